@@ -0,0 +1,83 @@
+// Purpose: Optional heap-allocation accounting that attributes operator new/delete calls, bytes and
+//          peak growth to the runtime phase that made them (RuntimeDiagPhase on firmware).
+// Invariants: Accounting only runs while enabled and assumes a single thread (the main loop); host
+//             tests enable it around single-threaded code only. Phase ids index a fixed table;
+//             out-of-range ids fold into phase 0 ("none").
+// Notes: Pure logic (no Arduino deps). ALLOC_PROFILER compiles AllocProfilerHooks.cpp, which
+//        replaces the global operator new/delete with size-prefixed versions that feed this module.
+//        malloc()/free() called directly (by the SDK or libraries) are not seen.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#ifndef ALLOC_PROFILER
+#define ALLOC_PROFILER 0
+#endif
+
+constexpr size_t kAllocProfilerPhaseCount = 8;
+
+struct AllocPhaseStats {
+	uint32_t allocs;
+	uint32_t frees;
+	uint32_t allocBytes;
+	uint32_t freeBytes;
+	// Largest net growth between two phase changes.
+	uint32_t peakBytes;
+};
+
+struct AllocProfile {
+	AllocPhaseStats phases[kAllocProfilerPhaseCount];
+	uint32_t liveBytes;
+	uint32_t peakLiveBytes;
+};
+
+void allocProfilerEnable(bool enabled);
+bool allocProfilerEnabled(void);
+void allocProfilerReset(void);
+// Makes phase current and returns the previous one.
+uint8_t allocProfilerEnterPhase(uint8_t phase);
+uint8_t allocProfilerPhase(void);
+void allocProfilerNoteAlloc(size_t bytes);
+void allocProfilerNoteFree(size_t bytes);
+const AllocProfile &allocProfile(void);
+
+// Attributes allocations to phase for its lifetime, then restores the previous phase.
+class AllocPhaseScope {
+public:
+	explicit AllocPhaseScope(uint8_t phase) : previous_(allocProfilerEnterPhase(phase)) {}
+	~AllocPhaseScope() { allocProfilerEnterPhase(previous_); }
+	AllocPhaseScope(const AllocPhaseScope &) = delete;
+	AllocPhaseScope &operator=(const AllocPhaseScope &) = delete;
+
+private:
+	uint8_t previous_;
+};
+
+// Enables accounting for its lifetime and reports the calls made since construction, summed over
+// all phases. Used for allocation budgets such as "a steady-state poll pass allocates nothing".
+class AllocWindow {
+public:
+	AllocWindow();
+	~AllocWindow();
+	AllocWindow(const AllocWindow &) = delete;
+	AllocWindow &operator=(const AllocWindow &) = delete;
+
+	uint32_t allocs() const;
+	uint32_t frees() const;
+	uint32_t allocBytes() const;
+
+private:
+	bool wasEnabled_;
+	uint32_t allocs_;
+	uint32_t frees_;
+	uint32_t allocBytes_;
+};
+
+// {"<phase>":{"allocs":..,"frees":..,"bytes":..,"peak":..},..,"live":..,"peak_live":..}
+// Phases that never allocated are left out; names[i] labels phase i.
+bool buildAllocProfileJson(const AllocProfile &profile,
+                           const char *const *names,
+                           size_t nameCount,
+                           char *out,
+                           size_t outSize);
@@ -0,0 +1,40 @@
+// Purpose: Feed one extra RS485 bus from the active poll plan a few transactions at a time.
+// Invariants: A due bucket owes exactly one pass over its transactions; lower bucket ordinals
+//             (faster cadences) are fed first, and the bus queue is never filled past the lookahead.
+// Notes: Queued items carry the bucket ordinal, transaction index and read key so a completion can be
+//        matched back to the plan and discarded if the plan was rebuilt meanwhile. Pure logic.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "MqttEntities.h"
+#include "MultiBusPoller.h"
+
+constexpr size_t kBusPlanFeedBuckets = 6;
+// Queued transactions kept ahead of the bus; small so a newly due faster bucket is not stuck behind
+// a long slow pass.
+constexpr size_t kBusPlanFeedLookahead = 4;
+
+struct BusPlanFeed {
+	uint16_t cursor[kBusPlanFeedBuckets] = {};
+	uint16_t remaining[kBusPlanFeedBuckets] = {};
+};
+
+// Returns false for transactions this bus should not run.
+using BusPlanFeedFilterFn = bool (*)(const MqttEntityActiveBucket &bucket, const MqttPollTransaction &txn, void *ctx);
+
+const MqttEntityActiveBucket *busPlanFeedBucket(const MqttEntityActivePlan &plan, uint8_t ordinal);
+void busPlanFeedReset(BusPlanFeed &feed);
+// Owes one full pass of each bucket in dueBuckets (one bit per bucket ordinal), continuing from
+// where an unfinished pass stopped.
+void busPlanFeedMarkDue(BusPlanFeed &feed, const MqttEntityActivePlan &plan, uint8_t dueBuckets);
+bool busPlanFeedIdle(const BusPlanFeed &feed);
+// Tops the bus queue up to the lookahead while its link is online. Returns the number enqueued.
+size_t busPlanFeedFill(BusPlanFeed &feed,
+                       const MqttEntityActivePlan &plan,
+                       MultiBusPoller &poller,
+                       size_t bus,
+                       uint8_t slaveId,
+                       BusPlanFeedFilterFn filter,
+                       void *ctx);
@@ -0,0 +1,37 @@
+// Purpose: Optional short state topics ("a2/<device code>/<entity code>") so high-rate publishes
+//          are not dominated by "<deviceName>/<device id>/<entity key>/state" topic bytes.
+// Invariants: Codes are base36 hashes of names, never of catalog positions, so reordering or
+//             extending the catalog does not move existing entities. Entity codes are unique across
+//             the compiled catalog (enforced by host tests). Settable entities and entities with
+//             bespoke state templates keep their long topics.
+// Notes: Pure logic (no Arduino deps) so it can be unit tested on host. MQTT_COMPACT_TOPICS opts in;
+//        the code -> entity map is published retained to "<deviceName>/compact_topics".
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "Definitions.h"
+
+#ifndef MQTT_COMPACT_TOPICS
+#define MQTT_COMPACT_TOPICS 0
+#endif
+
+constexpr size_t kCompactTopicEntityCodeLen = 4;
+constexpr size_t kCompactTopicDeviceCodeLen = 6;
+// "a2/" + device code + "/" + entity code + NUL.
+constexpr size_t kCompactTopicMaxLen = 3 + kCompactTopicDeviceCodeLen + 1 + kCompactTopicEntityCodeLen + 1;
+
+// Writes the entity code for an entity key (e.g. "Grid_Power" -> 4 base36 chars).
+bool compactTopicEntityCode(const char *entityKey, char *out, size_t outLen);
+// Writes "a2/<device code>", derived from the device name and the scope's device id.
+bool buildCompactTopicPrefix(const char *deviceName, const char *deviceId, char *out, size_t outLen);
+// Writes "a2/<device code>/<entity code>". False when the device id is not known yet.
+bool buildCompactStateTopic(const char *deviceName,
+                            const char *deviceId,
+                            const char *entityKey,
+                            char *out,
+                            size_t outLen);
+bool compactTopicEntityEligible(mqttEntityId entityId, bool subscribe);
+// Writes "<deviceName>/compact_topics".
+bool buildCompactTopicMapTopic(const char *deviceName, char *out, size_t outLen);
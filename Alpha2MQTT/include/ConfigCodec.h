@@ -1,9 +1,27 @@
+// Purpose: Text codec for the persisted runtime settings (A2mConfig) as "key=value;" pairs, written
+//          to and read from caller-provided buffers.
+// Invariants: No heap allocation. Encoding never writes past outSize and always NUL-terminates;
+//             decoding never reads past len and never overflows a field. Payloads start with "v=<n>;";
+//             payloads without it are version 1 (the original four keys) and still decode.
+// Notes: String values escape ';', '=', '%' and control bytes as %XX, so any SSID or password round
+//        trips. Unknown keys are skipped so older firmware can read newer payloads of the same
+//        version; a newer version is refused rather than half-applied.
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
-#include <string>
 
 #include "BootModes.h"
+#include "InverterFleet.h"
+
+constexpr uint32_t kConfigCodecVersion = 2;
+// Longest WiFi/MQTT string setting, matching the 64-byte Preferences buffers.
+constexpr size_t kConfigStringMaxLen = 63;
+constexpr size_t kConfigInverterLabelMaxLen = 10;
+constexpr size_t kConfigSlaveListMaxLen = kInverterSlaveIdListMaxLen - 1;
+// Worst case: every string at its limit and fully escaped (3 bytes per character), plus the NUL.
+constexpr size_t kConfigEncodedMaxBytes =
+	320 + 3 * (5 * kConfigStringMaxLen + kConfigInverterLabelMaxLen + kConfigSlaveListMaxLen) + 1;
 
 struct A2mConfig {
 	uint32_t pollIntervalSeconds;
@@ -11,6 +29,26 @@ struct A2mConfig {
 	// Persist the reboot intent so the next boot can distinguish intentional reboots from crashes.
 	BootIntent bootIntent;
 	uint64_t enabledRegisterMask;
+	char wifiSsid[kConfigStringMaxLen + 1];
+	char wifiPass[kConfigStringMaxLen + 1];
+	char mqttServer[kConfigStringMaxLen + 1];
+	uint16_t mqttPort;
+	char mqttUser[kConfigStringMaxLen + 1];
+	char mqttPass[kConfigStringMaxLen + 1];
+	char inverterLabel[kConfigInverterLabelMaxLen + 1];
+	// 0 means the baud is detected rather than configured.
+	uint32_t rs485Baud;
+	// Comma-separated Modbus slave ids, primary first; empty means the default slave.
+	char rs485SlaveIds[kConfigSlaveListMaxLen + 1];
+	bool extAntenna;
+};
+
+enum class ConfigDecodeStatus : uint8_t {
+	Ok,
+	// Some values were malformed, too long or out of range; those fields kept their defaults.
+	Partial,
+	// Written by a newer codec version; the config is left at defaults.
+	UnsupportedVersion,
 };
 
 constexpr uint32_t kPollIntervalMinSeconds = 1;
@@ -20,6 +58,8 @@ constexpr uint32_t kPollIntervalDefaultSeconds = 60;
 A2mConfig defaultConfig();
 uint32_t clampPollInterval(uint32_t valueSeconds);
 
-std::string serializeConfig(const A2mConfig &config);
-A2mConfig deserializeConfig(const std::string &payload);
+// Returns the encoded length (without the NUL), or 0 when out is too small.
+size_t serializeConfig(const A2mConfig &config, char *out, size_t outSize);
+// Decodes up to len bytes (or the first NUL) into config, which starts from defaultConfig().
+ConfigDecodeStatus deserializeConfig(const char *payload, size_t len, A2mConfig &config);
 BootIntent consumeBootIntent(A2mConfig &config);
@@ -0,0 +1,75 @@
+// Purpose: Cooperative task table for loop(): run only subsystems that are due, highest priority first.
+// Invariants: Tasks never preempt each other; each due task runs at most once per pass.
+//             Due checks are wraparound-safe (same signed-difference rule as shouldRun()).
+// Notes: Pure logic; time comes from nowMillis() so host tests can drive it with TimeProviderFake.
+//        Names must be string literals (stored by pointer, also used as the JSON key).
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+constexpr size_t kMaxCoopTasks = 16;
+constexpr uint8_t kCoopTaskInvalid = 0xFF;
+// "No deadline" for next-due queries; far enough out to stay clear of the 2^31 wraparound window.
+constexpr uint32_t kCoopNoDeadlineMs = 3600000UL;
+
+using CoopTaskFn = void (*)(void *ctx);
+// Milliseconds until the task has work (0 = now). Must be cheap and side-effect free.
+using CoopNextDueFn = uint32_t (*)(uint32_t nowMs, void *ctx);
+
+struct CoopTaskStats {
+	uint32_t runs = 0;
+	// Wall time spent inside the task (ms). On the ESP this is loop-core CPU time.
+	uint32_t cpuMs = 0;
+	uint32_t lastRunMs = 0;
+	uint32_t maxRunMs = 0;
+	// Runs that took longer than the task's budget.
+	uint32_t overruns = 0;
+	// Lateness between the due time and the actual start.
+	uint32_t maxLatencyMs = 0;
+};
+
+struct CoopTask {
+	const char *name = nullptr;
+	CoopTaskFn fn = nullptr;
+	void *ctx = nullptr;
+	// 0 = due on every pass, unless nextDue is set (then only when nextDue reports work).
+	uint32_t periodMs = 0;
+	CoopNextDueFn nextDue = nullptr;
+	uint32_t budgetMs = 0;
+	// Lower runs first; ties keep registration order.
+	uint8_t priority = 0;
+	bool enabled = true;
+	uint32_t nextWakeMs = 0;
+	CoopTaskStats stats{};
+};
+
+struct CoopScheduler {
+	CoopTask tasks[kMaxCoopTasks];
+	uint8_t count = 0;
+	// Registration indices sorted by priority; rebuilt on each add.
+	uint8_t order[kMaxCoopTasks] = {};
+	uint32_t passes = 0;
+};
+
+// Returns the task id, or kCoopTaskInvalid when the table is full or the task is malformed.
+// A new task is due immediately.
+uint8_t coopSchedulerAdd(CoopScheduler &sched,
+                         const char *name,
+                         CoopTaskFn fn,
+                         void *ctx,
+                         uint32_t periodMs,
+                         uint8_t priority,
+                         uint32_t budgetMs);
+// Lets a task report its own deadline (e.g. the next poll bucket) so loop() can sleep until then.
+// With a non-zero period the task also runs at least once per period.
+void coopSchedulerSetNextDue(CoopScheduler &sched, uint8_t id, CoopNextDueFn nextDue);
+void coopSchedulerSetEnabled(CoopScheduler &sched, uint8_t id, bool enabled);
+// Makes a task due now (e.g. after an I/O event), without waiting for its period.
+void coopSchedulerWake(CoopScheduler &sched, uint8_t id);
+bool coopSchedulerDue(const CoopScheduler &sched, uint8_t id, uint32_t nowMs);
+// Runs every due task once in priority order. Returns the number of tasks that ran.
+size_t coopSchedulerRunDue(CoopScheduler &sched);
+// Milliseconds until the earliest task is due, clamped to capMs (0 = something is due now).
+uint32_t coopSchedulerMsUntilNextDue(const CoopScheduler &sched, uint32_t nowMs, uint32_t capMs);
+const CoopTask *coopSchedulerTask(const CoopScheduler &sched, uint8_t id);
@@ -0,0 +1,9 @@
+// Purpose: Standard CRC-32 (IEEE 802.3, reflected, as used by zlib) for records kept in flash.
+// Invariants: crc32Ieee("123456789") == 0xCBF43926; an empty input hashes to 0.
+// Notes: Pure logic (no Arduino deps). Half-byte table, so it costs 64 bytes rather than 1 KiB.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+uint32_t crc32Ieee(const void *data, size_t len);
@@ -167,6 +167,8 @@ Customise these options as per README.txt.  Please read README.txt before contin
 #endif
 
 // Default address of inverter is 0x55 as per Alpha Modbus documentation.  If you have altered it, reflect that change here.
+// Paralleled inverters on one bus each answer on their own address; RegisterHandler::setSlaveId() selects
+// the target at runtime and this value is only the default for the primary inverter.
 #define ALPHA_SLAVE_ID 0x55
 
 // x 50mS to wait for RS485 input chars.  300ms as per Modbus documentation, but I got timeouts on that.  However 400ms works without issue
@@ -1223,7 +1225,8 @@ enum modbusRequestAndResponseStatusValues
 	payloadExceededCapacity,
 	addedToPayload,
 //	notValidIncomingTopic,
-	readDataInvalidValue
+	readDataInvalidValue,
+	responsePending
 };
 #define MODBUS_REQUEST_AND_RESPONSE_PREPROCESSING_MQTT_DESC "preProcessing"
 #define MODBUS_REQUEST_AND_RESPONSE_NOT_HANDLED_REGISTER_MQTT_DESC "notHandledRegister"
@@ -1243,6 +1246,7 @@ enum modbusRequestAndResponseStatusValues
 #define MODBUS_REQUEST_AND_RESPONSE_ADDED_TO_PAYLOAD_MQTT_DESC "addedToPayload"
 //#define MODBUS_REQUEST_AND_RESPONSE_NOT_VALID_INCOMING_TOPIC_MQTT_DESC "notValidIncomingTopic"
 #define MODBUS_REQUEST_AND_RESPONSE_READ_DATA_INVALID_VALUE_MQTT_DESC "readDataInvalidValue"
+#define MODBUS_REQUEST_AND_RESPONSE_RESPONSE_PENDING_MQTT_DESC "responsePending"
 
 
 #define MODBUS_REQUEST_AND_RESPONSE_PREPROCESSING_DISPLAY_DESC "PRE-PROC"
@@ -1263,6 +1267,7 @@ enum modbusRequestAndResponseStatusValues
 #define MODBUS_REQUEST_AND_RESPONSE_ADDED_TO_PAYLOAD_DISPLAY_DESC "ADDED-PAYL"
 //#define MODBUS_REQUEST_AND_RESPONSE_NOT_VALID_INCOMING_TOPIC_DISPLAY_DESC "INV-IN-TOP"
 #define MODBUS_REQUEST_AND_RESPONSE_READ_DATA_INVALID_VALUE_DISPLAY_DESC "INV-VAL"
+#define MODBUS_REQUEST_AND_RESPONSE_RESPONSE_PENDING_DISPLAY_DESC "RSP-WAIT"
 
 #define MAX_CHARACTER_VALUE_LENGTH 21
 #define MAX_MQTT_NAME_LENGTH 81
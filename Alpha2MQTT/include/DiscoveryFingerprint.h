@@ -0,0 +1,51 @@
+// Purpose: Remember a 32-bit fingerprint of every retained HA discovery payload so reconnects can
+//          skip republishing configs the broker already holds.
+// Invariants: Fingerprints are FNV-1a over the topic followed by the exact payload bytes, so a topic
+//             change, a payload change, or a clear (empty payload) always changes the value.
+//             A persisted table is only trusted when its catalog and firmware hashes match.
+// Notes: Pure logic (no Arduino deps) so it can be unit tested on host. Slots 0..N-1 are catalog
+//        entity indices; the extra slots cover discovery payloads that are not catalog entities.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "MqttEntities.h"
+
+constexpr uint32_t kFingerprintSeed = 2166136261UL;
+
+uint32_t fingerprintUpdate(uint32_t hash, const void *data, size_t len);
+uint32_t fingerprintString(uint32_t hash, const char *text);
+
+enum DiscoveryFingerprintExtraSlot : size_t {
+	kDiscoveryFingerprintSlotConfig = kMqttEntityDescriptorCount,
+	kDiscoveryFingerprintSlotInverterSerial,
+	kDiscoveryFingerprintSlotControllerDevice,
+	kDiscoveryFingerprintSlotInverterDevice,
+	kDiscoveryFingerprintSlotCount
+};
+
+struct DiscoveryFingerprintTable {
+	uint32_t catalogHash;
+	uint32_t versionHash;
+	uint32_t fingerprints[kDiscoveryFingerprintSlotCount];
+	uint8_t known[(kDiscoveryFingerprintSlotCount + 7) / 8];
+	bool dirty;
+};
+
+void discoveryFingerprintReset(DiscoveryFingerprintTable &table, uint32_t catalogHash, uint32_t versionHash);
+bool discoveryFingerprintMatches(const DiscoveryFingerprintTable &table, size_t slot, uint32_t fingerprint);
+// Records a successfully published payload; marks the table dirty only when the value changed.
+void discoveryFingerprintStore(DiscoveryFingerprintTable &table, size_t slot, uint32_t fingerprint);
+size_t discoveryFingerprintKnownCount(const DiscoveryFingerprintTable &table);
+
+// Flash blob: magic, format, slot count, catalog/version hashes, known bitset, fingerprints, checksum.
+size_t discoveryFingerprintBlobSize(void);
+size_t discoveryFingerprintSerialize(const DiscoveryFingerprintTable &table, uint8_t *out, size_t outLen);
+// Loads a blob written by discoveryFingerprintSerialize(). On any mismatch or corruption the table is
+// reset (empty, with the given hashes) and false is returned.
+bool discoveryFingerprintDeserialize(DiscoveryFingerprintTable &table,
+                                     const uint8_t *in,
+                                     size_t len,
+                                     uint32_t catalogHash,
+                                     uint32_t versionHash);
@@ -37,6 +37,13 @@ uint32_t dispatchRemainingSeconds(uint32_t acceptedAtMs,
                                   uint32_t nowMs);
 bool dispatchEvalDue(uint32_t lastEvalMs, uint32_t nowMs, uint32_t intervalMs, bool forceImmediate);
 bool dispatchCountdownPublishDue(uint32_t lastCountdownPublishMs, uint32_t nowMs);
+// Milliseconds until dispatchEvalDue() or (when countdownActive) dispatchCountdownPublishDue()
+// would fire; 0 when either is due now. Lets loop() sleep instead of polling dispatchService().
+uint32_t dispatchMsUntilDue(uint32_t lastEvalMs,
+                            uint32_t evalIntervalMs,
+                            bool countdownActive,
+                            uint32_t lastCountdownPublishMs,
+                            uint32_t nowMs);
 bool dispatchUseFastEvalCadence(const TimedDispatchRuntimeState &state,
                                 bool timedEnabled,
                                 bool rs485Live);
@@ -0,0 +1,31 @@
+// Purpose: Pick where one polled entity state goes: the offline history ring, its bucket batch
+//          document, the outbound queue, or straight to its own topic.
+// Invariants: While MQTT is down a history-eligible sample is offered to the ring before any publish
+//             path; batch documents are only built on a connected client. When a path turns the
+//             value away the caller clears that path's flag and asks again.
+// Notes: Pure logic (no Arduino deps) so the TELEMETRY_HISTORY / MQTT_STATE_BATCH /
+//        MQTT_OUTBOUND_QUEUE build combinations can be checked on host.
+#pragma once
+
+#include <cstdint>
+
+enum class EntityStateRoute : uint8_t {
+	History,
+	Batch,
+	Queue,
+	Direct
+};
+
+struct EntityStateRouteInput {
+	// Build options compiled in.
+	bool historyEnabled = false;
+	bool batchEnabled = false;
+	bool queueEnabled = false;
+	// Regular state publish for the primary inverter (not discovery, not a secondary slot).
+	bool primaryState = false;
+	bool mqttConnected = false;
+	bool historyEligible = false;
+	bool batchEligible = false;
+};
+
+EntityStateRoute entityStateRoute(const EntityStateRouteInput &in);
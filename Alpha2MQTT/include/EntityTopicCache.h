@@ -0,0 +1,49 @@
+// Purpose: Per-scope "<deviceName>/<device id>/" topic prefixes built once per identity change, so
+//          the publish hot path writes prefix + flash-resident entity name + suffix with memcpy only.
+// Invariants: A cached prefix always equals what buildEntityTopicBase() would produce for the same
+//             identity (minus the entity key). The inverter prefix is rebuilt whenever the serial or
+//             readiness it was built from differs from the caller's, or after an explicit invalidate.
+// Notes: Pure logic (no Arduino deps) so it can be unit tested on host.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "DiscoveryModel.h"
+#include "MqttEntities.h"
+
+constexpr size_t kEntityTopicPrefixMaxLen = 112;
+constexpr size_t kEntityTopicDeviceIdMaxLen = 64;
+
+struct EntityTopicPrefix {
+	char text[kEntityTopicPrefixMaxLen];
+	uint8_t len;
+	char deviceId[kEntityTopicDeviceIdMaxLen];
+	bool valid;
+};
+
+struct EntityTopicCache {
+	EntityTopicPrefix scopes[2];
+	bool built[2];
+	// Identity the inverter prefix was built from.
+	bool inverterReady;
+	char serial[24];
+	uint32_t rebuilds;
+};
+
+void entityTopicCacheInit(EntityTopicCache &cache);
+// Forces both prefixes to be rebuilt on next use (identity or label change).
+void entityTopicCacheInvalidate(EntityTopicCache &cache);
+// Returns the scope's prefix, rebuilding it first when stale. Never null; check ->valid.
+const EntityTopicPrefix *entityTopicCachePrefix(EntityTopicCache &cache,
+                                                DiscoveryDeviceScope scope,
+                                                const char *deviceName,
+                                                const char *controllerId,
+                                                const char *serial,
+                                                bool inverterReady);
+// Writes prefix + entity name + suffix (e.g. "/state"). Returns the length, 0 when invalid or too long.
+size_t entityTopicCompose(const EntityTopicPrefix &prefix,
+                          const mqttState *entity,
+                          const char *suffix,
+                          char *out,
+                          size_t outLen);
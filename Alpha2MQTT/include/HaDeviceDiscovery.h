@@ -0,0 +1,46 @@
+// Purpose: Support Home Assistant device-based discovery, where one retained
+//          "homeassistant/device/<id>/config" payload carries every component of a device.
+// Invariants: The compactor is a streaming filter: output is byte-for-byte deterministic for a given
+//             input regardless of how the input is chunked, so counted publishes stay consistent.
+//             String values are never rewritten; only object keys are abbreviated.
+// Notes: Pure logic (no Arduino deps) so it can be unit tested on host. HA_DEVICE_DISCOVERY opts
+//        into this mode at build time; per-entity discovery remains the default.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#ifndef HA_DEVICE_DISCOVERY
+#define HA_DEVICE_DISCOVERY 0
+#endif
+
+// Returns HA's documented abbreviation for a discovery key, or nullptr when it has none.
+const char *haDiscoveryAbbreviation(const char *key, size_t keyLen);
+
+// Writes "homeassistant/device/<deviceId>/config".
+bool buildHaDeviceDiscoveryTopic(const char *deviceId, char *out, size_t outLen);
+
+using HaJsonSink = bool (*)(void *ctx, const char *data, size_t len);
+
+// Longest key the compactor can abbreviate; longer strings pass through unchanged.
+constexpr size_t kHaJsonCompactorKeyMax = 32;
+constexpr size_t kHaJsonCompactorOutSize = 96;
+
+struct HaJsonCompactor {
+	HaJsonSink sink;
+	void *sinkCtx;
+	bool ok;
+	size_t emitted;
+	uint8_t state;
+	bool escaped;
+	char token[kHaJsonCompactorKeyMax];
+	size_t tokenLen;
+	char out[kHaJsonCompactorOutSize];
+	size_t outLen;
+};
+
+// Drops insignificant whitespace and abbreviates object keys while forwarding to sink.
+void haJsonCompactorBegin(HaJsonCompactor &compactor, HaJsonSink sink, void *sinkCtx);
+bool haJsonCompactorFeed(HaJsonCompactor &compactor, const char *text, size_t len);
+// Flushes any buffered output; returns false if the sink failed at any point.
+bool haJsonCompactorFinish(HaJsonCompactor &compactor);
@@ -0,0 +1,75 @@
+// Purpose: Describe the inverters that share one RS485 bus and hand out bus time fairly between them.
+// Invariants: Slot slave ids are unique, valid unicast Modbus addresses; slot 0 is the primary inverter.
+// Notes: Bus time is charged per completed transaction (start-time fair queueing), so a slow or
+//        timing-out inverter cannot starve a healthy one sharing the same wire. Pure logic, no Arduino deps.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+constexpr size_t kMaxInvertersPerBus = 4;
+constexpr size_t kInverterSlaveIdListMaxLen = kMaxInvertersPerBus * 4 + 1;
+
+struct InverterSlot {
+	uint8_t slaveId = 0;
+	bool backlogged = false;
+	char serial[17] = {};
+	// Virtual bus time (ms) attained so far; compared with wraparound-safe differences.
+	uint32_t busTimeMs = 0;
+	uint32_t transactions = 0;
+	uint32_t failures = 0;
+	// Poll buckets (one bit per bucket ordinal) this inverter still owes for the current periods.
+	uint8_t dueBuckets = 0;
+	// When the slot's current poll turn started; a parked turn is charged from here once it finishes.
+	uint32_t turnStartMs = 0;
+	bool turnFailed = false;
+};
+
+struct InverterFleet {
+	InverterSlot slots[kMaxInvertersPerBus];
+	uint8_t count = 0;
+	// Tie-break rotation so equal-service inverters alternate instead of slot 0 always winning.
+	uint8_t nextTieBreak = 0;
+	// Slot whose poll turn stopped on a deferred RS485 reply; it runs again before anyone else.
+	int8_t parkedSlot = -1;
+};
+
+// Drives one inverter's poll work. The firmware runs its bucket passes here; tests substitute their own.
+struct InverterFleetPollHooks {
+	void *context = nullptr;
+	// Runs the owed buckets for one slot and returns the ones still owed. Sets *ok to false when a
+	// transaction failed, and *parked when the slot stopped on a deferred reply.
+	uint8_t (*runSlot)(void *context, size_t index, uint8_t dueBuckets, bool *ok, bool *parked) = nullptr;
+	uint32_t (*nowMs)(void *context) = nullptr;
+};
+
+// Parses "85", "0x55,0x56" or "85 86". Returns the number of ids written, or 0 when any entry is
+// invalid, duplicated, or the list exceeds outMax.
+size_t parseInverterSlaveIdList(const char *text, uint8_t *out, size_t outMax);
+bool formatInverterSlaveIdList(const uint8_t *ids, size_t count, char *out, size_t outLen);
+
+// Resets all accounting. Invalid or duplicate ids leave the fleet empty and return false.
+bool inverterFleetInit(InverterFleet &fleet, const uint8_t *slaveIds, size_t count);
+int inverterFleetIndexOf(const InverterFleet &fleet, uint8_t slaveId);
+
+// Marks a slot as having (or not having) poll work queued. A slot that becomes backlogged after
+// idling is advanced to the least service among busy slots so it cannot bank credit while idle.
+void inverterFleetSetBacklogged(InverterFleet &fleet, size_t index, bool backlogged);
+
+// Returns the backlogged slot with the least attained bus time, or -1 when nothing is queued.
+int inverterFleetNextSlot(InverterFleet &fleet);
+void inverterFleetCharge(InverterFleet &fleet, size_t index, uint32_t elapsedMs, bool ok);
+
+// Owes `dueMask` to every inverter and queues them all for a poll turn.
+void inverterFleetMarkDue(InverterFleet &fleet, uint8_t dueMask);
+// Forgets all owed work, including a parked turn (its reply is abandoned by the caller).
+void inverterFleetClearDue(InverterFleet &fleet);
+bool inverterFleetHasWork(const InverterFleet &fleet);
+
+// Gives one inverter its poll turn: the parked slot if any, else inverterFleetNextSlot(). The turn
+// is charged with the wall time it took once it finishes. Returns the slot that ran, or -1.
+int inverterFleetPollTurn(InverterFleet &fleet, const InverterFleetPollHooks &hooks);
+
+void inverterFleetSetSerial(InverterFleet &fleet, size_t index, const char *serial);
+// Per-inverter HA device identifier ("alpha2mqtt_inv_<serial>"); empty until the serial is known.
+bool inverterFleetDeviceIdentifier(const InverterFleet &fleet, size_t index, char *out, size_t outLen);
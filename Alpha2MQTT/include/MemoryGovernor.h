@@ -0,0 +1,76 @@
+// Purpose: Turn the runtime heap level from evaluateRuntimeMem() into concrete degradations
+//          (smaller polling-config chunks, slower discovery, deferred plan rebuilds, compact status
+//          JSON, paused diagnostics, shed low-priority publishes) so a tight heap slows the firmware
+//          down instead of making large publishes fail.
+// Invariants: The policy is a fixed table indexed by MemLevel. Escalation is immediate; relaxing
+//             steps down one level at a time and only after kMemGovernorRelaxSamples consecutive
+//             calmer samples, so a borderline heap cannot flap. Every decision is counted; the first
+//             decision of each kind per pressure episode is also kept in a small event log.
+// Notes: Pure logic (no Arduino deps, no dynamic allocation) so it can be unit tested on host.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "MemoryHealth.h"
+
+constexpr uint8_t kMemGovernorRelaxSamples = 3;
+constexpr size_t kMemGovernorEventLogSize = 8;
+
+struct MemGovernorPolicy {
+	// Upper bound for one polling-config chunk map (bytes).
+	uint16_t pollingConfigChunkMax;
+	// Minimum gap between streamed discovery payloads; 0 = one per loop turn.
+	uint16_t discoveryGapMs;
+	// Leave a queued polling-config change (and its plan rebuild) queued until pressure eases.
+	bool deferPlanRebuild;
+	// Build status JSON with the compact builders directly.
+	bool compactStatus;
+	// Skip optional status diagnostics (tasks, scratch, power-snapshot diag).
+	bool pauseDiagnostics;
+	// Drop controller-diagnostic entity states (MqttOutboundClass::Diagnostics).
+	bool shedLowPriority;
+};
+
+enum class MemGovernorDecision : uint8_t {
+	Escalate = 0,
+	Relax,
+	ShrinkChunk,
+	SlowDiscovery,
+	DeferPlanRebuild,
+	CompactStatus,
+	PauseDiagnostics,
+	ShedPublish
+};
+constexpr size_t kMemGovernorDecisionCount = 8;
+
+struct MemGovernorEvent {
+	uint32_t atMs;
+	MemGovernorDecision decision;
+	// Governed level at the time of the decision.
+	MemLevel level;
+};
+
+struct MemGovernor {
+	MemLevel level;
+	uint8_t calmSamples;
+	uint32_t counts[kMemGovernorDecisionCount];
+	// Decisions already logged during the current level; cleared on every level change.
+	uint8_t loggedMask;
+	MemGovernorEvent events[kMemGovernorEventLogSize];
+	// Total events logged; the newest is events[(eventCount - 1) % kMemGovernorEventLogSize].
+	uint32_t eventCount;
+};
+
+const MemGovernorPolicy &memGovernorPolicyFor(MemLevel level);
+const MemGovernorPolicy &memGovernorPolicy(const MemGovernor &gov);
+// Feeds one evaluateRuntimeMem() result; returns true when the governed level changed.
+bool memGovernorSample(MemGovernor &gov, MemLevel sampled, uint32_t nowMs);
+// Records a degradation the caller just applied.
+void memGovernorNote(MemGovernor &gov, MemGovernorDecision decision, uint32_t nowMs);
+const char *memGovernorDecisionName(MemGovernorDecision decision);
+const char *memLevelName(MemLevel level);
+
+// {"level":"warn","counts":{"escalate":1,..},"events":[{"at_ms":..,"decision":"..","level":".."},..]}
+// Events are oldest first.
+bool buildMemGovernorJson(const MemGovernor &gov, char *out, size_t outSize);
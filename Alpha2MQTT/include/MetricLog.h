@@ -0,0 +1,127 @@
+// Purpose: Append-only on-flash time-series log of key metrics (power tuple, SOC, energy counters)
+//          that survives reboots and can be range-queried from the HTTP control plane.
+// Invariants: Data lives in fixed-size blocks grouped into numbered segment files. Every block is
+//             self-describing (time range, base values, checksum), so a torn or missing block only
+//             loses its own records. Records inside a block are delta/varint encoded against the
+//             previous record. Blocks are written once, whole; segments are only ever appended to
+//             or deleted (oldest first), which keeps flash wear even.
+// Notes: Pure logic (no Arduino deps) so it can be unit tested on host; the filesystem sits behind
+//        MetricLogStore. METRIC_LOG opts into the LittleFS-backed log and its /history.csv route.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "Definitions.h"
+
+#ifndef METRIC_LOG
+#define METRIC_LOG 0
+#endif
+
+#ifndef METRIC_LOG_INTERVAL_S
+#define METRIC_LOG_INTERVAL_S 60
+#endif
+
+constexpr size_t kMetricLogChannels = 9;
+constexpr size_t kMetricLogBlockBytes = 512;
+constexpr size_t kMetricLogHeaderBytes = 24 + 4 * kMetricLogChannels;
+constexpr size_t kMetricLogMaxSegments = 32;
+// A channel that has not been observed yet; exported as an empty CSV cell.
+constexpr int32_t kMetricLogNoValue = INT32_MIN;
+
+struct MetricLogChannel {
+	mqttEntityId entityId;
+	// CSV column name.
+	const char *column;
+};
+
+extern const MetricLogChannel kMetricLogChannelDefs[kMetricLogChannels];
+
+// Channel index for an entity, or -1 when the entity is not logged.
+int metricLogChannelFor(mqttEntityId entityId);
+
+struct MetricLogRecord {
+	// Wall-clock seconds (UTC).
+	uint32_t timeS;
+	// Fixed point, value * 1000; kMetricLogNoValue when unknown.
+	int32_t values[kMetricLogChannels];
+};
+
+struct MetricLogBlockHeader {
+	uint16_t count;
+	uint16_t used;
+	uint32_t firstTimeS;
+	uint32_t lastTimeS;
+	uint16_t intervalS;
+};
+
+// Block codec. The first record goes into the header; later ones are appended as deltas.
+void metricLogBlockBegin(uint8_t *block, uint16_t intervalS, const MetricLogRecord &first);
+// False when the record does not fit (block full) or is not newer than the last one.
+bool metricLogBlockAppend(uint8_t *block, const MetricLogRecord &record);
+bool metricLogBlockHeader(const uint8_t *block, size_t len, MetricLogBlockHeader *header);
+bool metricLogBlockValid(const uint8_t *block);
+
+using MetricLogRecordFn = bool (*)(void *ctx, const MetricLogRecord &record);
+
+// Emits records with fromS <= timeS <= toS. Returns false when fn asked to stop.
+bool metricLogBlockDecode(const uint8_t *block, uint32_t fromS, uint32_t toS, MetricLogRecordFn fn, void *ctx);
+
+class MetricLogStore {
+public:
+	virtual ~MetricLogStore() = default;
+	// Stored segment ids in ascending order; returns how many were written to ids.
+	virtual size_t listSegments(uint32_t *ids, size_t maxIds) = 0;
+	virtual uint16_t blockCount(uint32_t segmentId) = 0;
+	// Reads the first len bytes of a block.
+	virtual bool readBlock(uint32_t segmentId, uint16_t blockIndex, uint8_t *out, size_t len) = 0;
+	// Appends one full block to the segment, creating it when needed.
+	virtual bool appendBlock(uint32_t segmentId, const uint8_t *block) = 0;
+	virtual bool removeSegment(uint32_t segmentId) = 0;
+};
+
+struct MetricLogConfig {
+	uint16_t intervalS;
+	uint16_t blocksPerSegment;
+	uint16_t maxSegments;
+};
+
+struct MetricLogSegmentInfo {
+	uint32_t id;
+	uint32_t firstTimeS;
+	uint32_t lastTimeS;
+	uint16_t blocks;
+};
+
+struct MetricLogStats {
+	uint32_t appended;
+	// Records not newer than the last one (e.g. the clock stepped back).
+	uint32_t rejected;
+	uint32_t blocksWritten;
+	uint32_t writeFailures;
+	uint32_t segmentsRotated;
+	// Blocks (or headers) read by queries; a seek costs O(log n) header reads.
+	uint32_t blocksRead;
+};
+
+struct MetricLog {
+	MetricLogConfig config;
+	MetricLogSegmentInfo segments[kMetricLogMaxSegments];
+	uint8_t segmentCount;
+	// Newest records, not yet written; a valid block image that queries also read.
+	uint8_t pending[kMetricLogBlockBytes];
+	bool pendingActive;
+	uint32_t lastTimeS;
+	uint8_t readScratch[kMetricLogBlockBytes];
+	MetricLogStats stats;
+};
+
+// Rebuilds the segment index from the store (two header reads per segment).
+bool metricLogOpen(MetricLog &log, MetricLogStore &store, const MetricLogConfig &config);
+bool metricLogAppend(MetricLog &log, MetricLogStore &store, const MetricLogRecord &record);
+// Writes the partially filled block now (e.g. before a planned reboot).
+bool metricLogFlush(MetricLog &log, MetricLogStore &store);
+// Streams records in [fromS, toS] in time order. Returns records emitted.
+size_t metricLogQuery(MetricLog &log, MetricLogStore &store, uint32_t fromS, uint32_t toS, MetricLogRecordFn fn, void *ctx);
+uint32_t metricLogFirstTimeS(const MetricLog &log);
+size_t metricLogStoredBytes(const MetricLog &log);
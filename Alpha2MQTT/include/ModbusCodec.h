@@ -4,6 +4,11 @@
 #include <cstdint>
 
 constexpr size_t kModbusReadFrameSize = 8;
+constexpr uint8_t kModbusMinSlaveId = 1;
+constexpr uint8_t kModbusMaxSlaveId = 247;
+
+// Unicast RTU addresses only: 0 is broadcast and 248..255 are reserved.
+bool modbusSlaveIdIsValid(uint8_t slaveId);
 
 uint16_t calculateCrc(const uint8_t *frame, size_t length);
 void appendCrc(uint8_t *frame, size_t frameSize);
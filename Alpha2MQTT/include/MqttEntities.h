@@ -9,11 +9,7 @@
 #include <cstdint>
 
 #include "Definitions.h"
-
-struct MqttEntityBucketOverride {
-	uint16_t entityIndex;
-	BucketId bucketId;
-};
+#include "PackedBucketMap.h"
 
 enum class MqttPollTransactionKind : uint8_t {
 	SnapshotFanout = 0,
@@ -55,6 +51,15 @@ constexpr size_t kMqttEntityDescriptorCount =
 #undef MQTT_ENTITY_ROW
 ;
 
+// One catalog row as stored in flash, generated from MqttEntityCatalogRows.h. bits packs the update
+// frequency, HA class, family, scope, read kind and the subscribe/retain/needsEssSnapshot flags;
+// nameOffset points into a single NUL-separated name pool. The entity id is the row index.
+struct MqttEntityPackedRow {
+	uint32_t bits;
+	uint16_t nameOffset;
+	uint16_t readKey;
+};
+
 // Host/test code can still inspect the raw descriptor table. Firmware paths
 // should prefer copy helpers so ESP8266 builds can keep the catalog in flash.
 const mqttState *mqttEntitiesDesc();
@@ -63,11 +68,32 @@ bool mqttEntityCopyByIndex(size_t idx, mqttState *out);
 bool mqttEntityCopyById(mqttEntityId id, mqttState *out);
 bool mqttEntityIndexById(mqttEntityId id, size_t *outIdx);
 bool mqttEntityIndexByName(const char *name, size_t *outIdx);
+// O(1) through a compile-time perfect hash of the catalog names; name need not be NUL-terminated.
+bool mqttEntityIndexByNameSpan(const char *name, size_t len, size_t *outIdx);
 bool mqttEntityCopyCatalog(mqttState *out, size_t count);
 size_t mqttEntitiesCount();
 
+// Zero-copy reads of one field straight from the packed flash catalog, for paths that do not need
+// the whole mqttState. The name is a PGM pointer on ESP8266; out-of-range indexes return nullptr,
+// freqDisabled, haClassInfo, Controller family, Inverter scope, Derived, 0 and false.
+const char *mqttEntityNameByIndex(size_t idx);
+mqttUpdateFreq mqttEntityDefaultFreqByIndex(size_t idx);
+homeAssistantClass mqttEntityHaClassByIndex(size_t idx);
+MqttEntityFamily mqttEntityFamilyByIndex(size_t idx);
+MqttEntityScope mqttEntityScopeByIndex(size_t idx);
+MqttEntityReadKind mqttEntityReadKindByIndex(size_t idx);
+uint16_t mqttEntityReadKeyByIndex(size_t idx);
+bool mqttEntitySubscribeByIndex(size_t idx);
+bool mqttEntityRetainByIndex(size_t idx);
+// Flash taken by the packed rows plus the name pool.
+size_t mqttEntityCatalogFlashBytes();
+// Hash of the first count names and default freqs; appending entities keeps every prefix's value.
+uint32_t mqttEntityCatalogFingerprint(size_t count);
+
 bool mqttEntityNameEquals(const mqttState *entity, const char *name);
 void mqttEntityNameCopy(const mqttState *entity, char *out, size_t outSize);
+// Copies the name straight from the flash catalog and returns its length; 0 when it does not fit.
+size_t mqttEntityNameAppend(const mqttState *entity, char *out, size_t outSize);
 
 bool mqttEntityNeedsEssSnapshotByIndex(size_t idx);
 BucketId mqttEntityBucketByIndex(size_t idx);
@@ -75,6 +101,11 @@ mqttUpdateFreq mqttEntityEffectiveFreqByIndex(size_t idx);
 bool mqttEntityCopyBuckets(BucketId *outBuckets, size_t entityCount);
 bool mqttEntityCanApplyBuckets(const BucketId *buckets, size_t entityCount);
 bool mqttEntityApplyBuckets(const BucketId *buckets, size_t entityCount);
+// Effective buckets packed three bits per entity: a rollback point that costs 3/8 of a BucketId
+// array. Restoring rebuilds the plan like mqttEntityApplyBuckets().
+constexpr size_t kMqttEntityBucketSnapshotBytes = packedBucketMapBytes(kMqttEntityDescriptorCount);
+bool mqttEntitySaveBucketSnapshot(uint8_t *out, size_t outSize);
+bool mqttEntityRestoreBucketSnapshot(const uint8_t *snapshot, size_t size);
 bool mqttEntityIncludedInPublicSurface(const mqttState *entity);
 size_t mqttEntityCompactPublicSurfaceAssignments(mqttState *entities, BucketId *buckets, size_t entityCount);
 size_t mqttEntityCopyCompactedPublicSurfaceAssignments(const mqttState *srcEntities,
@@ -84,6 +115,8 @@ size_t mqttEntityCopyCompactedPublicSurfaceAssignments(const mqttState *srcEntit
                                                        BucketId *outBuckets);
 
 const MqttEntityActivePlan *mqttActivePlan();
+// Bytes in the single allocation backing the active plan and its packed bucket overrides.
+size_t mqttActivePlanStorageBytes();
 
 bool mqttEntitiesRtAvailable();
 
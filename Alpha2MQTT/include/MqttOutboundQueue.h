@@ -0,0 +1,118 @@
+// Purpose: Decouple value production from MQTT sends with a bounded, keyed outbound queue and a
+//          token-bucket rate shaper, so a slow link cannot stall RS485 polling.
+// Invariants: At most one pending entry per key; a newer value replaces an unsent older one in place
+//             (latest value wins, queue position kept). Entries drain strictly by class priority,
+//             then FIFO within a class. No heap use: all storage lives in the queue object.
+// Notes: Pure logic (no Arduino deps) so it can be unit tested on host. MQTT_OUTBOUND_QUEUE opts
+//        into routing entity state publishes through the queue; direct publishing remains the default.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "MqttEntities.h"
+
+#ifndef MQTT_OUTBOUND_QUEUE
+#define MQTT_OUTBOUND_QUEUE 0
+#endif
+
+#ifndef MQTT_OUTBOUND_RATE_PER_SEC
+#define MQTT_OUTBOUND_RATE_PER_SEC 20
+#endif
+
+#ifndef MQTT_OUTBOUND_BURST
+#define MQTT_OUTBOUND_BURST 8
+#endif
+
+constexpr size_t kMqttOutboundSlots = 32;
+// Longer values bypass the queue; entity states are short numbers or option labels.
+constexpr size_t kMqttOutboundPayloadMax = 40;
+// Inverter serials are at most 16 characters.
+constexpr size_t kMqttOutboundIdentityMax = 24;
+
+// Lower value drains first.
+enum class MqttOutboundClass : uint8_t {
+	Dispatch = 0,
+	Telemetry,
+	Diagnostics
+};
+constexpr size_t kMqttOutboundClassCount = 3;
+
+enum class MqttOutboundEnqueue : uint8_t {
+	Queued,
+	Coalesced,
+	// The queue was full and a lower-priority entry was dropped to make room.
+	QueuedWithEviction,
+	// Full with nothing lower-priority to evict, or the payload does not fit a slot.
+	Rejected
+};
+
+struct MqttTokenBucket {
+	uint32_t ratePerSec;
+	uint32_t burst;
+	// Scaled by 1000 so sub-token refills between short loop() turns are not lost.
+	uint32_t milliTokens;
+	uint32_t lastRefillMs;
+};
+
+void tokenBucketInit(MqttTokenBucket &bucket, uint32_t ratePerSec, uint32_t burst, uint32_t nowMs);
+bool tokenBucketTryTake(MqttTokenBucket &bucket, uint32_t nowMs);
+// 0 when a token is available now.
+uint32_t tokenBucketMsUntilToken(MqttTokenBucket &bucket, uint32_t nowMs);
+
+struct MqttOutboundEntry {
+	uint32_t seq;
+	uint16_t key;
+	uint8_t cls;
+	bool used;
+	bool retain;
+	char payload[kMqttOutboundPayloadMax];
+};
+
+struct MqttOutboundStats {
+	uint32_t queued;
+	uint32_t coalesced;
+	uint32_t dropped;
+	uint32_t rejected;
+	uint32_t sent;
+	uint32_t sendFailures;
+	uint32_t throttled;
+	uint16_t depth;
+	uint16_t maxDepth;
+};
+
+struct MqttOutboundQueue {
+	MqttOutboundEntry entries[kMqttOutboundSlots];
+	uint32_t nextSeq;
+	MqttTokenBucket shaper;
+	MqttOutboundStats stats;
+	// Identity the queued values belong to ("" = unknown); topics are rebuilt from it at send time.
+	char identity[kMqttOutboundIdentityMax];
+};
+
+// Returns false to leave the entry queued (e.g. the client could not take the bytes right now).
+using MqttOutboundSink = bool (*)(void *ctx, uint16_t key, const char *payload, bool retain);
+
+void mqttOutboundInit(MqttOutboundQueue &queue, uint32_t ratePerSec, uint32_t burst, uint32_t nowMs);
+MqttOutboundEnqueue mqttOutboundEnqueue(MqttOutboundQueue &queue,
+                                        uint16_t key,
+                                        MqttOutboundClass cls,
+                                        const char *payload,
+                                        bool retain);
+// Sends up to maxItems entries as tokens allow; stops at the first sink failure. Returns entries sent.
+size_t mqttOutboundDrain(MqttOutboundQueue &queue,
+                         uint32_t nowMs,
+                         size_t maxItems,
+                         MqttOutboundSink sink,
+                         void *ctx);
+// 0 when an entry can be sent now; noDeadlineMs when the queue is empty.
+uint32_t mqttOutboundMsUntilSend(MqttOutboundQueue &queue, uint32_t nowMs, uint32_t noDeadlineMs);
+// Drops every pending entry (e.g. identity change); counts them as dropped.
+void mqttOutboundClear(MqttOutboundQueue &queue);
+// Records the identity that produces the queued values. A different identity (nullptr or "" when it
+// is cleared) drops everything queued under the old one, so stale values never reach the new topics.
+// Returns the number of entries dropped.
+size_t mqttOutboundSetIdentity(MqttOutboundQueue &queue, const char *identity);
+
+// Dispatch state and control values first, controller-scoped values are diagnostics, the rest telemetry.
+MqttOutboundClass mqttOutboundClassFor(mqttEntityId entityId, MqttEntityReadKind readKind, MqttEntityScope scope);
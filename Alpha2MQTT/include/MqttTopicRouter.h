@@ -0,0 +1,19 @@
+// Purpose: Route inbound "<deviceName><suffix>" control topics to their handler with one hash lookup
+//          instead of a chain of string compares in mqttCallback().
+// Invariants: Every suffix in the route table is unique (enforced at compile time by the perfect hash).
+//             A topic routes only when it starts with the device name and the rest equals a suffix
+//             exactly; anything else is DeviceTopicRoute::None.
+// Notes: Pure logic (no Arduino deps) so it can be unit tested on host. Entity command topics are
+//        resolved separately through mqttEntityIndexByNameSpan().
+#pragma once
+
+#include <cstddef>
+
+enum class DeviceTopicRoute : unsigned char {
+	None = 0,
+	ConfigSet,
+	RawReadSet,
+	Rs485StubSet,
+};
+
+DeviceTopicRoute routeDeviceTopic(const char *topic, const char *deviceName);
@@ -0,0 +1,134 @@
+// Purpose: Overlap Modbus transactions on independent RS485 buses instead of serialising them.
+// Invariants: At most one transaction is in flight per bus; each bus owns its queue, budget, link
+//             state and diagnostics. A linked bus only runs queued work while its link is online.
+// Notes: Transport-agnostic so the concurrency, link handling and completion handling can be
+//        exercised on host with several stub buses. No Arduino deps; the caller supplies time and a
+//        completion callback.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// ESP32 parts expose up to three UARTs; UART0 usually stays on the USB console.
+constexpr size_t kMaxRs485Buses = 3;
+constexpr size_t kBusQueueDepth = 32;
+// Link handshake pacing, matching the primary bus probe.
+constexpr uint32_t kBusProbeAttemptDelayMs = 1000;
+constexpr uint32_t kBusProbeMaxBackoffMs = 15000;
+// Consecutive failed transactions that take an online link back to probing.
+constexpr uint8_t kBusLinkFailureLimit = 3;
+
+enum class BusTxnState : uint8_t {
+	Pending = 0,
+	Ok = 1,
+	Failed = 2,
+};
+
+enum class BusTxnKind : uint8_t {
+	// Caller-queued poll work.
+	Poll = 0,
+	// Link handshake issued by the poller: planIndex is the baud index to try.
+	Probe,
+	// Link handshake issued by the poller: read the identity at the locked baud.
+	Identify,
+};
+
+// Opaque unit of poll work; planIndex, bucket and readKey are interpreted by the caller (e.g. one
+// transaction of an active-plan bucket and the register it reads).
+struct BusTxn {
+	uint16_t planIndex = 0;
+	uint8_t slaveId = 0;
+	BusTxnKind kind = BusTxnKind::Poll;
+	uint8_t bucket = 0;
+	uint16_t readKey = 0;
+};
+
+class BusTransport {
+public:
+	virtual ~BusTransport() = default;
+	// Starts a transaction without waiting for the reply. Returning false counts as a failed transaction.
+	virtual bool beginTxn(const BusTxn &txn, uint32_t nowMs) = 0;
+	// Reports progress of the transaction started by beginTxn().
+	virtual BusTxnState pollTxn(uint32_t nowMs) = 0;
+};
+
+enum class BusLinkState : uint8_t {
+	// No link handshake: the transport manages its own connection.
+	Unmanaged = 0,
+	Probing,
+	Identifying,
+	Online,
+};
+
+struct BusLink {
+	BusLinkState state = BusLinkState::Unmanaged;
+	uint8_t slaveId = 0;
+	uint8_t baudCount = 0;
+	// Baud index the next probe tries; the locked one while identifying or online.
+	uint8_t baudIndex = 0;
+	uint8_t probesInCycle = 0;
+	uint8_t failures = 0;
+	uint32_t nextAttemptMs = 0;
+	uint32_t cycleBackoffMs = kBusProbeAttemptDelayMs;
+	// Bumped each time the link comes online, so the caller can spot a reconnect.
+	uint32_t epoch = 0;
+};
+
+struct BusDiag {
+	uint32_t started = 0;
+	uint32_t completed = 0;
+	uint32_t failed = 0;
+	// Work rejected because the bus queue was full, or dropped unrun (link down, queue cleared).
+	uint32_t dropped = 0;
+	// Cycles in which queued work was held back because the bus budget was spent.
+	uint32_t budgetDeferrals = 0;
+	uint32_t busyMs = 0;
+	uint32_t lastLatencyMs = 0;
+	uint32_t maxLatencyMs = 0;
+	uint32_t linkDrops = 0;
+	uint16_t queueHighWater = 0;
+};
+
+struct BusLane {
+	BusTransport *transport = nullptr;
+	BusTxn queue[kBusQueueDepth];
+	uint8_t head = 0;
+	uint8_t count = 0;
+	bool inFlight = false;
+	BusTxn current{};
+	uint32_t startedMs = 0;
+	// Per-cycle bus-time budget (0 = unlimited). New work is not started once it is spent.
+	uint32_t cycleBudgetMs = 0;
+	uint32_t cycleUsedMs = 0;
+	bool cycleDeferred = false;
+	BusLink link{};
+	BusDiag diag{};
+};
+
+struct MultiBusPoller {
+	BusLane lanes[kMaxRs485Buses];
+};
+
+using BusCompletionFn = void (*)(size_t bus, const BusTxn &txn, bool ok, uint32_t latencyMs, void *ctx);
+
+bool multiBusAttach(MultiBusPoller &poller, size_t bus, BusTransport *transport, uint32_t cycleBudgetMs);
+// Puts an attached bus behind a probe/identify handshake over baudCount candidate bauds. The
+// poller issues the handshake itself; queued work waits until the link is online.
+bool multiBusEnableLink(MultiBusPoller &poller, size_t bus, uint8_t slaveId, uint8_t baudCount);
+bool multiBusEnqueue(MultiBusPoller &poller, size_t bus, const BusTxn &txn);
+// Drops queued (not in-flight) work, e.g. after the poll plan was rebuilt.
+void multiBusClearQueue(MultiBusPoller &poller, size_t bus);
+// Starts a new budget cycle on every bus (typically once per poll-bucket tick).
+void multiBusBeginCycle(MultiBusPoller &poller);
+// Completes finished transactions and starts the next queued one (or link handshake) on every
+// idle bus. Returns the number of completions reported through onComplete.
+size_t multiBusService(MultiBusPoller &poller, uint32_t nowMs, BusCompletionFn onComplete, void *ctx);
+bool multiBusIdle(const MultiBusPoller &poller);
+size_t multiBusPending(const MultiBusPoller &poller, size_t bus);
+bool multiBusLinkOnline(const MultiBusPoller &poller, size_t bus);
+// 0 when a bus has work to start now, inFlightPollMs while only in-flight replies are awaited, the
+// time to the next link handshake otherwise, and noDeadlineMs when every bus is idle.
+uint32_t multiBusMsUntilWork(const MultiBusPoller &poller, uint32_t nowMs, uint32_t inFlightPollMs, uint32_t noDeadlineMs);
+const char *busLinkStateToString(BusLinkState state);
+// {"link":"online","baud_idx":0,"epoch":1,"queued":0,"started":..,...}
+bool multiBusDiagJson(const MultiBusPoller &poller, size_t bus, char *out, size_t outLen);
@@ -0,0 +1,94 @@
+// Purpose: Incremental WiFi and MQTT reconnect state machines advanced once per loop() turn, so
+//          a lost link never blocks RS485 polling or dispatch timing.
+// Invariants: A step never waits: it only returns the single platform action the caller should
+//             perform now. Retry spacing grows exponentially up to a cap and resets on success.
+//             Runtime WiFi recovery escalation reuses the WifiRecoveryPolicy decisions unchanged.
+// Notes: Pure logic (no Arduino deps) so it can be unit tested on host. Callers translate platform
+//        state into the step inputs and perform the returned action (WiFi.begin(), connect(), ...).
+#pragma once
+
+#include <cstdint>
+
+#include "BootModes.h"
+#include "WifiRecoveryPolicy.h"
+
+struct ReconnectTiming {
+	// How long one attempt may stay pending before it counts as failed (0: resolved synchronously).
+	uint32_t attemptTimeoutMs;
+	uint32_t backoffBaseMs;
+	uint32_t backoffMaxMs;
+};
+
+ReconnectTiming wifiReconnectTiming(void);
+ReconnectTiming mqttReconnectTiming(void);
+
+// Delay before retry number failedAttempts + 1: base * 2^failedAttempts, capped at max.
+uint32_t reconnectBackoffMs(const ReconnectTiming &timing, uint16_t failedAttempts);
+
+enum class WifiReconnectState : uint8_t {
+	Connected = 0,
+	Connecting,
+	Backoff
+};
+
+enum class WifiReconnectAction : uint8_t {
+	None = 0,
+	// The link just dropped: count the reconnect and reset failure tracking.
+	Lost,
+	// Start a station connection attempt (WiFi.begin()).
+	Begin,
+	// The link is back: run the post-connect bookkeeping.
+	Connected,
+	// The validation window expired without escalation: reset failure tracking.
+	RestartWindow,
+	// Stored credentials look invalid: reboot into the config portal.
+	RebootApConfig
+};
+
+struct WifiReconnect {
+	WifiReconnectState state;
+	uint16_t failedAttempts;
+	uint32_t attemptStartMs;
+	uint32_t nextAttemptMs;
+	uint32_t windowStartMs;
+};
+
+struct WifiReconnectInput {
+	uint32_t nowMs;
+	bool connected;
+	WifiFailureClass failureClass;
+	BootMode bootMode;
+	bool hasStoredCredentials;
+};
+
+void wifiReconnectInit(WifiReconnect &machine, uint32_t nowMs, bool connected);
+WifiReconnectAction wifiReconnectStep(WifiReconnect &machine, const WifiReconnectInput &input);
+
+enum class MqttReconnectState : uint8_t {
+	Connected = 0,
+	WaitWifi,
+	Backoff,
+	Connecting
+};
+
+enum class MqttReconnectAction : uint8_t {
+	None = 0,
+	// The session just dropped: tear down the stale client before the next attempt.
+	Lost,
+	// Attempt one broker connect now, then report it via mqttReconnectNoteResult().
+	Connect
+};
+
+struct MqttReconnect {
+	MqttReconnectState state;
+	uint16_t failedAttempts;
+	uint32_t nextAttemptMs;
+};
+
+// Gap between tearing down a dropped session and the first new connect.
+constexpr uint32_t kMqttReconnectSettleMs = 200;
+
+// Starts disconnected with the first attempt due immediately.
+void mqttReconnectInit(MqttReconnect &machine, uint32_t nowMs);
+MqttReconnectAction mqttReconnectStep(MqttReconnect &machine, uint32_t nowMs, bool wifiConnected, bool mqttConnected);
+void mqttReconnectNoteResult(MqttReconnect &machine, uint32_t nowMs, bool connected);
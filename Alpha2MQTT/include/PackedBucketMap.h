@@ -0,0 +1,50 @@
+// Purpose: Per-entity bucket state packed three bits per entity, plus one-bit entity sets, so
+//          runtime and config paths stay small as the entity catalog grows.
+// Invariants: Every BucketId (including Unknown) fits in kPackedBucketBits. Maps are caller-owned
+//             byte arrays of packedBucketMapBytes(entityCount); callers range-check idx.
+// Notes: Pure logic (no Arduino deps). A fresh map is filled with Unknown, which the entity runtime
+//        reads as "no override, use the catalog default".
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "Definitions.h"
+
+constexpr size_t kPackedBucketBits = 3;
+
+static_assert(static_cast<unsigned>(BucketId::Unknown) < (1u << kPackedBucketBits),
+              "BucketId outgrew the packed bucket map");
+
+constexpr size_t
+packedBucketMapBytes(size_t entityCount)
+{
+	return (entityCount * kPackedBucketBits + 7) / 8;
+}
+
+constexpr size_t
+entityBitsetBytes(size_t entityCount)
+{
+	return (entityCount + 7) / 8;
+}
+
+BucketId packedBucketGet(const uint8_t *map, size_t idx);
+void packedBucketSet(uint8_t *map, size_t idx, BucketId bucket);
+void packedBucketFill(uint8_t *map, size_t entityCount, BucketId bucket);
+// Packs buckets[0..entityCount) into map, reports whether map still holds exactly those values, or
+// expands map back into buckets.
+void packedBucketPack(uint8_t *map, const BucketId *buckets, size_t entityCount);
+bool packedBucketMatches(const uint8_t *map, const BucketId *buckets, size_t entityCount);
+void packedBucketUnpack(const uint8_t *map, BucketId *buckets, size_t entityCount);
+
+inline bool
+entityBitsetTest(const uint8_t *bits, size_t idx)
+{
+	return (bits[idx / 8] & static_cast<uint8_t>(1u << (idx % 8))) != 0;
+}
+
+inline void
+entityBitsetSet(uint8_t *bits, size_t idx)
+{
+	bits[idx / 8] = static_cast<uint8_t>(bits[idx / 8] | (1u << (idx % 8)));
+}
@@ -0,0 +1,143 @@
+// Purpose: Compile-time minimal perfect hash over a fixed list of string literals, so name lookups
+//          (entity names, topic suffixes) cost one string hash and one verifying compare.
+// Invariants: buildPerfectHash() maps every key to a distinct slot in [0, N) using one 16-bit seed per
+//             bucket of ~4 keys ("hash and displace"). ok is false when no seed works for some bucket,
+//             which always happens for duplicate keys; callers static_assert on it so a bad key list
+//             fails the build. Lookups only return candidates; callers must compare the key.
+// Notes: Pure logic (no Arduino deps) so it can be unit tested on host. Tables are plain constant data;
+//        perfectHashCandidate() reads them with pgm_read_word() on ESP8266 so they can live in PROGMEM.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+constexpr uint32_t kPerfectHashNoKey = 0xFFFFFFFFu;
+
+constexpr size_t
+perfectHashBucketCount(size_t keyCount)
+{
+	return keyCount == 0 ? 1 : (keyCount + 3) / 4;
+}
+
+// FNV-1a; usable both while building the table and at lookup time.
+constexpr uint32_t
+perfectHashString(const char *text, size_t len)
+{
+	uint32_t hash = 2166136261u;
+	for (size_t i = 0; i < len; ++i) {
+		hash ^= static_cast<uint8_t>(text[i]);
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+constexpr size_t
+perfectHashLength(const char *text)
+{
+	size_t len = 0;
+	while (text[len] != '\0') {
+		++len;
+	}
+	return len;
+}
+
+constexpr uint32_t
+perfectHashSlot(uint32_t keyHash, uint16_t seed, size_t slotCount)
+{
+	uint32_t h = keyHash ^ (static_cast<uint32_t>(seed) * 0x9E3779B9u);
+	h ^= h >> 16;
+	h *= 0x85EBCA6Bu;
+	h ^= h >> 13;
+	h *= 0xC2B2AE35u;
+	h ^= h >> 16;
+	return static_cast<uint32_t>(h % slotCount);
+}
+
+template <size_t N>
+struct PerfectHashTable {
+	uint16_t seeds[perfectHashBucketCount(N)];
+	// Key index stored in each slot.
+	uint16_t keys[N];
+	bool ok;
+};
+
+template <size_t N>
+constexpr PerfectHashTable<N>
+buildPerfectHash(const char *const (&keyList)[N])
+{
+	constexpr size_t kBuckets = perfectHashBucketCount(N);
+	static_assert(N > 0 && N <= 0xFFFF, "perfect hash key count out of range");
+	PerfectHashTable<N> table{};
+	uint32_t hashes[N] = {};
+	uint16_t bucketStart[kBuckets + 1] = {};
+	uint16_t members[N] = {};
+	bool used[N] = {};
+
+	// Counting sort of keys by bucket so each bucket's members are contiguous.
+	for (size_t i = 0; i < N; ++i) {
+		hashes[i] = perfectHashString(keyList[i], perfectHashLength(keyList[i]));
+		bucketStart[hashes[i] % kBuckets + 1]++;
+	}
+	size_t largest = 0;
+	for (size_t b = 0; b < kBuckets; ++b) {
+		if (bucketStart[b + 1] > largest) {
+			largest = bucketStart[b + 1];
+		}
+		bucketStart[b + 1] = static_cast<uint16_t>(bucketStart[b + 1] + bucketStart[b]);
+	}
+	uint16_t fill[kBuckets] = {};
+	for (size_t i = 0; i < N; ++i) {
+		const size_t b = hashes[i] % kBuckets;
+		members[bucketStart[b] + fill[b]] = static_cast<uint16_t>(i);
+		fill[b]++;
+	}
+
+	// Place the largest buckets first while most slots are still free.
+	for (size_t size = largest; size > 0; --size) {
+		for (size_t b = 0; b < kBuckets; ++b) {
+			if (static_cast<size_t>(bucketStart[b + 1] - bucketStart[b]) != size) {
+				continue;
+			}
+			bool placed = false;
+			for (uint32_t seed = 0; seed <= 0xFFFFu && !placed; ++seed) {
+				size_t claimed = 0;
+				for (size_t m = bucketStart[b]; m < bucketStart[b + 1]; ++m) {
+					const uint32_t slot = perfectHashSlot(hashes[members[m]], static_cast<uint16_t>(seed), N);
+					if (used[slot]) {
+						break;
+					}
+					used[slot] = true;
+					table.keys[slot] = members[m];
+					claimed++;
+				}
+				if (claimed == size) {
+					table.seeds[b] = static_cast<uint16_t>(seed);
+					placed = true;
+					break;
+				}
+				for (size_t m = bucketStart[b]; m < bucketStart[b] + claimed; ++m) {
+					used[perfectHashSlot(hashes[members[m]], static_cast<uint16_t>(seed), N)] = false;
+				}
+			}
+			if (!placed) {
+				return table;
+			}
+		}
+	}
+	table.ok = true;
+	return table;
+}
+
+// Key index the text would have if it is a member, or kPerfectHashNoKey for an empty table.
+uint32_t perfectHashCandidate(const uint16_t *seeds,
+                              const uint16_t *keys,
+                              size_t keyCount,
+                              const char *text,
+                              size_t len);
+
+template <size_t N>
+uint32_t
+perfectHashCandidate(const PerfectHashTable<N> &table, const char *text, size_t len)
+{
+	return perfectHashCandidate(table.seeds, table.keys, N, text, len);
+}
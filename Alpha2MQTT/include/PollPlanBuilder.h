@@ -0,0 +1,48 @@
+// Purpose: Build the active poll plan (per-bucket transactions and member lists) from any entity
+//          catalog in linear time, with everything the plan references in one right-sized arena.
+// Invariants: Every pass is a single walk of the catalog; the only scratch is the caller's
+//             read-group table, sized by distinct register reads rather than by entities.
+//             Transactions are ordered by their first member, and the members of one transaction
+//             are contiguous and in catalog order.
+// Notes: Pure logic (no Arduino deps). MqttEntities wires it to the packed flash catalog; host
+//        tests drive it with synthetic catalogs far larger than the compiled one.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "MqttEntities.h"
+
+// Read-only view of an entity catalog. readGroup() numbers the distinct register reads
+// 0..readGroupCount-1 and is only asked about RegisterFanout rows.
+struct PollPlanCatalog {
+	size_t entityCount;
+	size_t readGroupCount;
+	const void *ctx;
+	BucketId (*defaultBucket)(const void *ctx, size_t idx);
+	MqttPollTransactionKind (*kind)(const void *ctx, size_t idx);
+	uint16_t (*readKey)(const void *ctx, size_t idx);
+	uint16_t (*readGroup)(const void *ctx, size_t idx);
+};
+
+// User bucket for idx, or Unknown when the catalog default applies.
+using PollPlanOverrideFn = BucketId (*)(const void *ctx, size_t idx);
+
+struct PollPlanStorage {
+	MqttEntityActivePlan plan;
+	// PackedBucketMap of the overrides, Unknown where the default applies; null when there are none.
+	uint8_t *overrideMap;
+	size_t overrideCount;
+	uint8_t *arena;
+	size_t arenaBytes;
+};
+
+// Makes one allocation: [override map][transactions per bucket][members per bucket]. groupScratch
+// holds catalog.readGroupCount entries. Fails on an unresolvable bucket or allocation failure,
+// leaving out empty.
+bool pollPlanBuild(const PollPlanCatalog &catalog,
+                   PollPlanOverrideFn overrideFor,
+                   const void *overrideCtx,
+                   uint16_t *groupScratch,
+                   PollPlanStorage &out);
+void pollPlanRelease(PollPlanStorage &storage);
@@ -114,6 +114,18 @@ bool buildPollingConfigSetPayload(const char *pollIntervalS,
                                  char *out,
                                  size_t outSize);
 
+// Read the next "token=bucket" entry of a Bucket_Map string and advance cursor past it. Returns
+// false at the end of the map, or with malformed set when the entry is broken.
+bool nextBucketMapEntry(const char *&cursor,
+                        char *token,
+                        size_t tokenSize,
+                        char *bucket,
+                        size_t bucketSize,
+                        bool &malformed);
+// Syntax-only pass so appliers can reject a broken map before touching any assignment, instead of
+// staging a full copy of the bucket array.
+bool bucketMapWellFormed(const char *map);
+
 // Apply a Bucket_Map string into the provided bucket assignments. Supports both
 // "Entity_Name=bucket;" and compact "#<descriptor-index>=bucket;" tokens.
 bool applyBucketMapString(const char *map,
@@ -0,0 +1,58 @@
+// Purpose: Compact binary form of the polling bucket assignments for the boot path, so a stored
+//          config is restored with a CRC check and an unpack instead of reading and parsing the
+//          name-keyed text map.
+// Invariants: The record is bound to one stored Bucket_Map (by the size the storage reports for
+//             it, a metadata probe that needs no read) and to one catalog prefix (the fingerprint
+//             of the first entityCount entities). It is only trusted while both still match and
+//             its own CRC32 verifies; decode never writes buckets unless it returns Ok or Grown.
+// Notes: Pure logic (no Arduino deps). The text map stays the import/export and MQTT format and
+//        the source of truth; a missing, stale or corrupt record just means one text parse.
+//        Every writer of Bucket_Map here refreshes the record; only a same-size edit made by
+//        firmware that predates the record would go unnoticed.
+//        Layout, little-endian: "PC", version, bits per entity, entityCount (u16), catalog
+//        fingerprint (u32), text map size (u16), PackedBucketMap codes, CRC32 of all before it.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "PackedBucketMap.h"
+
+constexpr uint8_t kPollingConfigRecordVersion = 1;
+constexpr size_t kPollingConfigRecordHeaderBytes = 12;
+constexpr size_t kPollingConfigRecordCrcBytes = 4;
+
+constexpr size_t
+pollingConfigRecordBytes(size_t entityCount)
+{
+	return kPollingConfigRecordHeaderBytes + packedBucketMapBytes(entityCount) + kPollingConfigRecordCrcBytes;
+}
+
+enum class PollingConfigRecordStatus : uint8_t {
+	Ok,
+	// Written for a shorter catalog that is a prefix of this one: entities past the record keep
+	// whatever the caller pre-filled (the catalog defaults), and the record should be rewritten.
+	Grown,
+	// Well-formed but for another text map, catalog or format version; fall back to the text map.
+	Stale,
+	Corrupt,
+};
+
+// Fingerprint of the first count catalog entities; a longer catalog that only appends entities
+// must keep every shorter prefix's fingerprint.
+using PollingConfigFingerprintFn = uint32_t (*)(size_t count);
+
+// Returns the record length, or 0 when out is too small, entityCount or mapSize is out of range or
+// a bucket is Unknown.
+size_t pollingConfigRecordEncode(const BucketId *buckets,
+                                 size_t entityCount,
+                                 uint32_t catalogFingerprint,
+                                 size_t mapSize,
+                                 uint8_t *out,
+                                 size_t outSize);
+PollingConfigRecordStatus pollingConfigRecordDecode(const uint8_t *record,
+                                                    size_t len,
+                                                    size_t entityCount,
+                                                    PollingConfigFingerprintFn fingerprint,
+                                                    size_t mapSize,
+                                                    BucketId *buckets);
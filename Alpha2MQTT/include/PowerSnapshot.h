@@ -269,6 +269,8 @@ modbusStatusMqttLabel(modbusRequestAndResponseStatusValues result)
 		return MODBUS_REQUEST_AND_RESPONSE_ADDED_TO_PAYLOAD_MQTT_DESC;
 	case modbusRequestAndResponseStatusValues::readDataInvalidValue:
 		return MODBUS_REQUEST_AND_RESPONSE_READ_DATA_INVALID_VALUE_MQTT_DESC;
+	case modbusRequestAndResponseStatusValues::responsePending:
+		return MODBUS_REQUEST_AND_RESPONSE_RESPONSE_PENDING_MQTT_DESC;
 	default:
 		return MODBUS_REQUEST_AND_RESPONSE_PREPROCESSING_MQTT_DESC;
 	}
@@ -14,15 +14,48 @@ Handles Modbus requests and responses in a tidy class separate from main program
 #define _RS485Handler_h
 
 #include "Definitions.h"
-
-struct Rs485TransactionDiag {
-	uint16_t waitQ10 = 0;
-	uint16_t quietQ10 = 0;
-	uint8_t attempts = 0;
-	uint8_t retries = 0;
-	modbusRequestAndResponseStatusValues result = modbusRequestAndResponseStatusValues::preProcessing;
+#include "Rs485Replay.h"
+
+// One RS485 transceiver on its own hardware UART. Boards with spare UARTs can run
+// several handlers so separately wired inverters are polled on independent buses.
+struct Rs485PortConfig {
+	uint8_t uartNum;
+	int8_t rxPin;
+	int8_t txPin;
+	int8_t controlPin;
 };
 
+// Optional: a second RS485 bus for an inverter wired to its own transceiver (ESP32 only). It is
+// probed, identified and polled independently of the primary bus and publishes its register
+// readings under its own HA device.
+#ifndef RS485_AUX_BUS
+#define RS485_AUX_BUS 0
+#endif
+#if RS485_AUX_BUS
+#if RS485_STUB
+// The stub bus has no wiring; the UART number only seeds its serial.
+#ifndef RS485_AUX_UART
+#define RS485_AUX_UART 1
+#endif
+#ifndef RS485_AUX_RX_PIN
+#define RS485_AUX_RX_PIN -1
+#endif
+#ifndef RS485_AUX_TX_PIN
+#define RS485_AUX_TX_PIN -1
+#endif
+#ifndef RS485_AUX_CONTROL_PIN
+#define RS485_AUX_CONTROL_PIN -1
+#endif
+#elif !defined MP_ESP32
+#error "RS485_AUX_BUS needs a spare hardware UART (ESP32 only)"
+#elif !defined RS485_AUX_RX_PIN || !defined RS485_AUX_TX_PIN || !defined RS485_AUX_CONTROL_PIN
+#error "RS485_AUX_BUS needs RS485_AUX_RX_PIN, RS485_AUX_TX_PIN and RS485_AUX_CONTROL_PIN for the second transceiver"
+#endif
+#ifndef RS485_AUX_SLAVE_ID
+#define RS485_AUX_SLAVE_ID ALPHA_SLAVE_ID
+#endif
+#endif // RS485_AUX_BUS
+
 #if RS485_STUB
 #include "RS485HandlerStub.h"
 #else
@@ -63,8 +96,36 @@ struct Rs485TransactionDiag {
 #define TX_PIN 17							// Serial Transmit pin
 #define HW_UART_NUM 2				// Hardware UART
 #endif // MP_XIAO_ESP32C6
+#if RS485_AUX_BUS
+#ifndef RS485_AUX_UART
+#define RS485_AUX_UART ((HW_UART_NUM == 1) ? 0 : 1)	// The other hardware UART
+#endif
+#if RS485_AUX_UART == HW_UART_NUM
+#error "RS485_AUX_UART must differ from the primary RS485 UART"
+#endif
+#endif // RS485_AUX_BUS
 #endif // MP_ESP32
 
+// Optional: run Modbus I/O on a FreeRTOS task pinned to the other core (dual-core ESP32 only).
+// Frames cross to the worker and replies come back through lock-free SPSC rings. Inside a deferred
+// scope sendModbus() returns responsePending instead of waiting and the caller retries on a later
+// loop turn; outside one it still waits, servicing MQTT/HTTP through the service hook.
+#ifndef RS485_WORKER_TASK
+#define RS485_WORKER_TASK 0
+#endif
+#if defined MP_ESP32 && RS485_WORKER_TASK && !CONFIG_FREERTOS_UNICORE
+#define RS485_WORKER_ENABLED 1
+#include "SpscRing.h"
+#else
+#define RS485_WORKER_ENABLED 0
+#endif
+#ifndef RS485_WORKER_CORE
+#define RS485_WORKER_CORE 0					// Arduino loop() runs on core 1
+#endif
+#ifndef RS485_WORKER_STACK
+#define RS485_WORKER_STACK 4096
+#endif
+
 // Ensure RS485 is quiet for this many millis before transmitting to help avoid collisions.
 // Keep this overrideable so real-hardware tuning can be exercised without reshaping the call sites.
 #ifndef QUIET_MILLIS_BEFORE_TX
@@ -81,10 +142,20 @@ class RS485Handler
 		HardwareSerial* _RS485Serial;
 #endif
 
+		int _controlPin = SERIAL_COMMUNICATION_CONTROL_PIN;
+#if defined MP_ESP32
+		uint8_t _uartNum = HW_UART_NUM;
+		int _rxPin = RX_PIN;
+		int _txPin = TX_PIN;
+#endif
+
 		char* _debugOutput;
+		modbusRequestAndResponseStatusValues sendModbusOnBus(uint8_t frame[], byte actualFrameSize, modbusRequestAndResponse* resp, Rs485TransactionDiag &diag);
+		void noteTransaction(const Rs485TransactionDiag &diag);
+		void runServiceHook();
 		void flushRS485();
 		void checkRS485IsQuiet(uint32_t *quietMsAccum = nullptr);
-		modbusRequestAndResponseStatusValues listenResponse(modbusRequestAndResponse* resp, uint32_t *waitMsAccum = nullptr);
+		modbusRequestAndResponseStatusValues listenResponse(modbusRequestAndResponse* resp, uint8_t expectedSlaveId, uint32_t *waitMsAccum = nullptr);
 		bool checkForData(uint32_t *waitMsAccum = nullptr);
 		void (*_serviceHook)() = nullptr;
 #ifdef DEBUG_OUTPUT_TX_RX
@@ -95,12 +166,35 @@ class RS485Handler
 		bool _rs485IsOnline;
 		Rs485TransactionDiag _lastTransactionDiag{};
 		char uartInfoString[OLED_CHARACTER_WIDTH];
+#if RS485_WORKER_ENABLED
+		struct WorkerJob {
+			uint8_t frame[MAX_FRAME_SIZE];
+			byte frameSize;
+		};
+		WorkerHandoff<WorkerJob, Rs485WorkerReply, 2> _worker;
+		TaskHandle_t _workerTask = nullptr;
+		// Worker-owned receive buffer; the loop task only ever sees the copied reply.
+		modbusRequestAndResponse _workerResp{};
+		// Loop-task side of deferred sends; the worker never touches it.
+		Rs485ReplayChannel _replay;
+		bool onWorkerTask() const { return _workerTask != nullptr && xTaskGetCurrentTaskHandle() == _workerTask; }
+		bool submitToWorker(uint8_t frame[], byte actualFrameSize, uint32_t *seqOut);
+		bool collectWorkerReplies(uint32_t waitSeq, Rs485WorkerReply *waited);
+		void drainWorker();
+		modbusRequestAndResponseStatusValues deliverReply(const Rs485WorkerReply &reply, modbusRequestAndResponse* resp);
+		modbusRequestAndResponseStatusValues sendModbusViaWorker(uint8_t frame[], byte actualFrameSize, modbusRequestAndResponse* resp);
+		modbusRequestAndResponseStatusValues sendModbusDeferred(uint8_t frame[], byte actualFrameSize, modbusRequestAndResponse* resp);
+		static void workerTaskMain(void *arg);
+#endif
 
 	protected:
 
 
 	public:
 		RS485Handler();
+#if defined MP_ESP32
+		explicit RS485Handler(const Rs485PortConfig &port);
+#endif
 		~RS485Handler();
 		modbusRequestAndResponseStatusValues sendModbus(uint8_t frame[], byte actualFrameSize, modbusRequestAndResponse* resp);
 		void setServiceHook(void (*hook)());
@@ -111,6 +205,18 @@ class RS485Handler
 #endif // DEBUG_OVER_SERIAL || DEBUG_LEVEL2 || DEBUG_OUTPUT_TX_RX
 		void setBaudRate(unsigned long baudRate);
 		bool isRs485Online();
+#if RS485_WORKER_ENABLED
+		bool startWorkerTask();
+		bool workerTaskRunning() const { return _workerTask != nullptr; }
+#endif
+		// Reads inside a deferred scope return responsePending rather than waiting on the worker;
+		// re-run the same chain on a later turn to pick the replies up. No-ops without the worker.
+		void beginDeferredScope();
+		// True while the chain still waits on the bus.
+		bool endDeferredScope();
+		// True while the deferred request is still on the bus (nothing to collect yet).
+		bool deferredReplyOutstanding() const;
+		void abandonDeferred();
 		bool inTransaction() const { return _inTransaction; }
 		const Rs485TransactionDiag &lastTransactionDiag() const { return _lastTransactionDiag; }
 		char *uartInfo();
@@ -35,6 +35,10 @@
 #ifndef RS485_STUB_LATENCY_MS
 #define RS485_STUB_LATENCY_MS 0
 #endif
+#ifndef RS485_STUB_EXTRA_SLAVES
+// Additional emulated inverters answering on ALPHA_SLAVE_ID+1, +2, ... (paralleled-inverter sites).
+#define RS485_STUB_EXTRA_SLAVES 0
+#endif
 
 class RS485Handler
 {
@@ -72,6 +76,8 @@ class RS485Handler
 		Rs485StubConfig _cfg;
 		bool _cfgRuntime = false;
 		VirtualInverterState _state;
+		Rs485StubSlaveSet _slaves;
+		uint8_t _currentSlaveId = ALPHA_SLAVE_ID;
 		uint32_t _cfgAppliedMs = 0;
 		uint32_t _probeAttempts = 0;
 		int16_t _socStepX10PerSnapshot = 0;
@@ -142,6 +148,13 @@ class RS485Handler
 			if (reg >= REG_SYSTEM_INFO_R_EMS_SN_BYTE_1_2 &&
 			    reg < static_cast<uint16_t>(REG_SYSTEM_INFO_R_EMS_SN_BYTE_1_2 + 8)) {
 				const uint16_t offset = static_cast<uint16_t>(reg - REG_SYSTEM_INFO_R_EMS_SN_BYTE_1_2);
+				if (_currentSlaveId != ALPHA_SLAVE_ID) {
+					char serial[17] = { 0 };
+					rs485StubSerialForSlave(_currentSlaveId, ALPHA_SLAVE_ID, serial, sizeof(serial));
+					*outWord = static_cast<uint16_t>((static_cast<uint8_t>(serial[offset * 2]) << 8) |
+					                                 static_cast<uint8_t>(serial[offset * 2 + 1]));
+					return true;
+				}
 				const uint8_t b0 = _state.serialBytes[offset * 2];
 				const uint8_t b1 = _state.serialBytes[offset * 2 + 1];
 				*outWord = static_cast<uint16_t>((b0 << 8) | b1);
@@ -281,6 +294,22 @@ class RS485Handler
 		{
 			_cfg = buildConfig();
 			initDefaultSerial();
+			rs485StubSlaveSetAdd(_slaves, ALPHA_SLAVE_ID);
+			for (uint16_t i = 1; i <= RS485_STUB_EXTRA_SLAVES && ALPHA_SLAVE_ID + i <= 247; i++) {
+				rs485StubSlaveSetAdd(_slaves, static_cast<uint8_t>(ALPHA_SLAVE_ID + i));
+			}
+			_cfgAppliedMs = millis();
+		}
+
+		// Stand-in for an inverter on its own bus: it answers only on ALPHA_SLAVE_ID and reports a
+		// serial derived from the UART number so it never collides with the primary bus.
+		explicit RS485Handler(const Rs485PortConfig &port)
+		{
+			_cfg = buildConfig();
+			char serial[17] = { 0 };
+			snprintf(serial, sizeof(serial), "STUBSNUART%05u", static_cast<unsigned>(port.uartNum));
+			setSerialString(serial);
+			rs485StubSlaveSetAdd(_slaves, ALPHA_SLAVE_ID);
 			_cfgAppliedMs = millis();
 		}
 
@@ -477,6 +506,11 @@ class RS485Handler
 		uint32_t stubLastWriteMs() const { return _lastWriteMs; }
 		bool inTransaction() const { return _inTransaction; }
 		const Rs485TransactionDiag &lastTransactionDiag() const { return _lastTransactionDiag; }
+		// The stub answers synchronously, so deferred scopes never leave anything pending.
+		void beginDeferredScope() {}
+		bool endDeferredScope() { return false; }
+		bool deferredReplyOutstanding() const { return false; }
+		void abandonDeferred() {}
 
 		~RS485Handler() = default;
 
@@ -502,6 +536,16 @@ class RS485Handler
 			const uint8_t fn = frame[1];
 			resp->functionCode = fn;
 			_lastFn = fn;
+			_currentSlaveId = frame[0];
+
+			if (!rs485StubSlaveSetContains(_slaves, _currentSlaveId)) {
+				// Nobody answers on this address; the bus itself stays in whatever state it was.
+				resp->dataSize = 0;
+				strcpy(resp->statusMqttMessage, MODBUS_REQUEST_AND_RESPONSE_NO_RESPONSE_MQTT_DESC);
+				strcpy(resp->displayMessage, MODBUS_REQUEST_AND_RESPONSE_NO_RESPONSE_DISPLAY_DESC);
+				_lastTransactionDiag.result = modbusRequestAndResponseStatusValues::noResponse;
+				return modbusRequestAndResponseStatusValues::noResponse;
+			}
 
 			const uint16_t startRegister = static_cast<uint16_t>((frame[2] << 8) | frame[3]);
 			const uint16_t registerCount = static_cast<uint16_t>((frame[4] << 8) | frame[5]);
@@ -655,7 +699,7 @@ class RS485Handler
 							strcpy(resp->displayMessage, MODBUS_REQUEST_AND_RESPONSE_ERROR_DISPLAY_DESC);
 							return modbusRequestAndResponseStatusValues::slaveError;
 						}
-						word = rs485StubWordForRegister(reg);
+						word = rs485StubWordForSlaveRegister(_currentSlaveId, ALPHA_SLAVE_ID, reg);
 					}
 					resp->data[i * 2] = static_cast<uint8_t>((word >> 8) & 0xFF);
 					resp->data[i * 2 + 1] = static_cast<uint8_t>(word & 0xFF);
@@ -33,6 +33,9 @@ class RegisterHandler
 {
 	private:
 		RS485Handler* _modBus;
+		// Modbus address of the inverter this handler talks to. Paralleled inverters
+		// share one RS485Handler and differ only by slave id.
+		uint8_t _slaveId = ALPHA_SLAVE_ID;
 
 		// We will have a function to set serial number prefix as error codes depend on whether the
 		// system serial number begings AL or AE.
@@ -50,6 +53,8 @@ class RegisterHandler
 
 		void setModbus(RS485Handler* modBus);
 		void setSerialNumberPrefix(uint8_t char1, uint8_t char2);
+		void setSlaveId(uint8_t slaveId);
+		uint8_t slaveId() const { return _slaveId; }
 		modbusRequestAndResponseStatusValues readHandledRegister(uint16_t registerAddress, modbusRequestAndResponse* rs);
 		modbusRequestAndResponseStatusValues readRawRegister(uint16_t registerAddress, modbusRequestAndResponse* rs);
 		modbusRequestAndResponseStatusValues readRawRegisterBlock(uint16_t registerAddress, uint16_t registerCount, modbusRequestAndResponse* rs);
@@ -0,0 +1,81 @@
+// Purpose: Let the loop() task issue RS485 reads without waiting on the worker task for the reply.
+// Invariants: Owner-side only (never touched by the worker). At most one deferred request is in flight;
+//             replies are replayed strictly in the order the chain asked for them.
+// Notes: A caller runs its whole request chain inside a scope each loop turn. The first frame that has
+//        no reply yet is submitted (or found still in flight) and every later send in that scope reports
+//        pending, so the chain unwinds without taking fallback branches. On the next turn the chain runs
+//        again from the top and each already-answered frame is answered from the replay list. Pure logic.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "Definitions.h"
+
+struct Rs485TransactionDiag {
+	uint16_t waitQ10 = 0;
+	uint16_t quietQ10 = 0;
+	uint8_t attempts = 0;
+	uint8_t retries = 0;
+	modbusRequestAndResponseStatusValues result = modbusRequestAndResponseStatusValues::preProcessing;
+};
+
+// Everything one bus transaction produces, handed back by value so the worker writes no shared state.
+// Only the response fields the receive path fills are carried; request-side fields stay with the caller.
+struct Rs485WorkerReply {
+	modbusRequestAndResponseStatusValues result = modbusRequestAndResponseStatusValues::preProcessing;
+	Rs485TransactionDiag diag{};
+	uint8_t data[MAX_FRAME_SIZE] = {};
+	uint8_t dataSize = 0;
+	uint8_t functionCode = 0;
+	char statusMqttMessage[MAX_MQTT_STATUS_LENGTH] = {};
+	char displayMessage[OLED_CHARACTER_WIDTH_SMALL] = {};
+};
+
+void rs485ReplyFromResponse(const modbusRequestAndResponse &resp, Rs485WorkerReply &reply);
+void rs485ReplyToResponse(const Rs485WorkerReply &reply, modbusRequestAndResponse &resp);
+
+// Longest chain that can be replayed; the derived load reading issues nine frames.
+constexpr size_t kRs485ReplayDepth = 9;
+
+enum class Rs485ReplayStep : uint8_t {
+	Replayed,	// Reply copied out; the chain carries on.
+	Submit,		// Submit this frame, then report submitted() or submitFailed().
+	Pending,	// Reply not in yet; unwind and retry on a later turn.
+	Wait,		// Replay list is full; send this frame the blocking way.
+};
+
+class Rs485ReplayChannel {
+public:
+	void beginScope();
+	// True while the chain still waits on a reply. A finished chain clears its replies.
+	bool endScope();
+	bool inScope() const { return _inScope; }
+
+	Rs485ReplayStep next(const uint8_t *frame, size_t frameSize, Rs485WorkerReply &out);
+	void submitted(const uint8_t *frame, size_t frameSize, uint32_t seq);
+	void submitFailed() { _scopePending = true; }
+
+	// Offers a collected result. Returns true when it answered the deferred request (and was kept).
+	bool collected(uint32_t seq, const Rs485WorkerReply &reply);
+	bool awaiting() const { return _inFlightSeq != 0; }
+	size_t replayCount() const { return _replayCount; }
+
+	// Drops the replay list and forgets the in-flight request; its reply is discarded when it lands.
+	void abandon();
+
+private:
+	struct Entry {
+		uint8_t frame[MAX_FRAME_SIZE];
+		uint8_t frameSize;
+		Rs485WorkerReply reply;
+	};
+	Entry _replay[kRs485ReplayDepth];
+	size_t _replayCount = 0;
+	size_t _replayNext = 0;
+	uint8_t _inFlightFrame[MAX_FRAME_SIZE] = {};
+	uint8_t _inFlightFrameSize = 0;
+	uint32_t _inFlightSeq = 0;
+	bool _inScope = false;
+	bool _scopePending = false;
+};
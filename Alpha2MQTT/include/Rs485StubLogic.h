@@ -5,6 +5,7 @@
 */
 #pragma once
 
+#include <cstdio>
 #include <cstdlib>
 #include <cstdint>
 #include <cstring>
@@ -204,3 +205,43 @@ rs485StubWordForRegister(uint16_t reg)
 	// Deterministic pseudo data: stable across boots and builds.
 	return static_cast<uint16_t>(reg ^ 0xA55A);
 }
+
+// Set of slave addresses the stub answers on; frames to any other address time out like a real bus.
+struct Rs485StubSlaveSet {
+	uint32_t bits[8] = {};
+};
+
+static inline void
+rs485StubSlaveSetAdd(Rs485StubSlaveSet &set, uint8_t slaveId)
+{
+	set.bits[slaveId >> 5] |= (1UL << (slaveId & 31));
+}
+
+static inline bool
+rs485StubSlaveSetContains(const Rs485StubSlaveSet &set, uint8_t slaveId)
+{
+	return (set.bits[slaveId >> 5] & (1UL << (slaveId & 31))) != 0;
+}
+
+static inline void
+rs485StubSerialForSlave(uint8_t slaveId, uint8_t primarySlaveId, char *out, size_t outLen)
+{
+	if (out == nullptr || outLen == 0) {
+		return;
+	}
+	// The primary keeps the historical serial so existing stub fixtures stay stable.
+	if (slaveId == primarySlaveId) {
+		snprintf(out, outLen, "STUBSN000000000");
+		return;
+	}
+	snprintf(out, outLen, "STUBSN000000%03u", static_cast<unsigned>(slaveId));
+}
+
+static inline uint16_t
+rs485StubWordForSlaveRegister(uint8_t slaveId, uint8_t primarySlaveId, uint16_t reg)
+{
+	if (slaveId == primarySlaveId) {
+		return rs485StubWordForRegister(reg);
+	}
+	return static_cast<uint16_t>(rs485StubWordForRegister(reg) ^ (static_cast<uint16_t>(slaveId) << 8));
+}
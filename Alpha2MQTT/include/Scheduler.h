@@ -11,6 +11,8 @@
 bool shouldRun(uint32_t now, uint32_t lastRun, uint32_t intervalMs);
 bool timedOut(uint32_t start, uint32_t now, uint32_t limitMs);
 uint32_t resetScheduleBaseline(uint32_t now);
+// Milliseconds until shouldRun() would return true for the same arguments (0 = due now).
+uint32_t msUntilDue(uint32_t now, uint32_t lastRun, uint32_t intervalMs);
 bool shouldBootstrapPublishEntity(mqttUpdateFreq freq);
 size_t normalizeDeferredCursor(size_t cursor, size_t totalCount);
 size_t nextDeferredCursor(size_t startCursor, size_t processedCount, size_t totalCount, bool truncated);
@@ -0,0 +1,84 @@
+// Purpose: Shared scratch buffers that phases which never overlap (discovery emit, status JSON,
+//          polling-config publish, portal rendering) lease in turn instead of each pinning its own.
+// Invariants: A pool has at most one holder. A lease that would overlap the holder, or that asks
+//             for more than the pool's capacity, is rejected and counted; it never shares bytes.
+//             Peak usage is what leases reported (or, for text, the string they left behind).
+// Notes: Pure logic (no Arduino deps) so it can be unit tested on host. Leases are RAII and
+//        release on scope exit; the backing block stays allocated once reserved.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+enum class ScratchPhase : uint8_t {
+	None = 0,
+	Discovery,
+	StatusJson,
+	PollingConfig,
+	Portal,
+};
+
+const char *scratchPhaseName(ScratchPhase phase);
+
+struct ScratchPoolStats {
+	uint32_t leases;
+	uint32_t rejected;
+	size_t peakBytes;
+	ScratchPhase peakPhase;
+	// Holder and requester of the most recent rejected lease.
+	ScratchPhase conflictHolder;
+	ScratchPhase conflictRequester;
+};
+
+struct ScratchPool {
+	const char *name;
+	size_t capacity;
+	uint8_t *storage;
+	ScratchPhase holder;
+	ScratchPoolStats stats;
+};
+
+void scratchPoolInit(ScratchPool &pool, const char *name, size_t capacity);
+// Allocates the backing block now rather than on the first lease.
+bool scratchPoolReserve(ScratchPool &pool);
+// Returns the backing block to the heap; a no-op while a lease is held.
+void scratchPoolFree(ScratchPool &pool);
+
+class ScratchLease {
+public:
+	ScratchLease(ScratchPool &pool, ScratchPhase phase, size_t bytes);
+	~ScratchLease();
+	ScratchLease(const ScratchLease &) = delete;
+	ScratchLease &operator=(const ScratchLease &) = delete;
+
+	bool ok() const
+	{
+		return pool_ != nullptr;
+	}
+	size_t size() const
+	{
+		return bytes_;
+	}
+	// NUL-terminated text buffer; its final length is recorded as the high-water mark on release.
+	char *chars();
+	template <typename T>
+	T *as(size_t count)
+	{
+		if (!ok() || count * sizeof(T) > bytes_) {
+			return nullptr;
+		}
+		noteUsed(count * sizeof(T));
+		return reinterpret_cast<T *>(pool_->storage);
+	}
+	void noteUsed(size_t bytes);
+
+private:
+	ScratchPool *pool_;
+	ScratchPhase phase_;
+	size_t bytes_;
+	size_t used_;
+	bool text_;
+};
+
+// {"<name>":{"cap":..,"peak":..,"peak_phase":"..","leases":..,"rejected":..,"conflict":"holder>requester"},..}
+bool buildScratchPoolsJson(const ScratchPool *const *pools, size_t count, char *out, size_t outSize);
@@ -0,0 +1,114 @@
+// Purpose: Write-behind layer for small, often rewritten settings (boot intent/mode, RS485 baud,
+//          polling last-change stamp): dirty values wait in RAM, repeated writes coalesce, and one
+//          flush commits every pending key with a single flash write.
+// Invariants: The journal is one record (generation, every key it owns, CRC32) written alternately
+//             to two slots, so a torn write leaves the previous generation readable and load takes
+//             the valid slot with the newest generation. A key the journal owns is never evicted,
+//             and a write equal to the value it already holds does not dirty it. Removed keys stay
+//             as tombstones so readers do not fall back to an older copy elsewhere.
+// Notes: Pure logic (no Arduino deps); storage sits behind SettingsStore, so host tests use an
+//        in-memory backend. Keys and values are bounded and the key table is fixed; a put that
+//        does not fit returns false and the caller writes that key through as before. Per-key
+//        flash write counts cover journal flushes and any write-through the caller reports.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#ifndef SETTINGS_JOURNAL_QUIET_MS
+#define SETTINGS_JOURNAL_QUIET_MS 5000
+#endif
+
+#ifndef SETTINGS_JOURNAL_MAX_DELAY_MS
+#define SETTINGS_JOURNAL_MAX_DELAY_MS 60000
+#endif
+
+constexpr size_t kSettingsJournalKeys = 8;
+// Room for the existing 19-character keys such as "polling_last_change".
+constexpr size_t kSettingsKeyMaxLen = 23;
+constexpr size_t kSettingsJournalValueMax = 32;
+constexpr size_t kSettingsWriteStatKeys = 16;
+constexpr uint32_t kSettingsJournalNoFlush = UINT32_MAX;
+
+// "SJ", version, entry count, generation (u32), entries, CRC32 of everything before it. An entry is
+// key length, key, kind, value length, value.
+constexpr size_t kSettingsJournalHeaderBytes = 8;
+constexpr size_t kSettingsJournalRecordMaxBytes =
+	kSettingsJournalHeaderBytes + kSettingsJournalKeys * (3 + kSettingsKeyMaxLen + kSettingsJournalValueMax) + 4;
+
+enum class SettingsValueKind : uint8_t {
+	Removed,
+	UInt,
+	String,
+};
+
+enum class SettingsLookup : uint8_t {
+	// The journal does not own the key; read it from wherever it lived before.
+	Missing,
+	Removed,
+	Present,
+};
+
+struct SettingsJournalEntry {
+	char key[kSettingsKeyMaxLen + 1];
+	SettingsValueKind kind;
+	uint8_t len;
+	bool dirty;
+	uint8_t value[kSettingsJournalValueMax];
+};
+
+struct SettingsWriteStat {
+	char key[kSettingsKeyMaxLen + 1];
+	uint32_t writes;
+};
+
+struct SettingsJournal {
+	SettingsJournalEntry entries[kSettingsJournalKeys];
+	size_t count;
+	uint32_t generation;
+	// Time of the first and of the latest change since the last flush.
+	uint32_t firstDirtyMs;
+	uint32_t lastDirtyMs;
+	uint32_t flushes;
+	uint32_t flushFailures;
+	// Puts that only replaced a value still waiting to be flushed, or matched the stored one.
+	uint32_t coalesced;
+	SettingsWriteStat stats[kSettingsWriteStatKeys];
+	size_t statCount;
+};
+
+class SettingsStore {
+public:
+	virtual ~SettingsStore() = default;
+	// Copies slot 0 or 1 into out and returns its length; 0 when empty or larger than outSize.
+	virtual size_t readSlot(uint8_t slot, uint8_t *out, size_t outSize) = 0;
+	virtual bool writeSlot(uint8_t slot, const uint8_t *data, size_t len) = 0;
+};
+
+void settingsJournalInit(SettingsJournal &journal);
+// Replaces the journal contents with the newest valid slot. False when neither slot is valid,
+// which leaves the journal empty (every lookup Missing).
+bool settingsJournalLoad(SettingsJournal &journal, SettingsStore &store);
+
+bool settingsJournalPutUInt(SettingsJournal &journal, const char *key, uint32_t value, uint32_t nowMs);
+bool settingsJournalPutString(SettingsJournal &journal, const char *key, const char *value, uint32_t nowMs);
+bool settingsJournalRemove(SettingsJournal &journal, const char *key, uint32_t nowMs);
+SettingsLookup settingsJournalGetUInt(const SettingsJournal &journal, const char *key, uint32_t &out);
+// Missing leaves out untouched; Removed stores "".
+SettingsLookup settingsJournalGetString(const SettingsJournal &journal, const char *key, char *out, size_t outSize);
+
+size_t settingsJournalPending(const SettingsJournal &journal);
+// Milliseconds until a flush is due: quietMs after the latest change, but no later than
+// maxDelayMs after the first one. kSettingsJournalNoFlush when nothing is pending.
+uint32_t settingsJournalMsUntilFlush(const SettingsJournal &journal,
+                                     uint32_t nowMs,
+                                     uint32_t quietMs = SETTINGS_JOURNAL_QUIET_MS,
+                                     uint32_t maxDelayMs = SETTINGS_JOURNAL_MAX_DELAY_MS);
+// Writes the next generation to the other slot. Pending keys stay dirty when the write fails.
+bool settingsJournalFlush(SettingsJournal &journal, SettingsStore &store);
+
+// Counts a write the caller made straight to flash, so the per-key totals cover every path.
+void settingsJournalNoteWrite(SettingsJournal &journal, const char *key);
+uint32_t settingsJournalWriteCount(const SettingsJournal &journal, const char *key);
+// {"gen":..,"pending":..,"flushes":..,"flush_failures":..,"coalesced":..,"writes":{"<key>":..,..}}
+bool buildSettingsJournalJson(const SettingsJournal &journal, char *out, size_t outSize);
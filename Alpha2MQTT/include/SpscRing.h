@@ -0,0 +1,119 @@
+// Purpose: Bounded lock-free single-producer/single-consumer ring plus a request/result handoff built on it.
+// Invariants: Exactly one thread pushes and exactly one thread pops each ring; Capacity is a power of two.
+//             Indices grow monotonically and wrap at 2^32, so fill level is always (tail - head).
+// Notes: The producer publishes tail with a release store after writing the slot and the consumer reads
+//        it with an acquire load before reading the slot (and vice versa for head), so no mutex is needed
+//        on the hot path. Portable C++11 atomics; used by the ESP32 RS485 worker task and host-tested
+//        with std::thread.
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+template <typename T, size_t Capacity>
+class SpscRing {
+	static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "SpscRing capacity must be a power of two");
+
+public:
+	// Producer side. Returns false (and leaves the ring untouched) when full.
+	bool push(const T &item)
+	{
+		const uint32_t tail = _tail.load(std::memory_order_relaxed);
+		const uint32_t head = _head.load(std::memory_order_acquire);
+		if (tail - head >= Capacity) {
+			return false;
+		}
+		_slots[tail & kMask] = item;
+		_tail.store(tail + 1, std::memory_order_release);
+		return true;
+	}
+
+	// Consumer side. Returns false when empty.
+	bool pop(T &out)
+	{
+		const uint32_t head = _head.load(std::memory_order_relaxed);
+		const uint32_t tail = _tail.load(std::memory_order_acquire);
+		if (head == tail) {
+			return false;
+		}
+		out = _slots[head & kMask];
+		_head.store(head + 1, std::memory_order_release);
+		return true;
+	}
+
+	// Approximate when called from a third thread; exact from either endpoint.
+	size_t size() const
+	{
+		return static_cast<size_t>(_tail.load(std::memory_order_acquire) - _head.load(std::memory_order_acquire));
+	}
+	bool empty() const { return size() == 0; }
+	static constexpr size_t capacity() { return Capacity; }
+
+private:
+	static constexpr uint32_t kMask = static_cast<uint32_t>(Capacity - 1);
+	T _slots[Capacity];
+	// Not cache-line padded: on the ESP32 the RAM cost outweighs the false-sharing win for a few slots.
+	std::atomic<uint32_t> _head{ 0 };
+	std::atomic<uint32_t> _tail{ 0 };
+};
+
+// Two SPSC rings forming a bounded request/result channel between an owner (e.g. loop()) and a worker.
+// The owner never has more than Depth requests outstanding, so the worker can always publish a result
+// and nothing is lost. Results carry the request sequence number and arrive in submission order.
+template <typename Payload, typename Outcome, size_t Depth>
+class WorkerHandoff {
+public:
+	struct Request {
+		uint32_t seq;
+		Payload payload;
+	};
+	struct Result {
+		uint32_t seq;
+		Outcome outcome;
+	};
+
+	// Owner side.
+	bool submit(const Payload &payload, uint32_t *seqOut = nullptr)
+	{
+		if (_submitted - _collected >= Depth) {
+			return false;
+		}
+		const Request request{ _submitted + 1, payload };
+		if (!_requests.push(request)) {
+			return false;
+		}
+		_submitted++;
+		if (seqOut != nullptr) {
+			*seqOut = request.seq;
+		}
+		return true;
+	}
+
+	bool collect(Result &out)
+	{
+		if (!_results.pop(out)) {
+			return false;
+		}
+		_collected++;
+		return true;
+	}
+
+	uint32_t outstanding() const { return _submitted - _collected; }
+	bool resultWaiting() const { return !_results.empty(); }
+
+	// Worker side.
+	bool take(Request &out) { return _requests.pop(out); }
+
+	bool complete(uint32_t seq, const Outcome &outcome)
+	{
+		return _results.push(Result{ seq, outcome });
+	}
+
+private:
+	SpscRing<Request, Depth> _requests;
+	SpscRing<Result, Depth> _results;
+	// Owner-only counters.
+	uint32_t _submitted = 0;
+	uint32_t _collected = 0;
+};
@@ -0,0 +1,59 @@
+// Purpose: Collect the entity states produced by one bucket pass into a single JSON document so
+//          batched mode can publish "<device>/<id>/bucket/<bucket>/state" once instead of once per entity.
+// Invariants: The document is always a valid JSON object once finished; entries never straddle a flush.
+//             Keys are entity keys (already topic-safe); values are emitted as JSON numbers when they
+//             parse as such and as escaped strings otherwise.
+// Notes: Pure logic (no Arduino deps) so it can be unit tested on host. The per-entity topics remain the
+//        default; MQTT_STATE_BATCH opts into this mode at build time.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "Definitions.h"
+
+#ifndef MQTT_STATE_BATCH
+#define MQTT_STATE_BATCH 0
+#endif
+
+// Sized for a typical ten-second bucket on ESP8266; larger buckets flush early and continue.
+constexpr size_t kStateBatchBufferSize = 768;
+constexpr size_t kStateBatchMaxEntries = 48;
+
+struct StateBatch {
+	char json[kStateBatchBufferSize];
+	size_t used;
+	uint16_t entityIndex[kStateBatchMaxEntries];
+	size_t entries;
+	bool finished;
+};
+
+enum class StateBatchAppend : uint8_t {
+	Added,
+	// Entry does not fit; flush the batch and append again.
+	Full,
+	// Entry can never fit (or arguments are invalid); publish it another way.
+	Rejected
+};
+
+void stateBatchReset(StateBatch &batch);
+StateBatchAppend stateBatchAppend(StateBatch &batch, const char *key, const char *value, uint16_t entityIndex);
+// Closes the JSON object and returns it (nullptr when no entries were added).
+const char *stateBatchFinish(StateBatch &batch);
+bool stateBatchValueIsNumber(const char *value);
+
+// Entities with bespoke state templates or retained state keep their own topics.
+bool stateBatchEntityEligible(mqttEntityId entityId, bool retained, BucketId bucket);
+
+// Writes "<deviceName>/<deviceId>/bucket/<bucket>/state".
+bool buildStateBatchTopic(const char *deviceName,
+                          const char *deviceId,
+                          BucketId bucket,
+                          char *out,
+                          size_t outLen);
+// Writes the HA value_template selecting one entity from a batch document; documents without the
+// entity's key leave its state unchanged.
+bool buildStateBatchValueTemplate(const char *entityKey, char *out, size_t outLen);
+
+// Bytes a QoS 0 PUBLISH packet occupies on the wire (fixed header, topic, payload).
+size_t mqttPublishPacketBytes(size_t topicLen, size_t payloadLen);
@@ -60,6 +60,13 @@ struct StatusNetSnapshot {
 	const char *wifiStatus;
 	int wifiStatusCode;
 	uint32_t wifiReconnects;
+	// Store-and-forward buffer (TELEMETRY_HISTORY); capacity 0 when the mode is compiled out.
+	uint32_t historySamples;
+	uint32_t historyUsedBytes;
+	uint32_t historyCapacityBytes;
+	uint32_t historyOldestAgeS;
+	uint32_t historyDropped;
+	uint32_t historyReplaySamplesPerSec;
 };
 
 struct StatusPollSnapshot {
@@ -97,6 +104,12 @@ struct StatusPollSnapshot {
 	uint32_t essSnapshotAttempts;
 	uint32_t essPowerSnapshotLastBuildMs;
 	uint32_t snapshotPublishSkipCount;
+	uint32_t haDiscoveryPublishCount;
+	uint32_t haDiscoverySkipCount;
+	uint32_t mqttOutDepth;
+	uint32_t mqttOutMaxDepth;
+	uint32_t mqttOutCoalesced;
+	uint32_t mqttOutDropped;
 	const char *rs485StubMode;
 	uint32_t rs485StubFailRemaining;
 	uint32_t rs485StubWriteCount;
@@ -279,3 +292,7 @@ bool buildStatusPowerSnapshotDiagLastJson(const StatusPowerSnapshotDiagLastSnaps
 bool buildStatusPowerSnapshotDiagCountsJson(const StatusPowerSnapshotDiagCountsSnapshot &snapshot,
                                             char *out,
                                             size_t outSize);
+
+struct CoopScheduler;
+// Per-task loop() accounting: {"passes":N,"tasks":{"<name>":{"runs":..,"cpu_ms":..,...}}}.
+bool buildStatusTasksJson(const CoopScheduler &sched, char *out, size_t outSize);
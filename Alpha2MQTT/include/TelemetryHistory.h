@@ -0,0 +1,97 @@
+// Purpose: Store-and-forward ring for entity samples taken while MQTT is down, replayed in batches
+//          to a history topic after reconnect so recorders can backfill the outage gap.
+// Invariants: Storage is a fixed ring of blocks; each block is self-contained (its own time base and
+//             value-delta table), so evicting the oldest block never corrupts the ones after it.
+//             Values are fixed-point (3 decimals) and stored as zigzag varint deltas against the
+//             previous value of the same key in the same block; times are varint deltas in ms.
+// Notes: Pure logic (no Arduino deps) so it can be unit tested on host. TELEMETRY_HISTORY opts into
+//        recording energy/power/SOC entities while offline; default builds keep their RAM.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "Definitions.h"
+
+#ifndef TELEMETRY_HISTORY
+#define TELEMETRY_HISTORY 0
+#endif
+
+#ifndef TELEMETRY_HISTORY_BLOCKS
+#define TELEMETRY_HISTORY_BLOCKS 16
+#endif
+
+constexpr size_t kTelemetryHistoryBlockBytes = 128;
+constexpr size_t kTelemetryHistoryBlockCount = TELEMETRY_HISTORY_BLOCKS;
+// Distinct keys per block that get delta coding; later keys in a full block are coded against 0.
+constexpr size_t kTelemetryHistoryDeltaKeys = 16;
+// Worst case record: 3-byte key + 5-byte time delta + 5-byte value delta.
+constexpr size_t kTelemetryHistoryMaxRecordBytes = 13;
+// Values are kept as value * 1000.
+constexpr int32_t kTelemetryHistoryValueScale = 1000;
+
+struct TelemetryHistoryBlock {
+	uint32_t baseMs;
+	uint32_t lastMs;
+	uint16_t used;
+	uint16_t samples;
+	uint8_t bytes[kTelemetryHistoryBlockBytes];
+};
+
+struct TelemetryHistoryStats {
+	uint32_t recorded;
+	// Samples lost to ring overwrite.
+	uint32_t dropped;
+	// Values that could not be stored (not numeric or out of range).
+	uint32_t rejected;
+	uint32_t replayed;
+	// Samples per second over the last replay that emptied the ring.
+	uint32_t lastReplaySamplesPerSec;
+};
+
+struct TelemetryHistory {
+	TelemetryHistoryBlock blocks[kTelemetryHistoryBlockCount];
+	uint8_t head;
+	uint8_t count;
+	// Encoder table for the newest block; mirrored by the decoder.
+	uint16_t deltaKeys[kTelemetryHistoryDeltaKeys];
+	int32_t deltaValues[kTelemetryHistoryDeltaKeys];
+	uint8_t deltaKeyCount;
+	bool replaying;
+	uint32_t replayStartMs;
+	uint32_t replaySamples;
+	TelemetryHistoryStats stats;
+};
+
+struct TelemetryHistorySample {
+	uint16_t key;
+	uint32_t timestampMs;
+	int32_t milliValue;
+};
+
+using TelemetryHistorySampleFn = bool (*)(void *ctx, const TelemetryHistorySample &sample);
+
+void telemetryHistoryInit(TelemetryHistory &history);
+// Parses a decimal string ("-12.5", "230") into value * 1000. False for anything else.
+bool telemetryHistoryParseValue(const char *text, int32_t *milliValue);
+// Formats value * 1000 back to the shortest decimal text ("12.5", "-3", "0.001").
+size_t telemetryHistoryFormatValue(int32_t milliValue, char *out, size_t outSize);
+
+bool telemetryHistoryRecord(TelemetryHistory &history, uint16_t key, uint32_t nowMs, int32_t milliValue);
+bool telemetryHistoryRecordText(TelemetryHistory &history, uint16_t key, uint32_t nowMs, const char *text);
+
+uint32_t telemetryHistorySampleCount(const TelemetryHistory &history);
+size_t telemetryHistoryUsedBytes(const TelemetryHistory &history);
+size_t telemetryHistoryCapacityBytes(void);
+// 0 when empty.
+uint32_t telemetryHistoryOldestAgeMs(const TelemetryHistory &history, uint32_t nowMs);
+
+// Decodes the oldest block in sample order; stops early when fn returns false. Returns samples visited.
+size_t telemetryHistoryForEachOldest(const TelemetryHistory &history, TelemetryHistorySampleFn fn, void *ctx);
+// Drops the oldest block after it was published; startedMs is when that publish began. Replay
+// throughput spans from the first popped batch until the ring is empty.
+void telemetryHistoryPopOldest(TelemetryHistory &history, uint32_t startedMs, uint32_t nowMs);
+
+// Inverter energy, power and SOC values feed HA graphs; settable (subscribed) entities are never buffered.
+// Retention is not a filter: the catalog retains most measurements so HA has a value after restart.
+bool telemetryHistoryEntityEligible(homeAssistantClass haClass, MqttEntityScope scope, bool subscribe);
@@ -0,0 +1,67 @@
+// Purpose: Persisted summary of what the last good boot learned (RS485 baud, inverter identity,
+//          plan and discovery fingerprints) so the next boot can resume with one verification read,
+//          plus the per-boot timings published as time-to-first-publish.
+// Invariants: A record is only trusted after the recorded serial is read back at the recorded baud
+//             from the recorded slave id; any other answer falls back to the full baud probe. Decoding
+//             rejects a wrong magic, version, length or CRC32, and strings that are not terminated.
+// Notes: Pure logic (no Arduino deps). Runtime identity stays live-only: the record only chooses
+//        where to look first (baud and expected serial); everything else, battery type included, is
+//        read from the inverter after the serial matches. The firmware, plan and discovery fingerprints decide whether the
+//        discovery refresh may wait for the first telemetry publish, not whether the baud is reused.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// "WS", version, then the fields in declaration order (little-endian), then CRC32.
+constexpr size_t kWarmStartRecordBytes = 3 + 4 + 1 + 4 + 4 + 17 + 20 + 4;
+// How long a resumed boot lets telemetry go ahead of an unchanged discovery refresh.
+constexpr uint32_t kWarmStartDiscoveryHoldMs = 5000;
+
+struct WarmStartRecord {
+	uint32_t baud;
+	uint8_t slaveId;
+	uint32_t planFingerprint;
+	uint32_t discoveryFingerprint;
+	char serial[17];
+	// Controller firmware build that wrote the record.
+	char firmware[20];
+};
+
+enum class WarmStartOutcome : uint8_t {
+	// No usable record; the baud probe ran from the start.
+	Cold,
+	// The verification read matched; the baud probe was skipped.
+	Resumed,
+	// The verification read failed or returned another serial; the full probe ran instead.
+	Mismatch,
+};
+
+struct WarmStartBootStats {
+	WarmStartOutcome outcome;
+	// The discovery refresh waited for the first telemetry publish.
+	bool discoveryHeld;
+	// Modbus reads spent before the inverter identity was established.
+	uint32_t identityReads;
+	// millis() at each milestone; 0 until reached.
+	uint32_t rs485ConnectedMs;
+	uint32_t firstPublishMs;
+};
+
+size_t warmStartEncode(const WarmStartRecord &record, uint8_t *out, size_t outSize);
+bool warmStartDecode(const uint8_t *in, size_t len, WarmStartRecord &record);
+bool warmStartRecordEqual(const WarmStartRecord &a, const WarmStartRecord &b);
+
+// True when the record describes slaveId, so its baud and serial are worth one verification read.
+bool warmStartUsable(const WarmStartRecord &record, uint8_t slaveId);
+bool warmStartVerified(const WarmStartRecord &record, const char *liveSerial);
+// True when this firmware, plan and discovery table are the ones the record was written with, so
+// a discovery refresh would republish nothing.
+bool warmStartDiscoveryCurrent(const WarmStartRecord &record,
+                               const char *firmware,
+                               uint32_t planFingerprint,
+                               uint32_t discoveryFingerprint);
+
+const char *warmStartOutcomeName(WarmStartOutcome outcome);
+// {"outcome":"resumed","identity_reads":1,"rs485_connected_ms":..,"first_publish_ms":..,"discovery_held":true}
+bool buildWarmStartJson(const WarmStartBootStats &stats, char *out, size_t outSize);
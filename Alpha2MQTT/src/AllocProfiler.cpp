@@ -0,0 +1,190 @@
+// Purpose: Per-phase heap accounting behind the optional allocation profiler hooks.
+#include "../include/AllocProfiler.h"
+
+#include <cstdio>
+
+static AllocProfile g_allocProfile{};
+static bool g_allocProfilerEnabled = false;
+static uint8_t g_allocProfilerPhase = 0;
+// Net bytes allocated since the last phase change.
+static int32_t g_allocStretchNet = 0;
+
+static uint8_t
+clampPhase(uint8_t phase)
+{
+	return (phase < kAllocProfilerPhaseCount) ? phase : 0;
+}
+
+static uint32_t
+totalAllocs(void)
+{
+	uint32_t total = 0;
+	for (const AllocPhaseStats &phase : g_allocProfile.phases) {
+		total += phase.allocs;
+	}
+	return total;
+}
+
+static uint32_t
+totalFrees(void)
+{
+	uint32_t total = 0;
+	for (const AllocPhaseStats &phase : g_allocProfile.phases) {
+		total += phase.frees;
+	}
+	return total;
+}
+
+static uint32_t
+totalAllocBytes(void)
+{
+	uint32_t total = 0;
+	for (const AllocPhaseStats &phase : g_allocProfile.phases) {
+		total += phase.allocBytes;
+	}
+	return total;
+}
+
+void
+allocProfilerEnable(bool enabled)
+{
+	g_allocProfilerEnabled = enabled;
+}
+
+bool
+allocProfilerEnabled(void)
+{
+	return g_allocProfilerEnabled;
+}
+
+void
+allocProfilerReset(void)
+{
+	g_allocProfile = AllocProfile{};
+	g_allocStretchNet = 0;
+}
+
+uint8_t
+allocProfilerEnterPhase(uint8_t phase)
+{
+	const uint8_t previous = g_allocProfilerPhase;
+	g_allocProfilerPhase = clampPhase(phase);
+	g_allocStretchNet = 0;
+	return previous;
+}
+
+uint8_t
+allocProfilerPhase(void)
+{
+	return g_allocProfilerPhase;
+}
+
+void
+allocProfilerNoteAlloc(size_t bytes)
+{
+	if (!g_allocProfilerEnabled) {
+		return;
+	}
+	AllocPhaseStats &phase = g_allocProfile.phases[g_allocProfilerPhase];
+	phase.allocs++;
+	phase.allocBytes += static_cast<uint32_t>(bytes);
+	g_allocStretchNet += static_cast<int32_t>(bytes);
+	if (g_allocStretchNet > 0 && static_cast<uint32_t>(g_allocStretchNet) > phase.peakBytes) {
+		phase.peakBytes = static_cast<uint32_t>(g_allocStretchNet);
+	}
+	g_allocProfile.liveBytes += static_cast<uint32_t>(bytes);
+	if (g_allocProfile.liveBytes > g_allocProfile.peakLiveBytes) {
+		g_allocProfile.peakLiveBytes = g_allocProfile.liveBytes;
+	}
+}
+
+void
+allocProfilerNoteFree(size_t bytes)
+{
+	if (!g_allocProfilerEnabled) {
+		return;
+	}
+	AllocPhaseStats &phase = g_allocProfile.phases[g_allocProfilerPhase];
+	phase.frees++;
+	phase.freeBytes += static_cast<uint32_t>(bytes);
+	g_allocStretchNet -= static_cast<int32_t>(bytes);
+	// Blocks allocated before accounting started can be freed while it runs.
+	g_allocProfile.liveBytes =
+		(g_allocProfile.liveBytes > bytes) ? g_allocProfile.liveBytes - static_cast<uint32_t>(bytes) : 0;
+}
+
+const AllocProfile &
+allocProfile(void)
+{
+	return g_allocProfile;
+}
+
+AllocWindow::AllocWindow()
+	: wasEnabled_(g_allocProfilerEnabled), allocs_(totalAllocs()), frees_(totalFrees()), allocBytes_(totalAllocBytes())
+{
+	g_allocProfilerEnabled = true;
+}
+
+AllocWindow::~AllocWindow()
+{
+	g_allocProfilerEnabled = wasEnabled_;
+}
+
+uint32_t
+AllocWindow::allocs() const
+{
+	return totalAllocs() - allocs_;
+}
+
+uint32_t
+AllocWindow::frees() const
+{
+	return totalFrees() - frees_;
+}
+
+uint32_t
+AllocWindow::allocBytes() const
+{
+	return totalAllocBytes() - allocBytes_;
+}
+
+bool
+buildAllocProfileJson(const AllocProfile &profile, const char *const *names, size_t nameCount, char *out, size_t outSize)
+{
+	if (out == nullptr || outSize == 0) {
+		return false;
+	}
+	size_t len = 0;
+	int written = snprintf(out, outSize, "{");
+	if (written < 0 || static_cast<size_t>(written) >= outSize) {
+		return false;
+	}
+	len = static_cast<size_t>(written);
+	for (size_t i = 0; i < kAllocProfilerPhaseCount; ++i) {
+		const AllocPhaseStats &phase = profile.phases[i];
+		if (phase.allocs == 0 && phase.frees == 0) {
+			continue;
+		}
+		const char *name = (names != nullptr && i < nameCount && names[i] != nullptr && names[i][0] != '\0')
+		                       ? names[i]
+		                       : "none";
+		written = snprintf(out + len,
+		                   outSize - len,
+		                   "\"%s\":{\"allocs\":%lu,\"frees\":%lu,\"bytes\":%lu,\"peak\":%lu},",
+		                   name,
+		                   static_cast<unsigned long>(phase.allocs),
+		                   static_cast<unsigned long>(phase.frees),
+		                   static_cast<unsigned long>(phase.allocBytes),
+		                   static_cast<unsigned long>(phase.peakBytes));
+		if (written < 0 || static_cast<size_t>(written) >= outSize - len) {
+			return false;
+		}
+		len += static_cast<size_t>(written);
+	}
+	written = snprintf(out + len,
+	                   outSize - len,
+	                   "\"live\":%lu,\"peak_live\":%lu}",
+	                   static_cast<unsigned long>(profile.liveBytes),
+	                   static_cast<unsigned long>(profile.peakLiveBytes));
+	return written >= 0 && static_cast<size_t>(written) < outSize - len;
+}
@@ -0,0 +1,117 @@
+// Purpose: Global operator new/delete replacements that feed AllocProfiler (ALLOC_PROFILER only).
+#include "../include/AllocProfiler.h"
+
+#if ALLOC_PROFILER
+
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+namespace {
+
+// Each block carries its size in front so frees can be attributed without sized delete.
+constexpr size_t kAllocHeaderBytes = alignof(std::max_align_t);
+static_assert(kAllocHeaderBytes >= sizeof(size_t), "allocation header too small");
+
+void *
+profiledAlloc(size_t size)
+{
+	uint8_t *raw = static_cast<uint8_t *>(std::malloc(size + kAllocHeaderBytes));
+	if (raw == nullptr) {
+		return nullptr;
+	}
+	memcpy(raw, &size, sizeof(size));
+	allocProfilerNoteAlloc(size);
+	return raw + kAllocHeaderBytes;
+}
+
+void
+profiledFree(void *ptr)
+{
+	if (ptr == nullptr) {
+		return;
+	}
+	uint8_t *raw = static_cast<uint8_t *>(ptr) - kAllocHeaderBytes;
+	size_t size = 0;
+	memcpy(&size, raw, sizeof(size));
+	allocProfilerNoteFree(size);
+	std::free(raw);
+}
+
+void *
+profiledAllocOrFail(size_t size)
+{
+	void *ptr = profiledAlloc(size);
+	if (ptr == nullptr) {
+#if defined(__cpp_exceptions)
+		throw std::bad_alloc();
+#else
+		abort();
+#endif
+	}
+	return ptr;
+}
+
+} // namespace
+
+void *
+operator new(size_t size)
+{
+	return profiledAllocOrFail(size);
+}
+
+void *
+operator new[](size_t size)
+{
+	return profiledAllocOrFail(size);
+}
+
+void *
+operator new(size_t size, const std::nothrow_t &) noexcept
+{
+	return profiledAlloc(size);
+}
+
+void *
+operator new[](size_t size, const std::nothrow_t &) noexcept
+{
+	return profiledAlloc(size);
+}
+
+void
+operator delete(void *ptr) noexcept
+{
+	profiledFree(ptr);
+}
+
+void
+operator delete[](void *ptr) noexcept
+{
+	profiledFree(ptr);
+}
+
+void
+operator delete(void *ptr, size_t) noexcept
+{
+	profiledFree(ptr);
+}
+
+void
+operator delete[](void *ptr, size_t) noexcept
+{
+	profiledFree(ptr);
+}
+
+void
+operator delete(void *ptr, const std::nothrow_t &) noexcept
+{
+	profiledFree(ptr);
+}
+
+void
+operator delete[](void *ptr, const std::nothrow_t &) noexcept
+{
+	profiledFree(ptr);
+}
+
+#endif // ALLOC_PROFILER
@@ -0,0 +1,105 @@
+// Purpose: Feed one extra RS485 bus from the active poll plan a few transactions at a time.
+#include "../include/BusPlanFeed.h"
+
+const MqttEntityActiveBucket *
+busPlanFeedBucket(const MqttEntityActivePlan &plan, uint8_t ordinal)
+{
+	switch (ordinal) {
+	case 0:
+		return &plan.tenSec;
+	case 1:
+		return &plan.oneMin;
+	case 2:
+		return &plan.fiveMin;
+	case 3:
+		return &plan.oneHour;
+	case 4:
+		return &plan.oneDay;
+	case 5:
+		return &plan.user;
+	default:
+		return nullptr;
+	}
+}
+
+void
+busPlanFeedReset(BusPlanFeed &feed)
+{
+	feed = BusPlanFeed{};
+}
+
+void
+busPlanFeedMarkDue(BusPlanFeed &feed, const MqttEntityActivePlan &plan, uint8_t dueBuckets)
+{
+	for (uint8_t ordinal = 0; ordinal < kBusPlanFeedBuckets; ++ordinal) {
+		if ((dueBuckets & (1U << ordinal)) == 0) {
+			continue;
+		}
+		const MqttEntityActiveBucket *bucketPlan = busPlanFeedBucket(plan, ordinal);
+		feed.remaining[ordinal] = (bucketPlan == nullptr || bucketPlan->transactions == nullptr)
+		                              ? 0
+		                              : static_cast<uint16_t>(bucketPlan->transactionCount);
+	}
+}
+
+bool
+busPlanFeedIdle(const BusPlanFeed &feed)
+{
+	for (size_t ordinal = 0; ordinal < kBusPlanFeedBuckets; ++ordinal) {
+		if (feed.remaining[ordinal] != 0) {
+			return false;
+		}
+	}
+	return true;
+}
+
+size_t
+busPlanFeedFill(BusPlanFeed &feed,
+                const MqttEntityActivePlan &plan,
+                MultiBusPoller &poller,
+                size_t bus,
+                uint8_t slaveId,
+                BusPlanFeedFilterFn filter,
+                void *ctx)
+{
+	size_t enqueued = 0;
+	if (!multiBusLinkOnline(poller, bus)) {
+		return enqueued;
+	}
+	for (uint8_t ordinal = 0; ordinal < kBusPlanFeedBuckets; ++ordinal) {
+		const MqttEntityActiveBucket *bucketPlan = busPlanFeedBucket(plan, ordinal);
+		while (feed.remaining[ordinal] != 0) {
+			if (multiBusPending(poller, bus) >= kBusPlanFeedLookahead) {
+				return enqueued;
+			}
+			if (bucketPlan == nullptr || bucketPlan->transactions == nullptr || bucketPlan->transactionCount == 0) {
+				feed.remaining[ordinal] = 0;
+				break;
+			}
+			// The plan may have shrunk since the bucket was marked due.
+			if (feed.cursor[ordinal] >= bucketPlan->transactionCount) {
+				feed.cursor[ordinal] = 0;
+			}
+			if (feed.remaining[ordinal] > bucketPlan->transactionCount) {
+				feed.remaining[ordinal] = static_cast<uint16_t>(bucketPlan->transactionCount);
+			}
+			const uint16_t index = feed.cursor[ordinal];
+			const MqttPollTransaction &txn = bucketPlan->transactions[index];
+			if (filter == nullptr || filter(*bucketPlan, txn, ctx)) {
+				BusTxn item{};
+				item.planIndex = index;
+				item.slaveId = slaveId;
+				item.kind = BusTxnKind::Poll;
+				item.bucket = ordinal;
+				item.readKey = txn.readKey;
+				if (!multiBusEnqueue(poller, bus, item)) {
+					return enqueued;
+				}
+				enqueued++;
+			}
+			feed.cursor[ordinal] = static_cast<uint16_t>((index + 1) % bucketPlan->transactionCount);
+			feed.remaining[ordinal]--;
+		}
+	}
+	return enqueued;
+}
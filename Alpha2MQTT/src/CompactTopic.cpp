@@ -0,0 +1,107 @@
+// Purpose: Stable hashed short topic codes for compact state publishing.
+#include "../include/CompactTopic.h"
+
+#include <cstdio>
+
+namespace {
+
+constexpr char kBase36[] = "0123456789abcdefghijklmnopqrstuvwxyz";
+
+uint32_t
+fnv1a(uint32_t hash, const char *text)
+{
+	for (const char *p = text; *p != '\0'; ++p) {
+		hash = (hash ^ static_cast<uint8_t>(*p)) * 16777619U;
+	}
+	return hash;
+}
+
+void
+writeBase36(uint32_t value, char *out, size_t digits)
+{
+	for (size_t i = digits; i > 0; --i) {
+		out[i - 1] = kBase36[value % 36U];
+		value /= 36U;
+	}
+	out[digits] = '\0';
+}
+
+} // namespace
+
+bool
+compactTopicEntityCode(const char *entityKey, char *out, size_t outLen)
+{
+	if (entityKey == nullptr || entityKey[0] == '\0' || out == nullptr || outLen <= kCompactTopicEntityCodeLen) {
+		return false;
+	}
+	writeBase36(fnv1a(2166136261U, entityKey), out, kCompactTopicEntityCodeLen);
+	return true;
+}
+
+bool
+buildCompactTopicPrefix(const char *deviceName, const char *deviceId, char *out, size_t outLen)
+{
+	if (deviceId == nullptr || deviceId[0] == '\0' || out == nullptr || outLen < kCompactTopicMaxLen) {
+		return false;
+	}
+	uint32_t hash = fnv1a(2166136261U, deviceName != nullptr ? deviceName : "");
+	hash = fnv1a(hash, "/");
+	hash = fnv1a(hash, deviceId);
+	out[0] = 'a';
+	out[1] = '2';
+	out[2] = '/';
+	writeBase36(hash, out + 3, kCompactTopicDeviceCodeLen);
+	return true;
+}
+
+bool
+buildCompactStateTopic(const char *deviceName,
+                       const char *deviceId,
+                       const char *entityKey,
+                       char *out,
+                       size_t outLen)
+{
+	if (!buildCompactTopicPrefix(deviceName, deviceId, out, outLen)) {
+		return false;
+	}
+	const size_t prefixLen = 3 + kCompactTopicDeviceCodeLen;
+	out[prefixLen] = '/';
+	if (!compactTopicEntityCode(entityKey, out + prefixLen + 1, outLen - prefixLen - 1)) {
+		out[0] = '\0';
+		return false;
+	}
+	return true;
+}
+
+bool
+compactTopicEntityEligible(mqttEntityId entityId, bool subscribe)
+{
+	if (subscribe) {
+		return false;
+	}
+	// Same exclusions as batched state: these carry JSON read through bespoke templates or live on
+	// the status topic.
+	switch (entityId) {
+	case mqttEntityId::entityBatFaults:
+	case mqttEntityId::entityBatWarnings:
+	case mqttEntityId::entityInverterFaults:
+	case mqttEntityId::entityInverterWarnings:
+	case mqttEntityId::entitySystemFaults:
+	case mqttEntityId::entityFrequency:
+	case mqttEntityId::entityRs485Avail:
+	case mqttEntityId::entityGridAvail:
+		return false;
+	default:
+		return true;
+	}
+}
+
+bool
+buildCompactTopicMapTopic(const char *deviceName, char *out, size_t outLen)
+{
+	if (out == nullptr || outLen == 0) {
+		return false;
+	}
+	const int written = snprintf(out, outLen, "%s/compact_topics", deviceName != nullptr ? deviceName : "");
+	return written > 0 && static_cast<size_t>(written) < outLen;
+}
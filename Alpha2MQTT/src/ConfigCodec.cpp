@@ -1,55 +1,268 @@
+// Purpose: Allocation-free "key=value;" codec for A2mConfig over caller-provided buffers.
 #include "../include/ConfigCodec.h"
 
-#include <cerrno>
-#include <cinttypes>
-#include <cstdlib>
+#include <cstring>
 
 namespace {
-const char *kKeyPollInterval = "poll_interval_s";
-const char *kKeyBootMode = "boot_mode";
-const char *kKeyBootIntent = "boot_intent";
-const char *kKeyRegisterMask = "enabled_register_mask";
+const char kKeyVersion[] = "v";
+const char kKeyPollInterval[] = "poll_interval_s";
+const char kKeyBootMode[] = "boot_mode";
+const char kKeyBootIntent[] = "boot_intent";
+const char kKeyRegisterMask[] = "enabled_register_mask";
+const char kKeyWifiSsid[] = "wifi_ssid";
+const char kKeyWifiPass[] = "wifi_pass";
+const char kKeyMqttServer[] = "mqtt_server";
+const char kKeyMqttPort[] = "mqtt_port";
+const char kKeyMqttUser[] = "mqtt_user";
+const char kKeyMqttPass[] = "mqtt_pass";
+const char kKeyInverterLabel[] = "inverter_label";
+const char kKeyRs485Baud[] = "rs485_baud";
+const char kKeyRs485SlaveIds[] = "rs485_slaves";
+const char kKeyExtAntenna[] = "ext_antenna";
+// Longer than any boot mode or intent name.
+constexpr size_t kBootNameMaxLen = 23;
 
-bool parseUint32(const std::string &value, uint32_t *result)
+struct TextWriter {
+	char *out;
+	size_t size;
+	size_t len;
+	bool ok;
+};
+
+void
+writeChar(TextWriter &writer, char c)
 {
-	if (value.empty()) {
-		return false;
+	// The last byte is kept for the NUL.
+	if (!writer.ok || writer.len + 1 >= writer.size) {
+		writer.ok = false;
+		return;
 	}
-	char *end = nullptr;
-	errno = 0;
-	unsigned long parsed = std::strtoul(value.c_str(), &end, 10);
-	if (errno != 0 || end == value.c_str() || *end != '\0') {
-		return false;
+	writer.out[writer.len++] = c;
+}
+
+void
+writeKey(TextWriter &writer, const char *key)
+{
+	if (writer.len != 0) {
+		writeChar(writer, ';');
+	}
+	for (; *key != '\0'; ++key) {
+		writeChar(writer, *key);
+	}
+	writeChar(writer, '=');
+}
+
+void
+writeUint(TextWriter &writer, uint64_t value)
+{
+	char digits[20];
+	size_t count = 0;
+	do {
+		digits[count++] = static_cast<char>('0' + (value % 10));
+		value /= 10;
+	} while (value != 0);
+	while (count > 0) {
+		writeChar(writer, digits[--count]);
+	}
+}
+
+bool
+needsEscape(unsigned char c)
+{
+	return c < 0x20 || c == 0x7F || c == ';' || c == '=' || c == '%';
+}
+
+// Stops at maxLen so a field that lost its NUL cannot run into the next one.
+void
+writeEscaped(TextWriter &writer, const char *text, size_t maxLen)
+{
+	static const char kHex[] = "0123456789ABCDEF";
+	for (size_t i = 0; i < maxLen && text[i] != '\0'; ++i) {
+		const unsigned char c = static_cast<unsigned char>(text[i]);
+		if (needsEscape(c)) {
+			writeChar(writer, '%');
+			writeChar(writer, kHex[c >> 4]);
+			writeChar(writer, kHex[c & 0x0F]);
+		} else {
+			writeChar(writer, static_cast<char>(c));
+		}
 	}
-	if (parsed > UINT32_MAX) {
+}
+
+bool
+keyIs(const char *key, size_t keyLen, const char *name)
+{
+	return strlen(name) == keyLen && memcmp(key, name, keyLen) == 0;
+}
+
+bool
+parseUint(const char *value, size_t len, uint64_t max, uint64_t &out)
+{
+	if (len == 0) {
 		return false;
 	}
-	*result = static_cast<uint32_t>(parsed);
+	uint64_t parsed = 0;
+	for (size_t i = 0; i < len; ++i) {
+		if (value[i] < '0' || value[i] > '9') {
+			return false;
+		}
+		const uint64_t digit = static_cast<uint64_t>(value[i] - '0');
+		if (digit > max || parsed > (max - digit) / 10) {
+			return false;
+		}
+		parsed = parsed * 10 + digit;
+	}
+	out = parsed;
 	return true;
 }
 
-bool parseUint64(const std::string &value, uint64_t *result)
+int
+hexValue(char c)
 {
-	if (value.empty()) {
-		return false;
+	if (c >= '0' && c <= '9') {
+		return c - '0';
+	}
+	if (c >= 'A' && c <= 'F') {
+		return c - 'A' + 10;
 	}
-	char *end = nullptr;
-	errno = 0;
-	unsigned long long parsed = std::strtoull(value.c_str(), &end, 10);
-	if (errno != 0 || end == value.c_str() || *end != '\0') {
+	if (c >= 'a' && c <= 'f') {
+		return c - 'a' + 10;
+	}
+	return -1;
+}
+
+// Unescapes value into out (outSize includes the NUL). On failure out is left empty.
+bool
+parseString(const char *value, size_t len, char *out, size_t outSize)
+{
+	size_t written = 0;
+	for (size_t i = 0; i < len; ++i) {
+		char c = value[i];
+		if (c == '%') {
+			const int hi = (i + 2 < len) ? hexValue(value[i + 1]) : -1;
+			const int lo = (i + 2 < len) ? hexValue(value[i + 2]) : -1;
+			if (hi < 0 || lo < 0 || (hi == 0 && lo == 0)) {
+				out[0] = '\0';
+				return false;
+			}
+			c = static_cast<char>((hi << 4) | lo);
+			i += 2;
+		}
+		if (written + 1 >= outSize) {
+			out[0] = '\0';
+			return false;
+		}
+		out[written++] = c;
+	}
+	out[written] = '\0';
+	return true;
+}
+
+// Copies a short name into a NUL-terminated buffer for the BootModes parsers.
+bool
+copyBootName(const char *value, size_t len, char (&out)[kBootNameMaxLen + 1])
+{
+	if (len > kBootNameMaxLen) {
 		return false;
 	}
-	*result = static_cast<uint64_t>(parsed);
+	memcpy(out, value, len);
+	out[len] = '\0';
+	return true;
+}
+
+// False when a known key has a value it cannot take; unknown keys are accepted and ignored.
+bool
+decodeField(const char *key, size_t keyLen, const char *value, size_t valueLen, A2mConfig &config)
+{
+	uint64_t number = 0;
+	if (keyIs(key, keyLen, kKeyPollInterval)) {
+		if (!parseUint(value, valueLen, UINT32_MAX, number)) {
+			return false;
+		}
+		config.pollIntervalSeconds = clampPollInterval(static_cast<uint32_t>(number));
+		return true;
+	}
+	if (keyIs(key, keyLen, kKeyBootMode)) {
+		char name[kBootNameMaxLen + 1];
+		if (!copyBootName(value, valueLen, name)) {
+			return false;
+		}
+		config.bootMode = bootModeFromString(name);
+		return strcmp(bootModeToString(config.bootMode), name) == 0;
+	}
+	if (keyIs(key, keyLen, kKeyBootIntent)) {
+		char name[kBootNameMaxLen + 1];
+		if (!copyBootName(value, valueLen, name)) {
+			return false;
+		}
+		config.bootIntent = bootIntentFromString(name);
+		return strcmp(bootIntentToString(config.bootIntent), name) == 0;
+	}
+	if (keyIs(key, keyLen, kKeyRegisterMask)) {
+		if (!parseUint(value, valueLen, UINT64_MAX, number)) {
+			return false;
+		}
+		config.enabledRegisterMask = number;
+		return true;
+	}
+	if (keyIs(key, keyLen, kKeyWifiSsid)) {
+		return parseString(value, valueLen, config.wifiSsid, sizeof(config.wifiSsid));
+	}
+	if (keyIs(key, keyLen, kKeyWifiPass)) {
+		return parseString(value, valueLen, config.wifiPass, sizeof(config.wifiPass));
+	}
+	if (keyIs(key, keyLen, kKeyMqttServer)) {
+		return parseString(value, valueLen, config.mqttServer, sizeof(config.mqttServer));
+	}
+	if (keyIs(key, keyLen, kKeyMqttPort)) {
+		if (!parseUint(value, valueLen, UINT16_MAX, number)) {
+			return false;
+		}
+		config.mqttPort = static_cast<uint16_t>(number);
+		return true;
+	}
+	if (keyIs(key, keyLen, kKeyMqttUser)) {
+		return parseString(value, valueLen, config.mqttUser, sizeof(config.mqttUser));
+	}
+	if (keyIs(key, keyLen, kKeyMqttPass)) {
+		return parseString(value, valueLen, config.mqttPass, sizeof(config.mqttPass));
+	}
+	if (keyIs(key, keyLen, kKeyInverterLabel)) {
+		return parseString(value, valueLen, config.inverterLabel, sizeof(config.inverterLabel));
+	}
+	if (keyIs(key, keyLen, kKeyRs485Baud)) {
+		if (!parseUint(value, valueLen, UINT32_MAX, number)) {
+			return false;
+		}
+		config.rs485Baud = static_cast<uint32_t>(number);
+		return true;
+	}
+	if (keyIs(key, keyLen, kKeyRs485SlaveIds)) {
+		return parseString(value, valueLen, config.rs485SlaveIds, sizeof(config.rs485SlaveIds));
+	}
+	if (keyIs(key, keyLen, kKeyExtAntenna)) {
+		if (!parseUint(value, valueLen, 1, number)) {
+			return false;
+		}
+		config.extAntenna = (number != 0);
+		return true;
+	}
 	return true;
 }
 } // namespace
 
-struct A2mConfig defaultConfig()
+A2mConfig
+defaultConfig()
 {
-	return { kPollIntervalDefaultSeconds, BootMode::Normal, BootIntent::Normal, 0 };
+	A2mConfig config{};
+	config.pollIntervalSeconds = kPollIntervalDefaultSeconds;
+	config.bootMode = BootMode::Normal;
+	config.bootIntent = BootIntent::Normal;
+	return config;
 }
 
-uint32_t clampPollInterval(uint32_t valueSeconds)
+uint32_t
+clampPollInterval(uint32_t valueSeconds)
 {
 	if (valueSeconds < kPollIntervalMinSeconds) {
 		return kPollIntervalMinSeconds;
@@ -60,56 +273,94 @@ uint32_t clampPollInterval(uint32_t valueSeconds)
 	return valueSeconds;
 }
 
-std::string serializeConfig(const A2mConfig &config)
+size_t
+serializeConfig(const A2mConfig &config, char *out, size_t outSize)
 {
-	std::string output;
-	output.reserve(160);
-	output.append(kKeyPollInterval).append("=").append(std::to_string(config.pollIntervalSeconds)).append(";");
-	output.append(kKeyBootMode).append("=").append(bootModeToString(config.bootMode)).append(";");
-	output.append(kKeyBootIntent).append("=").append(bootIntentToString(config.bootIntent)).append(";");
-	output.append(kKeyRegisterMask).append("=").append(std::to_string(config.enabledRegisterMask));
-	return output;
+	if (out == nullptr || outSize == 0) {
+		return 0;
+	}
+	TextWriter writer{ out, outSize, 0, true };
+	writeKey(writer, kKeyVersion);
+	writeUint(writer, kConfigCodecVersion);
+	writeKey(writer, kKeyPollInterval);
+	writeUint(writer, config.pollIntervalSeconds);
+	writeKey(writer, kKeyBootMode);
+	writeEscaped(writer, bootModeToString(config.bootMode), kBootNameMaxLen);
+	writeKey(writer, kKeyBootIntent);
+	writeEscaped(writer, bootIntentToString(config.bootIntent), kBootNameMaxLen);
+	writeKey(writer, kKeyRegisterMask);
+	writeUint(writer, config.enabledRegisterMask);
+	writeKey(writer, kKeyWifiSsid);
+	writeEscaped(writer, config.wifiSsid, kConfigStringMaxLen);
+	writeKey(writer, kKeyWifiPass);
+	writeEscaped(writer, config.wifiPass, kConfigStringMaxLen);
+	writeKey(writer, kKeyMqttServer);
+	writeEscaped(writer, config.mqttServer, kConfigStringMaxLen);
+	writeKey(writer, kKeyMqttPort);
+	writeUint(writer, config.mqttPort);
+	writeKey(writer, kKeyMqttUser);
+	writeEscaped(writer, config.mqttUser, kConfigStringMaxLen);
+	writeKey(writer, kKeyMqttPass);
+	writeEscaped(writer, config.mqttPass, kConfigStringMaxLen);
+	writeKey(writer, kKeyInverterLabel);
+	writeEscaped(writer, config.inverterLabel, kConfigInverterLabelMaxLen);
+	writeKey(writer, kKeyRs485Baud);
+	writeUint(writer, config.rs485Baud);
+	writeKey(writer, kKeyRs485SlaveIds);
+	writeEscaped(writer, config.rs485SlaveIds, kConfigSlaveListMaxLen);
+	writeKey(writer, kKeyExtAntenna);
+	writeUint(writer, config.extAntenna ? 1 : 0);
+	if (!writer.ok) {
+		out[0] = '\0';
+		return 0;
+	}
+	out[writer.len] = '\0';
+	return writer.len;
 }
 
-struct A2mConfig deserializeConfig(const std::string &payload)
+ConfigDecodeStatus
+deserializeConfig(const char *payload, size_t len, A2mConfig &config)
 {
-	A2mConfig config = defaultConfig();
+	config = defaultConfig();
+	if (payload == nullptr) {
+		return ConfigDecodeStatus::Ok;
+	}
+	const void *nul = memchr(payload, '\0', len);
+	if (nul != nullptr) {
+		len = static_cast<size_t>(static_cast<const char *>(nul) - payload);
+	}
 
+	bool partial = false;
 	size_t start = 0;
-	while (start < payload.size()) {
-		size_t end = payload.find(';', start);
-		if (end == std::string::npos) {
-			end = payload.size();
-		}
-		std::string token = payload.substr(start, end - start);
-		size_t delimiter = token.find('=');
-		if (delimiter != std::string::npos) {
-			std::string key = token.substr(0, delimiter);
-			std::string value = token.substr(delimiter + 1);
-			if (key == kKeyPollInterval) {
-				uint32_t parsed = 0;
-				if (parseUint32(value, &parsed)) {
-					config.pollIntervalSeconds = clampPollInterval(parsed);
-				}
-			} else if (key == kKeyBootMode) {
-				config.bootMode = bootModeFromString(value.c_str());
-			} else if (key == kKeyBootIntent) {
-				config.bootIntent = bootIntentFromString(value.c_str());
-			} else if (key == kKeyRegisterMask) {
-				uint64_t parsed = 0;
-				if (parseUint64(value, &parsed)) {
-					config.enabledRegisterMask = parsed;
+	while (start < len) {
+		const char *token = payload + start;
+		const void *separator = memchr(token, ';', len - start);
+		const size_t tokenLen =
+			(separator != nullptr) ? static_cast<size_t>(static_cast<const char *>(separator) - token) : (len - start);
+		const void *equals = memchr(token, '=', tokenLen);
+		if (equals != nullptr) {
+			const size_t keyLen = static_cast<size_t>(static_cast<const char *>(equals) - token);
+			const char *value = token + keyLen + 1;
+			const size_t valueLen = tokenLen - keyLen - 1;
+			if (keyIs(token, keyLen, kKeyVersion)) {
+				uint64_t version = 0;
+				if (!parseUint(value, valueLen, UINT32_MAX, version)) {
+					partial = true;
+				} else if (version > kConfigCodecVersion) {
+					config = defaultConfig();
+					return ConfigDecodeStatus::UnsupportedVersion;
 				}
+			} else if (!decodeField(token, keyLen, value, valueLen, config)) {
+				partial = true;
 			}
 		}
-		start = end + 1;
+		start += tokenLen + 1;
 	}
-
-	config.pollIntervalSeconds = clampPollInterval(config.pollIntervalSeconds);
-	return config;
+	return partial ? ConfigDecodeStatus::Partial : ConfigDecodeStatus::Ok;
 }
 
-BootIntent consumeBootIntent(A2mConfig &config)
+BootIntent
+consumeBootIntent(A2mConfig &config)
 {
 	BootIntent prior = config.bootIntent;
 	config.bootIntent = BootIntent::Normal;
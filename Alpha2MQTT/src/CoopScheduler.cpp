@@ -0,0 +1,172 @@
+// Purpose: Cooperative task table for loop(): run only subsystems that are due, highest priority first.
+#include "../include/CoopScheduler.h"
+
+#include "../include/TimeProvider.h"
+
+uint8_t
+coopSchedulerAdd(CoopScheduler &sched,
+                 const char *name,
+                 CoopTaskFn fn,
+                 void *ctx,
+                 uint32_t periodMs,
+                 uint8_t priority,
+                 uint32_t budgetMs)
+{
+	if (fn == nullptr || name == nullptr || sched.count >= kMaxCoopTasks) {
+		return kCoopTaskInvalid;
+	}
+	const uint8_t id = sched.count;
+	CoopTask &task = sched.tasks[id];
+	task = CoopTask{};
+	task.name = name;
+	task.fn = fn;
+	task.ctx = ctx;
+	task.periodMs = periodMs;
+	task.budgetMs = budgetMs;
+	task.priority = priority;
+	task.nextWakeMs = nowMillis();
+	sched.count++;
+
+	// Stable insertion keeps equal-priority tasks in registration order.
+	size_t pos = id;
+	while (pos > 0 && sched.tasks[sched.order[pos - 1]].priority > priority) {
+		sched.order[pos] = sched.order[pos - 1];
+		pos--;
+	}
+	sched.order[pos] = id;
+	return id;
+}
+
+void
+coopSchedulerSetNextDue(CoopScheduler &sched, uint8_t id, CoopNextDueFn nextDue)
+{
+	if (id >= sched.count) {
+		return;
+	}
+	sched.tasks[id].nextDue = nextDue;
+}
+
+void
+coopSchedulerSetEnabled(CoopScheduler &sched, uint8_t id, bool enabled)
+{
+	if (id >= sched.count) {
+		return;
+	}
+	CoopTask &task = sched.tasks[id];
+	if (enabled && !task.enabled) {
+		task.nextWakeMs = nowMillis();
+	}
+	task.enabled = enabled;
+}
+
+void
+coopSchedulerWake(CoopScheduler &sched, uint8_t id)
+{
+	if (id >= sched.count) {
+		return;
+	}
+	const uint32_t now = nowMillis();
+	CoopTask &task = sched.tasks[id];
+	if (static_cast<int32_t>(task.nextWakeMs - now) > 0) {
+		task.nextWakeMs = now;
+	}
+}
+
+bool
+coopSchedulerDue(const CoopScheduler &sched, uint8_t id, uint32_t nowMs)
+{
+	if (id >= sched.count) {
+		return false;
+	}
+	const CoopTask &task = sched.tasks[id];
+	if (!task.enabled) {
+		return false;
+	}
+	if (static_cast<int32_t>(nowMs - task.nextWakeMs) >= 0) {
+		return true;
+	}
+	return task.nextDue != nullptr && task.nextDue(nowMs, task.ctx) == 0;
+}
+
+size_t
+coopSchedulerRunDue(CoopScheduler &sched)
+{
+	size_t ran = 0;
+	sched.passes++;
+	for (size_t n = 0; n < sched.count; ++n) {
+		const uint8_t id = sched.order[n];
+		const uint32_t startMs = nowMillis();
+		if (!coopSchedulerDue(sched, id, startMs)) {
+			continue;
+		}
+		CoopTask &task = sched.tasks[id];
+		const uint32_t latency = startMs - task.nextWakeMs;
+		if (latency > task.stats.maxLatencyMs) {
+			task.stats.maxLatencyMs = latency;
+		}
+
+		task.fn(task.ctx);
+
+		const uint32_t endMs = nowMillis();
+		const uint32_t elapsed = endMs - startMs;
+		CoopTaskStats &stats = task.stats;
+		stats.runs++;
+		stats.cpuMs += elapsed;
+		stats.lastRunMs = elapsed;
+		if (elapsed > stats.maxRunMs) {
+			stats.maxRunMs = elapsed;
+		}
+		if (task.budgetMs != 0 && elapsed > task.budgetMs) {
+			stats.overruns++;
+		}
+		// Keep the task's phase when possible; a task that fell far behind is rebased instead of
+		// running back-to-back to catch up.
+		if (task.periodMs == 0) {
+			task.nextWakeMs = (task.nextDue != nullptr) ? endMs + kCoopNoDeadlineMs : endMs;
+		} else if (static_cast<int32_t>(task.nextWakeMs - startMs) <= 0) {
+			uint32_t next = task.nextWakeMs + task.periodMs;
+			if (static_cast<int32_t>(next - endMs) <= 0) {
+				next = startMs + task.periodMs;
+				if (static_cast<int32_t>(next - endMs) <= 0) {
+					next = endMs;
+				}
+			}
+			task.nextWakeMs = next;
+		}
+		ran++;
+	}
+	return ran;
+}
+
+uint32_t
+coopSchedulerMsUntilNextDue(const CoopScheduler &sched, uint32_t nowMs, uint32_t capMs)
+{
+	uint32_t earliest = capMs;
+	for (size_t id = 0; id < sched.count && earliest > 0; ++id) {
+		const CoopTask &task = sched.tasks[id];
+		if (!task.enabled) {
+			continue;
+		}
+		const int32_t untilWake = static_cast<int32_t>(task.nextWakeMs - nowMs);
+		const uint32_t wakeMs = (untilWake <= 0) ? 0 : static_cast<uint32_t>(untilWake);
+		if (wakeMs < earliest) {
+			earliest = wakeMs;
+		}
+		if (task.nextDue != nullptr) {
+			const uint32_t hookMs = task.nextDue(nowMs, task.ctx);
+			if (hookMs < earliest) {
+				earliest = hookMs;
+			}
+		}
+	}
+	return earliest;
+}
+
+const CoopTask *
+coopSchedulerTask(const CoopScheduler &sched, uint8_t id)
+{
+	if (id >= sched.count) {
+		return nullptr;
+	}
+	return &sched.tasks[id];
+}
@@ -0,0 +1,24 @@
+// Purpose: Half-byte-table CRC-32.
+#include "../include/Crc32.h"
+
+namespace {
+
+constexpr uint32_t kCrc32Nibble[16] = {
+	0x00000000U, 0x1DB71064U, 0x3B6E20C8U, 0x26D930ACU, 0x76DC4190U, 0x6B6B51F4U, 0x4DB26158U, 0x5005713CU,
+	0xEDB88320U, 0xF00F9344U, 0xD6D6A3E8U, 0xCB61B38CU, 0x9B64C2B0U, 0x86D3D2D4U, 0xA00AE278U, 0xBDBDF21CU,
+};
+
+} // namespace
+
+uint32_t
+crc32Ieee(const void *data, size_t len)
+{
+	const uint8_t *bytes = static_cast<const uint8_t *>(data);
+	uint32_t crc = 0xFFFFFFFFU;
+	for (size_t i = 0; i < len; ++i) {
+		crc ^= bytes[i];
+		crc = (crc >> 4) ^ kCrc32Nibble[crc & 0x0FU];
+		crc = (crc >> 4) ^ kCrc32Nibble[crc & 0x0FU];
+	}
+	return crc ^ 0xFFFFFFFFU;
+}
@@ -0,0 +1,175 @@
+// Purpose: Track HA discovery payload fingerprints and (de)serialize them for flash without heap use.
+#include "../include/DiscoveryFingerprint.h"
+
+#include <cstring>
+
+namespace {
+
+constexpr uint32_t kFingerprintPrime = 16777619UL;
+constexpr uint32_t kBlobMagic = 0x50463241UL; // "A2FP"
+constexpr uint16_t kBlobFormat = 1;
+constexpr size_t kBlobHeaderSize = 4 + 2 + 2 + 4 + 4;
+constexpr size_t kKnownBytes = sizeof(DiscoveryFingerprintTable::known);
+
+void
+putU16(uint8_t *out, uint16_t value)
+{
+	out[0] = static_cast<uint8_t>(value & 0xFF);
+	out[1] = static_cast<uint8_t>(value >> 8);
+}
+
+void
+putU32(uint8_t *out, uint32_t value)
+{
+	for (size_t i = 0; i < 4; ++i) {
+		out[i] = static_cast<uint8_t>((value >> (8 * i)) & 0xFF);
+	}
+}
+
+uint16_t
+getU16(const uint8_t *in)
+{
+	return static_cast<uint16_t>(in[0] | (in[1] << 8));
+}
+
+uint32_t
+getU32(const uint8_t *in)
+{
+	uint32_t value = 0;
+	for (size_t i = 0; i < 4; ++i) {
+		value |= static_cast<uint32_t>(in[i]) << (8 * i);
+	}
+	return value;
+}
+
+bool
+slotKnown(const DiscoveryFingerprintTable &table, size_t slot)
+{
+	return (table.known[slot / 8] & (1U << (slot % 8))) != 0;
+}
+
+} // namespace
+
+uint32_t
+fingerprintUpdate(uint32_t hash, const void *data, size_t len)
+{
+	const uint8_t *bytes = static_cast<const uint8_t *>(data);
+	for (size_t i = 0; i < len; ++i) {
+		hash ^= bytes[i];
+		hash *= kFingerprintPrime;
+	}
+	return hash;
+}
+
+uint32_t
+fingerprintString(uint32_t hash, const char *text)
+{
+	if (text == nullptr) {
+		return hash;
+	}
+	// Include the terminator so "ab"+"c" and "a"+"bc" differ when strings are chained.
+	return fingerprintUpdate(hash, text, strlen(text) + 1);
+}
+
+void
+discoveryFingerprintReset(DiscoveryFingerprintTable &table, uint32_t catalogHash, uint32_t versionHash)
+{
+	memset(&table, 0, sizeof(table));
+	table.catalogHash = catalogHash;
+	table.versionHash = versionHash;
+}
+
+bool
+discoveryFingerprintMatches(const DiscoveryFingerprintTable &table, size_t slot, uint32_t fingerprint)
+{
+	if (slot >= kDiscoveryFingerprintSlotCount) {
+		return false;
+	}
+	return slotKnown(table, slot) && table.fingerprints[slot] == fingerprint;
+}
+
+void
+discoveryFingerprintStore(DiscoveryFingerprintTable &table, size_t slot, uint32_t fingerprint)
+{
+	if (slot >= kDiscoveryFingerprintSlotCount || discoveryFingerprintMatches(table, slot, fingerprint)) {
+		return;
+	}
+	table.fingerprints[slot] = fingerprint;
+	table.known[slot / 8] = static_cast<uint8_t>(table.known[slot / 8] | (1U << (slot % 8)));
+	table.dirty = true;
+}
+
+size_t
+discoveryFingerprintKnownCount(const DiscoveryFingerprintTable &table)
+{
+	size_t count = 0;
+	for (size_t slot = 0; slot < kDiscoveryFingerprintSlotCount; ++slot) {
+		if (slotKnown(table, slot)) {
+			++count;
+		}
+	}
+	return count;
+}
+
+size_t
+discoveryFingerprintBlobSize(void)
+{
+	return kBlobHeaderSize + kKnownBytes + 4 * kDiscoveryFingerprintSlotCount + 4;
+}
+
+size_t
+discoveryFingerprintSerialize(const DiscoveryFingerprintTable &table, uint8_t *out, size_t outLen)
+{
+	const size_t blobSize = discoveryFingerprintBlobSize();
+	if (out == nullptr || outLen < blobSize) {
+		return 0;
+	}
+	uint8_t *p = out;
+	putU32(p, kBlobMagic);
+	putU16(p + 4, kBlobFormat);
+	putU16(p + 6, static_cast<uint16_t>(kDiscoveryFingerprintSlotCount));
+	putU32(p + 8, table.catalogHash);
+	putU32(p + 12, table.versionHash);
+	p += kBlobHeaderSize;
+	memcpy(p, table.known, kKnownBytes);
+	p += kKnownBytes;
+	for (size_t slot = 0; slot < kDiscoveryFingerprintSlotCount; ++slot) {
+		putU32(p, table.fingerprints[slot]);
+		p += 4;
+	}
+	putU32(p, fingerprintUpdate(kFingerprintSeed, out, static_cast<size_t>(p - out)));
+	return blobSize;
+}
+
+bool
+discoveryFingerprintDeserialize(DiscoveryFingerprintTable &table,
+                                const uint8_t *in,
+                                size_t len,
+                                uint32_t catalogHash,
+                                uint32_t versionHash)
+{
+	discoveryFingerprintReset(table, catalogHash, versionHash);
+	const size_t blobSize = discoveryFingerprintBlobSize();
+	if (in == nullptr || len != blobSize) {
+		return false;
+	}
+	const size_t bodyLen = blobSize - 4;
+	if (getU32(in + bodyLen) != fingerprintUpdate(kFingerprintSeed, in, bodyLen)) {
+		return false;
+	}
+	if (getU32(in) != kBlobMagic ||
+	    getU16(in + 4) != kBlobFormat ||
+	    getU16(in + 6) != kDiscoveryFingerprintSlotCount ||
+	    getU32(in + 8) != catalogHash ||
+	    getU32(in + 12) != versionHash) {
+		return false;
+	}
+	const uint8_t *p = in + kBlobHeaderSize;
+	memcpy(table.known, p, kKnownBytes);
+	p += kKnownBytes;
+	for (size_t slot = 0; slot < kDiscoveryFingerprintSlotCount; ++slot) {
+		table.fingerprints[slot] = getU32(p);
+		p += 4;
+	}
+	return true;
+}
@@ -300,11 +300,11 @@ buildStaleInverterIdentifier(const char *previousSerial,
 DiscoveryDeviceScope
 mqttEntityScope(mqttEntityId id)
 {
-	mqttState entity{};
-	if (!mqttEntityCopyById(id, &entity)) {
+	size_t idx = 0;
+	if (!mqttEntityIndexById(id, &idx)) {
 		return DiscoveryDeviceScope::Inverter;
 	}
-	switch (entity.scope) {
+	switch (mqttEntityScopeByIndex(idx)) {
 	case MqttEntityScope::Controller:
 		return DiscoveryDeviceScope::Controller;
 	case MqttEntityScope::Inverter:
@@ -57,6 +57,30 @@ dispatchCountdownPublishDue(uint32_t lastCountdownPublishMs, uint32_t nowMs)
 	return static_cast<uint32_t>(nowMs - lastCountdownPublishMs) >= kDispatchCountdownPublishIntervalMs;
 }
 
+uint32_t
+dispatchMsUntilDue(uint32_t lastEvalMs,
+                   uint32_t evalIntervalMs,
+                   bool countdownActive,
+                   uint32_t lastCountdownPublishMs,
+                   uint32_t nowMs)
+{
+	if (dispatchEvalDue(lastEvalMs, nowMs, evalIntervalMs, false)) {
+		return 0;
+	}
+	uint32_t untilMs = evalIntervalMs - static_cast<uint32_t>(nowMs - lastEvalMs);
+	if (countdownActive) {
+		if (dispatchCountdownPublishDue(lastCountdownPublishMs, nowMs)) {
+			return 0;
+		}
+		const uint32_t untilCountdownMs =
+			kDispatchCountdownPublishIntervalMs - static_cast<uint32_t>(nowMs - lastCountdownPublishMs);
+		if (untilCountdownMs < untilMs) {
+			untilMs = untilCountdownMs;
+		}
+	}
+	return untilMs;
+}
+
 bool
 dispatchUseFastEvalCadence(const TimedDispatchRuntimeState &state,
                            bool timedEnabled,
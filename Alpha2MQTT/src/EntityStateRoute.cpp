@@ -0,0 +1,20 @@
+// Purpose: Route one polled entity state to history, batch, queue or its own topic.
+#include "../include/EntityStateRoute.h"
+
+EntityStateRoute
+entityStateRoute(const EntityStateRouteInput &in)
+{
+	if (!in.primaryState) {
+		return EntityStateRoute::Direct;
+	}
+	if (in.historyEnabled && in.historyEligible && !in.mqttConnected) {
+		return EntityStateRoute::History;
+	}
+	if (in.batchEnabled && in.batchEligible && in.mqttConnected) {
+		return EntityStateRoute::Batch;
+	}
+	if (in.queueEnabled) {
+		return EntityStateRoute::Queue;
+	}
+	return EntityStateRoute::Direct;
+}
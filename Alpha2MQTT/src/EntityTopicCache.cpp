@@ -0,0 +1,112 @@
+// Purpose: Cache entity topic prefixes per device scope and compose topics without formatting.
+#include "../include/EntityTopicCache.h"
+
+#include <cstdio>
+#include <cstring>
+
+namespace {
+
+void
+buildPrefix(EntityTopicPrefix &prefix, const char *deviceName, const char *deviceId)
+{
+	prefix.valid = false;
+	prefix.len = 0;
+	prefix.text[0] = '\0';
+	prefix.deviceId[0] = '\0';
+	if (deviceId == nullptr || deviceId[0] == '\0' || strlen(deviceId) >= sizeof(prefix.deviceId)) {
+		return;
+	}
+	const int written = snprintf(prefix.text, sizeof(prefix.text), "%s/%s/", deviceName ? deviceName : "", deviceId);
+	if (written <= 0 || static_cast<size_t>(written) >= sizeof(prefix.text)) {
+		prefix.text[0] = '\0';
+		return;
+	}
+	strcpy(prefix.deviceId, deviceId);
+	prefix.len = static_cast<uint8_t>(written);
+	prefix.valid = true;
+}
+
+} // namespace
+
+void
+entityTopicCacheInit(EntityTopicCache &cache)
+{
+	memset(&cache, 0, sizeof(cache));
+}
+
+void
+entityTopicCacheInvalidate(EntityTopicCache &cache)
+{
+	cache.built[0] = false;
+	cache.built[1] = false;
+}
+
+const EntityTopicPrefix *
+entityTopicCachePrefix(EntityTopicCache &cache,
+                       DiscoveryDeviceScope scope,
+                       const char *deviceName,
+                       const char *controllerId,
+                       const char *serial,
+                       bool inverterReady)
+{
+	const size_t slot = static_cast<size_t>(scope);
+	EntityTopicPrefix &prefix = cache.scopes[slot];
+	if (scope == DiscoveryDeviceScope::Controller) {
+		if (!cache.built[slot]) {
+			buildPrefix(prefix, deviceName, controllerId);
+			cache.built[slot] = true;
+			cache.rebuilds++;
+		}
+		return &prefix;
+	}
+
+	const char *currentSerial = serial != nullptr ? serial : "";
+	if (cache.built[slot] && cache.inverterReady == inverterReady && strcmp(cache.serial, currentSerial) == 0) {
+		return &prefix;
+	}
+	char inverterId[kEntityTopicDeviceIdMaxLen];
+	inverterId[0] = '\0';
+	if (inverterReady && inverterSerialIsValid(currentSerial)) {
+		buildInverterIdentifier(currentSerial, inverterId, sizeof(inverterId));
+	}
+	buildPrefix(prefix, deviceName, inverterId);
+	cache.inverterReady = inverterReady;
+	snprintf(cache.serial, sizeof(cache.serial), "%s", currentSerial);
+	cache.built[slot] = true;
+	cache.rebuilds++;
+	return &prefix;
+}
+
+size_t
+entityTopicCompose(const EntityTopicPrefix &prefix,
+                   const mqttState *entity,
+                   const char *suffix,
+                   char *out,
+                   size_t outLen)
+{
+	if (out == nullptr || outLen == 0) {
+		return 0;
+	}
+	out[0] = '\0';
+	if (!prefix.valid || outLen <= prefix.len) {
+		return 0;
+	}
+	memcpy(out, prefix.text, prefix.len);
+	const size_t nameLen = mqttEntityNameAppend(entity, out + prefix.len, outLen - prefix.len);
+	if (nameLen == 0) {
+		out[0] = '\0';
+		return 0;
+	}
+	size_t len = prefix.len + nameLen;
+	const size_t suffixLen = (suffix != nullptr) ? strlen(suffix) : 0;
+	if (len + suffixLen >= outLen) {
+		out[0] = '\0';
+		return 0;
+	}
+	if (suffixLen > 0) {
+		memcpy(out + len, suffix, suffixLen);
+		len += suffixLen;
+	}
+	out[len] = '\0';
+	return len;
+}
@@ -0,0 +1,251 @@
+// Purpose: Compact Home Assistant discovery JSON for single-payload device discovery without heap use.
+#include "../include/HaDeviceDiscovery.h"
+
+#include <cstdio>
+#include <cstring>
+
+namespace {
+
+struct HaAbbreviation {
+	const char *key;
+	const char *abbreviation;
+};
+
+// Subset of HA's MQTT abbreviation table covering the keys this firmware emits. "component" is the
+// per-entity discovery hint; device discovery calls the same field "platform" ("p").
+const HaAbbreviation kHaAbbreviations[] = {
+	{ "availability_template", "avty_tpl" },
+	{ "availability_topic", "avty_t" },
+	{ "command_template", "cmd_tpl" },
+	{ "command_topic", "cmd_t" },
+	{ "component", "p" },
+	{ "components", "cmps" },
+	{ "configuration_url", "cu" },
+	{ "device", "dev" },
+	{ "device_class", "dev_cla" },
+	{ "enabled_by_default", "en" },
+	{ "entity_category", "ent_cat" },
+	{ "force_update", "frc_upd" },
+	{ "hw_version", "hw" },
+	{ "icon", "ic" },
+	{ "identifiers", "ids" },
+	{ "json_attributes_template", "json_attr_tpl" },
+	{ "json_attributes_topic", "json_attr_t" },
+	{ "manufacturer", "mf" },
+	{ "model", "mdl" },
+	{ "object_id", "obj_id" },
+	{ "options", "ops" },
+	{ "origin", "o" },
+	{ "payload_available", "pl_avail" },
+	{ "payload_not_available", "pl_not_avail" },
+	{ "payload_off", "pl_off" },
+	{ "payload_on", "pl_on" },
+	{ "platform", "p" },
+	{ "retain", "ret" },
+	{ "serial_number", "sn" },
+	{ "state_class", "stat_cla" },
+	{ "state_topic", "stat_t" },
+	{ "suggested_display_precision", "sug_dsp_prc" },
+	{ "support_url", "url" },
+	{ "sw_version", "sw" },
+	{ "unique_id", "uniq_id" },
+	{ "unit_of_measurement", "unit_of_meas" },
+	{ "value_template", "val_tpl" },
+};
+
+enum CompactorState : uint8_t {
+	kOutside = 0,
+	kToken,
+	kPassString,
+	kAfterToken
+};
+
+bool
+isJsonWhitespace(char c)
+{
+	return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+void
+emitBytes(HaJsonCompactor &c, const char *data, size_t len)
+{
+	while (len > 0) {
+		if (c.outLen == sizeof(c.out)) {
+			if (c.ok && !c.sink(c.sinkCtx, c.out, c.outLen)) {
+				c.ok = false;
+			}
+			c.outLen = 0;
+		}
+		size_t chunk = sizeof(c.out) - c.outLen;
+		if (chunk > len) {
+			chunk = len;
+		}
+		memcpy(c.out + c.outLen, data, chunk);
+		c.outLen += chunk;
+		c.emitted += chunk;
+		data += chunk;
+		len -= chunk;
+	}
+}
+
+void
+emitChar(HaJsonCompactor &c, char ch)
+{
+	emitBytes(c, &ch, 1);
+}
+
+void
+emitToken(HaJsonCompactor &c, bool asKey)
+{
+	emitChar(c, '"');
+	const char *abbreviation = asKey ? haDiscoveryAbbreviation(c.token, c.tokenLen) : nullptr;
+	if (abbreviation != nullptr) {
+		emitBytes(c, abbreviation, strlen(abbreviation));
+	} else {
+		emitBytes(c, c.token, c.tokenLen);
+	}
+	emitChar(c, '"');
+}
+
+void
+feedPassString(HaJsonCompactor &c, char ch)
+{
+	emitChar(c, ch);
+	if (c.escaped) {
+		c.escaped = false;
+	} else if (ch == '\\') {
+		c.escaped = true;
+	} else if (ch == '"') {
+		c.state = kOutside;
+	}
+}
+
+void
+feedChar(HaJsonCompactor &c, char ch)
+{
+	switch (c.state) {
+	case kOutside:
+		if (isJsonWhitespace(ch)) {
+			return;
+		}
+		if (ch == '"') {
+			c.state = kToken;
+			c.tokenLen = 0;
+			c.escaped = false;
+			return;
+		}
+		emitChar(c, ch);
+		return;
+	case kToken:
+		if (!c.escaped && ch == '"') {
+			c.state = kAfterToken;
+			return;
+		}
+		if (c.tokenLen == sizeof(c.token)) {
+			// Too long to be an abbreviated key: emit what we have and stream the rest.
+			emitChar(c, '"');
+			emitBytes(c, c.token, c.tokenLen);
+			c.state = kPassString;
+			feedPassString(c, ch);
+			return;
+		}
+		c.token[c.tokenLen++] = ch;
+		if (c.escaped) {
+			c.escaped = false;
+		} else if (ch == '\\') {
+			c.escaped = true;
+		}
+		return;
+	case kPassString:
+		feedPassString(c, ch);
+		return;
+	case kAfterToken:
+	default:
+		if (isJsonWhitespace(ch)) {
+			return;
+		}
+		emitToken(c, ch == ':');
+		c.state = kOutside;
+		feedChar(c, ch);
+		return;
+	}
+}
+
+} // namespace
+
+const char *
+haDiscoveryAbbreviation(const char *key, size_t keyLen)
+{
+	if (key == nullptr) {
+		return nullptr;
+	}
+	for (const HaAbbreviation &entry : kHaAbbreviations) {
+		if (strlen(entry.key) == keyLen && memcmp(entry.key, key, keyLen) == 0) {
+			return entry.abbreviation;
+		}
+	}
+	return nullptr;
+}
+
+bool
+buildHaDeviceDiscoveryTopic(const char *deviceId, char *out, size_t outLen)
+{
+	if (out == nullptr || outLen == 0) {
+		return false;
+	}
+	out[0] = '\0';
+	if (deviceId == nullptr || deviceId[0] == '\0') {
+		return false;
+	}
+	const int written = snprintf(out, outLen, "homeassistant/device/%s/config", deviceId);
+	if (written < 0 || static_cast<size_t>(written) >= outLen) {
+		out[0] = '\0';
+		return false;
+	}
+	return true;
+}
+
+void
+haJsonCompactorBegin(HaJsonCompactor &compactor, HaJsonSink sink, void *sinkCtx)
+{
+	compactor.sink = sink;
+	compactor.sinkCtx = sinkCtx;
+	compactor.ok = (sink != nullptr);
+	compactor.emitted = 0;
+	compactor.state = kOutside;
+	compactor.escaped = false;
+	compactor.tokenLen = 0;
+	compactor.outLen = 0;
+}
+
+bool
+haJsonCompactorFeed(HaJsonCompactor &compactor, const char *text, size_t len)
+{
+	if (text == nullptr) {
+		compactor.ok = false;
+		return false;
+	}
+	for (size_t i = 0; i < len; ++i) {
+		feedChar(compactor, text[i]);
+	}
+	return compactor.ok;
+}
+
+bool
+haJsonCompactorFinish(HaJsonCompactor &compactor)
+{
+	if (compactor.state == kAfterToken) {
+		emitToken(compactor, false);
+	} else if (compactor.state == kToken) {
+		emitChar(compactor, '"');
+		emitBytes(compactor, compactor.token, compactor.tokenLen);
+	}
+	compactor.state = kOutside;
+	if (compactor.outLen > 0) {
+		if (compactor.ok && !compactor.sink(compactor.sinkCtx, compactor.out, compactor.outLen)) {
+			compactor.ok = false;
+		}
+		compactor.outLen = 0;
+	}
+	return compactor.ok;
+}
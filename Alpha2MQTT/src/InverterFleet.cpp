@@ -0,0 +1,277 @@
+// Purpose: Describe the inverters that share one RS485 bus and hand out bus time fairly between them.
+#include "../include/InverterFleet.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "../include/DiscoveryModel.h"
+#include "../include/ModbusCodec.h"
+
+namespace {
+
+bool
+busTimeBefore(uint32_t a, uint32_t b)
+{
+	return static_cast<int32_t>(a - b) < 0;
+}
+
+bool
+minBusyBusTime(const InverterFleet &fleet, size_t skipIndex, uint32_t *out)
+{
+	bool found = false;
+	for (size_t i = 0; i < fleet.count; ++i) {
+		if (i == skipIndex || !fleet.slots[i].backlogged) {
+			continue;
+		}
+		if (!found || busTimeBefore(fleet.slots[i].busTimeMs, *out)) {
+			*out = fleet.slots[i].busTimeMs;
+			found = true;
+		}
+	}
+	return found;
+}
+
+} // namespace
+
+size_t
+parseInverterSlaveIdList(const char *text, uint8_t *out, size_t outMax)
+{
+	if (text == nullptr || out == nullptr || outMax == 0) {
+		return 0;
+	}
+	size_t count = 0;
+	const char *pos = text;
+	while (*pos != '\0') {
+		while (*pos == ' ' || *pos == ',' || *pos == ';' || *pos == '\t') {
+			pos++;
+		}
+		if (*pos == '\0') {
+			break;
+		}
+		char *endPtr = nullptr;
+		const unsigned long parsed = strtoul(pos, &endPtr, 0);
+		if (endPtr == pos || parsed > 0xFF || !modbusSlaveIdIsValid(static_cast<uint8_t>(parsed))) {
+			return 0;
+		}
+		if (*endPtr != '\0' && *endPtr != ' ' && *endPtr != ',' && *endPtr != ';' && *endPtr != '\t') {
+			return 0;
+		}
+		if (count >= outMax) {
+			return 0;
+		}
+		for (size_t i = 0; i < count; ++i) {
+			if (out[i] == parsed) {
+				return 0;
+			}
+		}
+		out[count++] = static_cast<uint8_t>(parsed);
+		pos = endPtr;
+	}
+	return count;
+}
+
+bool
+formatInverterSlaveIdList(const uint8_t *ids, size_t count, char *out, size_t outLen)
+{
+	if (out == nullptr || outLen == 0) {
+		return false;
+	}
+	out[0] = '\0';
+	if (ids == nullptr && count != 0) {
+		return false;
+	}
+	size_t used = 0;
+	for (size_t i = 0; i < count; ++i) {
+		const int written = snprintf(out + used, outLen - used, i == 0 ? "%u" : ",%u", static_cast<unsigned>(ids[i]));
+		if (written < 0 || static_cast<size_t>(written) >= outLen - used) {
+			out[0] = '\0';
+			return false;
+		}
+		used += static_cast<size_t>(written);
+	}
+	return true;
+}
+
+bool
+inverterFleetInit(InverterFleet &fleet, const uint8_t *slaveIds, size_t count)
+{
+	fleet = InverterFleet{};
+	if (slaveIds == nullptr || count == 0 || count > kMaxInvertersPerBus) {
+		return false;
+	}
+	for (size_t i = 0; i < count; ++i) {
+		if (!modbusSlaveIdIsValid(slaveIds[i])) {
+			return false;
+		}
+		for (size_t j = 0; j < i; ++j) {
+			if (slaveIds[j] == slaveIds[i]) {
+				return false;
+			}
+		}
+	}
+	for (size_t i = 0; i < count; ++i) {
+		fleet.slots[i].slaveId = slaveIds[i];
+	}
+	fleet.count = static_cast<uint8_t>(count);
+	return true;
+}
+
+int
+inverterFleetIndexOf(const InverterFleet &fleet, uint8_t slaveId)
+{
+	for (size_t i = 0; i < fleet.count; ++i) {
+		if (fleet.slots[i].slaveId == slaveId) {
+			return static_cast<int>(i);
+		}
+	}
+	return -1;
+}
+
+void
+inverterFleetSetBacklogged(InverterFleet &fleet, size_t index, bool backlogged)
+{
+	if (index >= fleet.count) {
+		return;
+	}
+	InverterSlot &slot = fleet.slots[index];
+	if (backlogged && !slot.backlogged) {
+		uint32_t floor = 0;
+		if (minBusyBusTime(fleet, index, &floor) && busTimeBefore(slot.busTimeMs, floor)) {
+			slot.busTimeMs = floor;
+		}
+	}
+	slot.backlogged = backlogged;
+}
+
+int
+inverterFleetNextSlot(InverterFleet &fleet)
+{
+	int best = -1;
+	for (size_t n = 0; n < fleet.count; ++n) {
+		const size_t i = (fleet.nextTieBreak + n) % fleet.count;
+		if (!fleet.slots[i].backlogged) {
+			continue;
+		}
+		if (best < 0 || busTimeBefore(fleet.slots[i].busTimeMs, fleet.slots[best].busTimeMs)) {
+			best = static_cast<int>(i);
+		}
+	}
+	if (best >= 0) {
+		fleet.nextTieBreak = static_cast<uint8_t>((best + 1) % fleet.count);
+	}
+	return best;
+}
+
+void
+inverterFleetCharge(InverterFleet &fleet, size_t index, uint32_t elapsedMs, bool ok)
+{
+	if (index >= fleet.count) {
+		return;
+	}
+	InverterSlot &slot = fleet.slots[index];
+	// Charge at least 1ms so zero-latency transports still rotate.
+	slot.busTimeMs += (elapsedMs == 0) ? 1 : elapsedMs;
+	slot.transactions++;
+	if (!ok) {
+		slot.failures++;
+	}
+}
+
+void
+inverterFleetMarkDue(InverterFleet &fleet, uint8_t dueMask)
+{
+	if (dueMask == 0) {
+		return;
+	}
+	for (size_t i = 0; i < fleet.count; ++i) {
+		fleet.slots[i].dueBuckets |= dueMask;
+		inverterFleetSetBacklogged(fleet, i, true);
+	}
+}
+
+void
+inverterFleetClearDue(InverterFleet &fleet)
+{
+	for (size_t i = 0; i < fleet.count; ++i) {
+		fleet.slots[i].dueBuckets = 0;
+		fleet.slots[i].backlogged = false;
+	}
+	fleet.parkedSlot = -1;
+}
+
+bool
+inverterFleetHasWork(const InverterFleet &fleet)
+{
+	if (fleet.parkedSlot >= 0) {
+		return true;
+	}
+	for (size_t i = 0; i < fleet.count; ++i) {
+		if (fleet.slots[i].backlogged) {
+			return true;
+		}
+	}
+	return false;
+}
+
+int
+inverterFleetPollTurn(InverterFleet &fleet, const InverterFleetPollHooks &hooks)
+{
+	if (hooks.runSlot == nullptr || hooks.nowMs == nullptr) {
+		return -1;
+	}
+	const bool resuming = fleet.parkedSlot >= 0 && static_cast<size_t>(fleet.parkedSlot) < fleet.count;
+	const int index = resuming ? fleet.parkedSlot : inverterFleetNextSlot(fleet);
+	if (index < 0) {
+		return -1;
+	}
+	InverterSlot &slot = fleet.slots[index];
+	if (!resuming) {
+		slot.turnStartMs = hooks.nowMs(hooks.context);
+		slot.turnFailed = false;
+	}
+	bool ok = true;
+	bool parked = false;
+	slot.dueBuckets = hooks.runSlot(hooks.context, static_cast<size_t>(index), slot.dueBuckets, &ok, &parked);
+	slot.turnFailed = slot.turnFailed || !ok;
+	if (parked) {
+		fleet.parkedSlot = static_cast<int8_t>(index);
+		return index;
+	}
+	fleet.parkedSlot = -1;
+	inverterFleetCharge(fleet, static_cast<size_t>(index), hooks.nowMs(hooks.context) - slot.turnStartMs, !slot.turnFailed);
+	if (slot.dueBuckets == 0) {
+		inverterFleetSetBacklogged(fleet, static_cast<size_t>(index), false);
+	}
+	return index;
+}
+
+void
+inverterFleetSetSerial(InverterFleet &fleet, size_t index, const char *serial)
+{
+	if (index >= fleet.count) {
+		return;
+	}
+	char *dst = fleet.slots[index].serial;
+	const size_t dstLen = sizeof(fleet.slots[index].serial);
+	if (serial == nullptr) {
+		dst[0] = '\0';
+		return;
+	}
+	strncpy(dst, serial, dstLen - 1);
+	dst[dstLen - 1] = '\0';
+}
+
+bool
+inverterFleetDeviceIdentifier(const InverterFleet &fleet, size_t index, char *out, size_t outLen)
+{
+	if (out == nullptr || outLen == 0) {
+		return false;
+	}
+	out[0] = '\0';
+	if (index >= fleet.count) {
+		return false;
+	}
+	buildInverterIdentifier(fleet.slots[index].serial, out, outLen);
+	return out[0] != '\0';
+}
@@ -0,0 +1,174 @@
+// Purpose: Memory-pressure policy table, level hysteresis and decision accounting.
+#include "../include/MemoryGovernor.h"
+
+#include <cstdarg>
+#include <cstdio>
+
+// Indexed by MemLevel. Ok must stay identical to the ungoverned defaults.
+static const MemGovernorPolicy kMemGovernorPolicies[] = {
+	{ 1024, 0, false, false, false, false },
+	{ 512, 250, false, true, true, false },
+	{ 256, 1000, true, true, true, true },
+};
+
+const MemGovernorPolicy &
+memGovernorPolicyFor(MemLevel level)
+{
+	const uint8_t idx = static_cast<uint8_t>(level);
+	return kMemGovernorPolicies[idx < 3 ? idx : 2];
+}
+
+const MemGovernorPolicy &
+memGovernorPolicy(const MemGovernor &gov)
+{
+	return memGovernorPolicyFor(gov.level);
+}
+
+static void
+logDecision(MemGovernor &gov, MemGovernorDecision decision, uint32_t nowMs)
+{
+	MemGovernorEvent &event = gov.events[gov.eventCount % kMemGovernorEventLogSize];
+	event.atMs = nowMs;
+	event.decision = decision;
+	event.level = gov.level;
+	gov.eventCount++;
+}
+
+bool
+memGovernorSample(MemGovernor &gov, MemLevel sampled, uint32_t nowMs)
+{
+	const uint8_t current = static_cast<uint8_t>(gov.level);
+	const uint8_t next = static_cast<uint8_t>(sampled);
+	if (next > current) {
+		gov.level = sampled;
+		gov.calmSamples = 0;
+		gov.loggedMask = 0;
+		gov.counts[static_cast<size_t>(MemGovernorDecision::Escalate)]++;
+		logDecision(gov, MemGovernorDecision::Escalate, nowMs);
+		return true;
+	}
+	if (next == current) {
+		gov.calmSamples = 0;
+		return false;
+	}
+	if (++gov.calmSamples < kMemGovernorRelaxSamples) {
+		return false;
+	}
+	gov.level = static_cast<MemLevel>(current - 1);
+	gov.calmSamples = 0;
+	gov.loggedMask = 0;
+	gov.counts[static_cast<size_t>(MemGovernorDecision::Relax)]++;
+	logDecision(gov, MemGovernorDecision::Relax, nowMs);
+	return true;
+}
+
+void
+memGovernorNote(MemGovernor &gov, MemGovernorDecision decision, uint32_t nowMs)
+{
+	const size_t idx = static_cast<size_t>(decision);
+	if (idx >= kMemGovernorDecisionCount) {
+		return;
+	}
+	gov.counts[idx]++;
+	const uint8_t bit = static_cast<uint8_t>(1U << idx);
+	if ((gov.loggedMask & bit) != 0) {
+		return;
+	}
+	gov.loggedMask |= bit;
+	logDecision(gov, decision, nowMs);
+}
+
+const char *
+memGovernorDecisionName(MemGovernorDecision decision)
+{
+	switch (decision) {
+	case MemGovernorDecision::Escalate:
+		return "escalate";
+	case MemGovernorDecision::Relax:
+		return "relax";
+	case MemGovernorDecision::ShrinkChunk:
+		return "shrink_chunk";
+	case MemGovernorDecision::SlowDiscovery:
+		return "slow_discovery";
+	case MemGovernorDecision::DeferPlanRebuild:
+		return "defer_plan_rebuild";
+	case MemGovernorDecision::CompactStatus:
+		return "compact_status";
+	case MemGovernorDecision::PauseDiagnostics:
+		return "pause_diagnostics";
+	case MemGovernorDecision::ShedPublish:
+		return "shed_publish";
+	default:
+		return "";
+	}
+}
+
+const char *
+memLevelName(MemLevel level)
+{
+	switch (level) {
+	case MemLevel::Ok:
+		return "ok";
+	case MemLevel::Warn:
+		return "warn";
+	case MemLevel::Crit:
+		return "crit";
+	default:
+		return "";
+	}
+}
+
+static bool
+appendJson(char *out, size_t outSize, size_t &len, const char *fmt, ...)
+{
+	va_list args;
+	va_start(args, fmt);
+	const int written = vsnprintf(out + len, outSize - len, fmt, args);
+	va_end(args);
+	if (written < 0 || static_cast<size_t>(written) >= outSize - len) {
+		return false;
+	}
+	len += static_cast<size_t>(written);
+	return true;
+}
+
+bool
+buildMemGovernorJson(const MemGovernor &gov, char *out, size_t outSize)
+{
+	if (out == nullptr || outSize == 0) {
+		return false;
+	}
+	size_t len = 0;
+	if (!appendJson(out, outSize, len, "{\"level\":\"%s\",\"counts\":{", memLevelName(gov.level))) {
+		return false;
+	}
+	for (size_t i = 0; i < kMemGovernorDecisionCount; ++i) {
+		if (!appendJson(out,
+		                outSize,
+		                len,
+		                "%s\"%s\":%lu",
+		                (i > 0) ? "," : "",
+		                memGovernorDecisionName(static_cast<MemGovernorDecision>(i)),
+		                static_cast<unsigned long>(gov.counts[i]))) {
+			return false;
+		}
+	}
+	if (!appendJson(out, outSize, len, "},\"events\":[")) {
+		return false;
+	}
+	const uint32_t logged = (gov.eventCount < kMemGovernorEventLogSize) ? gov.eventCount : kMemGovernorEventLogSize;
+	for (uint32_t i = 0; i < logged; ++i) {
+		const MemGovernorEvent &event = gov.events[(gov.eventCount - logged + i) % kMemGovernorEventLogSize];
+		if (!appendJson(out,
+		                outSize,
+		                len,
+		                "%s{\"at_ms\":%lu,\"decision\":\"%s\",\"level\":\"%s\"}",
+		                (i > 0) ? "," : "",
+		                static_cast<unsigned long>(event.atMs),
+		                memGovernorDecisionName(event.decision),
+		                memLevelName(event.level))) {
+			return false;
+		}
+	}
+	return appendJson(out, outSize, len, "]}");
+}
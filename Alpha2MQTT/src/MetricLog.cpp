@@ -0,0 +1,516 @@
+// Purpose: Delta/varint block codec, segment index and range queries for the on-flash metric log.
+#include "../include/MetricLog.h"
+
+#include <cstring>
+
+const MetricLogChannel kMetricLogChannelDefs[kMetricLogChannels] = {
+	{ mqttEntityId::entityBatPwr, "battery_w" },
+	{ mqttEntityId::entityGridPwr, "grid_w" },
+	{ mqttEntityId::entityPvPwr, "pv_w" },
+	{ mqttEntityId::entityBatSoc, "soc_pct" },
+	{ mqttEntityId::entityBatEnergyCharge, "battery_charge_kwh" },
+	{ mqttEntityId::entityBatEnergyDischarge, "battery_discharge_kwh" },
+	{ mqttEntityId::entityGridEnergyTo, "grid_export_kwh" },
+	{ mqttEntityId::entityGridEnergyFrom, "grid_import_kwh" },
+	{ mqttEntityId::entityPvEnergy, "pv_kwh" },
+};
+
+namespace {
+
+// Header layout (little endian):
+//   0 magic 'M','L' | 2 format | 3 channels | 4 count u16 | 6 used u16 | 8 firstTimeS u32
+//   12 lastTimeS u32 | 16 intervalS u16 | 18 reserved u16 | 20 checksum u32 | 24 base values
+constexpr uint8_t kMagic0 = 'M';
+constexpr uint8_t kMagic1 = 'L';
+constexpr uint8_t kFormat = 1;
+constexpr size_t kChecksumOffset = 20;
+// Time delta + 2-byte channel mask + one 5-byte delta per channel.
+constexpr size_t kMaxRecordBytes = 5 + 2 + 5 * kMetricLogChannels;
+
+static_assert(kMetricLogChannels <= 14, "channel mask must fit a two-byte varint");
+static_assert(kMetricLogHeaderBytes + kMaxRecordBytes <= kMetricLogBlockBytes, "block too small");
+
+void
+putU16(uint8_t *out, uint16_t value)
+{
+	out[0] = static_cast<uint8_t>(value);
+	out[1] = static_cast<uint8_t>(value >> 8);
+}
+
+void
+putU32(uint8_t *out, uint32_t value)
+{
+	for (size_t i = 0; i < 4; ++i) {
+		out[i] = static_cast<uint8_t>(value >> (8 * i));
+	}
+}
+
+uint16_t
+getU16(const uint8_t *in)
+{
+	return static_cast<uint16_t>(in[0] | (in[1] << 8));
+}
+
+uint32_t
+getU32(const uint8_t *in)
+{
+	return static_cast<uint32_t>(in[0]) | (static_cast<uint32_t>(in[1]) << 8) |
+	       (static_cast<uint32_t>(in[2]) << 16) | (static_cast<uint32_t>(in[3]) << 24);
+}
+
+size_t
+putVarint(uint8_t *out, uint32_t value)
+{
+	size_t len = 0;
+	while (value >= 0x80U) {
+		out[len++] = static_cast<uint8_t>(value | 0x80U);
+		value >>= 7;
+	}
+	out[len++] = static_cast<uint8_t>(value);
+	return len;
+}
+
+bool
+getVarint(const uint8_t *data, size_t size, size_t &pos, uint32_t &value)
+{
+	value = 0;
+	for (uint32_t shift = 0; shift < 35; shift += 7) {
+		if (pos >= size) {
+			return false;
+		}
+		const uint8_t byte = data[pos++];
+		value |= static_cast<uint32_t>(byte & 0x7FU) << shift;
+		if ((byte & 0x80U) == 0) {
+			return true;
+		}
+	}
+	return false;
+}
+
+uint32_t
+zigzag(int32_t value)
+{
+	return (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31);
+}
+
+int32_t
+unzigzag(uint32_t value)
+{
+	return static_cast<int32_t>((value >> 1) ^ (~(value & 1U) + 1U));
+}
+
+uint32_t
+blockChecksum(const uint8_t *block, size_t used)
+{
+	uint32_t hash = 2166136261U;
+	for (size_t i = 0; i < used; ++i) {
+		if (i >= kChecksumOffset && i < kChecksumOffset + 4) {
+			continue;
+		}
+		hash = (hash ^ block[i]) * 16777619U;
+	}
+	return hash;
+}
+
+// Decodes a block's records in order; stops early when onRecord returns false.
+template <typename Fn>
+bool
+walkBlock(const uint8_t *block, Fn &&onRecord)
+{
+	const uint16_t used = getU16(block + 6);
+	const uint16_t count = getU16(block + 4);
+	const uint16_t intervalS = getU16(block + 16);
+	MetricLogRecord record;
+	record.timeS = getU32(block + 8);
+	for (size_t ch = 0; ch < kMetricLogChannels; ++ch) {
+		record.values[ch] = static_cast<int32_t>(getU32(block + 24 + 4 * ch));
+	}
+	if (!onRecord(record)) {
+		return false;
+	}
+	size_t pos = kMetricLogHeaderBytes;
+	for (uint16_t i = 1; i < count; ++i) {
+		uint32_t dt = 0;
+		uint32_t mask = 0;
+		if (!getVarint(block, used, pos, dt) || !getVarint(block, used, pos, mask)) {
+			return true;
+		}
+		record.timeS += static_cast<uint32_t>(static_cast<int32_t>(intervalS) + unzigzag(dt));
+		for (size_t ch = 0; ch < kMetricLogChannels; ++ch) {
+			if ((mask & (1U << ch)) == 0) {
+				continue;
+			}
+			uint32_t delta = 0;
+			if (!getVarint(block, used, pos, delta)) {
+				return true;
+			}
+			record.values[ch] =
+				static_cast<int32_t>(static_cast<uint32_t>(record.values[ch]) + static_cast<uint32_t>(unzigzag(delta)));
+		}
+		if (!onRecord(record)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+bool
+readHeader(MetricLog &log, MetricLogStore &store, uint32_t segmentId, uint16_t index, MetricLogBlockHeader *header)
+{
+	log.stats.blocksRead++;
+	return store.readBlock(segmentId, index, log.readScratch, kMetricLogHeaderBytes) &&
+	       metricLogBlockHeader(log.readScratch, kMetricLogHeaderBytes, header);
+}
+
+bool
+writePending(MetricLog &log, MetricLogStore &store)
+{
+	if (!log.pendingActive) {
+		return true;
+	}
+	log.pendingActive = false;
+	MetricLogBlockHeader header;
+	metricLogBlockHeader(log.pending, kMetricLogBlockBytes, &header);
+
+	if (log.segmentCount == 0 || log.segments[log.segmentCount - 1].blocks >= log.config.blocksPerSegment) {
+		const uint32_t nextId = (log.segmentCount == 0) ? 1 : log.segments[log.segmentCount - 1].id + 1;
+		if (log.segmentCount >= log.config.maxSegments) {
+			store.removeSegment(log.segments[0].id);
+			memmove(&log.segments[0], &log.segments[1], sizeof(log.segments[0]) * (log.segmentCount - 1));
+			log.segmentCount--;
+			log.stats.segmentsRotated++;
+		}
+		MetricLogSegmentInfo &fresh = log.segments[log.segmentCount++];
+		fresh.id = nextId;
+		fresh.firstTimeS = header.firstTimeS;
+		fresh.lastTimeS = header.lastTimeS;
+		fresh.blocks = 0;
+	}
+	MetricLogSegmentInfo &segment = log.segments[log.segmentCount - 1];
+	// Unused tail bytes are zeroed so identical records always produce identical flash images.
+	memset(log.pending + header.used, 0, kMetricLogBlockBytes - header.used);
+	if (!store.appendBlock(segment.id, log.pending)) {
+		log.stats.writeFailures++;
+		if (segment.blocks == 0) {
+			log.segmentCount--;
+		}
+		return false;
+	}
+	if (segment.blocks == 0) {
+		segment.firstTimeS = header.firstTimeS;
+	}
+	segment.blocks++;
+	segment.lastTimeS = header.lastTimeS;
+	log.stats.blocksWritten++;
+	return true;
+}
+
+struct DecodeWindow {
+	uint32_t fromS;
+	uint32_t toS;
+	MetricLogRecordFn fn;
+	void *ctx;
+	size_t emitted;
+	// Past toS, or the consumer cancelled.
+	bool stopped;
+	bool cancelled;
+};
+
+bool
+decodeInto(const uint8_t *block, DecodeWindow &window)
+{
+	return walkBlock(block, [&window](const MetricLogRecord &record) {
+		if (record.timeS > window.toS) {
+			window.stopped = true;
+			return false;
+		}
+		if (record.timeS < window.fromS) {
+			return true;
+		}
+		window.emitted++;
+		if (!window.fn(window.ctx, record)) {
+			window.stopped = true;
+			window.cancelled = true;
+			return false;
+		}
+		return true;
+	});
+}
+
+} // namespace
+
+int
+metricLogChannelFor(mqttEntityId entityId)
+{
+	for (size_t ch = 0; ch < kMetricLogChannels; ++ch) {
+		if (kMetricLogChannelDefs[ch].entityId == entityId) {
+			return static_cast<int>(ch);
+		}
+	}
+	return -1;
+}
+
+void
+metricLogBlockBegin(uint8_t *block, uint16_t intervalS, const MetricLogRecord &first)
+{
+	memset(block, 0, kMetricLogHeaderBytes);
+	block[0] = kMagic0;
+	block[1] = kMagic1;
+	block[2] = kFormat;
+	block[3] = static_cast<uint8_t>(kMetricLogChannels);
+	putU16(block + 4, 1);
+	putU16(block + 6, static_cast<uint16_t>(kMetricLogHeaderBytes));
+	putU32(block + 8, first.timeS);
+	putU32(block + 12, first.timeS);
+	putU16(block + 16, intervalS);
+	for (size_t ch = 0; ch < kMetricLogChannels; ++ch) {
+		putU32(block + 24 + 4 * ch, static_cast<uint32_t>(first.values[ch]));
+	}
+	putU32(block + kChecksumOffset, blockChecksum(block, kMetricLogHeaderBytes));
+}
+
+bool
+metricLogBlockAppend(uint8_t *block, const MetricLogRecord &record)
+{
+	const uint16_t used = getU16(block + 6);
+	const uint16_t count = getU16(block + 4);
+	const uint32_t lastTimeS = getU32(block + 12);
+	if (record.timeS <= lastTimeS || used + kMaxRecordBytes > kMetricLogBlockBytes || count == UINT16_MAX) {
+		return false;
+	}
+	MetricLogRecord last{};
+	walkBlock(block, [&last](const MetricLogRecord &decoded) {
+		last = decoded;
+		return true;
+	});
+
+	const uint16_t intervalS = getU16(block + 16);
+	uint8_t *out = block + used;
+	size_t len = putVarint(out, zigzag(static_cast<int32_t>(record.timeS - lastTimeS) - intervalS));
+	uint32_t mask = 0;
+	for (size_t ch = 0; ch < kMetricLogChannels; ++ch) {
+		if (record.values[ch] != last.values[ch]) {
+			mask |= 1U << ch;
+		}
+	}
+	len += putVarint(out + len, mask);
+	for (size_t ch = 0; ch < kMetricLogChannels; ++ch) {
+		if ((mask & (1U << ch)) != 0) {
+			const uint32_t delta = static_cast<uint32_t>(record.values[ch]) - static_cast<uint32_t>(last.values[ch]);
+			len += putVarint(out + len, zigzag(static_cast<int32_t>(delta)));
+		}
+	}
+	const uint16_t newUsed = static_cast<uint16_t>(used + len);
+	putU16(block + 4, static_cast<uint16_t>(count + 1));
+	putU16(block + 6, newUsed);
+	putU32(block + 12, record.timeS);
+	putU32(block + kChecksumOffset, blockChecksum(block, newUsed));
+	return true;
+}
+
+bool
+metricLogBlockHeader(const uint8_t *block, size_t len, MetricLogBlockHeader *header)
+{
+	if (block == nullptr || len < kMetricLogHeaderBytes || block[0] != kMagic0 || block[1] != kMagic1 ||
+	    block[2] != kFormat || block[3] != kMetricLogChannels) {
+		return false;
+	}
+	MetricLogBlockHeader parsed;
+	parsed.count = getU16(block + 4);
+	parsed.used = getU16(block + 6);
+	parsed.firstTimeS = getU32(block + 8);
+	parsed.lastTimeS = getU32(block + 12);
+	parsed.intervalS = getU16(block + 16);
+	if (parsed.count == 0 || parsed.used < kMetricLogHeaderBytes || parsed.used > kMetricLogBlockBytes ||
+	    parsed.lastTimeS < parsed.firstTimeS) {
+		return false;
+	}
+	if (header != nullptr) {
+		*header = parsed;
+	}
+	return true;
+}
+
+bool
+metricLogBlockValid(const uint8_t *block)
+{
+	MetricLogBlockHeader header;
+	return metricLogBlockHeader(block, kMetricLogBlockBytes, &header) &&
+	       getU32(block + kChecksumOffset) == blockChecksum(block, header.used);
+}
+
+bool
+metricLogBlockDecode(const uint8_t *block, uint32_t fromS, uint32_t toS, MetricLogRecordFn fn, void *ctx)
+{
+	if (fn == nullptr || !metricLogBlockValid(block)) {
+		return true;
+	}
+	DecodeWindow window{ fromS, toS, fn, ctx, 0, false, false };
+	decodeInto(block, window);
+	return !window.cancelled;
+}
+
+bool
+metricLogOpen(MetricLog &log, MetricLogStore &store, const MetricLogConfig &config)
+{
+	memset(&log, 0, sizeof(log));
+	log.config = config;
+	if (log.config.intervalS == 0) {
+		log.config.intervalS = METRIC_LOG_INTERVAL_S;
+	}
+	if (log.config.blocksPerSegment == 0) {
+		log.config.blocksPerSegment = 1;
+	}
+	if (log.config.maxSegments < 2 || log.config.maxSegments > kMetricLogMaxSegments) {
+		log.config.maxSegments = kMetricLogMaxSegments;
+	}
+
+	uint32_t ids[kMetricLogMaxSegments * 2];
+	const size_t listed = store.listSegments(ids, kMetricLogMaxSegments * 2);
+	// Keep the newest segments only; a smaller maxSegments after an upgrade trims the oldest.
+	size_t start = (listed > log.config.maxSegments) ? listed - log.config.maxSegments : 0;
+	for (size_t i = 0; i < start; ++i) {
+		store.removeSegment(ids[i]);
+	}
+	for (size_t i = start; i < listed; ++i) {
+		const uint16_t blocks = store.blockCount(ids[i]);
+		MetricLogBlockHeader first;
+		MetricLogBlockHeader last;
+		uint16_t lastIndex = blocks;
+		bool found = blocks > 0 && readHeader(log, store, ids[i], 0, &first);
+		// A torn final block (power cut mid-write) is ignored; earlier blocks stay readable.
+		while (found && lastIndex > 0) {
+			lastIndex--;
+			if (readHeader(log, store, ids[i], lastIndex, &last)) {
+				break;
+			}
+			if (lastIndex == 0) {
+				found = false;
+			}
+		}
+		if (!found) {
+			store.removeSegment(ids[i]);
+			continue;
+		}
+		MetricLogSegmentInfo &segment = log.segments[log.segmentCount++];
+		segment.id = ids[i];
+		segment.firstTimeS = first.firstTimeS;
+		segment.lastTimeS = last.lastTimeS;
+		segment.blocks = blocks;
+		if (last.lastTimeS > log.lastTimeS) {
+			log.lastTimeS = last.lastTimeS;
+		}
+	}
+	log.stats.blocksRead = 0;
+	return true;
+}
+
+bool
+metricLogAppend(MetricLog &log, MetricLogStore &store, const MetricLogRecord &record)
+{
+	if (record.timeS <= log.lastTimeS) {
+		log.stats.rejected++;
+		return false;
+	}
+	bool stored = true;
+	if (!log.pendingActive) {
+		metricLogBlockBegin(log.pending, log.config.intervalS, record);
+		log.pendingActive = true;
+	} else if (!metricLogBlockAppend(log.pending, record)) {
+		stored = writePending(log, store);
+		metricLogBlockBegin(log.pending, log.config.intervalS, record);
+		log.pendingActive = true;
+	}
+	log.lastTimeS = record.timeS;
+	log.stats.appended++;
+	return stored;
+}
+
+bool
+metricLogFlush(MetricLog &log, MetricLogStore &store)
+{
+	return writePending(log, store);
+}
+
+size_t
+metricLogQuery(MetricLog &log, MetricLogStore &store, uint32_t fromS, uint32_t toS, MetricLogRecordFn fn, void *ctx)
+{
+	if (fn == nullptr || fromS > toS) {
+		return 0;
+	}
+	DecodeWindow window{ fromS, toS, fn, ctx, 0, false, false };
+
+	// First segment that can still hold fromS.
+	size_t lo = 0;
+	size_t hi = log.segmentCount;
+	while (lo < hi) {
+		const size_t mid = (lo + hi) / 2;
+		if (log.segments[mid].lastTimeS < fromS) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+	bool seeking = true;
+	for (size_t s = lo; s < log.segmentCount && !window.stopped; ++s) {
+		const MetricLogSegmentInfo &segment = log.segments[s];
+		if (segment.firstTimeS > toS) {
+			window.stopped = true;
+			break;
+		}
+		uint16_t startBlock = 0;
+		if (seeking && segment.firstTimeS < fromS) {
+			// Last block that starts at or before fromS.
+			uint16_t blo = 0;
+			uint16_t bhi = segment.blocks;
+			while (bhi - blo > 1) {
+				const uint16_t mid = static_cast<uint16_t>((blo + bhi) / 2);
+				MetricLogBlockHeader header;
+				if (readHeader(log, store, segment.id, mid, &header) && header.firstTimeS > fromS) {
+					bhi = mid;
+				} else {
+					blo = mid;
+				}
+			}
+			startBlock = blo;
+		}
+		seeking = false;
+		for (uint16_t b = startBlock; b < segment.blocks && !window.stopped; ++b) {
+			log.stats.blocksRead++;
+			if (!store.readBlock(segment.id, b, log.readScratch, kMetricLogBlockBytes) ||
+			    !metricLogBlockValid(log.readScratch)) {
+				continue;
+			}
+			decodeInto(log.readScratch, window);
+		}
+	}
+	if (!window.stopped && log.pendingActive) {
+		decodeInto(log.pending, window);
+	}
+	return window.emitted;
+}
+
+uint32_t
+metricLogFirstTimeS(const MetricLog &log)
+{
+	if (log.segmentCount > 0) {
+		return log.segments[0].firstTimeS;
+	}
+	if (log.pendingActive) {
+		MetricLogBlockHeader header;
+		if (metricLogBlockHeader(log.pending, kMetricLogBlockBytes, &header)) {
+			return header.firstTimeS;
+		}
+	}
+	return 0;
+}
+
+size_t
+metricLogStoredBytes(const MetricLog &log)
+{
+	size_t bytes = 0;
+	for (uint8_t s = 0; s < log.segmentCount; ++s) {
+		bytes += static_cast<size_t>(log.segments[s].blocks) * kMetricLogBlockBytes;
+	}
+	return bytes;
+}
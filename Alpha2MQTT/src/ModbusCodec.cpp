@@ -1,5 +1,10 @@
 #include "../include/ModbusCodec.h"
 
+bool modbusSlaveIdIsValid(uint8_t slaveId)
+{
+	return slaveId >= kModbusMinSlaveId && slaveId <= kModbusMaxSlaveId;
+}
+
 uint16_t calculateCrc(const uint8_t *frame, size_t length)
 {
 	unsigned int temp = 0xffff;
@@ -6,6 +6,9 @@
 #include "../include/MqttEntities.h"
 
 #include "../include/BucketScheduler.h"
+#include "../include/PackedBucketMap.h"
+#include "../include/PerfectHash.h"
+#include "../include/PollPlanBuilder.h"
 
 #include <new>
 #include <cstdio>
@@ -17,32 +20,267 @@
 
 namespace {
 
+// Compile-time only on firmware: the rows as written, which the packed table and the perfect hash
+// are generated from. Host builds also hand this table out through mqttEntitiesDesc().
+#define MQTT_ENTITY_ROW(id, name, freq, subscribe, retain, haClass, family, scope, readKind, readKey, needsEssSnapshot) \
+	{ name, static_cast<uint16_t>(readKey), id, freq, haClass, family, scope, readKind, subscribe, retain, needsEssSnapshot },
+constexpr mqttState kMqttEntityRows[] = {
+#include "../include/MqttEntityCatalogRows.h"
+};
+#undef MQTT_ENTITY_ROW
+
+static_assert(sizeof(kMqttEntityRows) / sizeof(kMqttEntityRows[0]) == kMqttEntityDescriptorCount,
+              "kMqttEntityDescriptorCount must match the catalog row count");
+
+// Every name back to back, NUL-separated; rows refer to their name by offset.
+#define MQTT_ENTITY_ROW(id, name, ...) name "\0"
 #if defined(ESP8266) || defined(ARDUINO_ARCH_ESP8266)
-#define MQTT_ENTITY_NAME_DECL(id, name) static const char id##_name[] PROGMEM = name;
+static const char kMqttEntityNamePool[] PROGMEM =
 #else
-#define MQTT_ENTITY_NAME_DECL(id, name) static const char id##_name[] = name;
+static const char kMqttEntityNamePool[] =
 #endif
-
-#define MQTT_ENTITY_ROW(id, name, ...) MQTT_ENTITY_NAME_DECL(id, name)
 #include "../include/MqttEntityCatalogRows.h"
+	;
 #undef MQTT_ENTITY_ROW
-#undef MQTT_ENTITY_NAME_DECL
 
-#define MQTT_ENTITY_ROW(id, name, freq, subscribe, retain, haClass, family, scope, readKind, readKey, needsEssSnapshot) \
-	{ id##_name, static_cast<uint16_t>(readKey), id, freq, haClass, family, scope, readKind, subscribe, retain, needsEssSnapshot },
+// Layout of MqttEntityPackedRow::bits, low bit first.
+constexpr unsigned kPackFreqShift = 0;
+constexpr unsigned kPackFreqWidth = 3;
+constexpr unsigned kPackHaClassShift = 3;
+constexpr unsigned kPackHaClassWidth = 5;
+constexpr unsigned kPackFamilyShift = 8;
+constexpr unsigned kPackFamilyWidth = 3;
+constexpr unsigned kPackScopeShift = 11;
+constexpr unsigned kPackScopeWidth = 1;
+constexpr unsigned kPackReadKindShift = 12;
+constexpr unsigned kPackReadKindWidth = 3;
+constexpr unsigned kPackSubscribeShift = 15;
+constexpr unsigned kPackRetainShift = 16;
+constexpr unsigned kPackNeedsEssShift = 17;
+// Dense id of the register read a RegisterFanout row shares with its transaction.
+constexpr unsigned kPackReadGroupShift = 18;
+constexpr unsigned kPackReadGroupWidth = 14;
+
+static_assert(mqttUpdateFreq::freqDisabled < (1u << kPackFreqWidth), "update frequency outgrew its bitfield");
+static_assert(haClassNumber < (1u << kPackHaClassWidth), "HA class outgrew its bitfield");
+static_assert(static_cast<unsigned>(MqttEntityFamily::System) < (1u << kPackFamilyWidth), "family outgrew its bitfield");
+static_assert(static_cast<unsigned>(MqttEntityScope::Inverter) < (1u << kPackScopeWidth), "scope outgrew its bitfield");
+static_assert(static_cast<unsigned>(MqttEntityReadKind::Manual) < (1u << kPackReadKindWidth),
+              "read kind outgrew its bitfield");
+static_assert(sizeof(MqttEntityPackedRow) == 8, "packed catalog rows must stay 8 bytes");
+static_assert(sizeof(MqttEntityPackedRow) < sizeof(mqttState), "packed rows must be smaller than mqttState");
+
+constexpr uint32_t
+unpackField(uint32_t bits, unsigned shift, unsigned width)
+{
+	return (bits >> shift) & ((1u << width) - 1u);
+}
+
+constexpr uint32_t
+packRowBits(const mqttState &row)
+{
+	return (static_cast<uint32_t>(row.updateFreq) << kPackFreqShift) |
+	       (static_cast<uint32_t>(row.haClass) << kPackHaClassShift) |
+	       (static_cast<uint32_t>(row.family) << kPackFamilyShift) |
+	       (static_cast<uint32_t>(row.scope) << kPackScopeShift) |
+	       (static_cast<uint32_t>(row.readKind) << kPackReadKindShift) |
+	       (static_cast<uint32_t>(row.subscribe ? 1u : 0u) << kPackSubscribeShift) |
+	       (static_cast<uint32_t>(row.retain ? 1u : 0u) << kPackRetainShift) |
+	       (static_cast<uint32_t>(row.needsEssSnapshot ? 1u : 0u) << kPackNeedsEssShift);
+}
+
+constexpr bool
+catalogRowIsRegisterFanout(const mqttState &row)
+{
+	return !row.needsEssSnapshot && row.readKind == MqttEntityReadKind::Register;
+}
+
+// Register-fanout rows sharing a read key share a read group; groups are numbered in catalog order.
+constexpr size_t
+catalogReadGroupCount()
+{
+	size_t groups = 0;
+	for (size_t i = 0; i < kMqttEntityDescriptorCount; ++i) {
+		const mqttState &row = kMqttEntityRows[i];
+		if (!catalogRowIsRegisterFanout(row)) {
+			continue;
+		}
+		bool seen = false;
+		for (size_t j = 0; j < i && !seen; ++j) {
+			seen = catalogRowIsRegisterFanout(kMqttEntityRows[j]) && kMqttEntityRows[j].readKey == row.readKey;
+		}
+		if (!seen) {
+			++groups;
+		}
+	}
+	return groups;
+}
+
+constexpr size_t kMqttEntityReadGroupCount = catalogReadGroupCount();
+static_assert(kMqttEntityReadGroupCount < (1u << kPackReadGroupWidth), "read group ids outgrew their bitfield");
+
+constexpr size_t
+catalogNameLength(const char *name)
+{
+	size_t len = 0;
+	while (name[len] != '\0') {
+		++len;
+	}
+	return len;
+}
+
+constexpr size_t
+catalogNamePoolBytes()
+{
+	size_t bytes = 0;
+	for (const mqttState &row : kMqttEntityRows) {
+		bytes += catalogNameLength(row.mqttName) + 1;
+	}
+	return bytes;
+}
+
+// The entity id is not stored: rows and ids come from the same list, so the id is the row index.
+constexpr bool
+catalogIdsMatchRows()
+{
+	for (size_t i = 0; i < kMqttEntityDescriptorCount; ++i) {
+		if (static_cast<size_t>(kMqttEntityRows[i].entityId) != i) {
+			return false;
+		}
+	}
+	return true;
+}
+
+struct MqttEntityPackedCatalog {
+	MqttEntityPackedRow rows[kMqttEntityDescriptorCount];
+};
+
+constexpr MqttEntityPackedCatalog
+buildPackedCatalog()
+{
+	MqttEntityPackedCatalog catalog{};
+	size_t nameOffset = 0;
+	uint32_t nextReadGroup = 0;
+	for (size_t i = 0; i < kMqttEntityDescriptorCount; ++i) {
+		const mqttState &row = kMqttEntityRows[i];
+		uint32_t readGroup = 0;
+		if (catalogRowIsRegisterFanout(row)) {
+			readGroup = nextReadGroup;
+			for (size_t j = 0; j < i; ++j) {
+				if (catalogRowIsRegisterFanout(kMqttEntityRows[j]) && kMqttEntityRows[j].readKey == row.readKey) {
+					readGroup = unpackField(catalog.rows[j].bits, kPackReadGroupShift, kPackReadGroupWidth);
+					break;
+				}
+			}
+			if (readGroup == nextReadGroup) {
+				++nextReadGroup;
+			}
+		}
+		catalog.rows[i].bits = packRowBits(row) | (readGroup << kPackReadGroupShift);
+		catalog.rows[i].nameOffset = static_cast<uint16_t>(nameOffset);
+		catalog.rows[i].readKey = row.readKey;
+		nameOffset += catalogNameLength(row.mqttName) + 1;
+	}
+	return catalog;
+}
+
+// The pool carries the literal's own trailing NUL on top of the per-name separators.
+static_assert(sizeof(kMqttEntityNamePool) == catalogNamePoolBytes() + 1, "name pool must hold every catalog name");
+static_assert(catalogNamePoolBytes() <= UINT16_MAX, "name pool offsets must fit in 16 bits");
+static_assert(catalogIdsMatchRows(), "entity ids must equal their catalog row index");
+
+constexpr uint32_t kCatalogFingerprintSeed = 2166136261U;
+constexpr uint32_t kCatalogFingerprintPrime = 16777619U;
+
+// FNV-1a over each name, its terminator and its default freq, in catalog order.
+constexpr uint32_t
+catalogFingerprint(size_t count)
+{
+	uint32_t hash = kCatalogFingerprintSeed;
+	for (size_t i = 0; i < count; ++i) {
+		const char *name = kMqttEntityRows[i].mqttName;
+		do {
+			hash = (hash ^ static_cast<uint8_t>(*name)) * kCatalogFingerprintPrime;
+		} while (*name++ != '\0');
+		hash = (hash ^ static_cast<uint8_t>(kMqttEntityRows[i].updateFreq)) * kCatalogFingerprintPrime;
+	}
+	return hash;
+}
+
+// Boot checks the full catalog, so that value costs nothing at runtime.
+constexpr uint32_t kMqttEntityCatalogFingerprint = catalogFingerprint(kMqttEntityDescriptorCount);
 
 #if defined(ESP8266) || defined(ARDUINO_ARCH_ESP8266)
-static const mqttState kMqttEntities[] PROGMEM = {
+static const MqttEntityPackedCatalog kMqttEntityPacked PROGMEM = buildPackedCatalog();
 #else
-static const mqttState kMqttEntities[] = {
+static const MqttEntityPackedCatalog kMqttEntityPacked = buildPackedCatalog();
 #endif
+
+// Compile-time only: the name list the perfect hash is built from.
+#define MQTT_ENTITY_ROW(id, name, ...) name,
+constexpr const char *kMqttEntityHashKeys[] = {
 #include "../include/MqttEntityCatalogRows.h"
 };
-
 #undef MQTT_ENTITY_ROW
 
-static_assert(sizeof(kMqttEntities) / sizeof(kMqttEntities[0]) == kMqttEntityDescriptorCount,
-              "kMqttEntityDescriptorCount must match kMqttEntities length");
+constexpr PerfectHashTable<kMqttEntityDescriptorCount> kMqttEntityNameHashBuilt =
+	buildPerfectHash(kMqttEntityHashKeys);
+static_assert(kMqttEntityNameHashBuilt.ok, "MQTT entity names must be unique");
+
+#if defined(ESP8266) || defined(ARDUINO_ARCH_ESP8266)
+static const PerfectHashTable<kMqttEntityDescriptorCount> kMqttEntityNameHash PROGMEM = kMqttEntityNameHashBuilt;
+#else
+static const PerfectHashTable<kMqttEntityDescriptorCount> kMqttEntityNameHash = kMqttEntityNameHashBuilt;
+#endif
+
+// Single-word reads straight from flash; callers have already range-checked idx.
+static uint32_t
+packedBits(size_t idx)
+{
+#if defined(ESP8266) || defined(ARDUINO_ARCH_ESP8266)
+	return pgm_read_dword(&kMqttEntityPacked.rows[idx].bits);
+#else
+	return kMqttEntityPacked.rows[idx].bits;
+#endif
+}
+
+static const char *
+packedName(size_t idx)
+{
+#if defined(ESP8266) || defined(ARDUINO_ARCH_ESP8266)
+	return kMqttEntityNamePool + pgm_read_word(&kMqttEntityPacked.rows[idx].nameOffset);
+#else
+	return kMqttEntityNamePool + kMqttEntityPacked.rows[idx].nameOffset;
+#endif
+}
+
+static uint16_t
+packedReadKey(size_t idx)
+{
+#if defined(ESP8266) || defined(ARDUINO_ARCH_ESP8266)
+	return pgm_read_word(&kMqttEntityPacked.rows[idx].readKey);
+#else
+	return kMqttEntityPacked.rows[idx].readKey;
+#endif
+}
+
+static mqttUpdateFreq
+packedFreq(size_t idx)
+{
+	return static_cast<mqttUpdateFreq>(unpackField(packedBits(idx), kPackFreqShift, kPackFreqWidth));
+}
+
+static MqttEntityReadKind
+packedReadKind(size_t idx)
+{
+	return static_cast<MqttEntityReadKind>(unpackField(packedBits(idx), kPackReadKindShift, kPackReadKindWidth));
+}
+
+static bool
+packedFlag(size_t idx, unsigned shift)
+{
+	return unpackField(packedBits(idx), shift, 1) != 0;
+}
 
 static bool
 copyEntityFromCatalog(size_t idx, mqttState *out)
@@ -50,11 +288,18 @@ copyEntityFromCatalog(size_t idx, mqttState *out)
 	if (out == nullptr || idx >= kMqttEntityDescriptorCount) {
 		return false;
 	}
-#if defined(ESP8266) || defined(ARDUINO_ARCH_ESP8266)
-	memcpy_P(out, &kMqttEntities[idx], sizeof(*out));
-#else
-	*out = kMqttEntities[idx];
-#endif
+	const uint32_t bits = packedBits(idx);
+	out->mqttName = packedName(idx);
+	out->readKey = packedReadKey(idx);
+	out->entityId = static_cast<mqttEntityId>(idx);
+	out->updateFreq = static_cast<mqttUpdateFreq>(unpackField(bits, kPackFreqShift, kPackFreqWidth));
+	out->haClass = static_cast<homeAssistantClass>(unpackField(bits, kPackHaClassShift, kPackHaClassWidth));
+	out->family = static_cast<MqttEntityFamily>(unpackField(bits, kPackFamilyShift, kPackFamilyWidth));
+	out->scope = static_cast<MqttEntityScope>(unpackField(bits, kPackScopeShift, kPackScopeWidth));
+	out->readKind = static_cast<MqttEntityReadKind>(unpackField(bits, kPackReadKindShift, kPackReadKindWidth));
+	out->subscribe = unpackField(bits, kPackSubscribeShift, 1) != 0;
+	out->retain = unpackField(bits, kPackRetainShift, 1) != 0;
+	out->needsEssSnapshot = unpackField(bits, kPackNeedsEssShift, 1) != 0;
 	return true;
 }
 
@@ -77,378 +322,153 @@ isRetiredLegacyDispatchControlEntity(mqttEntityId entityId)
 struct RuntimeState {
 	bool initialized = false;
 	bool planDirty = true;
-	MqttEntityBucketOverride *overrides = nullptr;
+	// PackedBucketMap of user overrides inside arena, like every array the plan references; null
+	// when every entity runs on its catalog default.
+	uint8_t *overrideMap = nullptr;
 	size_t overrideCount = 0;
 	MqttEntityActivePlan plan{};
+	uint8_t *arena = nullptr;
+	size_t arenaBytes = 0;
 };
 
 static RuntimeState g_runtime;
 
-static void
-resetBucket(MqttEntityActiveBucket &bucket)
-{
-	delete[] bucket.members;
-	delete[] bucket.transactions;
-	bucket.members = nullptr;
-	bucket.transactions = nullptr;
-	bucket.count = 0;
-	bucket.transactionCount = 0;
-	bucket.hasEssSnapshot = false;
-}
-
-static void
-resetActivePlan(MqttEntityActivePlan &plan)
-{
-	resetBucket(plan.tenSec);
-	resetBucket(plan.oneMin);
-	resetBucket(plan.fiveMin);
-	resetBucket(plan.oneHour);
-	resetBucket(plan.oneDay);
-	resetBucket(plan.user);
-	plan.activeCount = 0;
-}
-
 static BucketId
 defaultBucketForIndex(size_t idx)
 {
 	if (idx >= kMqttEntityDescriptorCount) {
 		return BucketId::Unknown;
 	}
-	mqttState entity{};
-	if (!copyEntityFromCatalog(idx, &entity)) {
-		return BucketId::Unknown;
-	}
-	return bucketIdFromFreq(entity.updateFreq);
+	return bucketIdFromFreq(packedFreq(idx));
 }
 
 static bool
 bucketMatchesStoredDefault(size_t idx, BucketId bucket)
 {
-	if (bucket == BucketId::Unknown) {
-		return false;
-	}
-	mqttState entity{};
-	if (!copyEntityFromCatalog(idx, &entity)) {
+	if (bucket == BucketId::Unknown || idx >= kMqttEntityDescriptorCount) {
 		return false;
 	}
-	if (entity.updateFreq == mqttUpdateFreq::freqNever) {
+	const mqttUpdateFreq defaultFreq = packedFreq(idx);
+	if (defaultFreq == mqttUpdateFreq::freqNever) {
 		// `freqNever` defaults render as Disabled in the portal, but dropping an
 		// explicit Disabled override would resurrect discovery/state publishing.
 		return false;
 	}
-	return bucket == bucketIdFromFreq(entity.updateFreq);
+	return bucket == bucketIdFromFreq(defaultFreq);
 }
 
 static BucketId
-bucketOverrideForIndex(const MqttEntityBucketOverride *overrides, size_t overrideCount, size_t idx)
+bucketOverrideForIndex(size_t idx)
 {
-	for (size_t i = 0; i < overrideCount; ++i) {
-		if (overrides[i].entityIndex == idx) {
-			return overrides[i].bucketId;
-		}
-		if (overrides[i].entityIndex > idx) {
-			break;
-		}
+	if (g_runtime.overrideMap == nullptr) {
+		return BucketId::Unknown;
 	}
-	return BucketId::Unknown;
+	return packedBucketGet(g_runtime.overrideMap, idx);
 }
 
 static BucketId
-bucketForIndex(const MqttEntityBucketOverride *overrides, size_t overrideCount, size_t idx)
+bucketForIndex(size_t idx)
 {
-	BucketId bucket = bucketOverrideForIndex(overrides, overrideCount, idx);
+	const BucketId bucket = bucketOverrideForIndex(idx);
 	if (bucket != BucketId::Unknown) {
 		return bucket;
 	}
 	return defaultBucketForIndex(idx);
 }
 
-static BucketId
-bucketForIndex(size_t idx)
-{
-	return bucketForIndex(g_runtime.overrides, g_runtime.overrideCount, idx);
-}
-
-static uint16_t *
-allocateMembers(size_t count)
-{
-	if (count == 0) {
-		return nullptr;
-	}
-	return new (std::nothrow) uint16_t[count];
-}
-
 static MqttPollTransactionKind
-transactionKindForEntity(const mqttState &entity)
+transactionKindForIndex(size_t idx)
 {
-	if (entity.needsEssSnapshot) {
+	if (packedFlag(idx, kPackNeedsEssShift)) {
 		return MqttPollTransactionKind::SnapshotFanout;
 	}
-	if (entity.readKind == MqttEntityReadKind::Register) {
+	if (packedReadKind(idx) == MqttEntityReadKind::Register) {
 		return MqttPollTransactionKind::RegisterFanout;
 	}
 	return MqttPollTransactionKind::SingleEntity;
 }
 
-struct TempTransactionSpec {
-	MqttPollTransactionKind kind = MqttPollTransactionKind::SingleEntity;
-	uint16_t readKey = 0;
-	uint16_t firstMemberOffset = 0;
-	uint16_t entityCount = 0;
-};
-
-static bool
-transactionMatches(const TempTransactionSpec &spec, const mqttState &entity)
+static BucketId
+catalogDefaultBucket(const void *, size_t idx)
 {
-	const MqttPollTransactionKind kind = transactionKindForEntity(entity);
-	if (spec.kind != kind) {
-		return false;
-	}
-	switch (kind) {
-	case MqttPollTransactionKind::SnapshotFanout:
-		return true;
-	case MqttPollTransactionKind::RegisterFanout:
-		return spec.readKey == entity.readKey;
-	case MqttPollTransactionKind::SingleEntity:
-	default:
-		return false;
-	}
+	return defaultBucketForIndex(idx);
 }
 
-static bool
-buildBucketTransactions(MqttEntityActiveBucket &bucket,
-                       BucketId bucketId,
-                       const MqttEntityBucketOverride *overrides,
-                       size_t overrideCount)
+static MqttPollTransactionKind
+catalogKind(const void *, size_t idx)
 {
-	if (bucket.count == 0) {
-		return true;
-	}
-
-	TempTransactionSpec *specs = new (std::nothrow) TempTransactionSpec[bucket.count];
-	if (specs == nullptr) {
-		return false;
-	}
-
-	uint16_t entityTxnIndex[kMqttEntityDescriptorCount];
-	for (size_t i = 0; i < kMqttEntityDescriptorCount; ++i) {
-		entityTxnIndex[i] = UINT16_MAX;
-	}
-
-	size_t txnCount = 0;
-	size_t matchedEntityCount = 0;
-	for (size_t idx = 0; idx < kMqttEntityDescriptorCount; ++idx) {
-		if (bucketForIndex(overrides, overrideCount, idx) != bucketId) {
-			continue;
-		}
-		mqttState entity{};
-		if (!copyEntityFromCatalog(idx, &entity)) {
-			delete[] specs;
-			return false;
-		}
-		size_t txnIndex = txnCount;
-		for (size_t existing = 0; existing < txnCount; ++existing) {
-			if (transactionMatches(specs[existing], entity)) {
-				txnIndex = existing;
-				break;
-			}
-		}
-		if (txnIndex == txnCount) {
-			specs[txnIndex].kind = transactionKindForEntity(entity);
-			specs[txnIndex].readKey = entity.readKey;
-			txnCount++;
-		}
-		specs[txnIndex].entityCount++;
-		entityTxnIndex[idx] = static_cast<uint16_t>(txnIndex);
-		matchedEntityCount++;
-	}
-
-	if (matchedEntityCount != bucket.count) {
-		delete[] specs;
-		return false;
-	}
-
-	bucket.transactions = new (std::nothrow) MqttPollTransaction[txnCount];
-	if (bucket.transactions == nullptr) {
-		delete[] specs;
-		return false;
-	}
-
-	size_t nextOffset = 0;
-	for (size_t i = 0; i < txnCount; ++i) {
-		specs[i].firstMemberOffset = static_cast<uint16_t>(nextOffset);
-		bucket.transactions[i].firstMemberOffset = specs[i].firstMemberOffset;
-		bucket.transactions[i].entityCount = specs[i].entityCount;
-		bucket.transactions[i].readKey = specs[i].readKey;
-		bucket.transactions[i].kind = specs[i].kind;
-		nextOffset += specs[i].entityCount;
-	}
-
-	if (nextOffset != bucket.count) {
-		delete[] specs;
-		return false;
-	}
-
-	bucket.members = allocateMembers(bucket.count);
-	if (bucket.count != 0 && bucket.members == nullptr) {
-		delete[] specs;
-		return false;
-	}
+	return transactionKindForIndex(idx);
+}
 
-	uint16_t fillCounts[kMqttEntityDescriptorCount];
-	for (size_t i = 0; i < kMqttEntityDescriptorCount; ++i) {
-		fillCounts[i] = 0;
-	}
+static uint16_t
+catalogReadKey(const void *, size_t idx)
+{
+	return packedReadKey(idx);
+}
 
-	for (size_t idx = 0; idx < kMqttEntityDescriptorCount; ++idx) {
-		if (bucketForIndex(overrides, overrideCount, idx) != bucketId) {
-			continue;
-		}
-		const uint16_t txnIndex = entityTxnIndex[idx];
-		if (txnIndex == UINT16_MAX || txnIndex >= txnCount) {
-			delete[] specs;
-			return false;
-		}
-		const size_t offset = specs[txnIndex].firstMemberOffset + fillCounts[txnIndex];
-		if (offset >= bucket.count) {
-			delete[] specs;
-			return false;
-		}
-		bucket.members[offset] = static_cast<uint16_t>(idx);
-		fillCounts[txnIndex]++;
-	}
+static uint16_t
+catalogReadGroup(const void *, size_t idx)
+{
+	return static_cast<uint16_t>(unpackField(packedBits(idx), kPackReadGroupShift, kPackReadGroupWidth));
+}
 
-	for (size_t i = 0; i < txnCount; ++i) {
-		if (fillCounts[i] != specs[i].entityCount) {
-			delete[] specs;
-			return false;
-		}
-		if (specs[i].kind == MqttPollTransactionKind::SnapshotFanout) {
-			bucket.hasEssSnapshot = true;
-		}
-	}
+constexpr PollPlanCatalog kFlashPlanCatalog = {
+	kMqttEntityDescriptorCount, kMqttEntityReadGroupCount, nullptr,
+	catalogDefaultBucket,       catalogKind,               catalogReadKey,
+	catalogReadGroup,
+};
 
-	bucket.transactionCount = txnCount;
-	delete[] specs;
-	return true;
+static BucketId
+runtimeOverride(const void *, size_t idx)
+{
+	return bucketOverrideForIndex(idx);
 }
 
-static bool
-rebuildActivePlanForOverrides(MqttEntityActivePlan &nextPlan,
-                              const MqttEntityBucketOverride *overrides,
-                              size_t overrideCount)
-{
-	for (size_t idx = 0; idx < kMqttEntityDescriptorCount; ++idx) {
-		mqttState entity{};
-		if (!copyEntityFromCatalog(idx, &entity)) {
-			resetActivePlan(nextPlan);
-			return false;
-		}
-		const bool needsEssSnapshot = entity.needsEssSnapshot;
-		switch (bucketForIndex(overrides, overrideCount, idx)) {
-		case BucketId::TenSec:
-			nextPlan.tenSec.count++;
-			nextPlan.tenSec.hasEssSnapshot = nextPlan.tenSec.hasEssSnapshot || needsEssSnapshot;
-			nextPlan.activeCount++;
-			break;
-		case BucketId::OneMin:
-			nextPlan.oneMin.count++;
-			nextPlan.oneMin.hasEssSnapshot = nextPlan.oneMin.hasEssSnapshot || needsEssSnapshot;
-			nextPlan.activeCount++;
-			break;
-		case BucketId::FiveMin:
-			nextPlan.fiveMin.count++;
-			nextPlan.fiveMin.hasEssSnapshot = nextPlan.fiveMin.hasEssSnapshot || needsEssSnapshot;
-			nextPlan.activeCount++;
-			break;
-		case BucketId::OneHour:
-			nextPlan.oneHour.count++;
-			nextPlan.oneHour.hasEssSnapshot = nextPlan.oneHour.hasEssSnapshot || needsEssSnapshot;
-			nextPlan.activeCount++;
-			break;
-		case BucketId::OneDay:
-			nextPlan.oneDay.count++;
-			nextPlan.oneDay.hasEssSnapshot = nextPlan.oneDay.hasEssSnapshot || needsEssSnapshot;
-			nextPlan.activeCount++;
-			break;
-		case BucketId::User:
-			nextPlan.user.count++;
-			nextPlan.user.hasEssSnapshot = nextPlan.user.hasEssSnapshot || needsEssSnapshot;
-			nextPlan.activeCount++;
-			break;
-		case BucketId::Disabled:
-		case BucketId::Unknown:
-		default:
-			break;
-		}
-	}
+// Explicit assignments for every entity; only those that differ from the stored default become
+// overrides.
+static BucketId
+assignedOverride(const void *ctx, size_t idx)
+{
+	const BucketId bucket = static_cast<const BucketId *>(ctx)[idx];
+	return bucketMatchesStoredDefault(idx, bucket) ? BucketId::Unknown : bucket;
+}
 
-	if (!buildBucketTransactions(nextPlan.tenSec, BucketId::TenSec, overrides, overrideCount) ||
-	    !buildBucketTransactions(nextPlan.oneMin, BucketId::OneMin, overrides, overrideCount) ||
-	    !buildBucketTransactions(nextPlan.fiveMin, BucketId::FiveMin, overrides, overrideCount) ||
-	    !buildBucketTransactions(nextPlan.oneHour, BucketId::OneHour, overrides, overrideCount) ||
-	    !buildBucketTransactions(nextPlan.oneDay, BucketId::OneDay, overrides, overrideCount) ||
-	    !buildBucketTransactions(nextPlan.user, BucketId::User, overrides, overrideCount)) {
-		resetActivePlan(nextPlan);
-		return false;
-	}
-	return true;
+static BucketId
+snapshotOverride(const void *ctx, size_t idx)
+{
+	const BucketId bucket = packedBucketGet(static_cast<const uint8_t *>(ctx), idx);
+	return bucketMatchesStoredDefault(idx, bucket) ? BucketId::Unknown : bucket;
 }
 
 static bool
-rebuildActivePlan(void)
+buildFlashPlan(PollPlanOverrideFn overrideFor, const void *overrideCtx, PollPlanStorage &out)
 {
-	MqttEntityActivePlan nextPlan{};
-	if (!rebuildActivePlanForOverrides(nextPlan, g_runtime.overrides, g_runtime.overrideCount)) {
-		return false;
-	}
-	resetActivePlan(g_runtime.plan);
-	g_runtime.plan = nextPlan;
+	// Sized by distinct register reads, not by entities.
+	uint16_t groupScratch[kMqttEntityReadGroupCount > 0 ? kMqttEntityReadGroupCount : 1];
+	return pollPlanBuild(kFlashPlanCatalog, overrideFor, overrideCtx, groupScratch, out);
+}
+
+static void
+installPlanStorage(PollPlanStorage &next)
+{
+	delete[] g_runtime.arena;
+	g_runtime.arena = next.arena;
+	g_runtime.arenaBytes = next.arenaBytes;
+	g_runtime.overrideMap = next.overrideMap;
+	g_runtime.overrideCount = next.overrideCount;
+	g_runtime.plan = next.plan;
 	g_runtime.planDirty = false;
-	return true;
+	next = PollPlanStorage{};
 }
 
 static bool
-buildOverridesFromBuckets(const BucketId *buckets,
-                          size_t entityCount,
-                          MqttEntityBucketOverride *&nextOverrides,
-                          size_t &nextOverrideCount)
+rebuildActivePlan(void)
 {
-	if (buckets == nullptr || entityCount != kMqttEntityDescriptorCount) {
-		return false;
-	}
-
-	nextOverrideCount = 0;
-	for (size_t i = 0; i < entityCount; ++i) {
-		const BucketId bucket = buckets[i];
-		if (bucket == BucketId::Unknown) {
-			return false;
-		}
-		if (!bucketMatchesStoredDefault(i, bucket)) {
-			nextOverrideCount++;
-		}
-	}
-
-	nextOverrides = nullptr;
-	if (nextOverrideCount == 0) {
-		return true;
-	}
-
-	nextOverrides = new (std::nothrow) MqttEntityBucketOverride[nextOverrideCount];
-	if (nextOverrides == nullptr) {
+	PollPlanStorage next{};
+	if (!buildFlashPlan(runtimeOverride, nullptr, next)) {
 		return false;
 	}
-
-	size_t nextIdx = 0;
-	for (size_t i = 0; i < entityCount; ++i) {
-		const BucketId bucket = buckets[i];
-		if (bucketMatchesStoredDefault(i, bucket)) {
-			continue;
-		}
-		nextOverrides[nextIdx].entityIndex = static_cast<uint16_t>(i);
-		nextOverrides[nextIdx].bucketId = bucket;
-		nextIdx++;
-	}
+	installPlanStorage(next);
 	return true;
 }
 
@@ -460,7 +480,7 @@ mqttEntitiesDesc()
 #if defined(ESP8266) || defined(ARDUINO_ARCH_ESP8266)
 	return nullptr;
 #else
-	return kMqttEntities;
+	return kMqttEntityRows;
 #endif
 }
 
@@ -470,12 +490,8 @@ mqttEntityById(mqttEntityId id)
 #if defined(ESP8266) || defined(ARDUINO_ARCH_ESP8266)
 	return nullptr;
 #else
-	for (size_t i = 0; i < kMqttEntityDescriptorCount; ++i) {
-		if (kMqttEntities[i].entityId == id) {
-			return &kMqttEntities[i];
-		}
-	}
-	return nullptr;
+	const size_t idx = static_cast<size_t>(id);
+	return (idx < kMqttEntityDescriptorCount) ? &kMqttEntityRows[idx] : nullptr;
 #endif
 }
 
@@ -504,36 +520,47 @@ mqttEntityIndexById(mqttEntityId id, size_t *outIdx)
 	if (outIdx == nullptr) {
 		return false;
 	}
-	for (size_t i = 0; i < kMqttEntityDescriptorCount; ++i) {
-		mqttState entity{};
-		if (!copyEntityFromCatalog(i, &entity)) {
-			return false;
-		}
-		if (entity.entityId == id) {
-			*outIdx = i;
-			return true;
-		}
+	// Ids and rows come from the same row list, so the id is the row index (checked at compile time).
+	if (static_cast<size_t>(id) >= kMqttEntityDescriptorCount) {
+		return false;
 	}
-	return false;
+	*outIdx = static_cast<size_t>(id);
+	return true;
 }
 
 bool
 mqttEntityIndexByName(const char *name, size_t *outIdx)
 {
-	if (name == nullptr || name[0] == '\0' || outIdx == nullptr) {
+	if (name == nullptr) {
 		return false;
 	}
-	for (size_t i = 0; i < kMqttEntityDescriptorCount; ++i) {
-		mqttState entity{};
-		if (!copyEntityFromCatalog(i, &entity)) {
-			return false;
-		}
-		if (mqttEntityNameEquals(&entity, name)) {
-			*outIdx = i;
-			return true;
-		}
+	return mqttEntityIndexByNameSpan(name, strlen(name), outIdx);
+}
+
+bool
+mqttEntityIndexByNameSpan(const char *name, size_t len, size_t *outIdx)
+{
+	if (name == nullptr || len == 0 || outIdx == nullptr) {
+		return false;
+	}
+	const uint32_t candidate = perfectHashCandidate(kMqttEntityNameHash, name, len);
+	if (candidate >= kMqttEntityDescriptorCount) {
+		return false;
 	}
-	return false;
+	// The hash only proposes a row; non-members land on some row too.
+#if defined(ESP8266) || defined(ARDUINO_ARCH_ESP8266)
+	const PGM_P entityName = reinterpret_cast<PGM_P>(packedName(candidate));
+	if (strncmp_P(name, entityName, len) != 0 || pgm_read_byte(entityName + len) != '\0') {
+		return false;
+	}
+#else
+	const char *entityName = packedName(candidate);
+	if (strncmp(name, entityName, len) != 0 || entityName[len] != '\0') {
+		return false;
+	}
+#endif
+	*outIdx = candidate;
+	return true;
 }
 
 bool
@@ -556,6 +583,99 @@ mqttEntitiesCount()
 	return kMqttEntityDescriptorCount;
 }
 
+const char *
+mqttEntityNameByIndex(size_t idx)
+{
+	return (idx < kMqttEntityDescriptorCount) ? packedName(idx) : nullptr;
+}
+
+mqttUpdateFreq
+mqttEntityDefaultFreqByIndex(size_t idx)
+{
+	return (idx < kMqttEntityDescriptorCount) ? packedFreq(idx) : mqttUpdateFreq::freqDisabled;
+}
+
+homeAssistantClass
+mqttEntityHaClassByIndex(size_t idx)
+{
+	if (idx >= kMqttEntityDescriptorCount) {
+		return homeAssistantClass::haClassInfo;
+	}
+	return static_cast<homeAssistantClass>(unpackField(packedBits(idx), kPackHaClassShift, kPackHaClassWidth));
+}
+
+MqttEntityFamily
+mqttEntityFamilyByIndex(size_t idx)
+{
+	if (idx >= kMqttEntityDescriptorCount) {
+		return MqttEntityFamily::Controller;
+	}
+	return static_cast<MqttEntityFamily>(unpackField(packedBits(idx), kPackFamilyShift, kPackFamilyWidth));
+}
+
+MqttEntityScope
+mqttEntityScopeByIndex(size_t idx)
+{
+	if (idx >= kMqttEntityDescriptorCount) {
+		return MqttEntityScope::Inverter;
+	}
+	return static_cast<MqttEntityScope>(unpackField(packedBits(idx), kPackScopeShift, kPackScopeWidth));
+}
+
+MqttEntityReadKind
+mqttEntityReadKindByIndex(size_t idx)
+{
+	return (idx < kMqttEntityDescriptorCount) ? packedReadKind(idx) : MqttEntityReadKind::Derived;
+}
+
+uint16_t
+mqttEntityReadKeyByIndex(size_t idx)
+{
+	return (idx < kMqttEntityDescriptorCount) ? packedReadKey(idx) : 0;
+}
+
+bool
+mqttEntitySubscribeByIndex(size_t idx)
+{
+	return idx < kMqttEntityDescriptorCount && packedFlag(idx, kPackSubscribeShift);
+}
+
+bool
+mqttEntityRetainByIndex(size_t idx)
+{
+	return idx < kMqttEntityDescriptorCount && packedFlag(idx, kPackRetainShift);
+}
+
+size_t
+mqttEntityCatalogFlashBytes()
+{
+	return sizeof(kMqttEntityPacked) + sizeof(kMqttEntityNamePool);
+}
+
+uint32_t
+mqttEntityCatalogFingerprint(size_t count)
+{
+	if (count >= kMqttEntityDescriptorCount) {
+		return kMqttEntityCatalogFingerprint;
+	}
+	// Shorter prefixes are only asked about once, when a record predates catalog growth.
+	uint32_t hash = kCatalogFingerprintSeed;
+	for (size_t idx = 0; idx < count; ++idx) {
+		const char *name = packedName(idx);
+		uint8_t byte = 0;
+		do {
+#if defined(ESP8266) || defined(ARDUINO_ARCH_ESP8266)
+			byte = pgm_read_byte(name++);
+#else
+			byte = static_cast<uint8_t>(*name++);
+#endif
+			hash = (hash ^ byte) * kCatalogFingerprintPrime;
+		} while (byte != 0);
+		hash = (hash ^ static_cast<uint8_t>(packedFreq(idx))) * kCatalogFingerprintPrime;
+	}
+	return hash;
+}
+
 bool
 mqttEntityNameEquals(const mqttState *entity, const char *name)
 {
@@ -587,17 +707,36 @@ mqttEntityNameCopy(const mqttState *entity, char *out, size_t outSize)
 #endif
 }
 
+size_t
+mqttEntityNameAppend(const mqttState *entity, char *out, size_t outSize)
+{
+	if (entity == nullptr || entity->mqttName == nullptr || out == nullptr) {
+		return 0;
+	}
+#if defined(ESP8266) || defined(ARDUINO_ARCH_ESP8266)
+	const size_t len = strlen_P(reinterpret_cast<PGM_P>(entity->mqttName));
+	if (len >= outSize) {
+		return 0;
+	}
+	memcpy_P(out, entity->mqttName, len);
+#else
+	const size_t len = strlen(entity->mqttName);
+	if (len >= outSize) {
+		return 0;
+	}
+	memcpy(out, entity->mqttName, len);
+#endif
+	out[len] = '\0';
+	return len;
+}
+
 bool
 mqttEntityNeedsEssSnapshotByIndex(size_t idx)
 {
 	if (idx >= kMqttEntityDescriptorCount) {
 		return false;
 	}
-	mqttState entity{};
-	if (!copyEntityFromCatalog(idx, &entity)) {
-		return false;
-	}
-	return entity.needsEssSnapshot;
+	return packedFlag(idx, kPackNeedsEssShift);
 }
 
 BucketId
@@ -615,16 +754,13 @@ mqttEntityEffectiveFreqByIndex(size_t idx)
 	if (idx >= kMqttEntityDescriptorCount) {
 		return mqttUpdateFreq::freqDisabled;
 	}
-	mqttState entity{};
-	if (!copyEntityFromCatalog(idx, &entity)) {
-		return mqttUpdateFreq::freqDisabled;
-	}
+	const mqttUpdateFreq defaultFreq = packedFreq(idx);
 	if (!g_runtime.initialized) {
-		return entity.updateFreq;
+		return defaultFreq;
 	}
 
-	const BucketId overrideBucket = bucketOverrideForIndex(g_runtime.overrides, g_runtime.overrideCount, idx);
-	if (overrideBucket == BucketId::Unknown && entity.updateFreq == mqttUpdateFreq::freqNever) {
+	const BucketId overrideBucket = bucketOverrideForIndex(idx);
+	if (overrideBucket == BucketId::Unknown && defaultFreq == mqttUpdateFreq::freqNever) {
 		return mqttUpdateFreq::freqNever;
 	}
 	return bucketIdToFreq(bucketForIndex(idx));
@@ -648,48 +784,70 @@ mqttEntityApplyBuckets(const BucketId *buckets, size_t entityCount)
 	if (!g_runtime.initialized || buckets == nullptr || entityCount != kMqttEntityDescriptorCount) {
 		return false;
 	}
+	for (size_t i = 0; i < entityCount; ++i) {
+		if (buckets[i] == BucketId::Unknown) {
+			return false;
+		}
+	}
 
-	MqttEntityBucketOverride *nextOverrides = nullptr;
-	size_t nextOverrideCount = 0;
-	if (!buildOverridesFromBuckets(buckets, entityCount, nextOverrides, nextOverrideCount)) {
-		delete[] nextOverrides;
+	PollPlanStorage next{};
+	if (!buildFlashPlan(assignedOverride, buckets, next)) {
 		return false;
 	}
+	installPlanStorage(next);
+	return true;
+}
 
-	MqttEntityActivePlan nextPlan{};
-	if (!rebuildActivePlanForOverrides(nextPlan, nextOverrides, nextOverrideCount)) {
-		delete[] nextOverrides;
+bool
+mqttEntityCanApplyBuckets(const BucketId *buckets, size_t entityCount)
+{
+	if (!g_runtime.initialized || buckets == nullptr || entityCount != kMqttEntityDescriptorCount) {
 		return false;
 	}
+	for (size_t i = 0; i < entityCount; ++i) {
+		if (buckets[i] == BucketId::Unknown) {
+			return false;
+		}
+	}
 
-	delete[] g_runtime.overrides;
-	g_runtime.overrides = nextOverrides;
-	g_runtime.overrideCount = nextOverrideCount;
-	resetActivePlan(g_runtime.plan);
-	g_runtime.plan = nextPlan;
-	g_runtime.planDirty = false;
+	PollPlanStorage next{};
+	if (!buildFlashPlan(assignedOverride, buckets, next)) {
+		return false;
+	}
+	pollPlanRelease(next);
 	return true;
 }
 
 bool
-mqttEntityCanApplyBuckets(const BucketId *buckets, size_t entityCount)
+mqttEntitySaveBucketSnapshot(uint8_t *out, size_t outSize)
 {
-	if (!g_runtime.initialized || buckets == nullptr || entityCount != kMqttEntityDescriptorCount) {
+	if (!g_runtime.initialized || out == nullptr || outSize < kMqttEntityBucketSnapshotBytes) {
 		return false;
 	}
+	for (size_t i = 0; i < kMqttEntityDescriptorCount; ++i) {
+		packedBucketSet(out, i, bucketForIndex(i));
+	}
+	return true;
+}
 
-	MqttEntityBucketOverride *nextOverrides = nullptr;
-	size_t nextOverrideCount = 0;
-	if (!buildOverridesFromBuckets(buckets, entityCount, nextOverrides, nextOverrideCount)) {
-		delete[] nextOverrides;
+bool
+mqttEntityRestoreBucketSnapshot(const uint8_t *snapshot, size_t size)
+{
+	if (!g_runtime.initialized || snapshot == nullptr || size < kMqttEntityBucketSnapshotBytes) {
 		return false;
 	}
+	for (size_t i = 0; i < kMqttEntityDescriptorCount; ++i) {
+		if (packedBucketGet(snapshot, i) == BucketId::Unknown) {
+			return false;
+		}
+	}
 
-	MqttEntityActivePlan nextPlan{};
-	const bool ok = rebuildActivePlanForOverrides(nextPlan, nextOverrides, nextOverrideCount);
-	resetActivePlan(nextPlan);
-	delete[] nextOverrides;
-	return ok;
+	PollPlanStorage next{};
+	if (!buildFlashPlan(snapshotOverride, snapshot, next)) {
+		return false;
+	}
+	installPlanStorage(next);
+	return true;
 }
 
 bool
@@ -756,6 +914,12 @@ mqttActivePlan()
 	return &g_runtime.plan;
 }
 
+size_t
+mqttActivePlanStorageBytes()
+{
+	return g_runtime.arenaBytes;
+}
+
 bool
 mqttEntitiesRtAvailable()
 {
@@ -0,0 +1,271 @@
+// Purpose: Bounded latest-value-wins MQTT outbound queue with priority classes and token-bucket shaping.
+#include "../include/MqttOutboundQueue.h"
+
+#include <cstring>
+
+namespace {
+
+constexpr uint32_t kMilliPerToken = 1000;
+
+void
+refill(MqttTokenBucket &bucket, uint32_t nowMs)
+{
+	const uint32_t elapsedMs = nowMs - bucket.lastRefillMs;
+	bucket.lastRefillMs = nowMs;
+	const uint64_t cap = static_cast<uint64_t>(bucket.burst) * kMilliPerToken;
+	// ms * tokens/s == milli-tokens.
+	uint64_t next = static_cast<uint64_t>(bucket.milliTokens) + static_cast<uint64_t>(elapsedMs) * bucket.ratePerSec;
+	if (next > cap) {
+		next = cap;
+	}
+	bucket.milliTokens = static_cast<uint32_t>(next);
+}
+
+bool
+seqBefore(uint32_t a, uint32_t b)
+{
+	return static_cast<int32_t>(a - b) < 0;
+}
+
+// Highest-priority, oldest pending entry; nullptr when empty.
+MqttOutboundEntry *
+nextToSend(MqttOutboundQueue &queue)
+{
+	MqttOutboundEntry *best = nullptr;
+	for (MqttOutboundEntry &entry : queue.entries) {
+		if (!entry.used) {
+			continue;
+		}
+		if (best == nullptr || entry.cls < best->cls ||
+		    (entry.cls == best->cls && seqBefore(entry.seq, best->seq))) {
+			best = &entry;
+		}
+	}
+	return best;
+}
+
+// Oldest entry of the lowest-priority class strictly below cls; nullptr when there is none.
+MqttOutboundEntry *
+evictionVictim(MqttOutboundQueue &queue, uint8_t cls)
+{
+	MqttOutboundEntry *victim = nullptr;
+	for (MqttOutboundEntry &entry : queue.entries) {
+		if (!entry.used || entry.cls <= cls) {
+			continue;
+		}
+		if (victim == nullptr || entry.cls > victim->cls ||
+		    (entry.cls == victim->cls && seqBefore(entry.seq, victim->seq))) {
+			victim = &entry;
+		}
+	}
+	return victim;
+}
+
+void
+fillEntry(MqttOutboundQueue &queue,
+          MqttOutboundEntry &entry,
+          uint16_t key,
+          uint8_t cls,
+          const char *payload,
+          size_t payloadLen,
+          bool retain)
+{
+	entry.used = true;
+	entry.key = key;
+	entry.cls = cls;
+	entry.retain = retain;
+	entry.seq = queue.nextSeq++;
+	memcpy(entry.payload, payload, payloadLen + 1);
+}
+
+} // namespace
+
+void
+tokenBucketInit(MqttTokenBucket &bucket, uint32_t ratePerSec, uint32_t burst, uint32_t nowMs)
+{
+	bucket.ratePerSec = ratePerSec;
+	bucket.burst = (burst == 0) ? 1 : burst;
+	bucket.milliTokens = bucket.burst * kMilliPerToken;
+	bucket.lastRefillMs = nowMs;
+}
+
+bool
+tokenBucketTryTake(MqttTokenBucket &bucket, uint32_t nowMs)
+{
+	if (bucket.ratePerSec == 0) {
+		return true;
+	}
+	refill(bucket, nowMs);
+	if (bucket.milliTokens < kMilliPerToken) {
+		return false;
+	}
+	bucket.milliTokens -= kMilliPerToken;
+	return true;
+}
+
+uint32_t
+tokenBucketMsUntilToken(MqttTokenBucket &bucket, uint32_t nowMs)
+{
+	if (bucket.ratePerSec == 0) {
+		return 0;
+	}
+	refill(bucket, nowMs);
+	if (bucket.milliTokens >= kMilliPerToken) {
+		return 0;
+	}
+	const uint32_t missing = kMilliPerToken - bucket.milliTokens;
+	return (missing + bucket.ratePerSec - 1) / bucket.ratePerSec;
+}
+
+void
+mqttOutboundInit(MqttOutboundQueue &queue, uint32_t ratePerSec, uint32_t burst, uint32_t nowMs)
+{
+	memset(&queue, 0, sizeof(queue));
+	tokenBucketInit(queue.shaper, ratePerSec, burst, nowMs);
+}
+
+MqttOutboundEnqueue
+mqttOutboundEnqueue(MqttOutboundQueue &queue,
+                    uint16_t key,
+                    MqttOutboundClass cls,
+                    const char *payload,
+                    bool retain)
+{
+	const size_t payloadLen = (payload != nullptr) ? strlen(payload) : kMqttOutboundPayloadMax;
+	if (payloadLen >= kMqttOutboundPayloadMax) {
+		queue.stats.rejected++;
+		return MqttOutboundEnqueue::Rejected;
+	}
+	const uint8_t clsValue = static_cast<uint8_t>(cls);
+
+	MqttOutboundEntry *freeSlot = nullptr;
+	for (MqttOutboundEntry &entry : queue.entries) {
+		if (entry.used && entry.key == key) {
+			// Keep the queue position so a value that changes every poll is not starved.
+			memcpy(entry.payload, payload, payloadLen + 1);
+			entry.retain = retain;
+			if (clsValue < entry.cls) {
+				entry.cls = clsValue;
+			}
+			queue.stats.coalesced++;
+			return MqttOutboundEnqueue::Coalesced;
+		}
+		if (!entry.used && freeSlot == nullptr) {
+			freeSlot = &entry;
+		}
+	}
+
+	if (freeSlot != nullptr) {
+		fillEntry(queue, *freeSlot, key, clsValue, payload, payloadLen, retain);
+		queue.stats.queued++;
+		queue.stats.depth++;
+		if (queue.stats.depth > queue.stats.maxDepth) {
+			queue.stats.maxDepth = queue.stats.depth;
+		}
+		return MqttOutboundEnqueue::Queued;
+	}
+
+	MqttOutboundEntry *victim = evictionVictim(queue, clsValue);
+	if (victim == nullptr) {
+		queue.stats.rejected++;
+		return MqttOutboundEnqueue::Rejected;
+	}
+	fillEntry(queue, *victim, key, clsValue, payload, payloadLen, retain);
+	queue.stats.queued++;
+	queue.stats.dropped++;
+	return MqttOutboundEnqueue::QueuedWithEviction;
+}
+
+size_t
+mqttOutboundDrain(MqttOutboundQueue &queue,
+                  uint32_t nowMs,
+                  size_t maxItems,
+                  MqttOutboundSink sink,
+                  void *ctx)
+{
+	if (sink == nullptr) {
+		return 0;
+	}
+	size_t sent = 0;
+	while (sent < maxItems) {
+		MqttOutboundEntry *entry = nextToSend(queue);
+		if (entry == nullptr) {
+			break;
+		}
+		if (!tokenBucketTryTake(queue.shaper, nowMs)) {
+			queue.stats.throttled++;
+			break;
+		}
+		if (!sink(ctx, entry->key, entry->payload, entry->retain)) {
+			// Nothing left the device, so the token is returned.
+			if (queue.shaper.ratePerSec != 0) {
+				queue.shaper.milliTokens += kMilliPerToken;
+			}
+			queue.stats.sendFailures++;
+			break;
+		}
+		entry->used = false;
+		queue.stats.sent++;
+		queue.stats.depth--;
+		sent++;
+	}
+	return sent;
+}
+
+uint32_t
+mqttOutboundMsUntilSend(MqttOutboundQueue &queue, uint32_t nowMs, uint32_t noDeadlineMs)
+{
+	if (queue.stats.depth == 0) {
+		return noDeadlineMs;
+	}
+	return tokenBucketMsUntilToken(queue.shaper, nowMs);
+}
+
+void
+mqttOutboundClear(MqttOutboundQueue &queue)
+{
+	for (MqttOutboundEntry &entry : queue.entries) {
+		if (entry.used) {
+			entry.used = false;
+			queue.stats.dropped++;
+		}
+	}
+	queue.stats.depth = 0;
+}
+
+size_t
+mqttOutboundSetIdentity(MqttOutboundQueue &queue, const char *identity)
+{
+	if (identity == nullptr) {
+		identity = "";
+	}
+	if (strncmp(queue.identity, identity, sizeof(queue.identity)) == 0) {
+		return 0;
+	}
+	const size_t dropped = queue.stats.depth;
+	mqttOutboundClear(queue);
+	strncpy(queue.identity, identity, sizeof(queue.identity) - 1);
+	queue.identity[sizeof(queue.identity) - 1] = '\0';
+	return dropped;
+}
+
+MqttOutboundClass
+mqttOutboundClassFor(mqttEntityId entityId, MqttEntityReadKind readKind, MqttEntityScope scope)
+{
+	if (readKind == MqttEntityReadKind::Control) {
+		return MqttOutboundClass::Dispatch;
+	}
+	switch (entityId) {
+	case mqttEntityId::entityDispatchStart:
+	case mqttEntityId::entityDispatchMode:
+	case mqttEntityId::entityDispatchPower:
+	case mqttEntityId::entityDispatchSoc:
+	case mqttEntityId::entityDispatchTime:
+	case mqttEntityId::entityDispatchRemaining:
+	case mqttEntityId::entityDispatchRequestStatus:
+		return MqttOutboundClass::Dispatch;
+	default:
+		break;
+	}
+	return (scope == MqttEntityScope::Controller) ? MqttOutboundClass::Diagnostics : MqttOutboundClass::Telemetry;
+}
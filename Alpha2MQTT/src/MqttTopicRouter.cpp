@@ -0,0 +1,49 @@
+// Purpose: Perfect-hash routing of device-scoped MQTT control topics.
+#include "../include/MqttTopicRouter.h"
+
+#include "../include/PerfectHash.h"
+
+#include <cstring>
+
+namespace {
+
+constexpr const char *kDeviceTopicSuffixes[] = {
+	"/config/set",
+	"/debug/raw_read/set",
+	"/debug/rs485_stub/set",
+};
+
+constexpr DeviceTopicRoute kDeviceTopicRoutes[] = {
+	DeviceTopicRoute::ConfigSet,
+	DeviceTopicRoute::RawReadSet,
+	DeviceTopicRoute::Rs485StubSet,
+};
+
+static_assert(sizeof(kDeviceTopicSuffixes) / sizeof(kDeviceTopicSuffixes[0]) ==
+                  sizeof(kDeviceTopicRoutes) / sizeof(kDeviceTopicRoutes[0]),
+              "every device topic suffix needs a route");
+
+constexpr size_t kDeviceTopicSuffixCount = sizeof(kDeviceTopicSuffixes) / sizeof(kDeviceTopicSuffixes[0]);
+
+constexpr PerfectHashTable<kDeviceTopicSuffixCount> kDeviceTopicHash = buildPerfectHash(kDeviceTopicSuffixes);
+static_assert(kDeviceTopicHash.ok, "device topic suffixes must be unique");
+
+} // namespace
+
+DeviceTopicRoute
+routeDeviceTopic(const char *topic, const char *deviceName)
+{
+	if (topic == nullptr || deviceName == nullptr || deviceName[0] == '\0') {
+		return DeviceTopicRoute::None;
+	}
+	const size_t deviceLen = strlen(deviceName);
+	if (strncmp(topic, deviceName, deviceLen) != 0) {
+		return DeviceTopicRoute::None;
+	}
+	const char *suffix = topic + deviceLen;
+	const uint32_t candidate = perfectHashCandidate(kDeviceTopicHash, suffix, strlen(suffix));
+	if (candidate >= kDeviceTopicSuffixCount || strcmp(suffix, kDeviceTopicSuffixes[candidate]) != 0) {
+		return DeviceTopicRoute::None;
+	}
+	return kDeviceTopicRoutes[candidate];
+}
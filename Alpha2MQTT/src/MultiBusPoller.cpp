@@ -0,0 +1,374 @@
+// Purpose: Overlap Modbus transactions on independent RS485 buses instead of serialising them.
+#include "../include/MultiBusPoller.h"
+
+#include <cstdio>
+
+#include "../include/Rs485ProbeLogic.h"
+
+namespace {
+
+bool
+timeReached(uint32_t nowMs, uint32_t atMs)
+{
+	return static_cast<int32_t>(nowMs - atMs) >= 0;
+}
+
+bool
+linkHandshaking(const BusLink &link)
+{
+	return link.state == BusLinkState::Probing || link.state == BusLinkState::Identifying;
+}
+
+void
+dropQueue(BusLane &lane)
+{
+	lane.diag.dropped += lane.count;
+	lane.head = 0;
+	lane.count = 0;
+}
+
+// Probing starts again at the last locked baud, so a brief outage reconnects on the first probe.
+void
+restartProbing(BusLane &lane, uint32_t atMs)
+{
+	lane.link.state = BusLinkState::Probing;
+	lane.link.failures = 0;
+	lane.link.probesInCycle = 0;
+	lane.link.cycleBackoffMs = kBusProbeAttemptDelayMs;
+	lane.link.nextAttemptMs = atMs;
+}
+
+void
+noteLinkResult(BusLane &lane, const BusTxn &txn, bool ok, uint32_t nowMs)
+{
+	BusLink &link = lane.link;
+	switch (txn.kind) {
+	case BusTxnKind::Probe:
+		if (link.state != BusLinkState::Probing) {
+			return;
+		}
+		if (ok) {
+			link.state = BusLinkState::Identifying;
+			link.baudIndex = static_cast<uint8_t>(txn.planIndex);
+			link.probesInCycle = 0;
+			link.failures = 0;
+			link.cycleBackoffMs = kBusProbeAttemptDelayMs;
+			link.nextAttemptMs = nowMs;
+			return;
+		}
+		link.baudIndex = static_cast<uint8_t>(rs485NextIndex(txn.planIndex, link.baudCount));
+		if (++link.probesInCycle >= link.baudCount) {
+			link.probesInCycle = 0;
+			link.nextAttemptMs = nowMs + link.cycleBackoffMs;
+			link.cycleBackoffMs = rs485NextBackoffMs(link.cycleBackoffMs, kBusProbeMaxBackoffMs);
+		} else {
+			link.nextAttemptMs = nowMs + kBusProbeAttemptDelayMs;
+		}
+		return;
+	case BusTxnKind::Identify:
+		if (link.state != BusLinkState::Identifying) {
+			return;
+		}
+		if (ok) {
+			link.state = BusLinkState::Online;
+			link.failures = 0;
+			link.epoch++;
+			return;
+		}
+		if (++link.failures >= kBusLinkFailureLimit) {
+			restartProbing(lane, nowMs + kBusProbeAttemptDelayMs);
+			return;
+		}
+		link.nextAttemptMs = nowMs + link.cycleBackoffMs;
+		link.cycleBackoffMs = rs485NextBackoffMs(link.cycleBackoffMs, kBusProbeMaxBackoffMs);
+		return;
+	case BusTxnKind::Poll:
+	default:
+		if (link.state != BusLinkState::Online) {
+			return;
+		}
+		if (ok) {
+			link.failures = 0;
+			return;
+		}
+		if (++link.failures >= kBusLinkFailureLimit) {
+			lane.diag.linkDrops++;
+			dropQueue(lane);
+			restartProbing(lane, nowMs);
+		}
+		return;
+	}
+}
+
+void
+finishTxn(BusLane &lane, size_t bus, bool ok, uint32_t nowMs, BusCompletionFn onComplete, void *ctx)
+{
+	const uint32_t latency = nowMs - lane.startedMs;
+	lane.inFlight = false;
+	lane.cycleUsedMs += latency;
+	lane.diag.busyMs += latency;
+	lane.diag.lastLatencyMs = latency;
+	if (latency > lane.diag.maxLatencyMs) {
+		lane.diag.maxLatencyMs = latency;
+	}
+	if (ok) {
+		lane.diag.completed++;
+	} else {
+		lane.diag.failed++;
+	}
+	if (lane.link.state != BusLinkState::Unmanaged) {
+		noteLinkResult(lane, lane.current, ok, nowMs);
+	}
+	if (onComplete != nullptr) {
+		onComplete(bus, lane.current, ok, latency, ctx);
+	}
+}
+
+bool
+budgetSpent(const BusLane &lane)
+{
+	return lane.cycleBudgetMs != 0 && lane.cycleUsedMs >= lane.cycleBudgetMs;
+}
+
+// Picks what an idle bus runs next: a due link handshake, else the head of its queue.
+bool
+takeNextTxn(BusLane &lane, uint32_t nowMs, BusTxn *out)
+{
+	if (linkHandshaking(lane.link)) {
+		if (!timeReached(nowMs, lane.link.nextAttemptMs)) {
+			return false;
+		}
+		*out = BusTxn{};
+		out->planIndex = lane.link.baudIndex;
+		out->slaveId = lane.link.slaveId;
+		out->kind = (lane.link.state == BusLinkState::Probing) ? BusTxnKind::Probe : BusTxnKind::Identify;
+		return true;
+	}
+	if (lane.count == 0) {
+		return false;
+	}
+	if (budgetSpent(lane)) {
+		if (!lane.cycleDeferred) {
+			lane.cycleDeferred = true;
+			lane.diag.budgetDeferrals++;
+		}
+		return false;
+	}
+	*out = lane.queue[lane.head];
+	lane.head = static_cast<uint8_t>((lane.head + 1) % kBusQueueDepth);
+	lane.count--;
+	return true;
+}
+
+} // namespace
+
+bool
+multiBusAttach(MultiBusPoller &poller, size_t bus, BusTransport *transport, uint32_t cycleBudgetMs)
+{
+	if (bus >= kMaxRs485Buses) {
+		return false;
+	}
+	poller.lanes[bus] = BusLane{};
+	poller.lanes[bus].transport = transport;
+	poller.lanes[bus].cycleBudgetMs = cycleBudgetMs;
+	return true;
+}
+
+bool
+multiBusEnableLink(MultiBusPoller &poller, size_t bus, uint8_t slaveId, uint8_t baudCount)
+{
+	if (bus >= kMaxRs485Buses || poller.lanes[bus].transport == nullptr || baudCount == 0) {
+		return false;
+	}
+	BusLane &lane = poller.lanes[bus];
+	lane.link = BusLink{};
+	lane.link.slaveId = slaveId;
+	lane.link.baudCount = baudCount;
+	dropQueue(lane);
+	restartProbing(lane, 0);
+	// The first probe goes out on the first service call, whatever the clock says.
+	lane.link.nextAttemptMs = 0;
+	lane.link.state = BusLinkState::Probing;
+	return true;
+}
+
+bool
+multiBusEnqueue(MultiBusPoller &poller, size_t bus, const BusTxn &txn)
+{
+	if (bus >= kMaxRs485Buses || poller.lanes[bus].transport == nullptr) {
+		return false;
+	}
+	BusLane &lane = poller.lanes[bus];
+	if (linkHandshaking(lane.link)) {
+		return false;
+	}
+	if (lane.count >= kBusQueueDepth) {
+		lane.diag.dropped++;
+		return false;
+	}
+	lane.queue[(lane.head + lane.count) % kBusQueueDepth] = txn;
+	lane.count++;
+	if (lane.count > lane.diag.queueHighWater) {
+		lane.diag.queueHighWater = lane.count;
+	}
+	return true;
+}
+
+void
+multiBusClearQueue(MultiBusPoller &poller, size_t bus)
+{
+	if (bus >= kMaxRs485Buses) {
+		return;
+	}
+	dropQueue(poller.lanes[bus]);
+}
+
+void
+multiBusBeginCycle(MultiBusPoller &poller)
+{
+	for (size_t bus = 0; bus < kMaxRs485Buses; ++bus) {
+		poller.lanes[bus].cycleUsedMs = 0;
+		poller.lanes[bus].cycleDeferred = false;
+	}
+}
+
+size_t
+multiBusService(MultiBusPoller &poller, uint32_t nowMs, BusCompletionFn onComplete, void *ctx)
+{
+	size_t completions = 0;
+	for (size_t bus = 0; bus < kMaxRs485Buses; ++bus) {
+		BusLane &lane = poller.lanes[bus];
+		if (lane.transport == nullptr) {
+			continue;
+		}
+		if (lane.inFlight) {
+			const BusTxnState state = lane.transport->pollTxn(nowMs);
+			if (state == BusTxnState::Pending) {
+				continue;
+			}
+			finishTxn(lane, bus, state == BusTxnState::Ok, nowMs, onComplete, ctx);
+			completions++;
+		}
+
+		// Start the next item straight away so this bus never idles while another one is busy.
+		while (!lane.inFlight && takeNextTxn(lane, nowMs, &lane.current)) {
+			lane.startedMs = nowMs;
+			lane.inFlight = true;
+			lane.diag.started++;
+			if (!lane.transport->beginTxn(lane.current, nowMs)) {
+				finishTxn(lane, bus, false, nowMs, onComplete, ctx);
+				completions++;
+			}
+		}
+	}
+	return completions;
+}
+
+bool
+multiBusIdle(const MultiBusPoller &poller)
+{
+	for (size_t bus = 0; bus < kMaxRs485Buses; ++bus) {
+		if (poller.lanes[bus].inFlight || poller.lanes[bus].count > 0) {
+			return false;
+		}
+	}
+	return true;
+}
+
+size_t
+multiBusPending(const MultiBusPoller &poller, size_t bus)
+{
+	if (bus >= kMaxRs485Buses) {
+		return 0;
+	}
+	const BusLane &lane = poller.lanes[bus];
+	return static_cast<size_t>(lane.count) + (lane.inFlight ? 1u : 0u);
+}
+
+bool
+multiBusLinkOnline(const MultiBusPoller &poller, size_t bus)
+{
+	if (bus >= kMaxRs485Buses || poller.lanes[bus].transport == nullptr) {
+		return false;
+	}
+	const BusLinkState state = poller.lanes[bus].link.state;
+	return state == BusLinkState::Online || state == BusLinkState::Unmanaged;
+}
+
+uint32_t
+multiBusMsUntilWork(const MultiBusPoller &poller, uint32_t nowMs, uint32_t inFlightPollMs, uint32_t noDeadlineMs)
+{
+	uint32_t best = noDeadlineMs;
+	for (size_t bus = 0; bus < kMaxRs485Buses; ++bus) {
+		const BusLane &lane = poller.lanes[bus];
+		if (lane.transport == nullptr) {
+			continue;
+		}
+		uint32_t wait = noDeadlineMs;
+		if (lane.inFlight) {
+			wait = inFlightPollMs;
+		} else if (linkHandshaking(lane.link)) {
+			wait = timeReached(nowMs, lane.link.nextAttemptMs) ? 0 : (lane.link.nextAttemptMs - nowMs);
+		} else if (lane.count > 0 && !budgetSpent(lane)) {
+			wait = 0;
+		}
+		if (wait < best) {
+			best = wait;
+		}
+	}
+	return best;
+}
+
+const char *
+busLinkStateToString(BusLinkState state)
+{
+	switch (state) {
+	case BusLinkState::Probing:
+		return "probing";
+	case BusLinkState::Identifying:
+		return "identifying";
+	case BusLinkState::Online:
+		return "online";
+	case BusLinkState::Unmanaged:
+	default:
+		return "unmanaged";
+	}
+}
+
+bool
+multiBusDiagJson(const MultiBusPoller &poller, size_t bus, char *out, size_t outLen)
+{
+	if (out == nullptr || outLen == 0) {
+		return false;
+	}
+	out[0] = '\0';
+	if (bus >= kMaxRs485Buses) {
+		return false;
+	}
+	const BusLane &lane = poller.lanes[bus];
+	const int written = snprintf(out,
+	                             outLen,
+	                             "{\"link\":\"%s\",\"baud_idx\":%u,\"epoch\":%lu,\"queued\":%u,"
+	                             "\"started\":%lu,\"completed\":%lu,\"failed\":%lu,\"dropped\":%lu,"
+	                             "\"budget_deferrals\":%lu,\"busy_ms\":%lu,\"last_ms\":%lu,\"max_ms\":%lu,"
+	                             "\"link_drops\":%lu,\"queue_hw\":%u}",
+	                             busLinkStateToString(lane.link.state),
+	                             static_cast<unsigned>(lane.link.baudIndex),
+	                             static_cast<unsigned long>(lane.link.epoch),
+	                             static_cast<unsigned>(lane.count),
+	                             static_cast<unsigned long>(lane.diag.started),
+	                             static_cast<unsigned long>(lane.diag.completed),
+	                             static_cast<unsigned long>(lane.diag.failed),
+	                             static_cast<unsigned long>(lane.diag.dropped),
+	                             static_cast<unsigned long>(lane.diag.budgetDeferrals),
+	                             static_cast<unsigned long>(lane.diag.busyMs),
+	                             static_cast<unsigned long>(lane.diag.lastLatencyMs),
+	                             static_cast<unsigned long>(lane.diag.maxLatencyMs),
+	                             static_cast<unsigned long>(lane.diag.linkDrops),
+	                             static_cast<unsigned>(lane.diag.queueHighWater));
+	if (written < 0 || static_cast<size_t>(written) >= outLen) {
+		out[0] = '\0';
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,155 @@
+// Purpose: Step-wise WiFi/MQTT reconnect with exponential backoff and bounded per-step work.
+#include "../include/NetworkReconnect.h"
+
+namespace {
+
+bool
+reached(uint32_t nowMs, uint32_t deadlineMs)
+{
+	return static_cast<int32_t>(nowMs - deadlineMs) >= 0;
+}
+
+} // namespace
+
+ReconnectTiming
+wifiReconnectTiming(void)
+{
+#ifdef A2M_WIFI_RECOVERY_FAST_PROFILE
+	return { 5000U, 500U, 5000U };
+#else
+	return { 20000U, 1000U, 30000U };
+#endif
+}
+
+ReconnectTiming
+mqttReconnectTiming(void)
+{
+	return { 0U, 2000U, 60000U };
+}
+
+uint32_t
+reconnectBackoffMs(const ReconnectTiming &timing, uint16_t failedAttempts)
+{
+	uint32_t delayMs = timing.backoffBaseMs;
+	for (uint16_t i = 0; i < failedAttempts && delayMs < timing.backoffMaxMs; ++i) {
+		delayMs *= 2;
+	}
+	return (delayMs > timing.backoffMaxMs) ? timing.backoffMaxMs : delayMs;
+}
+
+void
+wifiReconnectInit(WifiReconnect &machine, uint32_t nowMs, bool connected)
+{
+	machine.state = connected ? WifiReconnectState::Connected : WifiReconnectState::Backoff;
+	machine.failedAttempts = 0;
+	machine.attemptStartMs = nowMs;
+	machine.nextAttemptMs = nowMs;
+	machine.windowStartMs = nowMs;
+}
+
+WifiReconnectAction
+wifiReconnectStep(WifiReconnect &machine, const WifiReconnectInput &input)
+{
+	const uint32_t nowMs = input.nowMs;
+	if (input.connected) {
+		if (machine.state == WifiReconnectState::Connected) {
+			return WifiReconnectAction::None;
+		}
+		machine.state = WifiReconnectState::Connected;
+		machine.failedAttempts = 0;
+		return WifiReconnectAction::Connected;
+	}
+
+	if (machine.state == WifiReconnectState::Connected) {
+		// The core may reassociate by itself, so the first explicit begin is the next step.
+		machine.state = WifiReconnectState::Backoff;
+		machine.failedAttempts = 0;
+		machine.nextAttemptMs = nowMs;
+		machine.windowStartMs = nowMs;
+		return WifiReconnectAction::Lost;
+	}
+
+	const WifiRecoveryTiming recovery = wifiRecoveryTiming();
+	if (nowMs - machine.windowStartMs >= recovery.runtimeValidationMs) {
+		machine.windowStartMs = nowMs;
+		if (shouldRebootApOnRuntimeWifiFailure(input.bootMode, input.hasStoredCredentials, input.failureClass)) {
+			return WifiReconnectAction::RebootApConfig;
+		}
+		return WifiReconnectAction::RestartWindow;
+	}
+
+	const ReconnectTiming timing = wifiReconnectTiming();
+	switch (machine.state) {
+	case WifiReconnectState::Connecting:
+		if (nowMs - machine.attemptStartMs >= timing.attemptTimeoutMs) {
+			machine.state = WifiReconnectState::Backoff;
+			machine.nextAttemptMs = nowMs + reconnectBackoffMs(timing, machine.failedAttempts);
+			if (machine.failedAttempts < UINT16_MAX) {
+				machine.failedAttempts++;
+			}
+		}
+		return WifiReconnectAction::None;
+	case WifiReconnectState::Backoff:
+		if (!reached(nowMs, machine.nextAttemptMs)) {
+			return WifiReconnectAction::None;
+		}
+		machine.state = WifiReconnectState::Connecting;
+		machine.attemptStartMs = nowMs;
+		return WifiReconnectAction::Begin;
+	case WifiReconnectState::Connected:
+	default:
+		return WifiReconnectAction::None;
+	}
+}
+
+void
+mqttReconnectInit(MqttReconnect &machine, uint32_t nowMs)
+{
+	machine.state = MqttReconnectState::Backoff;
+	machine.failedAttempts = 0;
+	machine.nextAttemptMs = nowMs;
+}
+
+MqttReconnectAction
+mqttReconnectStep(MqttReconnect &machine, uint32_t nowMs, bool wifiConnected, bool mqttConnected)
+{
+	if (mqttConnected) {
+		machine.state = MqttReconnectState::Connected;
+		machine.failedAttempts = 0;
+		return MqttReconnectAction::None;
+	}
+	if (machine.state == MqttReconnectState::Connected) {
+		machine.state = wifiConnected ? MqttReconnectState::Backoff : MqttReconnectState::WaitWifi;
+		machine.failedAttempts = 0;
+		machine.nextAttemptMs = nowMs + kMqttReconnectSettleMs;
+		return MqttReconnectAction::Lost;
+	}
+	if (!wifiConnected) {
+		machine.state = MqttReconnectState::WaitWifi;
+		return MqttReconnectAction::None;
+	}
+	if (machine.state == MqttReconnectState::WaitWifi) {
+		// WiFi just came back; the pending deadline (possibly already past) still applies.
+		machine.state = MqttReconnectState::Backoff;
+	}
+	if (machine.state != MqttReconnectState::Backoff || !reached(nowMs, machine.nextAttemptMs)) {
+		return MqttReconnectAction::None;
+	}
+	machine.state = MqttReconnectState::Connecting;
+	return MqttReconnectAction::Connect;
+}
+
+void
+mqttReconnectNoteResult(MqttReconnect &machine, uint32_t nowMs, bool connected)
+{
+	if (connected) {
+		machine.state = MqttReconnectState::Connected;
+		machine.failedAttempts = 0;
+		return;
+	}
+	machine.state = MqttReconnectState::Backoff;
+	machine.nextAttemptMs = nowMs + reconnectBackoffMs(mqttReconnectTiming(), machine.failedAttempts);
+	if (machine.failedAttempts < UINT16_MAX) {
+		machine.failedAttempts++;
+	}
+}
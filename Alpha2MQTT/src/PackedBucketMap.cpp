@@ -0,0 +1,71 @@
+// Purpose: Three-bit packed per-entity bucket storage.
+#include "../include/PackedBucketMap.h"
+
+namespace {
+
+constexpr unsigned kPackedBucketMask = (1u << kPackedBucketBits) - 1u;
+
+} // namespace
+
+BucketId
+packedBucketGet(const uint8_t *map, size_t idx)
+{
+	const size_t bit = idx * kPackedBucketBits;
+	const size_t byte = bit / 8;
+	const unsigned shift = static_cast<unsigned>(bit % 8);
+	unsigned window = map[byte];
+	// A field starting in the top bits of a byte spills into the next one.
+	if (shift + kPackedBucketBits > 8) {
+		window |= static_cast<unsigned>(map[byte + 1]) << 8;
+	}
+	return static_cast<BucketId>((window >> shift) & kPackedBucketMask);
+}
+
+void
+packedBucketSet(uint8_t *map, size_t idx, BucketId bucket)
+{
+	const size_t bit = idx * kPackedBucketBits;
+	const size_t byte = bit / 8;
+	const unsigned shift = static_cast<unsigned>(bit % 8);
+	const unsigned value = static_cast<unsigned>(bucket) & kPackedBucketMask;
+	map[byte] = static_cast<uint8_t>((map[byte] & ~(kPackedBucketMask << shift)) | (value << shift));
+	if (shift + kPackedBucketBits > 8) {
+		const unsigned spill = 8 - shift;
+		map[byte + 1] = static_cast<uint8_t>((map[byte + 1] & ~(kPackedBucketMask >> spill)) | (value >> spill));
+	}
+}
+
+void
+packedBucketFill(uint8_t *map, size_t entityCount, BucketId bucket)
+{
+	for (size_t idx = 0; idx < entityCount; ++idx) {
+		packedBucketSet(map, idx, bucket);
+	}
+}
+
+void
+packedBucketPack(uint8_t *map, const BucketId *buckets, size_t entityCount)
+{
+	for (size_t idx = 0; idx < entityCount; ++idx) {
+		packedBucketSet(map, idx, buckets[idx]);
+	}
+}
+
+bool
+packedBucketMatches(const uint8_t *map, const BucketId *buckets, size_t entityCount)
+{
+	for (size_t idx = 0; idx < entityCount; ++idx) {
+		if (packedBucketGet(map, idx) != buckets[idx]) {
+			return false;
+		}
+	}
+	return true;
+}
+
+void
+packedBucketUnpack(const uint8_t *map, BucketId *buckets, size_t entityCount)
+{
+	for (size_t idx = 0; idx < entityCount; ++idx) {
+		buckets[idx] = packedBucketGet(map, idx);
+	}
+}
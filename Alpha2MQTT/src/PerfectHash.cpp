@@ -0,0 +1,35 @@
+// Purpose: Runtime side of the compile-time perfect hash tables.
+#include "../include/PerfectHash.h"
+
+#if defined(ESP8266) || defined(ARDUINO_ARCH_ESP8266)
+#include <pgmspace.h>
+#endif
+
+namespace {
+
+uint16_t
+readTableWord(const uint16_t *word)
+{
+#if defined(ESP8266) || defined(ARDUINO_ARCH_ESP8266)
+	return pgm_read_word(word);
+#else
+	return *word;
+#endif
+}
+
+} // namespace
+
+uint32_t
+perfectHashCandidate(const uint16_t *seeds,
+                     const uint16_t *keys,
+                     size_t keyCount,
+                     const char *text,
+                     size_t len)
+{
+	if (seeds == nullptr || keys == nullptr || keyCount == 0 || text == nullptr) {
+		return kPerfectHashNoKey;
+	}
+	const uint32_t hash = perfectHashString(text, len);
+	const uint16_t seed = readTableWord(&seeds[hash % perfectHashBucketCount(keyCount)]);
+	return readTableWord(&keys[perfectHashSlot(hash, seed, keyCount)]);
+}
@@ -0,0 +1,281 @@
+// Purpose: Linear-time poll plan construction over a catalog view.
+#include "../include/PollPlanBuilder.h"
+
+#include "../include/PackedBucketMap.h"
+
+#include <new>
+
+namespace {
+
+// Poll buckets in MqttEntityActivePlan field order; BucketId values 0..5 map onto them.
+constexpr size_t kPlanBucketCount = 6;
+constexpr uint16_t kNoTransaction = UINT16_MAX;
+
+MqttEntityActiveBucket *
+planBucket(MqttEntityActivePlan &plan, BucketId bucketId)
+{
+	switch (bucketId) {
+	case BucketId::TenSec:
+		return &plan.tenSec;
+	case BucketId::OneMin:
+		return &plan.oneMin;
+	case BucketId::FiveMin:
+		return &plan.fiveMin;
+	case BucketId::OneHour:
+		return &plan.oneHour;
+	case BucketId::OneDay:
+		return &plan.oneDay;
+	case BucketId::User:
+		return &plan.user;
+	case BucketId::Disabled:
+	case BucketId::Unknown:
+	default:
+		return nullptr;
+	}
+}
+
+size_t
+alignPlanOffset(size_t offset, size_t alignment)
+{
+	return (offset + alignment - 1) / alignment * alignment;
+}
+
+BucketId
+resolveBucket(const PollPlanCatalog &catalog, PollPlanOverrideFn overrideFor, const void *overrideCtx, size_t idx)
+{
+	const BucketId override = overrideFor(overrideCtx, idx);
+	return (override != BucketId::Unknown) ? override : catalog.defaultBucket(catalog.ctx, idx);
+}
+
+void
+clearGroups(uint16_t *groups, size_t count, uint16_t value)
+{
+	for (size_t g = 0; g < count; ++g) {
+		groups[g] = value;
+	}
+}
+
+/*
+ * countPlan
+ *
+ * First walk: bucket sizes, override count and transaction counts. groupScratch temporarily holds a
+ * bitmask of the buckets each register read group already has a transaction in.
+ */
+bool
+countPlan(const PollPlanCatalog &catalog,
+          PollPlanOverrideFn overrideFor,
+          const void *overrideCtx,
+          uint16_t *groupScratch,
+          PollPlanStorage &out,
+          size_t *txnCounts)
+{
+	static_assert(kPlanBucketCount <= 16, "bucket masks must fit the group scratch entries");
+	clearGroups(groupScratch, catalog.readGroupCount, 0);
+	uint16_t snapshotSeen = 0;
+	for (size_t idx = 0; idx < catalog.entityCount; ++idx) {
+		const BucketId override = overrideFor(overrideCtx, idx);
+		const BucketId bucketId = (override != BucketId::Unknown) ? override : catalog.defaultBucket(catalog.ctx, idx);
+		if (bucketId == BucketId::Unknown) {
+			return false;
+		}
+		if (override != BucketId::Unknown) {
+			out.overrideCount++;
+		}
+		MqttEntityActiveBucket *bucket = planBucket(out.plan, bucketId);
+		if (bucket == nullptr) {
+			continue;
+		}
+		bucket->count++;
+		out.plan.activeCount++;
+		const size_t b = static_cast<size_t>(bucketId);
+		const uint16_t bit = static_cast<uint16_t>(1u << b);
+		switch (catalog.kind(catalog.ctx, idx)) {
+		case MqttPollTransactionKind::SnapshotFanout:
+			if ((snapshotSeen & bit) == 0) {
+				snapshotSeen = static_cast<uint16_t>(snapshotSeen | bit);
+				txnCounts[b]++;
+			}
+			break;
+		case MqttPollTransactionKind::RegisterFanout: {
+			const uint16_t group = catalog.readGroup(catalog.ctx, idx);
+			if (group >= catalog.readGroupCount) {
+				return false;
+			}
+			if ((groupScratch[group] & bit) == 0) {
+				groupScratch[group] = static_cast<uint16_t>(groupScratch[group] | bit);
+				txnCounts[b]++;
+			}
+			break;
+		}
+		case MqttPollTransactionKind::SingleEntity:
+		default:
+			txnCounts[b]++;
+			break;
+		}
+	}
+	return true;
+}
+
+/*
+ * fillBucket
+ *
+ * Two walks per bucket. The first opens transactions in first-member order and counts their
+ * members, leaving each read group's transaction in groupScratch. The second replays the same
+ * sequence to place members; a transaction is recognised as new when its index equals the
+ * number opened so far, so singles need no per-entity scratch.
+ */
+bool
+fillBucket(const PollPlanCatalog &catalog,
+           PollPlanOverrideFn overrideFor,
+           const void *overrideCtx,
+           BucketId bucketId,
+           size_t txnCapacity,
+           uint16_t *groupScratch,
+           MqttEntityActiveBucket &bucket)
+{
+	clearGroups(groupScratch, catalog.readGroupCount, kNoTransaction);
+	uint16_t snapshotTxn = kNoTransaction;
+	size_t txnCount = 0;
+	for (size_t idx = 0; idx < catalog.entityCount; ++idx) {
+		if (resolveBucket(catalog, overrideFor, overrideCtx, idx) != bucketId) {
+			continue;
+		}
+		const MqttPollTransactionKind kind = catalog.kind(catalog.ctx, idx);
+		uint16_t *slot = nullptr;
+		if (kind == MqttPollTransactionKind::SnapshotFanout) {
+			slot = &snapshotTxn;
+		} else if (kind == MqttPollTransactionKind::RegisterFanout) {
+			slot = &groupScratch[catalog.readGroup(catalog.ctx, idx)];
+		}
+		size_t txnIndex = (slot != nullptr) ? *slot : kNoTransaction;
+		if (txnIndex == kNoTransaction) {
+			if (txnCount == txnCapacity) {
+				return false;
+			}
+			txnIndex = txnCount++;
+			MqttPollTransaction &txn = bucket.transactions[txnIndex];
+			txn.firstMemberOffset = 0;
+			txn.entityCount = 0;
+			txn.readKey = catalog.readKey(catalog.ctx, idx);
+			txn.kind = kind;
+			if (slot != nullptr) {
+				*slot = static_cast<uint16_t>(txnIndex);
+			}
+		}
+		bucket.transactions[txnIndex].entityCount++;
+	}
+	if (txnCount != txnCapacity) {
+		return false;
+	}
+
+	size_t nextOffset = 0;
+	for (size_t i = 0; i < txnCount; ++i) {
+		bucket.transactions[i].firstMemberOffset = static_cast<uint16_t>(nextOffset);
+		nextOffset += bucket.transactions[i].entityCount;
+	}
+	if (nextOffset != bucket.count) {
+		return false;
+	}
+
+	// firstMemberOffset doubles as the fill cursor and is wound back afterwards.
+	size_t opened = 0;
+	for (size_t idx = 0; idx < catalog.entityCount; ++idx) {
+		if (resolveBucket(catalog, overrideFor, overrideCtx, idx) != bucketId) {
+			continue;
+		}
+		const MqttPollTransactionKind kind = catalog.kind(catalog.ctx, idx);
+		size_t txnIndex = opened;
+		if (kind == MqttPollTransactionKind::SnapshotFanout) {
+			txnIndex = snapshotTxn;
+		} else if (kind == MqttPollTransactionKind::RegisterFanout) {
+			txnIndex = groupScratch[catalog.readGroup(catalog.ctx, idx)];
+		}
+		if (txnIndex == opened) {
+			opened++;
+		}
+		MqttPollTransaction &txn = bucket.transactions[txnIndex];
+		bucket.members[txn.firstMemberOffset++] = static_cast<uint16_t>(idx);
+	}
+	for (size_t i = 0; i < txnCount; ++i) {
+		MqttPollTransaction &txn = bucket.transactions[i];
+		txn.firstMemberOffset = static_cast<uint16_t>(txn.firstMemberOffset - txn.entityCount);
+		if (txn.kind == MqttPollTransactionKind::SnapshotFanout) {
+			bucket.hasEssSnapshot = true;
+		}
+	}
+	bucket.transactionCount = txnCount;
+	return true;
+}
+
+} // namespace
+
+bool
+pollPlanBuild(const PollPlanCatalog &catalog,
+              PollPlanOverrideFn overrideFor,
+              const void *overrideCtx,
+              uint16_t *groupScratch,
+              PollPlanStorage &out)
+{
+	out = PollPlanStorage{};
+	// Members and member offsets are 16-bit entity indexes.
+	if (catalog.entityCount > UINT16_MAX || catalog.defaultBucket == nullptr || catalog.kind == nullptr ||
+	    catalog.readKey == nullptr || catalog.readGroup == nullptr || overrideFor == nullptr ||
+	    (catalog.readGroupCount > 0 && groupScratch == nullptr)) {
+		return false;
+	}
+	size_t txnCounts[kPlanBucketCount] = {};
+	if (!countPlan(catalog, overrideFor, overrideCtx, groupScratch, out, txnCounts)) {
+		out = PollPlanStorage{};
+		return false;
+	}
+
+	const size_t overrideMapBytes = (out.overrideCount > 0) ? packedBucketMapBytes(catalog.entityCount) : 0;
+	size_t txnOffsets[kPlanBucketCount] = {};
+	size_t memberOffsets[kPlanBucketCount] = {};
+	size_t bytes = overrideMapBytes;
+	for (size_t b = 0; b < kPlanBucketCount; ++b) {
+		bytes = alignPlanOffset(bytes, alignof(MqttPollTransaction));
+		txnOffsets[b] = bytes;
+		bytes += txnCounts[b] * sizeof(MqttPollTransaction);
+	}
+	for (size_t b = 0; b < kPlanBucketCount; ++b) {
+		bytes = alignPlanOffset(bytes, alignof(uint16_t));
+		memberOffsets[b] = bytes;
+		bytes += planBucket(out.plan, static_cast<BucketId>(b))->count * sizeof(uint16_t);
+	}
+	if (bytes > 0) {
+		out.arena = new (std::nothrow) uint8_t[bytes];
+		if (out.arena == nullptr) {
+			out = PollPlanStorage{};
+			return false;
+		}
+	}
+	out.arenaBytes = bytes;
+
+	if (overrideMapBytes > 0) {
+		out.overrideMap = out.arena;
+		for (size_t idx = 0; idx < catalog.entityCount; ++idx) {
+			packedBucketSet(out.overrideMap, idx, overrideFor(overrideCtx, idx));
+		}
+	}
+	for (size_t b = 0; b < kPlanBucketCount; ++b) {
+		MqttEntityActiveBucket &bucket = *planBucket(out.plan, static_cast<BucketId>(b));
+		if (bucket.count == 0) {
+			continue;
+		}
+		bucket.transactions = reinterpret_cast<MqttPollTransaction *>(out.arena + txnOffsets[b]);
+		bucket.members = reinterpret_cast<uint16_t *>(out.arena + memberOffsets[b]);
+		if (!fillBucket(catalog, overrideFor, overrideCtx, static_cast<BucketId>(b), txnCounts[b], groupScratch, bucket)) {
+			pollPlanRelease(out);
+			return false;
+		}
+	}
+	return true;
+}
+
+void
+pollPlanRelease(PollPlanStorage &storage)
+{
+	delete[] storage.arena;
+	storage = PollPlanStorage{};
+}
@@ -121,6 +121,11 @@ lookupEntityByName(const char *name, const mqttState *entities, size_t entityCou
 	if (name == nullptr || entities == nullptr) {
 		return nullptr;
 	}
+	// Callers normally pass the catalog itself, where the catalog index is the array index.
+	size_t idx = 0;
+	if (mqttEntityIndexByName(name, &idx) && idx < entityCount && mqttEntityNameEquals(&entities[idx], name)) {
+		return &entities[idx];
+	}
 	for (size_t i = 0; i < entityCount; i++) {
 		if (mqttEntityNameEquals(&entities[i], name)) {
 			return &entities[i];
@@ -865,6 +870,63 @@ resolveLegacyEntityToken(const char *token,
 	return false;
 }
 
+bool
+nextBucketMapEntry(const char *&cursor,
+                   char *token,
+                   size_t tokenSize,
+                   char *bucket,
+                   size_t bucketSize,
+                   bool &malformed)
+{
+	malformed = false;
+	if (cursor == nullptr || token == nullptr || bucket == nullptr || tokenSize == 0 || bucketSize == 0) {
+		malformed = true;
+		return false;
+	}
+	while (*cursor && (*cursor == ';' || isspace(static_cast<unsigned char>(*cursor)))) {
+		cursor++;
+	}
+	if (!*cursor) {
+		return false;
+	}
+
+	size_t tokenIdx = 0;
+	size_t bucketIdx = 0;
+	while (*cursor && *cursor != '=' && *cursor != ';' && tokenIdx < tokenSize - 1) {
+		token[tokenIdx++] = *cursor++;
+	}
+	token[tokenIdx] = '\0';
+
+	if (*cursor != '=') {
+		malformed = true;
+		return false;
+	}
+	cursor++;
+
+	while (*cursor && *cursor != ';' && bucketIdx < bucketSize - 1) {
+		bucket[bucketIdx++] = *cursor++;
+	}
+	bucket[bucketIdx] = '\0';
+
+	if (token[0] == '\0' || bucket[0] == '\0') {
+		malformed = true;
+		return false;
+	}
+	return true;
+}
+
+bool
+bucketMapWellFormed(const char *map)
+{
+	const char *cursor = map;
+	char token[64];
+	char bucket[32];
+	bool malformed = false;
+	while (nextBucketMapEntry(cursor, token, sizeof(token), bucket, sizeof(bucket), malformed)) {
+	}
+	return !malformed;
+}
+
 static bool
 applyBucketMapStringWithResolver(const char *map,
                                  const mqttState *entities,
@@ -889,44 +951,16 @@ applyBucketMapStringWithResolver(const char *map,
 		return true;
 	}
 
-	BucketId staged[kMqttEntityDescriptorCount];
-	memcpy(staged, buckets, entityCount * sizeof(BucketId));
+	if (!bucketMapWellFormed(map)) {
+		return false;
+	}
 
-	uint8_t seen[kMqttEntityDescriptorCount];
-	memset(seen, 0, sizeof(seen));
+	uint8_t seen[entityBitsetBytes(kMqttEntityDescriptorCount)] = {};
 	const char *cursor = map;
-	while (*cursor) {
-		while (*cursor && (*cursor == ';' || isspace(static_cast<unsigned char>(*cursor)))) {
-			cursor++;
-		}
-		if (!*cursor) {
-			break;
-		}
-
-		char token[64] = {0};
-		char bucket[32] = {0};
-		size_t tokenIdx = 0;
-		size_t bucketIdx = 0;
-
-		while (*cursor && *cursor != '=' && *cursor != ';' && tokenIdx < sizeof(token) - 1) {
-			token[tokenIdx++] = *cursor++;
-		}
-		token[tokenIdx] = '\0';
-
-		if (*cursor != '=') {
-			return false;
-		}
-		cursor++;
-
-		while (*cursor && *cursor != ';' && bucketIdx < sizeof(bucket) - 1) {
-			bucket[bucketIdx++] = *cursor++;
-		}
-		bucket[bucketIdx] = '\0';
-
-		if (token[0] == '\0' || bucket[0] == '\0') {
-			return false;
-		}
-
+	char token[64];
+	char bucket[32];
+	bool malformed = false;
+	while (nextBucketMapEntry(cursor, token, sizeof(token), bucket, sizeof(bucket), malformed)) {
 		size_t idx = 0;
 		if (!resolver(token, entities, entityCount, idx)) {
 			unknownEntityCount++;
@@ -935,16 +969,14 @@ applyBucketMapStringWithResolver(const char *map,
 			if (bucketId == BucketId::Unknown) {
 				invalidBucketCount++;
 			} else {
-				if (seen[idx]) {
+				if (entityBitsetTest(seen, idx)) {
 					duplicateEntityCount++;
 				}
-				staged[idx] = bucketId;
-				seen[idx] = 1;
+				buckets[idx] = bucketId;
+				entityBitsetSet(seen, idx);
 			}
 		}
 	}
-
-	memcpy(buckets, staged, entityCount * sizeof(BucketId));
 	return true;
 }
 
@@ -0,0 +1,126 @@
+// Purpose: Encode, verify and decode the binary polling-config record.
+#include "../include/PollingConfigRecord.h"
+
+#include <cstring>
+
+#include "../include/Crc32.h"
+
+namespace {
+
+constexpr uint8_t kRecordMagic0 = 'P';
+constexpr uint8_t kRecordMagic1 = 'C';
+constexpr size_t kOffsetVersion = 2;
+constexpr size_t kOffsetBits = 3;
+constexpr size_t kOffsetCount = 4;
+constexpr size_t kOffsetFingerprint = 6;
+constexpr size_t kOffsetMapSize = 10;
+
+void
+putU16(uint8_t *out, uint16_t value)
+{
+	out[0] = static_cast<uint8_t>(value);
+	out[1] = static_cast<uint8_t>(value >> 8);
+}
+
+void
+putU32(uint8_t *out, uint32_t value)
+{
+	for (size_t i = 0; i < 4; ++i) {
+		out[i] = static_cast<uint8_t>(value >> (8 * i));
+	}
+}
+
+uint16_t
+getU16(const uint8_t *in)
+{
+	return static_cast<uint16_t>(in[0] | (in[1] << 8));
+}
+
+uint32_t
+getU32(const uint8_t *in)
+{
+	uint32_t value = 0;
+	for (size_t i = 0; i < 4; ++i) {
+		value |= static_cast<uint32_t>(in[i]) << (8 * i);
+	}
+	return value;
+}
+
+} // namespace
+
+size_t
+pollingConfigRecordEncode(const BucketId *buckets,
+                          size_t entityCount,
+                          uint32_t catalogFingerprint,
+                          size_t mapSize,
+                          uint8_t *out,
+                          size_t outSize)
+{
+	if (buckets == nullptr || out == nullptr || entityCount == 0 || entityCount > UINT16_MAX || mapSize > UINT16_MAX) {
+		return 0;
+	}
+	const size_t recordLen = pollingConfigRecordBytes(entityCount);
+	if (outSize < recordLen) {
+		return 0;
+	}
+	for (size_t i = 0; i < entityCount; ++i) {
+		if (buckets[i] == BucketId::Unknown) {
+			return 0;
+		}
+	}
+
+	memset(out, 0, recordLen);
+	out[0] = kRecordMagic0;
+	out[1] = kRecordMagic1;
+	out[kOffsetVersion] = kPollingConfigRecordVersion;
+	out[kOffsetBits] = static_cast<uint8_t>(kPackedBucketBits);
+	putU16(out + kOffsetCount, static_cast<uint16_t>(entityCount));
+	putU32(out + kOffsetFingerprint, catalogFingerprint);
+	putU16(out + kOffsetMapSize, static_cast<uint16_t>(mapSize));
+	packedBucketPack(out + kPollingConfigRecordHeaderBytes, buckets, entityCount);
+	const size_t crcOffset = recordLen - kPollingConfigRecordCrcBytes;
+	putU32(out + crcOffset, crc32Ieee(out, crcOffset));
+	return recordLen;
+}
+
+PollingConfigRecordStatus
+pollingConfigRecordDecode(const uint8_t *record,
+                          size_t len,
+                          size_t entityCount,
+                          PollingConfigFingerprintFn fingerprint,
+                          size_t mapSize,
+                          BucketId *buckets)
+{
+	if (record == nullptr || buckets == nullptr || fingerprint == nullptr || entityCount == 0) {
+		return PollingConfigRecordStatus::Corrupt;
+	}
+	if (len < kPollingConfigRecordHeaderBytes + kPollingConfigRecordCrcBytes || record[0] != kRecordMagic0 ||
+	    record[1] != kRecordMagic1) {
+		return PollingConfigRecordStatus::Corrupt;
+	}
+	const size_t crcOffset = len - kPollingConfigRecordCrcBytes;
+	if (crc32Ieee(record, crcOffset) != getU32(record + crcOffset)) {
+		return PollingConfigRecordStatus::Corrupt;
+	}
+	// Past the CRC the bytes are what some writer meant; anything unexpected is a format or
+	// catalog this firmware does not share rather than damage.
+	if (record[kOffsetVersion] != kPollingConfigRecordVersion || record[kOffsetBits] != kPackedBucketBits) {
+		return PollingConfigRecordStatus::Stale;
+	}
+	const size_t recordCount = getU16(record + kOffsetCount);
+	if (recordCount == 0 || len != pollingConfigRecordBytes(recordCount)) {
+		return PollingConfigRecordStatus::Corrupt;
+	}
+	if (recordCount > entityCount || getU16(record + kOffsetMapSize) != mapSize ||
+	    getU32(record + kOffsetFingerprint) != fingerprint(recordCount)) {
+		return PollingConfigRecordStatus::Stale;
+	}
+	const uint8_t *codes = record + kPollingConfigRecordHeaderBytes;
+	for (size_t i = 0; i < recordCount; ++i) {
+		if (packedBucketGet(codes, i) == BucketId::Unknown) {
+			return PollingConfigRecordStatus::Corrupt;
+		}
+	}
+	packedBucketUnpack(codes, buckets, recordCount);
+	return (recordCount == entityCount) ? PollingConfigRecordStatus::Ok : PollingConfigRecordStatus::Grown;
+}
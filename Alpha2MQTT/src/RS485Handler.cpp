@@ -43,7 +43,7 @@ Initialisations and what not
 RS485Handler::RS485Handler()
 {
 	// Configure the pin for controlling TX/RX (if using MAX485 with DE/RE pins)
-	pinMode(SERIAL_COMMUNICATION_CONTROL_PIN, OUTPUT);
+	pinMode(_controlPin, OUTPUT);
 
 	// Set pin 'LOW' for 'Receive' mode
 	//digitalWrite(SERIAL_COMMUNICATION_CONTROL_PIN, RS485_RX);
@@ -52,14 +52,32 @@ RS485Handler::RS485Handler()
 	_RS485Serial = new SoftwareSerial(RX_PIN, TX_PIN);
 	_RS485Serial->begin(DEFAULT_BAUD_RATE, SWSERIAL_8N1);
 #elif defined MP_ESP32
-	_RS485Serial = new HardwareSerial(HW_UART_NUM);
-	_RS485Serial->begin(DEFAULT_BAUD_RATE, SERIAL_8N1, RX_PIN, TX_PIN);
+	_RS485Serial = new HardwareSerial(_uartNum);
+	_RS485Serial->begin(DEFAULT_BAUD_RATE, SERIAL_8N1, _rxPin, _txPin);
 #endif
 	baudRate = DEFAULT_BAUD_RATE;
 	
 	_rs485IsOnline = false;
 }
 
+#if defined MP_ESP32
+/*
+Port constructor
+
+Additional buses on spare hardware UARTs. Each instance owns its UART and DE/RE pin,
+so transactions on different instances never contend for the same wire.
+*/
+RS485Handler::RS485Handler(const Rs485PortConfig &port)
+	: _controlPin(port.controlPin), _uartNum(port.uartNum), _rxPin(port.rxPin), _txPin(port.txPin)
+{
+	pinMode(_controlPin, OUTPUT);
+	_RS485Serial = new HardwareSerial(_uartNum);
+	_RS485Serial->begin(DEFAULT_BAUD_RATE, SERIAL_8N1, _rxPin, _txPin);
+	baudRate = DEFAULT_BAUD_RATE;
+	_rs485IsOnline = false;
+}
+#endif
+
 /*
 Default Destructor
 
@@ -78,6 +96,24 @@ RS485Handler::setServiceHook(void (*hook)())
 	_serviceHook = hook;
 }
 
+/*
+runServiceHook
+
+The hook pumps MQTT/HTTP and must only ever run on the loop() task.
+*/
+void
+RS485Handler::runServiceHook()
+{
+#if RS485_WORKER_ENABLED
+	if (onWorkerTask()) {
+		return;
+	}
+#endif
+	if (_serviceHook != nullptr) {
+		_serviceHook();
+	}
+}
+
 
 /*
  * uartInfo()
@@ -93,8 +129,12 @@ RS485Handler::uartInfo(void)
 	snprintf(uartInfoString, sizeof(uartInfoString), "SW %s/%s/%s",
 		 TO_STRING(RX_PIN), TO_STRING(TX_PIN), TO_STRING(SERIAL_COMMUNICATION_CONTROL_PIN));
 #elif defined MP_ESP32
-	snprintf(uartInfoString, sizeof(uartInfoString), "HW:%s %s/%s/%s", _RS485Serial ? TO_STRING(HW_UART_NUM) : "err",
-		 TO_STRING(RX_PIN), TO_STRING(TX_PIN), TO_STRING(SERIAL_COMMUNICATION_CONTROL_PIN));
+	if (_RS485Serial == NULL) {
+		snprintf(uartInfoString, sizeof(uartInfoString), "HW:err %d/%d/%d", _rxPin, _txPin, _controlPin);
+	} else {
+		snprintf(uartInfoString, sizeof(uartInfoString), "HW:%u %d/%d/%d",
+			 static_cast<unsigned>(_uartNum), _rxPin, _txPin, _controlPin);
+	}
 #endif
 
 	return &uartInfoString[0];
@@ -110,6 +150,10 @@ void RS485Handler::setBaudRate(unsigned long baudRate)
 	if (this->baudRate == baudRate) {
 		return;
 	}
+#if RS485_WORKER_ENABLED
+	// The worker owns the UART while a request is out; let it finish first.
+	drainWorker();
+#endif
 	_RS485Serial->flush();
 #if defined MP_ESP8266
 	// SoftwareSerial allocates RX/TX state in begin(); end() releases it. Re-probing baud
@@ -176,18 +220,246 @@ modbusRequestAndResponseStatusValues RS485Handler::sendModbus(uint8_t frame[], b
 		return modbusRequestAndResponseStatusValues::invalidFrame;
 	}
 
+	struct TxnGuard {
+		bool &flag;
+		explicit TxnGuard(bool &f) : flag(f) { flag = true; }
+		~TxnGuard() { flag = false; }
+	} txnGuard(_inTransaction);
+#if RS485_WORKER_ENABLED
+	if (_workerTask != nullptr && !onWorkerTask()) {
+		if (_replay.inScope()) {
+			return sendModbusDeferred(frame, actualFrameSize, resp);
+		}
+		return sendModbusViaWorker(frame, actualFrameSize, resp);
+	}
+#endif
+	Rs485TransactionDiag diag;
+	const modbusRequestAndResponseStatusValues result = sendModbusOnBus(frame, actualFrameSize, resp, diag);
+	noteTransaction(diag);
+	return result;
+}
+
+/*
+noteTransaction
+
+Records the outcome of a finished transaction. Only ever called on the loop() task.
+*/
+void RS485Handler::noteTransaction(const Rs485TransactionDiag &diag)
+{
+	_lastTransactionDiag = diag;
+	_rs485IsOnline = (diag.result == modbusRequestAndResponseStatusValues::writeDataRegisterSuccess ||
+			  diag.result == modbusRequestAndResponseStatusValues::writeSingleRegisterSuccess ||
+			  diag.result == modbusRequestAndResponseStatusValues::readDataRegisterSuccess);
+}
+
+void RS485Handler::beginDeferredScope()
+{
+#if RS485_WORKER_ENABLED
+	if (_workerTask != nullptr) {
+		_replay.beginScope();
+	}
+#endif
+}
+
+bool RS485Handler::endDeferredScope()
+{
+#if RS485_WORKER_ENABLED
+	if (_replay.inScope()) {
+		return _replay.endScope();
+	}
+#endif
+	return false;
+}
+
+bool RS485Handler::deferredReplyOutstanding() const
+{
+#if RS485_WORKER_ENABLED
+	return _replay.awaiting() && !_worker.resultWaiting();
+#else
+	return false;
+#endif
+}
+
+void RS485Handler::abandonDeferred()
+{
+#if RS485_WORKER_ENABLED
+	_replay.abandon();
+#endif
+}
+
+#if RS485_WORKER_ENABLED
+/*
+startWorkerTask
+
+Moves all further bus I/O onto a task pinned to RS485_WORKER_CORE.
+*/
+bool RS485Handler::startWorkerTask()
+{
+	if (_workerTask != nullptr) {
+		return true;
+	}
+	TaskHandle_t handle = nullptr;
+	if (xTaskCreatePinnedToCore(workerTaskMain, "rs485", RS485_WORKER_STACK, this, 1, &handle, RS485_WORKER_CORE) != pdPASS) {
+		return false;
+	}
+	_workerTask = handle;
+	return true;
+}
+
+void RS485Handler::workerTaskMain(void *arg)
+{
+	RS485Handler *self = static_cast<RS485Handler *>(arg);
+	decltype(self->_worker)::Request job;
+	for (;;) {
+		if (!self->_worker.take(job)) {
+			// Woken by the submitter; the timeout only bounds a missed notification.
+			ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(20));
+			continue;
+		}
+		Rs485WorkerReply reply;
+		self->_workerResp = modbusRequestAndResponse{};
+		reply.result = self->sendModbusOnBus(job.payload.frame, job.payload.frameSize, &self->_workerResp, reply.diag);
+		rs485ReplyFromResponse(self->_workerResp, reply);
+		// Owner never has more than the ring depth outstanding, so this cannot fail.
+		self->_worker.complete(job.seq, reply);
+	}
+}
+
+/*
+submitToWorker
+
+Queues a copy of the frame for the worker. Fails only while the ring is full.
+*/
+bool RS485Handler::submitToWorker(uint8_t frame[], byte actualFrameSize, uint32_t *seqOut)
+{
+	WorkerJob job;
+	memcpy(job.frame, frame, actualFrameSize);
+	job.frameSize = actualFrameSize;
+	if (!_worker.submit(job, seqOut)) {
+		return false;
+	}
+	xTaskNotifyGive(_workerTask);
+	return true;
+}
+
+/*
+collectWorkerReplies
+
+Drains the result ring. The reply for waitSeq (if any) is copied to *waited, the reply to
+the deferred request is kept for replay, and anything else belongs to an abandoned request.
+*/
+bool RS485Handler::collectWorkerReplies(uint32_t waitSeq, Rs485WorkerReply *waited)
+{
+	bool found = false;
+	decltype(_worker)::Result done;
+	while (_worker.collect(done)) {
+		if (waitSeq != 0 && done.seq == waitSeq) {
+			if (waited != nullptr) {
+				*waited = done.outcome;
+			}
+			found = true;
+			continue;
+		}
+		_replay.collected(done.seq, done.outcome);
+	}
+	return found;
+}
+
+void RS485Handler::drainWorker()
+{
+	while (_worker.outstanding() > 0) {
+		collectWorkerReplies(0, nullptr);
+		diagDelay(1);
+	}
+}
+
+modbusRequestAndResponseStatusValues RS485Handler::deliverReply(const Rs485WorkerReply &reply, modbusRequestAndResponse* resp)
+{
+	rs485ReplyToResponse(reply, *resp);
+	noteTransaction(reply.diag);
+	return reply.result;
+}
+
+/*
+sendModbusViaWorker
+
+Hands the frame to the worker and keeps the main loop serviced until the reply lands.
+Used for writes and one-off reads that need their answer before the caller can go on.
+*/
+modbusRequestAndResponseStatusValues RS485Handler::sendModbusViaWorker(uint8_t frame[], byte actualFrameSize, modbusRequestAndResponse* resp)
+{
+	if (actualFrameSize > MAX_FRAME_SIZE) {
+		return modbusRequestAndResponseStatusValues::invalidFrame;
+	}
+	uint32_t seq = 0;
+	while (!submitToWorker(frame, actualFrameSize, &seq)) {
+		// A deferred read is still out; its reply is kept for replay.
+		collectWorkerReplies(0, nullptr);
+		runServiceHook();
+		diagDelay(1);
+	}
+
+	Rs485WorkerReply reply;
+	while (!collectWorkerReplies(seq, &reply)) {
+		runServiceHook();
+		diagDelay(1);
+	}
+	// The worker computed the CRC in its copy; mirror it so callers see the frame that went out.
+	calcCRC(frame, actualFrameSize);
+	return deliverReply(reply, resp);
+}
+
+/*
+sendModbusDeferred
+
+Non-blocking send for reads inside a deferred scope: replays a reply collected on an earlier
+turn, or puts the frame on the worker and reports responsePending.
+*/
+modbusRequestAndResponseStatusValues RS485Handler::sendModbusDeferred(uint8_t frame[], byte actualFrameSize, modbusRequestAndResponse* resp)
+{
+	calcCRC(frame, actualFrameSize);
+	collectWorkerReplies(0, nullptr);
+
+	Rs485WorkerReply reply;
+	switch (_replay.next(frame, actualFrameSize, reply)) {
+	case Rs485ReplayStep::Replayed:
+		return deliverReply(reply, resp);
+	case Rs485ReplayStep::Pending:
+		return modbusRequestAndResponseStatusValues::responsePending;
+	case Rs485ReplayStep::Wait:
+		return sendModbusViaWorker(frame, actualFrameSize, resp);
+	case Rs485ReplayStep::Submit:
+	default:
+		break;
+	}
+	uint32_t seq = 0;
+	if (submitToWorker(frame, actualFrameSize, &seq)) {
+		_replay.submitted(frame, actualFrameSize, seq);
+	} else {
+		_replay.submitFailed();
+	}
+	return modbusRequestAndResponseStatusValues::responsePending;
+}
+#endif
+
+/*
+sendModbusOnBus
+
+Runs one transaction, retries included, on whichever task owns the UART. Writes only to
+frame, *resp and diag so the worker task never touches state the loop task reads.
+*/
+modbusRequestAndResponseStatusValues RS485Handler::sendModbusOnBus(uint8_t frame[], byte actualFrameSize, modbusRequestAndResponse* resp, Rs485TransactionDiag &diag)
+{
 	modbusRequestAndResponseStatusValues result = modbusRequestAndResponseStatusValues::preProcessing;
 	int tries = 0;
 	uint8_t attempts = 0;
 	uint8_t retries = 0;
 	uint32_t totalWaitMs = 0;
 	uint32_t totalQuietMs = 0;
-	struct TxnGuard {
-		bool &flag;
-		explicit TxnGuard(bool &f) : flag(f) { flag = true; }
-		~TxnGuard() { flag = false; }
-	} txnGuard(_inTransaction);
-	_lastTransactionDiag = Rs485TransactionDiag{};
+	// Responses are matched against the address of the request in flight so
+	// several slaves can share the bus without cross-talk.
+	const uint8_t expectedSlaveId = frame[FRAME_POSITION_SLAVE_ID];
+	diag = Rs485TransactionDiag{};
 
 	//Calculate the CRC and overwrite the last two bytes.
 	calcCRC(frame, actualFrameSize);
@@ -212,19 +484,19 @@ modbusRequestAndResponseStatusValues RS485Handler::sendModbus(uint8_t frame[], b
 		checkRS485IsQuiet(&totalQuietMs);
 
 		//Send
-		digitalWrite(SERIAL_COMMUNICATION_CONTROL_PIN, RS485_TX);
+		digitalWrite(_controlPin, RS485_TX);
 
 		_RS485Serial->write(frame, actualFrameSize);
 		// Ensure it's sent on its way.
 		_RS485Serial->flush();
 
-		// It's important to reset the SERIAL_COMMUNICATION_CONTROL_PIN as soon as
+		// It's important to reset the control pin as soon as
 		// we finish sending so that the serial port can start to buffer the response.
 
-		digitalWrite(SERIAL_COMMUNICATION_CONTROL_PIN, RS485_RX);
+		digitalWrite(_controlPin, RS485_RX);
 	
 		while (result == modbusRequestAndResponseStatusValues::preProcessing) {
-			result = listenResponse(resp, &totalWaitMs);
+			result = listenResponse(resp, expectedSlaveId, &totalWaitMs);
 			if (result == modbusRequestAndResponseStatusValues::writeDataRegisterSuccess ||
 			    result == modbusRequestAndResponseStatusValues::writeSingleRegisterSuccess ||
 			    result == modbusRequestAndResponseStatusValues::readDataRegisterSuccess) {
@@ -253,19 +525,11 @@ modbusRequestAndResponseStatusValues RS485Handler::sendModbus(uint8_t frame[], b
 			result = modbusRequestAndResponseStatusValues::preProcessing;
 		}
 	}
-	_lastTransactionDiag.waitQ10 = quantizeMillisToQ10Local(totalWaitMs);
-	_lastTransactionDiag.quietQ10 = quantizeMillisToQ10Local(totalQuietMs);
-	_lastTransactionDiag.attempts = attempts;
-	_lastTransactionDiag.retries = retries;
-	_lastTransactionDiag.result = result;
-
-	if (result == modbusRequestAndResponseStatusValues::writeDataRegisterSuccess ||
-	    result == modbusRequestAndResponseStatusValues::writeSingleRegisterSuccess ||
-	    result == modbusRequestAndResponseStatusValues::readDataRegisterSuccess) {
-		_rs485IsOnline = true;
-	} else {
-		_rs485IsOnline = false;
-	}
+	diag.waitQ10 = quantizeMillisToQ10Local(totalWaitMs);
+	diag.quietQ10 = quantizeMillisToQ10Local(totalQuietMs);
+	diag.attempts = attempts;
+	diag.retries = retries;
+	diag.result = result;
 	return result;
 }
 
@@ -324,6 +588,7 @@ Listens for a response and processes what it is given that data frame formats va
 Returns data in a stucture and returns a result to guide onward processing.
 */
 modbusRequestAndResponseStatusValues RS485Handler::listenResponse(modbusRequestAndResponse* resp,
+                                                                 uint8_t expectedSlaveId,
                                                                  uint32_t *waitMsAccum)
 {
 	if (!resp)
@@ -373,8 +638,8 @@ modbusRequestAndResponseStatusValues RS485Handler::listenResponse(modbusRequestA
 			sprintf(_debugOutput, "Slave ID: %d", inFrame[FRAME_POSITION_SLAVE_ID]);
 			Serial.println(_debugOutput);
 #endif
-			// First byte is Slave ID.  If not a match (unlikely) try again on the next byte.
-			if (inFrame[FRAME_POSITION_SLAVE_ID] != ALPHA_SLAVE_ID)   
+			// First byte is Slave ID.  If not the addressed slave, try again on the next byte.
+			if (inFrame[FRAME_POSITION_SLAVE_ID] != expectedSlaveId)
 			{
 				gotSlaveID = false;
 				inByteNumZeroIndexed--;
@@ -691,9 +956,7 @@ bool RS485Handler::checkForData(uint32_t *waitMsAccum)
 	
 	while ((!_RS485Serial->available()) && (tries++ < RS485_TRIES))
 	{
-		if (_serviceHook != nullptr) {
-			_serviceHook();
-		}
+		runServiceHook();
 		diagDelay(50);
 	}
 	if (waitMsAccum != nullptr) {
@@ -735,9 +998,7 @@ void RS485Handler::checkRS485IsQuiet(uint32_t *quietMsAccum)
 			_RS485Serial->read();
 			startTime = millis();  // start over
 		}
-		if (_serviceHook != nullptr) {
-			_serviceHook();
-		}
+		runServiceHook();
 		diagDelay(2);
 	}
 	if (quietMsAccum != nullptr) {
@@ -65,6 +65,17 @@ void RegisterHandler::setSerialNumberPrefix(uint8_t char1, uint8_t char2)
 	_serialNumberPrefix[1] = char2;
 }
 
+/*
+setSlaveId
+
+Select which inverter on the shared bus subsequent requests address.  Invalid
+Modbus addresses (0 is broadcast, 248+ reserved) fall back to the default.
+*/
+void RegisterHandler::setSlaveId(uint8_t slaveId)
+{
+	_slaveId = modbusSlaveIdIsValid(slaveId) ? slaveId : ALPHA_SLAVE_ID;
+}
+
 /*
 setModbus
 
@@ -1566,37 +1577,37 @@ modbusRequestAndResponseStatusValues RegisterHandler::readHandledRegister(uint16
 			*/
 
 
-			uint8_t	frame[] = { ALPHA_SLAVE_ID, MODBUS_FN_READDATAREGISTER, REG_PV_METER_R_TOTAL_ACTIVE_POWER_1 >> 8, REG_PV_METER_R_TOTAL_ACTIVE_POWER_1 & 0xff, 0, 2, 0, 0 };
+			uint8_t	frame[] = { _slaveId, MODBUS_FN_READDATAREGISTER, REG_PV_METER_R_TOTAL_ACTIVE_POWER_1 >> 8, REG_PV_METER_R_TOTAL_ACTIVE_POWER_1 & 0xff, 0, 2, 0, 0 };
 			result = _modBus->sendModbus(frame, sizeof(frame), rs);
 			if (result == modbusRequestAndResponseStatusValues::readDataRegisterSuccess)
 			{
 				pvPower = (int32_t)(rs->data[0] << 24 | rs->data[1] << 16 | rs->data[2] << 8 | rs->data[3]);
-				uint8_t	frame[] = { ALPHA_SLAVE_ID, MODBUS_FN_READDATAREGISTER, REG_INVERTER_HOME_R_PV1_POWER_1 >> 8, REG_INVERTER_HOME_R_PV1_POWER_1 & 0xff, 0, 2, 0, 0 };
+				uint8_t	frame[] = { _slaveId, MODBUS_FN_READDATAREGISTER, REG_INVERTER_HOME_R_PV1_POWER_1 >> 8, REG_INVERTER_HOME_R_PV1_POWER_1 & 0xff, 0, 2, 0, 0 };
 				result = _modBus->sendModbus(frame, sizeof(frame), rs);
 				if (result == modbusRequestAndResponseStatusValues::readDataRegisterSuccess)
 				{
 					pvPower = pvPower + ((int32_t)(rs->data[0] << 24 | rs->data[1] << 16 | rs->data[2] << 8 | rs->data[3]));
-					uint8_t	frame[] = { ALPHA_SLAVE_ID, MODBUS_FN_READDATAREGISTER, REG_INVERTER_HOME_R_PV2_POWER_1 >> 8, REG_INVERTER_HOME_R_PV2_POWER_1 & 0xff, 0, 2, 0, 0 };
+					uint8_t	frame[] = { _slaveId, MODBUS_FN_READDATAREGISTER, REG_INVERTER_HOME_R_PV2_POWER_1 >> 8, REG_INVERTER_HOME_R_PV2_POWER_1 & 0xff, 0, 2, 0, 0 };
 					result = _modBus->sendModbus(frame, sizeof(frame), rs);
 					if (result == modbusRequestAndResponseStatusValues::readDataRegisterSuccess)
 					{
 						pvPower = pvPower + ((int32_t)(rs->data[0] << 24 | rs->data[1] << 16 | rs->data[2] << 8 | rs->data[3]));
-						uint8_t	frame[] = { ALPHA_SLAVE_ID, MODBUS_FN_READDATAREGISTER, REG_INVERTER_HOME_R_PV3_POWER_1 >> 8, REG_INVERTER_HOME_R_PV3_POWER_1 & 0xff, 0, 2, 0, 0 };
+						uint8_t	frame[] = { _slaveId, MODBUS_FN_READDATAREGISTER, REG_INVERTER_HOME_R_PV3_POWER_1 >> 8, REG_INVERTER_HOME_R_PV3_POWER_1 & 0xff, 0, 2, 0, 0 };
 						result = _modBus->sendModbus(frame, sizeof(frame), rs);
 						if (result == modbusRequestAndResponseStatusValues::readDataRegisterSuccess)
 						{
 							pvPower = pvPower + ((int32_t)(rs->data[0] << 24 | rs->data[1] << 16 | rs->data[2] << 8 | rs->data[3]));
-							uint8_t	frame[] = { ALPHA_SLAVE_ID, MODBUS_FN_READDATAREGISTER, REG_INVERTER_HOME_R_PV4_POWER_1 >> 8, REG_INVERTER_HOME_R_PV4_POWER_1 & 0xff, 0, 2, 0, 0 };
+							uint8_t	frame[] = { _slaveId, MODBUS_FN_READDATAREGISTER, REG_INVERTER_HOME_R_PV4_POWER_1 >> 8, REG_INVERTER_HOME_R_PV4_POWER_1 & 0xff, 0, 2, 0, 0 };
 							result = _modBus->sendModbus(frame, sizeof(frame), rs);
 							if (result == modbusRequestAndResponseStatusValues::readDataRegisterSuccess)
 							{
 								pvPower = pvPower + ((int32_t)(rs->data[0] << 24 | rs->data[1] << 16 | rs->data[2] << 8 | rs->data[3]));
-								uint8_t	frame[] = { ALPHA_SLAVE_ID, MODBUS_FN_READDATAREGISTER, REG_INVERTER_HOME_R_PV5_POWER_1 >> 8, REG_INVERTER_HOME_R_PV5_POWER_1 & 0xff, 0, 2, 0, 0 };
+								uint8_t	frame[] = { _slaveId, MODBUS_FN_READDATAREGISTER, REG_INVERTER_HOME_R_PV5_POWER_1 >> 8, REG_INVERTER_HOME_R_PV5_POWER_1 & 0xff, 0, 2, 0, 0 };
 								result = _modBus->sendModbus(frame, sizeof(frame), rs);
 								if (result == modbusRequestAndResponseStatusValues::readDataRegisterSuccess)
 								{
 									pvPower = pvPower + ((int32_t)(rs->data[0] << 24 | rs->data[1] << 16 | rs->data[2] << 8 | rs->data[3]));
-									uint8_t	frame[] = { ALPHA_SLAVE_ID, MODBUS_FN_READDATAREGISTER, REG_INVERTER_HOME_R_PV6_POWER_1 >> 8, REG_INVERTER_HOME_R_PV6_POWER_1 & 0xff, 0, 2, 0, 0 };
+									uint8_t	frame[] = { _slaveId, MODBUS_FN_READDATAREGISTER, REG_INVERTER_HOME_R_PV6_POWER_1 >> 8, REG_INVERTER_HOME_R_PV6_POWER_1 & 0xff, 0, 2, 0, 0 };
 									result = _modBus->sendModbus(frame, sizeof(frame), rs);
 									if (result == modbusRequestAndResponseStatusValues::readDataRegisterSuccess)
 									{
@@ -1605,14 +1616,14 @@ modbusRequestAndResponseStatusValues RegisterHandler::readHandledRegister(uint16
 										if (result == modbusRequestAndResponseStatusValues::readDataRegisterSuccess)
 										{
 											// Generate a frame without CRC (ending 0, 0), sendModbus will do the rest
-											uint8_t	frame[] = { ALPHA_SLAVE_ID, MODBUS_FN_READDATAREGISTER, REG_GRID_METER_R_TOTAL_ACTIVE_POWER_1 >> 8, REG_GRID_METER_R_TOTAL_ACTIVE_POWER_1 & 0xff, 0, 2, 0, 0 };
+											uint8_t	frame[] = { _slaveId, MODBUS_FN_READDATAREGISTER, REG_GRID_METER_R_TOTAL_ACTIVE_POWER_1 >> 8, REG_GRID_METER_R_TOTAL_ACTIVE_POWER_1 & 0xff, 0, 2, 0, 0 };
 											// And send to the device, it's all synchronos so by the time we get a response we will know if success or failure
 											result = _modBus->sendModbus(frame, sizeof(frame), rs);
 											gridPower = (int32_t)(rs->data[0] << 24 | rs->data[1] << 16 | rs->data[2] << 8 | rs->data[3]);
 											if (result == modbusRequestAndResponseStatusValues::readDataRegisterSuccess)
 											{
 												// Generate a frame without CRC (ending 0, 0), sendModbus will do the rest
-												uint8_t	frame[] = { ALPHA_SLAVE_ID, MODBUS_FN_READDATAREGISTER, REG_BATTERY_HOME_R_BATTERY_POWER >> 8, REG_BATTERY_HOME_R_BATTERY_POWER & 0xff, 0, 1, 0, 0 };
+												uint8_t	frame[] = { _slaveId, MODBUS_FN_READDATAREGISTER, REG_BATTERY_HOME_R_BATTERY_POWER >> 8, REG_BATTERY_HOME_R_BATTERY_POWER & 0xff, 0, 1, 0, 0 };
 												// And send to the device, it's all synchronos so by the time we get a response we will know if success or failure
 												result = _modBus->sendModbus(frame, sizeof(frame), rs);
 												if (result == modbusRequestAndResponseStatusValues::readDataRegisterSuccess)
@@ -1661,13 +1672,13 @@ modbusRequestAndResponseStatusValues RegisterHandler::readHandledRegister(uint16
 			Ensure V > 0 to avoid division by zero
 			*/
 
-			uint8_t	frame[] = { ALPHA_SLAVE_ID, MODBUS_FN_READDATAREGISTER, REG_GRID_METER_R_ACTIVE_POWER_OF_A_PHASE_1 >> 8, REG_GRID_METER_R_ACTIVE_POWER_OF_A_PHASE_1 & 0xff, 0, 2, 0, 0 };
+			uint8_t	frame[] = { _slaveId, MODBUS_FN_READDATAREGISTER, REG_GRID_METER_R_ACTIVE_POWER_OF_A_PHASE_1 >> 8, REG_GRID_METER_R_ACTIVE_POWER_OF_A_PHASE_1 & 0xff, 0, 2, 0, 0 };
 			result = _modBus->sendModbus(frame, sizeof(frame), rs);
 			if (result == modbusRequestAndResponseStatusValues::readDataRegisterSuccess)
 			{
 				gridPower = (int32_t)(rs->data[0] << 24 | rs->data[1] << 16 | rs->data[2] << 8 | rs->data[3]);
 
-				uint8_t	frame[] = { ALPHA_SLAVE_ID, MODBUS_FN_READDATAREGISTER, REG_GRID_METER_R_VOLTAGE_OF_A_PHASE >> 8, REG_GRID_METER_R_VOLTAGE_OF_A_PHASE & 0xff, 0, 1, 0, 0 };
+				uint8_t	frame[] = { _slaveId, MODBUS_FN_READDATAREGISTER, REG_GRID_METER_R_VOLTAGE_OF_A_PHASE >> 8, REG_GRID_METER_R_VOLTAGE_OF_A_PHASE & 0xff, 0, 1, 0, 0 };
 				result = _modBus->sendModbus(frame, sizeof(frame), rs);
 				if (result == modbusRequestAndResponseStatusValues::readDataRegisterSuccess)
 				{
@@ -1755,7 +1766,7 @@ modbusRequestAndResponseStatusValues RegisterHandler::readHandledRegister(uint16
 			if (result == modbusRequestAndResponseStatusValues::preProcessing)
 			{
 				// Generate a frame without CRC (ending 0, 0), sendModbus will do the rest
-				uint8_t	frame[] = { ALPHA_SLAVE_ID, MODBUS_FN_READDATAREGISTER,
+				uint8_t	frame[] = { _slaveId, MODBUS_FN_READDATAREGISTER,
 						    (uint8_t)((registerAddressToSend >> 8) & 0xff), (uint8_t)(registerAddressToSend & 0xff),
 						    0, rs->registerCount,
 						    0, 0 };
@@ -4588,7 +4599,7 @@ modbusRequestAndResponseStatusValues RegisterHandler::readRawRegisterBlock(uint1
 	}
 
 	uint8_t frame[kModbusReadFrameSize];
-	buildReadFrame(ALPHA_SLAVE_ID, MODBUS_FN_READDATAREGISTER, registerAddress, registerCount, frame);
+	buildReadFrame(_slaveId, MODBUS_FN_READDATAREGISTER, registerAddress, registerCount, frame);
 	return _modBus->sendModbus(frame, sizeof(frame), rs);
 }
 
@@ -4610,7 +4621,7 @@ modbusRequestAndResponseStatusValues RegisterHandler::writeRawSingleRegister(uin
 	modbusRequestAndResponseStatusValues result;
 
 	// Generate a frame with CRC placeholders of 0, 0 at the end
-	uint8_t	frame[] = { ALPHA_SLAVE_ID, MODBUS_FN_WRITESINGLEREGISTER,
+	uint8_t	frame[] = { _slaveId, MODBUS_FN_WRITESINGLEREGISTER,
 			    (uint8_t)((registerAddress >> 8) & 0xff), (uint8_t)(registerAddress & 0xff),
 			    (uint8_t)((value >> 8) & 0xff), (uint8_t)(value & 0xff),
 			    0, 0 };
@@ -4644,7 +4655,7 @@ modbusRequestAndResponseStatusValues RegisterHandler::writeRawDataRegister(uint1
 	{
 		uint16_t values[] = { static_cast<uint16_t>(value & 0xffff) };
 		uint8_t frame[16];
-		size_t frameSize = buildWriteMultipleRegistersFrame(ALPHA_SLAVE_ID,
+		size_t frameSize = buildWriteMultipleRegistersFrame(_slaveId,
 								    MODBUS_FN_WRITEDATAREGISTER,
 								    registerAddress,
 								    values,
@@ -4662,7 +4673,7 @@ modbusRequestAndResponseStatusValues RegisterHandler::writeRawDataRegister(uint1
 			static_cast<uint16_t>(value & 0xffff)
 		};
 		uint8_t frame[20];
-		size_t frameSize = buildWriteMultipleRegistersFrame(ALPHA_SLAVE_ID,
+		size_t frameSize = buildWriteMultipleRegistersFrame(_slaveId,
 								    MODBUS_FN_WRITEDATAREGISTER,
 								    registerAddress,
 								    values,
@@ -4703,7 +4714,7 @@ modbusRequestAndResponseStatusValues RegisterHandler::writeDispatchRegisters(uin
                                                                             modbusRequestAndResponse* rs)
 {
 	modbusRequestAndResponseStatusValues result;
-	uint8_t	frame[] = { ALPHA_SLAVE_ID, MODBUS_FN_WRITEDATAREGISTER,
+	uint8_t	frame[] = { _slaveId, MODBUS_FN_WRITEDATAREGISTER,
 			(uint8_t)((REG_DISPATCH_RW_DISPATCH_START >> 8) & 0xff), (uint8_t)(REG_DISPATCH_RW_DISPATCH_START & 0xff),
 			0, 9, 18,										// 9 registers (1+2+2+1+1+2) and 9*2
 			(uint8_t)((DISPATCH_START_START >> 8) & 0xff), (uint8_t)(DISPATCH_START_START & 0xff),	// Start/Stop
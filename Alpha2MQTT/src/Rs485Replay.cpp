@@ -0,0 +1,117 @@
+// Purpose: Let the loop() task issue RS485 reads without waiting on the worker task for the reply.
+#include "../include/Rs485Replay.h"
+
+#include <cstring>
+
+namespace {
+
+bool
+sameFrame(const uint8_t *a, size_t aSize, const uint8_t *b, size_t bSize)
+{
+	return aSize == bSize && memcmp(a, b, aSize) == 0;
+}
+
+} // namespace
+
+void
+rs485ReplyFromResponse(const modbusRequestAndResponse &resp, Rs485WorkerReply &reply)
+{
+	memcpy(reply.data, resp.data, sizeof(reply.data));
+	reply.dataSize = resp.dataSize;
+	reply.functionCode = resp.functionCode;
+	memcpy(reply.statusMqttMessage, resp.statusMqttMessage, sizeof(reply.statusMqttMessage));
+	memcpy(reply.displayMessage, resp.displayMessage, sizeof(reply.displayMessage));
+}
+
+void
+rs485ReplyToResponse(const Rs485WorkerReply &reply, modbusRequestAndResponse &resp)
+{
+	memcpy(resp.data, reply.data, sizeof(resp.data));
+	resp.dataSize = reply.dataSize;
+	resp.functionCode = reply.functionCode;
+	memcpy(resp.statusMqttMessage, reply.statusMqttMessage, sizeof(resp.statusMqttMessage));
+	memcpy(resp.displayMessage, reply.displayMessage, sizeof(resp.displayMessage));
+}
+
+void
+Rs485ReplayChannel::beginScope()
+{
+	_inScope = true;
+	_scopePending = false;
+	_replayNext = 0;
+}
+
+bool
+Rs485ReplayChannel::endScope()
+{
+	_inScope = false;
+	if (!_scopePending) {
+		_replayCount = 0;
+	}
+	_replayNext = 0;
+	return _scopePending;
+}
+
+Rs485ReplayStep
+Rs485ReplayChannel::next(const uint8_t *frame, size_t frameSize, Rs485WorkerReply &out)
+{
+	if (_scopePending) {
+		return Rs485ReplayStep::Pending;
+	}
+	if (_replayNext < _replayCount) {
+		const Entry &entry = _replay[_replayNext];
+		if (sameFrame(entry.frame, entry.frameSize, frame, frameSize)) {
+			out = entry.reply;
+			_replayNext++;
+			return Rs485ReplayStep::Replayed;
+		}
+		// The chain took a different path than last turn; later replies no longer line up.
+		_replayCount = _replayNext;
+	}
+	if (_inFlightSeq != 0) {
+		if (sameFrame(_inFlightFrame, _inFlightFrameSize, frame, frameSize)) {
+			_scopePending = true;
+			return Rs485ReplayStep::Pending;
+		}
+		_inFlightSeq = 0;
+	}
+	if (_replayCount >= kRs485ReplayDepth || frameSize > MAX_FRAME_SIZE) {
+		return Rs485ReplayStep::Wait;
+	}
+	return Rs485ReplayStep::Submit;
+}
+
+void
+Rs485ReplayChannel::submitted(const uint8_t *frame, size_t frameSize, uint32_t seq)
+{
+	memcpy(_inFlightFrame, frame, frameSize);
+	_inFlightFrameSize = static_cast<uint8_t>(frameSize);
+	_inFlightSeq = seq;
+	_scopePending = true;
+}
+
+bool
+Rs485ReplayChannel::collected(uint32_t seq, const Rs485WorkerReply &reply)
+{
+	if (_inFlightSeq == 0 || seq != _inFlightSeq) {
+		return false;
+	}
+	_inFlightSeq = 0;
+	if (_replayCount >= kRs485ReplayDepth) {
+		return false;
+	}
+	Entry &entry = _replay[_replayCount++];
+	memcpy(entry.frame, _inFlightFrame, _inFlightFrameSize);
+	entry.frameSize = _inFlightFrameSize;
+	entry.reply = reply;
+	return true;
+}
+
+void
+Rs485ReplayChannel::abandon()
+{
+	_replayCount = 0;
+	_replayNext = 0;
+	_inFlightSeq = 0;
+	_scopePending = false;
+}
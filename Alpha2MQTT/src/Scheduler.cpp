@@ -18,6 +18,15 @@ uint32_t resetScheduleBaseline(uint32_t now)
 	return now;
 }
 
+uint32_t msUntilDue(uint32_t now, uint32_t lastRun, uint32_t intervalMs)
+{
+	if (lastRun == 0) {
+		return 0;
+	}
+	const uint32_t elapsed = static_cast<uint32_t>(now - lastRun);
+	return (elapsed >= intervalMs) ? 0 : (intervalMs - elapsed);
+}
+
 bool shouldBootstrapPublishEntity(mqttUpdateFreq freq)
 {
 	return freq != mqttUpdateFreq::freqTenSec &&
@@ -0,0 +1,155 @@
+// Purpose: Phase-exclusive scratch buffer leases with per-pool high-water accounting.
+#include "../include/ScratchPool.h"
+
+#include <cstdio>
+#include <cstring>
+#include <new>
+
+const char *
+scratchPhaseName(ScratchPhase phase)
+{
+	switch (phase) {
+	case ScratchPhase::Discovery:
+		return "discovery";
+	case ScratchPhase::StatusJson:
+		return "status_json";
+	case ScratchPhase::PollingConfig:
+		return "polling_config";
+	case ScratchPhase::Portal:
+		return "portal";
+	case ScratchPhase::None:
+	default:
+		return "none";
+	}
+}
+
+void
+scratchPoolInit(ScratchPool &pool, const char *name, size_t capacity)
+{
+	pool = ScratchPool{};
+	pool.name = name;
+	pool.capacity = capacity;
+}
+
+void
+scratchPoolFree(ScratchPool &pool)
+{
+	if (pool.holder != ScratchPhase::None) {
+		return;
+	}
+	delete[] pool.storage;
+	pool.storage = nullptr;
+}
+
+bool
+scratchPoolReserve(ScratchPool &pool)
+{
+	if (pool.storage != nullptr) {
+		return true;
+	}
+	if (pool.capacity == 0) {
+		return false;
+	}
+	pool.storage = new (std::nothrow) uint8_t[pool.capacity];
+	if (pool.storage == nullptr) {
+		return false;
+	}
+	pool.storage[0] = 0;
+	return true;
+}
+
+ScratchLease::ScratchLease(ScratchPool &pool, ScratchPhase phase, size_t bytes)
+	: pool_(nullptr), phase_(phase), bytes_(0), used_(0), text_(false)
+{
+	if (pool.holder != ScratchPhase::None || bytes == 0 || bytes > pool.capacity || !scratchPoolReserve(pool)) {
+		pool.stats.rejected++;
+		pool.stats.conflictHolder = pool.holder;
+		pool.stats.conflictRequester = phase;
+		return;
+	}
+	pool.holder = phase;
+	pool.stats.leases++;
+	pool_ = &pool;
+	bytes_ = bytes;
+}
+
+ScratchLease::~ScratchLease()
+{
+	if (pool_ == nullptr) {
+		return;
+	}
+	if (text_) {
+		const void *end = memchr(pool_->storage, '\0', bytes_);
+		const size_t textBytes = (end != nullptr) ? static_cast<size_t>(static_cast<const uint8_t *>(end) - pool_->storage) + 1
+		                                          : bytes_;
+		noteUsed(textBytes);
+	}
+	if (used_ > pool_->stats.peakBytes) {
+		pool_->stats.peakBytes = used_;
+		pool_->stats.peakPhase = phase_;
+	}
+	pool_->holder = ScratchPhase::None;
+}
+
+char *
+ScratchLease::chars()
+{
+	if (!ok()) {
+		return nullptr;
+	}
+	if (!text_) {
+		text_ = true;
+		pool_->storage[0] = 0;
+	}
+	return reinterpret_cast<char *>(pool_->storage);
+}
+
+void
+ScratchLease::noteUsed(size_t bytes)
+{
+	if (bytes > bytes_) {
+		bytes = bytes_;
+	}
+	if (bytes > used_) {
+		used_ = bytes;
+	}
+}
+
+bool
+buildScratchPoolsJson(const ScratchPool *const *pools, size_t count, char *out, size_t outSize)
+{
+	if (out == nullptr || outSize == 0) {
+		return false;
+	}
+	size_t len = 0;
+	int written = snprintf(out, outSize, "{");
+	if (written < 0 || static_cast<size_t>(written) >= outSize) {
+		return false;
+	}
+	len = static_cast<size_t>(written);
+	for (size_t i = 0; i < count; ++i) {
+		const ScratchPool *pool = pools[i];
+		if (pool == nullptr) {
+			continue;
+		}
+		written = snprintf(out + len,
+		                   outSize - len,
+		                   "%s\"%s\":{\"cap\":%lu,\"peak\":%lu,\"peak_phase\":\"%s\",\"leases\":%lu,"
+		                   "\"rejected\":%lu,\"conflict\":\"%s>%s\"}",
+		                   (len > 1) ? "," : "",
+		                   pool->name ? pool->name : "",
+		                   static_cast<unsigned long>(pool->capacity),
+		                   static_cast<unsigned long>(pool->stats.peakBytes),
+		                   scratchPhaseName(pool->stats.peakPhase),
+		                   static_cast<unsigned long>(pool->stats.leases),
+		                   static_cast<unsigned long>(pool->stats.rejected),
+		                   scratchPhaseName(pool->stats.conflictHolder),
+		                   scratchPhaseName(pool->stats.conflictRequester));
+		if (written < 0 || static_cast<size_t>(written) >= outSize - len) {
+			return false;
+		}
+		len += static_cast<size_t>(written);
+	}
+	written = snprintf(out + len, outSize - len, "}");
+	return written >= 0 && static_cast<size_t>(written) < outSize - len;
+}
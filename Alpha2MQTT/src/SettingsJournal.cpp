@@ -0,0 +1,387 @@
+// Purpose: RAM write-behind journal for small settings, committed to two alternating flash slots.
+#include "../include/SettingsJournal.h"
+
+#include <cstdio>
+#include <cstring>
+
+#include "../include/Crc32.h"
+
+namespace {
+
+constexpr uint8_t kJournalMagic0 = 'S';
+constexpr uint8_t kJournalMagic1 = 'J';
+constexpr uint8_t kJournalVersion = 1;
+
+size_t
+keyLength(const char *key)
+{
+	if (key == nullptr) {
+		return 0;
+	}
+	const size_t len = strnlen(key, kSettingsKeyMaxLen + 1);
+	return (len <= kSettingsKeyMaxLen) ? len : 0;
+}
+
+SettingsJournalEntry *
+findEntry(SettingsJournal &journal, const char *key)
+{
+	for (size_t i = 0; i < journal.count; ++i) {
+		if (strcmp(journal.entries[i].key, key) == 0) {
+			return &journal.entries[i];
+		}
+	}
+	return nullptr;
+}
+
+const SettingsJournalEntry *
+findEntry(const SettingsJournal &journal, const char *key)
+{
+	return findEntry(const_cast<SettingsJournal &>(journal), key);
+}
+
+SettingsWriteStat *
+statFor(SettingsJournal &journal, const char *key)
+{
+	for (size_t i = 0; i < journal.statCount; ++i) {
+		if (strcmp(journal.stats[i].key, key) == 0) {
+			return &journal.stats[i];
+		}
+	}
+	if (journal.statCount == kSettingsWriteStatKeys) {
+		return nullptr;
+	}
+	SettingsWriteStat &stat = journal.stats[journal.statCount++];
+	memcpy(stat.key, key, strlen(key) + 1);
+	stat.writes = 0;
+	return &stat;
+}
+
+bool
+put(SettingsJournal &journal, const char *key, SettingsValueKind kind, const void *data, size_t len, uint32_t nowMs)
+{
+	const size_t keyLen = keyLength(key);
+	if (keyLen == 0 || len > kSettingsJournalValueMax) {
+		return false;
+	}
+	SettingsJournalEntry *entry = findEntry(journal, key);
+	if (entry == nullptr) {
+		if (journal.count == kSettingsJournalKeys) {
+			return false;
+		}
+		entry = &journal.entries[journal.count++];
+		memcpy(entry->key, key, keyLen + 1);
+		entry->dirty = false;
+	} else if (entry->kind == kind && entry->len == len && memcmp(entry->value, data, len) == 0) {
+		journal.coalesced++;
+		return true;
+	} else if (entry->dirty) {
+		journal.coalesced++;
+	}
+	entry->kind = kind;
+	entry->len = static_cast<uint8_t>(len);
+	if (len > 0) {
+		memcpy(entry->value, data, len);
+	}
+	if (settingsJournalPending(journal) == 0) {
+		journal.firstDirtyMs = nowMs;
+	}
+	journal.lastDirtyMs = nowMs;
+	entry->dirty = true;
+	return true;
+}
+
+void
+putU32(uint8_t *out, uint32_t value)
+{
+	for (size_t i = 0; i < 4; ++i) {
+		out[i] = static_cast<uint8_t>(value >> (8 * i));
+	}
+}
+
+uint32_t
+getU32(const uint8_t *in)
+{
+	uint32_t value = 0;
+	for (size_t i = 0; i < 4; ++i) {
+		value |= static_cast<uint32_t>(in[i]) << (8 * i);
+	}
+	return value;
+}
+
+size_t
+serialize(const SettingsJournal &journal, uint32_t generation, uint8_t *out)
+{
+	out[0] = kJournalMagic0;
+	out[1] = kJournalMagic1;
+	out[2] = kJournalVersion;
+	out[3] = static_cast<uint8_t>(journal.count);
+	putU32(out + 4, generation);
+	size_t used = kSettingsJournalHeaderBytes;
+	for (size_t i = 0; i < journal.count; ++i) {
+		const SettingsJournalEntry &entry = journal.entries[i];
+		const size_t keyLen = strlen(entry.key);
+		out[used++] = static_cast<uint8_t>(keyLen);
+		memcpy(out + used, entry.key, keyLen);
+		used += keyLen;
+		out[used++] = static_cast<uint8_t>(entry.kind);
+		out[used++] = entry.len;
+		memcpy(out + used, entry.value, entry.len);
+		used += entry.len;
+	}
+	putU32(out + used, crc32Ieee(out, used));
+	return used + 4;
+}
+
+// Validates a slot image; with out set, also replaces out's entries with its contents (all clean).
+bool
+parse(const uint8_t *record, size_t len, uint32_t &generation, SettingsJournal *out)
+{
+	if (len < kSettingsJournalHeaderBytes + 4 || record[0] != kJournalMagic0 || record[1] != kJournalMagic1 ||
+	    record[2] != kJournalVersion || record[3] > kSettingsJournalKeys) {
+		return false;
+	}
+	const size_t body = len - 4;
+	if (crc32Ieee(record, body) != getU32(record + body)) {
+		return false;
+	}
+	generation = getU32(record + 4);
+	const size_t count = record[3];
+	size_t used = kSettingsJournalHeaderBytes;
+	for (size_t i = 0; i < count; ++i) {
+		if (used >= body) {
+			return false;
+		}
+		const size_t keyLen = record[used++];
+		if (keyLen == 0 || keyLen > kSettingsKeyMaxLen || used + keyLen + 2 > body) {
+			return false;
+		}
+		const uint8_t *key = record + used;
+		used += keyLen;
+		const uint8_t kind = record[used++];
+		const size_t valueLen = record[used++];
+		if (kind > static_cast<uint8_t>(SettingsValueKind::String) || valueLen > kSettingsJournalValueMax ||
+		    used + valueLen > body) {
+			return false;
+		}
+		if (out != nullptr) {
+			SettingsJournalEntry &entry = out->entries[i];
+			memcpy(entry.key, key, keyLen);
+			entry.key[keyLen] = '\0';
+			entry.kind = static_cast<SettingsValueKind>(kind);
+			entry.len = static_cast<uint8_t>(valueLen);
+			entry.dirty = false;
+			memcpy(entry.value, record + used, valueLen);
+		}
+		used += valueLen;
+	}
+	if (used != body) {
+		return false;
+	}
+	if (out != nullptr) {
+		out->count = count;
+	}
+	return true;
+}
+
+} // namespace
+
+void
+settingsJournalInit(SettingsJournal &journal)
+{
+	memset(&journal, 0, sizeof(journal));
+}
+
+bool
+settingsJournalLoad(SettingsJournal &journal, SettingsStore &store)
+{
+	uint8_t record[kSettingsJournalRecordMaxBytes];
+	bool found = false;
+	uint8_t newestSlot = 0;
+	uint32_t newestGeneration = 0;
+	for (uint8_t slot = 0; slot < 2; ++slot) {
+		const size_t len = store.readSlot(slot, record, sizeof(record));
+		uint32_t generation = 0;
+		if (len == 0 || !parse(record, len, generation, nullptr)) {
+			continue;
+		}
+		// Wraparound-safe: the newer of two generations is ahead by less than half the range.
+		if (!found || static_cast<int32_t>(generation - newestGeneration) > 0) {
+			found = true;
+			newestSlot = slot;
+			newestGeneration = generation;
+		}
+	}
+	journal.count = 0;
+	journal.generation = 0;
+	if (!found) {
+		return false;
+	}
+	const size_t len = store.readSlot(newestSlot, record, sizeof(record));
+	if (len == 0 || !parse(record, len, journal.generation, &journal)) {
+		journal.count = 0;
+		journal.generation = 0;
+		return false;
+	}
+	return true;
+}
+
+bool
+settingsJournalPutUInt(SettingsJournal &journal, const char *key, uint32_t value, uint32_t nowMs)
+{
+	uint8_t bytes[4];
+	putU32(bytes, value);
+	return put(journal, key, SettingsValueKind::UInt, bytes, sizeof(bytes), nowMs);
+}
+
+bool
+settingsJournalPutString(SettingsJournal &journal, const char *key, const char *value, uint32_t nowMs)
+{
+	const char *safeValue = (value != nullptr) ? value : "";
+	const size_t len = strnlen(safeValue, kSettingsJournalValueMax + 1);
+	return put(journal, key, SettingsValueKind::String, safeValue, len, nowMs);
+}
+
+bool
+settingsJournalRemove(SettingsJournal &journal, const char *key, uint32_t nowMs)
+{
+	return put(journal, key, SettingsValueKind::Removed, nullptr, 0, nowMs);
+}
+
+SettingsLookup
+settingsJournalGetUInt(const SettingsJournal &journal, const char *key, uint32_t &out)
+{
+	const SettingsJournalEntry *entry = (keyLength(key) != 0) ? findEntry(journal, key) : nullptr;
+	if (entry == nullptr) {
+		return SettingsLookup::Missing;
+	}
+	if (entry->kind != SettingsValueKind::UInt || entry->len != 4) {
+		return SettingsLookup::Removed;
+	}
+	out = getU32(entry->value);
+	return SettingsLookup::Present;
+}
+
+SettingsLookup
+settingsJournalGetString(const SettingsJournal &journal, const char *key, char *out, size_t outSize)
+{
+	const SettingsJournalEntry *entry = (keyLength(key) != 0) ? findEntry(journal, key) : nullptr;
+	if (entry == nullptr || out == nullptr || outSize == 0) {
+		return SettingsLookup::Missing;
+	}
+	if (entry->kind != SettingsValueKind::String) {
+		out[0] = '\0';
+		return SettingsLookup::Removed;
+	}
+	const size_t copyLen = (entry->len < outSize) ? entry->len : outSize - 1;
+	memcpy(out, entry->value, copyLen);
+	out[copyLen] = '\0';
+	return SettingsLookup::Present;
+}
+
+size_t
+settingsJournalPending(const SettingsJournal &journal)
+{
+	size_t pending = 0;
+	for (size_t i = 0; i < journal.count; ++i) {
+		if (journal.entries[i].dirty) {
+			pending++;
+		}
+	}
+	return pending;
+}
+
+uint32_t
+settingsJournalMsUntilFlush(const SettingsJournal &journal, uint32_t nowMs, uint32_t quietMs, uint32_t maxDelayMs)
+{
+	if (settingsJournalPending(journal) == 0) {
+		return kSettingsJournalNoFlush;
+	}
+	const uint32_t sinceLast = nowMs - journal.lastDirtyMs;
+	const uint32_t sinceFirst = nowMs - journal.firstDirtyMs;
+	const uint32_t quietLeft = (sinceLast >= quietMs) ? 0 : quietMs - sinceLast;
+	const uint32_t maxLeft = (sinceFirst >= maxDelayMs) ? 0 : maxDelayMs - sinceFirst;
+	return (quietLeft < maxLeft) ? quietLeft : maxLeft;
+}
+
+bool
+settingsJournalFlush(SettingsJournal &journal, SettingsStore &store)
+{
+	if (settingsJournalPending(journal) == 0) {
+		return true;
+	}
+	uint8_t record[kSettingsJournalRecordMaxBytes];
+	const uint32_t nextGeneration = journal.generation + 1;
+	const size_t len = serialize(journal, nextGeneration, record);
+	if (!store.writeSlot(static_cast<uint8_t>(nextGeneration & 1U), record, len)) {
+		journal.flushFailures++;
+		return false;
+	}
+	journal.generation = nextGeneration;
+	journal.flushes++;
+	for (size_t i = 0; i < journal.count; ++i) {
+		SettingsJournalEntry &entry = journal.entries[i];
+		if (entry.dirty) {
+			entry.dirty = false;
+			settingsJournalNoteWrite(journal, entry.key);
+		}
+	}
+	return true;
+}
+
+void
+settingsJournalNoteWrite(SettingsJournal &journal, const char *key)
+{
+	if (keyLength(key) == 0) {
+		return;
+	}
+	SettingsWriteStat *stat = statFor(journal, key);
+	if (stat != nullptr) {
+		stat->writes++;
+	}
+}
+
+uint32_t
+settingsJournalWriteCount(const SettingsJournal &journal, const char *key)
+{
+	for (size_t i = 0; i < journal.statCount; ++i) {
+		if (key != nullptr && strcmp(journal.stats[i].key, key) == 0) {
+			return journal.stats[i].writes;
+		}
+	}
+	return 0;
+}
+
+bool
+buildSettingsJournalJson(const SettingsJournal &journal, char *out, size_t outSize)
+{
+	if (out == nullptr || outSize == 0) {
+		return false;
+	}
+	int written = snprintf(out,
+	                       outSize,
+	                       "{\"gen\":%lu,\"pending\":%u,\"flushes\":%lu,\"flush_failures\":%lu,\"coalesced\":%lu,"
+	                       "\"writes\":{",
+	                       static_cast<unsigned long>(journal.generation),
+	                       static_cast<unsigned>(settingsJournalPending(journal)),
+	                       static_cast<unsigned long>(journal.flushes),
+	                       static_cast<unsigned long>(journal.flushFailures),
+	                       static_cast<unsigned long>(journal.coalesced));
+	if (written < 0 || static_cast<size_t>(written) >= outSize) {
+		return false;
+	}
+	size_t len = static_cast<size_t>(written);
+	for (size_t i = 0; i < journal.statCount; ++i) {
+		written = snprintf(out + len,
+		                   outSize - len,
+		                   "%s\"%s\":%lu",
+		                   (i == 0) ? "" : ",",
+		                   journal.stats[i].key,
+		                   static_cast<unsigned long>(journal.stats[i].writes));
+		if (written < 0 || static_cast<size_t>(written) >= outSize - len) {
+			return false;
+		}
+		len += static_cast<size_t>(written);
+	}
+	written = snprintf(out + len, outSize - len, "}}");
+	return written >= 0 && static_cast<size_t>(written) < outSize - len;
+}
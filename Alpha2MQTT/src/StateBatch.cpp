@@ -0,0 +1,244 @@
+// Purpose: Build batched per-bucket state documents without heap use.
+#include "../include/StateBatch.h"
+#include "../include/BucketScheduler.h"
+
+#include <cstdio>
+#include <cstring>
+
+namespace {
+
+// Room kept for the closing brace and terminator.
+constexpr size_t kStateBatchTail = 2;
+
+size_t
+escapedLength(const char *text)
+{
+	size_t len = 0;
+	for (const char *p = text; *p != '\0'; ++p) {
+		const unsigned char c = static_cast<unsigned char>(*p);
+		if (c == '"' || c == '\\') {
+			len += 2;
+		} else if (c < 0x20) {
+			len += 6;
+		} else {
+			len += 1;
+		}
+	}
+	return len;
+}
+
+size_t
+writeEscaped(char *out, const char *text)
+{
+	size_t pos = 0;
+	for (const char *p = text; *p != '\0'; ++p) {
+		const unsigned char c = static_cast<unsigned char>(*p);
+		if (c == '"' || c == '\\') {
+			out[pos++] = '\\';
+			out[pos++] = static_cast<char>(c);
+		} else if (c < 0x20) {
+			snprintf(out + pos, 7, "\\u%04x", static_cast<unsigned>(c));
+			pos += 6;
+		} else {
+			out[pos++] = static_cast<char>(c);
+		}
+	}
+	return pos;
+}
+
+} // namespace
+
+void
+stateBatchReset(StateBatch &batch)
+{
+	batch.json[0] = '{';
+	batch.json[1] = '\0';
+	batch.used = 1;
+	batch.entries = 0;
+	batch.finished = false;
+}
+
+bool
+stateBatchValueIsNumber(const char *value)
+{
+	// Strict JSON number grammar: -?(0|[1-9][0-9]*)(\.[0-9]+)?([eE][+-]?[0-9]+)?
+	if (value == nullptr) {
+		return false;
+	}
+	const char *p = value;
+	if (*p == '-') {
+		++p;
+	}
+	if (*p == '0') {
+		++p;
+	} else if (*p >= '1' && *p <= '9') {
+		while (*p >= '0' && *p <= '9') {
+			++p;
+		}
+	} else {
+		return false;
+	}
+	if (*p == '.') {
+		++p;
+		if (!(*p >= '0' && *p <= '9')) {
+			return false;
+		}
+		while (*p >= '0' && *p <= '9') {
+			++p;
+		}
+	}
+	if (*p == 'e' || *p == 'E') {
+		++p;
+		if (*p == '+' || *p == '-') {
+			++p;
+		}
+		if (!(*p >= '0' && *p <= '9')) {
+			return false;
+		}
+		while (*p >= '0' && *p <= '9') {
+			++p;
+		}
+	}
+	return *p == '\0';
+}
+
+StateBatchAppend
+stateBatchAppend(StateBatch &batch, const char *key, const char *value, uint16_t entityIndex)
+{
+	if (key == nullptr || key[0] == '\0' || value == nullptr || batch.finished) {
+		return StateBatchAppend::Rejected;
+	}
+	const bool numeric = stateBatchValueIsNumber(value);
+	// [,]"key":value or [,]"key":"value"
+	const size_t keyLen = escapedLength(key);
+	const size_t valueLen = numeric ? strlen(value) : escapedLength(value) + 2;
+	const size_t entryLen = 1 + keyLen + 2 + valueLen;
+	if (1 + entryLen + kStateBatchTail > sizeof(batch.json)) {
+		return StateBatchAppend::Rejected;
+	}
+	if (batch.entries >= kStateBatchMaxEntries ||
+	    batch.used + entryLen + kStateBatchTail > sizeof(batch.json)) {
+		return StateBatchAppend::Full;
+	}
+
+	char *out = batch.json + batch.used;
+	size_t pos = 0;
+	if (batch.entries > 0) {
+		out[pos++] = ',';
+	}
+	out[pos++] = '"';
+	pos += writeEscaped(out + pos, key);
+	out[pos++] = '"';
+	out[pos++] = ':';
+	if (numeric) {
+		memcpy(out + pos, value, valueLen);
+		pos += valueLen;
+	} else {
+		out[pos++] = '"';
+		pos += writeEscaped(out + pos, value);
+		out[pos++] = '"';
+	}
+	out[pos] = '\0';
+	batch.used += pos;
+	batch.entityIndex[batch.entries++] = entityIndex;
+	return StateBatchAppend::Added;
+}
+
+const char *
+stateBatchFinish(StateBatch &batch)
+{
+	if (batch.entries == 0) {
+		return nullptr;
+	}
+	if (!batch.finished) {
+		batch.json[batch.used++] = '}';
+		batch.json[batch.used] = '\0';
+		batch.finished = true;
+	}
+	return batch.json;
+}
+
+bool
+stateBatchEntityEligible(mqttEntityId entityId, bool retained, BucketId bucket)
+{
+	if (retained) {
+		return false;
+	}
+	switch (bucket) {
+	case BucketId::TenSec:
+	case BucketId::OneMin:
+	case BucketId::FiveMin:
+	case BucketId::OneHour:
+	case BucketId::OneDay:
+	case BucketId::User:
+		break;
+	default:
+		return false;
+	}
+	switch (entityId) {
+	case mqttEntityId::entityBatFaults:
+	case mqttEntityId::entityBatWarnings:
+	case mqttEntityId::entityInverterFaults:
+	case mqttEntityId::entityInverterWarnings:
+	case mqttEntityId::entitySystemFaults:
+	case mqttEntityId::entityFrequency:
+	case mqttEntityId::entityRs485Avail:
+	case mqttEntityId::entityGridAvail:
+		return false;
+	default:
+		return true;
+	}
+}
+
+bool
+buildStateBatchTopic(const char *deviceName,
+                     const char *deviceId,
+                     BucketId bucket,
+                     char *out,
+                     size_t outLen)
+{
+	if (out == nullptr || outLen == 0) {
+		return false;
+	}
+	out[0] = '\0';
+	if (deviceName == nullptr || deviceName[0] == '\0' || deviceId == nullptr || deviceId[0] == '\0') {
+		return false;
+	}
+	const int written = snprintf(out, outLen, "%s/%s/bucket/%s/state", deviceName, deviceId, bucketIdToString(bucket));
+	if (written < 0 || static_cast<size_t>(written) >= outLen) {
+		out[0] = '\0';
+		return false;
+	}
+	return true;
+}
+
+bool
+buildStateBatchValueTemplate(const char *entityKey, char *out, size_t outLen)
+{
+	if (out == nullptr || outLen == 0) {
+		return false;
+	}
+	out[0] = '\0';
+	if (entityKey == nullptr || entityKey[0] == '\0' || strchr(entityKey, '\'') != nullptr) {
+		return false;
+	}
+	// Documents from a split or budget-truncated pass omit most keys; keep the current state for those.
+	const int written = snprintf(out, outLen, "{{ value_json.get('%s', this.state) }}", entityKey);
+	if (written < 0 || static_cast<size_t>(written) >= outLen) {
+		out[0] = '\0';
+		return false;
+	}
+	return true;
+}
+
+size_t
+mqttPublishPacketBytes(size_t topicLen, size_t payloadLen)
+{
+	// Variable header: 2-byte topic length + topic (QoS 0 has no packet id).
+	const size_t remaining = 2 + topicLen + payloadLen;
+	size_t lengthBytes = 1;
+	for (size_t rest = remaining / 128; rest > 0; rest /= 128) {
+		++lengthBytes;
+	}
+	return 1 + lengthBytes + remaining;
+}
@@ -3,6 +3,7 @@
 // Invariants: No Arduino dependencies or dynamic allocations.
 #include "../include/StatusReporting.h"
 #include "../include/MemoryHealth.h"
+#include "../include/CoopScheduler.h"
 
 #include <cstdarg>
 #include <cstdio>
@@ -334,7 +335,13 @@ buildStatusNetJson(const StatusNetSnapshot &snapshot, char *out, size_t outSize)
 		        "\"mqtt_reconnects\":%lu,"
 		        "\"wifi_status\":\"%s\","
 		        "\"wifi_status_code\":%d,"
-		        "\"wifi_reconnects\":%lu"
+		        "\"wifi_reconnects\":%lu,"
+		        "\"history_samples\":%lu,"
+		        "\"history_used_bytes\":%lu,"
+		        "\"history_capacity_bytes\":%lu,"
+		        "\"history_oldest_age_s\":%lu,"
+		        "\"history_dropped\":%lu,"
+		        "\"history_replay_sps\":%lu"
 		        "}"),
 		static_cast<unsigned long>(snapshot.uptimeS),
 		static_cast<unsigned long>(snapshot.freeHeap),
@@ -346,7 +353,13 @@ buildStatusNetJson(const StatusNetSnapshot &snapshot, char *out, size_t outSize)
 		static_cast<unsigned long>(snapshot.mqttReconnects),
 		wifiStatus,
 		snapshot.wifiStatusCode,
-		static_cast<unsigned long>(snapshot.wifiReconnects));
+		static_cast<unsigned long>(snapshot.wifiReconnects),
+		static_cast<unsigned long>(snapshot.historySamples),
+		static_cast<unsigned long>(snapshot.historyUsedBytes),
+		static_cast<unsigned long>(snapshot.historyCapacityBytes),
+		static_cast<unsigned long>(snapshot.historyOldestAgeS),
+		static_cast<unsigned long>(snapshot.historyDropped),
+		static_cast<unsigned long>(snapshot.historyReplaySamplesPerSec));
 	if (written < 0 || static_cast<size_t>(written) >= outSize) {
 		return false;
 	}
@@ -393,6 +406,12 @@ buildStatusPollJson(const StatusPollSnapshot &snapshot, char *out, size_t outSiz
 		    "\"ess_snapshot_attempts\":%lu,"
 		    "\"ess_power_snapshot_last_build_ms\":%lu,"
 		    "\"snapshot_publish_skip_count\":%lu,"
+		    "\"ha_discovery_publish_count\":%lu,"
+		    "\"ha_discovery_skip_count\":%lu,"
+		    "\"mqtt_out_depth\":%lu,"
+		    "\"mqtt_out_max_depth\":%lu,"
+		    "\"mqtt_out_coalesced\":%lu,"
+		    "\"mqtt_out_dropped\":%lu,"
 		    "\"dispatch_last_run_ms\":%lu,"
 		    "\"dispatch_wait_due_to_snapshot_ms\":%lu,"
 		    "\"dispatch_queue_coalesce_count\":%lu,"
@@ -423,6 +442,12 @@ buildStatusPollJson(const StatusPollSnapshot &snapshot, char *out, size_t outSiz
 		    static_cast<unsigned long>(snapshot.essSnapshotAttempts),
 		    static_cast<unsigned long>(snapshot.essPowerSnapshotLastBuildMs),
 		    static_cast<unsigned long>(snapshot.snapshotPublishSkipCount),
+		    static_cast<unsigned long>(snapshot.haDiscoveryPublishCount),
+		    static_cast<unsigned long>(snapshot.haDiscoverySkipCount),
+		    static_cast<unsigned long>(snapshot.mqttOutDepth),
+		    static_cast<unsigned long>(snapshot.mqttOutMaxDepth),
+		    static_cast<unsigned long>(snapshot.mqttOutCoalesced),
+		    static_cast<unsigned long>(snapshot.mqttOutDropped),
 		    static_cast<unsigned long>(snapshot.dispatchLastRunMs),
 		    static_cast<unsigned long>(snapshot.dispatchWaitDueToSnapshotMs),
 		    static_cast<unsigned long>(snapshot.dispatchQueueCoalesceCount),
@@ -1160,3 +1185,34 @@ buildStatusPowerSnapshotDiagCountsJson(const StatusPowerSnapshotDiagCountsSnapsh
 	}
 	return true;
 }
+
+bool
+buildStatusTasksJson(const CoopScheduler &sched, char *out, size_t outSize)
+{
+	if (out == nullptr || outSize == 0) {
+		return false;
+	}
+	size_t used = 0;
+	if (!appendJsonf(out, outSize, used, A2M_FMT("{\"passes\":%lu,\"tasks\":{"),
+	                 static_cast<unsigned long>(sched.passes))) {
+		return false;
+	}
+	for (size_t i = 0; i < sched.count; ++i) {
+		const CoopTask &task = sched.tasks[i];
+		if (!appendJsonf(out,
+		                 outSize,
+		                 used,
+		                 A2M_FMT("%s\"%s\":{\"runs\":%lu,\"cpu_ms\":%lu,\"max_ms\":%lu,"
+		                         "\"overruns\":%lu,\"max_lat_ms\":%lu}"),
+		                 i == 0 ? "" : ",",
+		                 task.name,
+		                 static_cast<unsigned long>(task.stats.runs),
+		                 static_cast<unsigned long>(task.stats.cpuMs),
+		                 static_cast<unsigned long>(task.stats.maxRunMs),
+		                 static_cast<unsigned long>(task.stats.overruns),
+		                 static_cast<unsigned long>(task.stats.maxLatencyMs))) {
+			return false;
+		}
+	}
+	return appendJsonf(out, outSize, used, A2M_FMT("}}"));
+}
@@ -0,0 +1,347 @@
+// Purpose: Delta/varint-encoded block ring for offline telemetry samples and their batched replay.
+#include "../include/TelemetryHistory.h"
+
+#include <cstdio>
+#include <cstring>
+
+namespace {
+
+size_t
+putVarint(uint8_t *out, uint32_t value)
+{
+	size_t len = 0;
+	while (value >= 0x80U) {
+		out[len++] = static_cast<uint8_t>(value | 0x80U);
+		value >>= 7;
+	}
+	out[len++] = static_cast<uint8_t>(value);
+	return len;
+}
+
+bool
+getVarint(const uint8_t *data, size_t size, size_t &pos, uint32_t &value)
+{
+	value = 0;
+	for (uint32_t shift = 0; shift < 35; shift += 7) {
+		if (pos >= size) {
+			return false;
+		}
+		const uint8_t byte = data[pos++];
+		value |= static_cast<uint32_t>(byte & 0x7FU) << shift;
+		if ((byte & 0x80U) == 0) {
+			return true;
+		}
+	}
+	return false;
+}
+
+uint32_t
+zigzag(int32_t value)
+{
+	return (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31);
+}
+
+int32_t
+unzigzag(uint32_t value)
+{
+	return static_cast<int32_t>((value >> 1) ^ (~(value & 1U) + 1U));
+}
+
+// Shared by encoder and decoder so both sides agree on each record's delta base.
+struct DeltaTable {
+	uint16_t *keys;
+	int32_t *values;
+	uint8_t *count;
+
+	int32_t
+	baseFor(uint16_t key, int32_t **slot) const
+	{
+		for (uint8_t i = 0; i < *count; ++i) {
+			if (keys[i] == key) {
+				*slot = &values[i];
+				return values[i];
+			}
+		}
+		*slot = nullptr;
+		if (*count < kTelemetryHistoryDeltaKeys) {
+			keys[*count] = key;
+			values[*count] = 0;
+			*slot = &values[*count];
+			(*count)++;
+		}
+		return 0;
+	}
+};
+
+TelemetryHistoryBlock &
+tailBlock(TelemetryHistory &history)
+{
+	return history.blocks[(history.head + history.count - 1) % kTelemetryHistoryBlockCount];
+}
+
+void
+startBlock(TelemetryHistory &history, uint32_t nowMs)
+{
+	if (history.count == kTelemetryHistoryBlockCount) {
+		history.stats.dropped += history.blocks[history.head].samples;
+		history.head = static_cast<uint8_t>((history.head + 1) % kTelemetryHistoryBlockCount);
+		history.count--;
+	}
+	history.count++;
+	TelemetryHistoryBlock &block = tailBlock(history);
+	block.baseMs = nowMs;
+	block.lastMs = nowMs;
+	block.used = 0;
+	block.samples = 0;
+	history.deltaKeyCount = 0;
+}
+
+} // namespace
+
+void
+telemetryHistoryInit(TelemetryHistory &history)
+{
+	memset(&history, 0, sizeof(history));
+}
+
+bool
+telemetryHistoryParseValue(const char *text, int32_t *milliValue)
+{
+	if (text == nullptr || milliValue == nullptr) {
+		return false;
+	}
+	const char *p = text;
+	const bool negative = (*p == '-');
+	if (negative || *p == '+') {
+		p++;
+	}
+	int64_t whole = 0;
+	size_t digits = 0;
+	while (*p >= '0' && *p <= '9') {
+		whole = whole * 10 + (*p - '0');
+		digits++;
+		p++;
+		if (whole > INT32_MAX) {
+			return false;
+		}
+	}
+	int64_t fraction = 0;
+	int64_t fractionScale = kTelemetryHistoryValueScale;
+	bool roundUp = false;
+	if (*p == '.') {
+		p++;
+		while (*p >= '0' && *p <= '9') {
+			if (fractionScale > 1) {
+				fractionScale /= 10;
+				fraction += (*p - '0') * fractionScale;
+			} else if (fractionScale == 1) {
+				roundUp = (*p >= '5');
+				fractionScale = 0;
+			}
+			digits++;
+			p++;
+		}
+	}
+	if (digits == 0 || *p != '\0') {
+		return false;
+	}
+	int64_t scaled = whole * kTelemetryHistoryValueScale + fraction + (roundUp ? 1 : 0);
+	if (negative) {
+		scaled = -scaled;
+	}
+	if (scaled > INT32_MAX || scaled < INT32_MIN) {
+		return false;
+	}
+	*milliValue = static_cast<int32_t>(scaled);
+	return true;
+}
+
+size_t
+telemetryHistoryFormatValue(int32_t milliValue, char *out, size_t outSize)
+{
+	if (out == nullptr || outSize == 0) {
+		return 0;
+	}
+	const int64_t value = milliValue;
+	const uint64_t magnitude = static_cast<uint64_t>(value < 0 ? -value : value);
+	const unsigned long whole = static_cast<unsigned long>(magnitude / kTelemetryHistoryValueScale);
+	unsigned fraction = static_cast<unsigned>(magnitude % kTelemetryHistoryValueScale);
+	int written;
+	if (fraction == 0) {
+		written = snprintf(out, outSize, "%s%lu", value < 0 ? "-" : "", whole);
+	} else {
+		int width = 3;
+		while (fraction % 10 == 0) {
+			fraction /= 10;
+			width--;
+		}
+		written = snprintf(out, outSize, "%s%lu.%0*u", value < 0 ? "-" : "", whole, width, fraction);
+	}
+	if (written < 0 || static_cast<size_t>(written) >= outSize) {
+		out[0] = '\0';
+		return 0;
+	}
+	return static_cast<size_t>(written);
+}
+
+bool
+telemetryHistoryRecord(TelemetryHistory &history, uint16_t key, uint32_t nowMs, int32_t milliValue)
+{
+	if (history.count == 0 ||
+	    tailBlock(history).used + kTelemetryHistoryMaxRecordBytes > kTelemetryHistoryBlockBytes) {
+		startBlock(history, nowMs);
+	}
+	TelemetryHistoryBlock &block = tailBlock(history);
+	DeltaTable table{ history.deltaKeys, history.deltaValues, &history.deltaKeyCount };
+	int32_t *slot = nullptr;
+	const int32_t base = table.baseFor(key, &slot);
+	const int32_t delta = static_cast<int32_t>(static_cast<uint32_t>(milliValue) - static_cast<uint32_t>(base));
+
+	uint8_t *out = block.bytes + block.used;
+	size_t len = putVarint(out, key);
+	len += putVarint(out + len, nowMs - block.lastMs);
+	len += putVarint(out + len, zigzag(delta));
+	block.used = static_cast<uint16_t>(block.used + len);
+	block.lastMs = nowMs;
+	block.samples++;
+	if (slot != nullptr) {
+		*slot = milliValue;
+	}
+	history.stats.recorded++;
+	return true;
+}
+
+bool
+telemetryHistoryRecordText(TelemetryHistory &history, uint16_t key, uint32_t nowMs, const char *text)
+{
+	int32_t milliValue = 0;
+	if (!telemetryHistoryParseValue(text, &milliValue)) {
+		history.stats.rejected++;
+		return false;
+	}
+	return telemetryHistoryRecord(history, key, nowMs, milliValue);
+}
+
+uint32_t
+telemetryHistorySampleCount(const TelemetryHistory &history)
+{
+	uint32_t samples = 0;
+	for (uint8_t i = 0; i < history.count; ++i) {
+		samples += history.blocks[(history.head + i) % kTelemetryHistoryBlockCount].samples;
+	}
+	return samples;
+}
+
+size_t
+telemetryHistoryUsedBytes(const TelemetryHistory &history)
+{
+	size_t used = 0;
+	for (uint8_t i = 0; i < history.count; ++i) {
+		used += history.blocks[(history.head + i) % kTelemetryHistoryBlockCount].used;
+	}
+	return used;
+}
+
+size_t
+telemetryHistoryCapacityBytes(void)
+{
+	return kTelemetryHistoryBlockBytes * kTelemetryHistoryBlockCount;
+}
+
+uint32_t
+telemetryHistoryOldestAgeMs(const TelemetryHistory &history, uint32_t nowMs)
+{
+	if (history.count == 0) {
+		return 0;
+	}
+	return nowMs - history.blocks[history.head].baseMs;
+}
+
+size_t
+telemetryHistoryForEachOldest(const TelemetryHistory &history, TelemetryHistorySampleFn fn, void *ctx)
+{
+	if (history.count == 0 || fn == nullptr) {
+		return 0;
+	}
+	const TelemetryHistoryBlock &block = history.blocks[history.head];
+	uint16_t keys[kTelemetryHistoryDeltaKeys];
+	int32_t values[kTelemetryHistoryDeltaKeys];
+	uint8_t keyCount = 0;
+	DeltaTable table{ keys, values, &keyCount };
+
+	TelemetryHistorySample sample{ 0, block.baseMs, 0 };
+	size_t pos = 0;
+	size_t visited = 0;
+	while (pos < block.used) {
+		uint32_t key = 0;
+		uint32_t deltaMs = 0;
+		uint32_t zigzagged = 0;
+		if (!getVarint(block.bytes, block.used, pos, key) ||
+		    !getVarint(block.bytes, block.used, pos, deltaMs) ||
+		    !getVarint(block.bytes, block.used, pos, zigzagged)) {
+			break;
+		}
+		int32_t *slot = nullptr;
+		const int32_t base = table.baseFor(static_cast<uint16_t>(key), &slot);
+		sample.key = static_cast<uint16_t>(key);
+		sample.timestampMs += deltaMs;
+		sample.milliValue =
+			static_cast<int32_t>(static_cast<uint32_t>(base) + static_cast<uint32_t>(unzigzag(zigzagged)));
+		if (slot != nullptr) {
+			*slot = sample.milliValue;
+		}
+		visited++;
+		if (!fn(ctx, sample)) {
+			break;
+		}
+	}
+	return visited;
+}
+
+void
+telemetryHistoryPopOldest(TelemetryHistory &history, uint32_t startedMs, uint32_t nowMs)
+{
+	if (history.count == 0) {
+		return;
+	}
+	const uint16_t samples = history.blocks[history.head].samples;
+	const bool wasTail = (history.count == 1);
+	history.head = static_cast<uint8_t>((history.head + 1) % kTelemetryHistoryBlockCount);
+	history.count--;
+	if (wasTail) {
+		history.deltaKeyCount = 0;
+	}
+	history.stats.replayed += samples;
+
+	if (!history.replaying) {
+		history.replaying = true;
+		history.replayStartMs = startedMs;
+		history.replaySamples = 0;
+	}
+	history.replaySamples += samples;
+	if (history.count == 0) {
+		uint32_t elapsedMs = nowMs - history.replayStartMs;
+		if (elapsedMs == 0) {
+			elapsedMs = 1;
+		}
+		history.stats.lastReplaySamplesPerSec =
+			static_cast<uint32_t>((static_cast<uint64_t>(history.replaySamples) * 1000U) / elapsedMs);
+		history.replaying = false;
+	}
+}
+
+bool
+telemetryHistoryEntityEligible(homeAssistantClass haClass, MqttEntityScope scope, bool subscribe)
+{
+	if (subscribe || scope != MqttEntityScope::Inverter) {
+		return false;
+	}
+	switch (haClass) {
+	case homeAssistantClass::haClassEnergy:
+	case homeAssistantClass::haClassPower:
+	case homeAssistantClass::haClassBattery:
+		return true;
+	default:
+		return false;
+	}
+}
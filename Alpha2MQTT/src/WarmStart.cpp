@@ -0,0 +1,162 @@
+// Purpose: Warm-start record codec, resume decisions and per-boot timing JSON.
+#include "../include/WarmStart.h"
+
+#include <cstdio>
+#include <cstring>
+
+#include "../include/Crc32.h"
+
+namespace {
+
+constexpr uint8_t kWarmStartMagic0 = 'W';
+constexpr uint8_t kWarmStartMagic1 = 'S';
+constexpr uint8_t kWarmStartVersion = 2;
+
+void
+putU32(uint8_t *&out, uint32_t value)
+{
+	for (int shift = 0; shift < 32; shift += 8) {
+		*out++ = static_cast<uint8_t>(value >> shift);
+	}
+}
+
+uint32_t
+getU32(const uint8_t *&in)
+{
+	uint32_t value = 0;
+	for (int shift = 0; shift < 32; shift += 8) {
+		value |= static_cast<uint32_t>(*in++) << shift;
+	}
+	return value;
+}
+
+template <size_t N>
+void
+putText(uint8_t *&out, const char (&text)[N])
+{
+	// Pads with NULs so equal records encode to equal bytes.
+	const size_t len = strnlen(text, N - 1);
+	memcpy(out, text, len);
+	memset(out + len, 0, N - len);
+	out += N;
+}
+
+template <size_t N>
+bool
+getText(const uint8_t *&in, char (&text)[N])
+{
+	memcpy(text, in, N);
+	in += N;
+	return memchr(text, '\0', N) != nullptr;
+}
+
+} // namespace
+
+size_t
+warmStartEncode(const WarmStartRecord &record, uint8_t *out, size_t outSize)
+{
+	if (out == nullptr || outSize < kWarmStartRecordBytes) {
+		return 0;
+	}
+	uint8_t *cursor = out;
+	*cursor++ = kWarmStartMagic0;
+	*cursor++ = kWarmStartMagic1;
+	*cursor++ = kWarmStartVersion;
+	putU32(cursor, record.baud);
+	*cursor++ = record.slaveId;
+	putU32(cursor, record.planFingerprint);
+	putU32(cursor, record.discoveryFingerprint);
+	putText(cursor, record.serial);
+	putText(cursor, record.firmware);
+	putU32(cursor, crc32Ieee(out, static_cast<size_t>(cursor - out)));
+	return kWarmStartRecordBytes;
+}
+
+bool
+warmStartDecode(const uint8_t *in, size_t len, WarmStartRecord &record)
+{
+	if (in == nullptr || len != kWarmStartRecordBytes || in[0] != kWarmStartMagic0 || in[1] != kWarmStartMagic1 ||
+	    in[2] != kWarmStartVersion) {
+		return false;
+	}
+	const uint8_t *crcAt = in + kWarmStartRecordBytes - 4;
+	if (crc32Ieee(in, kWarmStartRecordBytes - 4) != getU32(crcAt)) {
+		return false;
+	}
+	WarmStartRecord decoded{};
+	const uint8_t *cursor = in + 3;
+	decoded.baud = getU32(cursor);
+	decoded.slaveId = *cursor++;
+	decoded.planFingerprint = getU32(cursor);
+	decoded.discoveryFingerprint = getU32(cursor);
+	if (!getText(cursor, decoded.serial) || !getText(cursor, decoded.firmware) || decoded.baud == 0 ||
+	    decoded.serial[0] == '\0') {
+		return false;
+	}
+	record = decoded;
+	return true;
+}
+
+bool
+warmStartRecordEqual(const WarmStartRecord &a, const WarmStartRecord &b)
+{
+	uint8_t encodedA[kWarmStartRecordBytes];
+	uint8_t encodedB[kWarmStartRecordBytes];
+	return warmStartEncode(a, encodedA, sizeof(encodedA)) == kWarmStartRecordBytes &&
+	       warmStartEncode(b, encodedB, sizeof(encodedB)) == kWarmStartRecordBytes &&
+	       memcmp(encodedA, encodedB, kWarmStartRecordBytes) == 0;
+}
+
+bool
+warmStartUsable(const WarmStartRecord &record, uint8_t slaveId)
+{
+	return record.baud != 0 && record.serial[0] != '\0' && record.slaveId == slaveId;
+}
+
+bool
+warmStartVerified(const WarmStartRecord &record, const char *liveSerial)
+{
+	return liveSerial != nullptr && record.serial[0] != '\0' && strcmp(record.serial, liveSerial) == 0;
+}
+
+bool
+warmStartDiscoveryCurrent(const WarmStartRecord &record,
+                          const char *firmware,
+                          uint32_t planFingerprint,
+                          uint32_t discoveryFingerprint)
+{
+	return firmware != nullptr && strcmp(record.firmware, firmware) == 0 &&
+	       record.planFingerprint == planFingerprint && record.discoveryFingerprint == discoveryFingerprint;
+}
+
+const char *
+warmStartOutcomeName(WarmStartOutcome outcome)
+{
+	switch (outcome) {
+	case WarmStartOutcome::Resumed:
+		return "resumed";
+	case WarmStartOutcome::Mismatch:
+		return "mismatch";
+	case WarmStartOutcome::Cold:
+	default:
+		return "cold";
+	}
+}
+
+bool
+buildWarmStartJson(const WarmStartBootStats &stats, char *out, size_t outSize)
+{
+	if (out == nullptr || outSize == 0) {
+		return false;
+	}
+	const int written = snprintf(out,
+	                             outSize,
+	                             "{\"outcome\":\"%s\",\"identity_reads\":%lu,\"rs485_connected_ms\":%lu,"
+	                             "\"first_publish_ms\":%lu,\"discovery_held\":%s}",
+	                             warmStartOutcomeName(stats.outcome),
+	                             static_cast<unsigned long>(stats.identityReads),
+	                             static_cast<unsigned long>(stats.rs485ConnectedMs),
+	                             static_cast<unsigned long>(stats.firstPublishMs),
+	                             stats.discoveryHeld ? "true" : "false");
+	return written >= 0 && static_cast<size_t>(written) < outSize;
+}
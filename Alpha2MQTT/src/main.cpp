@@ -25,21 +25,42 @@ First, go and customise options at the top of Definitions.h!
 #include "../include/BootEvent.h"
 #include "../include/WifiGuard.h"
 #include "../include/WifiRecoveryPolicy.h"
+#include "../include/NetworkReconnect.h"
 #include "../include/BucketScheduler.h"
 #include "../include/MqttEntities.h"
 #include "../include/PortalConfig.h"
 #include "../include/Rs485BaudSync.h"
 #include "../include/ConfigCodec.h"
 #include "../include/DebugLog.h"
+#include "../include/AllocProfiler.h"
 #include "../include/MemoryHealth.h"
+#include "../include/MemoryGovernor.h"
 #include "../include/PollingConfig.h"
+#include "../include/PollingConfigRecord.h"
 #include "../include/PowerSnapshot.h"
 #include "../include/RebootRequest.h"
+#include "../include/SettingsJournal.h"
+#include "../include/WarmStart.h"
 #include "../include/StatusReporting.h"
 #include "../include/StatusLedPolicy.h"
 #include "../include/DiscoveryModel.h"
 #include "../include/DispatchTiming.h"
 #include "../include/DispatchRequest.h"
+#include "../include/InverterFleet.h"
+#include "../include/MultiBusPoller.h"
+#include "../include/BusPlanFeed.h"
+#include "../include/CoopScheduler.h"
+#include "../include/StateBatch.h"
+#include "../include/EntityStateRoute.h"
+#include "../include/HaDeviceDiscovery.h"
+#include "../include/DiscoveryFingerprint.h"
+#include "../include/MqttOutboundQueue.h"
+#include "../include/TelemetryHistory.h"
+#include "../include/MetricLog.h"
+#include "../include/CompactTopic.h"
+#include "../include/EntityTopicCache.h"
+#include "../include/MqttTopicRouter.h"
+#include "../include/ScratchPool.h"
 #include "../include/RawReadRequest.h"
 #include "../include/Rs485ProbeLogic.h"
 #include "../include/Rs485RuntimeReconnect.h"
@@ -86,6 +107,10 @@ First, go and customise options at the top of Definitions.h!
 #ifdef MP_ESPUNO_ESP32C6
 #include <Adafruit_NeoPixel.h>
 #endif // MP_ESPUNO_ESP32C6
+#if METRIC_LOG
+#include <LittleFS.h>
+#include <time.h>
+#endif // METRIC_LOG
 
 #if defined(MP_ESP8266) || defined(ESP8266) || defined(ARDUINO_ARCH_ESP8266)
 using HttpServer = ESP8266WebServer;
@@ -116,6 +141,11 @@ diagYield(void)
 // Device parameters
 char _version[20] = "";
 char deviceSerialNumber[17]; // 8 registers = max 16 chars (usually 15)
+// Inverters sharing the RS485 bus. Slot 0 is the primary inverter that drives deviceSerialNumber.
+InverterFleet g_inverterFleet;
+// Slot the register reads, state topics and discovery payloads currently speak for. Only a
+// secondary inverter's poll turn or discovery pass moves it off slot 0, and both restore it.
+static size_t activeInverterSlot = 0;
 char deviceBatteryType[32];
 char haUniqueId[32] = "A2M-UNKNOWN";
 char controllerIdentifier[40] = "";
@@ -148,9 +178,15 @@ constexpr size_t kStatusJsonScratchSize = MAX_MQTT_PAYLOAD_SIZE;
 // overlap in this storage.
 static char *pendingDeferredControlPayload = nullptr;
 static char *pendingDispatchPayload = nullptr;
-// Status and manual-read JSON publishes are serialized through the single-threaded main loop.
-// Keep one shared scratch buffer instead of reserving multiple independent publish buffers.
-static char *g_statusJsonScratch = nullptr;
+// Status JSON, manual-read JSON, polling-config chunk maps, portal rows and discovery fragments
+// are serialized through the single-threaded main loop, so they lease one block in turn instead
+// of each pinning a buffer. Leases are scoped tightly: sendStatus nests the other publishers.
+static ScratchPool g_textScratchPool{ "text", kStatusJsonScratchSize, nullptr, ScratchPhase::None, {} };
+// Sampled by the "mem_gov" loop task; the policy for its level is applied where the work happens.
+static MemGovernor g_memGovernor{};
+// A config/set was persisted under memory pressure; the runtime plan still has the old schedule.
+static bool g_pollingConfigRebuildDeferred = false;
+static uint32_t g_haDiscoveryLastTurnMs = 0;
 static uint32_t manualRegisterReadSeq = 0;
 static uint32_t rawRegisterReadSeq = 0;
 constexpr uint8_t kDeferredMqttDrainMaxIterations = 16;
@@ -241,9 +277,25 @@ const char kPreferenceInverterLabel[] = "Inverter_Label";
 const char kPreferenceBucketMap[] = "Bucket_Map";
 const char kPreferencePollInterval[] = "poll_interval_s";
 const char kPreferenceRs485Baud[] = "rs485_baud";
+// Comma-separated Modbus slave ids on the bus, primary first (e.g. "85,86"). Absent means ALPHA_SLAVE_ID.
+const char kPreferenceRs485SlaveIds[] = "rs485_slaves";
 const char kPreferenceBucketMapMigrated[] = "Bucket_Map_Migrated";
+// Binary mirror of Bucket_Map (PollingConfigRecord) that lets boot skip the text parse.
+const char kPreferencePollingRecord[] = "Bucket_Rec";
 // Persisted "last polling-config change" timestamp published as polling-config last_change.
 const char kPreferencePollingLastChange[] = "polling_last_change";
+// A/B slots of the write-behind settings journal (SettingsJournal). Keys the journal owns
+// (boot intent/mode, RS485 baud, polling last-change) are read from it before their own keys.
+const char kPreferenceSettingsSlot0[] = "settings_0";
+const char kPreferenceSettingsSlot1[] = "settings_1";
+// WarmStartRecord written after a discovery pass completes with a live inverter identity.
+const char kPreferenceWarmStart[] = "warm_start";
+#if HA_DEVICE_DISCOVERY
+// Set once the legacy per-entity discovery topics were cleared after switching to device discovery.
+const char kPreferenceHaDeviceDiscoveryMigrated[] = "ha_dev_migrated";
+#endif
+// Fingerprints of the retained HA discovery payloads last published (DiscoveryFingerprint blob).
+const char kPreferenceHaDiscoveryFingerprints[] = "ha_fp";
 const char kControllerInverterSerialEntity[] = "inverter_serial";
 const char kControllerModel[] = "Alpha2MQTT Bridge";
 const char kInverterModelFallback[] = "Alpha ESS";
@@ -255,9 +307,16 @@ constexpr size_t kPrefWifiPasswordMaxLen = 64;
 constexpr size_t kPrefMqttServerMaxLen = 64;
 constexpr size_t kPrefMqttUsernameMaxLen = 64;
 constexpr size_t kPrefMqttPasswordMaxLen = 64;
+// A2mConfig (ConfigCodec) mirrors these Preferences buffers field for field.
+static_assert(kPrefWifiSsidMaxLen == kConfigStringMaxLen + 1 && kPrefWifiPasswordMaxLen == kConfigStringMaxLen + 1 &&
+                  kPrefMqttServerMaxLen == kConfigStringMaxLen + 1 && kPrefMqttUsernameMaxLen == kConfigStringMaxLen + 1 &&
+                  kPrefMqttPasswordMaxLen == kConfigStringMaxLen + 1 &&
+                  kPrefInverterLabelMaxLen == kConfigInverterLabelMaxLen + 1,
+              "ConfigCodec string limits must match the Preferences buffers");
 // Stable "name=bucket;" persistence is larger than the old index encoding. Size these
 // buffers for the full current catalog, but keep them off steady-state globals.
 constexpr size_t kPrefBucketMapMaxLen = 4608;
+constexpr size_t kPollingConfigRecordMaxBytes = pollingConfigRecordBytes(kMqttEntityDescriptorCount);
 constexpr size_t kPollingConfigSetPayloadMaxLen = 5120;
 constexpr size_t kPollingConfigChunkMapMaxLen = 1024;
 constexpr size_t kPrefPollingLastChangeMaxLen = 32;
@@ -436,6 +495,9 @@ enum class RuntimeDiagPhase : uint8_t {
 	DispatchReadback,
 	DispatchForcePublish,
 };
+// Allocation profiler phases are RuntimeDiagPhase values.
+static_assert(static_cast<size_t>(RuntimeDiagPhase::DispatchForcePublish) < kAllocProfilerPhaseCount,
+              "RuntimeDiagPhase does not fit the allocation profiler table");
 
 struct RuntimeDiagTracker {
 	bool minimaValid = false;
@@ -462,12 +524,18 @@ struct RuntimeDiagScope {
 	{
 		currentRuntimeDiagPhase = phase;
 		currentRuntimeDiagPayloadKind = (payloadKind != nullptr) ? payloadKind : "";
+#if ALLOC_PROFILER
+		allocProfilerEnterPhase(static_cast<uint8_t>(phase));
+#endif
 	}
 
 	~RuntimeDiagScope()
 	{
 		currentRuntimeDiagPhase = previousPhase;
 		currentRuntimeDiagPayloadKind = previousPayloadKind;
+#if ALLOC_PROFILER
+		allocProfilerEnterPhase(static_cast<uint8_t>(previousPhase));
+#endif
 	}
 };
 
@@ -532,6 +600,21 @@ bool bootstrapPublishPending = false;
 size_t bootstrapPublishCursor = 0;
 uint8_t bootstrapPublishedEntities[kBootstrapPublishBitsetBytes] = {};
 static constexpr size_t kHaDiscoveryBatchSize = 1;
+#if HA_DEVICE_DISCOVERY
+// Device discovery publishes one retained payload per device; resendHaNextEntityIndex then counts
+// devices instead of entities. Legacy per-entity topics are only walked while migrating.
+static bool haLegacyDiscoveryMigrationLoaded = false;
+static bool haLegacyDiscoveryMigrationPending = false;
+static bool haLegacyControllerClearQueued = false;
+static bool haLegacyInverterClearQueued = false;
+#endif
+// Reconnects only republish discovery payloads whose fingerprint changed; HA's birth message and
+// explicit resends clear this so every payload goes out again.
+static bool resendHaSkipUnchanged = false;
+static DiscoveryFingerprintTable *g_discoveryFingerprints = nullptr;
+static bool g_discoveryFingerprintsLoaded = false;
+static uint32_t haDiscoveryPublishCount = 0;
+static uint32_t haDiscoverySkipCount = 0;
 // Human-readable timestamp of the most recent polling-config mutation.
 char _pollingConfigLastChange[32] = "";
 // Bucket ids accepted via /config/set mapping (legacy freq* aliases are still accepted).
@@ -568,9 +651,22 @@ static constexpr BucketId kRuntimeBuckets[] = {
 	BucketId::OneDay,
 	BucketId::User
 };
-size_t schedNextCursor[sizeof(kRuntimeBuckets) / sizeof(kRuntimeBuckets[0])] = {};
+// Each inverter slot walks the bucket plans with its own cursors.
+size_t schedNextCursor[kMaxInvertersPerBus][sizeof(kRuntimeBuckets) / sizeof(kRuntimeBuckets[0])] = {};
 BucketRuntimeBudgetState schedBudgetState[sizeof(kRuntimeBuckets) / sizeof(kRuntimeBuckets[0])] = {};
 uint32_t pollingBudgetOverrunCount = 0;
+// A bucket pass that stopped on a read still out on the RS485 worker. The fleet gives the parked
+// slot the next poll turn, which resumes it at that bucket's cursor before anything else runs, so
+// only one pass owns the bus at a time.
+struct PendingBucketPass {
+	bool active = false;
+	BucketId bucket = BucketId::TenSec;
+	size_t remaining = 0;
+	bool snapshotOk = false;
+};
+static PendingBucketPass pendingBucketPass;
+// How often loop() checks back for the reply while a pass is parked.
+static constexpr uint32_t kRs485ReplyPollMs = 2;
 
 // OLED variables
 char _oledOperatingIndicator = '*';
@@ -718,6 +814,20 @@ static constexpr uint8_t kRs485RecoveryWritePasses = 3;
 static constexpr uint8_t kRs485RecoveryWritesPerBaud = 3;
 static constexpr uint32_t kRs485RecoveryWriteDelayMs = 10;
 
+#if RS485_AUX_BUS
+// Inverter on the second RS485 bus. It has its own handler, baud probe and identity, is driven by the
+// multi-bus poller and publishes in the slot after the primary bus's inverters.
+static RS485Handler *_auxModBus = nullptr;
+static RegisterHandler *_auxRegisterHandler = nullptr;
+static InverterFleet g_auxInverterFleet;
+static MultiBusPoller g_auxBuses;
+static BusPlanFeed g_auxPlanFeed;
+static constexpr size_t kAuxBusLane = 0;
+// Bus time the aux bus may spend per ten-second cycle; the rest is left for link recovery.
+static constexpr uint32_t kAuxBusCycleBudgetMs = 8000;
+static constexpr uint8_t kAuxBusBaudCount = sizeof(kKnownBaudRates) / sizeof(kKnownBaudRates[0]);
+#endif // RS485_AUX_BUS
+
 enum class Rs485ConnectState : uint8_t {
 	NotStarted = 0,
 	ProbingBaud,
@@ -738,8 +848,22 @@ static uint32_t rs485ProbeLastAttemptMs = 0;
 static Rs485RuntimeReconnectTracker rs485RuntimeReconnect{};
 static Rs485BaudTracker rs485BaudTracker{};
 static uint32_t rs485BaudNextActionAtMs = 0;
+static WarmStartRecord g_warmStartRecord{};
+static bool g_warmStartRecordValid = false;
+// Set at RS485 init when the stored record is worth one verification read; cleared once tried.
+static bool g_warmStartVerifyPending = false;
+static WarmStartBootStats g_warmStartStats{};
+static bool g_warmStartDiscoveryHold = false;
+static uint32_t g_warmStartDiscoveryHoldStartMs = 0;
+static bool g_warmStartEventPublished = false;
 
 static bool rs485TryReadIdentityOnce(void);
+static bool rs485TryWarmStartOnce(void);
+static void rs485OnIdentityEstablished(void);
+static uint32_t warmStartPlanFingerprint(void);
+static uint32_t warmStartDiscoveryFingerprint(void);
+static void loadWarmStartRecord(void);
+static void persistWarmStartRecord(void);
 static void rs485ProbeTick(void);
 static void resetRs485ProbeState(unsigned long now);
 static void noteRs485ConnectedEpoch(void);
@@ -777,6 +901,15 @@ static void applyParsedRs485StubControl(const Rs485StubControlRequest &request);
 #define STATUS_INTERVAL_ONE_DAY 86400000
 #define UPDATE_STATUS_BAR_INTERVAL 500
 
+// Sleep between loop() passes until the next scheduled deadline. The cap bounds MQTT/HTTP latency,
+// since those sockets are polled rather than waking the core.
+#ifndef LOOP_IDLE_SLEEP
+#define LOOP_IDLE_SLEEP 1
+#endif
+#ifndef LOOP_IDLE_MAX_SLEEP_MS
+#define LOOP_IDLE_MAX_SLEEP_MS 20
+#endif
+
 #ifndef DISABLE_DISPLAY
 #ifdef LARGE_DISPLAY
 // Pins GPIO22 and GPIO21 (SCL/SDA) if ESP32
@@ -795,10 +928,13 @@ void updateOLED(bool justStatus, const char* line2, const char* line3, const cha
 void configLoop(void);
 void configHandler(void);
 void setupWifi(bool initialConnect);
+void serviceWifiReconnect(void);
 void mqttReconnect(void);
 void mqttCallback(char* topic, byte* message, unsigned int length);
 void sendHaData(void);
 void requestHaDataResend(void);
+void requestHaDataRefresh(void);
+static void forgetDiscoveryFingerprints(void);
 void getA2mOpDataFromEss(void);
 bool refreshEssSnapshot(void);
 static bool refreshEssSnapshotAfterDispatch(bool primeForCurrentSendDataPass);
@@ -830,10 +966,11 @@ static void executeDispatchBlockTransaction(const MqttEntityActiveBucket &bucket
                                             const MqttPollTransaction &transaction);
 static void executePvBlockTransaction(const MqttEntityActiveBucket &bucketPlan,
                                       const MqttPollTransaction &transaction);
-static void executeGenericPollTransaction(const MqttEntityActiveBucket &bucketPlan,
+static bool executeGenericPollTransaction(const MqttEntityActiveBucket &bucketPlan,
                                           const MqttPollTransaction &transaction,
                                           const mqttState &leader);
 void sendData(void);
+static uint32_t sendDataMsUntilDue(uint32_t nowMs);
 void sendStatus(bool includeEssSnapshot);
 static void populateStatusPollSnapshot(StatusPollSnapshot &poll, bool includeEssSnapshot);
 static void populateStatusPowerSnapshotDiagLastSnapshot(StatusPowerSnapshotDiagLastSnapshot &snapshot);
@@ -899,6 +1036,7 @@ static bool readLegacyPollingPref(size_t index,
                                   int &storedValue,
                                   void *context);
 static void dispatchService(void);
+static uint32_t dispatchMsUntilDueNow(uint32_t nowMs);
 static void __attribute__((noinline)) serviceDeferredMqttWork(void);
 static void publishDispatchStateEntity(mqttEntityId entityId);
 static void publishDispatchAuxiliaryStates(bool publishRawTime);
@@ -954,6 +1092,9 @@ const char *discoveryDeviceIdForScope(DiscoveryDeviceScope scope);
 #if RS485_STUB
 static void primeStubRuntimeInverterIdentity(const char *serial);
 #endif
+#if MQTT_OUTBOUND_QUEUE
+static void noteMqttOutboundIdentity(const char *serial);
+#endif
 void publishStatusNow(void);
 void publishEvent(MqttEventCode code, const char *detail);
 MqttEventCode eventCodeFromResult(modbusRequestAndResponseStatusValues result);
@@ -982,8 +1123,8 @@ static void beginWifiStationWithStoredCredentials(void);
 static bool syncPortalWifiCredentials(WiFiManager *wifiManager, const char *ssidHint = nullptr, const char *passHint = nullptr);
 static void persistUserExtAntenna(bool enabled);
 static void persistUserInverterLabel(const char *label);
-static bool persistUserBucketMap(const char *bucketMap);
-static bool persistUserPollingConfig(uint32_t intervalSeconds, const char *bucketMap);
+static bool persistUserBucketMap(const char *bucketMap, const BucketId *buckets);
+static bool persistUserPollingConfig(uint32_t intervalSeconds, const char *bucketMap, const BucketId *buckets);
 static void persistUserPollingLastChange(const char *lastChange);
 static bool resetPollingConfigToDefaults(void);
 static bool resetBucketsToCatalogDefaults(BucketId *buckets, size_t entityCount);
@@ -1058,6 +1199,10 @@ void handleRebootApConfirm(void);
 void handleRebootAp(void);
 static bool portalRequestHasMqttFields(WiFiManager &wifiManager);
 void handleRebootWifi(void);
+#if METRIC_LOG
+void handleHttpHistoryCsv(void);
+static void flushMetricLog(void);
+#endif
 static bool sendRebootHandoffPage(HttpServer *server, BootIntent intent);
 void triggerRestart(void);
 bool subscribeInverterTopics(void);
@@ -1094,9 +1239,9 @@ ensureSharedRuntimeBuffer(char *&buffer, size_t size)
 }
 
 static bool
-ensureStatusJsonScratch(void)
+ensureTextScratchPool(void)
 {
-	return ensureSharedRuntimeBuffer(g_statusJsonScratch, kStatusJsonScratchSize);
+	return scratchPoolReserve(g_textScratchPool);
 }
 
 static bool
@@ -1158,22 +1303,11 @@ runtimePublishTopicScratch(void)
 static bool
 ensureNormalRuntimeBuffers(void)
 {
-	return ensureStatusJsonScratch() &&
+	return ensureTextScratchPool() &&
 	       ensureDeferredControlPayload() &&
 	       ensureDispatchPayload();
 }
 
-static bool
-topicEqualsDeviceSuffix(const char *topic, const char *suffix)
-{
-	if (topic == nullptr || suffix == nullptr || deviceName[0] == '\0') {
-		return false;
-	}
-	const size_t deviceLen = strlen(deviceName);
-	return strncmp(topic, deviceName, deviceLen) == 0 &&
-	       strcmp(topic + deviceLen, suffix) == 0;
-}
-
 static bool
 ensurePortalBucketsScratch(void)
 {
@@ -1200,6 +1334,8 @@ httpServerRef(void)
 	return *g_httpServer;
 }
 
+static EntityTopicCache g_entityTopicCache{};
+
 void
 buildDeviceName(void)
 {
@@ -1208,6 +1344,7 @@ buildDeviceName(void)
 	snprintf(deviceName, sizeof(deviceName), "%s-%02X%02X%02X", DEVICE_NAME, mac[3], mac[4], mac[5]);
 	buildControllerIdentifier(mac, controllerIdentifier, sizeof(controllerIdentifier));
 	snprintf(statusTopic, sizeof(statusTopic), "%s/status", deviceName);
+	entityTopicCacheInvalidate(g_entityTopicCache);
 }
 
 bool
@@ -1216,18 +1353,210 @@ inverterSerialKnown(void)
 	return inverterSerialIsValid(deviceSerialNumber);
 }
 
+static size_t
+primaryBusSlotCount(void)
+{
+	return (g_inverterFleet.count != 0) ? g_inverterFleet.count : 1;
+}
+
+#if RS485_AUX_BUS
+static size_t
+auxInverterSlotIndex(void)
+{
+	return primaryBusSlotCount();
+}
+
+static bool
+activeSlotOnAuxBus(void)
+{
+	return activeInverterSlot == auxInverterSlotIndex();
+}
+#endif // RS485_AUX_BUS
+
+static size_t
+inverterSlotCount(void)
+{
+#if RS485_AUX_BUS
+	return primaryBusSlotCount() + 1;
+#else
+	return primaryBusSlotCount();
+#endif
+}
+
+static const char *
+activeInverterSerial(void)
+{
+	if (activeInverterSlot == 0) {
+		return deviceSerialNumber;
+	}
+#if RS485_AUX_BUS
+	if (activeSlotOnAuxBus()) {
+		return g_auxInverterFleet.slots[0].serial;
+	}
+#endif
+	return g_inverterFleet.slots[activeInverterSlot].serial;
+}
+
+static bool
+activeInverterReady(void)
+{
+	return (activeInverterSlot == 0) ? inverterReady : inverterSerialIsValid(activeInverterSerial());
+}
+
+// Secondary inverters have no label preference; their display names come from the serial.
+static const char *
+activeInverterLabel(void)
+{
+	return (activeInverterSlot == 0) ? appConfig.inverterLabel.c_str() : "";
+}
+
+/*
+ * selectInverterSlot
+ *
+ * Points the publish/discovery context and the register handler at one inverter slot.
+ */
+static void
+selectInverterSlot(size_t index)
+{
+	activeInverterSlot = (index < inverterSlotCount()) ? index : 0;
+#if RS485_AUX_BUS
+	// The aux bus keeps its own register handler; the primary one stays on its current slave.
+	if (activeSlotOnAuxBus()) {
+		return;
+	}
+#endif
+	if (_registerHandler == NULL || g_inverterFleet.count == 0) {
+		return;
+	}
+	const char *serial = activeInverterSerial();
+	_registerHandler->setSlaveId(g_inverterFleet.slots[activeInverterSlot].slaveId);
+	if (serial[0] != '\0' && serial[1] != '\0') {
+		_registerHandler->setSerialNumberPrefix(serial[0], serial[1]);
+	}
+}
+
+// Holds a secondary slot selected for one poll turn or discovery payload; slot 0 is back afterwards.
+class InverterSlotScope {
+public:
+	explicit InverterSlotScope(size_t index) { selectInverterSlot(index); }
+	~InverterSlotScope() { selectInverterSlot(0); }
+	InverterSlotScope(const InverterSlotScope &) = delete;
+	InverterSlotScope &operator=(const InverterSlotScope &) = delete;
+};
+
+/*
+ * inverterSlotPollsEntity
+ *
+ * Secondary inverters publish their own register readings only. Controls, dispatch, identity
+ * bookkeeping and ESS-snapshot derived values stay with the primary inverter.
+ */
+static bool
+secondaryInverterPollsEntity(const mqttState &entity)
+{
+	return entity.scope == MqttEntityScope::Inverter &&
+	       entity.readKind == MqttEntityReadKind::Register &&
+	       !entity.subscribe &&
+	       !entity.needsEssSnapshot &&
+	       !isDispatchBlockReadKey(entity.readKey);
+}
+
+#if RS485_AUX_BUS
+// The aux bus reads one register per transaction, so the PV-string block stays on the primary bus too.
+static bool
+auxBusPollsEntity(const mqttState &entity)
+{
+	return secondaryInverterPollsEntity(entity) && !isPvStringBlockReadKey(entity.readKey);
+}
+#endif // RS485_AUX_BUS
+
+static bool
+inverterSlotPollsEntity(const mqttState &entity)
+{
+	if (activeInverterSlot == 0) {
+		return true;
+	}
+#if RS485_AUX_BUS
+	if (activeSlotOnAuxBus()) {
+		return auxBusPollsEntity(entity);
+	}
+#endif
+	return secondaryInverterPollsEntity(entity);
+}
+
+/*
+ * entityTopicPrefixForScope
+ *
+ * Cached "<deviceName>/<device id>/" prefix for a scope. The inverter prefix follows the active slot's
+ * serial and readiness on its own; identity setters also invalidate it so a label change is picked up.
+ */
+static const EntityTopicPrefix *
+entityTopicPrefixForScope(DiscoveryDeviceScope scope)
+{
+	return entityTopicCachePrefix(g_entityTopicCache,
+	                              scope,
+	                              deviceName,
+	                              controllerIdentifier,
+	                              activeInverterSerial(),
+	                              activeInverterReady());
+}
+
 const char *
 discoveryDeviceIdForScope(DiscoveryDeviceScope scope)
 {
 	if (scope == DiscoveryDeviceScope::Controller) {
 		return controllerIdentifier;
 	}
-	if (!inverterReady || !inverterSerialIsValid(deviceSerialNumber)) {
-		return "";
+	// Empty until the inverter is ready with a valid serial.
+	return entityTopicPrefixForScope(scope)->deviceId;
+}
+
+/*
+ * buildEntityStateTopic
+ *
+ * Topic an entity's state is published on: "<topicBase>/state", or its short "a2/<dev>/<code>"
+ * topic in MQTT_COMPACT_TOPICS builds. Discovery's state_topic goes through here too so both agree.
+ */
+static void
+buildEntityStateTopic(const mqttState *entity, const char *entityKey, const char *topicBase, char *out, size_t outSize)
+{
+#if MQTT_COMPACT_TOPICS
+	if (compactTopicEntityEligible(entity->entityId, entity->subscribe) &&
+	    buildCompactStateTopic(deviceName,
+	                           discoveryDeviceIdForScope(mqttEntityScope(entity->entityId)),
+	                           entityKey,
+	                           out,
+	                           outSize)) {
+		return;
+	}
+#else
+	(void)entity;
+	(void)entityKey;
+#endif
+	snprintf(out, outSize, "%s/state", topicBase);
+}
+
+/*
+ * composeEntityStateTopic
+ *
+ * Hot-path variant of buildEntityStateTopic(): copies the cached scope prefix, the flash-resident
+ * entity name and "/state" instead of formatting the topic base for every publish.
+ */
+static bool
+composeEntityStateTopic(const mqttState *entity,
+                        const char *entityKey,
+                        const EntityTopicPrefix &prefix,
+                        char *out,
+                        size_t outSize)
+{
+#if MQTT_COMPACT_TOPICS
+	if (compactTopicEntityEligible(entity->entityId, entity->subscribe) &&
+	    buildCompactStateTopic(deviceName, prefix.deviceId, entityKey, out, outSize)) {
+		return true;
 	}
-	static char inverterIdentifier[64];
-	buildInverterIdentifier(deviceSerialNumber, inverterIdentifier, sizeof(inverterIdentifier));
-	return inverterIdentifier;
+#else
+	(void)entityKey;
+#endif
+	return entityTopicCompose(prefix, entity, "/state", out, outSize) > 0;
 }
 
 static bool
@@ -1314,6 +1643,10 @@ setMqttIdentifiersFromSerial(const char *serial)
 	}
 
 	buildInverterHaUniqueId(serial, haUniqueId, sizeof(haUniqueId));
+	entityTopicCacheInvalidate(g_entityTopicCache);
+#if MQTT_OUTBOUND_QUEUE
+	noteMqttOutboundIdentity(serial);
+#endif
 	// Subscriptions are bound to the HA unique id; if identity changes from unknown/persisted, resubscribe.
 	inverterSubscriptionsSet = false;
 	inverterCommandSubscriptionsSet = false;
@@ -1325,8 +1658,13 @@ static void
 clearRuntimeInverterIdentity(void)
 {
 	deviceSerialNumber[0] = '\0';
+	inverterFleetSetSerial(g_inverterFleet, 0, nullptr);
 	strlcpy(haUniqueId, "A2M-UNKNOWN", sizeof(haUniqueId));
 	inverterReady = false;
+	entityTopicCacheInvalidate(g_entityTopicCache);
+#if MQTT_OUTBOUND_QUEUE
+	noteMqttOutboundIdentity(nullptr);
+#endif
 	inverterSubscriptionsSet = false;
 	inverterCommandSubscriptionsSet = false;
 	inverterDispatchSubscriptionSet = false;
@@ -1357,6 +1695,7 @@ primeStubRuntimeInverterIdentity(const char *serial)
 	}
 	const bool serialChanged = strcmp(deviceSerialNumber, serial) != 0;
 	strlcpy(deviceSerialNumber, serial, sizeof(deviceSerialNumber));
+	inverterFleetSetSerial(g_inverterFleet, 0, deviceSerialNumber);
 	if (_registerHandler != NULL) {
 		_registerHandler->setSerialNumberPrefix(deviceSerialNumber[0], deviceSerialNumber[1]);
 	}
@@ -1403,6 +1742,7 @@ applyLiveInverterIdentity(const char *serial)
 		(haUniqueId[0] == '\0') || (strcmp(haUniqueId, "A2M-UNKNOWN") == 0);
 
 	strlcpy(deviceSerialNumber, serial, sizeof(deviceSerialNumber));
+	inverterFleetSetSerial(g_inverterFleet, 0, deviceSerialNumber);
 	if (_registerHandler != NULL) {
 		_registerHandler->setSerialNumberPrefix(deviceSerialNumber[0], deviceSerialNumber[1]);
 	}
@@ -1509,6 +1849,7 @@ queueStaleInverterDiscoveryClear(const char *deviceId)
 	if (deviceId == nullptr || deviceId[0] == '\0') {
 		return;
 	}
+	forgetDiscoveryFingerprints();
 	for (size_t i = 0; i < resendHaClearStaleInverterQueueCount; ++i) {
 		if (strcmp(resendHaClearStaleInverterDeviceIds[i], deviceId) == 0) {
 			resendHaClearStaleInverterPending = true;
@@ -1534,6 +1875,7 @@ queueStaleControllerDiscoveryClear(const char *deviceId)
 	if (!ensureControllerDiscoveryClearScratch()) {
 		return;
 	}
+	forgetDiscoveryFingerprints();
 	for (size_t i = 0; i < resendHaClearStaleControllerQueueCount; ++i) {
 		if (strcmp(g_controllerDiscoveryClearScratch->deviceIds[i], deviceId) == 0) {
 			resendHaClearStaleControllerPending = true;
@@ -1629,6 +1971,41 @@ publishBootNetEventOncePerBoot(void)
 	}
 }
 
+// Time-to-first-publish for this boot, sent once the first inverter telemetry value went out.
+static void
+publishBootWarmEventOncePerBoot(void)
+{
+	if (g_warmStartEventPublished || !_mqtt.connected() || g_warmStartStats.firstPublishMs == 0) {
+		return;
+	}
+
+	char bootWarmTopic[160];
+	char payload[160];
+	if (!buildWarmStartJson(g_warmStartStats, payload, sizeof(payload))) {
+		return;
+	}
+
+	snprintf(bootWarmTopic, sizeof(bootWarmTopic), "%s/boot/warm", deviceName);
+	if (publishTrackedTextPayload(bootWarmTopic, payload, MQTT_RETAIN)) {
+		g_warmStartEventPublished = true;
+	}
+}
+
+// Milliseconds a resumed boot still lets telemetry go ahead of the unchanged discovery refresh.
+static uint32_t
+warmStartDiscoveryHoldRemainingMs(uint32_t nowMs)
+{
+	if (!g_warmStartDiscoveryHold) {
+		return 0;
+	}
+	const uint32_t sinceMs = nowMs - g_warmStartDiscoveryHoldStartMs;
+	if (g_warmStartStats.firstPublishMs != 0 || sinceMs >= kWarmStartDiscoveryHoldMs) {
+		g_warmStartDiscoveryHold = false;
+		return 0;
+	}
+	return kWarmStartDiscoveryHoldMs - sinceMs;
+}
+
 	#if defined(DEBUG_OVER_SERIAL)
 static void
 buildHeapTag(const char *label, char *out, size_t outSize)
@@ -1902,6 +2279,11 @@ isMqttPumpBlocked(void)
 	if (_modBus != nullptr && _modBus->inTransaction()) {
 		return true;
 	}
+#if RS485_AUX_BUS
+	if (_auxModBus != nullptr && _auxModBus->inTransaction()) {
+		return true;
+	}
+#endif
 	return false;
 }
 
@@ -1939,6 +2321,96 @@ serviceRs485Hooks(void)
 	}
 }
 
+// Counts the Modbus reads the first connection of this boot needed (published in boot/warm).
+static void
+noteWarmStartIdentityRead(void)
+{
+	if (g_warmStartStats.rs485ConnectedMs == 0) {
+		g_warmStartStats.identityReads++;
+	}
+}
+
+// Battery type is helpful for diagnostics, but it is not required to establish inverter identity.
+static void
+rs485ReadBatteryTypeOnce(modbusRequestAndResponse *response)
+{
+	*response = modbusRequestAndResponse{};
+	const modbusRequestAndResponseStatusValues result =
+		_registerHandler->readHandledRegister(REG_BATTERY_HOME_R_BATTERY_TYPE, response);
+	if (result == modbusRequestAndResponseStatusValues::readDataRegisterSuccess &&
+	    response->dataValueFormatted[0] != '\0') {
+		strlcpy(deviceBatteryType, response->dataValueFormatted, sizeof(deviceBatteryType));
+	}
+}
+
+// Reads the serial once at the recorded baud. Only a match with the recorded serial resumes;
+// identity and battery type are still taken from live reads.
+static bool
+rs485TryWarmStartOnce(void)
+{
+	if (_modBus == NULL || _registerHandler == NULL) {
+		return false;
+	}
+	modbusRequestAndResponse *response = runtimeModbusReadScratch();
+	if (response == nullptr) {
+		return false;
+	}
+
+	_modBus->setBaudRate(g_warmStartRecord.baud);
+	*response = modbusRequestAndResponse{};
+	const modbusRequestAndResponseStatusValues result =
+		_registerHandler->readHandledRegister(REG_SYSTEM_INFO_R_EMS_SN_BYTE_1_2, response);
+	if (result != modbusRequestAndResponseStatusValues::readDataRegisterSuccess ||
+	    !warmStartVerified(g_warmStartRecord, response->dataValueFormatted) ||
+	    !applyLiveInverterIdentity(response->dataValueFormatted)) {
+		return false;
+	}
+	rs485LockedBaud = g_warmStartRecord.baud;
+	rs485IdentityReadFailureCount = 0;
+	// The record only says where to look; a swapped battery must still show up on this boot.
+	rs485ReadBatteryTypeOnce(response);
+	g_warmStartStats.outcome = WarmStartOutcome::Resumed;
+
+#ifdef DEBUG_OVER_SERIAL
+	snprintf(_debugOutput, sizeof(_debugOutput), "Warm start resumed: %lu %s", rs485LockedBaud, deviceSerialNumber);
+	Serial.println(_debugOutput);
+#endif
+	return true;
+}
+
+static void
+rs485OnIdentityEstablished(void)
+{
+	rs485ConnectState = Rs485ConnectState::Connected;
+	rs485AttemptsInCycle = 0;
+	rs485CycleBackoffMs = kRs485ProbeAttemptDelayMs;
+	noteRs485ConnectedEpoch();
+
+	// Now that inverter identity is known, discovery/config can be published under the real HA unique id.
+	// If a deferred config/set payload is already queued, let loop() apply that first instead of
+	// reusing the shared bucket-map scratch and clobbering the pending MQTT command.
+	if (shouldReloadPollingConfigFromStorage(pendingPollingConfigSet, pollingConfigLoadedFromStorage)) {
+		loadPollingConfig();
+	}
+	requestHaDataRefresh();
+	resendAllData = true;
+
+	if (g_warmStartStats.rs485ConnectedMs == 0) {
+		const uint32_t nowMs = millis();
+		g_warmStartStats.rs485ConnectedMs = nowMs;
+		// An unchanged discovery surface republishes nothing, so the first telemetry goes out ahead of it.
+		if (g_warmStartStats.outcome == WarmStartOutcome::Resumed &&
+		    warmStartDiscoveryCurrent(g_warmStartRecord,
+		                              _version,
+		                              warmStartPlanFingerprint(),
+		                              warmStartDiscoveryFingerprint())) {
+			g_warmStartStats.discoveryHeld = true;
+			g_warmStartDiscoveryHold = true;
+			g_warmStartDiscoveryHoldStartMs = nowMs;
+		}
+	}
+}
+
 static bool
 rs485TryReadIdentityOnce(void)
 {
@@ -1963,14 +2435,7 @@ rs485TryReadIdentityOnce(void)
 		return false;
 	}
 	rs485IdentityReadFailureCount = 0;
-
-	// Battery type is helpful for diagnostics, but it is not required to establish inverter identity.
-	*response = modbusRequestAndResponse{};
-	result = _registerHandler->readHandledRegister(REG_BATTERY_HOME_R_BATTERY_TYPE, response);
-	if (result == modbusRequestAndResponseStatusValues::readDataRegisterSuccess &&
-	    response->dataValueFormatted[0] != '\0') {
-		strlcpy(deviceBatteryType, response->dataValueFormatted, sizeof(deviceBatteryType));
-	}
+	rs485ReadBatteryTypeOnce(response);
 
 #ifdef DEBUG_OVER_SERIAL
 	snprintf(_debugOutput, sizeof(_debugOutput), "Inverter identified: %s", deviceSerialNumber);
@@ -2040,20 +2505,9 @@ rs485ProbeTick(void)
 
 	if (rs485ConnectState == Rs485ConnectState::ReadingIdentity) {
 		rs485ProbeLastAttemptMs = now;
+		noteWarmStartIdentityRead();
 		if (rs485TryReadIdentityOnce()) {
-			rs485ConnectState = Rs485ConnectState::Connected;
-			rs485AttemptsInCycle = 0;
-			rs485CycleBackoffMs = kRs485ProbeAttemptDelayMs;
-			noteRs485ConnectedEpoch();
-
-			// Now that inverter identity is known, discovery/config can be published under the real HA unique id.
-			// If a deferred config/set payload is already queued, let loop() apply that first instead of
-			// reusing the shared bucket-map scratch and clobbering the pending MQTT command.
-			if (shouldReloadPollingConfigFromStorage(pendingPollingConfigSet, pollingConfigLoadedFromStorage)) {
-				loadPollingConfig();
-			}
-			requestHaDataResend();
-			resendAllData = true;
+			rs485OnIdentityEstablished();
 			return;
 		}
 		rs485IdentityReadFailureCount++;
@@ -2074,8 +2528,23 @@ rs485ProbeTick(void)
 		return;
 	}
 
+	if (g_warmStartVerifyPending) {
+		// One read at the recorded baud decides between resuming and the full probe below.
+		g_warmStartVerifyPending = false;
+		rs485ProbeLastAttemptMs = now;
+		noteWarmStartIdentityRead();
+		if (rs485TryWarmStartOnce()) {
+			rs485OnIdentityEstablished();
+			return;
+		}
+		g_warmStartStats.outcome = WarmStartOutcome::Mismatch;
+		rs485NextAttemptAtMs = now + kRs485ProbeAttemptDelayMs;
+		return;
+	}
+
 	// ProbingBaud: try one baud per tick, and back off between full cycles.
 	rs485ProbeLastAttemptMs = now;
+	noteWarmStartIdentityRead();
 	rs485BaudIndex = rs485NextIndex(rs485BaudIndex, static_cast<int>(sizeof(kKnownBaudRates) / sizeof(kKnownBaudRates[0])));
 	const unsigned long baud = kKnownBaudRates[rs485BaudIndex];
 	char baudRateString[10] = "";
@@ -2141,6 +2610,55 @@ rs485ProbeTick(void)
 	}
 }
 
+class PreferencesSettingsStore : public SettingsStore {
+public:
+	size_t readSlot(uint8_t slot, uint8_t *out, size_t outSize) override
+	{
+		const char *key = (slot & 1U) ? kPreferenceSettingsSlot1 : kPreferenceSettingsSlot0;
+		Preferences preferences;
+		if (!preferences.begin(DEVICE_NAME, true)) {
+			return 0;
+		}
+		size_t len = preferences.isKey(key) ? preferences.getBytesLength(key) : 0;
+		if (len > outSize || (len != 0 && preferences.getBytes(key, out, len) != len)) {
+			len = 0;
+		}
+		preferences.end();
+		return len;
+	}
+
+	bool writeSlot(uint8_t slot, const uint8_t *data, size_t len) override
+	{
+		const char *key = (slot & 1U) ? kPreferenceSettingsSlot1 : kPreferenceSettingsSlot0;
+		Preferences preferences;
+		if (!preferences.begin(DEVICE_NAME, false)) {
+			return false;
+		}
+		const bool ok = preferences.putBytes(key, data, len) == len;
+		preferences.end();
+		return ok;
+	}
+};
+
+static PreferencesSettingsStore g_settingsStore;
+static SettingsJournal g_settingsJournal;
+
+// Must run before anything reads or writes a key the journal owns.
+static void
+loadSettingsJournal(void)
+{
+	settingsJournalInit(g_settingsJournal);
+	settingsJournalLoad(g_settingsJournal, g_settingsStore);
+}
+
+static void
+flushSettingsJournal(void)
+{
+	if (settingsJournalPending(g_settingsJournal) != 0) {
+		settingsJournalFlush(g_settingsJournal, g_settingsStore);
+	}
+}
+
 class PreferencesBootStore : public RebootRequestStore {
 public:
 	void writeBootIntent(BootIntent intent) override
@@ -2159,6 +2677,10 @@ PreferencesBootStore rebootStore;
 void
 triggerRestart(void)
 {
+#if METRIC_LOG
+	flushMetricLog();
+#endif
+	flushSettingsJournal();
 	ESP.restart();
 }
 
@@ -2294,6 +2816,9 @@ setupHttpControlPlane(void)
 	httpServerRef().on("/reboot/ap", HTTP_GET, handleRebootApConfirm);
 	httpServerRef().on("/reboot/ap", HTTP_POST, handleRebootAp);
 	httpServerRef().on("/reboot/wifi", HTTP_POST, handleRebootWifi);
+#if METRIC_LOG
+	httpServerRef().on("/history.csv", HTTP_GET, handleHttpHistoryCsv);
+#endif
 	httpServerRef().begin();
 	httpControlPlaneEnabled = true;
 	if (bootNetDiagState.httpStartedMs == 0) {
@@ -2515,7 +3040,8 @@ publishStatusNow(void)
 static bool
 publishStatusCoreNow(void)
 {
-	if (!_mqtt.connected() || !ensureStatusJsonScratch()) {
+	ScratchLease json(g_textScratchPool, ScratchPhase::StatusJson, kStatusJsonScratchSize);
+	if (!_mqtt.connected() || !json.ok()) {
 		return false;
 	}
 
@@ -2529,12 +3055,12 @@ publishStatusCoreNow(void)
 	core.httpControlPlaneEnabled = httpControlPlaneEnabled;
 	core.haUniqueId = inverterReady ? haUniqueId : "A2M-UNKNOWN";
 
-	if (!buildStatusCoreJson(core, g_statusJsonScratch, kStatusJsonScratchSize)) {
+	if (!buildStatusCoreJson(core, json.chars(), json.size())) {
 		return false;
 	}
 
 	RuntimeDiagScope diagScope(RuntimeDiagPhase::StatusPublish, "core");
-	if (!publishTrackedTextPayload(statusTopic, g_statusJsonScratch, MQTT_RETAIN)) {
+	if (!publishTrackedTextPayload(statusTopic, json.chars(), MQTT_RETAIN)) {
 		return false;
 	}
 	maybeYield();
@@ -2629,6 +3155,7 @@ classifyRs485Error(modbusRequestAndResponseStatusValues result)
 	case modbusRequestAndResponseStatusValues::payloadExceededCapacity:
 	case modbusRequestAndResponseStatusValues::addedToPayload:
 	case modbusRequestAndResponseStatusValues::readDataInvalidValue:
+	case modbusRequestAndResponseStatusValues::responsePending:
 		return Rs485ErrorClass::None;
 	default:
 		return Rs485ErrorClass::Other;
@@ -2680,16 +3207,23 @@ persistUserConfiguredRs485Baud(uint32_t baud)
 	if (!rs485BaudValueSupported(baud)) {
 		return false;
 	}
+	if (settingsJournalPutUInt(g_settingsJournal, kPreferenceRs485Baud, baud, millis())) {
+		return true;
+	}
 	Preferences preferences;
 	preferences.begin(DEVICE_NAME, false);
 	const bool ok = preferences.putUInt(kPreferenceRs485Baud, baud) == sizeof(uint32_t);
 	preferences.end();
+	settingsJournalNoteWrite(g_settingsJournal, kPreferenceRs485Baud);
 	return ok;
 }
 
 static bool
 clearUserConfiguredRs485Baud(void)
 {
+	if (settingsJournalRemove(g_settingsJournal, kPreferenceRs485Baud, millis())) {
+		return true;
+	}
 	Preferences preferences;
 	preferences.begin(DEVICE_NAME, false);
 	bool ok = true;
@@ -2703,11 +3237,16 @@ clearUserConfiguredRs485Baud(void)
 static bool
 loadConfiguredRs485Baud(uint32_t &baudOut, bool &hasConfiguredOut)
 {
-	Preferences preferences;
-	preferences.begin(DEVICE_NAME, true);
-	const bool hasKey = preferences.isKey(kPreferenceRs485Baud);
-	const uint32_t storedBaud = preferences.getUInt(kPreferenceRs485Baud, 0);
-	preferences.end();
+	uint32_t storedBaud = 0;
+	const SettingsLookup journaled = settingsJournalGetUInt(g_settingsJournal, kPreferenceRs485Baud, storedBaud);
+	bool hasKey = (journaled == SettingsLookup::Present);
+	if (journaled == SettingsLookup::Missing) {
+		Preferences preferences;
+		preferences.begin(DEVICE_NAME, true);
+		hasKey = preferences.isKey(kPreferenceRs485Baud);
+		storedBaud = preferences.getUInt(kPreferenceRs485Baud, 0);
+		preferences.end();
+	}
 	if (!rs485BaudStoredValueUsable(hasKey, storedBaud)) {
 		baudOut = 0;
 		hasConfiguredOut = false;
@@ -2718,6 +3257,25 @@ loadConfiguredRs485Baud(uint32_t &baudOut, bool &hasConfiguredOut)
 	return true;
 }
 
+static void
+loadConfiguredInverterFleet(void)
+{
+	char stored[kInverterSlaveIdListMaxLen] = "";
+	Preferences preferences;
+	preferences.begin(DEVICE_NAME, true);
+	if (preferences.isKey(kPreferenceRs485SlaveIds)) {
+		preferences.getString(kPreferenceRs485SlaveIds, stored, sizeof(stored));
+	}
+	preferences.end();
+
+	uint8_t ids[kMaxInvertersPerBus];
+	const size_t count = parseInverterSlaveIdList(stored, ids, kMaxInvertersPerBus);
+	if (count == 0 || !inverterFleetInit(g_inverterFleet, ids, count)) {
+		const uint8_t fallback = ALPHA_SLAVE_ID;
+		inverterFleetInit(g_inverterFleet, &fallback, 1);
+	}
+}
+
 static bool
 readLiveRs485Baud(uint32_t &baudOut, modbusRequestAndResponseStatusValues *resultOut, const char **detailOut)
 {
@@ -2870,19 +3428,28 @@ serviceRs485BaudReconcile(void)
 static void
 persistUserBootIntent(BootIntent intent)
 {
+	// triggerRestart() flushes the journal, so a requested mode survives the reboot it asks for.
+	if (settingsJournalPutString(g_settingsJournal, kPreferenceBootIntent, bootIntentToString(intent), millis())) {
+		return;
+	}
 	Preferences preferences;
 	preferences.begin(DEVICE_NAME, false);
 	preferences.putString(kPreferenceBootIntent, bootIntentToString(intent));
 	preferences.end();
+	settingsJournalNoteWrite(g_settingsJournal, kPreferenceBootIntent);
 }
 
 static void
 persistUserBootMode(BootMode mode)
 {
+	if (settingsJournalPutString(g_settingsJournal, kPreferenceBootMode, bootModeToString(mode), millis())) {
+		return;
+	}
 	Preferences preferences;
 	preferences.begin(DEVICE_NAME, false);
 	preferences.putString(kPreferenceBootMode, bootModeToString(mode));
 	preferences.end();
+	settingsJournalNoteWrite(g_settingsJournal, kPreferenceBootMode);
 }
 
 static void
@@ -3134,8 +3701,70 @@ persistUserInverterLabel(const char *label)
 	preferences.end();
 }
 
+// Size the storage reports for Bucket_Map, 0 when absent. A metadata probe, so binding the binary
+// record to it costs no read of the text.
+static size_t
+storedBucketMapSize(Preferences &preferences)
+{
+	return preferences.isKey(kPreferenceBucketMap)
+	           ? preferenceStringBufferLen(preferences, kPreferenceBucketMap, SIZE_MAX)
+	           : 0;
+}
+
+// Call after Bucket_Map holds the text for buckets; null buckets drop the record. Best effort: a
+// torn record fails its CRC, and one that cannot be written is removed so an older record of the
+// same text size is never trusted. Either way the next boot parses Bucket_Map and rebuilds it.
+static void
+putPollingConfigRecord(Preferences &preferences, const BucketId *buckets, size_t entityCount)
+{
+	uint8_t record[kPollingConfigRecordMaxBytes];
+	const size_t recordLen = pollingConfigRecordEncode(buckets,
+	                                                   entityCount,
+	                                                   mqttEntityCatalogFingerprint(entityCount),
+	                                                   storedBucketMapSize(preferences),
+	                                                   record,
+	                                                   sizeof(record));
+	if (recordLen != 0 && preferences.putBytes(kPreferencePollingRecord, record, recordLen) == recordLen) {
+		settingsJournalNoteWrite(g_settingsJournal, kPreferencePollingRecord);
+		return;
+	}
+	if (preferences.isKey(kPreferencePollingRecord)) {
+		preferences.remove(kPreferencePollingRecord);
+	}
+}
+
+static void
+persistPollingConfigRecord(const BucketId *buckets, size_t entityCount)
+{
+	Preferences preferences;
+	if (!preferences.begin(DEVICE_NAME, false)) {
+		return;
+	}
+	putPollingConfigRecord(preferences, buckets, entityCount);
+	preferences.end();
+}
+
+static PollingConfigRecordStatus
+loadPollingConfigRecord(Preferences &preferences, size_t entityCount, BucketId *buckets)
+{
+	if (!preferences.isKey(kPreferencePollingRecord)) {
+		return PollingConfigRecordStatus::Stale;
+	}
+	// Records from a larger catalog cannot apply here, so they never need a bigger buffer.
+	uint8_t record[kPollingConfigRecordMaxBytes];
+	const size_t recordLen = preferences.getBytesLength(kPreferencePollingRecord);
+	if (recordLen == 0 || recordLen > sizeof(record)) {
+		return PollingConfigRecordStatus::Stale;
+	}
+	if (preferences.getBytes(kPreferencePollingRecord, record, recordLen) != recordLen) {
+		return PollingConfigRecordStatus::Corrupt;
+	}
+	return pollingConfigRecordDecode(
+		record, recordLen, entityCount, mqttEntityCatalogFingerprint, storedBucketMapSize(preferences), buckets);
+}
+
 static bool
-persistUserBucketMap(const char *bucketMap)
+persistUserBucketMap(const char *bucketMap, const BucketId *buckets)
 {
 	Preferences preferences;
 	if (!preferences.begin(DEVICE_NAME, false)) {
@@ -3151,15 +3780,21 @@ persistUserBucketMap(const char *bucketMap)
 	} else {
 		ok = preferences.putString(kPreferenceBucketMap, safeBucketMap) == bucketMapLen;
 	}
+	settingsJournalNoteWrite(g_settingsJournal, kPreferenceBucketMap);
 	if (ok) {
 		ok = preferences.putBool(kPreferenceBucketMapMigrated, true) == sizeof(uint8_t);
 	}
+	if (ok) {
+		putPollingConfigRecord(preferences, buckets, mqttEntitiesCount());
+	}
 	preferences.end();
 	return ok;
 }
 
+// buckets, when given, are the assignments bucketMap encodes and refresh the binary record; without
+// them the record is dropped and the next boot parses the new text.
 static bool
-persistUserPollingConfig(uint32_t intervalSeconds, const char *bucketMap)
+persistUserPollingConfig(uint32_t intervalSeconds, const char *bucketMap, const BucketId *buckets)
 {
 	Preferences preferences;
 	if (!preferences.begin(DEVICE_NAME, false)) {
@@ -3183,6 +3818,7 @@ persistUserPollingConfig(uint32_t intervalSeconds, const char *bucketMap)
 	}
 	const bool originalBucketMapMigrated = updateBucketMap ? preferences.getBool(kPreferenceBucketMapMigrated, false) : false;
 	bool ok = preferences.putUInt(kPreferencePollInterval, intervalSeconds) == sizeof(uint32_t);
+	settingsJournalNoteWrite(g_settingsJournal, kPreferencePollInterval);
 	if (updateBucketMap) {
 		const char *safeBucketMap = bucketMap;
 		const size_t bucketMapLen = strlen(safeBucketMap);
@@ -3193,6 +3829,7 @@ persistUserPollingConfig(uint32_t intervalSeconds, const char *bucketMap)
 			} else {
 				ok = preferences.putString(kPreferenceBucketMap, safeBucketMap) == bucketMapLen;
 			}
+			settingsJournalNoteWrite(g_settingsJournal, kPreferenceBucketMap);
 		}
 		if (ok) {
 			ok = preferences.putBool(kPreferenceBucketMapMigrated, true) == sizeof(uint8_t);
@@ -3208,6 +3845,8 @@ persistUserPollingConfig(uint32_t intervalSeconds, const char *bucketMap)
 			}
 			preferences.putBool(kPreferenceBucketMapMigrated, originalBucketMapMigrated);
 		}
+	} else if (updateBucketMap) {
+		putPollingConfigRecord(preferences, buckets, mqttEntitiesCount());
 	}
 	preferences.end();
 	return ok;
@@ -3219,6 +3858,9 @@ persistUserPollingLastChange(const char *lastChange)
 	if (lastChange == nullptr || *lastChange == '\0') {
 		return;
 	}
+	if (settingsJournalPutString(g_settingsJournal, kPreferencePollingLastChange, lastChange, millis())) {
+		return;
+	}
 
 	Preferences preferences;
 	char stored[kPrefPollingLastChangeMaxLen] = "";
@@ -3226,6 +3868,7 @@ persistUserPollingLastChange(const char *lastChange)
 	preferences.getString(kPreferencePollingLastChange, stored, sizeof(stored));
 	if (strcmp(stored, lastChange) != 0) {
 		preferences.putString(kPreferencePollingLastChange, lastChange);
+		settingsJournalNoteWrite(g_settingsJournal, kPreferencePollingLastChange);
 	}
 	preferences.end();
 }
@@ -3259,7 +3902,7 @@ recoverPollingConfigLoadToDefaults(const char *context,
 	}
 	const bool resetPersisted = shouldResetPersistedPollingConfig(failureKind);
 	const bool persistedResetOk =
-		!resetPersisted || persistUserPollingConfig(kPollIntervalDefaultSeconds, "");
+		!resetPersisted || persistUserPollingConfig(kPollIntervalDefaultSeconds, "", buckets);
 #ifdef DEBUG_OVER_SERIAL
 	Serial.printf("%s: recovered polling prefs to defaults reset_persisted=%u persisted=%u\r\n",
 	              (context != nullptr) ? context : "polling load",
@@ -3311,19 +3954,19 @@ resetPollingConfigToDefaults(void)
 		return false;
 	}
 	// Keep rollback storage fixed-size in this config path so reset remains
-	// deterministic on fragmented ESP8266 heaps.
-	BucketId originalBuckets[kMqttEntityDescriptorCount]{};
-	if (!mqttEntityCopyBuckets(originalBuckets, entityCount)) {
+	// deterministic on fragmented ESP8266 heaps; packed, it is 3/8 of a BucketId array.
+	uint8_t originalBuckets[kMqttEntityBucketSnapshotBytes];
+	if (!mqttEntitySaveBucketSnapshot(originalBuckets, sizeof(originalBuckets))) {
 		return false;
 	}
 	if (!mqttEntityApplyBuckets(buckets, entityCount)) {
 		return false;
 	}
-	if (!persistUserPollingConfig(kPollIntervalDefaultSeconds, canonicalMapBuffer.data)) {
+	if (!persistUserPollingConfig(kPollIntervalDefaultSeconds, canonicalMapBuffer.data, buckets)) {
 		// A failed rollback leaves runtime buckets diverged from the still-valid
 		// persisted schedule. Clear runtime trust so later reconnect and portal
 		// paths reload from storage instead of reusing stale buckets.
-		const bool rollbackOk = mqttEntityApplyBuckets(originalBuckets, entityCount);
+		const bool rollbackOk = mqttEntityRestoreBucketSnapshot(originalBuckets, sizeof(originalBuckets));
 		if (!rollbackOk) {
 			pollingConfigLoadedFromStorage = false;
 		}
@@ -4486,7 +5129,7 @@ applyPortalPollingProfileState(uint32_t stagedIntervalSeconds,
 	if (mqttEntitiesRtAvailable() && !mqttEntityCanApplyBuckets(stagedBuckets, entityCount)) {
 		return result;
 	}
-	if (!persistUserPollingConfig(storedIntervalSeconds, canonicalMapBuffer.data)) {
+	if (!persistUserPollingConfig(storedIntervalSeconds, canonicalMapBuffer.data, stagedBuckets)) {
 		return result;
 	}
 
@@ -6070,40 +6713,16 @@ portalApplyLegacyBucketMapString(const char *map,
 		return true;
 	}
 
-	BucketId staged[kMqttEntityDescriptorCount];
-	memcpy(staged, buckets, entityCount * sizeof(BucketId));
-	uint8_t seen[kMqttEntityDescriptorCount];
-	memset(seen, 0, sizeof(seen));
+	if (!bucketMapWellFormed(map)) {
+		return false;
+	}
 
+	uint8_t seen[entityBitsetBytes(kMqttEntityDescriptorCount)] = {};
 	const char *cursor = map;
-	while (*cursor != '\0') {
-		while (*cursor != '\0' && (*cursor == ';' || isspace(static_cast<unsigned char>(*cursor)))) {
-			cursor++;
-		}
-		if (*cursor == '\0') {
-			break;
-		}
-
-		char token[64] = {0};
-		char bucketName[32] = {0};
-		size_t tokenIdx = 0;
-		size_t bucketIdx = 0;
-		while (*cursor != '\0' && *cursor != '=' && *cursor != ';' && tokenIdx < sizeof(token) - 1) {
-			token[tokenIdx++] = *cursor++;
-		}
-		token[tokenIdx] = '\0';
-		if (*cursor != '=') {
-			return false;
-		}
-		cursor++;
-		while (*cursor != '\0' && *cursor != ';' && bucketIdx < sizeof(bucketName) - 1) {
-			bucketName[bucketIdx++] = *cursor++;
-		}
-		bucketName[bucketIdx] = '\0';
-		if (token[0] == '\0' || bucketName[0] == '\0') {
-			return false;
-		}
-
+	char token[64];
+	char bucketName[32];
+	bool malformed = false;
+	while (nextBucketMapEntry(cursor, token, sizeof(token), bucketName, sizeof(bucketName), malformed)) {
 		size_t idx = 0;
 		if (token[0] == '#') {
 			if (!portalResolveLegacyBucketToken(token, idx)) {
@@ -6120,14 +6739,12 @@ portalApplyLegacyBucketMapString(const char *map,
 			invalidBucketCount++;
 			continue;
 		}
-		if (seen[idx]) {
+		if (entityBitsetTest(seen, idx)) {
 			duplicateEntityCount++;
 		}
-		staged[idx] = bucket;
-		seen[idx] = 1;
+		buckets[idx] = bucket;
+		entityBitsetSet(seen, idx);
 	}
-
-	memcpy(buckets, staged, entityCount * sizeof(BucketId));
 	return true;
 }
 
@@ -6558,40 +7175,16 @@ portalApplyBucketMapString(const char *map,
 		return true;
 	}
 
-	BucketId staged[kMqttEntityDescriptorCount];
-	memcpy(staged, buckets, entityCount * sizeof(BucketId));
+	if (!bucketMapWellFormed(map)) {
+		return false;
+	}
 
-	uint8_t seen[kMqttEntityDescriptorCount];
-	memset(seen, 0, sizeof(seen));
+	uint8_t seen[entityBitsetBytes(kMqttEntityDescriptorCount)] = {};
 	const char *cursor = map;
-	while (*cursor != '\0') {
-		while (*cursor != '\0' && (*cursor == ';' || isspace(static_cast<unsigned char>(*cursor)))) {
-			cursor++;
-		}
-		if (*cursor == '\0') {
-			break;
-		}
-
-		char token[64] = {0};
-		char bucketName[32] = {0};
-		size_t tokenIdx = 0;
-		size_t bucketIdx = 0;
-		while (*cursor != '\0' && *cursor != '=' && *cursor != ';' && tokenIdx < sizeof(token) - 1) {
-			token[tokenIdx++] = *cursor++;
-		}
-		token[tokenIdx] = '\0';
-		if (*cursor != '=') {
-			return false;
-		}
-		cursor++;
-		while (*cursor != '\0' && *cursor != ';' && bucketIdx < sizeof(bucketName) - 1) {
-			bucketName[bucketIdx++] = *cursor++;
-		}
-		bucketName[bucketIdx] = '\0';
-		if (token[0] == '\0' || bucketName[0] == '\0') {
-			return false;
-		}
-
+	char token[64];
+	char bucketName[32];
+	bool malformed = false;
+	while (nextBucketMapEntry(cursor, token, sizeof(token), bucketName, sizeof(bucketName), malformed)) {
 		size_t idx = 0;
 		if (!portalResolveEntityToken(token, entityCount, idx)) {
 			unknownEntityCount++;
@@ -6602,14 +7195,12 @@ portalApplyBucketMapString(const char *map,
 			invalidBucketCount++;
 			continue;
 		}
-		if (seen[idx]) {
+		if (entityBitsetTest(seen, idx)) {
 			duplicateEntityCount++;
 		}
-		staged[idx] = bucket;
-		seen[idx] = 1;
+		buckets[idx] = bucket;
+		entityBitsetSet(seen, idx);
 	}
-
-	memcpy(buckets, staged, entityCount * sizeof(BucketId));
 	return true;
 }
 
@@ -6692,7 +7283,7 @@ handlePortalPollingPage(WiFiManager &wifiManager)
 		return;
 	}
 	const uint32_t storedIntervalSeconds = g_portalPollingCacheIntervalSeconds;
-	ScopedCharBuffer rowBuffer(768);
+	ScratchLease rowBuffer(g_textScratchPool, ScratchPhase::Portal, 768);
 	if (!rowBuffer.ok()) {
 		wifiManager.server->send(500, "text/plain", "polling config unavailable: row");
 		return;
@@ -6839,8 +7430,8 @@ handlePortalPollingPage(WiFiManager &wifiManager)
 				strlcpy(entityDisplayName, entityName, sizeof(entityDisplayName));
 			}
 			const int rowLen = snprintf_P(
-				rowBuffer.data,
-				rowBuffer.size,
+				rowBuffer.chars(),
+				rowBuffer.size(),
 				kRowFmt,
 				entityName,
 				entityDisplayName,
@@ -6852,7 +7443,7 @@ handlePortalPollingPage(WiFiManager &wifiManager)
 				bucketIdToString(BucketId::OneDay), (cur == BucketId::OneDay) ? " selected" : "", "1d",
 				bucketIdToString(BucketId::User), (cur == BucketId::User) ? " selected" : "", "usr",
 				bucketIdToString(BucketId::Disabled), (cur == BucketId::Disabled) ? " selected" : "", "off");
-			if (rowLen > 0 && static_cast<size_t>(rowLen) < rowBuffer.size && !writer.write(rowBuffer.data)) {
+			if (rowLen > 0 && static_cast<size_t>(rowLen) < rowBuffer.size() && !writer.write(rowBuffer.chars())) {
 				return false;
 			}
 		}
@@ -7111,9 +7702,10 @@ handlePortalPollingSave(WiFiManager &wifiManager)
 		wifiManager.server->send(500, "text/plain", "polling config unavailable");
 		return;
 	}
-	BucketId workingBuckets[kMqttEntityDescriptorCount]{};
-	memcpy(workingBuckets, g_portalBucketsScratch, entityCount * sizeof(BucketId));
-	BucketId *buckets = workingBuckets;
+	// Edit the portal cache in place; a packed copy (three bits per entity) restores it on failure.
+	uint8_t savedBuckets[packedBucketMapBytes(kMqttEntityDescriptorCount)];
+	packedBucketPack(savedBuckets, g_portalBucketsScratch, entityCount);
+	BucketId *buckets = g_portalBucketsScratch;
 	uint32_t storedIntervalSeconds = g_portalPollingCacheIntervalSeconds;
 	const String familyArg = wifiManager.server->arg("family");
 	const uint16_t requestedPage = portalArgToU16(wifiManager.server->arg("page"), 0);
@@ -7192,6 +7784,7 @@ handlePortalPollingSave(WiFiManager &wifiManager)
 	}
 	ScopedCharBuffer canonicalMapBuffer((persistedMapLen == 0 ? 0 : persistedMapLen) + 1);
 	if (!canonicalMapBuffer.ok()) {
+		packedBucketUnpack(savedBuckets, buckets, entityCount);
 		wifiManager.server->send(500, "text/plain", "polling config unavailable");
 		return;
 	}
@@ -7207,8 +7800,7 @@ handlePortalPollingSave(WiFiManager &wifiManager)
 		hadError = true;
 	}
 	if (!hadError) {
-		if (persistUserPollingConfig(storedIntervalSeconds, canonicalMapBuffer.data)) {
-			memcpy(g_portalBucketsScratch, buckets, entityCount * sizeof(BucketId));
+		if (persistUserPollingConfig(storedIntervalSeconds, canonicalMapBuffer.data, buckets)) {
 			pollIntervalSeconds = storedIntervalSeconds;
 			g_portalPollingCacheValid = true;
 			g_portalPollingCacheEntityCount = entityCount;
@@ -7225,6 +7817,7 @@ handlePortalPollingSave(WiFiManager &wifiManager)
 	portalRebootIntent = BootIntent::Normal;
 	portalMqttSaved = false;
 	if (hadError) {
+		packedBucketUnpack(savedBuckets, buckets, entityCount);
 		g_portalPollingCacheValid = false;
 	}
 
@@ -7272,9 +7865,6 @@ handlePortalPollingClear(WiFiManager &wifiManager)
 		wifiManager.server->send(500, "text/plain", "polling config unavailable");
 		return;
 	}
-	BucketId workingBuckets[kMqttEntityDescriptorCount]{};
-	memcpy(workingBuckets, g_portalBucketsScratch, entityCount * sizeof(BucketId));
-	BucketId *buckets = workingBuckets;
 	uint32_t storedIntervalSeconds = g_portalPollingCacheIntervalSeconds;
 
 	const String familyArg = wifiManager.server->arg("family");
@@ -7287,7 +7877,6 @@ handlePortalPollingClear(WiFiManager &wifiManager)
 	const char *familyKey = portalPollingFamilyKey(view.family);
 
 	bool hadError = false;
-	portalSetAllBuckets(buckets, entityCount, BucketId::Disabled);
 	char disableAllMap[24];
 	const bool mapBuilt = copyDisableAllBucketMap(disableAllMap, sizeof(disableAllMap));
 	if (!mapBuilt) {
@@ -7295,8 +7884,9 @@ handlePortalPollingClear(WiFiManager &wifiManager)
 	}
 
 	if (mapBuilt) {
-		if (persistUserPollingConfig(storedIntervalSeconds, disableAllMap)) {
-			memcpy(g_portalBucketsScratch, buckets, entityCount * sizeof(BucketId));
+		if (persistUserPollingConfig(storedIntervalSeconds, disableAllMap, nullptr)) {
+			// The cache only changes once the cleared map is stored, so no working copy is needed.
+			portalSetAllBuckets(g_portalBucketsScratch, entityCount, BucketId::Disabled);
 			pollIntervalSeconds = storedIntervalSeconds;
 			g_portalPollingCacheValid = true;
 			g_portalPollingCacheEntityCount = entityCount;
@@ -7328,6 +7918,212 @@ handlePortalPollingClear(WiFiManager &wifiManager)
 	wifiManager.server->send(302, "text/plain", "");
 }
 
+#if RS485_AUX_BUS
+/*
+ * AuxBusTransport
+ *
+ * Runs the multi-bus poller's transactions on the aux bus. Reads go through the aux handler's
+ * deferred scope: with the worker task a read is started here and its reply collected by a later
+ * poll, without it the read completes inside beginTxn().
+ */
+class AuxBusTransport : public BusTransport {
+public:
+	bool beginTxn(const BusTxn &txn, uint32_t) override
+	{
+		if (_auxModBus == nullptr || _auxRegisterHandler == nullptr) {
+			return false;
+		}
+		if (txn.kind == BusTxnKind::Probe) {
+			if (txn.planIndex >= kAuxBusBaudCount) {
+				return false;
+			}
+			_auxModBus->setBaudRate(kKnownBaudRates[txn.planIndex]);
+		}
+		_txn = txn;
+		_auxRegisterHandler->setSlaveId(txn.slaveId);
+		attempt();
+		return true;
+	}
+
+	BusTxnState pollTxn(uint32_t) override
+	{
+		if (_state == BusTxnState::Pending && !_auxModBus->deferredReplyOutstanding()) {
+			attempt();
+		}
+		return _state;
+	}
+
+	modbusRequestAndResponse *response() { return &_response; }
+
+private:
+	void attempt()
+	{
+		const uint16_t reg = (_txn.kind == BusTxnKind::Probe)      ? REG_SAFETY_TEST_RW_GRID_REGULATION
+		                     : (_txn.kind == BusTxnKind::Identify) ? REG_SYSTEM_INFO_R_EMS_SN_BYTE_1_2
+		                                                           : _txn.readKey;
+		_response = modbusRequestAndResponse{};
+		_auxModBus->beginDeferredScope();
+		const modbusRequestAndResponseStatusValues result = _auxRegisterHandler->readHandledRegister(reg, &_response);
+		if (_auxModBus->endDeferredScope()) {
+			_state = BusTxnState::Pending;
+			return;
+		}
+		const bool ok = result == modbusRequestAndResponseStatusValues::readDataRegisterSuccess &&
+		                (_txn.kind != BusTxnKind::Identify || inverterSerialIsValid(_response.dataValueFormatted));
+		_state = ok ? BusTxnState::Ok : BusTxnState::Failed;
+	}
+
+	BusTxn _txn{};
+	BusTxnState _state = BusTxnState::Failed;
+	modbusRequestAndResponse _response{};
+};
+
+static AuxBusTransport g_auxBusTransport;
+
+// Plan transactions the aux inverter can serve: a register read led by an entity it publishes.
+static bool
+auxBusPollsTransaction(const MqttEntityActiveBucket &bucketPlan, const MqttPollTransaction &transaction, void *)
+{
+	if (transaction.kind == MqttPollTransactionKind::SnapshotFanout || transaction.entityCount == 0 ||
+	    bucketPlan.members == nullptr || transaction.firstMemberOffset >= bucketPlan.count) {
+		return false;
+	}
+	mqttState leader{};
+	return mqttEntityCopyByIndex(bucketPlan.members[transaction.firstMemberOffset], &leader) &&
+	       auxBusPollsEntity(leader);
+}
+
+/*
+ * noteAuxInverterIdentity
+ *
+ * Records the serial read from the aux bus. A new or replaced inverter gets its HA device with the
+ * discovery refresh this requests.
+ */
+static void
+noteAuxInverterIdentity(const char *serial)
+{
+	if (strcmp(g_auxInverterFleet.slots[0].serial, serial) == 0) {
+		return;
+	}
+	inverterFleetSetSerial(g_auxInverterFleet, 0, serial);
+	_auxRegisterHandler->setSerialNumberPrefix(serial[0], serial[1]);
+	requestHaDataRefresh();
+#ifdef DEBUG_OVER_SERIAL
+	snprintf(_debugOutput, sizeof(_debugOutput), "Aux RS485 inverter identified: %s", serial);
+	Serial.println(_debugOutput);
+#endif
+}
+
+// Publishes one aux poll read for every member of its plan transaction, unless the plan was rebuilt
+// while the read was on the bus.
+static void
+publishAuxPollTransaction(const BusTxn &txn, modbusRequestAndResponse *response)
+{
+	const MqttEntityActivePlan *plan = mqttEntitiesRtAvailable() ? mqttActivePlan() : nullptr;
+	const MqttEntityActiveBucket *bucketPlan = (plan != nullptr) ? busPlanFeedBucket(*plan, txn.bucket) : nullptr;
+	if (bucketPlan == nullptr || bucketPlan->transactions == nullptr || txn.planIndex >= bucketPlan->transactionCount) {
+		return;
+	}
+	const MqttPollTransaction &transaction = bucketPlan->transactions[txn.planIndex];
+	if (transaction.readKey != txn.readKey) {
+		return;
+	}
+	InverterSlotScope slotScope(auxInverterSlotIndex());
+	for (size_t member = 0; member < transaction.entityCount; ++member) {
+		const size_t offset = static_cast<size_t>(transaction.firstMemberOffset) + member;
+		if (offset >= bucketPlan->count) {
+			break;
+		}
+		mqttState entity{};
+		if (!mqttEntityCopyByIndex(bucketPlan->members[offset], &entity) || !auxBusPollsEntity(entity)) {
+			continue;
+		}
+		sendDataFromMqttState(&entity, false, response);
+	}
+}
+
+static void
+onAuxBusTxnComplete(size_t, const BusTxn &txn, bool ok, uint32_t, void *)
+{
+	if (!ok) {
+		return;
+	}
+	switch (txn.kind) {
+	case BusTxnKind::Probe:
+#ifdef DEBUG_OVER_SERIAL
+		snprintf(_debugOutput, sizeof(_debugOutput), "Aux RS485 baud established: %lu", kKnownBaudRates[txn.planIndex]);
+		Serial.println(_debugOutput);
+#endif
+		return;
+	case BusTxnKind::Identify:
+		noteAuxInverterIdentity(g_auxBusTransport.response()->dataValueFormatted);
+		return;
+	case BusTxnKind::Poll:
+	default:
+		publishAuxPollTransaction(txn, g_auxBusTransport.response());
+		return;
+	}
+}
+
+/*
+ * serviceAuxBus
+ *
+ * Collects aux bus replies, keeps its queue topped up from the owed plan buckets and starts the next
+ * transaction. The poller runs the probe/identify handshake itself whenever the link is down.
+ */
+static void
+serviceAuxBus(void)
+{
+	if (_auxModBus == nullptr) {
+		return;
+	}
+	const uint32_t nowMs = millis();
+	multiBusService(g_auxBuses, nowMs, onAuxBusTxnComplete, nullptr);
+	const MqttEntityActivePlan *plan = mqttEntitiesRtAvailable() ? mqttActivePlan() : nullptr;
+	if (plan != nullptr &&
+	    busPlanFeedFill(g_auxPlanFeed, *plan, g_auxBuses, kAuxBusLane, RS485_AUX_SLAVE_ID, auxBusPollsTransaction, nullptr) > 0) {
+		multiBusService(g_auxBuses, nowMs, onAuxBusTxnComplete, nullptr);
+	}
+}
+
+static uint32_t
+auxBusMsUntilDue(uint32_t nowMs)
+{
+	if (_auxModBus == nullptr) {
+		return kCoopNoDeadlineMs;
+	}
+	if (!busPlanFeedIdle(g_auxPlanFeed) && multiBusLinkOnline(g_auxBuses, kAuxBusLane) &&
+	    multiBusPending(g_auxBuses, kAuxBusLane) < kBusPlanFeedLookahead) {
+		return 0;
+	}
+	return multiBusMsUntilWork(g_auxBuses, nowMs, kRs485ReplyPollMs, kCoopNoDeadlineMs);
+}
+
+static void
+setupAuxBus(void)
+{
+	const Rs485PortConfig port = { RS485_AUX_UART, RS485_AUX_RX_PIN, RS485_AUX_TX_PIN, RS485_AUX_CONTROL_PIN };
+	_auxModBus = new RS485Handler(port);
+#if defined(DEBUG_OVER_SERIAL) || defined(DEBUG_LEVEL2) || defined(DEBUG_OUTPUT_TX_RX)
+	_auxModBus->setDebugOutput(_debugOutput);
+#endif // DEBUG_OVER_SERIAL || DEBUG_LEVEL2 || DEBUG_OUTPUT_TX_RX
+	_auxModBus->setServiceHook(serviceRs485Hooks);
+#if RS485_WORKER_ENABLED
+	if (!_auxModBus->startWorkerTask()) {
+#if defined(DEBUG_OVER_SERIAL)
+		Serial.println("Aux RS485 worker task failed to start; using loop() I/O");
+#endif
+	}
+#endif
+	const uint8_t slaveId = RS485_AUX_SLAVE_ID;
+	inverterFleetInit(g_auxInverterFleet, &slaveId, 1);
+	_auxRegisterHandler = new RegisterHandler(_auxModBus);
+	_auxRegisterHandler->setSlaveId(slaveId);
+	multiBusAttach(g_auxBuses, kAuxBusLane, &g_auxBusTransport, kAuxBusCycleBudgetMs);
+	multiBusEnableLink(g_auxBuses, kAuxBusLane, slaveId, kAuxBusBaudCount);
+}
+#endif // RS485_AUX_BUS
+
 /*
  * setup
  *
@@ -7335,6 +8131,9 @@ handlePortalPollingClear(WiFiManager &wifiManager)
  */
 void setup()
 {
+#if ALLOC_PROFILER
+	allocProfilerEnable(true);
+#endif
 	Serial.begin(115200);
 #if defined(DEBUG_OVER_SERIAL) || defined(DEBUG_LEVEL2) || defined(DEBUG_OUTPUT_TX_RX)
 	// Boot prints below are unconditional, so keep the serial port initialized even when
@@ -7437,9 +8236,12 @@ void setup()
 	uint32_t storedRs485Baud = 0;
 	bool hasStoredRs485Baud = false;
 
+	loadSettingsJournal();
 	preferences.begin(DEVICE_NAME, true); // RO
 	preferences.getString(kPreferenceBootIntent, storedIntent, sizeof(storedIntent));
 	preferences.getString(kPreferenceBootMode, storedMode, sizeof(storedMode));
+	settingsJournalGetString(g_settingsJournal, kPreferenceBootIntent, storedIntent, sizeof(storedIntent));
+	settingsJournalGetString(g_settingsJournal, kPreferenceBootMode, storedMode, sizeof(storedMode));
 	preferences.getString(kPreferenceInverterLabel, storedInverterLabel, sizeof(storedInverterLabel));
 	preferences.getString("WiFi_SSID", wifiSsid, sizeof(wifiSsid));
 	preferences.getString("WiFi_Password", wifiPass, sizeof(wifiPass));
@@ -7463,6 +8265,8 @@ void setup()
 		// Boot intent is a one-boot diagnostic hint. Consume it now so later
 		// unrelated resets do not keep reporting the previous requested mode.
 		persistUserBootIntent(BootIntent::Normal);
+		// Not left to the quiet timer: a crash before it fires would replay the intent.
+		flushSettingsJournal();
 	}
 	currentBootMode = bootModeFromString(storedMode);
 	bootModeForDiagnostics = currentBootMode;
@@ -7664,9 +8468,18 @@ void setup()
 		_modBus->setDebugOutput(_debugOutput);
 #endif // DEBUG_OVER_SERIAL || DEBUG_LEVEL2 || DEBUG_OUTPUT_TX_RX
 		_modBus->setServiceHook(serviceRs485Hooks);
+#if RS485_WORKER_ENABLED
+		if (!_modBus->startWorkerTask()) {
+#if defined(DEBUG_OVER_SERIAL)
+			Serial.println("RS485 worker task failed to start; using loop() I/O");
+#endif
+		}
+#endif
 
 			// Set up the helper class for reading with reading registers
 			_registerHandler = new RegisterHandler(_modBus);
+			loadConfiguredInverterFleet();
+			_registerHandler->setSlaveId(g_inverterFleet.slots[0].slaveId);
 			if (deviceSerialNumber[0] != '\0' && deviceSerialNumber[1] != '\0') {
 				_registerHandler->setSerialNumberPrefix(deviceSerialNumber[0], deviceSerialNumber[1]);
 			}
@@ -7691,6 +8504,12 @@ void setup()
 			rs485RuntimeReconnectOnRediscoveryStart(rs485RuntimeReconnect);
 			rs485ConnectState = Rs485ConnectState::ProbingBaud;
 			resetRs485ProbeState(millis());
+			loadWarmStartRecord();
+			g_warmStartVerifyPending =
+				g_warmStartRecordValid && warmStartUsable(g_warmStartRecord, g_inverterFleet.slots[0].slaveId);
+#if RS485_AUX_BUS
+			setupAuxBus();
+#endif
 
 			// The scheduler owns ESS snapshot refresh and publishing cadence. Do not block setup() waiting
 			// for inverter connectivity; the inverter may be offline and MQTT must still operate.
@@ -8243,63 +9062,807 @@ configHandler(void)
 		}
 	}
 
-/*
- * loop
- *
- * The loop function runs over and over again until power down or reset
- */
-void
-loop()
+#if MQTT_OUTBOUND_QUEUE
+// Outbound queue mode: entity states are queued by entity index (latest value wins) and drained by
+// the "mqtt_out" loop task at the shaped rate, so a slow link cannot stall a poll pass. The topic is
+// rebuilt at send time from the current identity.
+static constexpr size_t kMqttOutboundDrainPerTurn = 8;
+static MqttOutboundQueue *g_mqttOutbound = nullptr;
+
+static bool
+ensureMqttOutboundQueue(void)
 {
-#ifdef FORCE_RESTART_HOURS
-	static unsigned long autoReboot = 0;
-#endif
-#if RS485_STUB
-	bool hadPendingStubControlAtLoopEntry = pendingRs485StubControlSet;
-#endif
+	if (g_mqttOutbound != nullptr) {
+		return true;
+	}
+	g_mqttOutbound = new (std::nothrow) MqttOutboundQueue;
+	if (g_mqttOutbound == nullptr) {
+		return false;
+	}
+	mqttOutboundInit(*g_mqttOutbound, MQTT_OUTBOUND_RATE_PER_SEC, MQTT_OUTBOUND_BURST, millis());
+	mqttOutboundSetIdentity(*g_mqttOutbound, deviceSerialNumber);
+	return true;
+}
 
-#ifdef BUTTON_PIN
-	// Read button state
-	if (digitalRead(BUTTON_PIN) == LOW) {
-		configHandler();
+// Queued values carry no identity of their own; drop them when the inverter identity is cleared or
+// changes, or they would be published under the new inverter's topics.
+static void
+noteMqttOutboundIdentity(const char *serial)
+{
+	if (g_mqttOutbound == nullptr) {
+		return;
 	}
-#endif // BUTTON_PIN
+	mqttOutboundSetIdentity(*g_mqttOutbound, serial);
+}
 
-	const uint32_t loopNowMs = millis();
-	loopSequence++;
-	diag_loop_tick(loopNowMs);
-	diag_wifi_status(static_cast<int16_t>(WiFi.status()), loopNowMs);
+// Returning true for entities that can no longer be addressed drops them instead of retrying forever.
+static bool
+publishQueuedEntityState(void *, uint16_t key, const char *payload, bool retain)
+{
+	if (!_mqtt.connected()) {
+		return false;
+	}
+	MqttPublishTopicScratch *publishScratch = runtimePublishTopicScratch();
+	if (publishScratch == nullptr) {
+		return false;
+	}
+	mqttState entity{};
+	if (!mqttEntityCopyByIndex(key, &entity)) {
+		return true;
+	}
+	mqttEntityNameCopy(&entity, publishScratch->entityKey, sizeof(publishScratch->entityKey));
+	if (!buildEntityTopicBase(deviceName,
+	                          mqttEntityScope(entity.entityId),
+	                          controllerIdentifier,
+	                          deviceSerialNumber,
+	                          publishScratch->entityKey,
+	                          publishScratch->topicBase,
+	                          sizeof(publishScratch->topicBase))) {
+		return true;
+	}
+	buildEntityStateTopic(&entity,
+	                      publishScratch->entityKey,
+	                      publishScratch->topicBase,
+	                      publishScratch->topic,
+	                      sizeof(publishScratch->topic));
+	noteTrackedMqttPayload(currentRuntimeDiagPayloadKind, strlen(payload));
+	if (!_mqtt.publish(publishScratch->topic, payload, retain)) {
+		return false;
+	}
+	noteMqttActivityPulse();
+	markBootstrapEntityPublished(key);
+	return true;
+}
 
-	// Refresh LED Screen, will cause the status asterisk to flicker
-	updateOLED(true, "", "", "");
+// Returns false when the value was not queued; the caller then publishes it directly.
+static bool
+queueEntityState(size_t idx, const mqttState *entity, const char *value)
+{
+	if (entity == nullptr || value == nullptr || !ensureMqttOutboundQueue()) {
+		return false;
+	}
+	const MqttOutboundClass cls = mqttOutboundClassFor(entity->entityId, entity->readKind, entity->scope);
+	return mqttOutboundEnqueue(*g_mqttOutbound,
+	                           static_cast<uint16_t>(idx),
+	                           cls,
+	                           value,
+	                           entity->retain ? MQTT_RETAIN : false) != MqttOutboundEnqueue::Rejected;
+}
+#endif // MQTT_OUTBOUND_QUEUE
 
-	if (bootPlan.wifiSta) {
-		// Make sure WiFi is good
-		if (WiFi.status() != WL_CONNECTED) {
-			if (lastWifiConnected) {
-				pendingWifiDisconnectEvent = true;
-			}
-			lastWifiConnected = false;
-			setupWifi(false);
-			if (mqttSubsystemEnabled()) {
-				mqttReconnect();
-				requestHaDataResend();
-			}
-		} else {
-			lastWifiConnected = true;
-		}
+#if TELEMETRY_HISTORY
+// Store-and-forward mode: while MQTT is down, inverter energy/power/SOC states are kept in a
+// delta-encoded ring instead of being dropped. After reconnect the "history" loop task publishes
+// one block per turn to DEVICE_NAME/history, paced behind discovery and live polling.
+static constexpr uint32_t kTelemetryHistoryReplayIntervalMs = 500;
+static TelemetryHistory *g_telemetryHistory = nullptr;
+static uint32_t g_telemetryHistoryLastReplayMs = 0;
+
+static bool
+ensureTelemetryHistory(void)
+{
+	if (g_telemetryHistory != nullptr) {
+		return true;
+	}
+	g_telemetryHistory = new (std::nothrow) TelemetryHistory;
+	if (g_telemetryHistory == nullptr) {
+		return false;
 	}
+	telemetryHistoryInit(*g_telemetryHistory);
+	return true;
+}
 
-	if (mqttSubsystemEnabled()) {
-		// make sure mqtt is still connected
-		const bool mqttOk = pumpMqttOnce();
+// Returns true when the value was buffered for later replay.
+static bool
+recordTelemetryHistorySample(size_t idx, const mqttState *entity, const char *value)
+{
+	if (entity == nullptr || value == nullptr ||
+	    !telemetryHistoryEntityEligible(entity->haClass, entity->scope, entity->subscribe) ||
+	    !ensureTelemetryHistory()) {
+		return false;
+	}
+	return telemetryHistoryRecordText(*g_telemetryHistory, static_cast<uint16_t>(idx), millis(), value);
+}
+
+static bool replayTelemetryHistoryBlock(void);
+#endif // TELEMETRY_HISTORY
+
+#if METRIC_LOG
+// On-flash metric log: once SNTP has set the clock, the latest power/SOC/energy states are
+// appended every METRIC_LOG_INTERVAL_S to segment files under /mlog on LittleFS, and
+// GET /history.csv streams a time range back out. Only whole blocks reach flash; the newest
+// (up to one block of records) is flushed on planned restarts and lost on power cuts.
+static constexpr uint32_t kMetricLogValidEpochS = 1700000000UL;
+// 8 KiB segment files; the oldest file is deleted when the log reaches its share of the FS.
+static constexpr uint16_t kMetricLogBlocksPerSegment = 16;
+// Values older than this are not logged (e.g. RS485 is down).
+static constexpr uint32_t kMetricLogSampleMaxAgeMs = 5UL * 60UL * 1000UL;
+static constexpr uint32_t kMetricLogCsvMaxRows = 20000;
+static constexpr uint32_t kMetricLogCsvDefaultSpanS = 24UL * 3600UL;
+
+class LittleFsMetricLogStore : public MetricLogStore {
+public:
+	size_t
+	listSegments(uint32_t *ids, size_t maxIds) override
+	{
+		size_t count = 0;
+#if defined(MP_ESP8266)
+		Dir dir = LittleFS.openDir("/mlog");
+		while (dir.next()) {
+			count = insertId(ids, maxIds, count, dir.fileName().c_str());
+		}
+#else
+		File root = LittleFS.open("/mlog");
+		if (!root || !root.isDirectory()) {
+			return 0;
+		}
+		for (File file = root.openNextFile(); file; file = root.openNextFile()) {
+			count = insertId(ids, maxIds, count, file.name());
+		}
+#endif
+		return count;
+	}
+
+	uint16_t
+	blockCount(uint32_t segmentId) override
+	{
+		char path[24];
+		segmentPath(segmentId, path, sizeof(path));
+		File file = LittleFS.open(path, "r");
+		if (!file) {
+			return 0;
+		}
+		return static_cast<uint16_t>(file.size() / kMetricLogBlockBytes);
+	}
+
+	bool
+	readBlock(uint32_t segmentId, uint16_t blockIndex, uint8_t *out, size_t len) override
+	{
+		char path[24];
+		segmentPath(segmentId, path, sizeof(path));
+		File file = LittleFS.open(path, "r");
+		return file && file.seek(static_cast<uint32_t>(blockIndex) * kMetricLogBlockBytes) && file.read(out, len) == len;
+	}
+
+	bool
+	appendBlock(uint32_t segmentId, const uint8_t *block) override
+	{
+		// LittleFS commits a file on close, so a power cut never leaves half a block behind.
+		char path[24];
+		segmentPath(segmentId, path, sizeof(path));
+		File file = LittleFS.open(path, "a");
+		return file && file.write(block, kMetricLogBlockBytes) == kMetricLogBlockBytes;
+	}
+
+	bool
+	removeSegment(uint32_t segmentId) override
+	{
+		char path[24];
+		segmentPath(segmentId, path, sizeof(path));
+		return LittleFS.remove(path);
+	}
+
+private:
+	static void
+	segmentPath(uint32_t segmentId, char *out, size_t outSize)
+	{
+		snprintf(out, outSize, "/mlog/%08lx.bin", static_cast<unsigned long>(segmentId));
+	}
+
+	// Keeps ids sorted ascending; when full, the smallest id is displaced by a newer one.
+	static size_t
+	insertId(uint32_t *ids, size_t maxIds, size_t count, const char *name)
+	{
+		char *end = nullptr;
+		const unsigned long id = strtoul(name, &end, 16);
+		if (maxIds == 0 || end == name || strcmp(end, ".bin") != 0) {
+			return count;
+		}
+		if (count == maxIds) {
+			if (id <= ids[0]) {
+				return count;
+			}
+			memmove(&ids[0], &ids[1], sizeof(ids[0]) * (count - 1));
+			count--;
+		}
+		size_t pos = count;
+		while (pos > 0 && ids[pos - 1] > id) {
+			ids[pos] = ids[pos - 1];
+			pos--;
+		}
+		ids[pos] = static_cast<uint32_t>(id);
+		return count + 1;
+	}
+};
+
+static LittleFsMetricLogStore g_metricLogStore;
+static MetricLog *g_metricLog = nullptr;
+static bool g_metricLogFailed = false;
+static bool g_metricLogClockStarted = false;
+static int32_t g_metricLogLatest[kMetricLogChannels];
+static uint32_t g_metricLogSeenMs = 0;
+static bool g_metricLogSeen = false;
+static uint32_t g_metricLogLastSlotS = 0;
+
+static bool
+ensureMetricLog(void)
+{
+	if (g_metricLog != nullptr) {
+		return true;
+	}
+	if (g_metricLogFailed) {
+		return false;
+	}
+	g_metricLogFailed = true;
+#if defined(MP_ESP8266)
+	if (!LittleFS.begin() && !(LittleFS.format() && LittleFS.begin())) {
+		return false;
+	}
+	FSInfo info;
+	const size_t totalBytes = LittleFS.info(info) ? info.totalBytes : 0;
+#else
+	if (!LittleFS.begin(true)) {
+		return false;
+	}
+	const size_t totalBytes = LittleFS.totalBytes();
+#endif
+	LittleFS.mkdir("/mlog");
+	// Leave half of the filesystem to everything else.
+	const size_t segmentBytes = static_cast<size_t>(kMetricLogBlocksPerSegment) * kMetricLogBlockBytes;
+	size_t maxSegments = (totalBytes / 2) / segmentBytes;
+	if (maxSegments > kMetricLogMaxSegments) {
+		maxSegments = kMetricLogMaxSegments;
+	}
+	if (maxSegments < 2) {
+		return false;
+	}
+	MetricLog *log = new (std::nothrow) MetricLog;
+	if (log == nullptr) {
+		return false;
+	}
+	const MetricLogConfig config{ METRIC_LOG_INTERVAL_S, kMetricLogBlocksPerSegment, static_cast<uint16_t>(maxSegments) };
+	metricLogOpen(*log, g_metricLogStore, config);
+	g_metricLog = log;
+	g_metricLogFailed = false;
+	return true;
+}
+
+static void
+startMetricLogClock(void)
+{
+	if (g_metricLogClockStarted) {
+		return;
+	}
+	// UTC only; /history.csv consumers localise.
+	configTime(0, 0, "pool.ntp.org", "time.nist.gov");
+	g_metricLogClockStarted = true;
+}
+
+// 0 until SNTP has synced.
+static uint32_t
+metricLogNowS(void)
+{
+	const time_t now = time(nullptr);
+	return (now >= static_cast<time_t>(kMetricLogValidEpochS)) ? static_cast<uint32_t>(now) : 0;
+}
+
+static void
+noteMetricLogSample(mqttEntityId entityId, const char *value)
+{
+	const int ch = metricLogChannelFor(entityId);
+	if (ch < 0) {
+		return;
+	}
+	if (!g_metricLogSeen) {
+		for (size_t i = 0; i < kMetricLogChannels; ++i) {
+			g_metricLogLatest[i] = kMetricLogNoValue;
+		}
+		g_metricLogSeen = true;
+	}
+	int32_t milliValue = 0;
+	if (telemetryHistoryParseValue(value, &milliValue)) {
+		g_metricLogLatest[ch] = milliValue;
+		g_metricLogSeenMs = millis();
+	}
+}
+
+static void
+flushMetricLog(void)
+{
+	if (g_metricLog != nullptr) {
+		metricLogFlush(*g_metricLog, g_metricLogStore);
+	}
+}
+
+struct MetricLogCsvWriter {
+	PortalResponseWriter *writer;
+	uint32_t rows;
+	bool ok;
+};
+
+static bool
+writeMetricLogCsvRow(void *ctx, const MetricLogRecord &record)
+{
+	auto *csv = static_cast<MetricLogCsvWriter *>(ctx);
+	char line[192];
+	size_t len = static_cast<size_t>(snprintf(line, sizeof(line), "%lu", static_cast<unsigned long>(record.timeS)));
+	for (size_t ch = 0; ch < kMetricLogChannels; ++ch) {
+		line[len++] = ',';
+		if (record.values[ch] != kMetricLogNoValue) {
+			len += telemetryHistoryFormatValue(record.values[ch], line + len, sizeof(line) - len - 1);
+		}
+	}
+	line[len++] = '\n';
+	line[len] = '\0';
+	csv->ok = csv->writer->write(line);
+	csv->rows++;
+	return csv->ok && csv->rows < kMetricLogCsvMaxRows;
+}
+
+static bool
+emitMetricLogCsv(PortalResponseWriter &writer, uint32_t fromS, uint32_t toS)
+{
+	if (!writer.write("time")) {
+		return false;
+	}
+	for (size_t ch = 0; ch < kMetricLogChannels; ++ch) {
+		if (!writer.write(",") || !writer.write(kMetricLogChannelDefs[ch].column)) {
+			return false;
+		}
+	}
+	if (!writer.write("\n")) {
+		return false;
+	}
+	MetricLogCsvWriter csv{ &writer, 0, true };
+	metricLogQuery(*g_metricLog, g_metricLogStore, fromS, toS, writeMetricLogCsvRow, &csv);
+	return csv.ok;
+}
+
+/*
+ * handleHttpHistoryCsv
+ *
+ * GET /history.csv?from=<epoch s>&to=<epoch s>. Defaults to the last 24 h of logged data;
+ * rows are capped at kMetricLogCsvMaxRows, so long exports are fetched in pages by "from".
+ */
+void
+handleHttpHistoryCsv(void)
+{
+	HttpServer *server = &httpServerRef();
+	if (!ensureMetricLog()) {
+		server->send(503, "text/plain", "metric log unavailable");
+		return;
+	}
+	uint32_t toS = UINT32_MAX;
+	if (server->hasArg("to")) {
+		toS = static_cast<uint32_t>(strtoul(server->arg("to").c_str(), nullptr, 10));
+	}
+	const uint32_t newestS = (toS == UINT32_MAX) ? g_metricLog->lastTimeS : toS;
+	uint32_t fromS = (newestS > kMetricLogCsvDefaultSpanS) ? newestS - kMetricLogCsvDefaultSpanS : 0;
+	if (server->hasArg("from")) {
+		fromS = static_cast<uint32_t>(strtoul(server->arg("from").c_str(), nullptr, 10));
+	}
+	if (fromS > toS) {
+		server->send(400, "text/plain", "from must not be after to");
+		return;
+	}
+
+	server->sendHeader("Cache-Control", "no-store");
+#if defined(MP_ESP8266)
+	if (!server->chunkedResponseModeStart_P(200, PSTR("text/csv"))) {
+#else
+	if (!server->chunkedResponseModeStart(200, "text/csv")) {
+#endif
+		// Same fixed-length fallback as the portal pages: count first, then stream.
+		PortalResponseWriter countWriter;
+		countWriter.server = nullptr;
+		emitMetricLogCsv(countWriter, fromS, toS);
+		server->setContentLength(countWriter.bytes);
+		server->send(200, "text/csv", "");
+		PortalResponseWriter bodyWriter;
+		bodyWriter.server = server;
+		emitMetricLogCsv(bodyWriter, fromS, toS);
+		return;
+	}
+	PortalResponseWriter writer;
+	writer.server = server;
+	emitMetricLogCsv(writer, fromS, toS);
+	server->chunkedResponseFinalize();
+}
+#endif // METRIC_LOG
+
+// Subsystems that only need to run on their own cadence are scheduled cooperatively; the WiFi/MQTT
+// pump and control-plane handling stay inline at the top of loop() because they gate early returns.
+static CoopScheduler g_loopTasks;
+static bool g_loopTasksRegistered = false;
+// Per-turn gates computed inline in loop() and honoured by the scheduled publish tasks.
+static bool g_loopSkipPublishThisTurn = false;
+static bool g_loopSchedulerCoolingDown = false;
+static uint8_t g_loopTaskRs485 = kCoopTaskInvalid;
+static uint8_t g_loopTaskStatusLed = kCoopTaskInvalid;
+
+static void
+loopTaskRs485(void *)
+{
+	// Keep attempting RS485/inverter connection in the background. This must not block loop() so MQTT, HTTP,
+	// and the scheduler remain responsive even when RS485 is disconnected.
+	if (bootPlan.inverter) {
+		rs485ProbeTick();
+		serviceRs485BaudReconcile();
+#if RS485_AUX_BUS
+		serviceAuxBus();
+#endif
+	}
+}
+
+// Milliseconds until the memory governor lets the next discovery turn run (0 = now).
+static uint32_t
+haDiscoveryGapRemainingMs(uint32_t nowMs)
+{
+	const uint32_t gapMs = memGovernorPolicy(g_memGovernor).discoveryGapMs;
+	const uint32_t sinceMs = nowMs - g_haDiscoveryLastTurnMs;
+	return (sinceMs >= gapMs) ? 0 : (gapMs - sinceMs);
+}
+
+static void
+loopTaskHaDiscovery(void *)
+{
+	// Send HA auto-discovery info
+	if (!g_loopSkipPublishThisTurn &&
+	    mqttSubsystemEnabled() &&
+	    !g_loopSchedulerCoolingDown &&
+	    resendHaData == true && _mqtt.connected()) {
+		const uint32_t nowMs = millis();
+		if (warmStartDiscoveryHoldRemainingMs(nowMs) > 0) {
+			return;
+		}
+		if (haDiscoveryGapRemainingMs(nowMs) > 0) {
+			memGovernorNote(g_memGovernor, MemGovernorDecision::SlowDiscovery, nowMs);
+			return;
+		}
+		g_haDiscoveryLastTurnMs = nowMs;
+		sendHaData();
+	}
+}
+
+static uint32_t
+loopTaskHaDiscoveryNextDue(uint32_t nowMs, void *)
+{
+	if (!resendHaData || !_mqtt.connected()) {
+		return kCoopNoDeadlineMs;
+	}
+	const uint32_t holdMs = warmStartDiscoveryHoldRemainingMs(nowMs);
+	const uint32_t gapMs = haDiscoveryGapRemainingMs(nowMs);
+	return holdMs > gapMs ? holdMs : gapMs;
+}
+
+// Mirrors the early returns in rs485ProbeTick() and serviceRs485BaudReconcile().
+static uint32_t
+primaryRs485MsUntilDue(uint32_t nowMs)
+{
+	uint32_t nextAtMs = static_cast<uint32_t>(rs485NextAttemptAtMs);
+	if (rs485ConnectState == Rs485ConnectState::Connected) {
+		if (!inverterReady || !opData.essRs485Connected ||
+		    !rs485BaudTrackerNeedsObservation(rs485BaudTracker, rs485RuntimeReconnect.connectionEpoch)) {
+			return kCoopNoDeadlineMs;
+		}
+		nextAtMs = rs485BaudNextActionAtMs;
+	}
+	const int32_t remaining = static_cast<int32_t>(nextAtMs - nowMs);
+	return (remaining <= 0) ? 0 : static_cast<uint32_t>(remaining);
+}
+
+static uint32_t
+loopTaskRs485NextDue(uint32_t nowMs, void *)
+{
+	if (!bootPlan.inverter) {
+		return kCoopNoDeadlineMs;
+	}
+	const uint32_t primaryMs = primaryRs485MsUntilDue(nowMs);
+#if RS485_AUX_BUS
+	const uint32_t auxMs = auxBusMsUntilDue(nowMs);
+	return (auxMs < primaryMs) ? auxMs : primaryMs;
+#else
+	return primaryMs;
+#endif
+}
+
+static void
+loopTaskSendData(void *)
+{
+	// Scheduler runs continuously; per-bucket prerequisites are resolved inside sendData().
+	if (!g_loopSkipPublishThisTurn && mqttSubsystemEnabled() && !g_loopSchedulerCoolingDown) {
+		sendData();
+	}
+}
+
+static void
+loopTaskDispatch(void *)
+{
+	if (!g_loopSkipPublishThisTurn && bootPlan.inverter && mqttSubsystemEnabled() && !g_loopSchedulerCoolingDown) {
+		dispatchService();
+	}
+}
+
+static uint32_t
+loopTaskSendDataNextDue(uint32_t nowMs, void *)
+{
+	return sendDataMsUntilDue(nowMs);
+}
+
+static uint32_t
+loopTaskDispatchNextDue(uint32_t nowMs, void *)
+{
+	return dispatchMsUntilDueNow(nowMs);
+}
+
+#if MQTT_OUTBOUND_QUEUE
+static void
+loopTaskMqttOut(void *)
+{
+	if (g_mqttOutbound != nullptr && _mqtt.connected()) {
+		mqttOutboundDrain(*g_mqttOutbound, millis(), kMqttOutboundDrainPerTurn, publishQueuedEntityState, nullptr);
+	}
+}
+
+static uint32_t
+loopTaskMqttOutNextDue(uint32_t nowMs, void *)
+{
+	if (g_mqttOutbound == nullptr || !_mqtt.connected()) {
+		return kCoopNoDeadlineMs;
+	}
+	return mqttOutboundMsUntilSend(*g_mqttOutbound, nowMs, kCoopNoDeadlineMs);
+}
+#endif
+
+#if TELEMETRY_HISTORY
+static void
+loopTaskHistory(void *)
+{
+	if (replayTelemetryHistoryBlock()) {
+		g_telemetryHistoryLastReplayMs = millis();
+	}
+}
+
+static uint32_t
+loopTaskHistoryNextDue(uint32_t nowMs, void *)
+{
+	// Discovery resends after a reconnect go first; replay resumes once they are done.
+	if (g_telemetryHistory == nullptr || g_telemetryHistory->count == 0 || !_mqtt.connected() || resendHaData) {
+		return kCoopNoDeadlineMs;
+	}
+	const uint32_t sinceMs = nowMs - g_telemetryHistoryLastReplayMs;
+	return (sinceMs >= kTelemetryHistoryReplayIntervalMs) ? 0 : (kTelemetryHistoryReplayIntervalMs - sinceMs);
+}
+#endif
+
+static void
+loopTaskSettings(void *)
+{
+	if (settingsJournalMsUntilFlush(g_settingsJournal, millis()) == 0) {
+		flushSettingsJournal();
+	}
+}
+
+static uint32_t
+loopTaskSettingsNextDue(uint32_t nowMs, void *)
+{
+	const uint32_t dueMs = settingsJournalMsUntilFlush(g_settingsJournal, nowMs);
+	return (dueMs < kCoopNoDeadlineMs) ? dueMs : kCoopNoDeadlineMs;
+}
+
+#if METRIC_LOG
+static void
+loopTaskMetricLog(void *)
+{
+	const uint32_t nowS = metricLogNowS();
+	if (nowS == 0) {
+		return;
+	}
+	const uint32_t slotS = nowS - (nowS % METRIC_LOG_INTERVAL_S);
+	if (slotS == g_metricLogLastSlotS) {
+		return;
+	}
+	g_metricLogLastSlotS = slotS;
+	if (!g_metricLogSeen || (millis() - g_metricLogSeenMs) > kMetricLogSampleMaxAgeMs || !ensureMetricLog()) {
+		return;
+	}
+	MetricLogRecord record;
+	record.timeS = slotS;
+	memcpy(record.values, g_metricLogLatest, sizeof(record.values));
+	metricLogAppend(*g_metricLog, g_metricLogStore, record);
+}
+#endif
+
+/*
+ * loopTaskMemGovernor
+ *
+ * Feeds the heap level to the memory governor once a second. When pressure has eased far enough
+ * that plan rebuilds are allowed again, a config/set that was only persisted is loaded and applied.
+ */
+static void
+loopTaskMemGovernor(void *)
+{
+	const uint32_t nowMs = millis();
+	MemSample sample = readMemSample();
+#if defined(MP_ESP32)
+	// readMemSample() reports no largest-block figure on ESP32; use the largest allocatable block.
+	sample.maxBlockB = ESP.getMaxAllocHeap();
+#endif
+	if (memGovernorSample(g_memGovernor, evaluateRuntimeMem(sample), nowMs)) {
+#ifdef DEBUG_OVER_SERIAL
+		Serial.printf("mem governor: level=%s free=%lu max=%lu frag=%u\r\n",
+		              memLevelName(g_memGovernor.level),
+		              static_cast<unsigned long>(sample.freeB),
+		              static_cast<unsigned long>(sample.maxBlockB),
+		              static_cast<unsigned>(sample.fragPct));
+#endif
+	}
+	if (!g_pollingConfigRebuildDeferred || memGovernorPolicy(g_memGovernor).deferPlanRebuild ||
+	    !shouldReloadPollingConfigFromStorage(pendingPollingConfigSet, pollingConfigLoadedFromStorage)) {
+		return;
+	}
+	g_pollingConfigRebuildDeferred = false;
+	loadPollingConfig();
+	if (pollingConfigLoadedFromStorage) {
+		updatePollingLastChange();
+		publishPollingConfig();
+		requestHaDataRefresh();
+		resendAllData = true;
+	}
+}
+
+static void
+loopTaskStatusLed(void *)
+{
+	updateStatusLed();
+}
+
+static void
+loopTaskRunstate(void *)
+{
+	// Check and display the runstate on the display
+	updateRunstate();
+}
+
+static void
+ensureLoopTasksRegistered(void)
+{
+	if (g_loopTasksRegistered) {
+		return;
+	}
+	g_loopTasksRegistered = true;
+	// Priority order mirrors the old fixed loop() order for the work that shares state.
+	// Event-driven tasks report their own deadline so loop() can sleep until the earliest one;
+	// the periods are a safety net in case a deadline input changes without a wake.
+	// Runs first so every other task in the pass sees the current memory policy.
+	coopSchedulerAdd(g_loopTasks, "mem_gov", loopTaskMemGovernor, nullptr, 1000, 0, 20);
+	g_loopTaskRs485 = coopSchedulerAdd(g_loopTasks, "rs485", loopTaskRs485, nullptr, 1000, 1, 250);
+	coopSchedulerSetNextDue(g_loopTasks, g_loopTaskRs485, loopTaskRs485NextDue);
+	const uint8_t haId = coopSchedulerAdd(g_loopTasks, "ha_discovery", loopTaskHaDiscovery, nullptr, 0, 2, 250);
+	coopSchedulerSetNextDue(g_loopTasks, haId, loopTaskHaDiscoveryNextDue);
+	const uint8_t sendId = coopSchedulerAdd(g_loopTasks, "send_data", loopTaskSendData, nullptr, 1000, 3, 1000);
+	coopSchedulerSetNextDue(g_loopTasks, sendId, loopTaskSendDataNextDue);
+	const uint8_t dispatchId = coopSchedulerAdd(g_loopTasks, "dispatch", loopTaskDispatch, nullptr, 1000, 4, 500);
+	coopSchedulerSetNextDue(g_loopTasks, dispatchId, loopTaskDispatchNextDue);
+#if MQTT_OUTBOUND_QUEUE
+	const uint8_t mqttOutId = coopSchedulerAdd(g_loopTasks, "mqtt_out", loopTaskMqttOut, nullptr, 0, 5, 100);
+	coopSchedulerSetNextDue(g_loopTasks, mqttOutId, loopTaskMqttOutNextDue);
+#endif
+#if TELEMETRY_HISTORY
+	// Lowest priority: replay only uses turns that live work left idle.
+	const uint8_t historyId = coopSchedulerAdd(g_loopTasks, "history", loopTaskHistory, nullptr, 0, 9, 100);
+	coopSchedulerSetNextDue(g_loopTasks, historyId, loopTaskHistoryNextDue);
+#endif
+#if METRIC_LOG
+	// Checks once a second whether a new interval slot started; appends touch flash once per block.
+	coopSchedulerAdd(g_loopTasks, "metric_log", loopTaskMetricLog, nullptr, 1000, 10, 100);
+#endif
+	// Batched settings flush once writes go quiet (or stay busy for too long); one flash write each.
+	const uint8_t settingsId = coopSchedulerAdd(g_loopTasks, "settings", loopTaskSettings, nullptr, 0, 11, 100);
+	coopSchedulerSetNextDue(g_loopTasks, settingsId, loopTaskSettingsNextDue);
+	// Activity pulses wake the LED task directly; the period only covers state-driven patterns.
+	g_loopTaskStatusLed = coopSchedulerAdd(g_loopTasks, "status_led", loopTaskStatusLed, nullptr, 100, 6, 5);
+	coopSchedulerAdd(g_loopTasks, "runstate", loopTaskRunstate, nullptr, 1000, 8, 50);
+}
+
+/*
+ * loopIdleSleep
+ *
+ * Sleeps until the earliest scheduled deadline, capped so MQTT/HTTP (which are polled, not
+ * interrupt-driven) stay responsive. diagDelay() lets the core enter modem sleep on ESP8266
+ * and yields to the idle task (light sleep when power management is enabled) on ESP32.
+ */
+static void
+loopIdleSleep(void)
+{
+#if LOOP_IDLE_SLEEP
+	if (pendingPollingConfigPublish || resendHaData || deferredControlPlaneRebootScheduled) {
+		return;
+	}
+	const uint32_t sleepMs =
+		coopSchedulerMsUntilNextDue(g_loopTasks, millis(), LOOP_IDLE_MAX_SLEEP_MS);
+	if (sleepMs > 0) {
+		diagDelay(sleepMs);
+	}
+#endif
+}
+
+/*
+ * loop
+ *
+ * The loop function runs over and over again until power down or reset
+ */
+void
+loop()
+{
+#ifdef FORCE_RESTART_HOURS
+	static unsigned long autoReboot = 0;
+#endif
+#if RS485_STUB
+	bool hadPendingStubControlAtLoopEntry = pendingRs485StubControlSet;
+#endif
+
+#ifdef BUTTON_PIN
+	// Read button state
+	if (digitalRead(BUTTON_PIN) == LOW) {
+		configHandler();
+	}
+#endif // BUTTON_PIN
+
+	const uint32_t loopNowMs = millis();
+	loopSequence++;
+	diag_loop_tick(loopNowMs);
+	diag_wifi_status(static_cast<int16_t>(WiFi.status()), loopNowMs);
+	ensureLoopTasksRegistered();
+
+	// Refresh LED Screen, will cause the status asterisk to flicker.
+	// Stays ahead of the WiFi/MQTT/stub-control early returns so the display keeps updating during outages.
+	updateOLED(true, "", "", "");
+
+	if (bootPlan.wifiSta) {
+		// Make sure WiFi is good
+		if (WiFi.status() != WL_CONNECTED) {
+			if (lastWifiConnected) {
+				pendingWifiDisconnectEvent = true;
+			}
+			lastWifiConnected = false;
+		} else {
+			lastWifiConnected = true;
+		}
+		// One bounded step per turn; the MQTT block below waits for the link to come back.
+		serviceWifiReconnect();
+	}
+
+	if (mqttSubsystemEnabled()) {
+		// make sure mqtt is still connected
+		const bool mqttOk = pumpMqttOnce();
 		if (!mqttOk) {
 			if (lastMqttConnected) {
 				pendingMqttDisconnectEvent = true;
 			}
 			lastMqttConnected = false;
 			mqttReconnect();
-			requestHaDataResend();
+			requestHaDataRefresh();
 		} else {
 			lastMqttConnected = true;
 		}
@@ -8375,28 +9938,6 @@ loop()
 		subscribedInverterTopicsThisLoop = subscribeInverterTopics();
 	}
 
-	// Keep attempting RS485/inverter connection in the background. This must not block loop() so MQTT, HTTP,
-	// and the scheduler remain responsive even when RS485 is disconnected.
-	if (bootPlan.inverter) {
-		rs485ProbeTick();
-		serviceRs485BaudReconcile();
-	}
-
-	updateStatusLed();
-
-	// Check and display the runstate on the display
-	updateRunstate();
-
-	// Send HA auto-discovery info
-	if (!subscribedInverterTopicsThisLoop &&
-	    mqttSubsystemEnabled() &&
-#if RS485_STUB
-	    !rs485StubControlSchedulerCoolingDown &&
-#endif
-	    resendHaData == true && _mqtt.connected()) {
-		sendHaData();
-	}
-
 	if (bootPlan.inverter) {
 		static bool longEnough = false;
 		if (!longEnough && getUptimeSeconds() > 60) {  // After a minute, set these even if we didn't get a callback
@@ -8409,28 +9950,13 @@ loop()
 		}
 	}
 
-	// Scheduler runs continuously; per-bucket prerequisites are resolved inside sendData().
-	if (!subscribedInverterTopicsThisLoop &&
-	    mqttSubsystemEnabled() &&
-#if RS485_STUB
-	    !rs485StubControlSchedulerCoolingDown
-#else
-	    true
-#endif
-	    ) {
-		sendData();
-	}
-	if (!subscribedInverterTopicsThisLoop &&
-	    bootPlan.inverter &&
-	    mqttSubsystemEnabled() &&
+	g_loopSkipPublishThisTurn = subscribedInverterTopicsThisLoop;
 #if RS485_STUB
-	    !rs485StubControlSchedulerCoolingDown
+	g_loopSchedulerCoolingDown = rs485StubControlSchedulerCoolingDown;
 #else
-	    true
+	g_loopSchedulerCoolingDown = false;
 #endif
-	    ) {
-		dispatchService();
-	}
+	coopSchedulerRunDue(g_loopTasks);
 
 	// Force Restart?
 #ifdef FORCE_RESTART_HOURS
@@ -8438,6 +9964,8 @@ loop()
 		setBootIntentAndReboot(BootIntent::Normal);
 	}
 #endif
+
+	loopIdleSleep();
 }
 
 
@@ -8687,6 +10215,8 @@ loadPollingConfig(void)
 	bool migrateLegacyIndexBucketMap = false;
 	ScopedCharBuffer migratedBucketMapBuffer(0);
 	const char *persistedBucketMap = nullptr;
+	// Set when this load parsed text the binary record can stand in for on the next boot.
+	bool writeRecord = false;
 
 	persistLoadOk = 0;
 	persistLoadErr = 0;
@@ -8715,21 +10245,13 @@ loadPollingConfig(void)
 		pollingConfigLoadedFromStorage = shouldMarkRecoveredPollingConfigLoaded(failureKind);
 	};
 	const bool storedBucketMapPresent = preferences.isKey(kPreferenceBucketMap);
-	const size_t bucketMapBufferSize = storedBucketMapPresent
-	                                     ? preferenceStringBufferLen(
-	                                           preferences, kPreferenceBucketMap, kPrefBucketMapMaxLen)
-	                                     : kPrefBucketMapMaxLen;
-	ScopedCharBuffer bucketMapBuffer(bucketMapBufferSize);
-	if (!bucketMapBuffer.ok()) {
-		recoverRuntimeLoad("polling config alloc");
-		return;
-	}
-	char *bucketMap = bucketMapBuffer.data;
 
 	char lastChange[kPrefPollingLastChangeMaxLen] = "";
-	const size_t lastChangeLen = preferences.getString(kPreferencePollingLastChange,
-	                                                  lastChange,
-	                                                  sizeof(lastChange));
+	const size_t lastChangeLen =
+		(settingsJournalGetString(g_settingsJournal, kPreferencePollingLastChange, lastChange, sizeof(lastChange)) ==
+		 SettingsLookup::Missing)
+			? preferences.getString(kPreferencePollingLastChange, lastChange, sizeof(lastChange))
+			: strlen(lastChange);
 	if (lastChangeLen == 0) {
 		getPollingTimestamp(_pollingConfigLastChange, sizeof(_pollingConfigLastChange));
 	} else {
@@ -8761,12 +10283,37 @@ loadPollingConfig(void)
 		return true;
 	};
 
-	bucketMap[0] = '\0';
-	if (storedBucketMapPresent) {
-		preferences.getString(kPreferenceBucketMap, bucketMap, bucketMapBuffer.size);
-	}
 	const bool legacyMigrated = preferences.getBool(kPreferenceBucketMapMigrated, false);
-	if (bucketMap[0] != '\0') {
+	// Fast path: a record bound to the stored text and to a prefix of this catalog stands in for
+	// reading and parsing that text. Unmigrated configs always take the migration path below.
+	PollingConfigRecordStatus recordStatus = PollingConfigRecordStatus::Stale;
+	if (storedBucketMapPresent || legacyMigrated) {
+		recordStatus = loadPollingConfigRecord(preferences, entityCount, buckets);
+	}
+	const bool recordLoaded =
+		(recordStatus == PollingConfigRecordStatus::Ok || recordStatus == PollingConfigRecordStatus::Grown);
+
+	ScopedCharBuffer bucketMapBuffer(0);
+	char *bucketMap = nullptr;
+	if (!recordLoaded) {
+		const size_t bucketMapBufferSize = storedBucketMapPresent
+		                                     ? preferenceStringBufferLen(
+		                                           preferences, kPreferenceBucketMap, kPrefBucketMapMaxLen)
+		                                     : kPrefBucketMapMaxLen;
+		if (!bucketMapBuffer.reset(bucketMapBufferSize)) {
+			recoverRuntimeLoad("polling config alloc");
+			return;
+		}
+		bucketMap = bucketMapBuffer.data;
+		if (storedBucketMapPresent) {
+			preferences.getString(kPreferenceBucketMap, bucketMap, bucketMapBuffer.size);
+		}
+	}
+	if (recordLoaded) {
+		// Grown records leave the appended entities on their catalog defaults; rewrite at full size.
+		writeRecord = (recordStatus == PollingConfigRecordStatus::Grown);
+		persistLoadOk = 1;
+	} else if (bucketMap[0] != '\0') {
 		if (bucketMapUsesDescriptorIndices(bucketMap)) {
 			if (!ensureCatalog()) {
 				recoverRuntimeLoad("polling config legacy catalog");
@@ -8809,6 +10356,7 @@ loadPollingConfig(void)
 			                                              persistInvalidBucketCount,
 			                                              persistDuplicateEntityCount);
 			if (appliedBucketMap) {
+				writeRecord = true;
 				persistLoadOk = 1;
 			} else {
 				recoverRuntimeLoad(
@@ -8847,6 +10395,7 @@ loadPollingConfig(void)
 			persistLoadOk = 1;
 		}
 	} else {
+		writeRecord = true;
 		persistLoadOk = 1;
 	}
 
@@ -8857,7 +10406,11 @@ loadPollingConfig(void)
 		return;
 	}
 	if (migrateLegacyIndexBucketMap && persistedBucketMap != nullptr) {
-		persistUserBucketMap(persistedBucketMap);
+		persistUserBucketMap(persistedBucketMap, buckets);
+	}
+	// Names the text holds that this catalog lacks would be lost from a record; keep parsing those.
+	if (writeRecord && persistUnknownEntityCount == 0) {
+		persistPollingConfigRecord(buckets, entityCount);
 	}
 	recomputeBucketCounts();
 	pollingConfigLoadedFromStorage = true;
@@ -8904,21 +10457,24 @@ struct CountedMqttPayload {
 	bool counting = true;
 	bool ok = true;
 	size_t length = 0;
+	// When set, appended text is compacted/abbreviated before it is counted or streamed.
+	HaJsonCompactor *compactor = nullptr;
+	// Count pass only: hash of the final payload bytes, used to skip unchanged discovery configs.
+	bool fingerprinting = false;
+	uint32_t fingerprint = kFingerprintSeed;
 };
 
 static bool
-appendCountedMqttText(CountedMqttPayload &payload, const char *text)
+appendCountedMqttBytes(CountedMqttPayload &payload, const char *data, size_t len)
 {
-	if (text == nullptr) {
-		payload.ok = false;
-		return false;
-	}
-	const size_t len = strlen(text);
 	if (payload.counting) {
+		if (payload.fingerprinting) {
+			payload.fingerprint = fingerprintUpdate(payload.fingerprint, data, len);
+		}
 		payload.length += len;
 		return true;
 	}
-	if (!streamMqttWrite(text, len)) {
+	if (!streamMqttWrite(data, len)) {
 		payload.ok = false;
 		return false;
 	}
@@ -8926,6 +10482,24 @@ appendCountedMqttText(CountedMqttPayload &payload, const char *text)
 	return true;
 }
 
+static bool
+appendCountedMqttText(CountedMqttPayload &payload, const char *text)
+{
+	if (text == nullptr) {
+		payload.ok = false;
+		return false;
+	}
+	const size_t len = strlen(text);
+	if (payload.compactor != nullptr) {
+		if (!haJsonCompactorFeed(*payload.compactor, text, len)) {
+			payload.ok = false;
+			return false;
+		}
+		return true;
+	}
+	return appendCountedMqttBytes(payload, text, len);
+}
+
 static bool
 appendCountedMqttFmt(CountedMqttPayload &payload, char *scratch, size_t scratchSize, const char *fmt, ...)
 {
@@ -8946,8 +10520,19 @@ appendCountedMqttFmt(CountedMqttPayload &payload, char *scratch, size_t scratchS
 
 using CountedMqttEmitter = bool (*)(CountedMqttPayload&, void *);
 
+// Optional fingerprint check for retained discovery publishes; see publishDiscoveryPayload().
+struct DiscoveryPublishGate {
+	size_t slot;
+	bool skipUnchanged;
+	bool skipped;
+};
+
 static bool
-publishCountedMqttPayload(const char *topic, bool retain, CountedMqttEmitter emit, void *context)
+publishCountedMqttPayload(const char *topic,
+                          bool retain,
+                          CountedMqttEmitter emit,
+                          void *context,
+                          DiscoveryPublishGate *gate = nullptr)
 {
 	static unsigned long lastFailureLogMs = 0;
 	const unsigned long nowMs = millis();
@@ -8966,15 +10551,30 @@ publishCountedMqttPayload(const char *topic, bool retain, CountedMqttEmitter emi
 	}
 
 	CountedMqttPayload countPass{};
+	if (gate != nullptr) {
+		countPass.fingerprinting = true;
+		countPass.fingerprint = fingerprintString(kFingerprintSeed, topic);
+	}
 	if (!emit(countPass, context) || !countPass.ok) {
 		return false;
 	}
+	if (gate != nullptr) {
+		gate->skipped = false;
+		if (gate->skipUnchanged &&
+		    discoveryFingerprintMatches(*g_discoveryFingerprints, gate->slot, countPass.fingerprint)) {
+			gate->skipped = true;
+			return true;
+		}
+	}
 	noteTrackedMqttPayload(currentRuntimeDiagPayloadKind, countPass.length);
 	if (countPass.length == 0) {
 		const bool published = _mqtt.publish(topic, "", retain);
 		noteRuntimePhaseObservation(currentRuntimeDiagPhase);
 		if (published) {
 			noteMqttActivityPulse();
+			if (gate != nullptr) {
+				discoveryFingerprintStore(*g_discoveryFingerprints, gate->slot, countPass.fingerprint);
+			}
 		}
 		return published;
 	}
@@ -9013,6 +10613,203 @@ publishCountedMqttPayload(const char *topic, bool retain, CountedMqttEmitter emi
 	}
 	noteRuntimePhaseObservation(currentRuntimeDiagPhase);
 	noteMqttActivityPulse();
+	if (gate != nullptr) {
+		discoveryFingerprintStore(*g_discoveryFingerprints, gate->slot, countPass.fingerprint);
+	}
+	return true;
+}
+
+static uint32_t
+discoveryCatalogHash(void)
+{
+	uint32_t hash = kFingerprintSeed;
+	const size_t entityCount = mqttEntitiesCount();
+	hash = fingerprintUpdate(hash, &entityCount, sizeof(entityCount));
+	for (size_t idx = 0; idx < entityCount; ++idx) {
+		mqttState entity{};
+		char entityName[64];
+		if (!mqttEntityCopyByIndex(idx, &entity)) {
+			continue;
+		}
+		mqttEntityNameCopy(&entity, entityName, sizeof(entityName));
+		hash = fingerprintString(hash, entityName);
+	}
+	return hash;
+}
+
+// Loads the persisted table once; a catalog or firmware change invalidates every fingerprint.
+static bool
+ensureDiscoveryFingerprints(void)
+{
+	if (g_discoveryFingerprints == nullptr) {
+		g_discoveryFingerprints = new (std::nothrow) DiscoveryFingerprintTable;
+		if (g_discoveryFingerprints == nullptr) {
+			return false;
+		}
+		g_discoveryFingerprintsLoaded = false;
+	}
+	if (g_discoveryFingerprintsLoaded || !mqttEntitiesRtAvailable()) {
+		return g_discoveryFingerprintsLoaded;
+	}
+	const uint32_t catalogHash = discoveryCatalogHash();
+	const uint32_t versionHash = fingerprintString(kFingerprintSeed, _version);
+	const size_t blobSize = discoveryFingerprintBlobSize();
+	uint8_t *blob = new (std::nothrow) uint8_t[blobSize];
+	size_t loaded = 0;
+	Preferences preferences;
+	if (blob != nullptr && preferences.begin(DEVICE_NAME, true)) {
+		if (preferences.getBytesLength(kPreferenceHaDiscoveryFingerprints) == blobSize) {
+			loaded = preferences.getBytes(kPreferenceHaDiscoveryFingerprints, blob, blobSize);
+		}
+		preferences.end();
+	}
+	(void)discoveryFingerprintDeserialize(*g_discoveryFingerprints, blob, loaded, catalogHash, versionHash);
+	delete[] blob;
+	g_discoveryFingerprintsLoaded = true;
+	return true;
+}
+
+// Polling plan the warm-start record was written under: interval, catalog and per-entity buckets.
+static uint32_t
+warmStartPlanFingerprint(void)
+{
+	if (!mqttEntitiesRtAvailable()) {
+		return 0;
+	}
+	const size_t entityCount = mqttEntitiesCount();
+	const uint32_t catalog = mqttEntityCatalogFingerprint(entityCount);
+	uint32_t hash = fingerprintUpdate(kFingerprintSeed, &pollIntervalSeconds, sizeof(pollIntervalSeconds));
+	hash = fingerprintUpdate(hash, &catalog, sizeof(catalog));
+	for (size_t idx = 0; idx < entityCount; ++idx) {
+		const uint8_t freq = static_cast<uint8_t>(mqttEntityEffectiveFreqByIndex(idx));
+		hash = fingerprintUpdate(hash, &freq, sizeof(freq));
+	}
+	return hash;
+}
+
+// Digest of the discovery fingerprint table; equal digests mean a refresh would publish nothing.
+static uint32_t
+warmStartDiscoveryFingerprint(void)
+{
+	if (!ensureDiscoveryFingerprints()) {
+		return 0;
+	}
+	const DiscoveryFingerprintTable &table = *g_discoveryFingerprints;
+	uint32_t hash = fingerprintUpdate(kFingerprintSeed, &table.catalogHash, sizeof(table.catalogHash));
+	hash = fingerprintUpdate(hash, &table.versionHash, sizeof(table.versionHash));
+	hash = fingerprintUpdate(hash, table.known, sizeof(table.known));
+	return fingerprintUpdate(hash, table.fingerprints, sizeof(table.fingerprints));
+}
+
+// Queued clears may wipe topics the table still lists as published, so trust none of it afterwards.
+static void
+forgetDiscoveryFingerprints(void)
+{
+	if (g_discoveryFingerprints == nullptr || discoveryFingerprintKnownCount(*g_discoveryFingerprints) == 0) {
+		return;
+	}
+	discoveryFingerprintReset(*g_discoveryFingerprints,
+	                          g_discoveryFingerprints->catalogHash,
+	                          g_discoveryFingerprints->versionHash);
+	g_discoveryFingerprints->dirty = true;
+}
+
+static void
+persistDiscoveryFingerprints(void)
+{
+	if (g_discoveryFingerprints == nullptr || !g_discoveryFingerprints->dirty) {
+		return;
+	}
+	const size_t blobSize = discoveryFingerprintBlobSize();
+	uint8_t *blob = new (std::nothrow) uint8_t[blobSize];
+	if (blob == nullptr) {
+		return;
+	}
+	const size_t written = discoveryFingerprintSerialize(*g_discoveryFingerprints, blob, blobSize);
+	Preferences preferences;
+	if (written == blobSize && preferences.begin(DEVICE_NAME, false)) {
+		if (preferences.putBytes(kPreferenceHaDiscoveryFingerprints, blob, blobSize) == blobSize) {
+			g_discoveryFingerprints->dirty = false;
+		}
+		settingsJournalNoteWrite(g_settingsJournal, kPreferenceHaDiscoveryFingerprints);
+		preferences.end();
+	}
+	delete[] blob;
+}
+
+static void
+loadWarmStartRecord(void)
+{
+	g_warmStartRecordValid = false;
+	uint8_t encoded[kWarmStartRecordBytes];
+	size_t loaded = 0;
+	Preferences preferences;
+	if (preferences.begin(DEVICE_NAME, true)) {
+		if (preferences.getBytesLength(kPreferenceWarmStart) == sizeof(encoded)) {
+			loaded = preferences.getBytes(kPreferenceWarmStart, encoded, sizeof(encoded));
+		}
+		preferences.end();
+	}
+	g_warmStartRecordValid = warmStartDecode(encoded, loaded, g_warmStartRecord);
+}
+
+// Rewritten only when something the next boot would use changed, so steady reboots cost no flash write.
+static void
+persistWarmStartRecord(void)
+{
+	if (rs485ConnectState != Rs485ConnectState::Connected || !inverterSerialKnown() || rs485LockedBaud == 0) {
+		return;
+	}
+	WarmStartRecord record{};
+	record.baud = static_cast<uint32_t>(rs485LockedBaud);
+	record.slaveId = g_inverterFleet.slots[0].slaveId;
+	record.planFingerprint = warmStartPlanFingerprint();
+	record.discoveryFingerprint = warmStartDiscoveryFingerprint();
+	strlcpy(record.serial, deviceSerialNumber, sizeof(record.serial));
+	strlcpy(record.firmware, _version, sizeof(record.firmware));
+	if (g_warmStartRecordValid && warmStartRecordEqual(record, g_warmStartRecord)) {
+		return;
+	}
+
+	uint8_t encoded[kWarmStartRecordBytes];
+	if (warmStartEncode(record, encoded, sizeof(encoded)) != sizeof(encoded)) {
+		return;
+	}
+	Preferences preferences;
+	if (preferences.begin(DEVICE_NAME, false)) {
+		if (preferences.putBytes(kPreferenceWarmStart, encoded, sizeof(encoded)) == sizeof(encoded)) {
+			g_warmStartRecord = record;
+			g_warmStartRecordValid = true;
+		}
+		settingsJournalNoteWrite(g_settingsJournal, kPreferenceWarmStart);
+		preferences.end();
+	}
+}
+
+// Publishes a retained discovery payload, or skips it when a reconnect finds the broker already
+// holds the same bytes on the same topic. Non-retained payloads are never skipped, and neither are
+// a secondary inverter's: fingerprints are kept for the primary inverter's entities only.
+static bool
+publishDiscoveryPayload(size_t slot, const char *topic, bool retain, CountedMqttEmitter emit, void *context)
+{
+	if (!retain || activeInverterSlot != 0 || !ensureDiscoveryFingerprints()) {
+		return publishCountedMqttPayload(topic, retain, emit, context);
+	}
+	DiscoveryPublishGate gate{ slot, resendHaSkipUnchanged, false };
+	if (!publishCountedMqttPayload(topic, retain, emit, context, &gate)) {
+		return false;
+	}
+	if (gate.skipped) {
+		haDiscoverySkipCount++;
+	} else {
+		haDiscoveryPublishCount++;
+	}
+	return true;
+}
+
+static bool
+emitEmptyDiscoveryPayload(CountedMqttPayload &, void *)
+{
 	return true;
 }
 
@@ -9150,7 +10947,12 @@ publishPollingConfigChunkClear(size_t startIndex, size_t endIndex)
 static bool
 publishPollingConfigChunked(const mqttState *entities, size_t entityCount, const BucketId *buckets)
 {
-	ScopedCharBuffer chunkMap(kPollingConfigChunkMapMaxLen);
+	size_t chunkMapMaxLen = kPollingConfigChunkMapMaxLen;
+	if (memGovernorPolicy(g_memGovernor).pollingConfigChunkMax < chunkMapMaxLen) {
+		chunkMapMaxLen = memGovernorPolicy(g_memGovernor).pollingConfigChunkMax;
+		memGovernorNote(g_memGovernor, MemGovernorDecision::ShrinkChunk, millis());
+	}
+	ScratchLease chunkMap(g_textScratchPool, ScratchPhase::PollingConfig, chunkMapMaxLen);
 	if (!chunkMap.ok()) {
 		return false;
 	}
@@ -9166,8 +10968,8 @@ publishPollingConfigChunked(const mqttState *entities, size_t entityCount, const
 		                                              entityCount,
 		                                              buckets,
 		                                              startIndex,
-		                                              chunkMap.data,
-		                                              kPollingConfigChunkMapMaxLen,
+		                                              chunkMap.chars(),
+		                                              chunkMap.size(),
 		                                              nextIndex,
 		                                              appliedCount)) {
 			return false;
@@ -9188,15 +10990,15 @@ publishPollingConfigChunked(const mqttState *entities, size_t entityCount, const
 		                                              entityCount,
 		                                              buckets,
 		                                              startIndex,
-		                                              chunkMap.data,
-		                                              kPollingConfigChunkMapMaxLen,
+		                                              chunkMap.chars(),
+		                                              chunkMap.size(),
 		                                              nextIndex,
 		                                              appliedCount) ||
 		    appliedCount == 0) {
 			return false;
 		}
 
-		PollingConfigChunkPayloadContext chunkPayload{ chunkIndex, chunkCount, chunkMap.data };
+		PollingConfigChunkPayloadContext chunkPayload{ chunkIndex, chunkCount, chunkMap.chars() };
 		snprintf(topic,
 		         sizeof(topic),
 		         "%s/config/entity_intervals/%lu",
@@ -9275,23 +11077,27 @@ publishPollingConfig(void)
 	delete[] publicBuckets;
 }
 
+// A non-null context (const bool *, true) emits the object as a device-discovery component,
+// which inherits the device block from the enclosing payload.
 static bool
-emitConfigDiscoveryPayload(CountedMqttPayload &payload, void * /* context */)
+emitConfigDiscoveryPayload(CountedMqttPayload &payload, void *context)
 {
 	const char *sensorName = "MQTT_Config";
 	const char *prettyName = "MQTT Config";
+	const bool asComponent = (context != nullptr) && *static_cast<const bool *>(context);
 	char addition[256];
 	return appendCountedMqttText(payload, "{") &&
 	       appendCountedMqttText(payload, "\"component\": \"sensor\"") &&
-	       appendCountedMqttFmt(payload,
-	                            addition,
-	                            sizeof(addition),
-	                            ", \"device\": {"
-	                            " \"name\": \"%s\", \"model\": \"%s\", \"manufacturer\": \"AlphaESS\","
-	                            " \"identifiers\": [\"%s\"]}",
-	                            deviceName,
-	                            kControllerModel,
-	                            controllerIdentifier) &&
+	       (asComponent ||
+	        appendCountedMqttFmt(payload,
+	                             addition,
+	                             sizeof(addition),
+	                             ", \"device\": {"
+	                             " \"name\": \"%s\", \"model\": \"%s\", \"manufacturer\": \"AlphaESS\","
+	                             " \"identifiers\": [\"%s\"]}",
+	                             deviceName,
+	                             kControllerModel,
+	                             controllerIdentifier)) &&
 	       appendCountedMqttFmt(payload, addition, sizeof(addition), ", \"name\": \"%s\"", prettyName) &&
 	       appendCountedMqttFmt(payload,
 	                            addition,
@@ -9316,22 +11122,25 @@ publishConfigDiscovery(void)
 {
 	char topic[128];
 	snprintf(topic, sizeof(topic), "homeassistant/sensor/%s/%s/config", controllerIdentifier, "MQTT_Config");
-	return publishCountedMqttPayload(topic, MQTT_RETAIN, emitConfigDiscoveryPayload, nullptr);
+	return publishDiscoveryPayload(kDiscoveryFingerprintSlotConfig, topic, MQTT_RETAIN, emitConfigDiscoveryPayload, nullptr);
 }
 
+// Context follows emitConfigDiscoveryPayload().
 static bool
-emitControllerInverterSerialDiscoveryPayload(CountedMqttPayload &payload, void * /* context */)
+emitControllerInverterSerialDiscoveryPayload(CountedMqttPayload &payload, void *context)
 {
+	const bool asComponent = (context != nullptr) && *static_cast<const bool *>(context);
 	char addition[256];
 	return appendCountedMqttText(payload, "{") &&
 	       appendCountedMqttText(payload, "\"component\": \"sensor\"") &&
-	       appendCountedMqttFmt(payload,
-	                            addition,
-	                            sizeof(addition),
-	                            ", \"device\": { \"name\": \"%s\", \"model\": \"%s\", \"manufacturer\": \"AlphaESS\", \"identifiers\": [\"%s\"]}",
-	                            deviceName,
-	                            kControllerModel,
-	                            controllerIdentifier) &&
+	       (asComponent ||
+	        appendCountedMqttFmt(payload,
+	                             addition,
+	                             sizeof(addition),
+	                             ", \"device\": { \"name\": \"%s\", \"model\": \"%s\", \"manufacturer\": \"AlphaESS\", \"identifiers\": [\"%s\"]}",
+	                             deviceName,
+	                             kControllerModel,
+	                             controllerIdentifier)) &&
 	       appendCountedMqttText(payload, ", \"name\": \"Inverter Serial\"") &&
 	       appendCountedMqttFmt(payload,
 	                            addition,
@@ -9354,7 +11163,11 @@ publishControllerInverterSerialDiscovery(void)
 {
 	char topic[160];
 	snprintf(topic, sizeof(topic), "homeassistant/sensor/%s/%s/config", controllerIdentifier, kControllerInverterSerialEntity);
-	return publishCountedMqttPayload(topic, MQTT_RETAIN, emitControllerInverterSerialDiscoveryPayload, nullptr);
+	return publishDiscoveryPayload(kDiscoveryFingerprintSlotInverterSerial,
+	                               topic,
+	                               MQTT_RETAIN,
+	                               emitControllerInverterSerialDiscoveryPayload,
+	                               nullptr);
 }
 
 void
@@ -9387,11 +11200,30 @@ requestHaDataResend(void)
 	resendHaData = true;
 	resendHaPreludePending = true;
 	resendHaNextEntityIndex = 0;
+	resendHaSkipUnchanged = false;
+}
+
+// Reconnect variant of requestHaDataResend(): the broker still holds our retained configs, so only
+// payloads whose fingerprint changed are republished. A pending full resend is never downgraded.
+void
+requestHaDataRefresh(void)
+{
+	if (resendHaData && !resendHaSkipUnchanged) {
+		return;
+	}
+	resendHaData = true;
+	resendHaPreludePending = true;
+	resendHaNextEntityIndex = 0;
+	resendHaSkipUnchanged = true;
 }
 
 static void
 queueCurrentHaDiscoveryClears(void)
 {
+#if HA_DEVICE_DISCOVERY
+	// The next device payload lists disabled entities as removals, so nothing needs clearing first.
+	return;
+#endif
 	if (controllerIdentifier[0] != '\0') {
 		queueStaleControllerDiscoveryClear(controllerIdentifier);
 	}
@@ -9419,11 +11251,9 @@ homeAssistantEntityType(const mqttState *entity)
 	}
 }
 
-bool
-clearHaEntityDiscovery(const mqttState *entity, const char *deviceId)
+static bool
+buildHaEntityDiscoveryTopic(const mqttState *entity, const char *deviceId, char *topic, size_t topicSize)
 {
-	char topic[128];
-
 	if (entity == nullptr || deviceId == nullptr || deviceId[0] == '\0') {
 		return false;
 	}
@@ -9431,14 +11261,48 @@ clearHaEntityDiscovery(const mqttState *entity, const char *deviceId)
 	char entityName[64];
 	mqttEntityNameCopy(entity, entityName, sizeof(entityName));
 	snprintf(topic,
-	         sizeof(topic),
+	         topicSize,
 	         "homeassistant/%s/%s/%s/config",
 	         homeAssistantEntityType(entity),
 	         deviceId,
 	         entityName);
+	return true;
+}
+
+bool
+clearHaEntityDiscovery(const mqttState *entity, const char *deviceId)
+{
+	char topic[128];
+	if (!buildHaEntityDiscoveryTopic(entity, deviceId, topic, sizeof(topic))) {
+		return false;
+	}
+	emptyPayload();
+	return sendMqtt(topic, MQTT_RETAIN);
+}
+
+// Clears a current entity's discovery topic, remembering the clear so reconnects can skip it.
+static bool
+clearCurrentHaEntityDiscovery(const mqttState *entity, const char *deviceId, size_t idx)
+{
+	char topic[128];
+	if (!buildHaEntityDiscoveryTopic(entity, deviceId, topic, sizeof(topic))) {
+		return false;
+	}
+	return publishDiscoveryPayload(idx, topic, MQTT_RETAIN, emitEmptyDiscoveryPayload, nullptr);
+}
+
+#if HA_DEVICE_DISCOVERY
+static bool
+clearHaDeviceDiscovery(const char *deviceId)
+{
+	char topic[128];
+	if (!buildHaDeviceDiscoveryTopic(deviceId, topic, sizeof(topic))) {
+		return false;
+	}
 	emptyPayload();
 	return sendMqtt(topic, MQTT_RETAIN);
 }
+#endif
 
 static bool
 clearHaControllerExtraDiscovery(const char *deviceId)
@@ -9472,6 +11336,13 @@ publishPendingStaleInverterDiscoveryClears(void)
 	}
 
 	const size_t entityCount = mqttEntitiesCount();
+#if HA_DEVICE_DISCOVERY
+	// A device-discovery payload is removed with one empty publish; per-entity topics only
+	// exist for ids published before the migration.
+	if (!haLegacyDiscoveryMigrationPending) {
+		resendHaClearStaleInverterIndex = entityCount;
+	}
+#endif
 	size_t batchCount = 0;
 	while (resendHaClearStaleInverterIndex < entityCount && batchCount < kHaDiscoveryBatchSize) {
 		const size_t idx = resendHaClearStaleInverterIndex;
@@ -9494,6 +11365,11 @@ publishPendingStaleInverterDiscoveryClears(void)
 	if (resendHaClearStaleInverterIndex < entityCount) {
 		return true;
 	}
+#if HA_DEVICE_DISCOVERY
+	if (!clearHaDeviceDiscovery(resendHaClearStaleInverterDeviceIds[resendHaClearStaleInverterQueueIndex])) {
+		return true;
+	}
+#endif
 
 	resendHaClearStaleInverterIndex = 0;
 	resendHaClearStaleInverterDeviceIds[resendHaClearStaleInverterQueueIndex][0] = '\0';
@@ -9524,6 +11400,11 @@ publishPendingStaleControllerDiscoveryClears(void)
 	}
 
 	const size_t entityCount = mqttEntitiesCount();
+#if HA_DEVICE_DISCOVERY
+	if (!haLegacyDiscoveryMigrationPending) {
+		resendHaClearStaleControllerIndex = entityCount;
+	}
+#endif
 	size_t batchCount = 0;
 	while (resendHaClearStaleControllerIndex < entityCount && batchCount < kHaDiscoveryBatchSize) {
 		const size_t idx = resendHaClearStaleControllerIndex;
@@ -9547,11 +11428,22 @@ publishPendingStaleControllerDiscoveryClears(void)
 	if (resendHaClearStaleControllerIndex < entityCount) {
 		return true;
 	}
-
+
+#if HA_DEVICE_DISCOVERY
+	if (haLegacyDiscoveryMigrationPending &&
+	    !clearHaControllerExtraDiscovery(
+	        g_controllerDiscoveryClearScratch->deviceIds[resendHaClearStaleControllerQueueIndex])) {
+		return true;
+	}
+	if (!clearHaDeviceDiscovery(g_controllerDiscoveryClearScratch->deviceIds[resendHaClearStaleControllerQueueIndex])) {
+		return true;
+	}
+#else
 	if (!clearHaControllerExtraDiscovery(
 	        g_controllerDiscoveryClearScratch->deviceIds[resendHaClearStaleControllerQueueIndex])) {
 		return true;
 	}
+#endif
 
 	resendHaClearStaleControllerIndex = 0;
 	g_controllerDiscoveryClearScratch->deviceIds[resendHaClearStaleControllerQueueIndex][0] = '\0';
@@ -9575,6 +11467,9 @@ publishHaEntityDiscovery(const mqttState *entity)
 	if (!mqttEntitiesRtAvailable()) {
 		return true;
 	}
+	if (!inverterSlotPollsEntity(*entity)) {
+		return true;
+	}
 	size_t idx = 0;
 	if (!lookupEntityIndex(entity->entityId, &idx)) {
 		return true;
@@ -9586,7 +11481,7 @@ publishHaEntityDiscovery(const mqttState *entity)
 		return true;
 	}
 	if (!includeEntityInPublicSurfaces(*entity)) {
-		return clearHaEntityDiscovery(entity, deviceId);
+		return clearCurrentHaEntityDiscovery(entity, deviceId, idx);
 	}
 
 	if (effectiveFreq == mqttUpdateFreq::freqNever) {
@@ -9594,7 +11489,7 @@ publishHaEntityDiscovery(const mqttState *entity)
 	}
 
 	if (effectiveFreq == mqttUpdateFreq::freqDisabled) {
-		return clearHaEntityDiscovery(entity, deviceId);
+		return clearCurrentHaEntityDiscovery(entity, deviceId, idx);
 	}
 
 	return sendDataFromMqttState(entity, true);
@@ -9610,7 +11505,7 @@ handlePollingConfigSet(char *payload)
 		bool pollIntervalChanged = false;
 		size_t entityCount = 0;
 		BucketId *buckets = nullptr;
-		BucketId *originalBuckets = nullptr;
+		const uint8_t *originalBuckets = nullptr;
 		uint32_t stagedPollInterval = kPollIntervalDefaultSeconds;
 	};
 
@@ -9628,9 +11523,12 @@ handlePollingConfigSet(char *payload)
 	}
 	ctx.stagedPollInterval = stagedPollIntervalSeconds;
 	const bool bucketsLoaded = mqttEntitiesRtAvailable();
-	BucketId originalBuckets[kMqttEntityDescriptorCount]{};
-	if (bucketsLoaded) {
-		memcpy(originalBuckets, buckets, sizeof(originalBuckets));
+	// Rollback point for the live runtime, packed three bits per entity.
+	uint8_t originalBuckets[kMqttEntityBucketSnapshotBytes] = {};
+	if (bucketsLoaded && !mqttEntitySaveBucketSnapshot(originalBuckets, sizeof(originalBuckets))) {
+		persistLoadOk = 0;
+		persistLoadErr = 1;
+		return false;
 	}
 	ctx.entityCount = entityCount;
 	ctx.buckets = buckets;
@@ -9662,8 +11560,8 @@ handlePollingConfigSet(char *payload)
 				}
 
 			if (!strcmp(key, "bucket_map")) {
-				BucketId beforeBuckets[kMqttEntityDescriptorCount]{};
-				memcpy(beforeBuckets, ctx.buckets, ctx.entityCount * sizeof(BucketId));
+				uint8_t beforeBuckets[packedBucketMapBytes(kMqttEntityDescriptorCount)];
+				packedBucketPack(beforeBuckets, ctx.buckets, ctx.entityCount);
 				persistUnknownEntityCount = 0;
 				persistInvalidBucketCount = 0;
 				persistDuplicateEntityCount = 0;
@@ -9678,7 +11576,7 @@ handlePollingConfigSet(char *payload)
 				if (!applied) {
 					return false;
 				}
-				if (memcmp(beforeBuckets, ctx.buckets, ctx.entityCount * sizeof(BucketId)) != 0) {
+				if (!packedBucketMatches(beforeBuckets, ctx.buckets, ctx.entityCount)) {
 					ctx.bucketAssignmentsChanged = true;
 				}
 #ifdef DEBUG_OVER_SERIAL
@@ -9728,7 +11626,12 @@ handlePollingConfigSet(char *payload)
 	if (!parsed) {
 		return false;
 	}
-	const bool bucketsCanApply = !mqttEntitiesRtAvailable() || mqttEntityCanApplyBuckets(ctx.buckets, entityCount);
+	// Under memory pressure a bucket change is only persisted; both plan builds (the dry run and
+	// the apply) wait until loopTaskMemGovernor reloads the schedule from storage.
+	const bool deferPlanRebuild = ctx.bucketAssignmentsChanged && mqttEntitiesRtAvailable() &&
+	                              memGovernorPolicy(g_memGovernor).deferPlanRebuild;
+	const bool bucketsCanApply =
+		deferPlanRebuild || !mqttEntitiesRtAvailable() || mqttEntityCanApplyBuckets(ctx.buckets, entityCount);
 	size_t persistedMapAppliedCount = 0;
 	size_t persistedMapLen = 0;
 	if ((ctx.pollIntervalChanged || ctx.bucketAssignmentsChanged) &&
@@ -9763,18 +11666,19 @@ handlePollingConfigSet(char *payload)
 			return false;
 		}
 
-		if (mqttEntitiesRtAvailable() && !mqttEntityApplyBuckets(buckets, entityCount)) {
+		if (!deferPlanRebuild && mqttEntitiesRtAvailable() && !mqttEntityApplyBuckets(buckets, entityCount)) {
 			persistLoadOk = 0;
 			persistLoadErr = 1;
 			return false;
 		}
-		ctx.bucketsApplied = mqttEntitiesRtAvailable();
+		ctx.bucketsApplied = !deferPlanRebuild && mqttEntitiesRtAvailable();
 	}
 	if ((ctx.pollIntervalChanged || ctx.bucketAssignmentsChanged) &&
 	    !persistUserPollingConfig(ctx.stagedPollInterval,
-	                             ctx.bucketAssignmentsChanged ? persistedMap.data : nullptr)) {
+	                             ctx.bucketAssignmentsChanged ? persistedMap.data : nullptr,
+	                             ctx.bucketAssignmentsChanged ? ctx.buckets : nullptr)) {
 		if (ctx.bucketsApplied) {
-			const bool rollbackOk = mqttEntityApplyBuckets(ctx.originalBuckets, entityCount);
+			const bool rollbackOk = mqttEntityRestoreBucketSnapshot(ctx.originalBuckets, kMqttEntityBucketSnapshotBytes);
 			if (!rollbackOk) {
 				pollingConfigLoadedFromStorage = false;
 			}
@@ -9784,9 +11688,17 @@ handlePollingConfigSet(char *payload)
 		return false;
 	}
 
-	if (ctx.bucketAssignmentsChanged) {
+	if (deferPlanRebuild) {
+		// Runtime buckets no longer match storage; reconnect and portal paths reload from storage.
+		pollingConfigLoadedFromStorage = false;
+		g_pollingConfigRebuildDeferred = true;
+		memGovernorNote(g_memGovernor, MemGovernorDecision::DeferPlanRebuild, millis());
+#ifdef DEBUG_OVER_SERIAL
+		Serial.println(F("config/set persisted; plan rebuild deferred (memory pressure)"));
+#endif
+	} else if (ctx.bucketAssignmentsChanged) {
 		ctx.anyChange = true;
-		requestHaDataResend();
+		requestHaDataRefresh();
 		resendAllData = true;
 	}
 	if (ctx.pollIntervalChanged) {
@@ -9804,8 +11716,10 @@ handlePollingConfigSet(char *payload)
 #endif
 		recomputeBucketCounts();
 		updatePollingLastChange();
-		pollingConfigLoadedFromStorage = true;
-		publishPollingConfig();
+		if (!deferPlanRebuild) {
+			pollingConfigLoadedFromStorage = true;
+			publishPollingConfig();
+		}
 #ifdef DEBUG_OVER_SERIAL
 		Serial.printf("config/set publish complete: poll_interval=%lu free=%u max=%u frag=%u\r\n",
 		              static_cast<unsigned long>(pollIntervalSeconds),
@@ -9819,10 +11733,160 @@ handlePollingConfigSet(char *payload)
 	return true;
 }
 
+/*
+ * stepWifiTxPower
+ *
+ * Step the station TX power down one notch (wrapping back to maximum) so repeated connect
+ * attempts also try lower power levels, and describe the new level for the OLED.
+ */
+static void
+stepWifiTxPower(char *line, size_t lineSize)
+{
+#if defined MP_ESP8266
+	wifiPower -= WIFI_POWER_DECREMENT;
+	if (wifiPower < WIFI_POWER_MIN) {
+		wifiPower = WIFI_POWER_MAX;
+	}
+	WiFi.setOutputPower(wifiPower);
+	snprintf(line, lineSize, "TX: %0.2f", wifiPower);
+#else
+	switch (wifiPower) {
+	case WIFI_POWER_19_5dBm:
+		wifiPower = WIFI_POWER_19dBm;
+		break;
+	case WIFI_POWER_19dBm:
+		wifiPower = WIFI_POWER_18_5dBm;
+		break;
+	case WIFI_POWER_18_5dBm:
+		wifiPower = WIFI_POWER_17dBm;
+		break;
+	case WIFI_POWER_17dBm:
+		wifiPower = WIFI_POWER_15dBm;
+		break;
+	case WIFI_POWER_15dBm:
+		wifiPower = WIFI_POWER_13dBm;
+		break;
+	case WIFI_POWER_13dBm:
+		wifiPower = WIFI_POWER_11dBm;
+		break;
+	case WIFI_POWER_11dBm:
+	default:
+		wifiPower = WIFI_POWER_19_5dBm;
+		break;
+	}
+	WiFi.setTxPower(wifiPower);
+	snprintf(line, lineSize, "TX: %0.01fdBm", (int)wifiPower / 4.0f);
+#endif
+}
+
+/*
+ * noteWifiConnected
+ *
+ * Post-connect bookkeeping shared by the blocking boot connect and the runtime reconnect machine.
+ */
+static void
+noteWifiConnected(void)
+{
+	char line3[OLED_CHARACTER_WIDTH];
+
+	clearWifiFailureTracking();
+#if METRIC_LOG
+	startMetricLogClock();
+#endif
+	if (bootNetDiagState.wifiConnectMs == 0) {
+		bootNetDiagState.wifiConnectMs = millis();
+	}
+
+	// Output some debug information
+#ifdef DEBUG_OVER_SERIAL
+	Serial.print("WiFi connected, IP is ");
+	Serial.println(WiFi.localIP());
+	byte *bssid = WiFi.BSSID();
+	sprintf(_debugOutput, "WiFi BSSID is %02X:%02X:%02X:%02X:%02X:%02X", bssid[0], bssid[1], bssid[2], bssid[3], bssid[4], bssid[5]);
+	Serial.println(_debugOutput);
+	Serial.print("WiFi RSSI: ");
+	Serial.println(WiFi.RSSI());
+#endif
+
+#if defined(MP_ESP8266)
+	// Free any retained scan results to reduce heap pressure in NORMAL mode.
+	WiFi.scanDelete();
+#ifdef DEBUG_OVER_SERIAL
+	Serial.println(F("WiFi scan results cleared."));
+#endif
+#endif
+
+	// Connected, so ditch out with blank screen
+	snprintf(line3, sizeof(line3), "%s", WiFi.localIP().toString().c_str());
+	updateOLED(false, line3, "", _version);
+}
+
+/*
+ * serviceWifiReconnect
+ *
+ * Advance the runtime WiFi reconnect machine by one step. Each call does at most one
+ * WiFi.begin() and returns, so RS485 polling carries on while the link is down.
+ */
+void
+serviceWifiReconnect(void)
+{
+	static WifiReconnect machine;
+	static bool machineReady = false;
+	char line3[OLED_CHARACTER_WIDTH];
+	char line4[OLED_CHARACTER_WIDTH] = "";
+
+	const uint32_t nowMs = millis();
+	const bool connected = WiFi.status() == WL_CONNECTED;
+	if (!machineReady) {
+		// Boot only gets here after the blocking initial connect succeeded.
+		wifiReconnectInit(machine, nowMs, true);
+		machineReady = true;
+	}
+	WifiReconnectInput input;
+	input.nowMs = nowMs;
+	input.connected = connected;
+	input.failureClass = connected ? WifiFailureClass::Unknown : classifyWifiFailure(currentWifiFailureSignals());
+	input.bootMode = currentBootMode;
+	input.hasStoredCredentials = isWifiConfigComplete();
+
+	switch (wifiReconnectStep(machine, input)) {
+	case WifiReconnectAction::Lost:
+#ifdef A2M_DEBUG_WIFI
+		wifiReconnects++;
+#endif // A2M_DEBUG_WIFI
+		wifiReconnectCount++;
+		clearWifiFailureTracking();
+#ifdef DEBUG_OVER_SERIAL
+		snprintf(_debugOutput, sizeof(_debugOutput), "Reconnect to %s", appConfig.wifiSSID.c_str());
+		Serial.println(_debugOutput);
+#endif
+		break;
+	case WifiReconnectAction::Begin:
+		beginWifiStationWithStoredCredentials();
+		stepWifiTxPower(line4, sizeof(line4));
+		snprintf(line3, sizeof(line3), "WiFi %u ...", static_cast<unsigned>(machine.failedAttempts));
+		updateOLED(false, "Reconnect", line3, line4);
+		break;
+	case WifiReconnectAction::Connected:
+		noteWifiConnected();
+		break;
+	case WifiReconnectAction::RestartWindow:
+		clearWifiFailureTracking();
+		break;
+	case WifiReconnectAction::RebootApConfig:
+		setBootIntentAndReboot(BootIntent::ApConfig);
+		break;
+	case WifiReconnectAction::None:
+	default:
+		break;
+	}
+}
+
 /*
  * setupWifi
  *
- * Connect to WiFi
+ * Connect to WiFi, blocking until the link is up. Only the boot path waits here; runtime
+ * link loss is handled by serviceWifiReconnect().
  */
 void
 setupWifi(bool initialConnect)
@@ -9906,42 +11970,7 @@ setupWifi(bool initialConnect)
 
 		if (tries % 50 == 0) {
 			beginWifiStationWithStoredCredentials();
-
-#if defined MP_ESP8266
-			wifiPower -= WIFI_POWER_DECREMENT;
-			if (wifiPower < WIFI_POWER_MIN) {
-				wifiPower = WIFI_POWER_MAX;
-			}
-			WiFi.setOutputPower(wifiPower);
-			snprintf(line4, sizeof(line4), "TX: %0.2f", wifiPower);
-#else
-			switch (wifiPower) {
-			case WIFI_POWER_19_5dBm:
-				wifiPower = WIFI_POWER_19dBm;
-				break;
-			case WIFI_POWER_19dBm:
-				wifiPower = WIFI_POWER_18_5dBm;
-				break;
-			case WIFI_POWER_18_5dBm:
-				wifiPower = WIFI_POWER_17dBm;
-				break;
-			case WIFI_POWER_17dBm:
-				wifiPower = WIFI_POWER_15dBm;
-				break;
-			case WIFI_POWER_15dBm:
-				wifiPower = WIFI_POWER_13dBm;
-				break;
-			case WIFI_POWER_13dBm:
-				wifiPower = WIFI_POWER_11dBm;
-				break;
-			case WIFI_POWER_11dBm:
-			default:
-				wifiPower = WIFI_POWER_19_5dBm;
-				break;
-			}
-			WiFi.setTxPower(wifiPower);
-			snprintf(line4, sizeof(line4), "TX: %0.01fdBm", (int)wifiPower / 4.0f);
-#endif
+			stepWifiTxPower(line4, sizeof(line4));
 		}
 
 		if (bootConnectPhase) {
@@ -9952,33 +11981,7 @@ setupWifi(bool initialConnect)
 		diagDelay(500);
 	}
 
-	clearWifiFailureTracking();
-	if (bootNetDiagState.wifiConnectMs == 0) {
-		bootNetDiagState.wifiConnectMs = millis();
-	}
-
-	// Output some debug information
-#ifdef DEBUG_OVER_SERIAL
-	Serial.print("WiFi connected, IP is ");
-	Serial.println(WiFi.localIP());
-	byte *bssid = WiFi.BSSID();
-	sprintf(_debugOutput, "WiFi BSSID is %02X:%02X:%02X:%02X:%02X:%02X", bssid[0], bssid[1], bssid[2], bssid[3], bssid[4], bssid[5]);
-	Serial.println(_debugOutput);
-	Serial.print("WiFi RSSI: ");
-	Serial.println(WiFi.RSSI());
-#endif
-
-#if defined(MP_ESP8266)
-	// Free any retained scan results to reduce heap pressure in NORMAL mode.
-	WiFi.scanDelete();
-#ifdef DEBUG_OVER_SERIAL
-	Serial.println(F("WiFi scan results cleared."));
-#endif
-#endif
-
-	// Connected, so ditch out with blank screen
-	snprintf(line3, sizeof(line3), "%s", WiFi.localIP().toString().c_str());
-	updateOLED(false, line3, "", _version);
+	noteWifiConnected();
 }
 
 
@@ -10566,15 +12569,47 @@ portalNormalRebootIntent(void)
 
 
 
+// PubSubClient's socket timeout only bounds the CONNACK wait. The broker hostname lookup and the
+// TCP connect run on the WiFiClient's own timeout (5 s on ESP8266, 3 s on ESP32), so it is cut
+// short for the connect and given back afterwards for the send window of large publishes.
+static constexpr uint32_t kMqttConnectTimeoutMs = 1000;
+#if defined(MP_ESP8266)
+static constexpr uint32_t kMqttClientIoTimeoutMs = 5000;
+#else
+static constexpr uint32_t kMqttClientIoTimeoutMs = 3000;
+#endif
+
+static void
+setMqttClientConnecting(bool connecting)
+{
+#if defined(MP_ESP8266)
+	// Covers hostByName() and the TCP connect; write() re-applies it to the open socket.
+	_wifi.setTimeout(connecting ? kMqttConnectTimeoutMs : kMqttClientIoTimeoutMs);
+#elif defined(MP_ESP32)
+#if defined(ESP_ARDUINO_VERSION_MAJOR) && ESP_ARDUINO_VERSION_MAJOR >= 3
+	if (connecting) {
+		_wifi.setConnectionTimeout(kMqttConnectTimeoutMs);
+	}
+#else
+	// Seconds on this core; it bounds the TCP connect but not the DNS lookup (up to 4 s).
+	_wifi.setTimeout((connecting ? kMqttConnectTimeoutMs : kMqttClientIoTimeoutMs) / 1000);
+#endif
+#endif
+}
+
 /*
  * mqttReconnect
  *
- * This function reconnects to the MQTT broker
+ * Advance the MQTT reconnect machine by one step. At most one broker connect is attempted per
+ * call; retries back off exponentially and wait for WiFi. An unreachable broker holds loop() for
+ * up to about 3 s on ESP8266 (1 s lookup, 1 s TCP connect, 1 s CONNACK) and up to about 6 s on
+ * ESP32, whose DNS lookup has its own 4 s limit.
  */
 void
 mqttReconnect(void)
 {
-	static unsigned long lastAttemptMs = 0;
+	static MqttReconnect machine;
+	static bool machineReady = false;
 	static int tries = 0;
 	static bool mqttTargetLogged = false;
 	char mqttReconnectLine3[OLED_CHARACTER_WIDTH] = "";
@@ -10582,12 +12617,23 @@ mqttReconnect(void)
 	bool subscribed = false;
 	bool inverterSubscriptionsAdded = false;
 
-	// Throttle reconnect attempts; do not block the main loop.
 	const unsigned long nowMs = millis();
-	if ((nowMs - lastAttemptMs) < 5000) {
+	if (!machineReady) {
+		mqttReconnectInit(machine, nowMs);
+		machineReady = true;
+	}
+	const bool wifiUp = WiFi.status() == WL_CONNECTED;
+	switch (mqttReconnectStep(machine, nowMs, wifiUp, _mqtt.connected())) {
+	case MqttReconnectAction::Lost:
+		// Drop the stale session once; the first new attempt follows after a short settle gap.
+		_mqtt.disconnect();
+		return;
+	case MqttReconnectAction::Connect:
+		break;
+	case MqttReconnectAction::None:
+	default:
 		return;
 	}
-	lastAttemptMs = nowMs;
 
 	initMqttEntitiesRtIfNeeded(true);
 	if (shouldReloadPollingConfigFromStorage(pendingPollingConfigSet, pollingConfigLoadedFromStorage)) {
@@ -10609,18 +12655,12 @@ mqttReconnect(void)
 	}
 #endif
 
-		_mqtt.disconnect();		// Just in case.
-		diagDelay(200);
-
 #ifdef BUTTON_PIN
 		// Read button state
 		if (digitalRead(BUTTON_PIN) == LOW) {
 			configHandler();
 		}
 #endif // BUTTON_PIN
-		if (WiFi.status() != WL_CONNECTED) {
-			setupWifi(false);
-		}
 		diag_wifi_status(static_cast<int16_t>(WiFi.status()), millis());
 
 #if defined(MP_ESP8266)
@@ -10644,7 +12684,6 @@ mqttReconnect(void)
 
 		snprintf(mqttReconnectLine3, sizeof(mqttReconnectLine3), "MQTT %d ...", tries);
 		updateOLED(false, "Connecting", mqttReconnectLine3, _version);
-		diagDelay(100);
 
 #ifdef DEBUG_OVER_SERIAL
 		debugLogMqttReconnectProbe();
@@ -10655,6 +12694,7 @@ mqttReconnect(void)
 #if defined(MP_ESP8266)
 			ESP.wdtDisable();
 #endif
+		setMqttClientConnecting(true);
 		const bool mqttConnected = _mqtt.connect(
 			deviceName,
 			appConfig.mqttUser.c_str(),
@@ -10663,6 +12703,7 @@ mqttReconnect(void)
 			0,
 			true,
 				"{ \"presence\": \"offline\", \"a2mStatus\": \"offline\", \"rs485Status\": \"unavailable\", \"gridStatus\": \"unavailable\" }");
+		setMqttClientConnecting(false);
 #if defined(MP_ESP8266)
 			ESP.wdtEnable(0);
 #endif
@@ -10707,6 +12748,7 @@ mqttReconnect(void)
 
 			// Subscribe or resubscribe to topics.
 			if (subscribed) {
+				mqttReconnectNoteResult(machine, millis(), true);
 				inverterSubscriptionsSet = false;
 				inverterCommandSubscriptionsSet = false;
 				inverterDispatchSubscriptionSet = false;
@@ -10717,12 +12759,13 @@ mqttReconnect(void)
 		}
 
 #ifdef DEBUG_OVER_SERIAL
-		sprintf(_debugOutput, "MQTT Failed: RC is %d\r\nTrying again in five seconds...", _mqtt.state());
+		sprintf(_debugOutput, "MQTT Failed: RC is %d", _mqtt.state());
 		Serial.println(_debugOutput);
 		Serial.printf("mqttReconnect attempt %d failed after %lu ms\r\n", tries, millis() - attemptStart);
 #endif
 		// Ensure we don't hold onto a half-open TCP session between attempts.
 		_wifi.stop();
+		mqttReconnectNoteResult(machine, millis(), false);
 		return;
 }
 
@@ -10745,28 +12788,17 @@ lookupSubscriptionSpan(const char *entityName, size_t entityNameLen, mqttState *
 	if (entityName == nullptr || outEntity == nullptr || entityNameLen == 0) {
 		return false;
 	}
-	int numberOfEntities = static_cast<int>(mqttEntitiesCount());
-	for (int i = 0; i < numberOfEntities; i++) {
-		if (!mqttEntityCopyByIndex(static_cast<size_t>(i), &scratch.inverterSubscriptionEntity)) {
-			continue;
-		}
-		if (!includeEntityInPublicSurfaces(scratch.inverterSubscriptionEntity) ||
-		    !scratch.inverterSubscriptionEntity.subscribe) {
-			continue;
-		}
-		mqttEntityNameCopy(&scratch.inverterSubscriptionEntity,
-		                   scratch.inverterSubscriptionEntityKey,
-		                   sizeof(scratch.inverterSubscriptionEntityKey));
-		const size_t candidateLen = strlen(scratch.inverterSubscriptionEntityKey);
-		if (candidateLen != entityNameLen) {
-			continue;
-		}
-		if (memcmp(scratch.inverterSubscriptionEntityKey, entityName, entityNameLen) == 0) {
-			*outEntity = scratch.inverterSubscriptionEntity;
-			return true;
-		}
+	size_t idx = 0;
+	if (!mqttEntityIndexByNameSpan(entityName, entityNameLen, &idx) ||
+	    !mqttEntityCopyByIndex(idx, &scratch.inverterSubscriptionEntity)) {
+		return false;
 	}
-	return false;
+	if (!includeEntityInPublicSurfaces(scratch.inverterSubscriptionEntity) ||
+	    !scratch.inverterSubscriptionEntity.subscribe) {
+		return false;
+	}
+	*outEntity = scratch.inverterSubscriptionEntity;
+	return true;
 }
 
 static bool
@@ -11558,7 +13590,8 @@ readEntity(const mqttState *singleEntity, modbusRequestAndResponse* rs)
 	}
 
 	if ((result != modbusRequestAndResponseStatusValues::readDataInvalidValue) &&
-	    (result != modbusRequestAndResponseStatusValues::readDataRegisterSuccess)) {
+	    (result != modbusRequestAndResponseStatusValues::readDataRegisterSuccess) &&
+	    (result != modbusRequestAndResponseStatusValues::responsePending)) {
 		recordRs485Error(result);
 #ifdef DEBUG_OVER_SERIAL
 		char entityName[64];
@@ -11648,6 +13681,16 @@ populateStatusPollSnapshot(StatusPollSnapshot &poll, bool includeEssSnapshot)
 	poll.essSnapshotAttempts = essSnapshotAttemptCount;
 	poll.essPowerSnapshotLastBuildMs = essPowerSnapshotLastBuildMs;
 	poll.snapshotPublishSkipCount = snapshotPublishSkipCount;
+	poll.haDiscoveryPublishCount = haDiscoveryPublishCount;
+	poll.haDiscoverySkipCount = haDiscoverySkipCount;
+#if MQTT_OUTBOUND_QUEUE
+	if (g_mqttOutbound != nullptr) {
+		poll.mqttOutDepth = g_mqttOutbound->stats.depth;
+		poll.mqttOutMaxDepth = g_mqttOutbound->stats.maxDepth;
+		poll.mqttOutCoalesced = g_mqttOutbound->stats.coalesced;
+		poll.mqttOutDropped = g_mqttOutbound->stats.dropped;
+	}
+#endif
 #if RS485_STUB
 	poll.rs485StubMode = _modBus ? _modBus->stubModeLabel() : "uninit";
 	poll.rs485StubFailRemaining = _modBus ? _modBus->stubFailRemaining() : 0;
@@ -11873,25 +13916,31 @@ populateStatusStubSnapshot(StatusStubSnapshot &stub)
 static bool __attribute__((noinline))
 publishStatusPollSnapshot(const StatusPollSnapshot &poll)
 {
-	if (!ensureStatusJsonScratch()) {
+	ScratchLease json(g_textScratchPool, ScratchPhase::StatusJson, kStatusJsonScratchSize);
+	if (!json.ok()) {
 		return false;
 	}
 	char pollTopic[160];
 	snprintf(pollTopic, sizeof(pollTopic), "%s/poll", statusTopic);
-	bool pollBuilt = buildStatusPollJson(poll, g_statusJsonScratch, kStatusJsonScratchSize);
+	bool pollBuilt = false;
 	bool usedCompactPoll = false;
+	if (memGovernorPolicy(g_memGovernor).compactStatus) {
+		memGovernorNote(g_memGovernor, MemGovernorDecision::CompactStatus, millis());
+	} else {
+		pollBuilt = buildStatusPollJson(poll, json.chars(), json.size());
+	}
 	if (!pollBuilt) {
-		pollBuilt = buildStatusPollJsonCompact(poll, g_statusJsonScratch, kStatusJsonScratchSize);
+		pollBuilt = buildStatusPollJsonCompact(poll, json.chars(), json.size());
 		usedCompactPoll = pollBuilt;
 	}
 	if (!pollBuilt) {
 		return false;
 	}
 	RuntimeDiagScope diagScope(RuntimeDiagPhase::StatusPublish, "poll");
-	bool published = publishTrackedTextPayload(pollTopic, g_statusJsonScratch, MQTT_RETAIN);
+	bool published = publishTrackedTextPayload(pollTopic, json.chars(), MQTT_RETAIN);
 	if (!published && !usedCompactPoll &&
-	    buildStatusPollJsonCompact(poll, g_statusJsonScratch, kStatusJsonScratchSize)) {
-		published = publishTrackedTextPayload(pollTopic, g_statusJsonScratch, MQTT_RETAIN);
+	    buildStatusPollJsonCompact(poll, json.chars(), json.size())) {
+		published = publishTrackedTextPayload(pollTopic, json.chars(), MQTT_RETAIN);
 	}
 #ifdef DEBUG_OVER_SERIAL
 	if (!published) {
@@ -11902,10 +13951,128 @@ publishStatusPollSnapshot(const StatusPollSnapshot &poll)
 	return published;
 }
 
+static bool __attribute__((noinline))
+publishStatusTasksSnapshot(void)
+{
+	ScratchLease json(g_textScratchPool, ScratchPhase::StatusJson, kStatusJsonScratchSize);
+	if (!_mqtt.connected() || !json.ok()) {
+		return false;
+	}
+	char topic[160];
+	snprintf(topic, sizeof(topic), "%s/tasks", statusTopic);
+	if (!buildStatusTasksJson(g_loopTasks, json.chars(), json.size())) {
+		return false;
+	}
+	RuntimeDiagScope diagScope(RuntimeDiagPhase::StatusPublish, "tasks");
+	const bool published = publishTrackedTextPayload(topic, json.chars(), MQTT_RETAIN);
+	maybeYield();
+	return published;
+}
+
+#if RS485_AUX_BUS
+static bool __attribute__((noinline))
+publishStatusAuxBusSnapshot(void)
+{
+	ScratchLease json(g_textScratchPool, ScratchPhase::StatusJson, kStatusJsonScratchSize);
+	if (_auxModBus == nullptr || !_mqtt.connected() || !json.ok()) {
+		return false;
+	}
+	char topic[160];
+	snprintf(topic, sizeof(topic), "%s/rs485_aux", statusTopic);
+	if (!multiBusDiagJson(g_auxBuses, kAuxBusLane, json.chars(), json.size())) {
+		return false;
+	}
+	RuntimeDiagScope diagScope(RuntimeDiagPhase::StatusPublish, "rs485_aux");
+	const bool published = publishTrackedTextPayload(topic, json.chars(), MQTT_RETAIN);
+	maybeYield();
+	return published;
+}
+#endif // RS485_AUX_BUS
+
+static bool __attribute__((noinline))
+publishStatusScratchSnapshot(void)
+{
+	ScratchLease json(g_textScratchPool, ScratchPhase::StatusJson, kStatusJsonScratchSize);
+	if (!_mqtt.connected() || !json.ok()) {
+		return false;
+	}
+	char topic[160];
+	snprintf(topic, sizeof(topic), "%s/scratch", statusTopic);
+	const ScratchPool *pools[] = { &g_textScratchPool };
+	if (!buildScratchPoolsJson(pools, sizeof(pools) / sizeof(pools[0]), json.chars(), json.size())) {
+		return false;
+	}
+	RuntimeDiagScope diagScope(RuntimeDiagPhase::StatusPublish, "scratch");
+	const bool published = publishTrackedTextPayload(topic, json.chars(), MQTT_RETAIN);
+	maybeYield();
+	return published;
+}
+
+#if ALLOC_PROFILER
+static bool __attribute__((noinline))
+publishStatusAllocSnapshot(void)
+{
+	ScratchLease json(g_textScratchPool, ScratchPhase::StatusJson, kStatusJsonScratchSize);
+	if (!_mqtt.connected() || !json.ok()) {
+		return false;
+	}
+	char topic[160];
+	snprintf(topic, sizeof(topic), "%s/alloc", statusTopic);
+	const char *phaseNames[kAllocProfilerPhaseCount] = {};
+	for (size_t i = 0; i <= static_cast<size_t>(RuntimeDiagPhase::DispatchForcePublish); ++i) {
+		phaseNames[i] = runtimeDiagPhaseName(static_cast<RuntimeDiagPhase>(i));
+	}
+	if (!buildAllocProfileJson(allocProfile(), phaseNames, kAllocProfilerPhaseCount, json.chars(), json.size())) {
+		return false;
+	}
+	RuntimeDiagScope diagScope(RuntimeDiagPhase::StatusPublish, "alloc");
+	const bool published = publishTrackedTextPayload(topic, json.chars(), MQTT_RETAIN);
+	maybeYield();
+	return published;
+}
+#endif // ALLOC_PROFILER
+
+static bool __attribute__((noinline))
+publishStatusSettingsSnapshot(void)
+{
+	ScratchLease json(g_textScratchPool, ScratchPhase::StatusJson, kStatusJsonScratchSize);
+	if (!_mqtt.connected() || !json.ok()) {
+		return false;
+	}
+	char topic[160];
+	snprintf(topic, sizeof(topic), "%s/settings", statusTopic);
+	if (!buildSettingsJournalJson(g_settingsJournal, json.chars(), json.size())) {
+		return false;
+	}
+	RuntimeDiagScope diagScope(RuntimeDiagPhase::StatusPublish, "settings");
+	const bool published = publishTrackedTextPayload(topic, json.chars(), MQTT_RETAIN);
+	maybeYield();
+	return published;
+}
+
+static bool __attribute__((noinline))
+publishStatusMemSnapshot(void)
+{
+	ScratchLease json(g_textScratchPool, ScratchPhase::StatusJson, kStatusJsonScratchSize);
+	if (!_mqtt.connected() || !json.ok()) {
+		return false;
+	}
+	char topic[160];
+	snprintf(topic, sizeof(topic), "%s/mem", statusTopic);
+	if (!buildMemGovernorJson(g_memGovernor, json.chars(), json.size())) {
+		return false;
+	}
+	RuntimeDiagScope diagScope(RuntimeDiagPhase::StatusPublish, "mem");
+	const bool published = publishTrackedTextPayload(topic, json.chars(), MQTT_RETAIN);
+	maybeYield();
+	return published;
+}
+
 static bool __attribute__((noinline))
 publishStatusPowerSnapshotDiagLastSnapshot(const StatusPowerSnapshotDiagLastSnapshot &snapshot)
 {
-	if (!_mqtt.connected() || !ensureStatusJsonScratch()) {
+	ScratchLease json(g_textScratchPool, ScratchPhase::StatusJson, kStatusJsonScratchSize);
+	if (!_mqtt.connected() || !json.ok()) {
 		return false;
 	}
 	if (!powerSnapshotDiagLastDirty) {
@@ -11913,11 +14080,11 @@ publishStatusPowerSnapshotDiagLastSnapshot(const StatusPowerSnapshotDiagLastSnap
 	}
 	char topic[192];
 	snprintf(topic, sizeof(topic), "%s/power_snapshot_diag_last", statusTopic);
-	if (!buildStatusPowerSnapshotDiagLastJson(snapshot, g_statusJsonScratch, kStatusJsonScratchSize)) {
+	if (!buildStatusPowerSnapshotDiagLastJson(snapshot, json.chars(), json.size())) {
 		return false;
 	}
 	RuntimeDiagScope diagScope(RuntimeDiagPhase::StatusPublish, "power_snapshot_diag_last");
-	if (!publishTrackedTextPayload(topic, g_statusJsonScratch, MQTT_RETAIN)) {
+	if (!publishTrackedTextPayload(topic, json.chars(), MQTT_RETAIN)) {
 		return false;
 	}
 	powerSnapshotDiagLastDirty = false;
@@ -11928,7 +14095,8 @@ publishStatusPowerSnapshotDiagLastSnapshot(const StatusPowerSnapshotDiagLastSnap
 static bool __attribute__((noinline))
 publishStatusPowerSnapshotDiagCountsSnapshot(const StatusPowerSnapshotDiagCountsSnapshot &snapshot)
 {
-	if (!_mqtt.connected() || !ensureStatusJsonScratch()) {
+	ScratchLease json(g_textScratchPool, ScratchPhase::StatusJson, kStatusJsonScratchSize);
+	if (!_mqtt.connected() || !json.ok()) {
 		return false;
 	}
 	if (!powerSnapshotDiagCountsDirty) {
@@ -11936,11 +14104,11 @@ publishStatusPowerSnapshotDiagCountsSnapshot(const StatusPowerSnapshotDiagCounts
 	}
 	char topic[192];
 	snprintf(topic, sizeof(topic), "%s/power_snapshot_diag_counts", statusTopic);
-	if (!buildStatusPowerSnapshotDiagCountsJson(snapshot, g_statusJsonScratch, kStatusJsonScratchSize)) {
+	if (!buildStatusPowerSnapshotDiagCountsJson(snapshot, json.chars(), json.size())) {
 		return false;
 	}
 	RuntimeDiagScope diagScope(RuntimeDiagPhase::StatusPublish, "power_snapshot_diag_counts");
-	if (!publishTrackedTextPayload(topic, g_statusJsonScratch, MQTT_RETAIN)) {
+	if (!publishTrackedTextPayload(topic, json.chars(), MQTT_RETAIN)) {
 		return false;
 	}
 	powerSnapshotDiagCountsDirty = false;
@@ -11968,15 +14136,16 @@ clearRetainedPowerSnapshotBuildTopicOnce(void)
 static bool __attribute__((noinline))
 publishStatusStubSnapshot(const StatusStubSnapshot &stub)
 {
-	if (!ensureStatusJsonScratch()) {
+	ScratchLease json(g_textScratchPool, ScratchPhase::StatusJson, kStatusJsonScratchSize);
+	if (!json.ok()) {
 		return false;
 	}
 	char stubTopic[160];
 	snprintf(stubTopic, sizeof(stubTopic), "%s/stub", statusTopic);
-	if (!buildStatusStubJson(stub, g_statusJsonScratch, kStatusJsonScratchSize)) {
+	if (!buildStatusStubJson(stub, json.chars(), json.size())) {
 		return false;
 	}
-	if (_mqtt.publish(stubTopic, g_statusJsonScratch, MQTT_RETAIN)) {
+	if (_mqtt.publish(stubTopic, json.chars(), MQTT_RETAIN)) {
 		noteMqttActivityPulse();
 		maybeYield();
 		return true;
@@ -11988,7 +14157,8 @@ publishStatusStubSnapshot(const StatusStubSnapshot &stub)
 static bool
 publishStubControlStatusNow(bool includeEssSnapshot)
 {
-	if (!_mqtt.connected() || !ensureStatusJsonScratch()) {
+	ScratchLease json(g_textScratchPool, ScratchPhase::StatusJson, kStatusJsonScratchSize);
+	if (!_mqtt.connected() || !json.ok()) {
 		return false;
 	}
 	// Stub-control acknowledgements avoid the full status builders because the extra locals and
@@ -11997,8 +14167,8 @@ publishStubControlStatusNow(bool includeEssSnapshot)
 	const char *stubMode = _modBus ? _modBus->stubModeLabel() : "uninit";
 	const char *skipReason = dispatchLastSkipReason ? dispatchLastSkipReason : "";
 	const int pollWritten = snprintf(
-		g_statusJsonScratch,
-		kStatusJsonScratchSize,
+		json.chars(),
+		json.size(),
 		"{"
 		"\"rs485_backend\":\"stub\","
 		"\"rs485_stub_mode\":\"%s\","
@@ -12054,17 +14224,17 @@ publishStubControlStatusNow(bool includeEssSnapshot)
 		static_cast<unsigned long>(rs485BaudTracker.hasConfiguredBaud ? rs485BaudTracker.configuredBaud : 0),
 		static_cast<unsigned long>(rs485BaudTracker.actualBaud),
 		rs485BaudSyncStateLabel(rs485BaudTracker.syncState));
-	if (pollWritten <= 0 || static_cast<size_t>(pollWritten) >= kStatusJsonScratchSize) {
+	if (pollWritten <= 0 || static_cast<size_t>(pollWritten) >= json.size()) {
 		return false;
 	}
 	char pollTopic[160];
 	snprintf(pollTopic, sizeof(pollTopic), "%s/poll", statusTopic);
-	const bool pollPublished = publishTrackedTextPayload(pollTopic, g_statusJsonScratch, MQTT_RETAIN);
+	const bool pollPublished = publishTrackedTextPayload(pollTopic, json.chars(), MQTT_RETAIN);
 	maybeYield();
 
 	const int stubWritten = snprintf(
-		g_statusJsonScratch,
-		kStatusJsonScratchSize,
+		json.chars(),
+		json.size(),
 		"{"
 		"\"strict_unknown\":%s,"
 		"\"fail_reads\":%s,"
@@ -12083,12 +14253,12 @@ publishStubControlStatusNow(bool includeEssSnapshot)
 		static_cast<unsigned long>(_modBus ? _modBus->stubFlapOnlineMs() : 0),
 		static_cast<unsigned long>(_modBus ? _modBus->stubFlapOfflineMs() : 0),
 		static_cast<unsigned long>(_modBus ? _modBus->stubProbeSuccessAfterN() : 0));
-	if (stubWritten <= 0 || static_cast<size_t>(stubWritten) >= kStatusJsonScratchSize) {
+	if (stubWritten <= 0 || static_cast<size_t>(stubWritten) >= json.size()) {
 		return false;
 	}
 	char stubTopic[160];
 	snprintf(stubTopic, sizeof(stubTopic), "%s/stub", statusTopic);
-	const bool stubPublished = _mqtt.publish(stubTopic, g_statusJsonScratch, MQTT_RETAIN);
+	const bool stubPublished = _mqtt.publish(stubTopic, json.chars(), MQTT_RETAIN);
 	if (stubPublished) {
 		noteMqttActivityPulse();
 	}
@@ -12100,9 +14270,6 @@ publishStubControlStatusNow(bool includeEssSnapshot)
 void
 sendStatus(bool includeEssSnapshot)
 {
-	if (!ensureStatusJsonScratch()) {
-		return;
-	}
 	StatusCoreSnapshot core{};
 	StatusNetSnapshot net{};
 	StatusPollSnapshot poll{};
@@ -12170,13 +14337,26 @@ sendStatus(bool includeEssSnapshot)
 	net.wifiStatus = wifiStatusLabel(WiFi.status());
 	net.wifiStatusCode = static_cast<int>(WiFi.status());
 	net.wifiReconnects = wifiReconnectCount;
+#if TELEMETRY_HISTORY
+	net.historyCapacityBytes = telemetryHistoryCapacityBytes();
+	if (g_telemetryHistory != nullptr) {
+		net.historySamples = telemetryHistorySampleCount(*g_telemetryHistory);
+		net.historyUsedBytes = telemetryHistoryUsedBytes(*g_telemetryHistory);
+		net.historyOldestAgeS = telemetryHistoryOldestAgeMs(*g_telemetryHistory, millis()) / 1000U;
+		net.historyDropped = g_telemetryHistory->stats.dropped;
+		net.historyReplaySamplesPerSec = g_telemetryHistory->stats.lastReplaySamplesPerSec;
+	}
+#endif
 
 	populateStatusPollSnapshot(poll, includeEssSnapshot);
 
-	if (!buildStatusCoreJson(core, g_statusJsonScratch, kStatusJsonScratchSize)) {
-		return;
+	{
+		ScratchLease json(g_textScratchPool, ScratchPhase::StatusJson, kStatusJsonScratchSize);
+		if (!json.ok() || !buildStatusCoreJson(core, json.chars(), json.size())) {
+			return;
+		}
+		resultAddedToPayload = addToPayload(json.chars());
 	}
-	resultAddedToPayload = addToPayload(g_statusJsonScratch);
 	if (resultAddedToPayload == modbusRequestAndResponseStatusValues::payloadExceededCapacity) {
 		return;
 	}
@@ -12191,19 +14371,37 @@ sendStatus(bool includeEssSnapshot)
 
 	char netTopic[160];
 	snprintf(netTopic, sizeof(netTopic), "%s/net", statusTopic);
-	if (buildStatusNetJson(net, g_statusJsonScratch, kStatusJsonScratchSize)) {
-		RuntimeDiagScope diagScope(RuntimeDiagPhase::StatusPublish, "net");
-		publishTrackedTextPayload(netTopic, g_statusJsonScratch, MQTT_RETAIN);
-		maybeYield();
+	{
+		ScratchLease json(g_textScratchPool, ScratchPhase::StatusJson, kStatusJsonScratchSize);
+		if (json.ok() && buildStatusNetJson(net, json.chars(), json.size())) {
+			RuntimeDiagScope diagScope(RuntimeDiagPhase::StatusPublish, "net");
+			publishTrackedTextPayload(netTopic, json.chars(), MQTT_RETAIN);
+			maybeYield();
+		}
 	}
 
 	publishStatusPollSnapshot(poll);
-	StatusPowerSnapshotDiagLastSnapshot powerSnapshotDiagLastSnapshot{};
-	StatusPowerSnapshotDiagCountsSnapshot powerSnapshotDiagCountsSnapshot{};
-	populateStatusPowerSnapshotDiagLastSnapshot(powerSnapshotDiagLastSnapshot);
-	populateStatusPowerSnapshotDiagCountsSnapshot(powerSnapshotDiagCountsSnapshot);
-	publishStatusPowerSnapshotDiagLastSnapshot(powerSnapshotDiagLastSnapshot);
-	publishStatusPowerSnapshotDiagCountsSnapshot(powerSnapshotDiagCountsSnapshot);
+	publishStatusMemSnapshot();
+	publishBootWarmEventOncePerBoot();
+	if (memGovernorPolicy(g_memGovernor).pauseDiagnostics) {
+		memGovernorNote(g_memGovernor, MemGovernorDecision::PauseDiagnostics, millis());
+	} else {
+		publishStatusTasksSnapshot();
+#if RS485_AUX_BUS
+		publishStatusAuxBusSnapshot();
+#endif
+		publishStatusScratchSnapshot();
+		publishStatusSettingsSnapshot();
+#if ALLOC_PROFILER
+		publishStatusAllocSnapshot();
+#endif
+		StatusPowerSnapshotDiagLastSnapshot powerSnapshotDiagLastSnapshot{};
+		StatusPowerSnapshotDiagCountsSnapshot powerSnapshotDiagCountsSnapshot{};
+		populateStatusPowerSnapshotDiagLastSnapshot(powerSnapshotDiagLastSnapshot);
+		populateStatusPowerSnapshotDiagCountsSnapshot(powerSnapshotDiagCountsSnapshot);
+		publishStatusPowerSnapshotDiagLastSnapshot(powerSnapshotDiagLastSnapshot);
+		publishStatusPowerSnapshotDiagCountsSnapshot(powerSnapshotDiagCountsSnapshot);
+	}
 	clearRetainedPowerSnapshotBuildTopicOnce();
 
 #if RS485_STUB
@@ -12224,10 +14422,75 @@ sendStatus(bool includeEssSnapshot)
 #endif
 }
 
+// Writes the "device": {...} member shared by per-entity and device discovery payloads.
+static bool
+buildDiscoveryDeviceBlock(DiscoveryDeviceScope scope, const char *deviceId, char *out, size_t outSize)
+{
+	if (scope == DiscoveryDeviceScope::Inverter) {
+		char deviceDisplayName[48];
+		if (!buildInverterDeviceDisplayName(activeInverterSerial(),
+		                                    activeInverterLabel(),
+		                                    deviceDisplayName,
+		                                    sizeof(deviceDisplayName))) {
+			return false;
+		}
+		A2M_SNPRINTF(out, outSize,
+		         A2M_FMT("\"device\": {"
+		                 " \"name\": \"%s\", \"model\": \"%s\", \"manufacturer\": \"AlphaESS\","
+		                 " \"identifiers\": [\"%s\"], \"via_device\": \"%s\"}"),
+		         deviceDisplayName,
+		         (activeInverterSlot == 0 && deviceBatteryType[0] != '\0') ? deviceBatteryType : kInverterModelFallback,
+		         deviceId,
+		         controllerIdentifier);
+	} else {
+		A2M_SNPRINTF(out, outSize,
+		         A2M_FMT("\"device\": {"
+		                 " \"name\": \"%s\", \"model\": \"%s\", \"manufacturer\": \"AlphaESS\","
+		                 " \"identifiers\": [\"%s\"]}"),
+		         deviceName,
+		         kControllerModel,
+		         deviceId);
+	}
+	return true;
+}
+
+#if MQTT_STATE_BATCH
+// Points an eligible entity at its bucket document. Returns false (payload still ok) when the
+// entity keeps its own state topic.
+static bool
+emitStateBatchDiscoveryFields(CountedMqttPayload &payload,
+                              const mqttState *singleEntity,
+                              const char *deviceId,
+                              const char *entityKey)
+{
+	size_t idx = 0;
+	if (!lookupEntityIndex(singleEntity->entityId, &idx)) {
+		return false;
+	}
+	const BucketId bucketId = bucketIdFromFreq(mqttEntityEffectiveFreqByIndex(idx));
+	if (!stateBatchEntityEligible(singleEntity->entityId, singleEntity->retain, bucketId)) {
+		return false;
+	}
+	char batchTopic[128];
+	char valueTemplate[96];
+	if (!buildStateBatchTopic(deviceName, deviceId, bucketId, batchTopic, sizeof(batchTopic)) ||
+	    !buildStateBatchValueTemplate(entityKey, valueTemplate, sizeof(valueTemplate))) {
+		return false;
+	}
+	return appendCountedMqttText(payload, ", \"state_topic\": \"") &&
+	       appendCountedMqttText(payload, batchTopic) &&
+	       appendCountedMqttText(payload, "\", \"value_template\": \"") &&
+	       appendCountedMqttText(payload, valueTemplate) &&
+	       appendCountedMqttText(payload, "\"");
+}
+#endif // MQTT_STATE_BATCH
+
 struct EntityDiscoveryPayloadContext {
 	const mqttState *singleEntity = nullptr;
 	DiscoveryDeviceScope scope = DiscoveryDeviceScope::Inverter;
 	const char *topicBase = nullptr;
+	// Device-discovery component: the device block comes from the enclosing payload.
+	bool asComponent = false;
 };
 
 static bool
@@ -12237,11 +14500,12 @@ emitEntityDiscoveryPayload(CountedMqttPayload &payload, void *context)
 	const mqttState *singleEntity = ctx.singleEntity;
 	const DiscoveryDeviceScope scope = ctx.scope;
 	const char *topicBase = ctx.topicBase;
-	char stateAddition[256];
+	ScratchLease stateLease(g_textScratchPool, ScratchPhase::Discovery, 256);
+	char *stateAddition = stateLease.chars();
+	const size_t stateAdditionSize = stateLease.size();
 	char prettyName[64];
 	char metricId[64];
 	char uniqueId[128];
-	char deviceDisplayName[48];
 	char labelDisplay[16];
 	char labelId[16];
 	char defaultEntityId[96];
@@ -12249,8 +14513,7 @@ emitEntityDiscoveryPayload(CountedMqttPayload &payload, void *context)
 	const bool inverterScope = (scope == DiscoveryDeviceScope::Inverter);
 	char entityKey[64];
 	const char *entityType = "sensor";
-	stateAddition[0] = '\0';
-	if (singleEntity == nullptr || deviceId[0] == '\0' || topicBase == nullptr || topicBase[0] == '\0') {
+	if (!stateLease.ok() || singleEntity == nullptr || deviceId[0] == '\0' || topicBase == nullptr || topicBase[0] == '\0') {
 		payload.ok = false;
 		return false;
 	}
@@ -12258,12 +14521,12 @@ emitEntityDiscoveryPayload(CountedMqttPayload &payload, void *context)
 	buildEntityMetricId(singleEntity, metricId, sizeof(metricId));
 	buildEntityUniqueId(scope,
 	                    controllerIdentifier,
-	                    deviceSerialNumber,
+	                    activeInverterSerial(),
 	                    (inverterScope && metricId[0] != '\0') ? metricId : entityKey,
 	                    uniqueId,
 	                    sizeof(uniqueId));
 
-	A2M_SNPRINTF(stateAddition, sizeof(stateAddition), A2M_FMT("{"));
+	A2M_SNPRINTF(stateAddition, stateAdditionSize, A2M_FMT("{"));
 	if (!appendCountedMqttText(payload, stateAddition)) {
 		return false;
 	}
@@ -12271,19 +14534,19 @@ emitEntityDiscoveryPayload(CountedMqttPayload &payload, void *context)
 	switch (singleEntity->haClass) {
 	case homeAssistantClass::haClassBox:
 	case homeAssistantClass::haClassNumber:
-		A2M_SNPRINTF(stateAddition, sizeof(stateAddition), A2M_FMT("\"component\": \"number\""));
+		A2M_SNPRINTF(stateAddition, stateAdditionSize, A2M_FMT("\"component\": \"number\""));
 		entityType = "number";
 		break;
 	case homeAssistantClass::haClassSelect:
-		A2M_SNPRINTF(stateAddition, sizeof(stateAddition), A2M_FMT("\"component\": \"select\""));
+		A2M_SNPRINTF(stateAddition, stateAdditionSize, A2M_FMT("\"component\": \"select\""));
 		entityType = "select";
 		break;
 	case homeAssistantClass::haClassBinaryProblem:
-		A2M_SNPRINTF(stateAddition, sizeof(stateAddition), A2M_FMT("\"component\": \"binary_sensor\""));
+		A2M_SNPRINTF(stateAddition, stateAdditionSize, A2M_FMT("\"component\": \"binary_sensor\""));
 		entityType = "binary_sensor";
 		break;
 	default:
-		A2M_SNPRINTF(stateAddition, sizeof(stateAddition), A2M_FMT("\"component\": \"sensor\""));
+		A2M_SNPRINTF(stateAddition, stateAdditionSize, A2M_FMT("\"component\": \"sensor\""));
 		entityType = "sensor";
 		break;
 	}
@@ -12291,44 +14554,25 @@ emitEntityDiscoveryPayload(CountedMqttPayload &payload, void *context)
 		return false;
 	}
 
-	if (inverterScope) {
-		if (!buildInverterDeviceDisplayName(deviceSerialNumber,
-		                                    appConfig.inverterLabel.c_str(),
-		                                    deviceDisplayName,
-		                                    sizeof(deviceDisplayName))) {
+	if (!ctx.asComponent) {
+		if (!buildDiscoveryDeviceBlock(scope, deviceId, stateAddition, stateAdditionSize)) {
 			payload.ok = false;
 			return false;
 		}
-		A2M_SNPRINTF(stateAddition, sizeof(stateAddition),
-		         A2M_FMT(", \"device\": {"
-		                 " \"name\": \"%s\", \"model\": \"%s\", \"manufacturer\": \"AlphaESS\","
-		                 " \"identifiers\": [\"%s\"], \"via_device\": \"%s\"}"),
-		         deviceDisplayName,
-		         (deviceBatteryType[0] != '\0' ? deviceBatteryType : kInverterModelFallback),
-		         deviceId,
-		         controllerIdentifier);
-	} else {
-		A2M_SNPRINTF(stateAddition, sizeof(stateAddition),
-		         A2M_FMT(", \"device\": {"
-		                 " \"name\": \"%s\", \"model\": \"%s\", \"manufacturer\": \"AlphaESS\","
-		                 " \"identifiers\": [\"%s\"]}"),
-		         deviceName,
-		         kControllerModel,
-		         deviceId);
-	}
-	if (!appendCountedMqttText(payload, stateAddition)) {
-		return false;
+		if (!appendCountedMqttText(payload, ", ") || !appendCountedMqttText(payload, stateAddition)) {
+			return false;
+		}
 	}
 
 	buildEntityDisplayName(singleEntity, scope, prettyName, sizeof(prettyName));
-	A2M_SNPRINTF(stateAddition, sizeof(stateAddition), A2M_FMT(", \"name\": \"%s\""), prettyName);
+	A2M_SNPRINTF(stateAddition, stateAdditionSize, A2M_FMT(", \"name\": \"%s\""), prettyName);
 	if (!appendCountedMqttText(payload, stateAddition)) {
 		return false;
 	}
 
 	if (inverterScope) {
-		if (!buildInverterLabelDisplay(deviceSerialNumber,
-		                               appConfig.inverterLabel.c_str(),
+		if (!buildInverterLabelDisplay(activeInverterSerial(),
+		                               activeInverterLabel(),
 		                               labelDisplay,
 		                               sizeof(labelDisplay))) {
 			payload.ok = false;
@@ -12343,7 +14587,7 @@ emitEntityDiscoveryPayload(CountedMqttPayload &payload, void *context)
 		         entityType,
 		         labelId,
 		         (metricId[0] != '\0' ? metricId : entityKey));
-		A2M_SNPRINTF(stateAddition, sizeof(stateAddition),
+		A2M_SNPRINTF(stateAddition, stateAdditionSize,
 		         A2M_FMT(", \"default_entity_id\": \"%s\", \"has_entity_name\": true"),
 		         defaultEntityId);
 		if (!appendCountedMqttText(payload, stateAddition)) {
@@ -12351,14 +14595,14 @@ emitEntityDiscoveryPayload(CountedMqttPayload &payload, void *context)
 		}
 	}
 
-	A2M_SNPRINTF(stateAddition, sizeof(stateAddition), A2M_FMT(", \"unique_id\": \"%s\""), uniqueId);
+	A2M_SNPRINTF(stateAddition, stateAdditionSize, A2M_FMT(", \"unique_id\": \"%s\""), uniqueId);
 	if (!appendCountedMqttText(payload, stateAddition)) {
 		return false;
 	}
 
 	switch (singleEntity->haClass) {
 	case homeAssistantClass::haClassEnergy:
-		A2M_SNPRINTF(stateAddition, sizeof(stateAddition),
+		A2M_SNPRINTF(stateAddition, stateAdditionSize,
 			 A2M_FMT(", \"device_class\": \"energy\""
 			         ", \"state_class\": \"total_increasing\""
 			         ", \"unit_of_measurement\": \"kWh\""
@@ -12368,7 +14612,7 @@ emitEntityDiscoveryPayload(CountedMqttPayload &payload, void *context)
 			        ));
 		break;
 	case homeAssistantClass::haClassPower:
-		A2M_SNPRINTF(stateAddition, sizeof(stateAddition),
+		A2M_SNPRINTF(stateAddition, stateAdditionSize,
 			 A2M_FMT(", \"device_class\": \"power\""
 			         ", \"state_class\": \"measurement\""
 			         ", \"unit_of_measurement\": \"W\""
@@ -12378,7 +14622,7 @@ emitEntityDiscoveryPayload(CountedMqttPayload &payload, void *context)
 			        ));
 		break;
 	case homeAssistantClass::haClassFrequency:
-		A2M_SNPRINTF(stateAddition, sizeof(stateAddition),
+		A2M_SNPRINTF(stateAddition, stateAdditionSize,
 			 A2M_FMT(", \"device_class\": \"frequency\""
 			         ", \"state_class\": \"measurement\""
 			         ", \"unit_of_measurement\": \"Hz\""
@@ -12388,7 +14632,7 @@ emitEntityDiscoveryPayload(CountedMqttPayload &payload, void *context)
 			         ", \"entity_category\": \"diagnostic\""));
 		break;
 	case homeAssistantClass::haClassReactivePower:
-		A2M_SNPRINTF(stateAddition, sizeof(stateAddition),
+		A2M_SNPRINTF(stateAddition, stateAdditionSize,
 			 A2M_FMT(", \"state_class\": \"measurement\""
 			         ", \"unit_of_measurement\": \"var\""
 #ifdef MQTT_FORCE_UPDATE
@@ -12397,7 +14641,7 @@ emitEntityDiscoveryPayload(CountedMqttPayload &payload, void *context)
 			         ", \"entity_category\": \"diagnostic\""));
 		break;
 	case homeAssistantClass::haClassApparentPower:
-		A2M_SNPRINTF(stateAddition, sizeof(stateAddition),
+		A2M_SNPRINTF(stateAddition, stateAdditionSize,
 			 A2M_FMT(", \"state_class\": \"measurement\""
 			         ", \"unit_of_measurement\": \"VA\""
 #ifdef MQTT_FORCE_UPDATE
@@ -12406,7 +14650,7 @@ emitEntityDiscoveryPayload(CountedMqttPayload &payload, void *context)
 			         ", \"entity_category\": \"diagnostic\""));
 		break;
 	case homeAssistantClass::haClassPowerFactor:
-		A2M_SNPRINTF(stateAddition, sizeof(stateAddition),
+		A2M_SNPRINTF(stateAddition, stateAdditionSize,
 			 A2M_FMT(", \"state_class\": \"measurement\""
 #ifdef MQTT_FORCE_UPDATE
 			         ", \"force_update\": \"true\""
@@ -12414,14 +14658,14 @@ emitEntityDiscoveryPayload(CountedMqttPayload &payload, void *context)
 			         ", \"entity_category\": \"diagnostic\""));
 		break;
 	case homeAssistantClass::haClassBinaryProblem:
-		A2M_SNPRINTF(stateAddition, sizeof(stateAddition),
+		A2M_SNPRINTF(stateAddition, stateAdditionSize,
 			 A2M_FMT(", \"device_class\": \"problem\""
 			         ", \"payload_on\": \"Problem\""
 			         ", \"payload_off\": \"OK\""
 			         ", \"entity_category\": \"diagnostic\""));
 		break;
 	case homeAssistantClass::haClassBattery:
-		A2M_SNPRINTF(stateAddition, sizeof(stateAddition),
+		A2M_SNPRINTF(stateAddition, stateAdditionSize,
 			 A2M_FMT(", \"device_class\": \"battery\""
 			         ", \"state_class\": \"measurement\""
 			         ", \"unit_of_measurement\": \"%%\""
@@ -12431,7 +14675,7 @@ emitEntityDiscoveryPayload(CountedMqttPayload &payload, void *context)
 			        ));
 		break;
 	case homeAssistantClass::haClassVoltage:
-		A2M_SNPRINTF(stateAddition, sizeof(stateAddition),
+		A2M_SNPRINTF(stateAddition, stateAdditionSize,
 			 A2M_FMT(", \"device_class\": \"voltage\""
 			         ", \"state_class\": \"measurement\""
 			         ", \"unit_of_measurement\": \"V\""
@@ -12441,7 +14685,7 @@ emitEntityDiscoveryPayload(CountedMqttPayload &payload, void *context)
 			        ));
 		break;
 	case homeAssistantClass::haClassCurrent:
-		A2M_SNPRINTF(stateAddition, sizeof(stateAddition),
+		A2M_SNPRINTF(stateAddition, stateAdditionSize,
 			 A2M_FMT(", \"device_class\": \"current\""
 			         ", \"state_class\": \"measurement\""
 			         ", \"unit_of_measurement\": \"A\""
@@ -12451,7 +14695,7 @@ emitEntityDiscoveryPayload(CountedMqttPayload &payload, void *context)
 			        ));
 		break;
 	case homeAssistantClass::haClassTemp:
-		A2M_SNPRINTF(stateAddition, sizeof(stateAddition),
+		A2M_SNPRINTF(stateAddition, stateAdditionSize,
 			 A2M_FMT(", \"device_class\": \"temperature\""
 			         ", \"state_class\": \"measurement\""
 			         ", \"unit_of_measurement\": \"°C\""
@@ -12461,29 +14705,29 @@ emitEntityDiscoveryPayload(CountedMqttPayload &payload, void *context)
 			         ", \"entity_category\": \"diagnostic\""));
 		break;
 	case homeAssistantClass::haClassDuration:
-		A2M_SNPRINTF(stateAddition, sizeof(stateAddition),
+		A2M_SNPRINTF(stateAddition, stateAdditionSize,
 			 A2M_FMT(", \"device_class\": \"duration\""
 			         ", \"state_class\": \"measurement\""
 			         ", \"unit_of_measurement\": \"s\""
 			         ", \"entity_category\": \"diagnostic\""));
 		break;
 	case homeAssistantClass::haClassCounter:
-		A2M_SNPRINTF(stateAddition, sizeof(stateAddition),
+		A2M_SNPRINTF(stateAddition, stateAdditionSize,
 			 A2M_FMT(", \"state_class\": \"total_increasing\""
 			         ", \"unit_of_measurement\": \"errors\""
 			         ", \"entity_category\": \"diagnostic\""));
 		break;
 	case homeAssistantClass::haClassBox:
-		A2M_SNPRINTF(stateAddition, sizeof(stateAddition), A2M_FMT(", \"mode\": \"box\""));
+		A2M_SNPRINTF(stateAddition, stateAdditionSize, A2M_FMT(", \"mode\": \"box\""));
 		break;
 	case homeAssistantClass::haClassInfo:
-		A2M_SNPRINTF(stateAddition, sizeof(stateAddition), A2M_FMT(", \"entity_category\": \"diagnostic\""));
+		A2M_SNPRINTF(stateAddition, stateAdditionSize, A2M_FMT(", \"entity_category\": \"diagnostic\""));
 		break;
 	case homeAssistantClass::haClassSelect:
-		A2M_SNPRINTF(stateAddition, sizeof(stateAddition), A2M_FMT(", \"device_class\": \"enum\""));
+		A2M_SNPRINTF(stateAddition, stateAdditionSize, A2M_FMT(", \"device_class\": \"enum\""));
 		break;
 	case homeAssistantClass::haClassNumber:
-		A2M_SNPRINTF(stateAddition, sizeof(stateAddition),
+		A2M_SNPRINTF(stateAddition, stateAdditionSize,
 			 A2M_FMT(", \"entity_category\": \"diagnostic\""
 			         ", \"entity_type\": \"number\""));
 		break;
@@ -12498,64 +14742,64 @@ emitEntityDiscoveryPayload(CountedMqttPayload &payload, void *context)
 	stateAddition[0] = '\0';
 	switch (singleEntity->entityId) {
 	case mqttEntityId::entityRegNum:
-		A2M_SNPRINTF(stateAddition, sizeof(stateAddition),
+		A2M_SNPRINTF(stateAddition, stateAdditionSize,
 			 A2M_FMT(", \"entity_category\": \"diagnostic\""
 			         ", \"icon\": \"mdi:pound\""
 			         ", \"min\": -1, \"max\": 41000"));
 		break;
 	case mqttEntityId::entityRegValue:
-		A2M_SNPRINTF(stateAddition, sizeof(stateAddition), A2M_FMT(", \"icon\": \"mdi:folder-pound-outline\""));
+		A2M_SNPRINTF(stateAddition, stateAdditionSize, A2M_FMT(", \"icon\": \"mdi:folder-pound-outline\""));
 		break;
 	case mqttEntityId::entityGridReg:
-		A2M_SNPRINTF(stateAddition, sizeof(stateAddition), A2M_FMT(", \"icon\": \"mdi:security\""));
+		A2M_SNPRINTF(stateAddition, stateAdditionSize, A2M_FMT(", \"icon\": \"mdi:security\""));
 		break;
 	case mqttEntityId::entityInverterMode:
-		A2M_SNPRINTF(stateAddition, sizeof(stateAddition), A2M_FMT(", \"icon\": \"mdi:format-list-numbered\""));
+		A2M_SNPRINTF(stateAddition, stateAdditionSize, A2M_FMT(", \"icon\": \"mdi:format-list-numbered\""));
 		break;
 	case mqttEntityId::entityPvPwr:
-		A2M_SNPRINTF(stateAddition, sizeof(stateAddition), A2M_FMT(", \"icon\": \"mdi:solar-power\""));
+		A2M_SNPRINTF(stateAddition, stateAdditionSize, A2M_FMT(", \"icon\": \"mdi:solar-power\""));
 		break;
 	case mqttEntityId::entityPvEnergy:
-		A2M_SNPRINTF(stateAddition, sizeof(stateAddition), A2M_FMT(", \"icon\": \"mdi:solar-power-variant-outline\""));
+		A2M_SNPRINTF(stateAddition, stateAdditionSize, A2M_FMT(", \"icon\": \"mdi:solar-power-variant-outline\""));
 		break;
 	case mqttEntityId::entityFrequency:
-		A2M_SNPRINTF(stateAddition, sizeof(stateAddition),
+		A2M_SNPRINTF(stateAddition, stateAdditionSize,
 			 A2M_FMT(", \"icon\": \"mdi:sine-wave\""
 			         ", \"suggested_display_precision\": 2"));
 		break;
 	case mqttEntityId::entityGridPwr:
-		A2M_SNPRINTF(stateAddition, sizeof(stateAddition), A2M_FMT(", \"icon\": \"mdi:transmission-tower\""));
+		A2M_SNPRINTF(stateAddition, stateAdditionSize, A2M_FMT(", \"icon\": \"mdi:transmission-tower\""));
 		break;
 	case mqttEntityId::entityGridEnergyTo:
-		A2M_SNPRINTF(stateAddition, sizeof(stateAddition), A2M_FMT(", \"icon\": \"mdi:transmission-tower-export\""));
+		A2M_SNPRINTF(stateAddition, stateAdditionSize, A2M_FMT(", \"icon\": \"mdi:transmission-tower-export\""));
 		break;
 	case mqttEntityId::entityGridEnergyFrom:
-		A2M_SNPRINTF(stateAddition, sizeof(stateAddition), A2M_FMT(", \"icon\": \"mdi:transmission-tower-import\""));
+		A2M_SNPRINTF(stateAddition, stateAdditionSize, A2M_FMT(", \"icon\": \"mdi:transmission-tower-import\""));
 		break;
 	case mqttEntityId::entityBatPwr:
-		A2M_SNPRINTF(stateAddition, sizeof(stateAddition), A2M_FMT(", \"icon\": \"mdi:battery-charging-100\""));
+		A2M_SNPRINTF(stateAddition, stateAdditionSize, A2M_FMT(", \"icon\": \"mdi:battery-charging-100\""));
 		break;
 	case mqttEntityId::entityBatEnergyCharge:
-		A2M_SNPRINTF(stateAddition, sizeof(stateAddition), A2M_FMT(", \"icon\": \"mdi:battery-plus\""));
+		A2M_SNPRINTF(stateAddition, stateAdditionSize, A2M_FMT(", \"icon\": \"mdi:battery-plus\""));
 		break;
 	case mqttEntityId::entityBatEnergyDischarge:
-		A2M_SNPRINTF(stateAddition, sizeof(stateAddition), A2M_FMT(", \"icon\": \"mdi:battery-minus\""));
+		A2M_SNPRINTF(stateAddition, stateAdditionSize, A2M_FMT(", \"icon\": \"mdi:battery-minus\""));
 		break;
 	case mqttEntityId::entityBatCap:
-		A2M_SNPRINTF(stateAddition, sizeof(stateAddition),
+		A2M_SNPRINTF(stateAddition, stateAdditionSize,
 			 A2M_FMT(", \"device_class\": \"energy\""
 			         ", \"state_class\": \"total_increasing\""
 			         ", \"unit_of_measurement\": \"kWh\""
 			         ", \"icon\": \"mdi:home-battery\""));
 		break;
 	case mqttEntityId::entityOpMode:
-		A2M_SNPRINTF(stateAddition, sizeof(stateAddition),
+		A2M_SNPRINTF(stateAddition, stateAdditionSize,
 			 A2M_FMT(", \"options\": [ \"%s\", \"%s\", \"%s\", \"%s\", \"%s\", \"%s\", \"%s\" ]"),
 			 OP_MODE_DESC_NORMAL, OP_MODE_DESC_LOAD_FOLLOW, OP_MODE_DESC_TARGET, OP_MODE_DESC_PUSH,
 			 OP_MODE_DESC_PV_CHARGE, OP_MODE_DESC_MAX_CHARGE, OP_MODE_DESC_NO_CHARGE);
 		break;
 	case mqttEntityId::entityDispatchDuration:
-		A2M_SNPRINTF(stateAddition, sizeof(stateAddition),
+		A2M_SNPRINTF(stateAddition, stateAdditionSize,
 			 A2M_FMT(", \"device_class\": \"duration\""
 			         ", \"state_class\": \"measurement\""
 			         ", \"unit_of_measurement\": \"s\""
@@ -12564,17 +14808,17 @@ emitEntityDiscoveryPayload(CountedMqttPayload &payload, void *context)
 			 static_cast<unsigned long>(kDispatchDurationMaxSeconds));
 		break;
 	case mqttEntityId::entityDispatchRemaining:
-		A2M_SNPRINTF(stateAddition, sizeof(stateAddition),
+		A2M_SNPRINTF(stateAddition, stateAdditionSize,
 			 A2M_FMT(", \"device_class\": \"duration\""
 			         ", \"state_class\": \"measurement\""
 			         ", \"unit_of_measurement\": \"s\""
 			         ", \"icon\": \"mdi:timer-sand\""));
 		break;
 	case mqttEntityId::entityDispatchRequestStatus:
-		A2M_SNPRINTF(stateAddition, sizeof(stateAddition), A2M_FMT(", \"icon\": \"mdi:message-alert-outline\""));
+		A2M_SNPRINTF(stateAddition, stateAdditionSize, A2M_FMT(", \"icon\": \"mdi:message-alert-outline\""));
 		break;
 	case mqttEntityId::entitySocTarget:
-		A2M_SNPRINTF(stateAddition, sizeof(stateAddition),
+		A2M_SNPRINTF(stateAddition, stateAdditionSize,
 			 A2M_FMT(", \"device_class\": \"battery\""
 			         ", \"state_class\": \"measurement\""
 			         ", \"unit_of_measurement\": \"%%\""
@@ -12584,7 +14828,7 @@ emitEntityDiscoveryPayload(CountedMqttPayload &payload, void *context)
 		break;
 	case mqttEntityId::entityChargePwr:
 	case mqttEntityId::entityDischargePwr:
-		A2M_SNPRINTF(stateAddition, sizeof(stateAddition),
+		A2M_SNPRINTF(stateAddition, stateAdditionSize,
 			 A2M_FMT(", \"device_class\": \"power\""
 			         ", \"state_class\": \"measurement\""
 			         ", \"unit_of_measurement\": \"W\""
@@ -12593,7 +14837,7 @@ emitEntityDiscoveryPayload(CountedMqttPayload &payload, void *context)
 			 0, INVERTER_POWER_MAX);
 		break;
 	case mqttEntityId::entityPushPwr:
-		A2M_SNPRINTF(stateAddition, sizeof(stateAddition),
+		A2M_SNPRINTF(stateAddition, stateAdditionSize,
 			 A2M_FMT(", \"device_class\": \"power\""
 			         ", \"state_class\": \"measurement\""
 			         ", \"unit_of_measurement\": \"W\""
@@ -12602,7 +14846,7 @@ emitEntityDiscoveryPayload(CountedMqttPayload &payload, void *context)
 			 0, INVERTER_POWER_MAX);
 		break;
 	case mqttEntityId::entityMaxFeedinPercent:
-		A2M_SNPRINTF(stateAddition, sizeof(stateAddition),
+		A2M_SNPRINTF(stateAddition, stateAdditionSize,
 			 A2M_FMT(", \"unit_of_measurement\": \"%%\""
 			         ", \"icon\": \"mdi:transmission-tower-export\""
 			         ", \"min\": 0, \"max\": 100"));
@@ -12612,17 +14856,17 @@ emitEntityDiscoveryPayload(CountedMqttPayload &payload, void *context)
 	case mqttEntityId::entityBSSID:
 	case mqttEntityId::entityTxPower:
 	case mqttEntityId::entityWifiRecon:
-		A2M_SNPRINTF(stateAddition, sizeof(stateAddition), A2M_FMT(", \"icon\": \"mdi:wifi\""));
+		A2M_SNPRINTF(stateAddition, stateAdditionSize, A2M_FMT(", \"icon\": \"mdi:wifi\""));
 		break;
 #endif // A2M_DEBUG_WIFI
 	case mqttEntityId::entityA2MVersion:
 	case mqttEntityId::entityInverterVersion:
 	case mqttEntityId::entityEmsVersion:
-		A2M_SNPRINTF(stateAddition, sizeof(stateAddition), A2M_FMT(", \"icon\": \"mdi:numeric\""));
+		A2M_SNPRINTF(stateAddition, stateAdditionSize, A2M_FMT(", \"icon\": \"mdi:numeric\""));
 		break;
 	case mqttEntityId::entityInverterSn:
 	case mqttEntityId::entityEmsSn:
-		A2M_SNPRINTF(stateAddition, sizeof(stateAddition), A2M_FMT(", \"icon\": \"mdi:identifier\""));
+		A2M_SNPRINTF(stateAddition, stateAdditionSize, A2M_FMT(", \"icon\": \"mdi:identifier\""));
 		break;
 	case mqttEntityId::entityRs485Errors:
 	case mqttEntityId::entityRs485TransportErrors:
@@ -12632,7 +14876,7 @@ emitEntityDiscoveryPayload(CountedMqttPayload &payload, void *context)
 	case mqttEntityId::entityInverterFaults:
 	case mqttEntityId::entityInverterWarnings:
 	case mqttEntityId::entitySystemFaults:
-		A2M_SNPRINTF(stateAddition, sizeof(stateAddition), A2M_FMT(", \"icon\": \"mdi:alert-decagram-outline\""));
+		A2M_SNPRINTF(stateAddition, stateAdditionSize, A2M_FMT(", \"icon\": \"mdi:alert-decagram-outline\""));
 		break;
 	case mqttEntityId::entityPollingBudgetExceeded:
 	case mqttEntityId::entityPollingBudgetOverrunCount:
@@ -12666,11 +14910,11 @@ emitEntityDiscoveryPayload(CountedMqttPayload &payload, void *context)
 	case mqttEntityId::entityPollingBacklogCountUser:
 	case mqttEntityId::entityPollingBacklogOldestAgeMsUser:
 	case mqttEntityId::entityPollingLastFullCycleAgeMsUser:
-		A2M_SNPRINTF(stateAddition, sizeof(stateAddition), A2M_FMT(", \"icon\": \"mdi:clock-alert-outline\""));
+		A2M_SNPRINTF(stateAddition, stateAdditionSize, A2M_FMT(", \"icon\": \"mdi:clock-alert-outline\""));
 		break;
 #ifdef DEBUG_FREEMEM
 	case mqttEntityId::entityFreemem:
-		A2M_SNPRINTF(stateAddition, sizeof(stateAddition), A2M_FMT(", \"icon\": \"mdi:memory\""));
+		A2M_SNPRINTF(stateAddition, stateAdditionSize, A2M_FMT(", \"icon\": \"mdi:memory\""));
 		break;
 #endif // DEBUG_FREEMEM
 #ifdef DEBUG_CALLBACKS
@@ -12687,19 +14931,19 @@ emitEntityDiscoveryPayload(CountedMqttPayload &payload, void *context)
 	default:
 		switch (singleEntity->family) {
 		case MqttEntityFamily::Battery:
-			A2M_SNPRINTF(stateAddition, sizeof(stateAddition), A2M_FMT(", \"icon\": \"mdi:battery-outline\""));
+			A2M_SNPRINTF(stateAddition, stateAdditionSize, A2M_FMT(", \"icon\": \"mdi:battery-outline\""));
 			break;
 		case MqttEntityFamily::Pv:
-			A2M_SNPRINTF(stateAddition, sizeof(stateAddition), A2M_FMT(", \"icon\": \"mdi:solar-power\""));
+			A2M_SNPRINTF(stateAddition, stateAdditionSize, A2M_FMT(", \"icon\": \"mdi:solar-power\""));
 			break;
 		case MqttEntityFamily::Grid:
-			A2M_SNPRINTF(stateAddition, sizeof(stateAddition), A2M_FMT(", \"icon\": \"mdi:transmission-tower\""));
+			A2M_SNPRINTF(stateAddition, stateAdditionSize, A2M_FMT(", \"icon\": \"mdi:transmission-tower\""));
 			break;
 		case MqttEntityFamily::Backup:
-			A2M_SNPRINTF(stateAddition, sizeof(stateAddition), A2M_FMT(", \"icon\": \"mdi:power-plug-battery\""));
+			A2M_SNPRINTF(stateAddition, stateAdditionSize, A2M_FMT(", \"icon\": \"mdi:power-plug-battery\""));
 			break;
 		case MqttEntityFamily::Inverter:
-			A2M_SNPRINTF(stateAddition, sizeof(stateAddition), A2M_FMT(", \"icon\": \"mdi:flash\""));
+			A2M_SNPRINTF(stateAddition, stateAdditionSize, A2M_FMT(", \"icon\": \"mdi:flash\""));
 			break;
 		case MqttEntityFamily::System:
 		case MqttEntityFamily::Controller:
@@ -12716,13 +14960,13 @@ emitEntityDiscoveryPayload(CountedMqttPayload &payload, void *context)
 	if (singleEntity->subscribe) {
 #ifdef HA_IS_OP_MODE_AUTHORITY
 		if (singleEntity->retain) {
-			A2M_SNPRINTF(stateAddition, sizeof(stateAddition), A2M_FMT(", \"retain\": \"true\""));
+			A2M_SNPRINTF(stateAddition, stateAdditionSize, A2M_FMT(", \"retain\": \"true\""));
 			if (!appendCountedMqttText(payload, stateAddition)) {
 				return false;
 			}
 		}
 #endif // HA_IS_OP_MODE_AUTHORITY
-		A2M_SNPRINTF(stateAddition, sizeof(stateAddition), A2M_FMT(", \"qos\": %d"), MQTT_SUBSCRIBE_QOS);
+		A2M_SNPRINTF(stateAddition, stateAdditionSize, A2M_FMT(", \"qos\": %d"), MQTT_SUBSCRIBE_QOS);
 		if (!appendCountedMqttText(payload, stateAddition)) {
 			return false;
 		}
@@ -12734,7 +14978,7 @@ emitEntityDiscoveryPayload(CountedMqttPayload &payload, void *context)
 	case mqttEntityId::entityInverterFaults:
 	case mqttEntityId::entityInverterWarnings:
 	case mqttEntityId::entitySystemFaults:
-		A2M_SNPRINTF(stateAddition, sizeof(stateAddition),
+		A2M_SNPRINTF(stateAddition, stateAdditionSize,
 			A2M_FMT(", \"state_topic\": \"%s/state\""
 			        ", \"value_template\": \"{{ \\\"OK\\\" if value_json.numEvents == 0 else \\\"Problem\\\" }}\""
 			        ", \"json_attributes_topic\": \"%s/state\""),
@@ -12742,7 +14986,7 @@ emitEntityDiscoveryPayload(CountedMqttPayload &payload, void *context)
 			topicBase);
 		break;
 	case mqttEntityId::entityFrequency:
-		A2M_SNPRINTF(stateAddition, sizeof(stateAddition),
+		A2M_SNPRINTF(stateAddition, stateAdditionSize,
 			A2M_FMT(", \"state_topic\": \"%s/state\""
 			        ", \"value_template\": \"{{ value_json[\\\"Use Frequency\\\"] | default(\\\"\\\") }}\""
 			        ", \"json_attributes_topic\": \"%s/state\""),
@@ -12750,38 +14994,52 @@ emitEntityDiscoveryPayload(CountedMqttPayload &payload, void *context)
 			topicBase);
 		break;
 	case mqttEntityId::entityRs485Avail:
-		A2M_SNPRINTF(stateAddition, sizeof(stateAddition),
+		A2M_SNPRINTF(stateAddition, stateAdditionSize,
 			A2M_FMT(", \"state_topic\": \"%s\""
 			        ", \"value_template\": \"{{ value_json.rs485Status | default(\\\"\\\") }}\""
 			        ", \"json_attributes_topic\": \"%s\""),
 			statusTopic, statusTopic);
 		break;
 	case mqttEntityId::entityGridAvail:
-		A2M_SNPRINTF(stateAddition, sizeof(stateAddition),
+		A2M_SNPRINTF(stateAddition, stateAdditionSize,
 			A2M_FMT(", \"state_topic\": \"%s\""
 			        ", \"value_template\": \"{{ value_json.gridStatus | default(\\\"\\\") }}\""
 			        ", \"json_attributes_topic\": \"%s\""),
 			statusTopic, statusTopic);
 		break;
 	default:
-		A2M_SNPRINTF(stateAddition, sizeof(stateAddition),
-			A2M_FMT(", \"state_topic\": \"%s/state\""),
-			topicBase);
+#if MQTT_STATE_BATCH
+		// Secondary inverters publish per-entity states, never the bucket documents.
+		if (activeInverterSlot == 0 && emitStateBatchDiscoveryFields(payload, singleEntity, deviceId, entityKey)) {
+			stateAddition[0] = '\0';
+			break;
+		}
+		if (!payload.ok) {
+			return false;
+		}
+#endif
+		{
+			char stateTopic[kEntityTopicScratchSize];
+			buildEntityStateTopic(singleEntity, entityKey, topicBase, stateTopic, sizeof(stateTopic));
+			A2M_SNPRINTF(stateAddition, stateAdditionSize,
+				A2M_FMT(", \"state_topic\": \"%s\""),
+				stateTopic);
+		}
 		break;
 	}
-	if (!appendCountedMqttText(payload, stateAddition)) {
+	if (stateAddition[0] != '\0' && !appendCountedMqttText(payload, stateAddition)) {
 		return false;
 	}
 
 	if (singleEntity->subscribe) {
-		A2M_SNPRINTF(stateAddition, sizeof(stateAddition), A2M_FMT(", \"command_topic\": \"%s/command\""), topicBase);
+		A2M_SNPRINTF(stateAddition, stateAdditionSize, A2M_FMT(", \"command_topic\": \"%s/command\""), topicBase);
 		if (!appendCountedMqttText(payload, stateAddition)) {
 			return false;
 		}
 	}
 
 	if (singleEntity->entityId == entityGridAvail) {
-		A2M_SNPRINTF(stateAddition, sizeof(stateAddition),
+		A2M_SNPRINTF(stateAddition, stateAdditionSize,
 			A2M_FMT(", \"availability_template\": \"{{ \\\"online\\\" if value_json.a2mStatus == \\\"online\\\" and value_json.rs485Status == \\\"OK\\\" and value_json.gridStatus in ( \\\"OK\\\", \\\"Problem\\\" ) else \\\"offline\\\" }}\""
 			        ", \"availability_topic\": \"%s\""), statusTopic);
 	} else if (singleEntity->scope == MqttEntityScope::Controller ||
@@ -12789,15 +15047,15 @@ emitEntityDiscoveryPayload(CountedMqttPayload &payload, void *context)
 	           singleEntity->readKind == MqttEntityReadKind::Identity ||
 	           singleEntity->entityId == entityBatCap ||
 	           singleEntity->entityId == entityGridReg) {
-		A2M_SNPRINTF(stateAddition, sizeof(stateAddition),
+		A2M_SNPRINTF(stateAddition, stateAdditionSize,
 			A2M_FMT(", \"availability_template\": \"{{ value_json.a2mStatus | default(\\\"\\\") }}\""
 			        ", \"availability_topic\": \"%s\""), statusTopic);
 	} else if (singleEntity->family == MqttEntityFamily::Grid) {
-		A2M_SNPRINTF(stateAddition, sizeof(stateAddition),
+		A2M_SNPRINTF(stateAddition, stateAdditionSize,
 			A2M_FMT(", \"availability_template\": \"{{ \\\"online\\\" if value_json.a2mStatus == \\\"online\\\" and value_json.rs485Status == \\\"OK\\\" and value_json.gridStatus == \\\"OK\\\" else \\\"offline\\\" }}\""
 			        ", \"availability_topic\": \"%s\""), statusTopic);
 	} else {
-		A2M_SNPRINTF(stateAddition, sizeof(stateAddition),
+		A2M_SNPRINTF(stateAddition, stateAdditionSize,
 			A2M_FMT(", \"availability_template\": \"{{ \\\"online\\\" if value_json.a2mStatus == \\\"online\\\" and value_json.rs485Status == \\\"OK\\\" else \\\"offline\\\" }}\""
 			        ", \"availability_topic\": \"%s\""), statusTopic);
 	}
@@ -12808,6 +15066,160 @@ emitEntityDiscoveryPayload(CountedMqttPayload &payload, void *context)
 	return appendCountedMqttText(payload, "}");
 }
 
+#if HA_DEVICE_DISCOVERY
+static bool
+countedMqttCompactorSink(void *ctx, const char *data, size_t len)
+{
+	return appendCountedMqttBytes(*static_cast<CountedMqttPayload *>(ctx), data, len);
+}
+
+static bool
+emitHaDeviceComponents(CountedMqttPayload &payload, DiscoveryDeviceScope scope)
+{
+	MqttPublishTopicScratch *publishScratch = runtimePublishTopicScratch();
+	if (publishScratch == nullptr) {
+		payload.ok = false;
+		return false;
+	}
+	bool first = true;
+	if (scope == DiscoveryDeviceScope::Controller) {
+		bool asComponent = true;
+		if (!appendCountedMqttText(payload, "\"MQTT_Config\": ") ||
+		    !emitConfigDiscoveryPayload(payload, &asComponent) ||
+		    !appendCountedMqttText(payload, ", \"") ||
+		    !appendCountedMqttText(payload, kControllerInverterSerialEntity) ||
+		    !appendCountedMqttText(payload, "\": ") ||
+		    !emitControllerInverterSerialDiscoveryPayload(payload, &asComponent)) {
+			return false;
+		}
+		first = false;
+	}
+
+	const size_t entityCount = mqttEntitiesCount();
+	for (size_t idx = 0; idx < entityCount; ++idx) {
+		mqttState entity{};
+		if (!mqttEntityCopyByIndex(idx, &entity) || mqttEntityScope(entity.entityId) != scope ||
+		    !inverterSlotPollsEntity(entity)) {
+			continue;
+		}
+		char *const entityKey = publishScratch->entityKey;
+		mqttEntityNameCopy(&entity, entityKey, sizeof(publishScratch->entityKey));
+		if ((!first && !appendCountedMqttText(payload, ", ")) ||
+		    !appendCountedMqttText(payload, "\"") ||
+		    !appendCountedMqttText(payload, entityKey) ||
+		    !appendCountedMqttText(payload, "\": ")) {
+			return false;
+		}
+		first = false;
+
+		// Mirrors publishHaEntityDiscovery(): hidden/disabled entities become removals, which HA
+		// expresses as a component carrying only its platform.
+		const mqttUpdateFreq effectiveFreq = mqttEntityEffectiveFreqByIndex(idx);
+		const bool removed = !includeEntityInPublicSurfaces(entity) ||
+		                     effectiveFreq == mqttUpdateFreq::freqDisabled ||
+		                     !buildEntityTopicBase(deviceName,
+		                                           scope,
+		                                           controllerIdentifier,
+		                                           activeInverterSerial(),
+		                                           entityKey,
+		                                           publishScratch->topicBase,
+		                                           sizeof(publishScratch->topicBase));
+		if (removed) {
+			if (!appendCountedMqttText(payload, "{\"platform\": \"") ||
+			    !appendCountedMqttText(payload, homeAssistantEntityType(&entity)) ||
+			    !appendCountedMqttText(payload, "\"}")) {
+				return false;
+			}
+			continue;
+		}
+		EntityDiscoveryPayloadContext component{ &entity, scope, publishScratch->topicBase, true };
+		if (!emitEntityDiscoveryPayload(payload, &component)) {
+			return false;
+		}
+		maybeYield();
+	}
+	return true;
+}
+
+static bool
+emitHaDeviceDiscoveryPayload(CountedMqttPayload &payload, void *context)
+{
+	const DiscoveryDeviceScope scope = *static_cast<const DiscoveryDeviceScope *>(context);
+	char deviceBlock[256];
+	if (!buildDiscoveryDeviceBlock(scope, discoveryDeviceIdForScope(scope), deviceBlock, sizeof(deviceBlock))) {
+		payload.ok = false;
+		return false;
+	}
+	// Written with the long key names; the compactor abbreviates and strips whitespace on the way out.
+	HaJsonCompactor compactor;
+	haJsonCompactorBegin(compactor, countedMqttCompactorSink, &payload);
+	payload.compactor = &compactor;
+	const bool emitted = appendCountedMqttText(payload, "{") &&
+	                     appendCountedMqttText(payload, deviceBlock) &&
+	                     appendCountedMqttText(payload, ", \"origin\": {\"name\": \"Alpha2MQTT\"}") &&
+	                     appendCountedMqttText(payload, ", \"components\": {") &&
+	                     emitHaDeviceComponents(payload, scope) &&
+	                     appendCountedMqttText(payload, "}}");
+	payload.compactor = nullptr;
+	const bool finished = haJsonCompactorFinish(compactor);
+	if (!emitted || !finished) {
+		payload.ok = false;
+		return false;
+	}
+	return payload.ok;
+}
+
+static bool
+publishHaDeviceDiscovery(DiscoveryDeviceScope scope)
+{
+	char topic[128];
+	if (!buildHaDeviceDiscoveryTopic(discoveryDeviceIdForScope(scope), topic, sizeof(topic))) {
+		return false;
+	}
+	const size_t slot = (scope == DiscoveryDeviceScope::Controller) ? kDiscoveryFingerprintSlotControllerDevice
+	                                                                : kDiscoveryFingerprintSlotInverterDevice;
+	return publishDiscoveryPayload(slot, topic, MQTT_RETAIN, emitHaDeviceDiscoveryPayload, &scope);
+}
+
+// Queues a one-time clear of the per-entity topics left behind by earlier firmware.
+static void
+queueHaLegacyDiscoveryMigrationClears(void)
+{
+	if (!haLegacyDiscoveryMigrationLoaded) {
+		haLegacyDiscoveryMigrationLoaded = true;
+		Preferences preferences;
+		preferences.begin(DEVICE_NAME, true);
+		haLegacyDiscoveryMigrationPending = !preferences.getBool(kPreferenceHaDeviceDiscoveryMigrated, false);
+		preferences.end();
+	}
+	if (!haLegacyDiscoveryMigrationPending) {
+		return;
+	}
+	if (!haLegacyControllerClearQueued && controllerIdentifier[0] != '\0') {
+		queueStaleControllerDiscoveryClear(controllerIdentifier);
+		haLegacyControllerClearQueued = true;
+	}
+	const char *inverterId = discoveryDeviceIdForScope(DiscoveryDeviceScope::Inverter);
+	if (!haLegacyInverterClearQueued && inverterId[0] != '\0') {
+		queueStaleInverterDiscoveryClear(inverterId);
+		haLegacyInverterClearQueued = true;
+	}
+}
+
+static void
+noteHaDeviceDiscoveryPublished(void)
+{
+	if (!haLegacyDiscoveryMigrationPending || !haLegacyControllerClearQueued || !haLegacyInverterClearQueued) {
+		return;
+	}
+	Preferences preferences;
+	preferences.begin(DEVICE_NAME, false);
+	preferences.putBool(kPreferenceHaDeviceDiscoveryMigrated, true);
+	preferences.end();
+	haLegacyDiscoveryMigrationPending = false;
+}
+#endif // HA_DEVICE_DISCOVERY
+
 
 modbusRequestAndResponseStatusValues
 addToPayload(const char* addition)
@@ -12826,6 +15238,70 @@ addToPayload(const char* addition)
 	}
 }
 
+#if MQTT_COMPACT_TOPICS
+// Retained "<deviceName>/compact_topics": per device scope, the compact prefix and the
+// code -> entity key map for entities currently published on compact topics.
+static bool
+emitCompactTopicMapScope(CountedMqttPayload &payload, DiscoveryDeviceScope scope, const char *label, bool &firstScope)
+{
+	char prefix[kCompactTopicMaxLen];
+	if (!buildCompactTopicPrefix(deviceName, discoveryDeviceIdForScope(scope), prefix, sizeof(prefix))) {
+		return true;
+	}
+	if (!appendCountedMqttText(payload, firstScope ? "\"" : ",\"") ||
+	    !appendCountedMqttText(payload, label) ||
+	    !appendCountedMqttText(payload, "\":{\"prefix\":\"") ||
+	    !appendCountedMqttText(payload, prefix) ||
+	    !appendCountedMqttText(payload, "\",\"entities\":{")) {
+		return false;
+	}
+	firstScope = false;
+	bool first = true;
+	const size_t entityCount = mqttEntitiesCount();
+	for (size_t idx = 0; idx < entityCount; ++idx) {
+		mqttState entity{};
+		if (!mqttEntityCopyByIndex(idx, &entity) || mqttEntityScope(entity.entityId) != scope ||
+		    !compactTopicEntityEligible(entity.entityId, entity.subscribe) ||
+		    !includeEntityInPublicSurfaces(entity) ||
+		    mqttEntityEffectiveFreqByIndex(idx) == mqttUpdateFreq::freqDisabled) {
+			continue;
+		}
+		char entityKey[64];
+		char code[kCompactTopicEntityCodeLen + 1];
+		mqttEntityNameCopy(&entity, entityKey, sizeof(entityKey));
+		if (!compactTopicEntityCode(entityKey, code, sizeof(code))) {
+			continue;
+		}
+		if (!appendCountedMqttText(payload, first ? "\"" : ",\"") ||
+		    !appendCountedMqttText(payload, code) ||
+		    !appendCountedMqttText(payload, "\":\"") ||
+		    !appendCountedMqttText(payload, entityKey) ||
+		    !appendCountedMqttText(payload, "\"")) {
+			return false;
+		}
+		first = false;
+	}
+	return appendCountedMqttText(payload, "}}");
+}
+
+static bool
+emitCompactTopicMap(CountedMqttPayload &payload, void *)
+{
+	bool firstScope = true;
+	return appendCountedMqttText(payload, "{") &&
+	       emitCompactTopicMapScope(payload, DiscoveryDeviceScope::Controller, "controller", firstScope) &&
+	       emitCompactTopicMapScope(payload, DiscoveryDeviceScope::Inverter, "inverter", firstScope) &&
+	       appendCountedMqttText(payload, "}");
+}
+
+static bool
+publishCompactTopicMap(void)
+{
+	char topic[64];
+	return buildCompactTopicMapTopic(deviceName, topic, sizeof(topic)) &&
+	       publishCountedMqttPayload(topic, MQTT_RETAIN, emitCompactTopicMap, nullptr);
+}
+#endif // MQTT_COMPACT_TOPICS
 
 void
 sendHaData()
@@ -12835,6 +15311,9 @@ sendHaData()
 	}
 	const size_t numberOfEntities = mqttEntitiesCount();
 
+#if HA_DEVICE_DISCOVERY
+	queueHaLegacyDiscoveryMigrationClears();
+#endif
 	// Spread retained HA discovery publishes across multiple loop() turns so a config change
 	// cannot monopolize the ESP8266 network stack long enough to trigger the watchdog.
 	if (publishPendingStaleControllerDiscoveryClears()) {
@@ -12844,6 +15323,32 @@ sendHaData()
 		return;
 	}
 
+#if HA_DEVICE_DISCOVERY
+	(void)numberOfEntities;
+	// One streamed payload per device and loop() turn: controller first, then each inverter slot
+	// (primary first) once its identity is known. The cursor is 1 + the next slot.
+	if (resendHaNextEntityIndex == 0) {
+		if (!publishHaDeviceDiscovery(DiscoveryDeviceScope::Controller)) {
+			return;
+		}
+		resendHaNextEntityIndex = 1;
+		return;
+	}
+	if (resendHaNextEntityIndex <= inverterSlotCount()) {
+		{
+			InverterSlotScope slotScope(resendHaNextEntityIndex - 1);
+			if (discoveryDeviceIdForScope(DiscoveryDeviceScope::Inverter)[0] != '\0' &&
+			    !publishHaDeviceDiscovery(DiscoveryDeviceScope::Inverter)) {
+				return;
+			}
+		}
+		++resendHaNextEntityIndex;
+		if (resendHaNextEntityIndex <= inverterSlotCount()) {
+			return;
+		}
+	}
+	noteHaDeviceDiscoveryPublished();
+#else
 	if (resendHaPreludePending) {
 		if (!publishConfigDiscovery()) {
 			return;
@@ -12856,10 +15361,14 @@ sendHaData()
 		resendHaPreludePending = false;
 	}
 
+	// The primary inverter's entities come first, then each secondary slot's in turn: the cursor
+	// walks slot * numberOfEntities + entity index.
+	const size_t discoveryCount = numberOfEntities * inverterSlotCount();
 	size_t batchCount = 0;
-	while (resendHaNextEntityIndex < numberOfEntities && batchCount < kHaDiscoveryBatchSize) {
+	while (resendHaNextEntityIndex < discoveryCount && batchCount < kHaDiscoveryBatchSize) {
 		mqttState entity{};
-		if (!mqttEntityCopyByIndex(resendHaNextEntityIndex, &entity) ||
+		InverterSlotScope slotScope(resendHaNextEntityIndex / numberOfEntities);
+		if (!mqttEntityCopyByIndex(resendHaNextEntityIndex % numberOfEntities, &entity) ||
 		    !publishHaEntityDiscovery(&entity)) {
 			return;
 		}
@@ -12867,12 +15376,22 @@ sendHaData()
 		++batchCount;
 		maybeYield();
 	}
-	if (resendHaNextEntityIndex < numberOfEntities) {
+	if (resendHaNextEntityIndex < discoveryCount) {
+		return;
+	}
+#endif // HA_DEVICE_DISCOVERY
+#if MQTT_COMPACT_TOPICS
+	// Sent with every discovery pass so the map follows polling-config and identity changes.
+	if (!publishCompactTopicMap()) {
 		return;
 	}
+#endif
 	resendHaData = false;
 	resendHaPreludePending = false;
 	resendHaNextEntityIndex = 0;
+	resendHaSkipUnchanged = false;
+	persistDiscoveryFingerprints();
+	persistWarmStartRecord();
 }
 
 static void
@@ -13920,55 +16439,244 @@ static size_t *
 bucketCursorFor(BucketId bucket)
 {
 	const int ordinal = bucketOrdinal(bucket);
-	if (ordinal < 0 || ordinal >= static_cast<int>(sizeof(schedNextCursor) / sizeof(schedNextCursor[0]))) {
+	if (ordinal < 0 || ordinal >= static_cast<int>(sizeof(schedNextCursor[0]) / sizeof(schedNextCursor[0][0]))) {
 		return nullptr;
 	}
-	return &schedNextCursor[ordinal];
+	return &schedNextCursor[activeInverterSlot][ordinal];
+}
+
+static void
+resetBucketCursors(void)
+{
+	memset(schedNextCursor, 0, sizeof(schedNextCursor));
+	if (pendingBucketPass.active && _modBus != nullptr) {
+		_modBus->abandonDeferred();
+	}
+	pendingBucketPass = PendingBucketPass{};
+	inverterFleetClearDue(g_inverterFleet);
+#if RS485_AUX_BUS
+	busPlanFeedReset(g_auxPlanFeed);
+	multiBusClearQueue(g_auxBuses, kAuxBusLane);
+#endif
+}
+
+static void
+resetBucketBudgetStates(void)
+{
+	memset(schedBudgetState, 0, sizeof(schedBudgetState));
+}
+
+static void
+resetBootstrapPublishState(bool pending)
+{
+	bootstrapPublishPending = pending;
+	bootstrapPublishCursor = 0;
+	memset(bootstrapPublishedEntities, 0, sizeof(bootstrapPublishedEntities));
+}
+
+static bool
+bootstrapEntityWasPublished(size_t idx)
+{
+	if (idx >= kMqttEntityDescriptorCount) {
+		return true;
+	}
+	const size_t byteIdx = idx / 8U;
+	const uint8_t mask = static_cast<uint8_t>(1U << (idx % 8U));
+	return (bootstrapPublishedEntities[byteIdx] & mask) != 0;
+}
+
+static void
+markBootstrapEntityPublished(size_t idx)
+{
+	if (!bootstrapPublishPending || idx >= kMqttEntityDescriptorCount) {
+		return;
+	}
+	const size_t byteIdx = idx / 8U;
+	const uint8_t mask = static_cast<uint8_t>(1U << (idx % 8U));
+	bootstrapPublishedEntities[byteIdx] |= mask;
+}
+
+#if MQTT_STATE_BATCH
+#if MQTT_OUTBOUND_QUEUE
+// Queue slots hold one short entity value; a bucket document cannot be queued or rate shaped.
+#error "MQTT_STATE_BATCH and MQTT_OUTBOUND_QUEUE cannot be enabled together"
+#endif
+// Batched state mode: bucket passes collect eligible entity states into one JSON document per
+// bucket and device scope. Entities published outside a pass get a single-entry document on
+// the same topic so Home Assistant only ever needs the bucket topic.
+static StateBatch *g_stateBatch = nullptr;
+static bool g_stateBatchPassActive = false;
+static BucketId g_stateBatchBucket = BucketId::Unknown;
+static DiscoveryDeviceScope g_stateBatchScope = DiscoveryDeviceScope::Controller;
+
+static bool
+ensureStateBatch(void)
+{
+	if (g_stateBatch != nullptr) {
+		return true;
+	}
+	g_stateBatch = new (std::nothrow) StateBatch;
+	if (g_stateBatch == nullptr) {
+		return false;
+	}
+	stateBatchReset(*g_stateBatch);
+	return true;
+}
+
+static bool
+emitStateBatchPayload(CountedMqttPayload &payload, void *context)
+{
+	return appendCountedMqttText(payload, static_cast<const char *>(context));
+}
+
+static bool
+flushStateBatch(void)
+{
+	if (g_stateBatch == nullptr) {
+		return true;
+	}
+	const char *doc = stateBatchFinish(*g_stateBatch);
+	if (doc == nullptr) {
+		stateBatchReset(*g_stateBatch);
+		return true;
+	}
+	char topic[128];
+	bool published = false;
+	if (buildStateBatchTopic(deviceName,
+	                         discoveryDeviceIdForScope(g_stateBatchScope),
+	                         g_stateBatchBucket,
+	                         topic,
+	                         sizeof(topic))) {
+		published = publishCountedMqttPayload(topic, false, emitStateBatchPayload, const_cast<char *>(doc));
+	}
+	if (published) {
+		for (size_t n = 0; n < g_stateBatch->entries; ++n) {
+			markBootstrapEntityPublished(g_stateBatch->entityIndex[n]);
+		}
+	}
+	stateBatchReset(*g_stateBatch);
+	return published;
 }
 
 static void
-resetBucketCursors(void)
+beginStateBatchPass(BucketId bucketId)
 {
-	for (size_t i = 0; i < sizeof(schedNextCursor) / sizeof(schedNextCursor[0]); ++i) {
-		schedNextCursor[i] = 0;
-	}
+	flushStateBatch();
+	g_stateBatchPassActive = true;
+	g_stateBatchBucket = bucketId;
 }
 
 static void
-resetBucketBudgetStates(void)
+endStateBatchPass(void)
 {
-	memset(schedBudgetState, 0, sizeof(schedBudgetState));
+	flushStateBatch();
+	g_stateBatchPassActive = false;
 }
 
-static void
-resetBootstrapPublishState(bool pending)
+enum class StateBatchPublish : uint8_t {
+	Taken,
+	// Taken, but the document carrying it could not be published.
+	Failed,
+	// Not taken (no batch buffer, or the value can never fit); publish it on its own topic.
+	Rejected
+};
+
+static StateBatchPublish
+publishStateViaBatch(size_t idx, BucketId bucketId, DiscoveryDeviceScope scope, const char *entityKey, const char *value)
 {
-	bootstrapPublishPending = pending;
-	bootstrapPublishCursor = 0;
-	memset(bootstrapPublishedEntities, 0, sizeof(bootstrapPublishedEntities));
+	if (!ensureStateBatch()) {
+		return StateBatchPublish::Rejected;
+	}
+	if (bucketId != g_stateBatchBucket || scope != g_stateBatchScope) {
+		flushStateBatch();
+		g_stateBatchBucket = bucketId;
+		g_stateBatchScope = scope;
+	}
+	StateBatchAppend appended = stateBatchAppend(*g_stateBatch, entityKey, value, static_cast<uint16_t>(idx));
+	if (appended == StateBatchAppend::Full) {
+		flushStateBatch();
+		appended = stateBatchAppend(*g_stateBatch, entityKey, value, static_cast<uint16_t>(idx));
+	}
+	if (appended != StateBatchAppend::Added) {
+		return StateBatchPublish::Rejected;
+	}
+	if (!g_stateBatchPassActive && !flushStateBatch()) {
+		return StateBatchPublish::Failed;
+	}
+	return StateBatchPublish::Taken;
 }
+#endif // MQTT_STATE_BATCH
+
+#if TELEMETRY_HISTORY
+struct TelemetryHistoryReplayContext {
+	uint32_t nowMs;
+	CountedMqttPayload *payload;
+	bool first;
+	char scratch[128];
+};
 
 static bool
-bootstrapEntityWasPublished(size_t idx)
+emitTelemetryHistorySample(void *context, const TelemetryHistorySample &sample)
 {
-	if (idx >= kMqttEntityDescriptorCount) {
+	TelemetryHistoryReplayContext &replay = *static_cast<TelemetryHistoryReplayContext *>(context);
+	mqttState entity{};
+	char entityKey[64];
+	char value[24];
+	if (!mqttEntityCopyByIndex(sample.key, &entity)) {
+		// The catalog changed since the sample was taken; skip it.
 		return true;
 	}
-	const size_t byteIdx = idx / 8U;
-	const uint8_t mask = static_cast<uint8_t>(1U << (idx % 8U));
-	return (bootstrapPublishedEntities[byteIdx] & mask) != 0;
+	mqttEntityNameCopy(&entity, entityKey, sizeof(entityKey));
+	telemetryHistoryFormatValue(sample.milliValue, value, sizeof(value));
+	const bool appended = appendCountedMqttFmt(*replay.payload,
+	                                           replay.scratch,
+	                                           sizeof(replay.scratch),
+	                                           "%s[\"%s\",%ld,%s]",
+	                                           replay.first ? "" : ",",
+	                                           entityKey,
+	                                           -static_cast<long>(replay.nowMs - sample.timestampMs),
+	                                           value);
+	replay.first = false;
+	return appended;
+}
+
+// {"dev":"<inverter id>","now_ms":<uptime>,"s":[["<entity>",<age_ms (negative)>,<value>],...]}
+static bool
+emitTelemetryHistoryPayload(CountedMqttPayload &payload, void *context)
+{
+	TelemetryHistoryReplayContext &replay = *static_cast<TelemetryHistoryReplayContext *>(context);
+	replay.payload = &payload;
+	replay.first = true;
+	if (!appendCountedMqttFmt(payload,
+	                          replay.scratch,
+	                          sizeof(replay.scratch),
+	                          "{\"dev\":\"%s\",\"now_ms\":%lu,\"s\":[",
+	                          discoveryDeviceIdForScope(DiscoveryDeviceScope::Inverter),
+	                          static_cast<unsigned long>(replay.nowMs))) {
+		return false;
+	}
+	telemetryHistoryForEachOldest(*g_telemetryHistory, emitTelemetryHistorySample, &replay);
+	return payload.ok && appendCountedMqttText(payload, "]}");
 }
 
-static void
-markBootstrapEntityPublished(size_t idx)
+// Publishes the oldest buffered block as one message; returns true when a block was sent.
+static bool
+replayTelemetryHistoryBlock(void)
 {
-	if (!bootstrapPublishPending || idx >= kMqttEntityDescriptorCount) {
-		return;
+	if (g_telemetryHistory == nullptr || g_telemetryHistory->count == 0 || !_mqtt.connected()) {
+		return false;
 	}
-	const size_t byteIdx = idx / 8U;
-	const uint8_t mask = static_cast<uint8_t>(1U << (idx % 8U));
-	bootstrapPublishedEntities[byteIdx] |= mask;
+	char topic[64];
+	snprintf(topic, sizeof(topic), "%s/history", deviceName);
+	TelemetryHistoryReplayContext replay{};
+	replay.nowMs = millis();
+	if (!publishCountedMqttPayload(topic, false, emitTelemetryHistoryPayload, &replay)) {
+		return false;
+	}
+	telemetryHistoryPopOldest(*g_telemetryHistory, replay.nowMs, millis());
+	return true;
 }
+#endif // TELEMETRY_HISTORY
 
 static bool
 bootstrapPublishComplete(size_t entityCount)
@@ -14207,26 +16915,52 @@ executePvBlockTransaction(const MqttEntityActiveBucket &bucketPlan,
 	}
 }
 
-static void
+// A secondary inverter's reading: the plain register read, without the primary's per-entity
+// bookkeeping in readEntity().
+static modbusRequestAndResponseStatusValues
+readInverterSlotRegister(const mqttState &entity, modbusRequestAndResponse *rs)
+{
+	if (_registerHandler == nullptr) {
+		return modbusRequestAndResponseStatusValues::preProcessing;
+	}
+	const modbusRequestAndResponseStatusValues result = _registerHandler->readHandledRegister(entity.readKey, rs);
+	if (result != modbusRequestAndResponseStatusValues::readDataRegisterSuccess &&
+	    result != modbusRequestAndResponseStatusValues::readDataInvalidValue &&
+	    result != modbusRequestAndResponseStatusValues::responsePending) {
+		recordRs485Error(result);
+	}
+	return result;
+}
+
+// Returns true when the leader's read is still on the RS485 worker; the transaction is
+// re-run from the top on a later turn and picks the reply up then.
+static bool
 __attribute__((noinline))
 executeGenericPollTransaction(const MqttEntityActiveBucket &bucketPlan,
                               const MqttPollTransaction &transaction,
                               const mqttState &leader)
 {
 	if (shouldSkipScheduledEntityRead(mqttEntityScope(leader.entityId),
-	                                  inverterReady,
-	                                  inverterSerialKnown())) {
-		return;
+	                                  activeInverterReady(),
+	                                  inverterSerialIsValid(activeInverterSerial()))) {
+		return false;
 	}
 
 	modbusRequestAndResponse *response = runtimeModbusReadScratch();
 	if (response == nullptr) {
-		return;
+		return false;
 	}
 	*response = modbusRequestAndResponse{};
-	const modbusRequestAndResponseStatusValues result = readEntity(&leader, response);
+	if (_modBus != nullptr) {
+		_modBus->beginDeferredScope();
+	}
+	const modbusRequestAndResponseStatusValues result =
+		(activeInverterSlot == 0) ? readEntity(&leader, response) : readInverterSlotRegister(leader, response);
+	if (_modBus != nullptr && _modBus->endDeferredScope()) {
+		return true;
+	}
 	if (result != modbusRequestAndResponseStatusValues::readDataRegisterSuccess) {
-		return;
+		return false;
 	}
 
 	for (size_t member = 0; member < transaction.entityCount; ++member) {
@@ -14240,25 +16974,31 @@ executeGenericPollTransaction(const MqttEntityActiveBucket &bucketPlan,
 		}
 		sendDataFromMqttState(&entity, false, response);
 	}
+	return false;
 }
 
-static void
+// Returns true when the transaction is waiting on the RS485 worker and must be resumed.
+static bool
 executePollTransaction(const MqttEntityActiveBucket &bucketPlan,
                        const MqttPollTransaction &transaction,
                        bool snapshotOkThisBucket)
 {
 	(void)snapshotOkThisBucket;
 	if (transaction.entityCount == 0 || bucketPlan.members == nullptr) {
-		return;
+		return false;
 	}
 
 	const size_t leaderOffset = transaction.firstMemberOffset;
 	if (leaderOffset >= bucketPlan.count) {
-		return;
+		return false;
 	}
 
 	switch (transaction.kind) {
 	case MqttPollTransactionKind::SnapshotFanout:
+		// The ESS snapshot is read from the primary inverter only.
+		if (activeInverterSlot != 0) {
+			return false;
+		}
 		for (size_t member = 0; member < transaction.entityCount; ++member) {
 			const size_t offset = static_cast<size_t>(transaction.firstMemberOffset) + member;
 			if (offset >= bucketPlan.count) {
@@ -14270,7 +17010,7 @@ executePollTransaction(const MqttEntityActiveBucket &bucketPlan,
 			}
 			sendDataFromMqttState(&entity, false, nullptr);
 		}
-		return;
+		return false;
 	case MqttPollTransactionKind::RegisterFanout:
 	case MqttPollTransactionKind::SingleEntity:
 	default:
@@ -14279,23 +17019,24 @@ executePollTransaction(const MqttEntityActiveBucket &bucketPlan,
 
 	const size_t leaderIdx = bucketPlan.members[leaderOffset];
 	mqttState leader{};
-	if (!mqttEntityCopyByIndex(leaderIdx, &leader)) {
-		return;
+	if (!mqttEntityCopyByIndex(leaderIdx, &leader) || !inverterSlotPollsEntity(leader)) {
+		return false;
 	}
 	if (shouldSkipScheduledEntityRead(mqttEntityScope(leader.entityId),
-	                                  inverterReady,
-	                                  inverterSerialKnown())) {
-		return;
+	                                  activeInverterReady(),
+	                                  inverterSerialIsValid(activeInverterSerial()))) {
+		return false;
 	}
+	// Block snapshots decode several registers together and still wait for their reads.
 	if (leader.readKind == MqttEntityReadKind::Register && isDispatchBlockReadKey(leader.readKey)) {
 		executeDispatchBlockTransaction(bucketPlan, transaction);
-		return;
+		return false;
 	}
 	if (leader.readKind == MqttEntityReadKind::Register && isPvStringBlockReadKey(leader.readKey)) {
 		executePvBlockTransaction(bucketPlan, transaction);
-		return;
+		return false;
 	}
-	executeGenericPollTransaction(bucketPlan, transaction, leader);
+	return executeGenericPollTransaction(bucketPlan, transaction, leader);
 }
 
 static bool __attribute__((noinline))
@@ -14342,7 +17083,8 @@ runBucketTransactionsForPlan(BucketId bucketId,
                              bool snapshotOkThisBucket,
                              uint32_t pollIntervalSecondsLocal)
 {
-	BucketRuntimeBudgetState *budgetState = bucketBudgetStateFor(bucketId);
+	// Budget diagnostics describe the primary inverter's passes.
+	BucketRuntimeBudgetState *budgetState = (activeInverterSlot == 0) ? bucketBudgetStateFor(bucketId) : nullptr;
 	const uint32_t budgetMs = bucketBudgetMs(bucketId, pollIntervalSecondsLocal * 1000UL, kPollOverrunMs);
 	const uint32_t bucketStartMs = millis();
 
@@ -14357,11 +17099,21 @@ runBucketTransactionsForPlan(BucketId bucketId,
 		return false;
 	}
 	const size_t startCursor = normalizeDeferredCursor(*cursorPtr, bucketPlan.transactionCount);
+	// A resumed pass only finishes the transactions the parked pass had left.
+	const bool resuming = pendingBucketPass.active && pendingBucketPass.bucket == bucketId;
+	const size_t passCount = (resuming && pendingBucketPass.remaining < bucketPlan.transactionCount)
+		? pendingBucketPass.remaining
+		: bucketPlan.transactionCount;
+	pendingBucketPass = PendingBucketPass{};
 	size_t processed = 0;
 	bool truncated = false;
+	bool parked = false;
 	RuntimeDiagScope diagScope(RuntimeDiagPhase::BucketPublish, "entity");
+#if MQTT_STATE_BATCH
+	beginStateBatchPass(bucketId);
+#endif
 
-	while (processed < bucketPlan.transactionCount) {
+	while (processed < passCount) {
 		const size_t txnIndex = (startCursor + processed) % bucketPlan.transactionCount;
 #ifdef DEBUG_OVER_SERIAL
 		if (pollIntervalSecondsLocal <= 1) {
@@ -14382,7 +17134,10 @@ runBucketTransactionsForPlan(BucketId bucketId,
 			}
 		}
 #endif
-		executePollTransaction(bucketPlan, bucketPlan.transactions[txnIndex], snapshotOkThisBucket);
+		if (executePollTransaction(bucketPlan, bucketPlan.transactions[txnIndex], snapshotOkThisBucket)) {
+			parked = true;
+			break;
+		}
 #ifdef DEBUG_OVER_SERIAL
 		if (pollIntervalSecondsLocal <= 1) {
 			Serial.printf("bucket txn done: bucket=%s idx=%u free=%u max=%u frag=%u\r\n",
@@ -14394,11 +17149,24 @@ runBucketTransactionsForPlan(BucketId bucketId,
 		}
 #endif
 		processed++;
-		if (processed < bucketPlan.transactionCount && timedOut(bucketStartMs, millis(), budgetMs)) {
+		if (processed < passCount && timedOut(bucketStartMs, millis(), budgetMs)) {
 			truncated = true;
 			break;
 		}
 	}
+#if MQTT_STATE_BATCH
+	endStateBatchPass();
+#endif
+
+	if (parked) {
+		// Budget accounting waits for the pass to finish; the bus time is not ours to charge yet.
+		pendingBucketPass.active = true;
+		pendingBucketPass.bucket = bucketId;
+		pendingBucketPass.remaining = passCount - processed;
+		pendingBucketPass.snapshotOk = snapshotOkThisBucket;
+		*cursorPtr = (startCursor + processed) % bucketPlan.transactionCount;
+		return false;
+	}
 
 	const uint32_t bucketEndMs = millis();
 	if (budgetState != nullptr) {
@@ -14417,21 +17185,196 @@ runBucketTransactionsForPlan(BucketId bucketId,
 	return truncated;
 }
 
+static const MqttEntityActiveBucket *
+activePlanBucket(const MqttEntityActivePlan &plan, BucketId bucketId)
+{
+	switch (bucketId) {
+	case BucketId::TenSec:
+		return &plan.tenSec;
+	case BucketId::OneMin:
+		return &plan.oneMin;
+	case BucketId::FiveMin:
+		return &plan.fiveMin;
+	case BucketId::OneHour:
+		return &plan.oneHour;
+	case BucketId::OneDay:
+		return &plan.oneDay;
+	case BucketId::User:
+		return &plan.user;
+	default:
+		return nullptr;
+	}
+}
+
+/*
+ * resumePendingBucketPass
+ *
+ * Picks a parked bucket pass back up once the worker has answered, on the slot it parked for.
+ * Bucket timers are left alone: the pass already counted as this period's run when it started.
+ */
+static void
+resumePendingBucketPass(const MqttEntityActivePlan &plan)
+{
+	const MqttEntityActiveBucket *bucketPlan = activePlanBucket(plan, pendingBucketPass.bucket);
+	if (bucketPlan == nullptr) {
+		if (_modBus != nullptr) {
+			_modBus->abandonDeferred();
+		}
+		pendingBucketPass = PendingBucketPass{};
+		return;
+	}
+	runBucketTransactionsForPlan(pendingBucketPass.bucket, *bucketPlan, pendingBucketPass.snapshotOk, pollIntervalSeconds);
+}
+
+static uint8_t
+bucketDueBit(BucketId bucketId)
+{
+	const int ordinal = bucketOrdinal(bucketId);
+	return (ordinal < 0) ? 0 : static_cast<uint8_t>(1U << ordinal);
+}
+
+/*
+ * identifyInverterSlot
+ *
+ * Reads a secondary inverter's serial so it can be published under its own HA device. The new
+ * device's discovery goes out with the next discovery refresh.
+ */
+static bool
+identifyInverterSlot(size_t index)
+{
+	modbusRequestAndResponse *response = runtimeModbusReadScratch();
+	if (_registerHandler == nullptr || response == nullptr) {
+		return false;
+	}
+	*response = modbusRequestAndResponse{};
+	const modbusRequestAndResponseStatusValues result =
+		_registerHandler->readHandledRegister(REG_SYSTEM_INFO_R_EMS_SN_BYTE_1_2, response);
+	if (result != modbusRequestAndResponseStatusValues::readDataRegisterSuccess ||
+	    !inverterSerialIsValid(response->dataValueFormatted)) {
+		recordRs485Error(result);
+		return false;
+	}
+	inverterFleetSetSerial(g_inverterFleet, index, response->dataValueFormatted);
+	selectInverterSlot(index);
+	requestHaDataRefresh();
+#ifdef DEBUG_OVER_SERIAL
+	snprintf(_debugOutput, sizeof(_debugOutput), "Inverter slot %u identified: %s",
+	         static_cast<unsigned>(index), g_inverterFleet.slots[index].serial);
+	Serial.println(_debugOutput);
+#endif
+	return true;
+}
+
+/*
+ * runInverterSlotBuckets
+ *
+ * One inverter's poll turn: resumes its parked pass, or runs its owed buckets in order. The TenSec
+ * status publish and the ESS snapshot belong to the primary inverter. Returns the buckets the slot
+ * still owes; a pass that parks on the RS485 worker keeps the buckets after it for a later turn.
+ */
+static uint8_t
+runInverterSlotBuckets(void *, size_t index, uint8_t dueBuckets, bool *ok, bool *parked)
+{
+	const MqttEntityActivePlan *plan = mqttEntitiesRtAvailable() ? mqttActivePlan() : nullptr;
+	if (plan == nullptr) {
+		if (pendingBucketPass.active && _modBus != nullptr) {
+			_modBus->abandonDeferred();
+		}
+		pendingBucketPass = PendingBucketPass{};
+		return 0;
+	}
+	if (pendingBucketPass.active && _modBus != nullptr && _modBus->deferredReplyOutstanding()) {
+		*parked = true;
+		return dueBuckets;
+	}
+	InverterSlotScope slotScope(index);
+	const uint32_t rs485ErrorsBefore = rs485Errors;
+	uint8_t remaining = dueBuckets;
+	beginSchedulerPass();
+	if (pendingBucketPass.active) {
+		resumePendingBucketPass(*plan);
+	} else if (index != 0 && !inverterSerialIsValid(g_inverterFleet.slots[index].serial) &&
+	           !identifyInverterSlot(index)) {
+		// Nothing to publish under until the serial is known; this period's work is dropped.
+		remaining = 0;
+	} else {
+		// Bucket processing is runtime-driven: due buckets iterate their pre-built membership list.
+		// ESS snapshot is a bucket-scoped prerequisite and is refreshed once per scheduler pass
+		// (even if multiple buckets are due at the same time).
+		bool snapshotAttemptedThisPass = false;
+		bool snapshotOkThisPass = essSnapshotValid;
+		for (BucketId bucketId : kRuntimeBuckets) {
+			const uint8_t bit = bucketDueBit(bucketId);
+			const MqttEntityActiveBucket *bucketPlan = activePlanBucket(*plan, bucketId);
+			if ((remaining & bit) == 0 || bucketPlan == nullptr) {
+				continue;
+			}
+			remaining = static_cast<uint8_t>(remaining & ~bit);
+			const bool snapshotOkThisBucket =
+				(index == 0) && ensureSnapshotForBucketPass(bucketPlan->hasEssSnapshot,
+				                                            snapshotAttemptedThisPass,
+				                                            snapshotOkThisPass);
+			maybeYield();
+			if (index == 0 && bucketId == BucketId::TenSec) {
+#if RS485_STUB
+				if (rs485StubSkipNextScheduledStatusPublish) {
+					rs485StubSkipNextScheduledStatusPublish = false;
+				} else {
+					sendStatus(snapshotOkThisBucket);
+				}
+#else
+				sendStatus(snapshotOkThisBucket);
+#endif
+			}
+			runBucketTransactionsForPlan(bucketId, *bucketPlan, snapshotOkThisBucket, pollIntervalSeconds);
+			if (pendingBucketPass.active) {
+				break;
+			}
+		}
+	}
+	endSchedulerPass();
+	*parked = pendingBucketPass.active;
+	*ok = (rs485Errors == rs485ErrorsBefore);
+	return remaining;
+}
+
+static uint32_t
+inverterFleetMillis(void *)
+{
+	return millis();
+}
+
+// Gives the next inverter that owes buckets its poll turn; with nothing owed, slow-bucket
+// bootstrap publishes use the idle turn instead.
+static void
+pollNextInverterSlot(void)
+{
+	InverterFleetPollHooks hooks{};
+	hooks.runSlot = runInverterSlotBuckets;
+	hooks.nowMs = inverterFleetMillis;
+	if (inverterFleetPollTurn(g_inverterFleet, hooks) < 0) {
+		serviceBootstrapPublishPass();
+	}
+}
+
+// Bucket timers live at file scope so sendDataMsUntilDue() can report the next deadline.
+static unsigned long lastRunTenSeconds = 0;
+static unsigned long lastRunOneMinute = 0;
+static unsigned long lastRunFiveMinutes = 0;
+static unsigned long lastRunOneHour = 0;
+static unsigned long lastRunOneDay = 0;
+static unsigned long lastRunUser = 0;
+
 /*
  * sendData
  *
  * Runs once every loop, checks to see if time periods have elapsed to allow the schedules to run.
- * Each time, the appropriate arrays are iterated, processed and added to the payload.
+ * Due buckets are owed to every inverter on the bus; each call gives one inverter its poll turn,
+ * picked by inverterFleetPollTurn() so a slow unit cannot starve the others.
  */
 void
 sendData()
 {
-	static unsigned long lastRunTenSeconds = 0;
-	static unsigned long lastRunOneMinute = 0;
-	static unsigned long lastRunFiveMinutes = 0;
-	static unsigned long lastRunOneHour = 0;
-	static unsigned long lastRunOneDay = 0;
-	static unsigned long lastRunUser = 0;
 	static bool pendingImmediateStatusPass = false;
 
 	if (resendAllData) {
@@ -14476,7 +17419,7 @@ sendData()
 	const bool anyDue = (dueTenSeconds || dueOneMinute || dueFiveMinutes || dueOneHour || dueOneDay || dueUser);
 
 	if (!anyDue) {
-		serviceBootstrapPublishPass();
+		pollNextInverterSlot();
 		return;
 	}
 
@@ -14523,83 +17466,58 @@ sendData()
 		return;
 	}
 
-	const MqttEntityActivePlan *plan = mqttActivePlan();
-	if (plan == nullptr) {
-		return;
-	}
-
-	beginSchedulerPass();
-
-	// Bucket processing is runtime-driven: due buckets iterate their pre-built membership list.
-	// ESS snapshot is a bucket-scoped prerequisite and is refreshed once per scheduler pass
-	// (even if multiple buckets are due at the same time).
-	bool snapshotAttemptedThisPass = false;
-	bool snapshotOkThisPass = essSnapshotValid;
-
+	const uint8_t dueBuckets = static_cast<uint8_t>((dueTenSeconds ? bucketDueBit(BucketId::TenSec) : 0) |
+	                                                (dueOneMinute ? bucketDueBit(BucketId::OneMin) : 0) |
+	                                                (dueFiveMinutes ? bucketDueBit(BucketId::FiveMin) : 0) |
+	                                                (dueOneHour ? bucketDueBit(BucketId::OneHour) : 0) |
+	                                                (dueOneDay ? bucketDueBit(BucketId::OneDay) : 0) |
+	                                                (dueUser ? bucketDueBit(BucketId::User) : 0));
+	inverterFleetMarkDue(g_inverterFleet, dueBuckets);
+#if RS485_AUX_BUS
+	// The aux bus runs its share of the same buckets on its own wire, alongside the primary bus.
 	if (dueTenSeconds) {
-		const bool snapshotOkThisBucket =
-			ensureSnapshotForBucketPass(plan->tenSec.hasEssSnapshot,
-			                            snapshotAttemptedThisPass,
-			                            snapshotOkThisPass);
-		maybeYield();
-#if RS485_STUB
-		if (rs485StubSkipNextScheduledStatusPublish) {
-			rs485StubSkipNextScheduledStatusPublish = false;
-		} else {
-			sendStatus(snapshotOkThisBucket);
-		}
-#else
-		sendStatus(snapshotOkThisBucket);
-#endif
-		runBucketTransactionsForPlan(BucketId::TenSec, plan->tenSec, snapshotOkThisBucket, pollIntervalSeconds);
+		multiBusBeginCycle(g_auxBuses);
 	}
-
-	if (dueOneMinute) {
-		const bool snapshotOkThisBucket =
-			ensureSnapshotForBucketPass(plan->oneMin.hasEssSnapshot,
-			                            snapshotAttemptedThisPass,
-			                            snapshotOkThisPass);
-		maybeYield();
-		runBucketTransactionsForPlan(BucketId::OneMin, plan->oneMin, snapshotOkThisBucket, pollIntervalSeconds);
+	if (const MqttEntityActivePlan *plan = mqttActivePlan()) {
+		busPlanFeedMarkDue(g_auxPlanFeed, *plan, dueBuckets);
 	}
+#endif
+	pollNextInverterSlot();
+}
 
-	if (dueFiveMinutes) {
-		const bool snapshotOkThisBucket =
-			ensureSnapshotForBucketPass(plan->fiveMin.hasEssSnapshot,
-			                            snapshotAttemptedThisPass,
-			                            snapshotOkThisPass);
-		maybeYield();
-		runBucketTransactionsForPlan(BucketId::FiveMin, plan->fiveMin, snapshotOkThisBucket, pollIntervalSeconds);
+/*
+ * sendDataMsUntilDue
+ *
+ * Milliseconds until sendData() has a bucket due, mirroring its checkTimer() calls.
+ * Pending resend/bootstrap work and inverters still owed a poll turn are reported as due now,
+ * and a parked pass as soon as its RS485 reply is in.
+ */
+static uint32_t
+sendDataMsUntilDue(uint32_t nowMs)
+{
+	if (resendAllData || bootstrapPublishPending) {
+		return 0;
 	}
-
-	if (dueOneHour) {
-		const bool snapshotOkThisBucket =
-			ensureSnapshotForBucketPass(plan->oneHour.hasEssSnapshot,
-			                            snapshotAttemptedThisPass,
-			                            snapshotOkThisPass);
-		maybeYield();
-		runBucketTransactionsForPlan(BucketId::OneHour, plan->oneHour, snapshotOkThisBucket, pollIntervalSeconds);
+	if (pendingBucketPass.active) {
+		return (_modBus != nullptr && _modBus->deferredReplyOutstanding()) ? kRs485ReplyPollMs : 0;
 	}
-
-	if (dueOneDay) {
-		const bool snapshotOkThisBucket =
-			ensureSnapshotForBucketPass(plan->oneDay.hasEssSnapshot,
-			                            snapshotAttemptedThisPass,
-			                            snapshotOkThisPass);
-		maybeYield();
-		runBucketTransactionsForPlan(BucketId::OneDay, plan->oneDay, snapshotOkThisBucket, pollIntervalSeconds);
+	if (inverterFleetHasWork(g_inverterFleet)) {
+		return 0;
 	}
-
-	if (dueUser) {
-		const bool snapshotOkThisBucket =
-			ensureSnapshotForBucketPass(plan->user.hasEssSnapshot,
-			                            snapshotAttemptedThisPass,
-			                            snapshotOkThisPass);
-		maybeYield();
-		runBucketTransactionsForPlan(BucketId::User, plan->user, snapshotOkThisBucket, pollIntervalSeconds);
+	uint32_t earliest = msUntilDue(nowMs, lastRunTenSeconds, STATUS_INTERVAL_TEN_SECONDS);
+	const uint32_t candidates[] = {
+		msUntilDue(nowMs, lastRunOneMinute, STATUS_INTERVAL_ONE_MINUTE),
+		msUntilDue(nowMs, lastRunFiveMinutes, STATUS_INTERVAL_FIVE_MINUTE),
+		msUntilDue(nowMs, lastRunOneHour, STATUS_INTERVAL_ONE_HOUR),
+		msUntilDue(nowMs, lastRunOneDay, STATUS_INTERVAL_ONE_DAY),
+		msUntilDue(nowMs, lastRunUser, pollIntervalSeconds * 1000UL),
+	};
+	for (uint32_t candidate : candidates) {
+		if (candidate < earliest) {
+			earliest = candidate;
+		}
 	}
-
-	endSchedulerPass();
+	return earliest;
 }
 
 bool
@@ -14618,6 +17536,7 @@ sendDataFromMqttState(const mqttState *singleEntity,
 	modbusRequestAndResponseStatusValues result;
 	modbusRequestAndResponseStatusValues resultAddedToPayload;
 	DiscoveryDeviceScope scope = DiscoveryDeviceScope::Controller;
+	const EntityTopicPrefix *topicPrefix = nullptr;
 	const char *deviceId = "";
 
 	if (singleEntity == NULL)
@@ -14625,8 +17544,15 @@ sendDataFromMqttState(const mqttState *singleEntity,
 	if (!includeEntityInPublicSurfaces(*singleEntity) && !doHomeAssistant) {
 		return !forcePublish;
 	}
+	// A secondary inverter publishes straight to its own topics: the batch documents, outbound
+	// queue, history ring and metric log are keyed by entity index and belong to the primary.
+	const bool primarySlot = (activeInverterSlot == 0);
+	if (!inverterSlotPollsEntity(*singleEntity)) {
+		return !forcePublish;
+	}
 	scope = mqttEntityScope(singleEntity->entityId);
-	deviceId = discoveryDeviceIdForScope(scope);
+	topicPrefix = entityTopicPrefixForScope(scope);
+	deviceId = scope == DiscoveryDeviceScope::Controller ? controllerIdentifier : topicPrefix->deviceId;
 	if (!mqttEntitiesRtAvailable()) {
 		return !forcePublish;
 	}
@@ -14640,27 +17566,33 @@ sendDataFromMqttState(const mqttState *singleEntity,
 	     effectiveFreq == mqttUpdateFreq::freqDisabled)) {
 		return true;
 	}
-	if (deviceId[0] == '\0') {
-		return !forcePublish;
+	if (!doHomeAssistant && !forcePublish && memGovernorPolicy(g_memGovernor).shedLowPriority &&
+	    mqttOutboundClassFor(singleEntity->entityId, singleEntity->readKind, singleEntity->scope) ==
+	        MqttOutboundClass::Diagnostics) {
+		memGovernorNote(g_memGovernor, MemGovernorDecision::ShedPublish, millis());
+		return true;
 	}
-	mqttEntityNameCopy(singleEntity, entityKey, sizeof(publishScratch->entityKey));
-	if (!buildEntityTopicBase(deviceName,
-	                          scope,
-	                          controllerIdentifier,
-	                          deviceSerialNumber,
-	                          entityKey,
-	                          topicBase,
-	                          sizeof(publishScratch->topicBase))) {
+	if (deviceId[0] == '\0') {
 		return !forcePublish;
 	}
 	if (!doHomeAssistant && !snapshotPublishAllowedForEntityIndex(idx)) {
 		snapshotPublishSkipCount++;
 		return !forcePublish;
 	}
+	mqttEntityNameCopy(singleEntity, entityKey, sizeof(publishScratch->entityKey));
 
 	emptyPayload();
 
 	if (doHomeAssistant) {
+		if (!buildEntityTopicBase(deviceName,
+		                          scope,
+		                          controllerIdentifier,
+		                          activeInverterSerial(),
+		                          entityKey,
+		                          topicBase,
+		                          sizeof(publishScratch->topicBase))) {
+			return !forcePublish;
+		}
 		const char *entityType;
 		switch (singleEntity->haClass) {
 		case homeAssistantClass::haClassBox:
@@ -14680,7 +17612,11 @@ sendDataFromMqttState(const mqttState *singleEntity,
 
 		snprintf(topic, sizeof(publishScratch->topic), "homeassistant/%s/%s/%s/config", entityType, deviceId, entityKey);
 		EntityDiscoveryPayloadContext discoveryPayload{ singleEntity, scope, topicBase };
-		return publishCountedMqttPayload(topic, singleEntity->retain ? MQTT_RETAIN : false, emitEntityDiscoveryPayload, &discoveryPayload);
+		return publishDiscoveryPayload(idx,
+		                               topic,
+		                               singleEntity->retain ? MQTT_RETAIN : false,
+		                               emitEntityDiscoveryPayload,
+		                               &discoveryPayload);
 	} else {
 		bool skip = false;
 		if (!opData.a2mReadyToUseOpMode && (singleEntity->entityId == mqttEntityId::entityOpMode)) {
@@ -14699,7 +17635,9 @@ sendDataFromMqttState(const mqttState *singleEntity,
 			skip = true;
 		}
 		if (!skip) {
-			snprintf(topic, sizeof(publishScratch->topic), "%s/state", topicBase);
+			if (!composeEntityStateTopic(singleEntity, entityKey, *topicPrefix, topic, sizeof(publishScratch->topic))) {
+				return !forcePublish;
+			}
 				if (preparedResponse != nullptr) {
 					result = modbusRequestAndResponseStatusValues::readDataRegisterSuccess;
 					resultAddedToPayload = addToPayload(preparedResponse->dataValueFormatted);
@@ -14713,9 +17651,52 @@ sendDataFromMqttState(const mqttState *singleEntity,
 
 	if ((resultAddedToPayload != modbusRequestAndResponseStatusValues::payloadExceededCapacity) &&
 	    (result == modbusRequestAndResponseStatusValues::readDataRegisterSuccess)) {
+		if (!doHomeAssistant && primarySlot && scope == DiscoveryDeviceScope::Inverter &&
+		    g_warmStartStats.firstPublishMs == 0 && _mqtt.connected()) {
+			g_warmStartStats.firstPublishMs = millis();
+		}
+#if METRIC_LOG
+		if (!doHomeAssistant && primarySlot) {
+			noteMetricLogSample(singleEntity->entityId, _mqttPayload);
+		}
+#endif
+		EntityStateRouteInput route{};
+		route.primaryState = !doHomeAssistant && primarySlot;
+		route.mqttConnected = _mqtt.connected();
+#if TELEMETRY_HISTORY
+		route.historyEnabled = true;
+		route.historyEligible =
+			telemetryHistoryEntityEligible(singleEntity->haClass, singleEntity->scope, singleEntity->subscribe);
+		if (entityStateRoute(route) == EntityStateRoute::History) {
+			if (recordTelemetryHistorySample(idx, singleEntity, _mqttPayload)) {
+				emptyPayload();
+				return true;
+			}
+			route.historyEligible = false;
+		}
+#endif
+#if MQTT_STATE_BATCH
+		const BucketId bucketId = bucketIdFromFreq(effectiveFreq);
+		route.batchEnabled = true;
+		route.batchEligible = stateBatchEntityEligible(singleEntity->entityId, singleEntity->retain, bucketId);
+		if (entityStateRoute(route) == EntityStateRoute::Batch) {
+			const StateBatchPublish batched = publishStateViaBatch(idx, bucketId, scope, entityKey, _mqttPayload);
+			if (batched != StateBatchPublish::Rejected) {
+				return batched == StateBatchPublish::Taken || !forcePublish;
+			}
+			route.batchEligible = false;
+		}
+#endif
+#if MQTT_OUTBOUND_QUEUE
+		route.queueEnabled = true;
+		if (entityStateRoute(route) == EntityStateRoute::Queue && queueEntityState(idx, singleEntity, _mqttPayload)) {
+			emptyPayload();
+			return true;
+		}
+#endif
 			// And send
 			const bool published = sendMqtt(topic, singleEntity->retain ? MQTT_RETAIN : false);
-			if (published && !doHomeAssistant) {
+			if (published && !doHomeAssistant && primarySlot) {
 				markBootstrapEntityPublished(idx);
 			}
 		return published;
@@ -14762,7 +17743,7 @@ publishManualRegisterValueState(const mqttState *valueEntity,
 	if (resultAddedToPayload == modbusRequestAndResponseStatusValues::payloadExceededCapacity) {
 		return false;
 	}
-	snprintf(topic, sizeof(publishScratch->topic), "%s/state", topicBase);
+	buildEntityStateTopic(valueEntity, entityKey, topicBase, topic, sizeof(publishScratch->topic));
 	sendMqtt(topic, valueEntity->retain ? MQTT_RETAIN : false);
 	return true;
 }
@@ -14770,7 +17751,8 @@ publishManualRegisterValueState(const mqttState *valueEntity,
 static void
 publishManualRegisterReadStatus(int32_t requestedReg, const modbusRequestAndResponse &response)
 {
-	if (!ensureStatusJsonScratch()) {
+	ScratchLease json(g_textScratchPool, ScratchPhase::StatusJson, kStatusJsonScratchSize);
+	if (!json.ok()) {
 		return;
 	}
 	char manualReadTopic[160];
@@ -14785,8 +17767,8 @@ publishManualRegisterReadStatus(int32_t requestedReg, const modbusRequestAndResp
 #endif
 	snapshot.value = response.dataValueFormatted;
 	snprintf(manualReadTopic, sizeof(manualReadTopic), "%s/manual_read", statusTopic);
-	if (buildStatusManualReadJson(snapshot, g_statusJsonScratch, kStatusJsonScratchSize)) {
-		if (_mqtt.publish(manualReadTopic, g_statusJsonScratch, true)) {
+	if (buildStatusManualReadJson(snapshot, json.chars(), json.size())) {
+		if (_mqtt.publish(manualReadTopic, json.chars(), true)) {
 			noteMqttActivityPulse();
 		}
 		maybeYield();
@@ -14799,7 +17781,8 @@ publishRawRegisterReadStatus(int32_t requestedReg,
                              const modbusRequestAndResponse &response,
                              const char *statusOverride = nullptr)
 {
-	if (!ensureStatusJsonScratch()) {
+	ScratchLease json(g_textScratchPool, ScratchPhase::StatusJson, kStatusJsonScratchSize);
+	if (!json.ok()) {
 		return;
 	}
 	char rawReadTopic[160];
@@ -14820,8 +17803,8 @@ publishRawRegisterReadStatus(int32_t requestedReg,
 		snapshot.slaveErrorCode = static_cast<uint16_t>(response.data[0]);
 	}
 	snprintf(rawReadTopic, sizeof(rawReadTopic), "%s/raw_read", statusTopic);
-	if (buildStatusRawReadJson(snapshot, g_statusJsonScratch, kStatusJsonScratchSize)) {
-		if (_mqtt.publish(rawReadTopic, g_statusJsonScratch, true)) {
+	if (buildStatusRawReadJson(snapshot, json.chars(), json.size())) {
+		if (_mqtt.publish(rawReadTopic, json.chars(), true)) {
 			noteMqttActivityPulse();
 		}
 		maybeYield();
@@ -14937,7 +17920,7 @@ publishRegisterNumberStateValue(int32_t requestedReg)
 	if (addToPayload(valueBuf) == modbusRequestAndResponseStatusValues::payloadExceededCapacity) {
 		return false;
 	}
-	snprintf(topic, sizeof(publishScratch->topic), "%s/state", topicBase);
+	buildEntityStateTopic(&regEntity, entityKey, topicBase, topic, sizeof(publishScratch->topic));
 	return sendMqtt(topic, regEntity.retain ? MQTT_RETAIN : false);
 }
 
@@ -15753,7 +18736,8 @@ void mqttCallback(char* topic, byte* message, unsigned int length)
 	receivedCallbacks++;
 #endif // DEBUG_CALLBACKS
 
-	if (topicEqualsDeviceSuffix(topic, "/config/set")) {
+	const DeviceTopicRoute route = routeDeviceTopic(topic, deviceName);
+	if (route == DeviceTopicRoute::ConfigSet) {
 		// Defer config/set out of callback context without pinning a 2 KB global scratch
 		// in NORMAL mode. Queue an exact-size copy and let loop() parse/free it later.
 		if (!queuePendingPollingConfigPayload(reinterpret_cast<const char *>(message), length)) {
@@ -15770,7 +18754,7 @@ void mqttCallback(char* topic, byte* message, unsigned int length)
 		return;
 	}
 
-	if (topicEqualsDeviceSuffix(topic, "/debug/raw_read/set")) {
+	if (route == DeviceTopicRoute::RawReadSet) {
 		if (!ensureDeferredControlPayload() ||
 		    !copyLengthDelimitedString(reinterpret_cast<const char *>(message),
 		                              length,
@@ -15790,7 +18774,7 @@ void mqttCallback(char* topic, byte* message, unsigned int length)
 	}
 
 #if RS485_STUB
-	if (topicEqualsDeviceSuffix(topic, "/debug/rs485_stub/set")) {
+	if (route == DeviceTopicRoute::Rs485StubSet) {
 		Rs485StubControlRequest *request = ensureRs485StubControlRequestScratch();
 		if (request == nullptr ||
 		    !ensureDeferredControlPayload() ||
@@ -15862,8 +18846,6 @@ void mqttCallback(char* topic, byte* message, unsigned int length)
 #endif
 		}
 		return; // No further processing needed.
-	} else if (topicEqualsDeviceSuffix(topic, "/config/set")) {
-		return; // handled above
 	} else {
 		mqttState mqttEntity{};
 		bool haveMqttEntity = false;
@@ -16031,6 +19013,7 @@ noteMqttActivityPulse(void)
 {
 	const uint32_t nowMs = millis();
 	mqttActivityPulseUntilMs = nowMs + kMqttActivityPulseMs;
+	coopSchedulerWake(g_loopTasks, g_loopTaskStatusLed);
 }
 
 static bool
@@ -16175,7 +19158,7 @@ completeSuccessfulMqttReconnect(unsigned long attemptStart, int tries, bool inve
 	setStatusLedColor(0, 255, 0);
 	updateRunstate();
 	handleMqttReconnectDispatchReset();
-	requestHaDataResend();
+	requestHaDataRefresh();
 	pendingPollingConfigPublish = true;
 }
 
@@ -16480,10 +19463,11 @@ publishDispatchRequestStatus(void)
 		A2M_DEBUG_LINE("dq:stat:topic-fail");
 		return false;
 	}
-	snprintf(publishScratch->topic,
-	         sizeof(publishScratch->topic),
-	         "%s/state",
-	         publishScratch->topicBase);
+	buildEntityStateTopic(&entity,
+	                      publishScratch->entityKey,
+	                      publishScratch->topicBase,
+	                      publishScratch->topic,
+	                      sizeof(publishScratch->topic));
 	emptyPayload();
 	if (addToPayload((g_dispatchRequestStatus != nullptr) ? g_dispatchRequestStatus : "") ==
 	    modbusRequestAndResponseStatusValues::payloadExceededCapacity) {
@@ -16937,6 +19921,28 @@ computeDispatchCommand(uint16_t &essDispatchMode,
 	return true;
 }
 
+/*
+ * dispatchMsUntilDueNow
+ *
+ * Milliseconds until dispatchService() would evaluate or publish a countdown; uses the same
+ * cadence inputs so the idle sleep never overshoots a dispatch deadline.
+ */
+static uint32_t
+dispatchMsUntilDueNow(uint32_t nowMs)
+{
+	const bool timedEnabled = dispatchDurationIsTimed(timedDispatchState.configuredDurationSeconds);
+	const bool rs485Live = (rs485ConnectState == Rs485ConnectState::Connected) && inverterReady;
+	const bool fastEvalCadence =
+		dispatchUseFastEvalCadence(timedDispatchState, timedEnabled, rs485Live);
+	const uint32_t evalIntervalMs = fastEvalCadence ? kDispatchHandshakeIntervalMs :
+	                                                  (pollIntervalSeconds * 1000UL);
+	return dispatchMsUntilDue(timedDispatchState.lastEvalMs,
+	                          evalIntervalMs,
+	                          timedEnabled && (timedDispatchState.activeGeneration != 0),
+	                          timedDispatchState.lastCountdownPublishMs,
+	                          nowMs);
+}
+
 static void
 dispatchService(void)
 {
@@ -0,0 +1,132 @@
+#include <doctest/doctest.h>
+
+#include <memory>
+#include <string>
+
+#include "AllocProfiler.h"
+#include "EntityTopicCache.h"
+#include "MqttEntities.h"
+#include "MqttOutboundQueue.h"
+
+namespace {
+
+enum : uint8_t {
+	kPhaseNone = 0,
+	kPhasePoll = 1,
+	kPhaseStatus = 3,
+};
+
+const char *const kPhaseNames[] = { "", "poll_snapshot", "bucket_publish", "status_publish" };
+
+bool
+countingSink(void *ctx, uint16_t, const char *, bool)
+{
+	++*static_cast<size_t *>(ctx);
+	return true;
+}
+
+} // namespace
+
+TEST_CASE("alloc profiler: new and delete are attributed to the current phase")
+{
+	allocProfilerReset();
+	AllocWindow window;
+	{
+		AllocPhaseScope poll(kPhasePoll);
+		std::unique_ptr<char[]> a(new char[100]);
+		{
+			AllocPhaseScope status(kPhaseStatus);
+			std::unique_ptr<int> b(new int(7));
+			CHECK(allocProfilerPhase() == kPhaseStatus);
+		}
+		CHECK(allocProfilerPhase() == kPhasePoll);
+		std::unique_ptr<char[]> c(new char[50]);
+	}
+	CHECK(allocProfilerPhase() == kPhaseNone);
+	CHECK(window.allocs() == 3);
+	CHECK(window.frees() == 3);
+	CHECK(window.allocBytes() == 150 + sizeof(int));
+
+	const AllocProfile &profile = allocProfile();
+	CHECK(profile.phases[kPhasePoll].allocs == 2);
+	CHECK(profile.phases[kPhasePoll].allocBytes == 150);
+	CHECK(profile.phases[kPhasePoll].frees == 2);
+	// Growth is measured between phase changes: the nested scope restarts the count, so the
+	// 100-byte block sets the peak rather than 100 + 50.
+	CHECK(profile.phases[kPhasePoll].peakBytes == 100);
+	CHECK(profile.phases[kPhaseStatus].allocs == 1);
+	CHECK(profile.phases[kPhaseStatus].frees == 1);
+	CHECK(profile.phases[kPhaseStatus].peakBytes == sizeof(int));
+	// The int is gone before the 50-byte block arrives.
+	CHECK(profile.peakLiveBytes == 150);
+
+	char json[256];
+	REQUIRE(buildAllocProfileJson(profile, kPhaseNames, 4, json, sizeof(json)));
+	const std::string text(json);
+	CHECK(text.find("\"poll_snapshot\":{\"allocs\":2,\"frees\":2,\"bytes\":150,\"peak\":100}") != std::string::npos);
+	CHECK(text.find("\"status_publish\":{\"allocs\":1") != std::string::npos);
+	CHECK(text.find("bucket_publish") == std::string::npos);
+	CHECK_FALSE(buildAllocProfileJson(profile, kPhaseNames, 4, json, 24));
+}
+
+TEST_CASE("alloc profiler: nothing is counted while disabled")
+{
+	allocProfilerReset();
+	REQUIRE_FALSE(allocProfilerEnabled());
+	std::unique_ptr<char[]> block(new char[64]);
+	block.reset();
+	CHECK(allocProfile().phases[kPhaseNone].allocs == 0);
+	CHECK(allocProfile().phases[kPhaseNone].frees == 0);
+}
+
+// Covers the host-buildable pieces the publish path is made of (plan walk, catalog copy, cached topic
+// prefixes, outbound queue). sendData() itself lives in the firmware and is not run here.
+TEST_CASE("alloc profiler: plan walk, topic composition and queued sends stay allocation-free once warm")
+{
+	initMqttEntitiesRtIfNeeded(true);
+	REQUIRE(mqttActivePlan() != nullptr);
+	EntityTopicCache cache{};
+	entityTopicCacheInit(cache);
+	std::unique_ptr<MqttOutboundQueue> queue(new MqttOutboundQueue);
+	mqttOutboundInit(*queue, 1000, 1000, 0);
+	char topic[160];
+	size_t sent = 0;
+
+	// One warm-up pass builds the topic prefixes; the second pass is the steady state.
+	for (int pass = 0; pass < 2; ++pass) {
+		AllocPhaseScope poll(kPhasePoll);
+		AllocWindow window;
+		const MqttEntityActivePlan *plan = mqttActivePlan();
+		REQUIRE(plan != nullptr);
+		const MqttEntityActiveBucket *buckets[] = { &plan->tenSec, &plan->oneMin, &plan->fiveMin };
+		size_t published = 0;
+		for (const MqttEntityActiveBucket *bucket : buckets) {
+			for (size_t t = 0; t < bucket->transactionCount; ++t) {
+				const MqttPollTransaction &txn = bucket->transactions[t];
+				for (size_t m = 0; m < txn.entityCount; ++m) {
+					const uint16_t idx = bucket->members[txn.firstMemberOffset + m];
+					mqttState entity{};
+					REQUIRE(mqttEntityCopyByIndex(idx, &entity));
+					const EntityTopicPrefix *prefix = entityTopicCachePrefix(cache,
+					                                                        mqttEntityScope(entity.entityId),
+					                                                        "Alpha2MQTT",
+					                                                        "alpha2mqtt_ctrl_A1B2C3",
+					                                                        "AL2002321010043",
+					                                                        true);
+					REQUIRE(entityTopicCompose(*prefix, &entity, "/state", topic, sizeof(topic)) > 0);
+					mqttOutboundEnqueue(*queue,
+					                    idx,
+					                    mqttOutboundClassFor(entity.entityId, entity.readKind, entity.scope),
+					                    "123.4",
+					                    entity.retain);
+					mqttOutboundDrain(*queue, 1000U * static_cast<uint32_t>(pass + 1), 4, countingSink, &sent);
+					++published;
+				}
+			}
+		}
+		REQUIRE(published > 0);
+		CHECK(window.allocs() == 0);
+		CHECK(window.frees() == 0);
+	}
+	CHECK(sent > 0);
+}
@@ -0,0 +1,119 @@
+// Purpose: Validate that the extra-bus plan feed walks due buckets in cadence order within its lookahead.
+#include "doctest/doctest.h"
+
+#include "BusPlanFeed.h"
+
+namespace {
+
+class IdleBus : public BusTransport {
+public:
+	bool beginTxn(const BusTxn &, uint32_t) override { return true; }
+	BusTxnState pollTxn(uint32_t) override { return BusTxnState::Ok; }
+};
+
+MqttPollTransaction
+txn(uint16_t readKey, MqttPollTransactionKind kind = MqttPollTransactionKind::SingleEntity)
+{
+	return MqttPollTransaction{ 0, 1, readKey, kind };
+}
+
+bool
+skipSnapshots(const MqttEntityActiveBucket &, const MqttPollTransaction &t, void *)
+{
+	return t.kind != MqttPollTransactionKind::SnapshotFanout;
+}
+
+BusTxn
+takeQueued(MultiBusPoller &poller, size_t bus)
+{
+	BusLane &lane = poller.lanes[bus];
+	const BusTxn item = lane.queue[lane.head];
+	lane.head = static_cast<uint8_t>((lane.head + 1) % kBusQueueDepth);
+	lane.count--;
+	return item;
+}
+
+} // namespace
+
+TEST_CASE("bus plan feed: faster buckets are fed first and each due bucket owes one pass")
+{
+	MqttPollTransaction tenSec[2] = { txn(10), txn(11) };
+	MqttPollTransaction fiveMin[3] = { txn(50), txn(51), txn(52) };
+	MqttEntityActivePlan plan{};
+	plan.tenSec.transactions = tenSec;
+	plan.tenSec.transactionCount = 2;
+	plan.fiveMin.transactions = fiveMin;
+	plan.fiveMin.transactionCount = 3;
+
+	IdleBus transport;
+	MultiBusPoller poller;
+	REQUIRE(multiBusAttach(poller, 1, &transport, 0));
+	BusPlanFeed feed;
+	CHECK(busPlanFeedIdle(feed));
+	// Bits past the last bucket ordinal are ignored.
+	busPlanFeedMarkDue(feed, plan, static_cast<uint8_t>((1U << 2) | (1U << 0) | (1U << 7)));
+	CHECK_FALSE(busPlanFeedIdle(feed));
+
+	CHECK(busPlanFeedFill(feed, plan, poller, 1, 0x56, nullptr, nullptr) == kBusPlanFeedLookahead);
+	CHECK(busPlanFeedFill(feed, plan, poller, 1, 0x56, nullptr, nullptr) == 0u);
+	const BusTxn first = takeQueued(poller, 1);
+	CHECK(first.bucket == 0u);
+	CHECK(first.planIndex == 0u);
+	CHECK(first.readKey == 10u);
+	CHECK(first.slaveId == 0x56);
+	CHECK(first.kind == BusTxnKind::Poll);
+	CHECK(takeQueued(poller, 1).readKey == 11u);
+	CHECK(takeQueued(poller, 1).readKey == 50u);
+	const BusTxn fourth = takeQueued(poller, 1);
+	CHECK(fourth.bucket == 2u);
+	CHECK(fourth.planIndex == 1u);
+
+	CHECK(busPlanFeedFill(feed, plan, poller, 1, 0x56, nullptr, nullptr) == 1u);
+	CHECK(takeQueued(poller, 1).readKey == 52u);
+	CHECK(busPlanFeedIdle(feed));
+
+	// A new pass of a half-finished bucket continues from its cursor.
+	busPlanFeedMarkDue(feed, plan, 1U << 0);
+	feed.remaining[0] = 1;
+	CHECK(busPlanFeedFill(feed, plan, poller, 1, 0x56, nullptr, nullptr) == 1u);
+	CHECK(takeQueued(poller, 1).readKey == 10u);
+	busPlanFeedMarkDue(feed, plan, 1U << 0);
+	CHECK(busPlanFeedFill(feed, plan, poller, 1, 0x56, nullptr, nullptr) == 2u);
+	CHECK(takeQueued(poller, 1).readKey == 11u);
+	CHECK(takeQueued(poller, 1).readKey == 10u);
+}
+
+TEST_CASE("bus plan feed: filtered, shrunk and rejected work is handled")
+{
+	MqttPollTransaction tenSec[3] = { txn(1, MqttPollTransactionKind::SnapshotFanout), txn(2), txn(3) };
+	MqttEntityActivePlan plan{};
+	plan.tenSec.transactions = tenSec;
+	plan.tenSec.transactionCount = 3;
+
+	IdleBus transport;
+	MultiBusPoller poller;
+	BusPlanFeed feed;
+	busPlanFeedMarkDue(feed, plan, 1U << 0);
+	// No bus attached (or its link is down): nothing is consumed.
+	CHECK(busPlanFeedFill(feed, plan, poller, 0, 0x55, skipSnapshots, nullptr) == 0u);
+	CHECK(feed.remaining[0] == 3u);
+
+	REQUIRE(multiBusAttach(poller, 0, &transport, 0));
+	CHECK(busPlanFeedFill(feed, plan, poller, 0, 0x55, skipSnapshots, nullptr) == 2u);
+	CHECK(takeQueued(poller, 0).readKey == 2u);
+	CHECK(takeQueued(poller, 0).readKey == 3u);
+	CHECK(busPlanFeedIdle(feed));
+
+	// The plan was rebuilt smaller while a pass was owed.
+	busPlanFeedMarkDue(feed, plan, 1U << 0);
+	feed.cursor[0] = 2;
+	plan.tenSec.transactionCount = 2;
+	CHECK(busPlanFeedFill(feed, plan, poller, 0, 0x55, nullptr, nullptr) == 2u);
+	CHECK(takeQueued(poller, 0).readKey == 1u);
+	CHECK(takeQueued(poller, 0).readKey == 2u);
+
+	busPlanFeedMarkDue(feed, plan, 1U << 0);
+	busPlanFeedReset(feed);
+	CHECK(busPlanFeedIdle(feed));
+	CHECK(busPlanFeedBucket(plan, 6) == nullptr);
+}
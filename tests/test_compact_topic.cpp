@@ -0,0 +1,86 @@
+#include <doctest/doctest.h>
+
+#include <cstring>
+#include <set>
+#include <string>
+
+#include "CompactTopic.h"
+#include "DiscoveryModel.h"
+#include "MqttEntities.h"
+#include "StateBatch.h"
+
+TEST_CASE("compact topic: codes are short, stable and independent of catalog position")
+{
+	char code[8];
+	REQUIRE(compactTopicEntityCode("Grid_Power", code, sizeof(code)));
+	CHECK(std::strlen(code) == kCompactTopicEntityCodeLen);
+	// Pinned: changing the hash would silently move every compact state topic.
+	CHECK(std::string(code) == "0ed7");
+	CHECK_FALSE(compactTopicEntityCode("", code, sizeof(code)));
+	CHECK_FALSE(compactTopicEntityCode("Grid_Power", code, kCompactTopicEntityCodeLen));
+
+	char topic[kCompactTopicMaxLen];
+	REQUIRE(buildCompactStateTopic("Alpha2MQTT", "alpha2mqtt_inv_AL2002321010043", "Grid_Power", topic, sizeof(topic)));
+	CHECK(std::strlen(topic) == kCompactTopicMaxLen - 1);
+	CHECK(std::strncmp(topic, "a2/", 3) == 0);
+	CHECK(std::string(topic).substr(10) == "0ed7");
+
+	char other[kCompactTopicMaxLen];
+	REQUIRE(buildCompactStateTopic("Alpha2MQTT", "alpha2mqtt_inv_AL2002321010044", "Grid_Power", other, sizeof(other)));
+	CHECK(std::string(topic) != std::string(other));
+	CHECK_FALSE(buildCompactStateTopic("Alpha2MQTT", "", "Grid_Power", other, sizeof(other)));
+	CHECK_FALSE(buildCompactStateTopic("Alpha2MQTT", "x", "Grid_Power", other, sizeof(other) - 1));
+
+	char mapTopic[64];
+	REQUIRE(buildCompactTopicMapTopic("Alpha2MQTT", mapTopic, sizeof(mapTopic)));
+	CHECK(std::string(mapTopic) == "Alpha2MQTT/compact_topics");
+}
+
+TEST_CASE("compact topic: every catalog entity gets a distinct code")
+{
+	std::set<std::string> codes;
+	const size_t count = mqttEntitiesCount();
+	for (size_t idx = 0; idx < count; ++idx) {
+		mqttState entity{};
+		REQUIRE(mqttEntityCopyByIndex(idx, &entity));
+		char key[64];
+		mqttEntityNameCopy(&entity, key, sizeof(key));
+		char code[8];
+		REQUIRE(compactTopicEntityCode(key, code, sizeof(code)));
+		INFO(key);
+		CHECK(codes.insert(code).second);
+	}
+}
+
+TEST_CASE("compact topic: settable and templated entities keep their long topics")
+{
+	CHECK(compactTopicEntityEligible(mqttEntityId::entityGridPwr, false));
+	CHECK(compactTopicEntityEligible(mqttEntityId::entityBatSoc, false));
+	CHECK_FALSE(compactTopicEntityEligible(mqttEntityId::entityGridPwr, true));
+	CHECK_FALSE(compactTopicEntityEligible(mqttEntityId::entityFrequency, false));
+	CHECK_FALSE(compactTopicEntityEligible(mqttEntityId::entityRs485Avail, false));
+}
+
+TEST_CASE("compact topic: a ten-second power publish shrinks by more than half on the wire")
+{
+	const char *inverterId = "alpha2mqtt_inv_AL2002321010043";
+	char topicBase[128];
+	REQUIRE(buildEntityTopicBase("Alpha2MQTT",
+	                             DiscoveryDeviceScope::Inverter,
+	                             "alpha2mqtt_ctrl",
+	                             "AL2002321010043",
+	                             "Grid_Power",
+	                             topicBase,
+	                             sizeof(topicBase)));
+	const std::string longTopic = std::string(topicBase) + "/state";
+	char compact[kCompactTopicMaxLen];
+	REQUIRE(buildCompactStateTopic("Alpha2MQTT", inverterId, "Grid_Power", compact, sizeof(compact)));
+
+	const size_t payloadLen = std::strlen("-1234");
+	const size_t longBytes = mqttPublishPacketBytes(longTopic.size(), payloadLen);
+	const size_t compactBytes = mqttPublishPacketBytes(std::strlen(compact), payloadLen);
+	MESSAGE("per publish: " << longBytes << " -> " << compactBytes << " bytes ("
+	                        << (100 * (longBytes - compactBytes) / longBytes) << "% less)");
+	CHECK(longTopic == "Alpha2MQTT/alpha2mqtt_inv_AL2002321010043/Grid_Power/state");
+	CHECK(compactBytes * 2 < longBytes);
+}
@@ -1,17 +1,96 @@
 #include "doctest/doctest.h"
 
+#include <chrono>
+#include <cstring>
+
+#include "AllocProfiler.h"
 #include "ConfigCodec.h"
 
+namespace {
+
+A2mConfig
+decode(const char *payload)
+{
+	A2mConfig config{};
+	deserializeConfig(payload, strlen(payload), config);
+	return config;
+}
+
+// xorshift32: deterministic, so a failing fuzz seed reproduces.
+uint32_t
+nextRandom(uint32_t &state)
+{
+	state ^= state << 13;
+	state ^= state >> 17;
+	state ^= state << 5;
+	return state;
+}
+
+void
+randomString(uint32_t &state, char *out, size_t maxLen)
+{
+	const size_t len = nextRandom(state) % (maxLen + 1);
+	for (size_t i = 0; i < len; ++i) {
+		// Any byte but NUL, so separators, '%' and control bytes all get exercised.
+		out[i] = static_cast<char>(1 + nextRandom(state) % 255);
+	}
+	out[len] = '\0';
+}
+
+A2mConfig
+randomConfig(uint32_t &state)
+{
+	A2mConfig config = defaultConfig();
+	config.pollIntervalSeconds = kPollIntervalMinSeconds + nextRandom(state) % kPollIntervalMaxSeconds;
+	config.bootMode = static_cast<BootMode>(nextRandom(state) % 3);
+	config.bootIntent = static_cast<BootIntent>(nextRandom(state) % 5);
+	config.enabledRegisterMask = (static_cast<uint64_t>(nextRandom(state)) << 32) | nextRandom(state);
+	randomString(state, config.wifiSsid, kConfigStringMaxLen);
+	randomString(state, config.wifiPass, kConfigStringMaxLen);
+	randomString(state, config.mqttServer, kConfigStringMaxLen);
+	config.mqttPort = static_cast<uint16_t>(nextRandom(state));
+	randomString(state, config.mqttUser, kConfigStringMaxLen);
+	randomString(state, config.mqttPass, kConfigStringMaxLen);
+	randomString(state, config.inverterLabel, kConfigInverterLabelMaxLen);
+	config.rs485Baud = nextRandom(state);
+	randomString(state, config.rs485SlaveIds, kConfigSlaveListMaxLen);
+	config.extAntenna = (nextRandom(state) & 1U) != 0;
+	return config;
+}
+
+void
+checkSameConfig(const A2mConfig &a, const A2mConfig &b)
+{
+	CHECK(a.pollIntervalSeconds == b.pollIntervalSeconds);
+	CHECK(a.bootMode == b.bootMode);
+	CHECK(a.bootIntent == b.bootIntent);
+	CHECK(a.enabledRegisterMask == b.enabledRegisterMask);
+	CHECK(strcmp(a.wifiSsid, b.wifiSsid) == 0);
+	CHECK(strcmp(a.wifiPass, b.wifiPass) == 0);
+	CHECK(strcmp(a.mqttServer, b.mqttServer) == 0);
+	CHECK(a.mqttPort == b.mqttPort);
+	CHECK(strcmp(a.mqttUser, b.mqttUser) == 0);
+	CHECK(strcmp(a.mqttPass, b.mqttPass) == 0);
+	CHECK(strcmp(a.inverterLabel, b.inverterLabel) == 0);
+	CHECK(a.rs485Baud == b.rs485Baud);
+	CHECK(strcmp(a.rs485SlaveIds, b.rs485SlaveIds) == 0);
+	CHECK(a.extAntenna == b.extAntenna);
+}
+
+} // namespace
+
 TEST_CASE("config codec round-trips")
 {
-	A2mConfig input;
+	A2mConfig input = defaultConfig();
 	input.pollIntervalSeconds = 120;
 	input.bootMode = BootMode::WifiConfig;
 	input.bootIntent = BootIntent::WifiConfig;
 	input.enabledRegisterMask = 0xA5A5u;
 
-	std::string encoded = serializeConfig(input);
-	A2mConfig decoded = deserializeConfig(encoded);
+	char encoded[kConfigEncodedMaxBytes];
+	REQUIRE(serializeConfig(input, encoded, sizeof(encoded)) > 0);
+	A2mConfig decoded{};
+	CHECK(deserializeConfig(encoded, strlen(encoded), decoded) == ConfigDecodeStatus::Ok);
 
 	CHECK(decoded.pollIntervalSeconds == 120);
 	CHECK(decoded.bootMode == BootMode::WifiConfig);
@@ -21,19 +100,22 @@ TEST_CASE("config codec round-trips")
 
 TEST_CASE("config codec applies defaults when keys are missing")
 {
-	A2mConfig decoded = deserializeConfig("boot_mode=ap_config");
+	A2mConfig decoded = decode("boot_mode=ap_config");
 	CHECK(decoded.bootMode == BootMode::ApConfig);
 	CHECK(decoded.bootIntent == BootIntent::Normal);
 	CHECK(decoded.pollIntervalSeconds == kPollIntervalDefaultSeconds);
 	CHECK(decoded.enabledRegisterMask == 0u);
+	CHECK(decoded.wifiSsid[0] == '\0');
+	CHECK(decoded.mqttPort == 0);
+	CHECK(decoded.rs485Baud == 0);
 }
 
 TEST_CASE("config codec clamps poll interval")
 {
-	A2mConfig decodedMin = deserializeConfig("poll_interval_s=0");
+	A2mConfig decodedMin = decode("poll_interval_s=0");
 	CHECK(decodedMin.pollIntervalSeconds == kPollIntervalMinSeconds);
 
-	A2mConfig decodedMax = deserializeConfig("poll_interval_s=999999");
+	A2mConfig decodedMax = decode("poll_interval_s=999999");
 	CHECK(decodedMax.pollIntervalSeconds == kPollIntervalMaxSeconds);
 }
 
@@ -47,3 +129,151 @@ TEST_CASE("consume boot intent resets to normal")
 	CHECK(prior == BootIntent::WifiConfig);
 	CHECK(config.bootIntent == BootIntent::Normal);
 }
+
+TEST_CASE("config codec covers every persisted setting and escapes separators")
+{
+	A2mConfig input = defaultConfig();
+	strcpy(input.wifiSsid, "Home;Net=5%");
+	strcpy(input.wifiPass, "p\tss;word");
+	strcpy(input.mqttServer, "192.168.1.10");
+	input.mqttPort = 1883;
+	strcpy(input.mqttUser, "alpha");
+	strcpy(input.mqttPass, "=;%");
+	strcpy(input.inverterLabel, "Garage");
+	input.rs485Baud = 9600;
+	strcpy(input.rs485SlaveIds, "85,86");
+	input.extAntenna = true;
+
+	char encoded[kConfigEncodedMaxBytes];
+	const size_t len = serializeConfig(input, encoded, sizeof(encoded));
+	REQUIRE(len == strlen(encoded));
+	CHECK(strncmp(encoded, "v=2;poll_interval_s=60;boot_mode=normal;", 40) == 0);
+	CHECK(strstr(encoded, "wifi_ssid=Home%3BNet%3D5%25;") != nullptr);
+	CHECK(strstr(encoded, "wifi_pass=p%09ss%3Bword;") != nullptr);
+	CHECK(strstr(encoded, "ext_antenna=1") != nullptr);
+
+	A2mConfig decoded{};
+	CHECK(deserializeConfig(encoded, len, decoded) == ConfigDecodeStatus::Ok);
+	checkSameConfig(decoded, input);
+
+	// Every buffer too small to hold the payload is refused without writing past its end.
+	char small[kConfigEncodedMaxBytes + 1];
+	for (size_t size = 1; size <= len; ++size) {
+		memset(small, 'x', sizeof(small));
+		CHECK(serializeConfig(input, small, size) == 0);
+		CHECK(small[0] == '\0');
+		CHECK(small[size] == 'x');
+	}
+	CHECK(serializeConfig(input, small, len + 1) == len);
+	CHECK(serializeConfig(input, nullptr, 0) == 0);
+}
+
+TEST_CASE("config codec rejects newer versions and flags bad values")
+{
+	A2mConfig config{};
+	CHECK(deserializeConfig("v=3;poll_interval_s=10", 22, config) == ConfigDecodeStatus::UnsupportedVersion);
+	CHECK(config.pollIntervalSeconds == kPollIntervalDefaultSeconds);
+
+	// Version 1 payloads had no version key and still decode.
+	CHECK(deserializeConfig("poll_interval_s=10;enabled_register_mask=5", 42, config) == ConfigDecodeStatus::Ok);
+	CHECK(config.pollIntervalSeconds == 10);
+	CHECK(config.enabledRegisterMask == 5u);
+
+	// Unknown keys from a newer build of the same version are skipped.
+	CHECK(deserializeConfig("v=2;future_key=1;mqtt_port=1884", 31, config) == ConfigDecodeStatus::Ok);
+	CHECK(config.mqttPort == 1884);
+
+	const char *bad = "mqtt_port=70000;ext_antenna=2;boot_mode=sideways;wifi_ssid=%4;inverter_label=abcdefghijk;"
+	                  "enabled_register_mask=18446744073709551616;rs485_baud=-1;mqtt_user=ok";
+	CHECK(deserializeConfig(bad, strlen(bad), config) == ConfigDecodeStatus::Partial);
+	CHECK(config.mqttPort == 0);
+	CHECK_FALSE(config.extAntenna);
+	CHECK(config.bootMode == BootMode::Normal);
+	CHECK(config.wifiSsid[0] == '\0');
+	CHECK(config.inverterLabel[0] == '\0');
+	CHECK(config.enabledRegisterMask == 0u);
+	CHECK(config.rs485Baud == 0);
+	CHECK(strcmp(config.mqttUser, "ok") == 0);
+
+	// Decoding stops at len even without a NUL, and at an embedded NUL before len.
+	CHECK(deserializeConfig("mqtt_port=12345", 13, config) == ConfigDecodeStatus::Ok);
+	CHECK(config.mqttPort == 123);
+	const char embedded[] = "mqtt_port=12\0;mqtt_user=x";
+	CHECK(deserializeConfig(embedded, sizeof(embedded) - 1, config) == ConfigDecodeStatus::Ok);
+	CHECK(config.mqttPort == 12);
+	CHECK(config.mqttUser[0] == '\0');
+}
+
+TEST_CASE("config codec fuzz: random configs round-trip and random bytes decode safely")
+{
+	uint32_t state = 0x2026A2Eu;
+	char encoded[kConfigEncodedMaxBytes];
+	for (int round = 0; round < 500; ++round) {
+		CAPTURE(round);
+		const A2mConfig input = randomConfig(state);
+		const size_t len = serializeConfig(input, encoded, sizeof(encoded));
+		REQUIRE(len > 0);
+		REQUIRE(len < sizeof(encoded));
+		A2mConfig decoded{};
+		REQUIRE(deserializeConfig(encoded, len, decoded) == ConfigDecodeStatus::Ok);
+		checkSameConfig(decoded, input);
+
+		// Corrupt a few bytes of the valid payload: whatever comes back must still be bounded.
+		for (int flip = 0; flip < 4; ++flip) {
+			encoded[nextRandom(state) % len] = static_cast<char>(nextRandom(state));
+		}
+		deserializeConfig(encoded, len, decoded);
+		CHECK(strlen(decoded.wifiSsid) <= kConfigStringMaxLen);
+		CHECK(strlen(decoded.mqttPass) <= kConfigStringMaxLen);
+		CHECK(strlen(decoded.inverterLabel) <= kConfigInverterLabelMaxLen);
+		CHECK(strlen(decoded.rs485SlaveIds) <= kConfigSlaveListMaxLen);
+		CHECK(decoded.pollIntervalSeconds >= kPollIntervalMinSeconds);
+		CHECK(decoded.pollIntervalSeconds <= kPollIntervalMaxSeconds);
+	}
+
+	// The worst case (every string at its limit, every byte escaped) fits the advertised bound.
+	A2mConfig worst = defaultConfig();
+	worst.bootIntent = BootIntent::PortalNormal;
+	worst.enabledRegisterMask = UINT64_MAX;
+	worst.mqttPort = UINT16_MAX;
+	worst.rs485Baud = UINT32_MAX;
+	worst.extAntenna = true;
+	char *strings[] = { worst.wifiSsid, worst.wifiPass, worst.mqttServer, worst.mqttUser, worst.mqttPass };
+	for (char *text : strings) {
+		memset(text, ';', kConfigStringMaxLen);
+		text[kConfigStringMaxLen] = '\0';
+	}
+	memset(worst.inverterLabel, '%', kConfigInverterLabelMaxLen);
+	memset(worst.rs485SlaveIds, '=', kConfigSlaveListMaxLen);
+	CHECK(serializeConfig(worst, encoded, sizeof(encoded)) > 0);
+}
+
+TEST_CASE("config codec benchmark: encode and decode without allocating")
+{
+	uint32_t state = 7;
+	const A2mConfig input = randomConfig(state);
+	char encoded[kConfigEncodedMaxBytes];
+	A2mConfig decoded{};
+	const int rounds = 5000;
+	size_t total = 0;
+
+	AllocWindow window;
+	const auto start = std::chrono::steady_clock::now();
+	for (int round = 0; round < rounds; ++round) {
+		const size_t len = serializeConfig(input, encoded, sizeof(encoded));
+		total += len;
+		if (deserializeConfig(encoded, len, decoded) != ConfigDecodeStatus::Ok) {
+			total = 0;
+			break;
+		}
+	}
+	const double elapsedUs = static_cast<double>(
+		std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count());
+	const uint32_t allocs = window.allocs();
+	const uint32_t frees = window.frees();
+	MESSAGE("config codec: " << (elapsedUs / rounds) << " us per encode+decode of " << (total / rounds) << " bytes");
+	CHECK(total > 0);
+	CHECK(allocs == 0);
+	CHECK(frees == 0);
+	checkSameConfig(decoded, input);
+}
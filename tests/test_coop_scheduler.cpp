@@ -0,0 +1,229 @@
+// Purpose: Validate cooperative loop() task scheduling, priority order and per-task accounting.
+#include "doctest/doctest.h"
+
+#include <string>
+
+#include "CoopScheduler.h"
+#include "TimeProviderFake.h"
+
+namespace {
+
+struct FakeWork {
+	std::string *trace;
+	char tag;
+	// Simulated CPU time consumed by one run.
+	uint32_t costMs;
+	uint32_t *clock;
+};
+
+void
+runFakeWork(void *ctx)
+{
+	FakeWork *work = static_cast<FakeWork *>(ctx);
+	work->trace->push_back(work->tag);
+	*work->clock += work->costMs;
+	setFakeMillis(*work->clock);
+}
+
+} // namespace
+
+TEST_CASE("coop scheduler: only due tasks run, in priority order")
+{
+	uint32_t clock = 1000;
+	setFakeMillis(clock);
+	std::string trace;
+	FakeWork oled{ &trace, 'o', 0, &clock };
+	FakeWork mqtt{ &trace, 'm', 0, &clock };
+	FakeWork led{ &trace, 'l', 0, &clock };
+
+	CoopScheduler sched;
+	const uint8_t oledId = coopSchedulerAdd(sched, "oled", runFakeWork, &oled, 500, 5, 0);
+	const uint8_t mqttId = coopSchedulerAdd(sched, "mqtt", runFakeWork, &mqtt, 0, 0, 0);
+	const uint8_t ledId = coopSchedulerAdd(sched, "led", runFakeWork, &led, 100, 5, 0);
+	REQUIRE(oledId != kCoopTaskInvalid);
+	REQUIRE(mqttId != kCoopTaskInvalid);
+	REQUIRE(ledId != kCoopTaskInvalid);
+
+	CHECK(coopSchedulerRunDue(sched) == 3u);
+	CHECK(trace == "mol");
+
+	trace.clear();
+	clock += 50;
+	setFakeMillis(clock);
+	CHECK(coopSchedulerRunDue(sched) == 1u);
+	CHECK(trace == "m");
+
+	trace.clear();
+	clock += 50;
+	setFakeMillis(clock);
+	coopSchedulerRunDue(sched);
+	CHECK(trace == "ml");
+
+	trace.clear();
+	clock += 400;
+	setFakeMillis(clock);
+	coopSchedulerRunDue(sched);
+	CHECK(trace == "mol");
+
+	CHECK(coopSchedulerTask(sched, oledId)->stats.runs == 2u);
+	CHECK(coopSchedulerTask(sched, ledId)->stats.runs == 3u);
+	CHECK(coopSchedulerTask(sched, mqttId)->stats.runs == 4u);
+}
+
+TEST_CASE("coop scheduler: cpu time, overruns and latency are tracked per task")
+{
+	uint32_t clock = 0;
+	setFakeMillis(clock);
+	std::string trace;
+	FakeWork slow{ &trace, 's', 80, &clock };
+	FakeWork fast{ &trace, 'f', 2, &clock };
+
+	CoopScheduler sched;
+	const uint8_t slowId = coopSchedulerAdd(sched, "slow", runFakeWork, &slow, 0, 0, 50);
+	const uint8_t fastId = coopSchedulerAdd(sched, "fast", runFakeWork, &fast, 100, 1, 5);
+
+	coopSchedulerRunDue(sched);
+	const CoopTask *slowTask = coopSchedulerTask(sched, slowId);
+	const CoopTask *fastTask = coopSchedulerTask(sched, fastId);
+	CHECK(slowTask->stats.cpuMs == 80u);
+	CHECK(slowTask->stats.overruns == 1u);
+	CHECK(fastTask->stats.overruns == 0u);
+	// The fast task was due at 0 but only started after the slow one finished.
+	CHECK(fastTask->stats.maxLatencyMs == 80u);
+
+	coopSchedulerRunDue(sched);
+	coopSchedulerRunDue(sched);
+	CHECK(slowTask->stats.runs == 3u);
+	CHECK(slowTask->stats.cpuMs == 240u);
+	CHECK(slowTask->stats.maxRunMs == 80u);
+	CHECK(slowTask->stats.overruns == 3u);
+	CHECK(fastTask->stats.runs == 3u);
+	CHECK(fastTask->stats.cpuMs == 6u);
+	CHECK(sched.passes == 3u);
+}
+
+TEST_CASE("coop scheduler: wake, disable and fall-behind rebasing")
+{
+	uint32_t clock = 0;
+	setFakeMillis(clock);
+	std::string trace;
+	FakeWork work{ &trace, 'w', 0, &clock };
+
+	CoopScheduler sched;
+	const uint8_t id = coopSchedulerAdd(sched, "work", runFakeWork, &work, 1000, 0, 0);
+	coopSchedulerRunDue(sched);
+	CHECK_FALSE(coopSchedulerDue(sched, id, 10));
+
+	setFakeMillis(10);
+	coopSchedulerWake(sched, id);
+	CHECK(coopSchedulerDue(sched, id, 10));
+	coopSchedulerRunDue(sched);
+	CHECK(trace == "ww");
+
+	coopSchedulerSetEnabled(sched, id, false);
+	setFakeMillis(5000);
+	CHECK(coopSchedulerRunDue(sched) == 0u);
+
+	// Re-enabling makes it due now; a long stall runs once, not once per missed period.
+	coopSchedulerSetEnabled(sched, id, true);
+	clock = 9000;
+	setFakeMillis(clock);
+	CHECK(coopSchedulerRunDue(sched) == 1u);
+	CHECK(coopSchedulerRunDue(sched) == 0u);
+	CHECK_FALSE(coopSchedulerDue(sched, id, 9999));
+	CHECK(coopSchedulerDue(sched, id, 10000));
+}
+
+TEST_CASE("coop scheduler: due checks survive millis wraparound")
+{
+	uint32_t clock = 0xFFFFFF00u;
+	setFakeMillis(clock);
+	std::string trace;
+	FakeWork work{ &trace, 'w', 0, &clock };
+
+	CoopScheduler sched;
+	const uint8_t id = coopSchedulerAdd(sched, "work", runFakeWork, &work, 0x200, 0, 0);
+	coopSchedulerRunDue(sched);
+	CHECK_FALSE(coopSchedulerDue(sched, id, 0x00000010u));
+	CHECK(coopSchedulerDue(sched, id, 0x00000100u));
+}
+
+TEST_CASE("coop scheduler: table limits and bad ids are rejected")
+{
+	setFakeMillis(0);
+	CoopScheduler sched;
+	std::string trace;
+	uint32_t clock = 0;
+	FakeWork work{ &trace, 'w', 0, &clock };
+	CHECK(coopSchedulerAdd(sched, "x", nullptr, nullptr, 0, 0, 0) == kCoopTaskInvalid);
+	for (size_t i = 0; i < kMaxCoopTasks; ++i) {
+		CHECK(coopSchedulerAdd(sched, "t", runFakeWork, &work, 0, 0, 0) == i);
+	}
+	CHECK(coopSchedulerAdd(sched, "t", runFakeWork, &work, 0, 0, 0) == kCoopTaskInvalid);
+	CHECK(coopSchedulerTask(sched, kCoopTaskInvalid) == nullptr);
+	CHECK_FALSE(coopSchedulerDue(sched, kCoopTaskInvalid, 0));
+	coopSchedulerWake(sched, kCoopTaskInvalid);
+}
+
+namespace {
+
+struct FakeDeadline {
+	uint32_t dueAtMs;
+	int runs;
+};
+
+uint32_t
+fakeDeadlineNextDue(uint32_t nowMs, void *ctx)
+{
+	const FakeDeadline *deadline = static_cast<const FakeDeadline *>(ctx);
+	const int32_t remaining = static_cast<int32_t>(deadline->dueAtMs - nowMs);
+	return remaining <= 0 ? 0 : static_cast<uint32_t>(remaining);
+}
+
+void
+fakeDeadlineRun(void *ctx)
+{
+	FakeDeadline *deadline = static_cast<FakeDeadline *>(ctx);
+	deadline->runs++;
+	deadline->dueAtMs += 10000;
+}
+
+} // namespace
+
+TEST_CASE("coop scheduler: next-due hooks replace every-pass polling and drive idle time")
+{
+	setFakeMillis(0);
+	FakeDeadline poll{ 10000, 0 };
+	std::string trace;
+	uint32_t clock = 0;
+	FakeWork oled{ &trace, 'o', 0, &clock };
+
+	CoopScheduler sched;
+	const uint8_t pollId = coopSchedulerAdd(sched, "poll", fakeDeadlineRun, &poll, 0, 0, 0);
+	coopSchedulerSetNextDue(sched, pollId, fakeDeadlineNextDue);
+	coopSchedulerAdd(sched, "oled", runFakeWork, &oled, 500, 1, 0);
+
+	// Newly added tasks are due once; afterwards the poll task waits for its own deadline.
+	CHECK(coopSchedulerRunDue(sched) == 2u);
+	CHECK(poll.runs == 1);
+	CHECK(poll.dueAtMs == 20000u);
+	CHECK(coopSchedulerMsUntilNextDue(sched, 0, 60000) == 500u);
+
+	setFakeMillis(500);
+	CHECK(coopSchedulerRunDue(sched) == 1u);
+	CHECK(poll.runs == 1);
+
+	// Without the OLED task, the idle window is the poll deadline, clamped by the cap.
+	coopSchedulerSetEnabled(sched, 1, false);
+	CHECK(coopSchedulerMsUntilNextDue(sched, 500, 60000) == 19500u);
+	CHECK(coopSchedulerMsUntilNextDue(sched, 500, 20) == 20u);
+
+	setFakeMillis(20000);
+	CHECK(coopSchedulerMsUntilNextDue(sched, 20000, 60000) == 0u);
+	CHECK(coopSchedulerRunDue(sched) == 1u);
+	CHECK(poll.runs == 2);
+
+	// wake() still forces a hook-driven task.
+	coopSchedulerWake(sched, pollId);
+	CHECK(coopSchedulerMsUntilNextDue(sched, 20000, 60000) == 0u);
+}
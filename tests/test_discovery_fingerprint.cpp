@@ -0,0 +1,100 @@
+#include <doctest/doctest.h>
+
+#include <cstring>
+#include <vector>
+
+#include "DiscoveryFingerprint.h"
+
+TEST_CASE("discovery fingerprint: chunking does not change the hash")
+{
+	const char *payload = "{\"name\":\"Battery SOC\",\"unit_of_measurement\":\"%\"}";
+	const uint32_t whole = fingerprintUpdate(kFingerprintSeed, payload, strlen(payload));
+	uint32_t chunked = kFingerprintSeed;
+	for (size_t i = 0; i < strlen(payload); i += 7) {
+		const size_t len = strlen(payload) - i < 7 ? strlen(payload) - i : 7;
+		chunked = fingerprintUpdate(chunked, payload + i, len);
+	}
+	CHECK(whole == chunked);
+	CHECK(whole != fingerprintUpdate(kFingerprintSeed, payload, strlen(payload) - 1));
+	CHECK(fingerprintUpdate(kFingerprintSeed, "", 0) == kFingerprintSeed);
+}
+
+TEST_CASE("discovery fingerprint: chained strings keep their boundaries")
+{
+	const uint32_t a = fingerprintString(fingerprintString(kFingerprintSeed, "ab"), "c");
+	const uint32_t b = fingerprintString(fingerprintString(kFingerprintSeed, "a"), "bc");
+	CHECK(a != b);
+	CHECK(fingerprintString(kFingerprintSeed, nullptr) == kFingerprintSeed);
+}
+
+TEST_CASE("discovery fingerprint: store marks dirty only on change")
+{
+	DiscoveryFingerprintTable table;
+	discoveryFingerprintReset(table, 1, 2);
+	CHECK_FALSE(table.dirty);
+	CHECK(discoveryFingerprintKnownCount(table) == 0);
+	CHECK_FALSE(discoveryFingerprintMatches(table, 0, 0));
+
+	discoveryFingerprintStore(table, 0, 0x1234);
+	CHECK(table.dirty);
+	CHECK(discoveryFingerprintMatches(table, 0, 0x1234));
+	CHECK_FALSE(discoveryFingerprintMatches(table, 0, 0x1235));
+
+	table.dirty = false;
+	discoveryFingerprintStore(table, 0, 0x1234);
+	CHECK_FALSE(table.dirty);
+
+	discoveryFingerprintStore(table, kDiscoveryFingerprintSlotInverterDevice, 7);
+	CHECK(table.dirty);
+	CHECK(discoveryFingerprintKnownCount(table) == 2);
+
+	table.dirty = false;
+	discoveryFingerprintStore(table, kDiscoveryFingerprintSlotCount, 9);
+	CHECK_FALSE(table.dirty);
+	CHECK_FALSE(discoveryFingerprintMatches(table, kDiscoveryFingerprintSlotCount, 9));
+}
+
+TEST_CASE("discovery fingerprint: blob round-trips and rejects stale or corrupt data")
+{
+	DiscoveryFingerprintTable table;
+	discoveryFingerprintReset(table, 0xAABBCCDD, 0x01020304);
+	for (size_t slot = 0; slot < kDiscoveryFingerprintSlotCount; slot += 3) {
+		discoveryFingerprintStore(table, slot, static_cast<uint32_t>(slot * 2654435761UL));
+	}
+
+	std::vector<uint8_t> blob(discoveryFingerprintBlobSize());
+	CHECK(discoveryFingerprintSerialize(table, blob.data(), blob.size() - 1) == 0);
+	REQUIRE(discoveryFingerprintSerialize(table, blob.data(), blob.size()) == blob.size());
+
+	DiscoveryFingerprintTable loaded;
+	REQUIRE(discoveryFingerprintDeserialize(loaded, blob.data(), blob.size(), 0xAABBCCDD, 0x01020304));
+	CHECK_FALSE(loaded.dirty);
+	CHECK(discoveryFingerprintKnownCount(loaded) == discoveryFingerprintKnownCount(table));
+	for (size_t slot = 0; slot < kDiscoveryFingerprintSlotCount; ++slot) {
+		CHECK(discoveryFingerprintMatches(loaded, slot, table.fingerprints[slot]) ==
+		      discoveryFingerprintMatches(table, slot, table.fingerprints[slot]));
+	}
+
+	SUBCASE("catalog change invalidates")
+	{
+		CHECK_FALSE(discoveryFingerprintDeserialize(loaded, blob.data(), blob.size(), 0xAABBCCDE, 0x01020304));
+		CHECK(discoveryFingerprintKnownCount(loaded) == 0);
+		CHECK(loaded.catalogHash == 0xAABBCCDE);
+	}
+	SUBCASE("firmware change invalidates")
+	{
+		CHECK_FALSE(discoveryFingerprintDeserialize(loaded, blob.data(), blob.size(), 0xAABBCCDD, 0));
+		CHECK(discoveryFingerprintKnownCount(loaded) == 0);
+	}
+	SUBCASE("corruption invalidates")
+	{
+		blob[blob.size() / 2] ^= 0x01;
+		CHECK_FALSE(discoveryFingerprintDeserialize(loaded, blob.data(), blob.size(), 0xAABBCCDD, 0x01020304));
+		CHECK(discoveryFingerprintKnownCount(loaded) == 0);
+	}
+	SUBCASE("truncated blob invalidates")
+	{
+		CHECK_FALSE(discoveryFingerprintDeserialize(loaded, blob.data(), blob.size() - 4, 0xAABBCCDD, 0x01020304));
+		CHECK_FALSE(discoveryFingerprintDeserialize(loaded, nullptr, 0, 0xAABBCCDD, 0x01020304));
+	}
+}
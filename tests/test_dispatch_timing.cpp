@@ -79,6 +79,22 @@ TEST_CASE("dispatch timing evaluation and countdown cadences are independent")
 	CHECK(dispatchCountdownPublishDue(1000, 6000));
 }
 
+TEST_CASE("dispatch timing next-due reports the earlier of eval and countdown")
+{
+	CHECK(dispatchMsUntilDue(1000, 3000, false, 0, 1500) == 2500u);
+	CHECK(dispatchMsUntilDue(1000, 3000, false, 0, 4000) == 0u);
+	CHECK(dispatchMsUntilDue(1000, 0, false, 0, 1500) == 0u);
+
+	// Countdown publishes every 5s while a timed dispatch is active.
+	CHECK(dispatchMsUntilDue(1000, 60000, true, 3000, 4000) == 4000u);
+	CHECK(dispatchMsUntilDue(1000, 60000, true, 3000, 8000) == 0u);
+	CHECK(dispatchMsUntilDue(1000, 2000, true, 1000, 2500) == 500u);
+
+	// Wraparound: last eval just before the millis() rollover.
+	CHECK(dispatchMsUntilDue(0xFFFFFF00u, 0x200u, false, 0, 0x00000010u) == 0xF0u);
+	CHECK(dispatchMsUntilDue(0xFFFFFF00u, 0x200u, false, 0, 0x00000100u) == 0u);
+}
+
 TEST_CASE("dispatch timing fast cadence requires rs485 liveness")
 {
 	TimedDispatchRuntimeState state{};
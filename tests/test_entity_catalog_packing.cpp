@@ -0,0 +1,101 @@
+#include <doctest/doctest.h>
+
+#include <chrono>
+#include <cstring>
+
+#include "MqttEntities.h"
+
+static_assert(sizeof(MqttEntityPackedRow) == 8, "packed catalog rows must stay 8 bytes");
+static_assert(sizeof(MqttEntityPackedRow) * 2 <= sizeof(mqttState), "packing should at least halve a row");
+
+TEST_CASE("packed entity catalog: accessors and copies match the source rows")
+{
+	const mqttState *rows = mqttEntitiesDesc();
+	REQUIRE(rows != nullptr);
+	for (size_t idx = 0; idx < kMqttEntityDescriptorCount; ++idx) {
+		CAPTURE(idx);
+		const mqttState &row = rows[idx];
+		CHECK(static_cast<size_t>(row.entityId) == idx);
+		CHECK(strcmp(mqttEntityNameByIndex(idx), row.mqttName) == 0);
+		CHECK(mqttEntityDefaultFreqByIndex(idx) == row.updateFreq);
+		CHECK(mqttEntityHaClassByIndex(idx) == row.haClass);
+		CHECK(mqttEntityFamilyByIndex(idx) == row.family);
+		CHECK(mqttEntityScopeByIndex(idx) == row.scope);
+		CHECK(mqttEntityReadKindByIndex(idx) == row.readKind);
+		CHECK(mqttEntityReadKeyByIndex(idx) == row.readKey);
+		CHECK(mqttEntitySubscribeByIndex(idx) == row.subscribe);
+		CHECK(mqttEntityRetainByIndex(idx) == row.retain);
+		CHECK(mqttEntityNeedsEssSnapshotByIndex(idx) == row.needsEssSnapshot);
+
+		mqttState copy{};
+		REQUIRE(mqttEntityCopyByIndex(idx, &copy));
+		CHECK(copy.entityId == row.entityId);
+		CHECK(copy.updateFreq == row.updateFreq);
+		CHECK(copy.haClass == row.haClass);
+		CHECK(copy.family == row.family);
+		CHECK(copy.scope == row.scope);
+		CHECK(copy.readKind == row.readKind);
+		CHECK(copy.readKey == row.readKey);
+		CHECK(copy.subscribe == row.subscribe);
+		CHECK(copy.retain == row.retain);
+		CHECK(copy.needsEssSnapshot == row.needsEssSnapshot);
+		// Copies point into the shared name pool rather than at a per-row string.
+		CHECK(copy.mqttName == mqttEntityNameByIndex(idx));
+	}
+
+	CHECK(mqttEntityNameByIndex(kMqttEntityDescriptorCount) == nullptr);
+	CHECK(mqttEntityDefaultFreqByIndex(kMqttEntityDescriptorCount) == mqttUpdateFreq::freqDisabled);
+	CHECK(mqttEntityReadKeyByIndex(kMqttEntityDescriptorCount) == 0);
+	CHECK_FALSE(mqttEntityRetainByIndex(kMqttEntityDescriptorCount));
+}
+
+TEST_CASE("packed entity catalog: flash footprint is below the unpacked table")
+{
+	const mqttState *rows = mqttEntitiesDesc();
+	REQUIRE(rows != nullptr);
+	// The unpacked catalog: one mqttState per row plus one NUL-terminated array per name.
+	size_t unpackedBytes = kMqttEntityDescriptorCount * sizeof(mqttState);
+	size_t nameBytes = 0;
+	for (size_t idx = 0; idx < kMqttEntityDescriptorCount; ++idx) {
+		nameBytes += strlen(rows[idx].mqttName) + 1;
+	}
+	unpackedBytes += nameBytes;
+
+	const size_t packedBytes = mqttEntityCatalogFlashBytes();
+	CHECK(packedBytes == kMqttEntityDescriptorCount * sizeof(MqttEntityPackedRow) + nameBytes + 1);
+	MESSAGE("entity catalog flash: " << unpackedBytes << " bytes unpacked vs " << packedBytes << " packed");
+	CHECK(packedBytes < unpackedBytes);
+}
+
+TEST_CASE("packed entity catalog: per-access cost of a field read versus a row copy")
+{
+	const int rounds = 2000;
+	volatile size_t sink = 0;
+
+	const auto copyStart = std::chrono::steady_clock::now();
+	for (int round = 0; round < rounds; ++round) {
+		for (size_t idx = 0; idx < kMqttEntityDescriptorCount; ++idx) {
+			mqttState entity{};
+			if (mqttEntityCopyByIndex(idx, &entity)) {
+				sink = sink + static_cast<size_t>(entity.scope) + entity.readKey;
+			}
+		}
+	}
+	const double copyNs = static_cast<double>(
+		std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - copyStart).count());
+
+	const auto fieldStart = std::chrono::steady_clock::now();
+	for (int round = 0; round < rounds; ++round) {
+		for (size_t idx = 0; idx < kMqttEntityDescriptorCount; ++idx) {
+			sink = sink + static_cast<size_t>(mqttEntityScopeByIndex(idx)) + mqttEntityReadKeyByIndex(idx);
+		}
+	}
+	const double fieldNs = static_cast<double>(
+		std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - fieldStart).count());
+
+	const double reads = static_cast<double>(rounds) * static_cast<double>(kMqttEntityDescriptorCount);
+	MESSAGE("entity scope+readKey per access: " << (copyNs / reads) << " ns row copy vs " << (fieldNs / reads)
+	                                          << " ns field reads");
+	CHECK(sink > 0);
+	CHECK(fieldNs < copyNs);
+}
@@ -0,0 +1,71 @@
+#include <doctest/doctest.h>
+
+#include "EntityStateRoute.h"
+
+namespace {
+
+// A battery SOC reading from the primary inverter with every state option compiled in.
+EntityStateRouteInput
+allOptions(bool connected)
+{
+	EntityStateRouteInput in{};
+	in.historyEnabled = true;
+	in.batchEnabled = true;
+	in.queueEnabled = true;
+	in.primaryState = true;
+	in.mqttConnected = connected;
+	in.historyEligible = true;
+	in.batchEligible = true;
+	return in;
+}
+
+} // namespace
+
+TEST_CASE("entity state route: offline samples reach history before the batch")
+{
+	EntityStateRouteInput in = allOptions(false);
+	in.queueEnabled = false;
+	CHECK(entityStateRoute(in) == EntityStateRoute::History);
+
+	// A full ring does not hand an offline value to a batch that cannot be published.
+	in.historyEligible = false;
+	CHECK(entityStateRoute(in) == EntityStateRoute::Direct);
+}
+
+TEST_CASE("entity state route: connected batch builds skip history")
+{
+	EntityStateRouteInput in = allOptions(true);
+	in.queueEnabled = false;
+	CHECK(entityStateRoute(in) == EntityStateRoute::Batch);
+
+	// A value the batch rejects goes out on its own topic.
+	in.batchEligible = false;
+	CHECK(entityStateRoute(in) == EntityStateRoute::Direct);
+}
+
+TEST_CASE("entity state route: history falls back to the queue")
+{
+	EntityStateRouteInput in = allOptions(false);
+	in.batchEnabled = false;
+	CHECK(entityStateRoute(in) == EntityStateRoute::History);
+	in.historyEligible = false;
+	CHECK(entityStateRoute(in) == EntityStateRoute::Queue);
+	in.mqttConnected = true;
+	in.historyEligible = true;
+	CHECK(entityStateRoute(in) == EntityStateRoute::Queue);
+	in.queueEnabled = false;
+	CHECK(entityStateRoute(in) == EntityStateRoute::Direct);
+}
+
+TEST_CASE("entity state route: discovery and secondary inverters publish directly")
+{
+	EntityStateRouteInput in = allOptions(false);
+	in.primaryState = false;
+	CHECK(entityStateRoute(in) == EntityStateRoute::Direct);
+	in.mqttConnected = true;
+	CHECK(entityStateRoute(in) == EntityStateRoute::Direct);
+
+	EntityStateRouteInput none{};
+	none.primaryState = true;
+	CHECK(entityStateRoute(none) == EntityStateRoute::Direct);
+}
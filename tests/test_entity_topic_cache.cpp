@@ -0,0 +1,147 @@
+#include <doctest/doctest.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include "EntityTopicCache.h"
+
+namespace {
+
+const char *kDeviceName = "Alpha2MQTT";
+const char *kControllerId = "alpha2mqtt_ctrl_A1B2C3";
+const char *kSerial = "AL2002321010043";
+
+// The per-publish work sendDataFromMqttState() used to do for every state.
+size_t
+legacyStateTopic(mqttEntityId id, char *out, size_t outLen)
+{
+	size_t idx = 0;
+	for (size_t i = 0; i < mqttEntitiesCount(); ++i) {
+		mqttState candidate{};
+		mqttEntityCopyByIndex(i, &candidate);
+		if (candidate.entityId == id) {
+			idx = i;
+			break;
+		}
+	}
+	mqttState entity{};
+	mqttEntityCopyByIndex(idx, &entity);
+	const DiscoveryDeviceScope scope = mqttEntityScope(entity.entityId);
+	char inverterId[64];
+	buildInverterIdentifier(kSerial, inverterId, sizeof(inverterId));
+	char entityKey[64];
+	mqttEntityNameCopy(&entity, entityKey, sizeof(entityKey));
+	char topicBase[128];
+	if (!buildEntityTopicBase(kDeviceName, scope, kControllerId, kSerial, entityKey, topicBase, sizeof(topicBase))) {
+		return 0;
+	}
+	return static_cast<size_t>(snprintf(out, outLen, "%s/state", topicBase));
+}
+
+size_t
+cachedStateTopic(EntityTopicCache &cache, mqttEntityId id, char *out, size_t outLen)
+{
+	size_t idx = 0;
+	mqttState entity{};
+	if (!mqttEntityIndexById(id, &idx) || !mqttEntityCopyByIndex(idx, &entity)) {
+		return 0;
+	}
+	const EntityTopicPrefix *prefix =
+		entityTopicCachePrefix(cache, mqttEntityScope(entity.entityId), kDeviceName, kControllerId, kSerial, true);
+	return entityTopicCompose(*prefix, &entity, "/state", out, outLen);
+}
+
+} // namespace
+
+TEST_CASE("entity topic cache: composed topics match the formatted ones for every catalog entity")
+{
+	EntityTopicCache cache;
+	entityTopicCacheInit(cache);
+	for (size_t idx = 0; idx < mqttEntitiesCount(); ++idx) {
+		mqttState entity{};
+		REQUIRE(mqttEntityCopyByIndex(idx, &entity));
+		size_t byId = 0;
+		REQUIRE(mqttEntityIndexById(entity.entityId, &byId));
+		CHECK(byId == idx);
+
+		char legacy[176];
+		char cached[176];
+		const size_t legacyLen = legacyStateTopic(entity.entityId, legacy, sizeof(legacy));
+		REQUIRE(legacyLen > 0);
+		CHECK(cachedStateTopic(cache, entity.entityId, cached, sizeof(cached)) == legacyLen);
+		CHECK(std::string(cached) == std::string(legacy));
+	}
+	// Two scopes, each built once.
+	CHECK(cache.rebuilds == 2);
+}
+
+TEST_CASE("entity topic cache: the inverter prefix follows serial and readiness changes")
+{
+	EntityTopicCache cache;
+	entityTopicCacheInit(cache);
+	const EntityTopicPrefix *prefix =
+		entityTopicCachePrefix(cache, DiscoveryDeviceScope::Inverter, kDeviceName, kControllerId, "", false);
+	CHECK_FALSE(prefix->valid);
+
+	prefix = entityTopicCachePrefix(cache, DiscoveryDeviceScope::Inverter, kDeviceName, kControllerId, kSerial, false);
+	CHECK_FALSE(prefix->valid);
+	prefix = entityTopicCachePrefix(cache, DiscoveryDeviceScope::Inverter, kDeviceName, kControllerId, kSerial, true);
+	REQUIRE(prefix->valid);
+	char inverterId[64];
+	buildInverterIdentifier(kSerial, inverterId, sizeof(inverterId));
+	CHECK(std::string(prefix->deviceId) == inverterId);
+	CHECK(std::string(prefix->text) == std::string(kDeviceName) + "/" + inverterId + "/");
+	const uint32_t rebuilds = cache.rebuilds;
+	entityTopicCachePrefix(cache, DiscoveryDeviceScope::Inverter, kDeviceName, kControllerId, kSerial, true);
+	CHECK(cache.rebuilds == rebuilds);
+
+	prefix = entityTopicCachePrefix(cache, DiscoveryDeviceScope::Inverter, kDeviceName, kControllerId, "AL2002321010044", true);
+	CHECK(std::string(prefix->text).find("AL2002321010044") != std::string::npos);
+
+	entityTopicCacheInvalidate(cache);
+	entityTopicCachePrefix(cache, DiscoveryDeviceScope::Inverter, kDeviceName, kControllerId, "AL2002321010044", true);
+	CHECK(cache.rebuilds == rebuilds + 2);
+
+	// Too small an output buffer fails cleanly instead of truncating.
+	mqttState entity{};
+	REQUIRE(mqttEntityCopyById(mqttEntityId::entityGridPwr, &entity));
+	char small[24];
+	CHECK(entityTopicCompose(*prefix, &entity, "/state", small, sizeof(small)) == 0);
+	CHECK(small[0] == '\0');
+}
+
+TEST_CASE("entity topic cache: per-publish topic cost before and after")
+{
+	EntityTopicCache cache;
+	entityTopicCacheInit(cache);
+	const size_t count = mqttEntitiesCount();
+	const int rounds = 200;
+	char topic[176];
+	size_t sink = 0;
+
+	const auto legacyStart = std::chrono::steady_clock::now();
+	for (int round = 0; round < rounds; ++round) {
+		for (size_t idx = 0; idx < count; ++idx) {
+			sink += legacyStateTopic(static_cast<mqttEntityId>(idx), topic, sizeof(topic));
+		}
+	}
+	const auto legacyNs =
+		std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - legacyStart).count();
+
+	const auto cachedStart = std::chrono::steady_clock::now();
+	for (int round = 0; round < rounds; ++round) {
+		for (size_t idx = 0; idx < count; ++idx) {
+			sink += cachedStateTopic(cache, static_cast<mqttEntityId>(idx), topic, sizeof(topic));
+		}
+	}
+	const auto cachedNs =
+		std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - cachedStart).count();
+
+	const double publishes = static_cast<double>(rounds) * static_cast<double>(count);
+	MESSAGE("state topic per publish: " << (legacyNs / publishes) << " ns formatted vs " << (cachedNs / publishes)
+	                                    << " ns cached");
+	CHECK(sink > 0);
+	CHECK(cachedNs < legacyNs);
+}
@@ -74,3 +74,13 @@ TEST_CASE("modbus frames handle boundary register values")
 	CHECK(writeMultipleRegistersFrameSize(1) == 11u);
 	CHECK(writeMultipleRegistersFrameSize(std::numeric_limits<uint16_t>::max()) == 131079u);
 }
+
+TEST_CASE("modbus slave id validity excludes broadcast and reserved addresses")
+{
+	CHECK_FALSE(modbusSlaveIdIsValid(0));
+	CHECK(modbusSlaveIdIsValid(1));
+	CHECK(modbusSlaveIdIsValid(0x55));
+	CHECK(modbusSlaveIdIsValid(247));
+	CHECK_FALSE(modbusSlaveIdIsValid(248));
+	CHECK_FALSE(modbusSlaveIdIsValid(255));
+}
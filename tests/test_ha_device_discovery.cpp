@@ -0,0 +1,100 @@
+#include <doctest/doctest.h>
+
+#include <cstring>
+#include <string>
+
+#include "HaDeviceDiscovery.h"
+
+namespace {
+
+struct SinkCapture {
+	std::string text;
+	size_t writes = 0;
+	size_t failAfterWrites = 0;
+};
+
+bool
+captureSink(void *ctx, const char *data, size_t len)
+{
+	auto *capture = static_cast<SinkCapture *>(ctx);
+	if (capture->failAfterWrites != 0 && capture->writes >= capture->failAfterWrites) {
+		return false;
+	}
+	capture->writes++;
+	capture->text.append(data, len);
+	return true;
+}
+
+std::string
+compact(const char *input, size_t chunkSize)
+{
+	SinkCapture capture;
+	HaJsonCompactor compactor;
+	haJsonCompactorBegin(compactor, captureSink, &capture);
+	const size_t len = std::strlen(input);
+	for (size_t offset = 0; offset < len; offset += chunkSize) {
+		const size_t n = (len - offset < chunkSize) ? (len - offset) : chunkSize;
+		REQUIRE(haJsonCompactorFeed(compactor, input + offset, n));
+	}
+	REQUIRE(haJsonCompactorFinish(compactor));
+	CHECK(compactor.emitted == capture.text.size());
+	return capture.text;
+}
+
+} // namespace
+
+TEST_CASE("ha device discovery: abbreviation table and topic")
+{
+	CHECK(std::strcmp(haDiscoveryAbbreviation("unit_of_measurement", 19), "unit_of_meas") == 0);
+	CHECK(std::strcmp(haDiscoveryAbbreviation("component", 9), "p") == 0);
+	CHECK(std::strcmp(haDiscoveryAbbreviation("state_topic", 11), "stat_t") == 0);
+	CHECK(haDiscoveryAbbreviation("name", 4) == nullptr);
+	CHECK(haDiscoveryAbbreviation("state_top", 9) == nullptr);
+
+	char topic[64];
+	CHECK(buildHaDeviceDiscoveryTopic("alpha2mqtt_aabbcc", topic, sizeof(topic)));
+	CHECK(std::strcmp(topic, "homeassistant/device/alpha2mqtt_aabbcc/config") == 0);
+	CHECK_FALSE(buildHaDeviceDiscoveryTopic("", topic, sizeof(topic)));
+	CHECK_FALSE(buildHaDeviceDiscoveryTopic("alpha2mqtt_aabbcc", topic, 20));
+}
+
+TEST_CASE("ha device discovery: compactor abbreviates keys but never values")
+{
+	const char *input =
+		"{\"device\": { \"name\": \"Alpha ESS\", \"identifiers\": [\"id_1\"]},"
+		" \"components\": {\"Grid_Power\": {\"component\": \"sensor\", \"state_topic\": \"a/b/state\","
+		" \"value_template\": \"{{ value_json['icon'] | default('') }}\", \"icon\": \"icon\","
+		" \"name\": \"say \\\"state_topic\\\": x\"}}}";
+	const char *expected =
+		"{\"dev\":{\"name\":\"Alpha ESS\",\"ids\":[\"id_1\"]},"
+		"\"cmps\":{\"Grid_Power\":{\"p\":\"sensor\",\"stat_t\":\"a/b/state\","
+		"\"val_tpl\":\"{{ value_json['icon'] | default('') }}\",\"ic\":\"icon\","
+		"\"name\":\"say \\\"state_topic\\\": x\"}}}";
+	CHECK(compact(input, std::strlen(input)) == expected);
+	// Chunk boundaries must not change the output, including splits inside keys and escapes.
+	for (size_t chunk = 1; chunk < 12; ++chunk) {
+		CHECK(compact(input, chunk) == expected);
+	}
+}
+
+TEST_CASE("ha device discovery: long strings stream through unchanged")
+{
+	std::string longValue(200, 'x');
+	longValue[50] = '\\';
+	longValue[51] = '"';
+	const std::string input = "{\"state_topic\": \"" + longValue + "\", \"" + longValue + "\": 1}";
+	const std::string expected = "{\"stat_t\":\"" + longValue + "\",\"" + longValue + "\":1}";
+	CHECK(compact(input.c_str(), 7) == expected);
+}
+
+TEST_CASE("ha device discovery: compactor reports sink failures")
+{
+	SinkCapture capture;
+	capture.failAfterWrites = 1;
+	HaJsonCompactor compactor;
+	haJsonCompactorBegin(compactor, captureSink, &capture);
+	const std::string big(kHaJsonCompactorOutSize * 3, '1');
+	haJsonCompactorFeed(compactor, big.c_str(), big.size());
+	CHECK_FALSE(haJsonCompactorFinish(compactor));
+	CHECK(compactor.emitted == big.size());
+}
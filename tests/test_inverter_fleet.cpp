@@ -0,0 +1,302 @@
+// Purpose: Validate slave-id parsing, fair bus-time sharing and per-inverter poll turns on one RS485 bus.
+#include "doctest/doctest.h"
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "DiscoveryModel.h"
+#include "InverterFleet.h"
+#include "Rs485StubLogic.h"
+
+TEST_CASE("inverter fleet: slave id list parsing accepts decimal and hex and rejects bad input")
+{
+	uint8_t ids[kMaxInvertersPerBus] = {};
+	CHECK(parseInverterSlaveIdList("85", ids, kMaxInvertersPerBus) == 1);
+	CHECK(ids[0] == 0x55);
+
+	CHECK(parseInverterSlaveIdList("0x55, 0x56;87", ids, kMaxInvertersPerBus) == 3);
+	CHECK(ids[0] == 0x55);
+	CHECK(ids[1] == 0x56);
+	CHECK(ids[2] == 87);
+
+	CHECK(parseInverterSlaveIdList("", ids, kMaxInvertersPerBus) == 0);
+	CHECK(parseInverterSlaveIdList("0", ids, kMaxInvertersPerBus) == 0);
+	CHECK(parseInverterSlaveIdList("248", ids, kMaxInvertersPerBus) == 0);
+	CHECK(parseInverterSlaveIdList("85,85", ids, kMaxInvertersPerBus) == 0);
+	CHECK(parseInverterSlaveIdList("85x", ids, kMaxInvertersPerBus) == 0);
+	CHECK(parseInverterSlaveIdList("1,2,3,4,5", ids, kMaxInvertersPerBus) == 0);
+
+	char text[kInverterSlaveIdListMaxLen] = {};
+	const uint8_t four[] = { 85, 86, 200, 247 };
+	CHECK(formatInverterSlaveIdList(four, 4, text, sizeof(text)));
+	CHECK(std::string(text) == "85,86,200,247");
+	CHECK_FALSE(formatInverterSlaveIdList(four, 4, text, 6));
+	CHECK(text[0] == '\0');
+}
+
+TEST_CASE("inverter fleet: init rejects invalid or duplicate slave ids")
+{
+	InverterFleet fleet;
+	const uint8_t dup[] = { 0x55, 0x55 };
+	CHECK_FALSE(inverterFleetInit(fleet, dup, 2));
+	CHECK(fleet.count == 0);
+
+	const uint8_t broadcast[] = { 0 };
+	CHECK_FALSE(inverterFleetInit(fleet, broadcast, 1));
+
+	const uint8_t ok[] = { 0x55, 0x56 };
+	REQUIRE(inverterFleetInit(fleet, ok, 2));
+	CHECK(fleet.count == 2);
+	CHECK(inverterFleetIndexOf(fleet, 0x56) == 1);
+	CHECK(inverterFleetIndexOf(fleet, 0x57) == -1);
+}
+
+TEST_CASE("inverter fleet: bus time is shared fairly even when one inverter is slow")
+{
+	InverterFleet fleet;
+	const uint8_t ids[] = { 0x55, 0x56, 0x57 };
+	REQUIRE(inverterFleetInit(fleet, ids, 3));
+	for (size_t i = 0; i < 3; ++i) {
+		inverterFleetSetBacklogged(fleet, i, true);
+	}
+
+	// Slot 1 times out on every request (400ms), the others answer in 40ms.
+	uint32_t served[3] = {};
+	for (int n = 0; n < 300; ++n) {
+		const int slot = inverterFleetNextSlot(fleet);
+		REQUIRE(slot >= 0);
+		const bool slow = slot == 1;
+		inverterFleetCharge(fleet, static_cast<size_t>(slot), slow ? 400 : 40, !slow);
+		served[slot]++;
+	}
+
+	// Bus time, not transaction count, is balanced.
+	const uint32_t t0 = fleet.slots[0].busTimeMs;
+	const uint32_t t1 = fleet.slots[1].busTimeMs;
+	const uint32_t t2 = fleet.slots[2].busTimeMs;
+	const auto spread = [](uint32_t a, uint32_t b) { return a > b ? a - b : b - a; };
+	CHECK(spread(t0, t2) <= 40u);
+	CHECK(spread(t0, t1) <= 400u);
+	CHECK(served[0] > served[1] * 5);
+	CHECK(fleet.slots[1].failures == served[1]);
+	CHECK(fleet.slots[0].failures == 0);
+}
+
+TEST_CASE("inverter fleet: equal cost inverters alternate round robin")
+{
+	InverterFleet fleet;
+	const uint8_t ids[] = { 0x55, 0x56 };
+	REQUIRE(inverterFleetInit(fleet, ids, 2));
+	inverterFleetSetBacklogged(fleet, 0, true);
+	inverterFleetSetBacklogged(fleet, 1, true);
+
+	int last = -1;
+	for (int n = 0; n < 10; ++n) {
+		const int slot = inverterFleetNextSlot(fleet);
+		CHECK(slot != last);
+		inverterFleetCharge(fleet, static_cast<size_t>(slot), 0, true);
+		last = slot;
+	}
+}
+
+TEST_CASE("inverter fleet: idle inverter cannot bank credit and starve others on return")
+{
+	InverterFleet fleet;
+	const uint8_t ids[] = { 0x55, 0x56 };
+	REQUIRE(inverterFleetInit(fleet, ids, 2));
+	inverterFleetSetBacklogged(fleet, 0, true);
+
+	for (int n = 0; n < 50; ++n) {
+		CHECK(inverterFleetNextSlot(fleet) == 0);
+		inverterFleetCharge(fleet, 0, 100, true);
+	}
+	inverterFleetSetBacklogged(fleet, 1, true);
+	CHECK(fleet.slots[1].busTimeMs == fleet.slots[0].busTimeMs);
+
+	int zeroRuns = 0;
+	for (int n = 0; n < 10; ++n) {
+		const int slot = inverterFleetNextSlot(fleet);
+		inverterFleetCharge(fleet, static_cast<size_t>(slot), 100, true);
+		zeroRuns += slot == 0 ? 1 : 0;
+	}
+	CHECK(zeroRuns == 5);
+
+	inverterFleetSetBacklogged(fleet, 0, false);
+	inverterFleetSetBacklogged(fleet, 1, false);
+	CHECK(inverterFleetNextSlot(fleet) == -1);
+}
+
+TEST_CASE("inverter fleet: bus time comparison survives counter wraparound")
+{
+	InverterFleet fleet;
+	const uint8_t ids[] = { 0x55, 0x56 };
+	REQUIRE(inverterFleetInit(fleet, ids, 2));
+	fleet.slots[0].busTimeMs = 0xFFFFFF00u;
+	fleet.slots[1].busTimeMs = 0x00000010u; // wrapped past slot 0: it has more service
+	inverterFleetSetBacklogged(fleet, 0, true);
+	inverterFleetSetBacklogged(fleet, 1, true);
+	CHECK(inverterFleetNextSlot(fleet) == 0);
+}
+
+TEST_CASE("inverter fleet: each inverter gets its own HA device identifier")
+{
+	InverterFleet fleet;
+	const uint8_t ids[] = { 0x55, 0x56 };
+	REQUIRE(inverterFleetInit(fleet, ids, 2));
+
+	char id[64] = {};
+	CHECK_FALSE(inverterFleetDeviceIdentifier(fleet, 0, id, sizeof(id)));
+
+	inverterFleetSetSerial(fleet, 0, "AL2002321010043");
+	inverterFleetSetSerial(fleet, 1, "AL2002321010044");
+	REQUIRE(inverterFleetDeviceIdentifier(fleet, 0, id, sizeof(id)));
+	CHECK(std::string(id) == "alpha2mqtt_inv_AL2002321010043");
+	REQUIRE(inverterFleetDeviceIdentifier(fleet, 1, id, sizeof(id)));
+	CHECK(std::string(id) == "alpha2mqtt_inv_AL2002321010044");
+	CHECK_FALSE(inverterFleetDeviceIdentifier(fleet, 2, id, sizeof(id)));
+}
+
+namespace {
+
+// Stands in for the firmware's runInverterSlotBuckets(): identifies the slot on its first turn,
+// then reads one register per owed bucket from the emulated slave and publishes it under the
+// slot's own device.
+struct FleetPollHarness {
+	InverterFleet *fleet = nullptr;
+	uint32_t nowMs = 0;
+	uint32_t turnCostMs = 40;
+	// Slot that parks once on the deferred reply before finishing its turn (-1 = none).
+	int parkOnce = -1;
+	std::vector<std::string> published;
+};
+
+uint32_t
+harnessNow(void *context)
+{
+	return static_cast<FleetPollHarness *>(context)->nowMs;
+}
+
+uint8_t
+harnessRunSlot(void *context, size_t index, uint8_t dueBuckets, bool *ok, bool *parked)
+{
+	auto &harness = *static_cast<FleetPollHarness *>(context);
+	InverterSlot &slot = harness.fleet->slots[index];
+	const uint8_t primary = harness.fleet->slots[0].slaveId;
+	harness.nowMs += harness.turnCostMs;
+	if (harness.parkOnce == static_cast<int>(index)) {
+		harness.parkOnce = -1;
+		*parked = true;
+		return dueBuckets;
+	}
+	if (slot.serial[0] == '\0') {
+		char serial[17] = {};
+		rs485StubSerialForSlave(slot.slaveId, primary, serial, sizeof(serial));
+		inverterFleetSetSerial(*harness.fleet, index, serial);
+	}
+	for (uint8_t bucket = 0; bucket < 8; ++bucket) {
+		if ((dueBuckets & (1U << bucket)) == 0) {
+			continue;
+		}
+		char topicBase[128] = {};
+		if (!buildEntityTopicBase("Alpha2MQTT-ABCDEF",
+		                          DiscoveryDeviceScope::Inverter,
+		                          "alpha2mqtt_ctrl_ABCDEF",
+		                          slot.serial,
+		                          "Battery_SOC",
+		                          topicBase,
+		                          sizeof(topicBase))) {
+			*ok = false;
+			continue;
+		}
+		const uint16_t word = rs485StubWordForSlaveRegister(slot.slaveId, primary, 0x0102);
+		harness.published.push_back(std::string(topicBase) + "/state=" + std::to_string(word));
+	}
+	return 0;
+}
+
+} // namespace
+
+TEST_CASE("inverter fleet: poll turns run every due inverter under its own device")
+{
+	InverterFleet fleet;
+	const uint8_t ids[] = { 0x55, 0x56 };
+	REQUIRE(inverterFleetInit(fleet, ids, 2));
+	FleetPollHarness harness;
+	harness.fleet = &fleet;
+	InverterFleetPollHooks hooks;
+	hooks.context = &harness;
+	hooks.runSlot = harnessRunSlot;
+	hooks.nowMs = harnessNow;
+
+	CHECK(inverterFleetPollTurn(fleet, hooks) == -1);
+	CHECK_FALSE(inverterFleetHasWork(fleet));
+
+	// TenSec and User come due together: both inverters owe both buckets.
+	inverterFleetMarkDue(fleet, 0x21);
+	CHECK(inverterFleetHasWork(fleet));
+	const int first = inverterFleetPollTurn(fleet, hooks);
+	const int second = inverterFleetPollTurn(fleet, hooks);
+	CHECK(first != second);
+	CHECK(inverterFleetPollTurn(fleet, hooks) == -1);
+	CHECK_FALSE(inverterFleetHasWork(fleet));
+
+	REQUIRE(harness.published.size() == 4);
+	std::vector<std::string> primaryTopics;
+	std::vector<std::string> secondaryTopics;
+	for (const std::string &line : harness.published) {
+		if (line.find("/alpha2mqtt_inv_STUBSN000000000/") != std::string::npos) {
+			primaryTopics.push_back(line);
+		} else if (line.find("/alpha2mqtt_inv_STUBSN000000086/") != std::string::npos) {
+			secondaryTopics.push_back(line);
+		}
+	}
+	CHECK(primaryTopics.size() == 2);
+	CHECK(secondaryTopics.size() == 2);
+	CHECK(primaryTopics[0] != secondaryTopics[0]);
+	CHECK(fleet.slots[0].transactions == 1);
+	CHECK(fleet.slots[1].transactions == 1);
+	CHECK(fleet.slots[0].busTimeMs == 40);
+	CHECK(fleet.slots[1].busTimeMs == 40);
+
+	char deviceId[64] = {};
+	REQUIRE(inverterFleetDeviceIdentifier(fleet, 1, deviceId, sizeof(deviceId)));
+	CHECK(std::string(deviceId) == "alpha2mqtt_inv_STUBSN000000086");
+}
+
+TEST_CASE("inverter fleet: a parked turn resumes on the same inverter and is charged once")
+{
+	InverterFleet fleet;
+	const uint8_t ids[] = { 0x55, 0x56 };
+	REQUIRE(inverterFleetInit(fleet, ids, 2));
+	FleetPollHarness harness;
+	harness.fleet = &fleet;
+	harness.parkOnce = 0;
+	InverterFleetPollHooks hooks;
+	hooks.context = &harness;
+	hooks.runSlot = harnessRunSlot;
+	hooks.nowMs = harnessNow;
+
+	inverterFleetMarkDue(fleet, 0x01);
+	REQUIRE(inverterFleetPollTurn(fleet, hooks) == 0);
+	CHECK(fleet.parkedSlot == 0);
+	CHECK(fleet.slots[0].transactions == 0);
+	CHECK(harness.published.empty());
+
+	// Slot 1 would win the tie-break, but the parked pass owns the bus until it finishes.
+	CHECK(inverterFleetPollTurn(fleet, hooks) == 0);
+	CHECK(fleet.parkedSlot == -1);
+	CHECK(fleet.slots[0].transactions == 1);
+	CHECK(fleet.slots[0].busTimeMs == 80);
+	CHECK(inverterFleetPollTurn(fleet, hooks) == 1);
+	CHECK(harness.published.size() == 2);
+
+	// Clearing owed work forgets a parked turn too.
+	inverterFleetMarkDue(fleet, 0x01);
+	harness.parkOnce = 1;
+	inverterFleetPollTurn(fleet, hooks);
+	inverterFleetPollTurn(fleet, hooks);
+	inverterFleetClearDue(fleet);
+	CHECK_FALSE(inverterFleetHasWork(fleet));
+	CHECK(inverterFleetPollTurn(fleet, hooks) == -1);
+}
@@ -0,0 +1,100 @@
+#include <doctest/doctest.h>
+
+#include <string>
+
+#include "MemoryGovernor.h"
+
+TEST_CASE("memory governor: policy table degrades monotonically with pressure")
+{
+	const MemGovernorPolicy &ok = memGovernorPolicyFor(MemLevel::Ok);
+	const MemGovernorPolicy &warn = memGovernorPolicyFor(MemLevel::Warn);
+	const MemGovernorPolicy &crit = memGovernorPolicyFor(MemLevel::Crit);
+
+	// Ok is the ungoverned behaviour.
+	CHECK(ok.pollingConfigChunkMax == 1024);
+	CHECK(ok.discoveryGapMs == 0);
+	CHECK_FALSE(ok.deferPlanRebuild);
+	CHECK_FALSE(ok.compactStatus);
+	CHECK_FALSE(ok.pauseDiagnostics);
+	CHECK_FALSE(ok.shedLowPriority);
+
+	CHECK(warn.pollingConfigChunkMax < ok.pollingConfigChunkMax);
+	CHECK(crit.pollingConfigChunkMax < warn.pollingConfigChunkMax);
+	CHECK(warn.discoveryGapMs > ok.discoveryGapMs);
+	CHECK(crit.discoveryGapMs > warn.discoveryGapMs);
+	CHECK(warn.compactStatus);
+	CHECK(warn.pauseDiagnostics);
+	CHECK_FALSE(warn.deferPlanRebuild);
+	CHECK_FALSE(warn.shedLowPriority);
+	CHECK(crit.compactStatus);
+	CHECK(crit.pauseDiagnostics);
+	CHECK(crit.deferPlanRebuild);
+	CHECK(crit.shedLowPriority);
+}
+
+TEST_CASE("memory governor: escalates at once and relaxes one level after calm samples")
+{
+	MemGovernor gov{};
+	CHECK_FALSE(memGovernorSample(gov, MemLevel::Ok, 0));
+
+	CHECK(memGovernorSample(gov, MemLevel::Crit, 1000));
+	CHECK(gov.level == MemLevel::Crit);
+	CHECK(memGovernorPolicy(gov).shedLowPriority);
+
+	// A single calm sample is not enough, and a relapse restarts the count.
+	CHECK_FALSE(memGovernorSample(gov, MemLevel::Ok, 2000));
+	CHECK_FALSE(memGovernorSample(gov, MemLevel::Ok, 3000));
+	CHECK_FALSE(memGovernorSample(gov, MemLevel::Crit, 4000));
+	for (uint32_t i = 1; i < kMemGovernorRelaxSamples; ++i) {
+		CHECK_FALSE(memGovernorSample(gov, MemLevel::Ok, 4000 + i * 1000));
+	}
+	CHECK(memGovernorSample(gov, MemLevel::Ok, 9000));
+	// Steps down through Warn rather than jumping straight to Ok.
+	CHECK(gov.level == MemLevel::Warn);
+	for (uint32_t i = 1; i < kMemGovernorRelaxSamples; ++i) {
+		CHECK_FALSE(memGovernorSample(gov, MemLevel::Ok, 9000 + i * 1000));
+	}
+	CHECK(memGovernorSample(gov, MemLevel::Ok, 12000));
+	CHECK(gov.level == MemLevel::Ok);
+
+	CHECK(gov.counts[static_cast<size_t>(MemGovernorDecision::Escalate)] == 1);
+	CHECK(gov.counts[static_cast<size_t>(MemGovernorDecision::Relax)] == 2);
+}
+
+TEST_CASE("memory governor: decisions are counted and logged once per episode")
+{
+	MemGovernor gov{};
+	memGovernorSample(gov, MemLevel::Warn, 100);
+	memGovernorNote(gov, MemGovernorDecision::CompactStatus, 200);
+	memGovernorNote(gov, MemGovernorDecision::CompactStatus, 300);
+	memGovernorNote(gov, MemGovernorDecision::PauseDiagnostics, 300);
+	CHECK(gov.counts[static_cast<size_t>(MemGovernorDecision::CompactStatus)] == 2);
+	CHECK(gov.eventCount == 3);
+
+	memGovernorSample(gov, MemLevel::Crit, 400);
+	for (int i = 0; i < 20; ++i) {
+		memGovernorNote(gov, MemGovernorDecision::ShedPublish, 500);
+	}
+	// A new episode logs CompactStatus again; shedding 20 publishes logs one event.
+	memGovernorNote(gov, MemGovernorDecision::CompactStatus, 600);
+	CHECK(gov.counts[static_cast<size_t>(MemGovernorDecision::ShedPublish)] == 20);
+	CHECK(gov.eventCount == 6);
+
+	char json[768];
+	REQUIRE(buildMemGovernorJson(gov, json, sizeof(json)));
+	const std::string text(json);
+	CHECK(text.find("\"level\":\"crit\"") != std::string::npos);
+	CHECK(text.find("\"shed_publish\":20") != std::string::npos);
+	CHECK(text.find("{\"at_ms\":100,\"decision\":\"escalate\",\"level\":\"warn\"}") == text.find("[{") + 1);
+	CHECK(text.find("{\"at_ms\":600,\"decision\":\"compact_status\",\"level\":\"crit\"}") != std::string::npos);
+
+	// The log keeps the newest events only.
+	for (uint32_t i = 0; i < kMemGovernorEventLogSize; ++i) {
+		memGovernorSample(gov, (i % 2 == 0) ? MemLevel::Ok : MemLevel::Crit, 1000 + i);
+		memGovernorSample(gov, MemLevel::Ok, 1000 + i);
+		memGovernorSample(gov, MemLevel::Ok, 1000 + i);
+	}
+	REQUIRE(buildMemGovernorJson(gov, json, sizeof(json)));
+	CHECK(std::string(json).find("\"at_ms\":100,") == std::string::npos);
+	CHECK_FALSE(buildMemGovernorJson(gov, json, 32));
+}
@@ -0,0 +1,316 @@
+#include <doctest/doctest.h>
+
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "MetricLog.h"
+
+namespace {
+
+class MemoryMetricLogStore : public MetricLogStore {
+public:
+	std::map<uint32_t, std::vector<uint8_t>> segments;
+	uint32_t blockWrites = 0;
+	bool failWrites = false;
+
+	size_t
+	listSegments(uint32_t *ids, size_t maxIds) override
+	{
+		size_t n = 0;
+		for (const auto &entry : segments) {
+			if (n < maxIds) {
+				ids[n++] = entry.first;
+			}
+		}
+		return n;
+	}
+
+	uint16_t
+	blockCount(uint32_t segmentId) override
+	{
+		auto it = segments.find(segmentId);
+		return it == segments.end() ? 0 : static_cast<uint16_t>(it->second.size() / kMetricLogBlockBytes);
+	}
+
+	bool
+	readBlock(uint32_t segmentId, uint16_t blockIndex, uint8_t *out, size_t len) override
+	{
+		auto it = segments.find(segmentId);
+		const size_t offset = static_cast<size_t>(blockIndex) * kMetricLogBlockBytes;
+		if (it == segments.end() || offset + len > it->second.size()) {
+			return false;
+		}
+		memcpy(out, it->second.data() + offset, len);
+		return true;
+	}
+
+	bool
+	appendBlock(uint32_t segmentId, const uint8_t *block) override
+	{
+		if (failWrites) {
+			return false;
+		}
+		std::vector<uint8_t> &bytes = segments[segmentId];
+		bytes.insert(bytes.end(), block, block + kMetricLogBlockBytes);
+		blockWrites++;
+		return true;
+	}
+
+	bool
+	removeSegment(uint32_t segmentId) override
+	{
+		return segments.erase(segmentId) > 0;
+	}
+
+	size_t
+	totalBytes() const
+	{
+		size_t bytes = 0;
+		for (const auto &entry : segments) {
+			bytes += entry.second.size();
+		}
+		return bytes;
+	}
+};
+
+bool
+collect(void *ctx, const MetricLogRecord &record)
+{
+	static_cast<std::vector<MetricLogRecord> *>(ctx)->push_back(record);
+	return true;
+}
+
+bool
+sameRecord(const MetricLogRecord &a, const MetricLogRecord &b)
+{
+	return a.timeS == b.timeS && memcmp(a.values, b.values, sizeof(a.values)) == 0;
+}
+
+// A plausible day: PV bell curve, noisy house load, battery covering the difference, rising counters.
+MetricLogRecord
+syntheticRecord(uint32_t minute, MetricLogRecord &counters)
+{
+	const double dayPhase = static_cast<double>(minute % 1440) / 1440.0;
+	const double sun = std::max(0.0, std::sin((dayPhase - 0.25) * 2.0 * M_PI));
+	const int32_t pv = static_cast<int32_t>(sun * 4200.0) / 10 * 10;
+	const int32_t load = 350 + static_cast<int32_t>((minute * 7919U) % 400U);
+	const int32_t battery = (minute % 1440 < 360) ? 0 : std::min(3000, load - pv);
+	const int32_t grid = load - pv - battery;
+
+	MetricLogRecord record{};
+	record.timeS = 1767225600U + minute * 60U;
+	record.values[0] = battery * 1000;
+	record.values[1] = grid * 1000;
+	record.values[2] = pv * 1000;
+	record.values[3] = (50000 + static_cast<int32_t>(sun * 40000.0)) / 1000 * 1000;
+	if (minute % 6 == 0) {
+		// Energy registers move in 0.1 kWh steps a few times per hour.
+		counters.values[4] += battery < 0 ? 100 : 0;
+		counters.values[5] += battery > 0 ? 100 : 0;
+		counters.values[6] += grid < 0 ? 100 : 0;
+		counters.values[7] += grid > 0 ? 100 : 0;
+		counters.values[8] += pv > 0 ? 100 : 0;
+	}
+	for (size_t ch = 4; ch < kMetricLogChannels; ++ch) {
+		record.values[ch] = counters.values[ch];
+	}
+	return record;
+}
+
+MetricLogRecord
+flatRecord(uint32_t timeS, int32_t value)
+{
+	MetricLogRecord record{};
+	record.timeS = timeS;
+	for (size_t ch = 0; ch < kMetricLogChannels; ++ch) {
+		record.values[ch] = value + static_cast<int32_t>(ch);
+	}
+	return record;
+}
+
+} // namespace
+
+TEST_CASE("metric log: a block round-trips records including extreme values and irregular gaps")
+{
+	uint8_t block[kMetricLogBlockBytes];
+	std::vector<MetricLogRecord> expected;
+	MetricLogRecord first = flatRecord(1000, 0);
+	first.values[3] = kMetricLogNoValue;
+	metricLogBlockBegin(block, 60, first);
+	expected.push_back(first);
+
+	const int32_t swings[] = { INT32_MAX, INT32_MIN, 0, -1, 12345 };
+	uint32_t timeS = 1000;
+	for (int i = 0; i < 5; ++i) {
+		MetricLogRecord next = expected.back();
+		timeS += (i == 2) ? 3600 : 59 + i;
+		next.timeS = timeS;
+		next.values[i] = swings[i];
+		next.values[8] = swings[4 - i];
+		REQUIRE(metricLogBlockAppend(block, next));
+		expected.push_back(next);
+	}
+	// Not newer than the last record.
+	CHECK_FALSE(metricLogBlockAppend(block, flatRecord(timeS, 0)));
+
+	CHECK(metricLogBlockValid(block));
+	MetricLogBlockHeader header;
+	REQUIRE(metricLogBlockHeader(block, sizeof(block), &header));
+	CHECK(header.count == expected.size());
+	CHECK(header.firstTimeS == 1000);
+	CHECK(header.lastTimeS == timeS);
+
+	std::vector<MetricLogRecord> decoded;
+	CHECK(metricLogBlockDecode(block, 0, UINT32_MAX, collect, &decoded));
+	REQUIRE(decoded.size() == expected.size());
+	for (size_t i = 0; i < expected.size(); ++i) {
+		CHECK(sameRecord(decoded[i], expected[i]));
+	}
+
+	decoded.clear();
+	metricLogBlockDecode(block, expected[2].timeS, expected[3].timeS, collect, &decoded);
+	REQUIRE(decoded.size() == 2);
+	CHECK(sameRecord(decoded[0], expected[2]));
+
+	block[kMetricLogHeaderBytes + 1] ^= 0x40;
+	CHECK_FALSE(metricLogBlockValid(block));
+}
+
+TEST_CASE("metric log: unchanged channels cost one mask byte and on-interval times one byte")
+{
+	uint8_t block[kMetricLogBlockBytes];
+	metricLogBlockBegin(block, 60, flatRecord(5000, 100));
+	uint32_t appended = 1;
+	while (metricLogBlockAppend(block, flatRecord(5000 + appended * 60, 100))) {
+		appended++;
+	}
+	MetricLogBlockHeader header;
+	REQUIRE(metricLogBlockHeader(block, sizeof(block), &header));
+	CHECK(header.count == appended);
+	CHECK(header.used == kMetricLogHeaderBytes + (appended - 1) * 2);
+}
+
+TEST_CASE("metric log: the log rotates whole segments and reopens its index after a reboot")
+{
+	MemoryMetricLogStore store;
+	const MetricLogConfig config{ 60, 2, 3 };
+	auto log = std::make_unique<MetricLog>();
+	REQUIRE(metricLogOpen(*log, store, config));
+
+	uint32_t timeS = 100000;
+	for (int i = 0; i < 2000; ++i) {
+		timeS += 60;
+		metricLogAppend(*log, store, flatRecord(timeS, i * 1000));
+	}
+	CHECK(store.segments.size() == 3);
+	CHECK(log->stats.segmentsRotated > 0);
+	for (const auto &entry : store.segments) {
+		CHECK(entry.second.size() <= 2 * kMetricLogBlockBytes);
+	}
+	CHECK_FALSE(metricLogAppend(*log, store, flatRecord(timeS, 0)));
+	CHECK(log->stats.rejected == 1);
+
+	// Everything still stored plus the unwritten block comes back in order, newest last.
+	std::vector<MetricLogRecord> all;
+	metricLogQuery(*log, store, 0, UINT32_MAX, collect, &all);
+	REQUIRE(!all.empty());
+	CHECK(all.front().timeS == metricLogFirstTimeS(*log));
+	CHECK(all.back().timeS == timeS);
+	for (size_t i = 1; i < all.size(); ++i) {
+		REQUIRE(all[i].timeS == all[i - 1].timeS + 60);
+	}
+
+	REQUIRE(metricLogFlush(*log, store));
+	const size_t stored = all.size();
+	auto reopened = std::make_unique<MetricLog>();
+	REQUIRE(metricLogOpen(*reopened, store, config));
+	CHECK(reopened->segmentCount == log->segmentCount);
+	CHECK(reopened->lastTimeS == timeS);
+	CHECK_FALSE(metricLogAppend(*reopened, store, flatRecord(timeS, 0)));
+	std::vector<MetricLogRecord> after;
+	metricLogQuery(*reopened, store, 0, UINT32_MAX, collect, &after);
+	CHECK(after.size() == stored);
+}
+
+TEST_CASE("metric log: a torn final block and failed writes lose only their own records")
+{
+	MemoryMetricLogStore store;
+	const MetricLogConfig config{ 60, 8, 4 };
+	auto log = std::make_unique<MetricLog>();
+	metricLogOpen(*log, store, config);
+	uint32_t timeS = 0;
+	while (log->stats.blocksWritten < 3) {
+		timeS += 60;
+		metricLogAppend(*log, store, flatRecord(timeS, static_cast<int32_t>(timeS)));
+	}
+	std::vector<uint8_t> &bytes = store.segments.begin()->second;
+	memset(bytes.data() + 2 * kMetricLogBlockBytes, 0xFF, kMetricLogBlockBytes);
+
+	auto reopened = std::make_unique<MetricLog>();
+	REQUIRE(metricLogOpen(*reopened, store, config));
+	std::vector<MetricLogRecord> survivors;
+	metricLogQuery(*reopened, store, 0, UINT32_MAX, collect, &survivors);
+	REQUIRE(!survivors.empty());
+	CHECK(survivors.front().timeS == 60);
+	CHECK(reopened->lastTimeS == survivors.back().timeS);
+
+	store.failWrites = true;
+	const uint32_t writesBefore = store.blockWrites;
+	while (reopened->stats.writeFailures == 0) {
+		timeS += 60;
+		metricLogAppend(*reopened, store, flatRecord(timeS, 7));
+	}
+	CHECK(store.blockWrites == writesBefore);
+	store.failWrites = false;
+	timeS += 60;
+	CHECK(metricLogAppend(*reopened, store, flatRecord(timeS, 8)));
+}
+
+TEST_CASE("metric log: a synthetic month stays compact and range seeks read O(log n) headers")
+{
+	MemoryMetricLogStore store;
+	const MetricLogConfig config{ 60, 64, kMetricLogMaxSegments };
+	auto log = std::make_unique<MetricLog>();
+	REQUIRE(metricLogOpen(*log, store, config));
+
+	const uint32_t minutes = 30U * 1440U;
+	MetricLogRecord counters{};
+	std::vector<MetricLogRecord> month;
+	month.reserve(minutes);
+	for (uint32_t minute = 0; minute < minutes; ++minute) {
+		month.push_back(syntheticRecord(minute, counters));
+		REQUIRE(metricLogAppend(*log, store, month.back()));
+	}
+	REQUIRE(metricLogFlush(*log, store));
+	CHECK(log->stats.segmentsRotated == 0);
+
+	const double bytesPerSample = static_cast<double>(store.totalBytes()) / minutes;
+	const double rawBytesPerSample = sizeof(uint32_t) + sizeof(int32_t) * kMetricLogChannels;
+	MESSAGE("synthetic month: " << minutes << " records in " << store.totalBytes() << " bytes, " << bytesPerSample
+	                            << " bytes/sample (raw " << rawBytesPerSample << ")");
+	CHECK(bytesPerSample * 3 < rawBytesPerSample);
+
+	const auto started = std::chrono::steady_clock::now();
+	uint32_t seekReads = 0;
+	const int queries = 200;
+	for (int q = 0; q < queries; ++q) {
+		const uint32_t startMinute = static_cast<uint32_t>((q * 7417) % (minutes - 60));
+		std::vector<MetricLogRecord> hour;
+		log->stats.blocksRead = 0;
+		metricLogQuery(*log, store, month[startMinute].timeS, month[startMinute + 59].timeS, collect, &hour);
+		seekReads = std::max(seekReads, log->stats.blocksRead);
+		REQUIRE(hour.size() == 60);
+		CHECK(sameRecord(hour.front(), month[startMinute]));
+		CHECK(sameRecord(hour.back(), month[startMinute + 59]));
+	}
+	const auto elapsedUs =
+		std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - started).count();
+	MESSAGE("one-hour range query: " << (elapsedUs / queries) << " us avg, at most " << seekReads
+	                                 << " block reads across " << log->segmentCount << " segments");
+	// log2(64) header probes plus the few blocks an hour spans.
+	CHECK(seekReads <= 6 + 4);
+}
@@ -8,6 +8,7 @@
 
 #include <doctest/doctest.h>
 
+#include "AllocProfiler.h"
 #include "BucketScheduler.h"
 #include "MqttEntities.h"
 
@@ -600,3 +601,86 @@ TEST_CASE("mqtt entities: State_of_Charge can move from one_min to ten_sec")
 
 	REQUIRE(mqttEntityCanApplyBuckets(preview, kMqttEntityDescriptorCount));
 }
+
+TEST_CASE("mqtt entities: a plan rebuild is one right-sized allocation")
+{
+	initMqttEntitiesRtIfNeeded(true);
+	REQUIRE(mqttActivePlan() != nullptr);
+	BucketId buckets[kMqttEntityDescriptorCount]{};
+	REQUIRE(mqttEntityCopyBuckets(buckets, kMqttEntityDescriptorCount));
+	for (size_t i = 0; i < kMqttEntityDescriptorCount; i += 5) {
+		buckets[i] = BucketId::User;
+	}
+
+	{
+		AllocWindow window;
+		REQUIRE(mqttEntityApplyBuckets(buckets, kMqttEntityDescriptorCount));
+		CHECK(window.allocs() == 1);
+		CHECK(window.allocBytes() == mqttActivePlanStorageBytes());
+		// The previous plan goes back as one block too.
+		CHECK(window.frees() == 1);
+	}
+	{
+		AllocWindow window;
+		REQUIRE(mqttEntityCanApplyBuckets(buckets, kMqttEntityDescriptorCount));
+		CHECK(window.allocs() == 1);
+		CHECK(window.frees() == 1);
+	}
+
+	const MqttEntityActivePlan *plan = mqttActivePlan();
+	REQUIRE(plan != nullptr);
+	bool anyOverride = false;
+	for (size_t i = 0; i < kMqttEntityDescriptorCount; ++i) {
+		mqttState entity{};
+		REQUIRE(mqttEntityCopyByIndex(i, &entity));
+		if (entity.updateFreq == mqttUpdateFreq::freqNever || buckets[i] != bucketIdFromFreq(entity.updateFreq)) {
+			anyOverride = true;
+		}
+	}
+	// Overrides are one packed map (three bits per entity) ahead of the transactions.
+	size_t expected = anyOverride ? packedBucketMapBytes(kMqttEntityDescriptorCount) : 0;
+	expected = (expected + alignof(MqttPollTransaction) - 1) / alignof(MqttPollTransaction) * alignof(MqttPollTransaction);
+	const MqttEntityActiveBucket *planBuckets[] = { &plan->tenSec, &plan->oneMin, &plan->fiveMin,
+		                                            &plan->oneHour, &plan->oneDay, &plan->user };
+	for (const MqttEntityActiveBucket *bucket : planBuckets) {
+		expected += bucket->transactionCount * sizeof(MqttPollTransaction) + bucket->count * sizeof(uint16_t);
+		for (size_t t = 0; t < bucket->transactionCount; ++t) {
+			const MqttPollTransaction &txn = bucket->transactions[t];
+			REQUIRE(txn.firstMemberOffset + txn.entityCount <= bucket->count);
+			for (size_t m = 0; m < txn.entityCount; ++m) {
+				CHECK(mqttEntityBucketByIndex(bucket->members[txn.firstMemberOffset + m]) != BucketId::Disabled);
+			}
+		}
+	}
+	CHECK(mqttActivePlanStorageBytes() == expected);
+	CHECK(plan->user.count >= kMqttEntityDescriptorCount / 5);
+}
+
+TEST_CASE("mqtt entities: a packed bucket snapshot rolls back an applied change")
+{
+	initMqttEntitiesRtIfNeeded(true);
+	REQUIRE(mqttActivePlan() != nullptr);
+	BucketId original[kMqttEntityDescriptorCount]{};
+	REQUIRE(mqttEntityCopyBuckets(original, kMqttEntityDescriptorCount));
+
+	uint8_t snapshot[kMqttEntityBucketSnapshotBytes];
+	CHECK(sizeof(snapshot) * 2 < sizeof(original));
+	CHECK_FALSE(mqttEntitySaveBucketSnapshot(snapshot, sizeof(snapshot) - 1));
+	REQUIRE(mqttEntitySaveBucketSnapshot(snapshot, sizeof(snapshot)));
+
+	BucketId changed[kMqttEntityDescriptorCount]{};
+	std::memcpy(changed, original, sizeof(changed));
+	for (size_t i = 0; i < kMqttEntityDescriptorCount; i += 3) {
+		changed[i] = (original[i] == BucketId::User) ? BucketId::OneDay : BucketId::User;
+	}
+	REQUIRE(mqttEntityApplyBuckets(changed, kMqttEntityDescriptorCount));
+	CHECK(mqttEntityBucketByIndex(0) == changed[0]);
+
+	REQUIRE(mqttEntityRestoreBucketSnapshot(snapshot, sizeof(snapshot)));
+	BucketId restored[kMqttEntityDescriptorCount]{};
+	REQUIRE(mqttEntityCopyBuckets(restored, kMqttEntityDescriptorCount));
+	for (size_t i = 0; i < kMqttEntityDescriptorCount; ++i) {
+		CAPTURE(i);
+		CHECK(restored[i] == original[i]);
+	}
+}
@@ -0,0 +1,243 @@
+#include <doctest/doctest.h>
+
+#include <cstdio>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "MqttOutboundQueue.h"
+
+namespace {
+
+struct SentMessage {
+	uint16_t key;
+	std::string payload;
+	bool retain;
+};
+
+// Models a congested link: accepts only `budget` messages per drain call.
+struct SlowSink {
+	std::vector<SentMessage> sent;
+	size_t budget = 0;
+};
+
+bool
+slowSink(void *ctx, uint16_t key, const char *payload, bool retain)
+{
+	auto *sink = static_cast<SlowSink *>(ctx);
+	if (sink->budget == 0) {
+		return false;
+	}
+	sink->budget--;
+	sink->sent.push_back({ key, payload, retain });
+	return true;
+}
+
+} // namespace
+
+TEST_CASE("mqtt outbound: token bucket refills at the configured rate")
+{
+	MqttTokenBucket bucket;
+	tokenBucketInit(bucket, 10, 2, 1000);
+	CHECK(tokenBucketTryTake(bucket, 1000));
+	CHECK(tokenBucketTryTake(bucket, 1000));
+	CHECK_FALSE(tokenBucketTryTake(bucket, 1000));
+	CHECK(tokenBucketMsUntilToken(bucket, 1000) == 100);
+	CHECK(tokenBucketMsUntilToken(bucket, 1060) == 40);
+	CHECK(tokenBucketTryTake(bucket, 1100));
+	// A long idle period only refills up to the burst size.
+	CHECK(tokenBucketTryTake(bucket, 60000));
+	CHECK(tokenBucketTryTake(bucket, 60000));
+	CHECK_FALSE(tokenBucketTryTake(bucket, 60000));
+
+	MqttTokenBucket unlimited;
+	tokenBucketInit(unlimited, 0, 1, 0);
+	for (int i = 0; i < 100; ++i) {
+		CHECK(tokenBucketTryTake(unlimited, 0));
+	}
+	CHECK(tokenBucketMsUntilToken(unlimited, 0) == 0);
+}
+
+TEST_CASE("mqtt outbound: newer values replace unsent ones in place")
+{
+	MqttOutboundQueue queue;
+	mqttOutboundInit(queue, 0, 1, 0);
+	CHECK(mqttOutboundEnqueue(queue, 1, MqttOutboundClass::Telemetry, "10", false) == MqttOutboundEnqueue::Queued);
+	CHECK(mqttOutboundEnqueue(queue, 2, MqttOutboundClass::Telemetry, "20", false) == MqttOutboundEnqueue::Queued);
+	CHECK(mqttOutboundEnqueue(queue, 1, MqttOutboundClass::Telemetry, "11", true) == MqttOutboundEnqueue::Coalesced);
+	CHECK(queue.stats.depth == 2);
+	CHECK(queue.stats.coalesced == 1);
+
+	SlowSink sink;
+	sink.budget = 10;
+	CHECK(mqttOutboundDrain(queue, 0, 10, slowSink, &sink) == 2);
+	REQUIRE(sink.sent.size() == 2);
+	// Key 1 keeps its original position ahead of key 2 but carries the latest value.
+	CHECK(sink.sent[0].key == 1);
+	CHECK(sink.sent[0].payload == "11");
+	CHECK(sink.sent[0].retain);
+	CHECK(sink.sent[1].key == 2);
+	CHECK(queue.stats.depth == 0);
+	CHECK(queue.stats.sent == 2);
+}
+
+TEST_CASE("mqtt outbound: higher classes drain first, FIFO within a class")
+{
+	MqttOutboundQueue queue;
+	mqttOutboundInit(queue, 0, 1, 0);
+	mqttOutboundEnqueue(queue, 1, MqttOutboundClass::Diagnostics, "d", false);
+	mqttOutboundEnqueue(queue, 2, MqttOutboundClass::Telemetry, "t1", false);
+	mqttOutboundEnqueue(queue, 3, MqttOutboundClass::Telemetry, "t2", false);
+	mqttOutboundEnqueue(queue, 4, MqttOutboundClass::Dispatch, "x", false);
+
+	SlowSink sink;
+	sink.budget = 10;
+	mqttOutboundDrain(queue, 0, 10, slowSink, &sink);
+	REQUIRE(sink.sent.size() == 4);
+	CHECK(sink.sent[0].key == 4);
+	CHECK(sink.sent[1].key == 2);
+	CHECK(sink.sent[2].key == 3);
+	CHECK(sink.sent[3].key == 1);
+}
+
+TEST_CASE("mqtt outbound: a full queue evicts lower classes and rejects otherwise")
+{
+	MqttOutboundQueue queue;
+	mqttOutboundInit(queue, 0, 1, 0);
+	for (uint16_t key = 0; key < kMqttOutboundSlots; ++key) {
+		const MqttOutboundClass cls = (key == 5) ? MqttOutboundClass::Diagnostics : MqttOutboundClass::Telemetry;
+		REQUIRE(mqttOutboundEnqueue(queue, key, cls, "1", false) == MqttOutboundEnqueue::Queued);
+	}
+	CHECK(queue.stats.maxDepth == kMqttOutboundSlots);
+
+	CHECK(mqttOutboundEnqueue(queue, 100, MqttOutboundClass::Telemetry, "1", false) ==
+	      MqttOutboundEnqueue::QueuedWithEviction);
+	CHECK(queue.stats.dropped == 1);
+	// Nothing below Telemetry is left, so another Telemetry value is rejected...
+	CHECK(mqttOutboundEnqueue(queue, 101, MqttOutboundClass::Telemetry, "1", false) == MqttOutboundEnqueue::Rejected);
+	// ...but dispatch values still get in.
+	CHECK(mqttOutboundEnqueue(queue, 102, MqttOutboundClass::Dispatch, "1", false) ==
+	      MqttOutboundEnqueue::QueuedWithEviction);
+	CHECK(queue.stats.rejected == 1);
+	CHECK(queue.stats.depth == kMqttOutboundSlots);
+
+	const std::string tooLong(kMqttOutboundPayloadMax, 'x');
+	CHECK(mqttOutboundEnqueue(queue, 5, MqttOutboundClass::Dispatch, tooLong.c_str(), false) ==
+	      MqttOutboundEnqueue::Rejected);
+	CHECK(mqttOutboundEnqueue(queue, 6, MqttOutboundClass::Dispatch, nullptr, false) == MqttOutboundEnqueue::Rejected);
+
+	mqttOutboundClear(queue);
+	CHECK(queue.stats.depth == 0);
+	CHECK(queue.stats.dropped == 2 + kMqttOutboundSlots);
+}
+
+TEST_CASE("mqtt outbound: an identity change drops values queued for the old inverter")
+{
+	MqttOutboundQueue queue;
+	mqttOutboundInit(queue, 10, 10, 0);
+	CHECK(mqttOutboundSetIdentity(queue, "AL2002321010043") == 0);
+	REQUIRE(mqttOutboundEnqueue(queue, 1, MqttOutboundClass::Telemetry, "57.4", false) ==
+	        MqttOutboundEnqueue::Queued);
+	REQUIRE(mqttOutboundEnqueue(queue, 2, MqttOutboundClass::Dispatch, "1", false) == MqttOutboundEnqueue::Queued);
+
+	// Re-confirming the same serial keeps the backlog.
+	CHECK(mqttOutboundSetIdentity(queue, "AL2002321010043") == 0);
+	CHECK(queue.stats.depth == 2);
+
+	// Identity cleared (e.g. rediscovery): nothing queued may reach whichever inverter comes next.
+	CHECK(mqttOutboundSetIdentity(queue, nullptr) == 2);
+	CHECK(queue.stats.depth == 0);
+	CHECK(queue.stats.dropped == 2);
+
+	REQUIRE(mqttOutboundEnqueue(queue, 1, MqttOutboundClass::Telemetry, "12.0", false) ==
+	        MqttOutboundEnqueue::Queued);
+	// A different inverter answers: the value produced before the switch is dropped, not sent.
+	CHECK(mqttOutboundSetIdentity(queue, "AL2002321010099") == 1);
+	REQUIRE(mqttOutboundEnqueue(queue, 3, MqttOutboundClass::Telemetry, "99.9", false) ==
+	        MqttOutboundEnqueue::Queued);
+
+	SlowSink sink;
+	sink.budget = 10;
+	CHECK(mqttOutboundDrain(queue, 0, 10, slowSink, &sink) == 1);
+	REQUIRE(sink.sent.size() == 1);
+	CHECK(sink.sent[0].key == 3);
+	CHECK(sink.sent[0].payload == "99.9");
+}
+
+TEST_CASE("mqtt outbound: slow sink coalesces bursts instead of growing the backlog")
+{
+	MqttOutboundQueue queue;
+	mqttOutboundInit(queue, 20, 4, 0);
+	SlowSink sink;
+	constexpr uint16_t kEntities = 12;
+	std::map<uint16_t, std::string> latest;
+
+	// Each 100 ms tick produces a value for every entity, but the link only takes 2 messages per tick.
+	for (uint32_t tick = 0; tick < 50; ++tick) {
+		const uint32_t nowMs = tick * 100;
+		for (uint16_t key = 0; key < kEntities; ++key) {
+			char value[16];
+			snprintf(value, sizeof(value), "%u", static_cast<unsigned>(tick * 100 + key));
+			mqttOutboundEnqueue(queue, key, MqttOutboundClass::Telemetry, value, false);
+			latest[key] = value;
+		}
+		sink.budget = 2;
+		mqttOutboundDrain(queue, nowMs, 8, slowSink, &sink);
+		CHECK(queue.stats.depth <= kEntities);
+	}
+	CHECK(queue.stats.rejected == 0);
+	CHECK(queue.stats.dropped == 0);
+	CHECK(queue.stats.maxDepth == kEntities);
+	CHECK(queue.stats.coalesced > 400);
+	CHECK(queue.stats.sendFailures > 0);
+
+	// Once the link recovers, each pending entity's newest value is flushed exactly once.
+	const size_t backlog = queue.stats.depth;
+	CHECK(backlog > 0);
+	sink.sent.clear();
+	sink.budget = 100;
+	uint32_t nowMs = 5000;
+	while (queue.stats.depth > 0 && nowMs < 10000) {
+		mqttOutboundDrain(queue, nowMs, 100, slowSink, &sink);
+		nowMs += mqttOutboundMsUntilSend(queue, nowMs, 1000);
+	}
+	CHECK(sink.sent.size() == backlog);
+	for (const SentMessage &msg : sink.sent) {
+		CHECK(msg.payload == latest[msg.key]);
+	}
+	CHECK(mqttOutboundMsUntilSend(queue, nowMs, 1234) == 1234);
+}
+
+TEST_CASE("mqtt outbound: shaper limits the send rate and is refunded on sink failure")
+{
+	MqttOutboundQueue queue;
+	mqttOutboundInit(queue, 10, 2, 0);
+	for (uint16_t key = 0; key < 6; ++key) {
+		mqttOutboundEnqueue(queue, key, MqttOutboundClass::Telemetry, "v", false);
+	}
+	SlowSink sink;
+	sink.budget = 100;
+	CHECK(mqttOutboundDrain(queue, 0, 10, slowSink, &sink) == 2);
+	CHECK(queue.stats.throttled == 1);
+	CHECK(mqttOutboundMsUntilSend(queue, 0, 1000) == 100);
+	CHECK(mqttOutboundDrain(queue, 100, 10, slowSink, &sink) == 1);
+
+	sink.budget = 0;
+	CHECK(mqttOutboundDrain(queue, 200, 10, slowSink, &sink) == 0);
+	CHECK(queue.stats.sendFailures == 1);
+	CHECK(mqttOutboundMsUntilSend(queue, 200, 1000) == 0);
+	sink.budget = 100;
+	CHECK(mqttOutboundDrain(queue, 200, 10, slowSink, &sink) == 1);
+}
+
+TEST_CASE("mqtt outbound: entity classification")
+{
+	CHECK(mqttOutboundClassFor(mqttEntityId::entityDispatchDuration, MqttEntityReadKind::Control, MqttEntityScope::Inverter) ==
+	      MqttOutboundClass::Dispatch);
+	CHECK(mqttOutboundClassFor(mqttEntityId::entityDispatchMode, MqttEntityReadKind::Register, MqttEntityScope::Inverter) ==
+	      MqttOutboundClass::Dispatch);
+	CHECK(mqttOutboundClassFor(mqttEntityId::entityBatSoc, MqttEntityReadKind::Register, MqttEntityScope::Inverter) ==
+	      MqttOutboundClass::Telemetry);
+	CHECK(mqttOutboundClassFor(mqttEntityId::entityBatSoc, MqttEntityReadKind::Derived, MqttEntityScope::Controller) ==
+	      MqttOutboundClass::Diagnostics);
+}
@@ -0,0 +1,378 @@
+// Purpose: Validate that transactions on independent RS485 buses overlap and keep per-bus accounting.
+#include "doctest/doctest.h"
+
+#include <string>
+#include <vector>
+
+#include "MultiBusPoller.h"
+#include "Rs485StubLogic.h"
+
+namespace {
+
+// Host stand-in for one RS485 bus: fixed latency, failure policy shared with the firmware stub.
+class StubBus : public BusTransport {
+public:
+	StubBus(uint32_t latencyMs, Rs485StubMode mode) : _latencyMs(latencyMs)
+	{
+		cfg.mode = mode;
+	}
+
+	bool beginTxn(const BusTxn &txn, uint32_t nowMs) override
+	{
+		if (busy) {
+			overlapViolations++;
+		}
+		busy = true;
+		_doneAtMs = nowMs + _latencyMs;
+		_attempt++;
+		_fail = rs485StubShouldFail(cfg, _attempt, txn.planIndex);
+		return true;
+	}
+
+	BusTxnState pollTxn(uint32_t nowMs) override
+	{
+		if (static_cast<int32_t>(nowMs - _doneAtMs) < 0) {
+			return BusTxnState::Pending;
+		}
+		busy = false;
+		return _fail ? BusTxnState::Failed : BusTxnState::Ok;
+	}
+
+	Rs485StubConfig cfg;
+	bool busy = false;
+	int overlapViolations = 0;
+
+private:
+	uint32_t _latencyMs;
+	uint32_t _doneAtMs = 0;
+	uint32_t _attempt = 0;
+	bool _fail = false;
+};
+
+class RefusingBus : public BusTransport {
+public:
+	bool beginTxn(const BusTxn &, uint32_t) override { return false; }
+	BusTxnState pollTxn(uint32_t) override { return BusTxnState::Pending; }
+};
+
+struct Completion {
+	size_t bus;
+	uint16_t planIndex;
+	bool ok;
+	uint32_t latencyMs;
+};
+
+void
+recordCompletion(size_t bus, const BusTxn &txn, bool ok, uint32_t latencyMs, void *ctx)
+{
+	static_cast<std::vector<Completion> *>(ctx)->push_back(Completion{ bus, txn.planIndex, ok, latencyMs });
+}
+
+uint32_t
+runUntilIdle(MultiBusPoller &poller, uint32_t startMs, std::vector<Completion> &out)
+{
+	uint32_t now = startMs;
+	multiBusService(poller, now, recordCompletion, &out);
+	while (!multiBusIdle(poller) && now - startMs < 100000u) {
+		now++;
+		multiBusService(poller, now, recordCompletion, &out);
+	}
+	return now - startMs;
+}
+
+} // namespace
+
+TEST_CASE("multi bus poller: transactions on separate buses overlap in time")
+{
+	StubBus a(50, Rs485StubMode::OnlineAlways);
+	StubBus b(50, Rs485StubMode::OnlineAlways);
+	MultiBusPoller poller;
+	REQUIRE(multiBusAttach(poller, 0, &a, 0));
+	REQUIRE(multiBusAttach(poller, 1, &b, 0));
+	for (uint16_t i = 0; i < 10; ++i) {
+		REQUIRE(multiBusEnqueue(poller, 0, BusTxn{ i, 0x55 }));
+		REQUIRE(multiBusEnqueue(poller, 1, BusTxn{ static_cast<uint16_t>(100 + i), 0x55 }));
+	}
+
+	std::vector<Completion> done;
+	const uint32_t elapsed = runUntilIdle(poller, 1000, done);
+
+	// Serialised this would take 20 * 50ms; overlapped it is bounded by the busiest bus.
+	CHECK(elapsed == 500u);
+	CHECK(done.size() == 20u);
+	CHECK(a.overlapViolations == 0);
+	CHECK(b.overlapViolations == 0);
+	CHECK(poller.lanes[0].diag.completed == 10u);
+	CHECK(poller.lanes[1].diag.completed == 10u);
+	CHECK(poller.lanes[0].diag.busyMs == 500u);
+	CHECK(poller.lanes[0].diag.maxLatencyMs == 50u);
+	CHECK(poller.lanes[0].diag.queueHighWater == 10u);
+
+	// Per-bus FIFO order is preserved.
+	uint16_t expectA = 0;
+	for (const Completion &c : done) {
+		if (c.bus == 0) {
+			CHECK(c.planIndex == expectA);
+			expectA++;
+		}
+	}
+}
+
+TEST_CASE("multi bus poller: a dead bus does not slow down a healthy one")
+{
+	StubBus healthy(20, Rs485StubMode::OnlineAlways);
+	StubBus dead(300, Rs485StubMode::OfflineForever);
+	MultiBusPoller poller;
+	REQUIRE(multiBusAttach(poller, 0, &healthy, 0));
+	REQUIRE(multiBusAttach(poller, 2, &dead, 0));
+	for (uint16_t i = 0; i < 5; ++i) {
+		REQUIRE(multiBusEnqueue(poller, 0, BusTxn{ i, 0x55 }));
+	}
+	REQUIRE(multiBusEnqueue(poller, 2, BusTxn{ 7, 0x55 }));
+
+	std::vector<Completion> done;
+	uint32_t now = 0;
+	multiBusService(poller, now, recordCompletion, &done);
+	while (multiBusPending(poller, 0) > 0) {
+		now++;
+		multiBusService(poller, now, recordCompletion, &done);
+	}
+	CHECK(now == 100u);
+	CHECK(multiBusPending(poller, 2) == 1u);
+
+	runUntilIdle(poller, now, done);
+	CHECK(poller.lanes[2].diag.failed == 1u);
+	CHECK(poller.lanes[0].diag.failed == 0u);
+	CHECK(done.back().bus == 2u);
+	CHECK_FALSE(done.back().ok);
+}
+
+TEST_CASE("multi bus poller: per-bus budget defers work to the next cycle")
+{
+	StubBus a(40, Rs485StubMode::OnlineAlways);
+	StubBus b(40, Rs485StubMode::OnlineAlways);
+	MultiBusPoller poller;
+	REQUIRE(multiBusAttach(poller, 0, &a, 100));
+	REQUIRE(multiBusAttach(poller, 1, &b, 0));
+	for (uint16_t i = 0; i < 5; ++i) {
+		REQUIRE(multiBusEnqueue(poller, 0, BusTxn{ i, 0x55 }));
+		REQUIRE(multiBusEnqueue(poller, 1, BusTxn{ i, 0x55 }));
+	}
+
+	std::vector<Completion> done;
+	multiBusBeginCycle(poller);
+	for (uint32_t now = 0; now <= 1000; ++now) {
+		multiBusService(poller, now, recordCompletion, &done);
+	}
+	// 3 * 40ms crosses the 100ms budget; the rest waits for the next cycle.
+	CHECK(poller.lanes[0].diag.completed == 3u);
+	CHECK(multiBusPending(poller, 0) == 2u);
+	CHECK(poller.lanes[0].diag.budgetDeferrals == 1u);
+	CHECK(poller.lanes[1].diag.completed == 5u);
+
+	multiBusBeginCycle(poller);
+	runUntilIdle(poller, 1001, done);
+	CHECK(poller.lanes[0].diag.completed == 5u);
+	CHECK(poller.lanes[0].diag.budgetDeferrals == 1u);
+}
+
+TEST_CASE("multi bus poller: queue overflow, refused starts and bad bus indices are accounted")
+{
+	RefusingBus refusing;
+	MultiBusPoller poller;
+	CHECK_FALSE(multiBusAttach(poller, kMaxRs485Buses, &refusing, 0));
+	CHECK_FALSE(multiBusEnqueue(poller, 1, BusTxn{}));
+	REQUIRE(multiBusAttach(poller, 1, &refusing, 0));
+
+	for (size_t i = 0; i < kBusQueueDepth; ++i) {
+		REQUIRE(multiBusEnqueue(poller, 1, BusTxn{ static_cast<uint16_t>(i), 0x55 }));
+	}
+	CHECK_FALSE(multiBusEnqueue(poller, 1, BusTxn{ 99, 0x55 }));
+	CHECK(poller.lanes[1].diag.dropped == 1u);
+
+	std::vector<Completion> done;
+	CHECK(multiBusService(poller, 5, recordCompletion, &done) == kBusQueueDepth);
+	CHECK(poller.lanes[1].diag.failed == kBusQueueDepth);
+	CHECK(multiBusIdle(poller));
+	CHECK(multiBusPending(poller, kMaxRs485Buses) == 0u);
+}
+
+namespace {
+
+// Bus with one device answering at goodBaud; poll replies follow pollOk.
+class LinkBus : public BusTransport {
+public:
+	explicit LinkBus(uint16_t goodBaud) : goodBaud(goodBaud) {}
+
+	bool beginTxn(const BusTxn &txn, uint32_t nowMs) override
+	{
+		_doneAtMs = nowMs + 10;
+		started.push_back(txn);
+		switch (txn.kind) {
+		case BusTxnKind::Probe:
+			_ok = txn.planIndex == goodBaud;
+			break;
+		case BusTxnKind::Identify:
+			_ok = identifyOk;
+			break;
+		case BusTxnKind::Poll:
+		default:
+			_ok = pollOk;
+			break;
+		}
+		return true;
+	}
+
+	BusTxnState pollTxn(uint32_t nowMs) override
+	{
+		if (static_cast<int32_t>(nowMs - _doneAtMs) < 0) {
+			return BusTxnState::Pending;
+		}
+		return _ok ? BusTxnState::Ok : BusTxnState::Failed;
+	}
+
+	uint16_t goodBaud;
+	bool identifyOk = true;
+	bool pollOk = true;
+	std::vector<BusTxn> started;
+
+private:
+	uint32_t _doneAtMs = 0;
+	bool _ok = false;
+};
+
+void
+serviceFor(MultiBusPoller &poller, uint32_t fromMs, uint32_t toMs, std::vector<Completion> &out)
+{
+	for (uint32_t now = fromMs; now <= toMs; ++now) {
+		multiBusService(poller, now, recordCompletion, &out);
+	}
+}
+
+} // namespace
+
+TEST_CASE("multi bus poller: a linked bus probes bauds and identifies before taking work")
+{
+	LinkBus bus(2);
+	MultiBusPoller poller;
+	REQUIRE(multiBusAttach(poller, 1, &bus, 0));
+	REQUIRE(multiBusEnableLink(poller, 1, 0x56, 4));
+	CHECK_FALSE(multiBusLinkOnline(poller, 1));
+	CHECK_FALSE(multiBusEnqueue(poller, 1, BusTxn{ 1, 0x56 }));
+
+	std::vector<Completion> done;
+	// Bauds 0 and 1 fail (1s apart), baud 2 answers, identify follows immediately.
+	serviceFor(poller, 0, 2100, done);
+	CHECK(multiBusLinkOnline(poller, 1));
+	CHECK(poller.lanes[1].link.baudIndex == 2u);
+	CHECK(poller.lanes[1].link.epoch == 1u);
+	REQUIRE(bus.started.size() == 4u);
+	CHECK(bus.started[0].kind == BusTxnKind::Probe);
+	CHECK(bus.started[0].planIndex == 0u);
+	CHECK(bus.started[1].planIndex == 1u);
+	CHECK(bus.started[1].slaveId == 0x56);
+	CHECK(bus.started[2].planIndex == 2u);
+	CHECK(bus.started[3].kind == BusTxnKind::Identify);
+	CHECK(bus.started[3].planIndex == 2u);
+
+	REQUIRE(multiBusEnqueue(poller, 1, BusTxn{ 7, 0x56 }));
+	serviceFor(poller, 2101, 2200, done);
+	CHECK(done.back().planIndex == 7u);
+	CHECK(done.back().ok);
+}
+
+TEST_CASE("multi bus poller: a full failed probe cycle backs off before the next one")
+{
+	LinkBus bus(9);
+	MultiBusPoller poller;
+	REQUIRE(multiBusAttach(poller, 0, &bus, 0));
+	REQUIRE(multiBusEnableLink(poller, 0, 0x55, 2));
+
+	std::vector<Completion> done;
+	serviceFor(poller, 0, 1020, done);
+	// Second probe finished at 1020: the cycle is spent, so the next one waits the cycle backoff.
+	CHECK(bus.started.size() == 2u);
+	CHECK(poller.lanes[0].link.nextAttemptMs == 2020u);
+	CHECK(poller.lanes[0].link.cycleBackoffMs == 2000u);
+	CHECK(multiBusMsUntilWork(poller, 1020, 5, 1000000) == 1000u);
+
+	serviceFor(poller, 1021, 5000, done);
+	// Cycle two ends at 3040; cycle three waits 2s.
+	CHECK(bus.started.size() == 4u);
+	CHECK(poller.lanes[0].link.nextAttemptMs == 5040u);
+	CHECK(poller.lanes[0].link.state == BusLinkState::Probing);
+}
+
+TEST_CASE("multi bus poller: repeated poll failures take the link back to probing")
+{
+	LinkBus bus(1);
+	MultiBusPoller poller;
+	REQUIRE(multiBusAttach(poller, 0, &bus, 0));
+	REQUIRE(multiBusEnableLink(poller, 0, 0x55, 3));
+	std::vector<Completion> done;
+	serviceFor(poller, 0, 1100, done);
+	REQUIRE(multiBusLinkOnline(poller, 0));
+
+	bus.pollOk = false;
+	for (uint16_t i = 0; i < 5; ++i) {
+		REQUIRE(multiBusEnqueue(poller, 0, BusTxn{ i, 0x55 }));
+	}
+	bus.started.clear();
+	serviceFor(poller, 1101, 1135, done);
+
+	CHECK(poller.lanes[0].link.state == BusLinkState::Probing);
+	CHECK(poller.lanes[0].diag.linkDrops == 1u);
+	CHECK(poller.lanes[0].diag.dropped == 2u);
+	CHECK(multiBusPending(poller, 0) == 1u);
+	// Three polls, then the locked baud is probed again straight away.
+	REQUIRE(bus.started.size() == 4u);
+	CHECK(bus.started[3].kind == BusTxnKind::Probe);
+	CHECK(bus.started[3].planIndex == 1u);
+
+	bus.pollOk = true;
+	serviceFor(poller, 1136, 1200, done);
+	CHECK(multiBusLinkOnline(poller, 0));
+	CHECK(poller.lanes[0].link.epoch == 2u);
+}
+
+TEST_CASE("multi bus poller: an identify failure limit restarts probing")
+{
+	LinkBus bus(0);
+	bus.identifyOk = false;
+	MultiBusPoller poller;
+	REQUIRE(multiBusAttach(poller, 0, &bus, 0));
+	REQUIRE(multiBusEnableLink(poller, 0, 0x55, 2));
+	std::vector<Completion> done;
+	// Probe ok at 10, identify fails at 20, 1030, 3040 (1s then 2s backoff).
+	serviceFor(poller, 0, 3040, done);
+	CHECK(poller.lanes[0].link.state == BusLinkState::Probing);
+	CHECK(poller.lanes[0].link.nextAttemptMs == 4040u);
+	CHECK_FALSE(multiBusLinkOnline(poller, 0));
+}
+
+TEST_CASE("multi bus poller: wait hints and diagnostics json")
+{
+	StubBus a(50, Rs485StubMode::OnlineAlways);
+	MultiBusPoller poller;
+	CHECK(multiBusMsUntilWork(poller, 0, 5, 777) == 777u);
+	REQUIRE(multiBusAttach(poller, 0, &a, 0));
+	CHECK(multiBusMsUntilWork(poller, 0, 5, 777) == 777u);
+	REQUIRE(multiBusEnqueue(poller, 0, BusTxn{ 1, 0x55 }));
+	CHECK(multiBusMsUntilWork(poller, 0, 5, 777) == 0u);
+	std::vector<Completion> done;
+	multiBusService(poller, 0, recordCompletion, &done);
+	CHECK(multiBusMsUntilWork(poller, 1, 5, 777) == 5u);
+	runUntilIdle(poller, 1, done);
+
+	char json[320];
+	REQUIRE(multiBusDiagJson(poller, 0, json, sizeof(json)));
+	CHECK(std::string(json) ==
+	      "{\"link\":\"unmanaged\",\"baud_idx\":0,\"epoch\":0,\"queued\":0,\"started\":1,\"completed\":1,"
+	      "\"failed\":0,\"dropped\":0,\"budget_deferrals\":0,\"busy_ms\":50,\"last_ms\":50,\"max_ms\":50,"
+	      "\"link_drops\":0,\"queue_hw\":1}");
+	char tiny[8];
+	CHECK_FALSE(multiBusDiagJson(poller, 0, tiny, sizeof(tiny)));
+	CHECK(tiny[0] == '\0');
+	CHECK_FALSE(multiBusDiagJson(poller, kMaxRs485Buses, json, sizeof(json)));
+	CHECK(std::string(busLinkStateToString(BusLinkState::Online)) == "online");
+}
@@ -0,0 +1,129 @@
+#include <doctest/doctest.h>
+
+#include "NetworkReconnect.h"
+
+namespace {
+
+WifiReconnectInput
+wifiDown(uint32_t nowMs, WifiFailureClass cls = WifiFailureClass::Unknown)
+{
+	return { nowMs, false, cls, BootMode::Normal, true };
+}
+
+} // namespace
+
+TEST_CASE("network reconnect: backoff doubles up to the cap")
+{
+	const ReconnectTiming timing{ 0U, 1000U, 30000U };
+	CHECK(reconnectBackoffMs(timing, 0) == 1000);
+	CHECK(reconnectBackoffMs(timing, 1) == 2000);
+	CHECK(reconnectBackoffMs(timing, 4) == 16000);
+	CHECK(reconnectBackoffMs(timing, 5) == 30000);
+	CHECK(reconnectBackoffMs(timing, 60000) == 30000);
+}
+
+TEST_CASE("network reconnect: wifi loss begins immediately, then backs off between timed-out attempts")
+{
+	const ReconnectTiming timing = wifiReconnectTiming();
+	WifiReconnect wifi;
+	wifiReconnectInit(wifi, 0, true);
+	CHECK(wifiReconnectStep(wifi, { 10, true, WifiFailureClass::Unknown, BootMode::Normal, true }) ==
+	      WifiReconnectAction::None);
+
+	CHECK(wifiReconnectStep(wifi, wifiDown(100)) == WifiReconnectAction::Lost);
+	CHECK(wifiReconnectStep(wifi, wifiDown(100)) == WifiReconnectAction::Begin);
+	CHECK(wifi.state == WifiReconnectState::Connecting);
+	// While the attempt is pending every step is a no-op, so the loop keeps polling.
+	CHECK(wifiReconnectStep(wifi, wifiDown(100 + timing.attemptTimeoutMs - 1)) == WifiReconnectAction::None);
+
+	const uint32_t timedOutMs = 100 + timing.attemptTimeoutMs;
+	CHECK(wifiReconnectStep(wifi, wifiDown(timedOutMs)) == WifiReconnectAction::None);
+	CHECK(wifi.state == WifiReconnectState::Backoff);
+	CHECK(wifi.nextAttemptMs == timedOutMs + timing.backoffBaseMs);
+	CHECK(wifiReconnectStep(wifi, wifiDown(wifi.nextAttemptMs - 1)) == WifiReconnectAction::None);
+	CHECK(wifiReconnectStep(wifi, wifiDown(wifi.nextAttemptMs)) == WifiReconnectAction::Begin);
+
+	CHECK(wifiReconnectStep(wifi, { wifi.nextAttemptMs + 50, true, WifiFailureClass::Unknown, BootMode::Normal, true }) ==
+	      WifiReconnectAction::Connected);
+	CHECK(wifi.failedAttempts == 0);
+	CHECK(wifi.state == WifiReconnectState::Connected);
+}
+
+TEST_CASE("network reconnect: wifi recovery window escalates only for invalid stored credentials")
+{
+	const uint32_t windowMs = wifiRecoveryTiming().runtimeValidationMs;
+	WifiReconnect wifi;
+	wifiReconnectInit(wifi, 0, true);
+	REQUIRE(wifiReconnectStep(wifi, wifiDown(0)) == WifiReconnectAction::Lost);
+
+	bool restarted = false;
+	for (uint32_t nowMs = 0; nowMs <= windowMs; nowMs += 100) {
+		if (wifiReconnectStep(wifi, wifiDown(nowMs)) == WifiReconnectAction::RestartWindow) {
+			restarted = true;
+			CHECK(nowMs == windowMs);
+		}
+	}
+	CHECK(restarted);
+
+	CHECK(wifiReconnectStep(wifi, wifiDown(2 * windowMs, WifiFailureClass::InvalidConfig)) ==
+	      WifiReconnectAction::RebootApConfig);
+
+	WifiReconnect portal;
+	wifiReconnectInit(portal, 0, false);
+	const WifiReconnectInput apMode{ windowMs, false, WifiFailureClass::InvalidConfig, BootMode::ApConfig, true };
+	CHECK(wifiReconnectStep(portal, apMode) == WifiReconnectAction::RestartWindow);
+}
+
+TEST_CASE("network reconnect: mqtt waits for wifi and backs off on failed connects")
+{
+	const ReconnectTiming timing = mqttReconnectTiming();
+	MqttReconnect mqtt;
+	mqttReconnectInit(mqtt, 1000);
+	CHECK(mqttReconnectStep(mqtt, 1000, false, false) == MqttReconnectAction::None);
+	CHECK(mqtt.state == MqttReconnectState::WaitWifi);
+	CHECK(mqttReconnectStep(mqtt, 1500, true, false) == MqttReconnectAction::Connect);
+
+	mqttReconnectNoteResult(mqtt, 1500, false);
+	CHECK(mqtt.nextAttemptMs == 1500 + timing.backoffBaseMs);
+	CHECK(mqttReconnectStep(mqtt, 1500 + timing.backoffBaseMs - 1, true, false) == MqttReconnectAction::None);
+	CHECK(mqttReconnectStep(mqtt, 1500 + timing.backoffBaseMs, true, false) == MqttReconnectAction::Connect);
+	mqttReconnectNoteResult(mqtt, 1500 + timing.backoffBaseMs, false);
+	CHECK(mqtt.nextAttemptMs == 1500 + timing.backoffBaseMs + 2 * timing.backoffBaseMs);
+
+	uint32_t nowMs = mqtt.nextAttemptMs;
+	uint32_t lastDelayMs = 0;
+	for (int i = 0; i < 20; ++i) {
+		REQUIRE(mqttReconnectStep(mqtt, nowMs, true, false) == MqttReconnectAction::Connect);
+		mqttReconnectNoteResult(mqtt, nowMs, false);
+		lastDelayMs = mqtt.nextAttemptMs - nowMs;
+		CHECK(lastDelayMs <= timing.backoffMaxMs);
+		nowMs = mqtt.nextAttemptMs;
+	}
+	CHECK(lastDelayMs == timing.backoffMaxMs);
+
+	REQUIRE(mqttReconnectStep(mqtt, nowMs, true, false) == MqttReconnectAction::Connect);
+	mqttReconnectNoteResult(mqtt, nowMs, true);
+	CHECK(mqtt.failedAttempts == 0);
+	CHECK(mqttReconnectStep(mqtt, nowMs + 10, true, true) == MqttReconnectAction::None);
+}
+
+TEST_CASE("network reconnect: a dropped mqtt session is torn down once, then retried after the settle gap")
+{
+	MqttReconnect mqtt;
+	mqttReconnectInit(mqtt, 0);
+	mqttReconnectStep(mqtt, 0, true, true);
+	REQUIRE(mqtt.state == MqttReconnectState::Connected);
+
+	CHECK(mqttReconnectStep(mqtt, 5000, true, false) == MqttReconnectAction::Lost);
+	CHECK(mqttReconnectStep(mqtt, 5000 + kMqttReconnectSettleMs - 1, true, false) == MqttReconnectAction::None);
+	CHECK(mqttReconnectStep(mqtt, 5000 + kMqttReconnectSettleMs, true, false) == MqttReconnectAction::Connect);
+
+	// Losing WiFi parks the machine without burning attempts.
+	mqttReconnectNoteResult(mqtt, 6000, true);
+	CHECK(mqttReconnectStep(mqtt, 7000, false, false) == MqttReconnectAction::Lost);
+	for (uint32_t nowMs = 7000; nowMs < 60000; nowMs += 1000) {
+		CHECK(mqttReconnectStep(mqtt, nowMs, false, false) == MqttReconnectAction::None);
+	}
+	CHECK(mqtt.failedAttempts == 0);
+	CHECK(mqttReconnectStep(mqtt, 60000, true, false) == MqttReconnectAction::Connect);
+}
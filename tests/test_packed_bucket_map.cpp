@@ -0,0 +1,52 @@
+#include <doctest/doctest.h>
+
+#include "PackedBucketMap.h"
+
+TEST_CASE("packed bucket map: three-bit fields round-trip across byte boundaries")
+{
+	constexpr size_t kCount = 37;
+	uint8_t map[packedBucketMapBytes(kCount)] = {};
+	CHECK(sizeof(map) == 14);
+	packedBucketFill(map, kCount, BucketId::Unknown);
+	for (size_t idx = 0; idx < kCount; ++idx) {
+		CHECK(packedBucketGet(map, idx) == BucketId::Unknown);
+	}
+
+	BucketId expected[kCount];
+	for (size_t idx = 0; idx < kCount; ++idx) {
+		expected[idx] = static_cast<BucketId>((idx * 5 + 3) % 8);
+		packedBucketSet(map, idx, expected[idx]);
+	}
+	// Rewriting one field leaves its neighbours alone, including fields that straddle a byte.
+	packedBucketSet(map, 2, BucketId::TenSec);
+	expected[2] = BucketId::TenSec;
+	packedBucketSet(map, 5, BucketId::Disabled);
+	expected[5] = BucketId::Disabled;
+	for (size_t idx = 0; idx < kCount; ++idx) {
+		CAPTURE(idx);
+		CHECK(packedBucketGet(map, idx) == expected[idx]);
+	}
+	CHECK(packedBucketMatches(map, expected, kCount));
+
+	BucketId unpacked[kCount];
+	packedBucketUnpack(map, unpacked, kCount);
+	expected[36] = BucketId::User;
+	CHECK_FALSE(packedBucketMatches(map, expected, kCount));
+	packedBucketPack(map, expected, kCount);
+	CHECK(packedBucketMatches(map, expected, kCount));
+	CHECK(unpacked[2] == BucketId::TenSec);
+}
+
+TEST_CASE("packed bucket map: entity bitsets use one bit per entity")
+{
+	uint8_t bits[entityBitsetBytes(20)] = {};
+	CHECK(sizeof(bits) == 3);
+	entityBitsetSet(bits, 0);
+	entityBitsetSet(bits, 9);
+	entityBitsetSet(bits, 19);
+	CHECK(entityBitsetTest(bits, 0));
+	CHECK(entityBitsetTest(bits, 9));
+	CHECK(entityBitsetTest(bits, 19));
+	CHECK_FALSE(entityBitsetTest(bits, 1));
+	CHECK_FALSE(entityBitsetTest(bits, 18));
+}
@@ -0,0 +1,71 @@
+#include <doctest/doctest.h>
+
+#include <cstring>
+#include <string>
+
+#include "MqttEntities.h"
+#include "MqttTopicRouter.h"
+#include "PerfectHash.h"
+
+namespace {
+
+constexpr const char *kColours[] = { "red", "green", "blue", "cyan", "magenta", "yellow", "black", "white", "grey" };
+constexpr PerfectHashTable<9> kColourHash = buildPerfectHash(kColours);
+static_assert(kColourHash.ok, "distinct keys always hash");
+
+constexpr const char *kDuplicates[] = { "red", "green", "red" };
+// A duplicate key can never be placed, which is what turns a bad catalog into a build error.
+static_assert(!buildPerfectHash(kDuplicates).ok, "duplicate keys must be rejected");
+
+} // namespace
+
+TEST_CASE("perfect hash: every key gets its own slot and resolves to itself")
+{
+	bool seen[9] = {};
+	for (size_t slot = 0; slot < 9; ++slot) {
+		REQUIRE(kColourHash.keys[slot] < 9);
+		CHECK_FALSE(seen[kColourHash.keys[slot]]);
+		seen[kColourHash.keys[slot]] = true;
+	}
+	for (size_t i = 0; i < 9; ++i) {
+		CHECK(perfectHashCandidate(kColourHash, kColours[i], strlen(kColours[i])) == i);
+	}
+}
+
+TEST_CASE("perfect hash: catalog names resolve in O(1) and non-members are rejected")
+{
+	for (size_t idx = 0; idx < mqttEntitiesCount(); ++idx) {
+		mqttState entity{};
+		REQUIRE(mqttEntityCopyByIndex(idx, &entity));
+		const std::string name(entity.mqttName);
+		size_t found = 0;
+		REQUIRE(mqttEntityIndexByName(name.c_str(), &found));
+		CHECK(found == idx);
+
+		// Span lookups work on names embedded in a topic.
+		const std::string topic = "dev/inv/" + name + "/command";
+		found = 0;
+		REQUIRE(mqttEntityIndexByNameSpan(topic.c_str() + 8, name.size(), &found));
+		CHECK(found == idx);
+
+		CHECK_FALSE(mqttEntityIndexByNameSpan(name.c_str(), name.size() - 1, &found));
+		CHECK_FALSE(mqttEntityIndexByName((name + "_").c_str(), &found));
+	}
+	size_t idx = 0;
+	CHECK_FALSE(mqttEntityIndexByName("", &idx));
+	CHECK_FALSE(mqttEntityIndexByNameSpan("Grid_Power", 0, &idx));
+}
+
+TEST_CASE("topic router: device control suffixes route exactly")
+{
+	CHECK(routeDeviceTopic("A2M-ABCDEF/config/set", "A2M-ABCDEF") == DeviceTopicRoute::ConfigSet);
+	CHECK(routeDeviceTopic("A2M-ABCDEF/debug/raw_read/set", "A2M-ABCDEF") == DeviceTopicRoute::RawReadSet);
+	CHECK(routeDeviceTopic("A2M-ABCDEF/debug/rs485_stub/set", "A2M-ABCDEF") == DeviceTopicRoute::Rs485StubSet);
+
+	CHECK(routeDeviceTopic("A2M-ABCDEF/config/set/x", "A2M-ABCDEF") == DeviceTopicRoute::None);
+	CHECK(routeDeviceTopic("A2M-ABCDEF/config", "A2M-ABCDEF") == DeviceTopicRoute::None);
+	CHECK(routeDeviceTopic("A2M-000000/config/set", "A2M-ABCDEF") == DeviceTopicRoute::None);
+	CHECK(routeDeviceTopic("A2M-ABCDEF/A2M-AL20/Grid_Power/command", "A2M-ABCDEF") == DeviceTopicRoute::None);
+	CHECK(routeDeviceTopic("A2M-ABCDEF/config/set", "") == DeviceTopicRoute::None);
+	CHECK(routeDeviceTopic(nullptr, "A2M-ABCDEF") == DeviceTopicRoute::None);
+}
@@ -0,0 +1,218 @@
+#include <doctest/doctest.h>
+
+#include <chrono>
+#include <vector>
+
+#include "AllocProfiler.h"
+#include "PackedBucketMap.h"
+#include "PollPlanBuilder.h"
+
+namespace {
+
+constexpr size_t kSyntheticEntities = 2000;
+// Four entities share each register read.
+constexpr size_t kEntitiesPerRead = 4;
+
+struct SyntheticCatalog {
+	size_t entityCount;
+	mutable size_t walks;
+};
+
+MqttPollTransactionKind
+syntheticKind(const void *, size_t idx)
+{
+	if (idx % 7 == 0) {
+		return MqttPollTransactionKind::SnapshotFanout;
+	}
+	if (idx % 3 == 0) {
+		return MqttPollTransactionKind::SingleEntity;
+	}
+	return MqttPollTransactionKind::RegisterFanout;
+}
+
+BucketId
+syntheticDefault(const void *ctx, size_t idx)
+{
+	static_cast<const SyntheticCatalog *>(ctx)->walks++;
+	static const BucketId kDefaults[] = { BucketId::TenSec,  BucketId::OneMin, BucketId::FiveMin,
+		                                  BucketId::OneHour, BucketId::OneDay, BucketId::Disabled };
+	return kDefaults[(idx / 5) % 6];
+}
+
+uint16_t
+syntheticReadKey(const void *, size_t idx)
+{
+	return static_cast<uint16_t>(0x1000 + idx / kEntitiesPerRead);
+}
+
+uint16_t
+syntheticReadGroup(const void *, size_t idx)
+{
+	return static_cast<uint16_t>(idx / kEntitiesPerRead);
+}
+
+BucketId
+syntheticOverride(const void *, size_t idx)
+{
+	return (idx % 11 == 0) ? BucketId::User : BucketId::Unknown;
+}
+
+BucketId
+noOverride(const void *, size_t)
+{
+	return BucketId::Unknown;
+}
+
+PollPlanCatalog
+syntheticView(const SyntheticCatalog &synthetic)
+{
+	return PollPlanCatalog{ synthetic.entityCount,
+		                    synthetic.entityCount / kEntitiesPerRead + 1,
+		                    &synthetic,
+		                    syntheticDefault,
+		                    syntheticKind,
+		                    syntheticReadKey,
+		                    syntheticReadGroup };
+}
+
+BucketId
+effectiveBucket(const SyntheticCatalog &synthetic, size_t idx)
+{
+	const BucketId override = syntheticOverride(nullptr, idx);
+	return (override != BucketId::Unknown) ? override : syntheticDefault(&synthetic, idx);
+}
+
+} // namespace
+
+TEST_CASE("poll plan builder: a 2000-entity catalog builds in linear time and one arena")
+{
+	SyntheticCatalog synthetic{ kSyntheticEntities, 0 };
+	const PollPlanCatalog catalog = syntheticView(synthetic);
+	std::vector<uint16_t> groups(catalog.readGroupCount);
+	PollPlanStorage storage{};
+
+	const auto start = std::chrono::steady_clock::now();
+	{
+		AllocWindow window;
+		REQUIRE(pollPlanBuild(catalog, syntheticOverride, nullptr, groups.data(), storage));
+		CHECK(window.allocs() == 1);
+		CHECK(window.allocBytes() == storage.arenaBytes);
+	}
+	const auto elapsedUs =
+		std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+	MESSAGE("2000-entity plan build: " << elapsedUs << " us, " << storage.arenaBytes << " arena bytes, "
+	                                   << synthetic.walks << " default lookups");
+
+	// One counting walk plus two walks per non-empty bucket: linear, with no per-transaction scans.
+	CHECK(synthetic.walks <= kSyntheticEntities * 13);
+
+	// Overrides cost three bits per entity; every other byte is a transaction or a member.
+	size_t txnTotal = 0;
+	const MqttEntityActiveBucket *buckets[] = { &storage.plan.tenSec,  &storage.plan.oneMin, &storage.plan.fiveMin,
+		                                        &storage.plan.oneHour, &storage.plan.oneDay, &storage.plan.user };
+	for (const MqttEntityActiveBucket *bucket : buckets) {
+		txnTotal += bucket->transactionCount;
+	}
+	REQUIRE(storage.overrideMap != nullptr);
+	CHECK(storage.overrideMap == storage.arena);
+	CHECK(storage.overrideCount == (kSyntheticEntities + 10) / 11);
+	CHECK(storage.arenaBytes <= packedBucketMapBytes(kSyntheticEntities) + 16 +
+	                                txnTotal * sizeof(MqttPollTransaction) +
+	                                storage.plan.activeCount * sizeof(uint16_t));
+	CHECK(storage.arenaBytes < kSyntheticEntities * (sizeof(MqttPollTransaction) + sizeof(uint16_t)));
+	for (size_t idx = 0; idx < kSyntheticEntities; ++idx) {
+		CHECK(packedBucketGet(storage.overrideMap, idx) == syntheticOverride(nullptr, idx));
+	}
+	pollPlanRelease(storage);
+	CHECK(storage.arena == nullptr);
+}
+
+TEST_CASE("poll plan builder: synthetic plan groups every member correctly")
+{
+	SyntheticCatalog synthetic{ kSyntheticEntities, 0 };
+	const PollPlanCatalog catalog = syntheticView(synthetic);
+	std::vector<uint16_t> groups(catalog.readGroupCount);
+	PollPlanStorage storage{};
+	REQUIRE(pollPlanBuild(catalog, syntheticOverride, nullptr, groups.data(), storage));
+
+	std::vector<int> seen(kSyntheticEntities, 0);
+	const BucketId bucketIds[] = { BucketId::TenSec,  BucketId::OneMin, BucketId::FiveMin,
+		                           BucketId::OneHour, BucketId::OneDay, BucketId::User };
+	const MqttEntityActiveBucket *buckets[] = { &storage.plan.tenSec,  &storage.plan.oneMin, &storage.plan.fiveMin,
+		                                        &storage.plan.oneHour, &storage.plan.oneDay, &storage.plan.user };
+	size_t active = 0;
+	for (size_t b = 0; b < 6; ++b) {
+		const MqttEntityActiveBucket &bucket = *buckets[b];
+		REQUIRE(bucket.count > 0);
+		active += bucket.count;
+		size_t snapshotTxns = 0;
+		size_t previousLeader = 0;
+		std::vector<uint16_t> readKeys;
+		for (size_t t = 0; t < bucket.transactionCount; ++t) {
+			const MqttPollTransaction &txn = bucket.transactions[t];
+			REQUIRE(txn.entityCount > 0);
+			REQUIRE(txn.firstMemberOffset + txn.entityCount <= bucket.count);
+			const uint16_t *members = bucket.members + txn.firstMemberOffset;
+			// Transactions follow their first member's catalog order.
+			if (t > 0) {
+				CHECK(members[0] > previousLeader);
+			}
+			previousLeader = members[0];
+			for (size_t m = 0; m < txn.entityCount; ++m) {
+				const size_t idx = members[m];
+				CHECK(effectiveBucket(synthetic, idx) == bucketIds[b]);
+				CHECK(syntheticKind(nullptr, idx) == txn.kind);
+				if (m > 0) {
+					CHECK(members[m] > members[m - 1]);
+				}
+				if (txn.kind == MqttPollTransactionKind::RegisterFanout) {
+					CHECK(syntheticReadKey(nullptr, idx) == txn.readKey);
+				}
+				seen[idx]++;
+			}
+			if (txn.kind == MqttPollTransactionKind::SnapshotFanout) {
+				snapshotTxns++;
+			} else if (txn.kind == MqttPollTransactionKind::SingleEntity) {
+				CHECK(txn.entityCount == 1);
+			} else {
+				for (uint16_t key : readKeys) {
+					CHECK(key != txn.readKey);
+				}
+				readKeys.push_back(txn.readKey);
+			}
+		}
+		CHECK(snapshotTxns == 1);
+		CHECK(bucket.hasEssSnapshot);
+	}
+	CHECK(active == storage.plan.activeCount);
+	for (size_t idx = 0; idx < kSyntheticEntities; ++idx) {
+		CAPTURE(idx);
+		CHECK(seen[idx] == (effectiveBucket(synthetic, idx) == BucketId::Disabled ? 0 : 1));
+	}
+	pollPlanRelease(storage);
+}
+
+TEST_CASE("poll plan builder: no overrides means no override map, and bad input fails cleanly")
+{
+	SyntheticCatalog synthetic{ 64, 0 };
+	PollPlanCatalog catalog = syntheticView(synthetic);
+	std::vector<uint16_t> groups(catalog.readGroupCount);
+	PollPlanStorage storage{};
+	REQUIRE(pollPlanBuild(catalog, noOverride, nullptr, groups.data(), storage));
+	CHECK(storage.overrideMap == nullptr);
+	CHECK(storage.overrideCount == 0);
+	pollPlanRelease(storage);
+
+	// A read group outside the declared range is rejected before anything is allocated.
+	catalog.readGroupCount = 2;
+	{
+		AllocWindow window;
+		CHECK_FALSE(pollPlanBuild(catalog, noOverride, nullptr, groups.data(), storage));
+		CHECK(window.allocs() == 0);
+	}
+	CHECK(storage.arena == nullptr);
+
+	catalog.readGroupCount = groups.size();
+	catalog.entityCount = static_cast<size_t>(UINT16_MAX) + 1;
+	CHECK_FALSE(pollPlanBuild(catalog, noOverride, nullptr, groups.data(), storage));
+}
@@ -0,0 +1,216 @@
+#include <doctest/doctest.h>
+
+#include <chrono>
+#include <cstring>
+#include <vector>
+
+#include "BucketScheduler.h"
+#include "Crc32.h"
+#include "MqttEntities.h"
+#include "PollingConfig.h"
+#include "PollingConfigRecord.h"
+
+namespace {
+
+std::vector<BucketId>
+catalogDefaults(size_t count)
+{
+	std::vector<BucketId> buckets(count);
+	for (size_t idx = 0; idx < count; ++idx) {
+		buckets[idx] = bucketIdFromFreq(mqttEntityDefaultFreqByIndex(idx));
+	}
+	return buckets;
+}
+
+std::vector<BucketId>
+userBuckets(size_t count)
+{
+	std::vector<BucketId> buckets = catalogDefaults(count);
+	for (size_t idx = 0; idx < count; idx += 3) {
+		buckets[idx] = static_cast<BucketId>(idx % static_cast<size_t>(BucketId::Unknown));
+	}
+	return buckets;
+}
+
+uint32_t
+renamedCatalogFingerprint(size_t count)
+{
+	return mqttEntityCatalogFingerprint(count) ^ 1U;
+}
+
+uint32_t
+referenceFingerprint(size_t count)
+{
+	const mqttState *rows = mqttEntitiesDesc();
+	uint32_t hash = 2166136261U;
+	for (size_t idx = 0; idx < count; ++idx) {
+		for (const char *name = rows[idx].mqttName;; ++name) {
+			hash = (hash ^ static_cast<uint8_t>(*name)) * 16777619U;
+			if (*name == '\0') {
+				break;
+			}
+		}
+		hash = (hash ^ static_cast<uint8_t>(rows[idx].updateFreq)) * 16777619U;
+	}
+	return hash;
+}
+
+void
+resealRecord(std::vector<uint8_t> &record)
+{
+	const size_t crcOffset = record.size() - kPollingConfigRecordCrcBytes;
+	const uint32_t crc = crc32Ieee(record.data(), crcOffset);
+	for (size_t i = 0; i < 4; ++i) {
+		record[crcOffset + i] = static_cast<uint8_t>(crc >> (8 * i));
+	}
+}
+
+} // namespace
+
+TEST_CASE("polling config record: round-trips the assignments for the same text and catalog")
+{
+	const size_t count = kMqttEntityDescriptorCount;
+	const std::vector<BucketId> saved = userBuckets(count);
+	const size_t mapSize = sizeof("Battery_SOC=one_min;");
+	std::vector<uint8_t> record(pollingConfigRecordBytes(count));
+	REQUIRE(pollingConfigRecordEncode(saved.data(), count, mqttEntityCatalogFingerprint(count), mapSize, record.data(),
+	                                  record.size()) == record.size());
+	CHECK(pollingConfigRecordEncode(saved.data(), count, 0, mapSize, record.data(), record.size() - 1) == 0);
+
+	std::vector<BucketId> loaded = catalogDefaults(count);
+	CHECK(pollingConfigRecordDecode(record.data(), record.size(), count, mqttEntityCatalogFingerprint, mapSize,
+	                                loaded.data()) == PollingConfigRecordStatus::Ok);
+	CHECK(loaded == saved);
+	MESSAGE("polling config record: " << record.size() << " bytes for " << count << " entities");
+
+	std::vector<BucketId> withUnknown = saved;
+	withUnknown[5] = BucketId::Unknown;
+	CHECK(pollingConfigRecordEncode(withUnknown.data(), count, 0, mapSize, record.data(), record.size()) == 0);
+	CHECK(pollingConfigRecordEncode(saved.data(), count, 0, 70000, record.data(), record.size()) == 0);
+}
+
+TEST_CASE("polling config record: damage is rejected without touching the caller's buckets")
+{
+	const size_t count = kMqttEntityDescriptorCount;
+	const std::vector<BucketId> saved = userBuckets(count);
+	const std::vector<BucketId> defaults = catalogDefaults(count);
+	const size_t mapSize = 1234;
+	std::vector<uint8_t> record(pollingConfigRecordBytes(count));
+	REQUIRE(pollingConfigRecordEncode(saved.data(), count, mqttEntityCatalogFingerprint(count), mapSize, record.data(),
+	                                  record.size()) != 0);
+
+	for (size_t offset = 0; offset < record.size(); ++offset) {
+		CAPTURE(offset);
+		std::vector<uint8_t> damaged = record;
+		damaged[offset] ^= 0x10U;
+		std::vector<BucketId> loaded = defaults;
+		CHECK(pollingConfigRecordDecode(damaged.data(), damaged.size(), count, mqttEntityCatalogFingerprint, mapSize,
+		                                loaded.data()) == PollingConfigRecordStatus::Corrupt);
+		CHECK(loaded == defaults);
+	}
+
+	std::vector<BucketId> loaded = defaults;
+	CHECK(pollingConfigRecordDecode(record.data(), record.size() - 1, count, mqttEntityCatalogFingerprint, mapSize,
+	                                loaded.data()) == PollingConfigRecordStatus::Corrupt);
+	// Valid records that belong to other text, another catalog or a future format are stale.
+	CHECK(pollingConfigRecordDecode(record.data(), record.size(), count, mqttEntityCatalogFingerprint, mapSize + 1,
+	                                loaded.data()) == PollingConfigRecordStatus::Stale);
+	CHECK(pollingConfigRecordDecode(record.data(), record.size(), count, renamedCatalogFingerprint, mapSize,
+	                                loaded.data()) == PollingConfigRecordStatus::Stale);
+	std::vector<uint8_t> future = record;
+	future[2] = kPollingConfigRecordVersion + 1;
+	resealRecord(future);
+	CHECK(pollingConfigRecordDecode(future.data(), future.size(), count, mqttEntityCatalogFingerprint, mapSize,
+	                                loaded.data()) == PollingConfigRecordStatus::Stale);
+	CHECK(loaded == defaults);
+}
+
+TEST_CASE("polling config record: catalog growth keeps the old prefix and defaults the new entities")
+{
+	const size_t count = kMqttEntityDescriptorCount;
+	const size_t oldCount = count - 7;
+	CHECK(mqttEntityCatalogFingerprint(oldCount) != mqttEntityCatalogFingerprint(count));
+	CHECK(mqttEntityCatalogFingerprint(count + 5) == mqttEntityCatalogFingerprint(count));
+	// The compile-time full-catalog value and the runtime prefix walk hash the same bytes.
+	CHECK(mqttEntityCatalogFingerprint(count) == referenceFingerprint(count));
+	CHECK(mqttEntityCatalogFingerprint(oldCount) == referenceFingerprint(oldCount));
+
+	const std::vector<BucketId> saved = userBuckets(oldCount);
+	const size_t mapSize = 4321;
+	std::vector<uint8_t> record(pollingConfigRecordBytes(oldCount));
+	REQUIRE(pollingConfigRecordEncode(saved.data(), oldCount, mqttEntityCatalogFingerprint(oldCount), mapSize,
+	                                  record.data(), record.size()) == record.size());
+
+	const std::vector<BucketId> defaults = catalogDefaults(count);
+	std::vector<BucketId> loaded = defaults;
+	REQUIRE(pollingConfigRecordDecode(record.data(), record.size(), count, mqttEntityCatalogFingerprint, mapSize,
+	                                  loaded.data()) == PollingConfigRecordStatus::Grown);
+	for (size_t idx = 0; idx < count; ++idx) {
+		CAPTURE(idx);
+		CHECK(loaded[idx] == (idx < oldCount ? saved[idx] : defaults[idx]));
+	}
+
+	// The migrated assignments re-encode at full size and then load as current.
+	std::vector<uint8_t> migrated(pollingConfigRecordBytes(count));
+	REQUIRE(pollingConfigRecordEncode(loaded.data(), count, mqttEntityCatalogFingerprint(count), mapSize,
+	                                  migrated.data(), migrated.size()) == migrated.size());
+	std::vector<BucketId> reloaded = defaults;
+	CHECK(pollingConfigRecordDecode(migrated.data(), migrated.size(), count, mqttEntityCatalogFingerprint, mapSize,
+	                                reloaded.data()) == PollingConfigRecordStatus::Ok);
+	CHECK(reloaded == loaded);
+
+	// A shrunk catalog cannot trust a longer record, nor a grown one whose prefix changed.
+	std::vector<BucketId> shrunk = defaults;
+	CHECK(pollingConfigRecordDecode(migrated.data(), migrated.size(), oldCount, mqttEntityCatalogFingerprint, mapSize,
+	                                shrunk.data()) == PollingConfigRecordStatus::Stale);
+	CHECK(pollingConfigRecordDecode(record.data(), record.size(), count, renamedCatalogFingerprint, mapSize,
+	                                shrunk.data()) == PollingConfigRecordStatus::Stale);
+	CHECK(shrunk == defaults);
+}
+
+TEST_CASE("polling config record: boot decode versus the text map parse")
+{
+	const mqttState *entities = mqttEntitiesDesc();
+	REQUIRE(entities != nullptr);
+	const size_t count = kMqttEntityDescriptorCount;
+	const std::vector<BucketId> saved = userBuckets(count);
+	std::vector<char> text(4608);
+	size_t applied = 0;
+	REQUIRE(buildBucketMapFromAssignments(entities, count, saved.data(), text.data(), text.size(), applied));
+	REQUIRE(applied > 0);
+	const size_t textLen = strlen(text.data());
+	std::vector<uint8_t> record(pollingConfigRecordBytes(count));
+	REQUIRE(pollingConfigRecordEncode(saved.data(), count, mqttEntityCatalogFingerprint(count), textLen + 1,
+	                                  record.data(), record.size()) != 0);
+
+	const int rounds = 200;
+	const std::vector<BucketId> defaults = catalogDefaults(count);
+	std::vector<BucketId> loaded(count);
+	const auto textStart = std::chrono::steady_clock::now();
+	for (int round = 0; round < rounds; ++round) {
+		loaded = defaults;
+		uint32_t unknown = 0;
+		uint32_t invalid = 0;
+		uint32_t duplicate = 0;
+		REQUIRE(applyBucketMapString(text.data(), entities, count, loaded.data(), unknown, invalid, duplicate));
+	}
+	const double textUs = static_cast<double>(
+		std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - textStart).count());
+	CHECK(loaded == saved);
+
+	const auto recordStart = std::chrono::steady_clock::now();
+	for (int round = 0; round < rounds; ++round) {
+		loaded = defaults;
+		// Boot binds the record to the stored text by size alone; the text itself is never read.
+		REQUIRE(pollingConfigRecordDecode(record.data(), record.size(), count, mqttEntityCatalogFingerprint,
+		                                  textLen + 1, loaded.data()) == PollingConfigRecordStatus::Ok);
+	}
+	const double recordUs = static_cast<double>(
+		std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - recordStart).count());
+	CHECK(loaded == saved);
+
+	MESSAGE("polling config load (" << applied << " overrides, " << textLen << " text bytes vs " << record.size()
+	                                << " record bytes): " << (textUs / rounds) << " us parse vs "
+	                                << (recordUs / rounds) << " us record");
+	CHECK(recordUs < textUs);
+}
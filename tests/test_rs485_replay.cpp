@@ -0,0 +1,202 @@
+// Purpose: Validate that deferred RS485 replies are replayed to a re-run request chain in order.
+#include "doctest/doctest.h"
+
+#include <cstring>
+
+#include "Rs485Replay.h"
+
+namespace {
+
+Rs485WorkerReply
+replyWithWord(uint16_t word)
+{
+	Rs485WorkerReply reply;
+	reply.result = modbusRequestAndResponseStatusValues::readDataRegisterSuccess;
+	reply.diag.attempts = 1;
+	reply.diag.result = reply.result;
+	reply.functionCode = 0x03;
+	reply.dataSize = 2;
+	reply.data[0] = static_cast<uint8_t>(word >> 8);
+	reply.data[1] = static_cast<uint8_t>(word & 0xFF);
+	return reply;
+}
+
+uint16_t
+wordOf(const Rs485WorkerReply &reply)
+{
+	return static_cast<uint16_t>((reply.data[0] << 8) | reply.data[1]);
+}
+
+} // namespace
+
+TEST_CASE("rs485 replay: a two-frame chain completes over three turns")
+{
+	const uint8_t frameA[] = { 0x55, 0x03, 0x00, 0x10, 0x00, 0x01, 0xAA, 0xBB };
+	const uint8_t frameB[] = { 0x55, 0x03, 0x00, 0x20, 0x00, 0x01, 0xCC, 0xDD };
+	Rs485ReplayChannel channel;
+	Rs485WorkerReply out;
+
+	// Turn 1: A goes to the worker; B is never reached because the scope is already pending.
+	channel.beginScope();
+	REQUIRE(channel.next(frameA, sizeof(frameA), out) == Rs485ReplayStep::Submit);
+	channel.submitted(frameA, sizeof(frameA), 1);
+	CHECK(channel.next(frameB, sizeof(frameB), out) == Rs485ReplayStep::Pending);
+	CHECK(channel.endScope());
+	CHECK(channel.awaiting());
+
+	// Turn 2: A is still out; it stays pending and is not submitted twice.
+	channel.beginScope();
+	CHECK(channel.next(frameA, sizeof(frameA), out) == Rs485ReplayStep::Pending);
+	CHECK(channel.endScope());
+
+	CHECK(channel.collected(1, replyWithWord(0x1234)));
+	CHECK_FALSE(channel.awaiting());
+
+	// Turn 3: A is replayed and B goes out.
+	channel.beginScope();
+	REQUIRE(channel.next(frameA, sizeof(frameA), out) == Rs485ReplayStep::Replayed);
+	CHECK(wordOf(out) == 0x1234);
+	REQUIRE(channel.next(frameB, sizeof(frameB), out) == Rs485ReplayStep::Submit);
+	channel.submitted(frameB, sizeof(frameB), 2);
+	CHECK(channel.endScope());
+	CHECK(channel.collected(2, replyWithWord(0x5678)));
+
+	// Turn 4: both replay and the finished chain drops its replies.
+	channel.beginScope();
+	REQUIRE(channel.next(frameA, sizeof(frameA), out) == Rs485ReplayStep::Replayed);
+	CHECK(wordOf(out) == 0x1234);
+	REQUIRE(channel.next(frameB, sizeof(frameB), out) == Rs485ReplayStep::Replayed);
+	CHECK(wordOf(out) == 0x5678);
+	CHECK_FALSE(channel.endScope());
+	CHECK(channel.replayCount() == 0u);
+}
+
+TEST_CASE("rs485 replay: stale and foreign results are not replayed")
+{
+	const uint8_t frameA[] = { 0x55, 0x03, 0x00, 0x10, 0x00, 0x01, 0xAA, 0xBB };
+	const uint8_t frameC[] = { 0x56, 0x03, 0x00, 0x10, 0x00, 0x01, 0xEE, 0xFF };
+	Rs485ReplayChannel channel;
+	Rs485WorkerReply out;
+
+	channel.beginScope();
+	REQUIRE(channel.next(frameA, sizeof(frameA), out) == Rs485ReplayStep::Submit);
+	channel.submitted(frameA, sizeof(frameA), 7);
+	channel.endScope();
+
+	// A blocking caller's reply shares the result ring but is not ours.
+	CHECK_FALSE(channel.collected(6, replyWithWord(0x0001)));
+	CHECK(channel.awaiting());
+
+	// The chain moves on to a different frame: A is abandoned and C is submitted instead.
+	channel.beginScope();
+	REQUIRE(channel.next(frameC, sizeof(frameC), out) == Rs485ReplayStep::Submit);
+	channel.submitted(frameC, sizeof(frameC), 8);
+	channel.endScope();
+	CHECK_FALSE(channel.collected(7, replyWithWord(0x0AAA)));
+	CHECK(channel.collected(8, replyWithWord(0x0CCC)));
+
+	channel.beginScope();
+	REQUIRE(channel.next(frameC, sizeof(frameC), out) == Rs485ReplayStep::Replayed);
+	CHECK(wordOf(out) == 0x0CCC);
+	CHECK_FALSE(channel.endScope());
+}
+
+TEST_CASE("rs485 replay: a chain that branches differently drops the replies after the branch")
+{
+	const uint8_t frameA[] = { 0x55, 0x03, 0x00, 0x10, 0x00, 0x01, 0xAA, 0xBB };
+	const uint8_t frameB[] = { 0x55, 0x03, 0x00, 0x20, 0x00, 0x01, 0xCC, 0xDD };
+	const uint8_t frameC[] = { 0x55, 0x03, 0x00, 0x30, 0x00, 0x01, 0x11, 0x22 };
+	Rs485ReplayChannel channel;
+	Rs485WorkerReply out;
+
+	for (uint32_t seq = 1; seq <= 2; ++seq) {
+		channel.beginScope();
+		if (seq == 2) {
+			REQUIRE(channel.next(frameA, sizeof(frameA), out) == Rs485ReplayStep::Replayed);
+		}
+		const uint8_t *frame = (seq == 1) ? frameA : frameB;
+		REQUIRE(channel.next(frame, sizeof(frameA), out) == Rs485ReplayStep::Submit);
+		channel.submitted(frame, sizeof(frameA), seq);
+		channel.endScope();
+		REQUIRE(channel.collected(seq, replyWithWord(static_cast<uint16_t>(seq))));
+	}
+	REQUIRE(channel.replayCount() == 2u);
+
+	channel.beginScope();
+	REQUIRE(channel.next(frameA, sizeof(frameA), out) == Rs485ReplayStep::Replayed);
+	CHECK(channel.next(frameC, sizeof(frameC), out) == Rs485ReplayStep::Submit);
+	CHECK(channel.replayCount() == 1u);
+}
+
+TEST_CASE("rs485 replay: a chain longer than the replay list falls back to waiting")
+{
+	Rs485ReplayChannel channel;
+	Rs485WorkerReply out;
+	uint8_t frames[kRs485ReplayDepth + 1][8] = {};
+	for (size_t i = 0; i <= kRs485ReplayDepth; ++i) {
+		frames[i][0] = 0x55;
+		frames[i][1] = 0x03;
+		frames[i][3] = static_cast<uint8_t>(i);
+	}
+
+	for (size_t turn = 0; turn < kRs485ReplayDepth; ++turn) {
+		channel.beginScope();
+		for (size_t i = 0; i < turn; ++i) {
+			REQUIRE(channel.next(frames[i], 8, out) == Rs485ReplayStep::Replayed);
+		}
+		REQUIRE(channel.next(frames[turn], 8, out) == Rs485ReplayStep::Submit);
+		channel.submitted(frames[turn], 8, static_cast<uint32_t>(turn + 1));
+		channel.endScope();
+		REQUIRE(channel.collected(static_cast<uint32_t>(turn + 1), replyWithWord(static_cast<uint16_t>(turn))));
+	}
+
+	channel.beginScope();
+	for (size_t i = 0; i < kRs485ReplayDepth; ++i) {
+		REQUIRE(channel.next(frames[i], 8, out) == Rs485ReplayStep::Replayed);
+	}
+	CHECK(channel.next(frames[kRs485ReplayDepth], 8, out) == Rs485ReplayStep::Wait);
+	CHECK_FALSE(channel.endScope());
+}
+
+TEST_CASE("rs485 replay: abandon forgets the in-flight request")
+{
+	const uint8_t frameA[] = { 0x55, 0x03, 0x00, 0x10, 0x00, 0x01, 0xAA, 0xBB };
+	Rs485ReplayChannel channel;
+	Rs485WorkerReply out;
+
+	channel.beginScope();
+	REQUIRE(channel.next(frameA, sizeof(frameA), out) == Rs485ReplayStep::Submit);
+	channel.submitted(frameA, sizeof(frameA), 3);
+	channel.endScope();
+	channel.abandon();
+	CHECK_FALSE(channel.awaiting());
+	CHECK_FALSE(channel.collected(3, replyWithWord(0x0003)));
+
+	channel.beginScope();
+	CHECK(channel.next(frameA, sizeof(frameA), out) == Rs485ReplayStep::Submit);
+}
+
+TEST_CASE("rs485 replay: replies carry only the receive-side response fields")
+{
+	modbusRequestAndResponse worker{};
+	worker.functionCode = 0x03;
+	worker.dataSize = 2;
+	worker.data[0] = 0x12;
+	worker.data[1] = 0x34;
+	strcpy(worker.statusMqttMessage, MODBUS_REQUEST_AND_RESPONSE_READ_DATA_REGISTER_SUCCESS_MQTT_DESC);
+	worker.registerCount = 9;
+
+	Rs485WorkerReply reply;
+	rs485ReplyFromResponse(worker, reply);
+
+	modbusRequestAndResponse caller{};
+	caller.registerCount = 1;
+	caller.returnDataType = modbusReturnDataType::unsignedShort;
+	rs485ReplyToResponse(reply, caller);
+	CHECK(caller.functionCode == 0x03);
+	CHECK(caller.dataSize == 2);
+	CHECK(caller.data[1] == 0x34);
+	CHECK(strcmp(caller.statusMqttMessage, MODBUS_REQUEST_AND_RESPONSE_READ_DATA_REGISTER_SUCCESS_MQTT_DESC) == 0);
+	CHECK(caller.registerCount == 1);
+	CHECK(caller.returnDataType == modbusReturnDataType::unsignedShort);
+}
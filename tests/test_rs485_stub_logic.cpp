@@ -1,6 +1,9 @@
 // Purpose: Validate deterministic RS485 stub backend failure policy logic in host tests.
 #include "doctest/doctest.h"
 
+#include <cstring>
+#include <string>
+
 #include "Rs485StubLogic.h"
 
 TEST_CASE("rs485 stub: offline forever always fails")
@@ -92,3 +95,36 @@ TEST_CASE("rs485 stub: integer field parsing does not steal unrelated numeric va
 	CHECK(value == 2);
 	CHECK_FALSE(rs485StubParseIntField("{\"dispatch_soc\":55}", "soc", value));
 }
+
+TEST_CASE("rs485 stub: slave set answers only configured addresses")
+{
+	Rs485StubSlaveSet slaves;
+	rs485StubSlaveSetAdd(slaves, 0x55);
+	rs485StubSlaveSetAdd(slaves, 0x56);
+	rs485StubSlaveSetAdd(slaves, 247);
+
+	CHECK(rs485StubSlaveSetContains(slaves, 0x55));
+	CHECK(rs485StubSlaveSetContains(slaves, 0x56));
+	CHECK(rs485StubSlaveSetContains(slaves, 247));
+	CHECK_FALSE(rs485StubSlaveSetContains(slaves, 0x54));
+	CHECK_FALSE(rs485StubSlaveSetContains(slaves, 0x57));
+	CHECK_FALSE(rs485StubSlaveSetContains(slaves, 0));
+}
+
+TEST_CASE("rs485 stub: each emulated slave reports a distinct serial and data")
+{
+	char primary[17] = {};
+	char second[17] = {};
+	char third[17] = {};
+	rs485StubSerialForSlave(0x55, 0x55, primary, sizeof(primary));
+	rs485StubSerialForSlave(0x56, 0x55, second, sizeof(second));
+	rs485StubSerialForSlave(0x57, 0x55, third, sizeof(third));
+
+	CHECK(std::string(primary) == "STUBSN000000000");
+	CHECK(std::string(second) == "STUBSN000000086");
+	CHECK(std::string(third) == "STUBSN000000087");
+	CHECK(strlen(second) == 15);
+
+	CHECK(rs485StubWordForSlaveRegister(0x55, 0x55, 0x0102) == rs485StubWordForRegister(0x0102));
+	CHECK(rs485StubWordForSlaveRegister(0x56, 0x55, 0x0102) != rs485StubWordForSlaveRegister(0x57, 0x55, 0x0102));
+}
@@ -87,3 +87,18 @@ TEST_CASE("scheduler runtime budget state tracks deferred backlog until a full c
 	CHECK(bucketBacklogOldestAgeMs(state, 3200u) == 0u);
 	CHECK(bucketLastFullCycleAgeMs(state, 3200u) == 200u);
 }
+
+TEST_CASE("scheduler msUntilDue agrees with shouldRun across wraparound")
+{
+	CHECK(msUntilDue(1000u, 0u, 500u) == 0u);
+	CHECK(msUntilDue(1100u, 1000u, 500u) == 400u);
+	CHECK(msUntilDue(1500u, 1000u, 500u) == 0u);
+	CHECK(msUntilDue(9000u, 1000u, 500u) == 0u);
+
+	const uint32_t last = 0xFFFFFFF0u;
+	CHECK(msUntilDue(0x00000010u, last, 0x30u) == 0x10u);
+	CHECK(msUntilDue(0x00000020u, last, 0x30u) == 0u);
+	for (uint32_t now = last; now != 0x40u; ++now) {
+		CHECK((msUntilDue(now, last, 0x30u) == 0u) == shouldRun(now, last, 0x30u));
+	}
+}
@@ -0,0 +1,73 @@
+#include <doctest/doctest.h>
+
+#include <cstring>
+#include <string>
+
+#include "ScratchPool.h"
+
+TEST_CASE("scratch pool: phases take turns on one buffer")
+{
+	ScratchPool pool{};
+	scratchPoolInit(pool, "text", 256);
+	REQUIRE(scratchPoolReserve(pool));
+	const uint8_t *storage = pool.storage;
+
+	{
+		ScratchLease json(pool, ScratchPhase::StatusJson, 256);
+		REQUIRE(json.ok());
+		CHECK(pool.holder == ScratchPhase::StatusJson);
+		snprintf(json.chars(), json.size(), "{\"a\":1}");
+	}
+	CHECK(pool.holder == ScratchPhase::None);
+	{
+		ScratchLease rows(pool, ScratchPhase::Portal, 128);
+		REQUIRE(rows.ok());
+		CHECK(reinterpret_cast<uint8_t *>(rows.chars()) == storage);
+	}
+	{
+		ScratchLease buckets(pool, ScratchPhase::PollingConfig, 200);
+		REQUIRE(buckets.ok());
+		CHECK(buckets.as<uint16_t>(100) != nullptr);
+		CHECK(buckets.as<uint16_t>(101) == nullptr);
+	}
+	CHECK(pool.stats.leases == 3);
+	CHECK(pool.stats.rejected == 0);
+	// The polling-config lease used 200 bytes, more than the 8-byte JSON or the empty portal text.
+	CHECK(pool.stats.peakBytes == 200);
+	CHECK(pool.stats.peakPhase == ScratchPhase::PollingConfig);
+	scratchPoolFree(pool);
+}
+
+TEST_CASE("scratch pool: overlapping leases are rejected")
+{
+	ScratchPool pool{};
+	scratchPoolInit(pool, "text", 128);
+	{
+		ScratchLease discovery(pool, ScratchPhase::Discovery, 64);
+		REQUIRE(discovery.ok());
+		ScratchLease status(pool, ScratchPhase::StatusJson, 64);
+		CHECK_FALSE(status.ok());
+		CHECK(status.chars() == nullptr);
+		CHECK(status.as<char>(1) == nullptr);
+		// Re-entering the same phase would alias the holder's bytes too.
+		ScratchLease nested(pool, ScratchPhase::Discovery, 16);
+		CHECK_FALSE(nested.ok());
+		CHECK(pool.stats.conflictHolder == ScratchPhase::Discovery);
+		CHECK(pool.stats.conflictRequester == ScratchPhase::Discovery);
+	}
+	// A rejected lease releases nothing; the holder's release frees the pool.
+	CHECK(pool.holder == ScratchPhase::None);
+	ScratchLease tooBig(pool, ScratchPhase::Portal, 129);
+	CHECK_FALSE(tooBig.ok());
+	CHECK(pool.stats.rejected == 3);
+	CHECK(pool.stats.leases == 1);
+
+	const ScratchPool *pools[] = { &pool };
+	char json[256];
+	REQUIRE(buildScratchPoolsJson(pools, 1, json, sizeof(json)));
+	CHECK(std::string(json) ==
+	      "{\"text\":{\"cap\":128,\"peak\":0,\"peak_phase\":\"none\",\"leases\":1,\"rejected\":3,"
+	      "\"conflict\":\"none>portal\"}}");
+	CHECK_FALSE(buildScratchPoolsJson(pools, 1, json, 32));
+	scratchPoolFree(pool);
+}
@@ -0,0 +1,225 @@
+#include <doctest/doctest.h>
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "Crc32.h"
+#include "SettingsJournal.h"
+
+namespace {
+
+class MemorySettingsStore : public SettingsStore {
+public:
+	std::vector<uint8_t> slots[2];
+	uint32_t slotWrites = 0;
+	bool failWrites = false;
+	// Keeps only this many bytes of the next write, as if power failed mid-write.
+	size_t tearNextWriteAt = SIZE_MAX;
+
+	size_t
+	readSlot(uint8_t slot, uint8_t *out, size_t outSize) override
+	{
+		const std::vector<uint8_t> &bytes = slots[slot & 1U];
+		if (bytes.empty() || bytes.size() > outSize) {
+			return 0;
+		}
+		memcpy(out, bytes.data(), bytes.size());
+		return bytes.size();
+	}
+
+	bool
+	writeSlot(uint8_t slot, const uint8_t *data, size_t len) override
+	{
+		if (failWrites) {
+			return false;
+		}
+		slotWrites++;
+		const size_t kept = (tearNextWriteAt < len) ? tearNextWriteAt : len;
+		tearNextWriteAt = SIZE_MAX;
+		slots[slot & 1U].assign(data, data + kept);
+		return kept == len;
+	}
+};
+
+std::string
+getString(const SettingsJournal &journal, const char *key)
+{
+	char value[kSettingsJournalValueMax + 1];
+	return (settingsJournalGetString(journal, key, value, sizeof(value)) == SettingsLookup::Present) ? value : "?";
+}
+
+} // namespace
+
+TEST_CASE("crc32: matches the standard check value")
+{
+	CHECK(crc32Ieee("123456789", 9) == 0xCBF43926U);
+	CHECK(crc32Ieee("", 0) == 0U);
+}
+
+TEST_CASE("settings journal: repeated writes coalesce into one flash write per flush")
+{
+	SettingsJournal journal;
+	settingsJournalInit(journal);
+	MemorySettingsStore store;
+
+	// A reboot request writes intent and mode; a config change stamps last-change several times.
+	REQUIRE(settingsJournalPutString(journal, "Boot_Intent", "wifi_config", 100));
+	REQUIRE(settingsJournalPutString(journal, "Boot_Mode", "ap_config", 110));
+	for (uint32_t i = 0; i < 5; ++i) {
+		REQUIRE(settingsJournalPutString(journal, "polling_last_change", ("2026-10-18T10:00:0" + std::to_string(i)).c_str(),
+		                                 120 + i));
+	}
+	REQUIRE(settingsJournalPutUInt(journal, "rs485_baud", 9600, 130));
+	CHECK(settingsJournalPending(journal) == 4);
+	CHECK(journal.coalesced == 4);
+	CHECK(store.slotWrites == 0);
+
+	// Reads see pending values before anything reaches flash.
+	uint32_t baud = 0;
+	CHECK(settingsJournalGetUInt(journal, "rs485_baud", baud) == SettingsLookup::Present);
+	CHECK(baud == 9600);
+	CHECK(getString(journal, "polling_last_change") == "2026-10-18T10:00:04");
+	CHECK(settingsJournalGetUInt(journal, "poll_interval_s", baud) == SettingsLookup::Missing);
+
+	REQUIRE(settingsJournalFlush(journal, store));
+	CHECK(store.slotWrites == 1);
+	CHECK(settingsJournalPending(journal) == 0);
+	CHECK(journal.generation == 1);
+	CHECK(settingsJournalWriteCount(journal, "polling_last_change") == 1);
+	CHECK(settingsJournalWriteCount(journal, "Boot_Intent") == 1);
+
+	// Rewriting a stored value is free; only real changes dirty the journal.
+	REQUIRE(settingsJournalPutUInt(journal, "rs485_baud", 9600, 200));
+	REQUIRE(settingsJournalPutString(journal, "Boot_Mode", "ap_config", 200));
+	CHECK(settingsJournalPending(journal) == 0);
+	REQUIRE(settingsJournalFlush(journal, store));
+	CHECK(store.slotWrites == 1);
+
+	REQUIRE(settingsJournalRemove(journal, "rs485_baud", 300));
+	REQUIRE(settingsJournalFlush(journal, store));
+	CHECK(store.slotWrites == 2);
+	CHECK(settingsJournalGetUInt(journal, "rs485_baud", baud) == SettingsLookup::Removed);
+	CHECK(settingsJournalWriteCount(journal, "rs485_baud") == 2);
+	CHECK(settingsJournalWriteCount(journal, "Boot_Mode") == 1);
+
+	// Write-through paths report their own writes.
+	settingsJournalNoteWrite(journal, "Bucket_Map");
+	settingsJournalNoteWrite(journal, "Bucket_Map");
+	CHECK(settingsJournalWriteCount(journal, "Bucket_Map") == 2);
+
+	char json[512];
+	REQUIRE(buildSettingsJournalJson(journal, json, sizeof(json)));
+	const std::string text(json);
+	CHECK(text.find("\"gen\":2,\"pending\":0,\"flushes\":2") != std::string::npos);
+	CHECK(text.find("\"rs485_baud\":2") != std::string::npos);
+	CHECK(text.find("\"Bucket_Map\":2") != std::string::npos);
+	CHECK_FALSE(buildSettingsJournalJson(journal, json, 40));
+}
+
+TEST_CASE("settings journal: flush timing waits for quiet but bounds the delay")
+{
+	SettingsJournal journal;
+	settingsJournalInit(journal);
+	CHECK(settingsJournalMsUntilFlush(journal, 0, 1000, 5000) == kSettingsJournalNoFlush);
+
+	REQUIRE(settingsJournalPutUInt(journal, "k", 1, 10000));
+	CHECK(settingsJournalMsUntilFlush(journal, 10000, 1000, 5000) == 1000);
+	CHECK(settingsJournalMsUntilFlush(journal, 10600, 1000, 5000) == 400);
+	// Each change restarts the quiet period...
+	for (uint32_t t = 10500; t <= 14500; t += 500) {
+		REQUIRE(settingsJournalPutUInt(journal, "k", t, t));
+	}
+	CHECK(settingsJournalMsUntilFlush(journal, 14500, 1000, 5000) == 500);
+	// ...but a steady stream of changes is still flushed maxDelay after the first one.
+	CHECK(settingsJournalMsUntilFlush(journal, 15000, 1000, 5000) == 0);
+
+	// Wraparound of the millisecond clock does not stall the timer.
+	SettingsJournal wrapped;
+	settingsJournalInit(wrapped);
+	REQUIRE(settingsJournalPutUInt(wrapped, "k", 1, UINT32_MAX - 100));
+	CHECK(settingsJournalMsUntilFlush(wrapped, 400, 1000, 5000) == 499);
+}
+
+TEST_CASE("settings journal: a reload sees the newest complete generation")
+{
+	MemorySettingsStore store;
+	SettingsJournal journal;
+	settingsJournalInit(journal);
+	REQUIRE(settingsJournalPutString(journal, "Boot_Intent", "normal", 0));
+	REQUIRE(settingsJournalPutUInt(journal, "rs485_baud", 115200, 0));
+	REQUIRE(settingsJournalFlush(journal, store));
+	REQUIRE(settingsJournalPutString(journal, "Boot_Intent", "ap_config", 0));
+	REQUIRE(settingsJournalFlush(journal, store));
+	CHECK(store.slotWrites == 2);
+	CHECK_FALSE(store.slots[0].empty());
+	CHECK_FALSE(store.slots[1].empty());
+
+	SettingsJournal reloaded;
+	settingsJournalInit(reloaded);
+	REQUIRE(settingsJournalLoad(reloaded, store));
+	CHECK(reloaded.generation == 2);
+	CHECK(getString(reloaded, "Boot_Intent") == "ap_config");
+	CHECK(settingsJournalPending(reloaded) == 0);
+
+	// Power fails halfway through generation 3: the torn slot is ignored and generation 2 survives
+	// whole, including keys the torn write also carried.
+	REQUIRE(settingsJournalPutString(reloaded, "Boot_Intent", "wifi_config", 0));
+	REQUIRE(settingsJournalPutUInt(reloaded, "rs485_baud", 9600, 0));
+	store.tearNextWriteAt = 20;
+	CHECK_FALSE(settingsJournalFlush(reloaded, store));
+	CHECK(reloaded.flushFailures == 1);
+	CHECK(settingsJournalPending(reloaded) == 2);
+
+	SettingsJournal afterTear;
+	settingsJournalInit(afterTear);
+	REQUIRE(settingsJournalLoad(afterTear, store));
+	CHECK(afterTear.generation == 2);
+	CHECK(getString(afterTear, "Boot_Intent") == "ap_config");
+	uint32_t baud = 0;
+	REQUIRE(settingsJournalGetUInt(afterTear, "rs485_baud", baud) == SettingsLookup::Present);
+	CHECK(baud == 115200);
+
+	// The still-pending keys retry into the same slot and win on the next load.
+	REQUIRE(settingsJournalFlush(reloaded, store));
+	SettingsJournal afterRetry;
+	settingsJournalInit(afterRetry);
+	REQUIRE(settingsJournalLoad(afterRetry, store));
+	CHECK(afterRetry.generation == 3);
+	CHECK(getString(afterRetry, "Boot_Intent") == "wifi_config");
+
+	// Nothing valid at all leaves an empty journal, so callers fall back to their old keys.
+	MemorySettingsStore blank;
+	blank.slots[0] = { 'S', 'J', 1, 0 };
+	SettingsJournal empty;
+	settingsJournalInit(empty);
+	CHECK_FALSE(settingsJournalLoad(empty, blank));
+	CHECK(empty.count == 0);
+}
+
+TEST_CASE("settings journal: puts that do not fit are refused so the caller writes through")
+{
+	SettingsJournal journal;
+	settingsJournalInit(journal);
+	CHECK_FALSE(settingsJournalPutUInt(journal, "", 1, 0));
+	CHECK_FALSE(settingsJournalPutUInt(journal, "a_key_that_is_much_too_long", 1, 0));
+	const std::string longValue(kSettingsJournalValueMax + 1, 'x');
+	CHECK_FALSE(settingsJournalPutString(journal, "Bucket_Map", longValue.c_str(), 0));
+
+	for (size_t i = 0; i < kSettingsJournalKeys; ++i) {
+		REQUIRE(settingsJournalPutUInt(journal, ("key" + std::to_string(i)).c_str(), 1, 0));
+	}
+	CHECK_FALSE(settingsJournalPutUInt(journal, "one_more", 1, 0));
+	// Keys the journal already owns can still change when the table is full.
+	CHECK(settingsJournalPutUInt(journal, "key3", 2, 0));
+
+	MemorySettingsStore store;
+	store.failWrites = true;
+	CHECK_FALSE(settingsJournalFlush(journal, store));
+	CHECK(settingsJournalPending(journal) == kSettingsJournalKeys);
+	CHECK(settingsJournalWriteCount(journal, "key3") == 0);
+	store.failWrites = false;
+	REQUIRE(settingsJournalFlush(journal, store));
+	uint8_t record[kSettingsJournalRecordMaxBytes];
+	CHECK(store.readSlot(1, record, sizeof(record)) <= kSettingsJournalRecordMaxBytes);
+}
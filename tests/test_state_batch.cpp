@@ -0,0 +1,213 @@
+#include <doctest/doctest.h>
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "StateBatch.h"
+
+TEST_CASE("state batch: numbers stay raw and strings are escaped")
+{
+	StateBatch batch;
+	stateBatchReset(batch);
+	CHECK(stateBatchFinish(batch) == nullptr);
+
+	CHECK(stateBatchAppend(batch, "battery_soc", "57.4", 3) == StateBatchAppend::Added);
+	CHECK(stateBatchAppend(batch, "grid_power", "-1200", 4) == StateBatchAppend::Added);
+	CHECK(stateBatchAppend(batch, "op_mode", "Load \"Follow\"", 9) == StateBatchAppend::Added);
+	CHECK(stateBatchAppend(batch, "note", "a\\b\n", 10) == StateBatchAppend::Added);
+	CHECK(batch.entries == 4u);
+	CHECK(batch.entityIndex[2] == 9u);
+	CHECK(std::strcmp(stateBatchFinish(batch),
+	                  "{\"battery_soc\":57.4,\"grid_power\":-1200,"
+	                  "\"op_mode\":\"Load \\\"Follow\\\"\",\"note\":\"a\\\\b\\u000a\"}") == 0);
+	// Finishing twice is harmless; appending afterwards is not allowed.
+	CHECK(stateBatchFinish(batch)[batch.used - 1] == '}');
+	CHECK(stateBatchAppend(batch, "late", "1", 11) == StateBatchAppend::Rejected);
+}
+
+TEST_CASE("state batch: number detection follows JSON grammar")
+{
+	CHECK(stateBatchValueIsNumber("0"));
+	CHECK(stateBatchValueIsNumber("-0.5"));
+	CHECK(stateBatchValueIsNumber("12e3"));
+	CHECK(stateBatchValueIsNumber("1.25E-2"));
+	CHECK_FALSE(stateBatchValueIsNumber(""));
+	CHECK_FALSE(stateBatchValueIsNumber("012"));
+	CHECK_FALSE(stateBatchValueIsNumber("1."));
+	CHECK_FALSE(stateBatchValueIsNumber(".5"));
+	CHECK_FALSE(stateBatchValueIsNumber("nan"));
+	CHECK_FALSE(stateBatchValueIsNumber("12 kW"));
+}
+
+TEST_CASE("state batch: full batches ask for a flush and oversize entries are rejected")
+{
+	StateBatch batch;
+	stateBatchReset(batch);
+	char key[16];
+	size_t added = 0;
+	StateBatchAppend result = StateBatchAppend::Added;
+	while (result == StateBatchAppend::Added) {
+		snprintf(key, sizeof(key), "entity_%02u", static_cast<unsigned>(added));
+		result = stateBatchAppend(batch, key, "12345.6", static_cast<uint16_t>(added));
+		if (result == StateBatchAppend::Added) {
+			++added;
+		}
+	}
+	CHECK(result == StateBatchAppend::Full);
+	CHECK(added == batch.entries);
+	CHECK(stateBatchFinish(batch) != nullptr);
+	CHECK(std::strlen(batch.json) == batch.used);
+	CHECK(batch.used < kStateBatchBufferSize);
+
+	stateBatchReset(batch);
+	CHECK(stateBatchAppend(batch, key, "12345.6", 0) == StateBatchAppend::Added);
+
+	char huge[kStateBatchBufferSize + 8];
+	std::memset(huge, 'x', sizeof(huge) - 1);
+	huge[sizeof(huge) - 1] = '\0';
+	CHECK(stateBatchAppend(batch, "big", huge, 1) == StateBatchAppend::Rejected);
+	CHECK(stateBatchAppend(batch, "", "1", 1) == StateBatchAppend::Rejected);
+}
+
+TEST_CASE("state batch: eligibility keeps bespoke-template and retained entities on their own topics")
+{
+	CHECK(stateBatchEntityEligible(mqttEntityId::entityBatSoc, false, BucketId::TenSec));
+	CHECK(stateBatchEntityEligible(mqttEntityId::entityBatSoc, false, BucketId::User));
+	CHECK_FALSE(stateBatchEntityEligible(mqttEntityId::entityBatSoc, true, BucketId::TenSec));
+	CHECK_FALSE(stateBatchEntityEligible(mqttEntityId::entityBatSoc, false, BucketId::Disabled));
+	CHECK_FALSE(stateBatchEntityEligible(mqttEntityId::entityBatFaults, false, BucketId::OneMin));
+	CHECK_FALSE(stateBatchEntityEligible(mqttEntityId::entityGridAvail, false, BucketId::TenSec));
+}
+
+TEST_CASE("state batch: topic and value template builders")
+{
+	char out[96];
+	CHECK(buildStateBatchTopic("A2M-1", "alpha2mqtt_aabbcc", BucketId::TenSec, out, sizeof(out)));
+	CHECK(std::strcmp(out, "A2M-1/alpha2mqtt_aabbcc/bucket/ten_sec/state") == 0);
+	CHECK_FALSE(buildStateBatchTopic("A2M-1", "", BucketId::TenSec, out, sizeof(out)));
+	CHECK_FALSE(buildStateBatchTopic("A2M-1", "alpha2mqtt_aabbcc", BucketId::TenSec, out, 12));
+	CHECK(out[0] == '\0');
+
+	CHECK(buildStateBatchValueTemplate("battery_soc", out, sizeof(out)));
+	CHECK(std::strcmp(out, "{{ value_json.get('battery_soc', this.state) }}") == 0);
+	CHECK_FALSE(buildStateBatchValueTemplate("bad'key", out, sizeof(out)));
+}
+
+namespace {
+// What HA does with a batch value_template on each message: the entity's value when the document
+// carries its key, otherwise the fallback expression.
+std::string
+renderBatchTemplate(const char *valueTemplate, const char *doc, const std::string &currentState)
+{
+	const char *keyStart = std::strstr(valueTemplate, "value_json.get('");
+	REQUIRE(keyStart != nullptr);
+	keyStart += std::strlen("value_json.get('");
+	const char *keyEnd = std::strchr(keyStart, '\'');
+	REQUIRE(keyEnd != nullptr);
+	const std::string needle = "\"" + std::string(keyStart, keyEnd) + "\":";
+	const char *hit = std::strstr(doc, needle.c_str());
+	if (hit == nullptr) {
+		if (std::strncmp(keyEnd, "', this.state)", std::strlen("', this.state)")) == 0) {
+			return currentState;
+		}
+		return std::string();
+	}
+	hit += needle.size();
+	return std::string(hit, hit + std::strcspn(hit, ",}"));
+}
+} // namespace
+
+TEST_CASE("state batch: entities missing from a split document keep their state")
+{
+	// A bucket too large for one document is published as several documents on the same topic;
+	// every entity's template sees every document.
+	constexpr unsigned kEntities = 60;
+	std::vector<std::string> docs;
+	std::vector<size_t> docOfEntity(kEntities);
+	StateBatch batch;
+	stateBatchReset(batch);
+	char key[32];
+	char value[16];
+	for (unsigned i = 0; i < kEntities; ++i) {
+		snprintf(key, sizeof(key), "ess_metric_%02u", i);
+		snprintf(value, sizeof(value), "%u.5", 1000 + i);
+		StateBatchAppend result = stateBatchAppend(batch, key, value, static_cast<uint16_t>(i));
+		if (result == StateBatchAppend::Full) {
+			docs.emplace_back(stateBatchFinish(batch));
+			stateBatchReset(batch);
+			result = stateBatchAppend(batch, key, value, static_cast<uint16_t>(i));
+		}
+		REQUIRE(result == StateBatchAppend::Added);
+		docOfEntity[i] = docs.size();
+	}
+	docs.emplace_back(stateBatchFinish(batch));
+	REQUIRE(docs.size() >= 2);
+
+	char valueTemplate[96];
+	for (unsigned i = 0; i < kEntities; ++i) {
+		snprintf(key, sizeof(key), "ess_metric_%02u", i);
+		snprintf(value, sizeof(value), "%u.5", 1000 + i);
+		REQUIRE(buildStateBatchValueTemplate(key, valueTemplate, sizeof(valueTemplate)));
+		std::string state = "previous";
+		for (size_t d = 0; d < docs.size(); ++d) {
+			state = renderBatchTemplate(valueTemplate, docs[d].c_str(), state);
+			if (d < docOfEntity[i]) {
+				CHECK(state == "previous");
+			} else {
+				CHECK(state == value);
+			}
+		}
+	}
+}
+
+TEST_CASE("state batch: one document per bucket cuts publishes and bytes on the wire")
+{
+	CHECK(mqttPublishPacketBytes(10, 5) == 1 + 1 + 2 + 10 + 5);
+	CHECK(mqttPublishPacketBytes(0, 125) == 1 + 1 + 2 + 125);
+	CHECK(mqttPublishPacketBytes(0, 126) == 1 + 2 + 2 + 126);
+
+	// A ten-second bucket with 30 numeric entities on an inverter device.
+	const char *deviceName = "Alpha2MQTT";
+	const char *deviceId = "alpha2mqtt_inv_al2002321010043";
+	char topic[128];
+	char key[32];
+	char value[16];
+	size_t perEntityPublishes = 0;
+	size_t perEntityBytes = 0;
+
+	StateBatch batch;
+	stateBatchReset(batch);
+	size_t batchPublishes = 0;
+	size_t batchBytes = 0;
+	char batchTopic[128];
+	REQUIRE(buildStateBatchTopic(deviceName, deviceId, BucketId::TenSec, batchTopic, sizeof(batchTopic)));
+
+	for (unsigned i = 0; i < 30; ++i) {
+		snprintf(key, sizeof(key), "ess_metric_%02u", i);
+		snprintf(value, sizeof(value), "%u.%u", 100 + i * 7, i % 10);
+		snprintf(topic, sizeof(topic), "%s/%s/%s/state", deviceName, deviceId, key);
+		perEntityPublishes++;
+		perEntityBytes += mqttPublishPacketBytes(std::strlen(topic), std::strlen(value));
+
+		StateBatchAppend result = stateBatchAppend(batch, key, value, static_cast<uint16_t>(i));
+		if (result == StateBatchAppend::Full) {
+			const char *doc = stateBatchFinish(batch);
+			batchPublishes++;
+			batchBytes += mqttPublishPacketBytes(std::strlen(batchTopic), std::strlen(doc));
+			stateBatchReset(batch);
+			result = stateBatchAppend(batch, key, value, static_cast<uint16_t>(i));
+		}
+		REQUIRE(result == StateBatchAppend::Added);
+	}
+	const char *doc = stateBatchFinish(batch);
+	REQUIRE(doc != nullptr);
+	batchPublishes++;
+	batchBytes += mqttPublishPacketBytes(std::strlen(batchTopic), std::strlen(doc));
+
+	CHECK(perEntityPublishes == 30u);
+	CHECK(batchPublishes == 1u);
+	// Topic strings dominate the per-entity cost; the batch pays for one topic plus JSON keys.
+	CHECK(batchBytes * 2 < perEntityBytes);
+}
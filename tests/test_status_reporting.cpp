@@ -4,6 +4,7 @@
 
 #include "doctest/doctest.h"
 
+#include "CoopScheduler.h"
 #include "Definitions.h"
 #include "StatusReporting.h"
 
@@ -96,6 +97,12 @@ TEST_CASE("status net JSON builder includes required keys")
 	snapshot.wifiStatus = "Connected";
 	snapshot.wifiStatusCode = 3;
 	snapshot.wifiReconnects = 1;
+	snapshot.historySamples = 420;
+	snapshot.historyUsedBytes = 1500;
+	snapshot.historyCapacityBytes = 2048;
+	snapshot.historyOldestAgeS = 3600;
+	snapshot.historyDropped = 9;
+	snapshot.historyReplaySamplesPerSec = 180;
 
 	char buffer[4096];
 	CHECK(buildStatusNetJson(snapshot, buffer, sizeof(buffer)));
@@ -109,6 +116,12 @@ TEST_CASE("status net JSON builder includes required keys")
 	CHECK(payload.find("\"max_frag_pct\":35") != std::string::npos);
 	CHECK(payload.find("\"mqtt_reconnects\":2") != std::string::npos);
 	CHECK(payload.find("\"wifi_status\":\"Connected\"") != std::string::npos);
+	CHECK(payload.find("\"history_samples\":420") != std::string::npos);
+	CHECK(payload.find("\"history_used_bytes\":1500") != std::string::npos);
+	CHECK(payload.find("\"history_capacity_bytes\":2048") != std::string::npos);
+	CHECK(payload.find("\"history_oldest_age_s\":3600") != std::string::npos);
+	CHECK(payload.find("\"history_dropped\":9") != std::string::npos);
+	CHECK(payload.find("\"history_replay_sps\":180") != std::string::npos);
 }
 
 TEST_CASE("status net JSON builder escapes SSID content")
@@ -166,6 +179,12 @@ TEST_CASE("status poll JSON builder includes required keys")
 	snapshot.essSnapshotAttempts = 3;
 	snapshot.essPowerSnapshotLastBuildMs = 91;
 	snapshot.snapshotPublishSkipCount = 7;
+	snapshot.haDiscoveryPublishCount = 12;
+	snapshot.haDiscoverySkipCount = 140;
+	snapshot.mqttOutDepth = 3;
+	snapshot.mqttOutMaxDepth = 17;
+	snapshot.mqttOutCoalesced = 250;
+	snapshot.mqttOutDropped = 2;
 	snapshot.rs485StubMode = "offline";
 	snapshot.rs485StubFailRemaining = 0;
 	snapshot.rs485StubWriteCount = 3;
@@ -236,6 +255,12 @@ TEST_CASE("status poll JSON builder includes required keys")
 	CHECK(payload.find("\"ess_snapshot_attempts\":3") != std::string::npos);
 	CHECK(payload.find("\"ess_power_snapshot_last_build_ms\":91") != std::string::npos);
 	CHECK(payload.find("\"snapshot_publish_skip_count\":7") != std::string::npos);
+	CHECK(payload.find("\"ha_discovery_publish_count\":12") != std::string::npos);
+	CHECK(payload.find("\"ha_discovery_skip_count\":140") != std::string::npos);
+	CHECK(payload.find("\"mqtt_out_depth\":3") != std::string::npos);
+	CHECK(payload.find("\"mqtt_out_max_depth\":17") != std::string::npos);
+	CHECK(payload.find("\"mqtt_out_coalesced\":250") != std::string::npos);
+	CHECK(payload.find("\"mqtt_out_dropped\":2") != std::string::npos);
 	CHECK(payload.find("\"dispatch_last_run_ms\":0") != std::string::npos);
 	CHECK(payload.find("\"dispatch_wait_due_to_snapshot_ms\":33") != std::string::npos);
 	CHECK(payload.find("\"dispatch_queue_coalesce_count\":4") != std::string::npos);
@@ -910,3 +935,28 @@ TEST_CASE("status power snapshot diag counts JSON builder includes per-subread c
 	char tooSmall[32];
 	CHECK_FALSE(buildStatusPowerSnapshotDiagCountsJson(snapshot, tooSmall, sizeof(tooSmall)));
 }
+
+TEST_CASE("status tasks JSON builder reports per-task loop accounting")
+{
+	CoopScheduler sched;
+	sched.passes = 12;
+	sched.count = 2;
+	sched.tasks[0].name = "oled";
+	sched.tasks[0].stats.runs = 4;
+	sched.tasks[0].stats.cpuMs = 37;
+	sched.tasks[0].stats.maxRunMs = 11;
+	sched.tasks[1].name = "send_data";
+	sched.tasks[1].stats.overruns = 2;
+	sched.tasks[1].stats.maxLatencyMs = 140;
+
+	char buffer[256];
+	REQUIRE(buildStatusTasksJson(sched, buffer, sizeof(buffer)));
+	const std::string payload(buffer);
+	CHECK(payload ==
+	      "{\"passes\":12,\"tasks\":{"
+	      "\"oled\":{\"runs\":4,\"cpu_ms\":37,\"max_ms\":11,\"overruns\":0,\"max_lat_ms\":0},"
+	      "\"send_data\":{\"runs\":0,\"cpu_ms\":0,\"max_ms\":0,\"overruns\":2,\"max_lat_ms\":140}}}");
+
+	char tooSmall[48];
+	CHECK_FALSE(buildStatusTasksJson(sched, tooSmall, sizeof(tooSmall)));
+}
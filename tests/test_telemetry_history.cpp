@@ -0,0 +1,204 @@
+#include <doctest/doctest.h>
+
+#include <string>
+#include <vector>
+
+#include "MqttEntities.h"
+#include "TelemetryHistory.h"
+
+namespace {
+
+struct Collected {
+	std::vector<TelemetryHistorySample> samples;
+	size_t stopAfter = SIZE_MAX;
+};
+
+bool
+collect(void *ctx, const TelemetryHistorySample &sample)
+{
+	auto *out = static_cast<Collected *>(ctx);
+	out->samples.push_back(sample);
+	return out->samples.size() < out->stopAfter;
+}
+
+std::vector<TelemetryHistorySample>
+drainAll(TelemetryHistory &history, uint32_t nowMs)
+{
+	Collected all;
+	while (history.count > 0) {
+		telemetryHistoryForEachOldest(history, collect, &all);
+		telemetryHistoryPopOldest(history, nowMs, nowMs);
+	}
+	return all.samples;
+}
+
+std::string
+formatted(int32_t milliValue)
+{
+	char buf[24];
+	telemetryHistoryFormatValue(milliValue, buf, sizeof(buf));
+	return buf;
+}
+
+} // namespace
+
+TEST_CASE("telemetry history: decimal values round-trip through fixed point")
+{
+	int32_t value = 0;
+	CHECK(telemetryHistoryParseValue("230", &value));
+	CHECK(value == 230000);
+	CHECK(telemetryHistoryParseValue("-12.5", &value));
+	CHECK(value == -12500);
+	CHECK(telemetryHistoryParseValue("0.0015", &value));
+	CHECK(value == 2);
+	CHECK(telemetryHistoryParseValue(".5", &value));
+	CHECK(value == 500);
+	CHECK_FALSE(telemetryHistoryParseValue("", &value));
+	CHECK_FALSE(telemetryHistoryParseValue("-", &value));
+	CHECK_FALSE(telemetryHistoryParseValue("Online", &value));
+	CHECK_FALSE(telemetryHistoryParseValue("12 W", &value));
+	CHECK_FALSE(telemetryHistoryParseValue("3000000", &value));
+
+	CHECK(formatted(230000) == "230");
+	CHECK(formatted(-12500) == "-12.5");
+	CHECK(formatted(2) == "0.002");
+	CHECK(formatted(-5) == "-0.005");
+	CHECK(formatted(1230) == "1.23");
+	CHECK(formatted(INT32_MIN) == "-2147483.648");
+}
+
+TEST_CASE("telemetry history: samples replay in order with their original times and values")
+{
+	TelemetryHistory history;
+	telemetryHistoryInit(history);
+	std::vector<TelemetryHistorySample> expected;
+	uint32_t nowMs = 50000;
+	for (int pass = 0; pass < 40; ++pass) {
+		for (uint16_t key = 10; key < 14; ++key) {
+			const int32_t value = static_cast<int32_t>(key) * 100000 + pass * 37 - 500;
+			REQUIRE(telemetryHistoryRecord(history, key, nowMs, value));
+			expected.push_back({ key, nowMs, value });
+			nowMs += 3;
+		}
+		nowMs += 10000;
+	}
+	CHECK(telemetryHistorySampleCount(history) == expected.size());
+	CHECK(history.count > 1);
+	CHECK(telemetryHistoryOldestAgeMs(history, nowMs) == nowMs - 50000);
+
+	const std::vector<TelemetryHistorySample> replayed = drainAll(history, nowMs);
+	REQUIRE(replayed.size() == expected.size());
+	for (size_t i = 0; i < expected.size(); ++i) {
+		CHECK(replayed[i].key == expected[i].key);
+		CHECK(replayed[i].timestampMs == expected[i].timestampMs);
+		CHECK(replayed[i].milliValue == expected[i].milliValue);
+	}
+	CHECK(telemetryHistorySampleCount(history) == 0);
+	CHECK(telemetryHistoryOldestAgeMs(history, nowMs) == 0);
+	CHECK(history.stats.replayed == expected.size());
+	CHECK(history.stats.dropped == 0);
+}
+
+TEST_CASE("telemetry history: slowly changing values encode far below raw size")
+{
+	TelemetryHistory history;
+	telemetryHistoryInit(history);
+	uint32_t nowMs = 0;
+	for (int pass = 0; pass < 20; ++pass) {
+		for (uint16_t key = 0; key < 5; ++key) {
+			telemetryHistoryRecord(history, key, nowMs, 2500000 + pass * 10);
+			nowMs += 2;
+		}
+		nowMs += 10000;
+	}
+	// A raw record would be key(2) + timestamp(4) + value(4) bytes.
+	CHECK(telemetryHistoryUsedBytes(history) * 2 < telemetryHistorySampleCount(history) * 10);
+}
+
+TEST_CASE("telemetry history: keys beyond the delta table and extreme swings still decode")
+{
+	TelemetryHistory history;
+	telemetryHistoryInit(history);
+	std::vector<TelemetryHistorySample> expected;
+	const int32_t values[] = { INT32_MAX, INT32_MIN, 0, -1, INT32_MAX };
+	uint32_t nowMs = UINT32_MAX - 10;
+	for (uint16_t key = 0; key < kTelemetryHistoryDeltaKeys + 4; ++key) {
+		const int32_t value = values[key % 5];
+		telemetryHistoryRecord(history, static_cast<uint16_t>(key * 1000), nowMs, value);
+		expected.push_back({ static_cast<uint16_t>(key * 1000), nowMs, value });
+		nowMs += 1;
+	}
+	const std::vector<TelemetryHistorySample> replayed = drainAll(history, nowMs);
+	REQUIRE(replayed.size() == expected.size());
+	for (size_t i = 0; i < expected.size(); ++i) {
+		CHECK(replayed[i].key == expected[i].key);
+		CHECK(replayed[i].timestampMs == expected[i].timestampMs);
+		CHECK(replayed[i].milliValue == expected[i].milliValue);
+	}
+}
+
+TEST_CASE("telemetry history: a full ring evicts whole oldest blocks")
+{
+	TelemetryHistory history;
+	telemetryHistoryInit(history);
+	uint32_t nowMs = 0;
+	uint32_t written = 0;
+	while (history.stats.dropped == 0) {
+		telemetryHistoryRecord(history, static_cast<uint16_t>(written % 7), nowMs, static_cast<int32_t>(written));
+		written++;
+		nowMs += 1000;
+	}
+	CHECK(history.count == kTelemetryHistoryBlockCount);
+	CHECK(telemetryHistorySampleCount(history) + history.stats.dropped == written);
+	CHECK(telemetryHistoryUsedBytes(history) <= telemetryHistoryCapacityBytes());
+
+	// The survivors are the newest samples, still decodable.
+	const std::vector<TelemetryHistorySample> replayed = drainAll(history, nowMs);
+	REQUIRE(!replayed.empty());
+	CHECK(replayed.front().milliValue == static_cast<int32_t>(history.stats.dropped));
+	CHECK(replayed.back().milliValue == static_cast<int32_t>(written - 1));
+}
+
+TEST_CASE("telemetry history: paced replay reports throughput and stops early on sink failure")
+{
+	TelemetryHistory history;
+	telemetryHistoryInit(history);
+	for (uint32_t i = 0; i < 60; ++i) {
+		telemetryHistoryRecord(history, 1, i * 1000, static_cast<int32_t>(i));
+	}
+	const uint32_t blocks = history.count;
+	REQUIRE(blocks >= 2);
+
+	Collected partial;
+	partial.stopAfter = 3;
+	CHECK(telemetryHistoryForEachOldest(history, collect, &partial) == 3);
+	CHECK(telemetryHistorySampleCount(history) == 60);
+
+	// One block every 500 ms.
+	uint32_t nowMs = 100000;
+	while (history.count > 0) {
+		telemetryHistoryPopOldest(history, nowMs, nowMs + 20);
+		nowMs += 500;
+	}
+	const uint32_t elapsedMs = (blocks - 1) * 500 + 20;
+	CHECK(history.stats.lastReplaySamplesPerSec == 60U * 1000U / elapsedMs);
+	CHECK(history.stats.replayed == 60);
+}
+
+TEST_CASE("telemetry history: only inverter energy, power and SOC values are buffered")
+{
+	CHECK(telemetryHistoryEntityEligible(homeAssistantClass::haClassEnergy, MqttEntityScope::Inverter, false));
+	CHECK(telemetryHistoryEntityEligible(homeAssistantClass::haClassPower, MqttEntityScope::Inverter, false));
+	CHECK(telemetryHistoryEntityEligible(homeAssistantClass::haClassBattery, MqttEntityScope::Inverter, false));
+	CHECK_FALSE(telemetryHistoryEntityEligible(homeAssistantClass::haClassPower, MqttEntityScope::Inverter, true));
+	CHECK_FALSE(telemetryHistoryEntityEligible(homeAssistantClass::haClassPower, MqttEntityScope::Controller, false));
+	CHECK_FALSE(telemetryHistoryEntityEligible(homeAssistantClass::haClassSelect, MqttEntityScope::Inverter, false));
+
+	// The real catalog rows, which are retained, must qualify.
+	const mqttEntityId graphed[] = { mqttEntityId::entityGridPwr, mqttEntityId::entityBatSoc, mqttEntityId::entityPvEnergy };
+	for (mqttEntityId id : graphed) {
+		mqttState entity{};
+		REQUIRE(mqttEntityCopyById(id, &entity));
+		CHECK(telemetryHistoryEntityEligible(entity.haClass, entity.scope, entity.subscribe));
+	}
+}
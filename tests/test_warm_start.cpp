@@ -0,0 +1,112 @@
+#include <doctest/doctest.h>
+
+#include <cstring>
+#include <string>
+
+#include "Crc32.h"
+#include "WarmStart.h"
+
+namespace {
+
+WarmStartRecord
+sampleRecord()
+{
+	WarmStartRecord record{};
+	record.baud = 115200;
+	record.slaveId = 0x55;
+	record.planFingerprint = 0x1234ABCDU;
+	record.discoveryFingerprint = 0x0BADF00DU;
+	strcpy(record.serial, "AL2002321010043");
+	strcpy(record.firmware, "1760000000000");
+	return record;
+}
+
+} // namespace
+
+TEST_CASE("warm start: records round-trip and damaged ones are rejected")
+{
+	const WarmStartRecord record = sampleRecord();
+	uint8_t encoded[kWarmStartRecordBytes];
+	REQUIRE(warmStartEncode(record, encoded, sizeof(encoded)) == kWarmStartRecordBytes);
+	CHECK(warmStartEncode(record, encoded, sizeof(encoded) - 1) == 0);
+
+	WarmStartRecord decoded{};
+	REQUIRE(warmStartDecode(encoded, sizeof(encoded), decoded));
+	CHECK(warmStartRecordEqual(decoded, record));
+	CHECK(decoded.baud == 115200);
+	CHECK(decoded.slaveId == 0x55);
+	CHECK(strcmp(decoded.serial, "AL2002321010043") == 0);
+	CHECK(strcmp(decoded.firmware, "1760000000000") == 0);
+
+	WarmStartRecord changed = record;
+	changed.planFingerprint++;
+	CHECK_FALSE(warmStartRecordEqual(changed, record));
+
+	// Every single-byte change fails the magic, version or CRC check.
+	for (size_t i = 0; i < sizeof(encoded); ++i) {
+		CAPTURE(i);
+		uint8_t damaged[kWarmStartRecordBytes];
+		memcpy(damaged, encoded, sizeof(damaged));
+		damaged[i] ^= 0x01;
+		WarmStartRecord out = sampleRecord();
+		CHECK_FALSE(warmStartDecode(damaged, sizeof(damaged), out));
+		CHECK(warmStartRecordEqual(out, record));
+	}
+	CHECK_FALSE(warmStartDecode(encoded, sizeof(encoded) - 1, decoded));
+	CHECK_FALSE(warmStartDecode(nullptr, sizeof(encoded), decoded));
+
+	// A valid CRC does not excuse an unterminated string or a record with nothing to verify.
+	uint8_t unterminated[kWarmStartRecordBytes];
+	memcpy(unterminated, encoded, sizeof(unterminated));
+	memset(unterminated + 16, 'x', 17);
+	const uint32_t crc = crc32Ieee(unterminated, kWarmStartRecordBytes - 4);
+	for (size_t b = 0; b < 4; ++b) {
+		unterminated[kWarmStartRecordBytes - 4 + b] = static_cast<uint8_t>(crc >> (8 * b));
+	}
+	CHECK_FALSE(warmStartDecode(unterminated, sizeof(unterminated), decoded));
+
+	WarmStartRecord empty{};
+	REQUIRE(warmStartEncode(empty, encoded, sizeof(encoded)) == kWarmStartRecordBytes);
+	CHECK_FALSE(warmStartDecode(encoded, sizeof(encoded), decoded));
+}
+
+TEST_CASE("warm start: resume decisions")
+{
+	const WarmStartRecord record = sampleRecord();
+	CHECK(warmStartUsable(record, 0x55));
+	// A different primary slave id means the record describes another inverter.
+	CHECK_FALSE(warmStartUsable(record, 0x56));
+	CHECK_FALSE(warmStartUsable(WarmStartRecord{}, 0));
+
+	CHECK(warmStartVerified(record, "AL2002321010043"));
+	CHECK_FALSE(warmStartVerified(record, "AL2002321010044"));
+	CHECK_FALSE(warmStartVerified(record, ""));
+	CHECK_FALSE(warmStartVerified(record, nullptr));
+
+	CHECK(warmStartDiscoveryCurrent(record, "1760000000000", 0x1234ABCDU, 0x0BADF00DU));
+	// New firmware, a changed polling plan or a changed discovery table all need the refresh first.
+	CHECK_FALSE(warmStartDiscoveryCurrent(record, "1760000000001", 0x1234ABCDU, 0x0BADF00DU));
+	CHECK_FALSE(warmStartDiscoveryCurrent(record, "1760000000000", 0x1234ABCEU, 0x0BADF00DU));
+	CHECK_FALSE(warmStartDiscoveryCurrent(record, "1760000000000", 0x1234ABCDU, 0x0BADF00EU));
+	CHECK_FALSE(warmStartDiscoveryCurrent(record, nullptr, 0x1234ABCDU, 0x0BADF00DU));
+}
+
+TEST_CASE("warm start: boot stats json")
+{
+	WarmStartBootStats stats{};
+	stats.outcome = WarmStartOutcome::Resumed;
+	stats.discoveryHeld = true;
+	stats.identityReads = 1;
+	stats.rs485ConnectedMs = 812;
+	stats.firstPublishMs = 1450;
+
+	char json[160];
+	REQUIRE(buildWarmStartJson(stats, json, sizeof(json)));
+	CHECK(std::string(json) ==
+	      "{\"outcome\":\"resumed\",\"identity_reads\":1,\"rs485_connected_ms\":812,\"first_publish_ms\":1450,"
+	      "\"discovery_held\":true}");
+	CHECK_FALSE(buildWarmStartJson(stats, json, 40));
+
+	CHECK(std::string(warmStartOutcomeName(WarmStartOutcome::Cold)) == "cold");
+	CHECK(std::string(warmStartOutcomeName(WarmStartOutcome::Mismatch)) == "mismatch");
+}